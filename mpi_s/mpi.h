@@ -37,11 +37,17 @@ typedef struct {
 
 typedef MPI_Handle MPI_Aint;
 
+/* MPI-IO (MPI 2.0) */
+
+typedef MPI_Handle MPI_Info;
+typedef long int MPI_Offset;
+typedef struct mpi_file_s * MPI_File;
+
 /* Defined constants (see Annex A.2) */
 
 /* Return codes */
 
-enum return_codes {MPI_SUCCESS};
+enum return_codes {MPI_SUCCESS, MPI_ERR_FILE};
 
 /* Assorted constants */
 
@@ -100,9 +106,28 @@ enum reserved_communicators{MPI_COMM_WORLD, MPI_COMM_SELF};
 #define MPI_OP_NULL         -5
 #define MPI_ERRHANDLER_NULL -6
 
+/* MPI-IO */
+
+#define MPI_INFO_NULL       -7
+#define MPI_FILE_NULL       ((MPI_File) 0)
+
+enum file_access_modes {MPI_MODE_RDONLY = 1,
+			MPI_MODE_WRONLY = 2,
+			MPI_MODE_RDWR = 4,
+			MPI_MODE_CREATE = 8,
+			MPI_MODE_EXCL = 16,
+			MPI_MODE_DELETE_ON_CLOSE = 32,
+			MPI_MODE_UNIQUE_OPEN = 64,
+			MPI_MODE_SEQUENTIAL = 128,
+			MPI_MODE_APPEND = 256};
+
+enum array_orders {MPI_ORDER_C, MPI_ORDER_FORTRAN};
+
 /* Special values */
 
 #define MPI_IN_PLACE ((void *) 1)
+#define MPI_STATUS_IGNORE ((MPI_Status *) 0)
+#define MPI_STATUSES_IGNORE ((MPI_Status *) 0)
 
 /* Interface */
 
@@ -130,6 +155,8 @@ int MPI_Issend(void * buf, int count, MPI_Datatype datatype, int dest,
 
 
 int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status * status);
+int MPI_Get_count(const MPI_Status * status, MPI_Datatype datatype,
+		  int * count);
 int MPI_Sendrecv(void * sendbuf, int sendcount, MPI_Datatype sendtype,
 		 int dest, int sendtag, void  *recvbuf, int recvcount,
 		 MPI_Datatype recvtype, int source, MPI_Datatype recvtag,
@@ -156,6 +183,8 @@ int MPI_Waitall(int count, MPI_Request * array_of_requests,
 		MPI_Status * array_of_statuses);
 int MPI_Waitany(int count, MPI_Request array_of_req[], int * index,
 		MPI_Status * status);
+int MPI_Testall(int count, MPI_Request * array_of_requests, int * flag,
+		MPI_Status * array_of_statuses);
 int MPI_Gather(void * sendbuf, int sendcount, MPI_Datatype sendtype,
 	       void * recvbuf, int recvcount, MPI_Datatype recvtype,
 	       int root, MPI_Comm comm);
@@ -165,8 +194,18 @@ int MPI_Gatherv(const void * sendbuf, int sendcount, MPI_Datatype sendtype,
 int MPI_Allgather(void * sendbuf, int sendcount, MPI_Datatype sendtype,
 		  void * recvbuf, int recvcount, MPI_Datatype recvtype,
 		  MPI_Comm comm);
+int MPI_Allgatherv(const void * sendbuf, int sendcount, MPI_Datatype sendtype,
+		   void * recvbuf, const int * recvcounts, const int * displs,
+		   MPI_Datatype recvtype, MPI_Comm comm);
+int MPI_Alltoallv(const void * sendbuf, const int * sendcounts,
+		  const int * sdispls, MPI_Datatype sendtype, void * recvbuf,
+		  const int * recvcounts, const int * rdispls,
+		  MPI_Datatype recvtype, MPI_Comm comm);
 int MPI_Allreduce(void * send, void * recv, int count, MPI_Datatype type,
 		  MPI_Op op, MPI_Comm comm);
+int MPI_Reduce_scatter(const void * sendbuf, void * recvbuf,
+		       const int * recvcounts, MPI_Datatype type, MPI_Op op,
+		       MPI_Comm comm);
 
 int MPI_Comm_split(MPI_Comm comm, int colour, int key, MPI_Comm * newcomm);
 int MPI_Comm_free(MPI_Comm * comm);
@@ -215,6 +254,24 @@ int MPI_Type_create_struct(int count, int * arry_of_blocklens,
 			   MPI_Datatype * newtype);
 int MPI_Type_create_resized(MPI_Datatype oldtype, MPI_Aint ub, MPI_Aint extent,
 			    MPI_Datatype * newtype);
+int MPI_Type_create_subarray(int ndims, const int * array_of_sizes,
+			     const int * array_of_subsizes,
+			     const int * array_of_starts, int order,
+			     MPI_Datatype oldtype, MPI_Datatype * newtype);
+
+/* MPI-IO: the file is always a single file opened by the single rank. */
+
+int MPI_File_open(MPI_Comm comm, const char * filename, int amode,
+		  MPI_Info info, MPI_File * fh);
+int MPI_File_close(MPI_File * fh);
+int MPI_File_set_size(MPI_File fh, MPI_Offset size);
+int MPI_File_set_view(MPI_File fh, MPI_Offset disp, MPI_Datatype etype,
+		      MPI_Datatype filetype, const char * datarep,
+		      MPI_Info info);
+int MPI_File_write_all(MPI_File fh, const void * buf, int count,
+		       MPI_Datatype datatype, MPI_Status * status);
+int MPI_File_read_all(MPI_File fh, void * buf, int count,
+		      MPI_Datatype datatype, MPI_Status * status);
 
 #ifdef __cplusplus
 }
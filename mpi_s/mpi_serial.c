@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /* Use clock() only as a last resort in serial (no threads) */
 
@@ -40,19 +41,30 @@
 /* Internal state */
 
 #define MAX_CART_COMM 16
+#define MAX_USER_DT   32
+#define MPI_DT_USER   (MPI_PACKED + 1)
 
 typedef struct mpi_info_s mpi_info_t;
 
 struct mpi_info_s {
   int initialised;               /* MPI initialised */
-  int ncart;                     /* Number of Cartesian communicators */
+  int nref[MAX_CART_COMM];       /* References to Cartesian communicators */
   int period[MAX_CART_COMM][3];  /* Periodic Cartesisan per communicator */
+  int dtsize[MAX_USER_DT];       /* Size (bytes) of contiguous types; 0 free */
 };
 
 static mpi_info_t * mpi_info = NULL;
 
+/* MPI-IO file handle: a stream plus the current view displacement */
+
+struct mpi_file_s {
+  FILE * fp;                     /* Underlying stream */
+  MPI_Offset disp;               /* Displacement from file view */
+};
+
 static void mpi_copy(void * send, void * recv, int count, MPI_Datatype type);
 static int mpi_sizeof(MPI_Datatype type);
+static int mpi_is_user_dt(MPI_Datatype type);
 static int mpi_is_valid_comm(MPI_Comm comm);
 
 /*****************************************************************************
@@ -343,7 +355,26 @@ int MPI_Waitall(int count, MPI_Request * requests, MPI_Status * statuses) {
 
   assert(count >= 0);
   assert(requests);
-  assert(statuses);
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_Testall
+ *
+ *  There are no outstanding requests in serial, so all are complete.
+ *
+ *****************************************************************************/
+
+int MPI_Testall(int count, MPI_Request * requests, int * flag,
+		MPI_Status * statuses) {
+
+  assert(count >= 0);
+  assert(requests);
+  assert(flag);
+
+  *flag = 1;
 
   return MPI_SUCCESS;
 }
@@ -385,6 +416,27 @@ int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status * status) {
   return MPI_SUCCESS;
 }
 
+/*****************************************************************************
+ *
+ *  MPI_Get_count
+ *
+ *  Only meaningful after MPI_Probe (or a receive), so should not be
+ *  required in serial.
+ *
+ *****************************************************************************/
+
+int MPI_Get_count(const MPI_Status * status, MPI_Datatype datatype,
+		  int * count) {
+
+  assert(status);
+  assert(count);
+
+  printf("MPI_Get_count should not be called in serial\n");
+  exit(0);
+
+  return MPI_SUCCESS;
+}
+
 /*****************************************************************************
  *
  *  MPI_Sendrecv
@@ -496,6 +548,79 @@ int MPI_Gatherv(const void * sendbuf, int sendcount, MPI_Datatype sendtype,
   return MPI_SUCCESS;
 }
 
+/*****************************************************************************
+ *
+ *  MPI_Allgatherv
+ *
+ *****************************************************************************/
+
+int MPI_Allgatherv(const void * sendbuf, int sendcount, MPI_Datatype sendtype,
+		   void * recvbuf, const int * recvcounts, const int * displs,
+		   MPI_Datatype recvtype, MPI_Comm comm) {
+
+  assert(sendbuf);
+  assert(recvbuf);
+  assert(recvcounts);
+  assert(displs);
+  assert(sendtype == recvtype);
+  assert(sendcount == recvcounts[0]);
+  assert(mpi_is_valid_comm(comm));
+
+  mpi_copy((void *) sendbuf,
+	   (char *) recvbuf + mpi_sizeof(recvtype)*displs[0],
+	   sendcount, sendtype);
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_Alltoallv
+ *
+ *****************************************************************************/
+
+int MPI_Alltoallv(const void * sendbuf, const int * sendcounts,
+		  const int * sdispls, MPI_Datatype sendtype, void * recvbuf,
+		  const int * recvcounts, const int * rdispls,
+		  MPI_Datatype recvtype, MPI_Comm comm) {
+
+  assert(sendbuf);
+  assert(recvbuf);
+  assert(sendcounts);
+  assert(recvcounts);
+  assert(sendtype == recvtype);
+  assert(sendcounts[0] == recvcounts[0]);
+  assert(mpi_is_valid_comm(comm));
+
+  mpi_copy((char *) sendbuf + mpi_sizeof(sendtype)*sdispls[0],
+	   (char *) recvbuf + mpi_sizeof(recvtype)*rdispls[0],
+	   sendcounts[0], sendtype);
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_Reduce_scatter
+ *
+ *****************************************************************************/
+
+int MPI_Reduce_scatter(const void * sendbuf, void * recvbuf,
+		       const int * recvcounts, MPI_Datatype type, MPI_Op op,
+		       MPI_Comm comm) {
+
+  assert(sendbuf);
+  assert(recvbuf);
+  assert(recvcounts);
+  assert(mpi_is_valid_comm(comm));
+
+  if (sendbuf != MPI_IN_PLACE) {
+    mpi_copy((void *) sendbuf, recvbuf, recvcounts[0], type);
+  }
+
+  return MPI_SUCCESS;
+}
+
 /*****************************************************************************
  *
  *  MPI_Allreduce
@@ -522,14 +647,18 @@ int MPI_Allreduce(void * sendbuf, void * recvbuf, int count, MPI_Datatype type,
  *  MPI_Comm_split
  *
  *  Return the original communicator as the new communicator.
+ *  A Cartesian communicator gains a reference, which is released
+ *  by the matching MPI_Comm_free().
  *
  *****************************************************************************/
 
 int MPI_Comm_split(MPI_Comm comm, int colour, int key, MPI_Comm * newcomm) {
 
+  assert(mpi_info);
   assert(mpi_is_valid_comm(comm));
   assert(newcomm);
 
+  if (comm > MPI_COMM_SELF) mpi_info->nref[comm] += 1;
   *newcomm = comm;
 
   return MPI_SUCCESS;
@@ -543,10 +672,16 @@ int MPI_Comm_split(MPI_Comm comm, int colour, int key, MPI_Comm * newcomm) {
 
 int MPI_Comm_free(MPI_Comm * comm) {
 
-  /* Mark Cartesian communicators as free */
+  assert(mpi_info);
+  assert(comm);
+  assert(mpi_is_valid_comm(*comm));
+
+  /* Release a reference; the Cartesian communicator is free for
+   * re-use when none remain. */
 
   if (*comm > MPI_COMM_SELF) {
-    mpi_info->ncart -= 1;
+    assert(mpi_info->nref[*comm] > 0);
+    mpi_info->nref[*comm] -= 1;
   }
 
   return MPI_SUCCESS;
@@ -556,7 +691,7 @@ int MPI_Comm_free(MPI_Comm * comm) {
  *
  *  MPI_Comm_dup
  *
- *  Just return the old one.
+ *  Just return the old one (with an extra reference if Cartesian).
  *
  *****************************************************************************/
 
@@ -566,6 +701,7 @@ int MPI_Comm_dup(MPI_Comm oldcomm, MPI_Comm * newcomm) {
   assert(mpi_is_valid_comm(oldcomm));
   assert(newcomm);
 
+  if (oldcomm > MPI_COMM_SELF) mpi_info->nref[oldcomm] += 1;
   *newcomm = oldcomm;
 
   return MPI_SUCCESS;
@@ -595,15 +731,38 @@ int MPI_Type_indexed(int count, int * array_of_blocklengths,
  *
  *  MPI_Type_contiguous
  *
+ *  A contiguous type built from an elementary (or another contiguous)
+ *  type records its size so it may be used as a buffer datatype in
+ *  file and point-to-point operations. Anything else is undefined.
+ *
  *****************************************************************************/
 
 int MPI_Type_contiguous(int count, MPI_Datatype old, MPI_Datatype * newtype) {
 
+  int n;
+
+  assert(mpi_info);
   assert(count > 0);
   assert(newtype);
 
   *newtype = MPI_UNDEFINED;
 
+  if ((old < MPI_CHAR || old >= MPI_PACKED) && !mpi_is_user_dt(old)) {
+    return MPI_SUCCESS;
+  }
+
+  for (n = 0; n < MAX_USER_DT; n++) {
+    if (mpi_info->dtsize[n] == 0) break;
+  }
+
+  if (n == MAX_USER_DT) {
+    printf("MPI_Type_contiguous: too many datatypes\n");
+    MPI_Abort(MPI_COMM_WORLD, 0);
+  }
+
+  mpi_info->dtsize[n] = count*mpi_sizeof(old);
+  *newtype = MPI_DT_USER + n;
+
   return MPI_SUCCESS;
 }
 
@@ -617,7 +776,9 @@ int MPI_Type_commit(MPI_Datatype * type) {
 
   assert(type);
 
-  /* Flag this as undefined at the moment */
+  /* Contiguous types are retained; others are flagged as undefined */
+  if (mpi_is_user_dt(*type)) return MPI_SUCCESS;
+
   *type = MPI_UNDEFINED;
 
   return MPI_SUCCESS;
@@ -633,6 +794,8 @@ int MPI_Type_free(MPI_Datatype * type) {
 
   assert(type);
 
+  if (mpi_is_user_dt(*type)) mpi_info->dtsize[*type - MPI_DT_USER] = 0;
+
   *type = MPI_DATATYPE_NULL;
 
   return MPI_SUCCESS;
@@ -726,10 +889,15 @@ int MPI_Cart_create(MPI_Comm oldcomm, int ndims, int * dims, int * periods,
   assert(ndims <= 3);
   assert(newcomm);
 
-  mpi_info->ncart += 1;
-  icart = MPI_COMM_SELF + mpi_info->ncart;
+  /* Use the first free slot */
+
+  for (icart = MPI_COMM_SELF + 1; icart < MAX_CART_COMM; icart++) {
+    if (mpi_info->nref[icart] == 0) break;
+  }
   assert(icart < MAX_CART_COMM);
 
+  mpi_info->nref[icart] = 1;
+
   *newcomm = icart;
 
   /* Record periodity */
@@ -850,6 +1018,7 @@ int MPI_Cart_sub(MPI_Comm comm, int * remain_dims, MPI_Comm * new_comm) {
   assert(remain_dims);
   assert(new_comm);
 
+  if (comm > MPI_COMM_SELF) mpi_info->nref[comm] += 1;
   *new_comm = comm;
 
   return MPI_SUCCESS;
@@ -946,6 +1115,7 @@ static int mpi_sizeof(MPI_Datatype type) {
   case MPI_PACKED:
     printf("MPI_PACKED not implemented\n");
   default:
+    if (mpi_is_user_dt(type)) return mpi_info->dtsize[type - MPI_DT_USER];
     printf("Unrecognised data type\n");
     MPI_Abort(MPI_COMM_WORLD, 0);
   }
@@ -1093,8 +1263,200 @@ int MPI_Type_get_extent(MPI_Datatype datatype, MPI_Aint * lb,
   return MPI_SUCCESS;
 }
 
+/*****************************************************************************
+ *
+ *  MPI_Type_create_subarray
+ *
+ *  In serial, the subarray must be the whole array.
+ *
+ *****************************************************************************/
+
+int MPI_Type_create_subarray(int ndims, const int * array_of_sizes,
+			     const int * array_of_subsizes,
+			     const int * array_of_starts, int order,
+			     MPI_Datatype oldtype, MPI_Datatype * newtype) {
+  int n;
+
+  assert(ndims > 0);
+  assert(array_of_sizes);
+  assert(array_of_subsizes);
+  assert(array_of_starts);
+  assert(order == MPI_ORDER_C || order == MPI_ORDER_FORTRAN);
+  assert(newtype);
+
+  for (n = 0; n < ndims; n++) {
+    assert(array_of_starts[n] == 0);
+    assert(array_of_subsizes[n] == array_of_sizes[n]);
+  }
+
+  *newtype = MPI_UNDEFINED;
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_File_open
+ *
+ *  An existing file is not truncated (as MPI). Returns MPI_ERR_FILE
+ *  if the file cannot be opened.
+ *
+ *****************************************************************************/
+
+int MPI_File_open(MPI_Comm comm, const char * filename, int amode,
+		  MPI_Info info, MPI_File * fh) {
+
+  FILE * fp = NULL;
+
+  assert(mpi_is_valid_comm(comm));
+  assert(filename);
+  assert(fh);
+
+  *fh = MPI_FILE_NULL;
+
+  if (amode & MPI_MODE_RDONLY) {
+    fp = fopen(filename, "rb");
+  }
+  else {
+    fp = fopen(filename, "r+b");
+    if (fp == NULL && (amode & MPI_MODE_CREATE)) fp = fopen(filename, "w+b");
+  }
+
+  if (fp == NULL) return MPI_ERR_FILE;
+
+  *fh = (MPI_File) calloc(1, sizeof(struct mpi_file_s));
+  assert(*fh);
+  (*fh)->fp = fp;
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_File_close
+ *
+ *****************************************************************************/
+
+int MPI_File_close(MPI_File * fh) {
+
+  assert(fh);
+  assert(*fh);
+
+  fclose((*fh)->fp);
+  free(*fh);
+  *fh = MPI_FILE_NULL;
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_File_set_size
+ *
+ *****************************************************************************/
+
+int MPI_File_set_size(MPI_File fh, MPI_Offset size) {
+
+  assert(fh);
+  assert(size >= 0);
+
+  fflush(fh->fp);
+  if (ftruncate(fileno(fh->fp), size) != 0) return MPI_ERR_FILE;
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_File_set_view
+ *
+ *  The filetype can only be contiguous in serial, so we just need
+ *  the displacement. The file pointer is reset to the start of the
+ *  view.
+ *
+ *****************************************************************************/
+
+int MPI_File_set_view(MPI_File fh, MPI_Offset disp, MPI_Datatype etype,
+		      MPI_Datatype filetype, const char * datarep,
+		      MPI_Info info) {
+  assert(fh);
+  assert(disp >= 0);
+  assert(datarep);
+
+  fh->disp = disp;
+  fseek(fh->fp, disp, SEEK_SET);
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_File_write_all
+ *
+ *  The buffer datatype must be elementary or contiguous.
+ *
+ *****************************************************************************/
+
+int MPI_File_write_all(MPI_File fh, const void * buf, int count,
+		       MPI_Datatype datatype, MPI_Status * status) {
+
+  size_t nitems;
+  size_t sz = mpi_sizeof(datatype);
+
+  assert(fh);
+  assert(buf);
+  assert(count >= 0);
+
+  nitems = fwrite(buf, sz, count, fh->fp);
+
+  if (nitems != (size_t) count || ferror(fh->fp)) return MPI_ERR_FILE;
+
+  return MPI_SUCCESS;
+}
+
+/*****************************************************************************
+ *
+ *  MPI_File_read_all
+ *
+ *  The buffer datatype must be elementary or contiguous.
+ *
+ *****************************************************************************/
+
+int MPI_File_read_all(MPI_File fh, void * buf, int count,
+		      MPI_Datatype datatype, MPI_Status * status) {
+
+  size_t nitems;
+  size_t sz = mpi_sizeof(datatype);
+
+  assert(fh);
+  assert(buf);
+  assert(count >= 0);
+
+  nitems = fread(buf, sz, count, fh->fp);
+
+  if (nitems != (size_t) count || ferror(fh->fp)) return MPI_ERR_FILE;
+
+  return MPI_SUCCESS;
+}
+
 #endif /* _DO_NOT_INCLUDE_MPI2_INTERFACE */
 
+/*****************************************************************************
+ *
+ *  mpi_is_user_dt
+ *
+ *  Is type a committed contiguous datatype?
+ *
+ *****************************************************************************/
+
+static int mpi_is_user_dt(MPI_Datatype type) {
+
+  if (mpi_info == NULL) return 0;
+  if (type < MPI_DT_USER || type >= MPI_DT_USER + MAX_USER_DT) return 0;
+
+  return (mpi_info->dtsize[type - MPI_DT_USER] > 0);
+}
+
 /*****************************************************************************
  *
  *  mpi_is_valid_comm
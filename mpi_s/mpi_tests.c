@@ -15,6 +15,8 @@ static int test_mpi_comm_size(void);
 static int test_mpi_allreduce(void);
 static int test_mpi_reduce(void);
 static int test_mpi_allgather(void);
+static int test_mpi_alltoallv(void);
+static int test_mpi_file(void);
 
 int main (int argc, char ** argv) {
 
@@ -30,6 +32,8 @@ int main (int argc, char ** argv) {
   ireturn = test_mpi_allreduce();
   ireturn = test_mpi_reduce();
   ireturn = test_mpi_allgather();
+  ireturn = test_mpi_alltoallv();
+  ireturn = test_mpi_file();
 
   ireturn = MPI_Finalize();
   assert(ireturn == MPI_SUCCESS);
@@ -183,3 +187,112 @@ int test_mpi_allgather(void) {
 
   return ireturn;
 }
+
+/*****************************************************************************
+ *
+ *  test_mpi_alltoallv
+ *
+ *  Also Allgatherv and Reduce_scatter, which are all copies in serial.
+ *
+ *****************************************************************************/
+
+static int test_mpi_alltoallv(void) {
+
+  int ireturn;
+  int count = 2;
+  int displ = 1;
+  int zero = 0;
+  double send[3] = {1.0, 2.0, 3.0};
+  double recv[3] = {0.0, 0.0, 0.0};
+
+  ireturn = MPI_Alltoallv(send, &count, &displ, MPI_DOUBLE,
+			  recv, &count, &zero, MPI_DOUBLE, comm_);
+  assert(ireturn == MPI_SUCCESS);
+  assert(recv[0] == 2.0);
+  assert(recv[1] == 3.0);
+
+  ireturn = MPI_Allgatherv(send, count, MPI_DOUBLE, recv, &count, &displ,
+			   MPI_DOUBLE, comm_);
+  assert(ireturn == MPI_SUCCESS);
+  assert(recv[1] == 1.0);
+  assert(recv[2] == 2.0);
+
+  ireturn = MPI_Reduce_scatter(send, recv, &count, MPI_DOUBLE, MPI_SUM, comm_);
+  assert(ireturn == MPI_SUCCESS);
+  assert(recv[0] == 1.0);
+  assert(recv[1] == 2.0);
+
+  return ireturn;
+}
+
+/*****************************************************************************
+ *
+ *  test_mpi_file
+ *
+ *  Write and read back a small file via a (trivial) subarray view.
+ *  An existing, longer, file is truncated with MPI_File_set_size().
+ *  The read uses a contiguous record type with a record count.
+ *
+ *****************************************************************************/
+
+static int test_mpi_file(void) {
+
+  int ireturn;
+  int sizes[2] = {2, 3};
+  int starts[2] = {0, 0};
+  double send[6] = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+  double recv[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  const char * filename = "/tmp/mpi-serial-test-file";
+
+  FILE * fp = NULL;
+  MPI_Datatype filetype;
+  MPI_Datatype record;
+  MPI_File fh = MPI_FILE_NULL;
+
+  fp = fopen(filename, "w");
+  assert(fp);
+  fwrite(recv, sizeof(double), 6, fp);
+  fwrite(recv, sizeof(double), 6, fp);
+  fclose(fp);
+
+  ireturn = MPI_Type_create_subarray(2, sizes, sizes, starts, MPI_ORDER_C,
+				     MPI_DOUBLE, &filetype);
+  assert(ireturn == MPI_SUCCESS);
+  MPI_Type_commit(&filetype);
+
+  ireturn = MPI_File_open(comm_, filename, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+			  MPI_INFO_NULL, &fh);
+  assert(ireturn == MPI_SUCCESS);
+  ireturn = MPI_File_set_size(fh, 0);
+  assert(ireturn == MPI_SUCCESS);
+  MPI_File_set_view(fh, 0, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL);
+  ireturn = MPI_File_write_all(fh, send, 6, MPI_DOUBLE, MPI_STATUS_IGNORE);
+  assert(ireturn == MPI_SUCCESS);
+  MPI_File_close(&fh);
+  assert(fh == MPI_FILE_NULL);
+
+  ireturn = MPI_File_open(comm_, filename, MPI_MODE_RDONLY, MPI_INFO_NULL,
+			  &fh);
+  assert(ireturn == MPI_SUCCESS);
+  MPI_File_set_view(fh, 0, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL);
+  MPI_Type_contiguous(3, MPI_DOUBLE, &record);
+  MPI_Type_commit(&record);
+  ireturn = MPI_File_read_all(fh, recv, 2, record, MPI_STATUS_IGNORE);
+  assert(ireturn == MPI_SUCCESS);
+  assert(recv[0] == send[0]);
+  assert(recv[5] == send[5]);
+  MPI_File_close(&fh);
+
+  fp = fopen(filename, "r");
+  assert(fp);
+  fseek(fp, 0, SEEK_END);
+  assert(ftell(fp) == (long int) (6*sizeof(double)));
+  fclose(fp);
+
+  MPI_Type_free(&record);
+  assert(record == MPI_DATATYPE_NULL);
+  MPI_Type_free(&filetype);
+  remove(filename);
+
+  return ireturn;
+}
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2018 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing Authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -32,6 +32,7 @@
 #include "colloid.h"
 #include "colloids.h"
 #include "colloids_s.h"
+#include "perf.h"
 
 struct bbl_s {
   pe_t * pe;            /* Parallel environment */
@@ -40,10 +41,24 @@ struct bbl_s {
   int ndist;            /* Number of LB distributions active */
   double deltag;        /* Excess or deficit of phi between steps */
   double stress[3][3];  /* Surface stress diagnostic */
+  int nlink;            /* Fluid links at last pass2 (for perf) */
+  colloid_link_table_t * ltable;  /* Flat copy of links (from cinfo) */
+  site_sync_t * sites;  /* Link end points (from cinfo) */
+  int npartial;         /* Capacity of partial (colloids) */
+  double * partial;     /* Per colloid diagnostics [BBL_NPARTIAL*npartial] */
 };
 
+#define BBL_NPARTIAL 10   /* Surface stress (9) and fluid links (1) */
+
 static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo);
+static int bbl_pass1_colloid(bbl_t * bbl, lb_t * lb, colloid_t * pc, int nc,
+			     double rho0);
 static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo);
+static int bbl_pass2_colloid(bbl_t * bbl, lb_t * lb, colloid_t * pc, int nc,
+			     double rho0, double sum[BBL_NPARTIAL]);
+static int bbl_partial_reserve(bbl_t * bbl, int ncolloid);
+static int bbl_update_colloid(bbl_t * bbl, wall_t * wall, colloid_t * pc,
+			      double rho0);
 static int bbl_active_conservation(bbl_t * bbl, colloids_info_t * cinfo);
 static int bbl_wall_lubrication_account(bbl_t * bbl, wall_t * wall,
 					colloids_info_t * cinfo);
@@ -93,6 +108,7 @@ int bbl_free(bbl_t * bbl) {
 
   assert(bbl);
 
+  free(bbl->partial);
   free(bbl);
 
   return 0;
@@ -161,12 +177,23 @@ int bounce_back_on_links(bbl_t * bbl, lb_t * lb, wall_t * wall,
   colloids_info_ntotal(cinfo, &ntotal);
   if (ntotal == 0) return 0;
 
+  perf_region_start("bbl");
+
+  /* The link table is that of the last build_update_links() */
+
+  bbl->ltable = cinfo->ltable;
+  bbl->sites = cinfo->lsites;
+  assert(bbl->sites);
+
   colloid_sums_halo(cinfo, COLLOID_SUM_STRUCTURE);
 
-  bbl_pass0(bbl, lb, cinfo);
+  /* If fused or AA, pass0 must be called before collision */
+  if (lb->param->isfused == 0 && lb->param->isaa == 0) {
+    bbl_pass0(bbl, lb, cinfo);
+  }
 
-  /* __NVCC__ TODO: remove */
-  lb_memcpy(lb, tdpMemcpyDeviceToHost);
+  /* Only the distributions at the link end points are required */
+  lb_memcpy_sites(lb, bbl->sites, tdpMemcpyDeviceToHost);
 
   bbl_pass1(bbl, lb, cinfo);
 
@@ -181,8 +208,14 @@ int bounce_back_on_links(bbl_t * bbl, lb_t * lb, wall_t * wall,
 
   bbl_pass2(bbl, lb, cinfo);
 
-  /* __NVCC__ TODO: remove */
-  lb_memcpy(lb, tdpMemcpyHostToDevice);
+  lb_memcpy_sites(lb, bbl->sites, tdpMemcpyHostToDevice);
+
+  /* Nominal work: per fluid link, four distribution accesses (one in
+   * pass1, three in pass2) and around 50 flops. */
+
+  perf_region_work(0.0, 4.0*bbl->nlink*bbl->ndist*sizeof(lb_data_t),
+		   50.0*bbl->nlink);
+  perf_region_stop("bbl");
 
   return 0;
 }
@@ -196,36 +229,43 @@ int bounce_back_on_links(bbl_t * bbl, lb_t * lb, wall_t * wall,
 static int bbl_active_conservation(bbl_t * bbl, colloids_info_t * cinfo) {
 
   int ia;
+  int n, nc;
   double dm;
   double c[3];
+  double rb[3];
   double rbxc[3];
 
-  colloid_t * pc;
-  colloid_link_t * p_link;
+  int nall;
+  colloid_t * pc = NULL;
+  colloid_t ** handles = NULL;
+  colloid_link_table_t * lt = bbl->ltable;
 
   assert(bbl);
   assert(cinfo);
 
-  colloids_info_all_head(cinfo, &pc);
+  colloids_info_all_handles(cinfo, &nall, &handles);
+  assert(nall == lt->ncolloid);
 
   /* For each colloid in the list */
 
-  for ( ; pc; pc = pc->nextall) {
+  tdp_host_omp(parallel for private(ia, n, dm, c, rb, rbxc, pc) schedule(dynamic))
+  for (nc = 0; nc < nall; nc++) {
 
+    pc = handles[nc];
     pc->sump /= pc->sumw;
-    p_link = pc->lnk;
 
-    for (; p_link; p_link = p_link->next) {
+    for (n = lt->offset[nc]; n < lt->offset[nc + 1]; n++) {
 
-      if (p_link->status != LINK_FLUID) continue;
+      if (lt->status[n] != LINK_FLUID) continue;
 
-      dm = -wv[p_link->p]*pc->sump;
+      dm = -wv[lt->p[n]]*pc->sump;
 
       for (ia = 0; ia < 3; ia++) {
-	c[ia] = 1.0*cv[p_link->p][ia];
+	c[ia] = 1.0*cv[lt->p[n]][ia];
+	rb[ia] = lt->rb[ia][n];
       }
 
-      cross_product(p_link->rb, c, rbxc);
+      cross_product(rb, c, rbxc);
 
       for (ia = 0; ia < 3; ia++) {
 	pc->fc0[ia] += dm*c[ia];
@@ -247,6 +287,7 @@ static int bbl_active_conservation(bbl_t * bbl, colloids_info_t * cinfo) {
 
 int bbl_pass0(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
+  int ntotal;
   int nlocal[3];
   int nextra;
   dim3 nblk, ntpb;
@@ -258,6 +299,9 @@ int bbl_pass0(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
   assert(lb);
   assert(cinfo);
 
+  colloids_info_ntotal(cinfo, &ntotal);
+  if (ntotal == 0) return 0;
+
   cs_nlocal(bbl->cs, nlocal);
   cs_target(bbl->cs, &cstarget);
 
@@ -351,8 +395,8 @@ __global__ void bbl_pass0_kernel(kernel_ctxt_t * ktxt, cs_t * cs, lb_t * lb,
 	  }
 	}
 
-	lb->f[ LB_ADDR(lb->nsite, lb->ndist, NVEL, index, LB_RHO, p) ]
-	  = lbp.wv[p]*(1.0 + rcs2*udotc + 0.5*rcs2*rcs2*sdotq);
+	lb_f_set(lb, index, p, LB_RHO,
+		 lbp.wv[p]*(1.0 + rcs2*udotc + 0.5*rcs2*rcs2*sdotq));
       }
     }
   }
@@ -370,22 +414,11 @@ __global__ void bbl_pass0_kernel(kernel_ctxt_t * ktxt, cs_t * cs, lb_t * lb,
 
 static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
-  int ia;
-  int i, j, ij, ji;
-
-  double dm;
-  double delta;
-  double rsumw;
-  double c[3];
-  double rbxc[3];
+  int nc, nall;
   double rho0;
-  double mod, rmod, dm_a, cost, plegendre, sint;
-  double tans[3], vector1[3];
-  double fdist;
 
   physics_t * phys = NULL;
-  colloid_t * pc = NULL;
-  colloid_link_t * p_link = NULL;
+  colloid_t ** handles = NULL;
 
   assert(bbl);
   assert(lb);
@@ -394,150 +427,189 @@ static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
   physics_ref(&phys);
   physics_rho0(phys, &rho0);
 
-  /* All colloids, including halo */
+  /* All colloids, including halo. Each colloid accumulates its own
+   * links only, so may be taken by any thread. */
 
-  colloids_info_all_head(cinfo, &pc);
+  colloids_info_all_handles(cinfo, &nall, &handles);
+  assert(nall == bbl->ltable->ncolloid);
 
-  for ( ; pc; pc = pc->nextall) {
+  tdp_host_omp(parallel for schedule(dynamic))
+  for (nc = 0; nc < nall; nc++) {
+    bbl_pass1_colloid(bbl, lb, handles[nc], nc, rho0);
+  }
 
-    p_link = pc->lnk;
+  return 0;
+}
 
-    for (i = 0; i < 21; i++) {
-      pc->zeta[i] = 0.0;
-    }
+/*****************************************************************************
+ *
+ *  bbl_pass1_colloid
+ *
+ *  Velocity independent terms for one colloid, which is entry nc in
+ *  the link table.
+ *
+ *****************************************************************************/
 
-    /* We need to normalise link quantities by the sum of weights
-     * over the particle. Note that sumw cannot be zero here during
-     * correct operation (implies the particle has no links). */
+static int bbl_pass1_colloid(bbl_t * bbl, lb_t * lb, colloid_t * pc, int nc,
+			     double rho0) {
+  int ia;
+  int i, j, n, ij, ji;
 
-    rsumw = 1.0 / pc->sumw;
-    for (ia = 0; ia < 3; ia++) {
-      pc->cbar[ia]   *= rsumw;
-      pc->rxcbar[ia] *= rsumw;
-    }
-    pc->deltam   *= rsumw;
-    pc->s.deltaphi *= rsumw;
+  double dm;
+  double delta;
+  double rsumw;
+  double c[3];
+  double rb[3];
+  double rbxc[3];
+  double mod, rmod, dm_a, cost, plegendre, sint;
+  double tans[3], vector1[3];
+  double fdist;
 
-    /* Sum over the links */ 
+  colloid_link_table_t * lt = bbl->ltable;
 
-    for (; p_link; p_link = p_link->next) {
+  assert(bbl);
+  assert(lb);
+  assert(pc);
 
-      if (p_link->status == LINK_UNUSED) continue;
+  for (i = 0; i < 21; i++) {
+    pc->zeta[i] = 0.0;
+  }
 
-      i = p_link->i;        /* index site i (outside) */
-      j = p_link->j;        /* index site j (inside) */
-      ij = p_link->p;       /* link velocity index i->j */
-      ji = NVEL - ij;       /* link velocity index j->i */
+  /* We need to normalise link quantities by the sum of weights
+   * over the particle. Note that sumw cannot be zero here during
+   * correct operation (implies the particle has no links). */
 
-      assert(ij > 0 && ij < NVEL);
+  rsumw = 1.0 / pc->sumw;
+  for (ia = 0; ia < 3; ia++) {
+    pc->cbar[ia]   *= rsumw;
+    pc->rxcbar[ia] *= rsumw;
+  }
+  pc->deltam   *= rsumw;
+  pc->s.deltaphi *= rsumw;
 
-      /* For stationary link, the momentum transfer from the
-       * fluid to the colloid is "dm" */
+  /* Sum over the links */ 
 
-      if (p_link->status == LINK_FLUID) {
-	/* Bounce back of fluid on outside plus correction
-	 * arising from changes in shape at previous step.
-	 * Note minus sign. */
+  for (n = lt->offset[nc]; n < lt->offset[nc + 1]; n++) {
 
-	lb_f(lb, i, ij, 0, &fdist);
-	dm =  2.0*fdist - wv[ij]*pc->deltam;
-	delta = 2.0*rcs2*wv[ij]*rho0;
+    if (lt->status[n] == LINK_UNUSED) continue;
 
-	/* Squirmer section */
-	if (pc->s.type == COLLOID_TYPE_ACTIVE) {
+    i = lt->i[n];         /* index site i (outside) */
+    j = lt->j[n];         /* index site j (inside) */
+    ij = lt->p[n];        /* link velocity index i->j */
+    ji = NVEL - ij;       /* link velocity index j->i */
 
-	  /* We expect s.m to be a unit vector, but for floating
-	   * point purposes, we must make sure here. */
+    assert(ij > 0 && ij < NVEL);
 
-	  mod = modulus(p_link->rb)*modulus(pc->s.m);
-	  rmod = 0.0;
-	  if (mod != 0.0) rmod = 1.0/mod;
-	  cost = rmod*dot_product(p_link->rb, pc->s.m);
-	  if (cost*cost > 1.0) cost = 1.0;
-	  assert(cost*cost <= 1.0);
-	  sint = sqrt(1.0 - cost*cost);
+    rb[X] = lt->rb[X][n];
+    rb[Y] = lt->rb[Y][n];
+    rb[Z] = lt->rb[Z][n];
 
-	  cross_product(p_link->rb, pc->s.m, vector1);
-	  cross_product(vector1, p_link->rb, tans);
+    /* For stationary link, the momentum transfer from the
+     * fluid to the colloid is "dm" */
 
-	  mod = modulus(tans);
-	  rmod = 0.0;
-	  if (mod != 0.0) rmod = 1.0/mod;
-	  plegendre = -sint*(pc->s.b2*cost + pc->s.b1);
+    if (lt->status[n] == LINK_FLUID) {
+      /* Bounce back of fluid on outside plus correction
+       * arising from changes in shape at previous step.
+       * Note minus sign. */
 
-	  dm_a = 0.0;
-	  for (ia = 0; ia < 3; ia++) {
-	    dm_a += -delta*plegendre*rmod*tans[ia]*cv[ij][ia];
-	  }
+      lb_f_link(lb, i, j, ij, 0, &fdist);
+      dm =  2.0*fdist - wv[ij]*pc->deltam;
+      delta = 2.0*rcs2*wv[ij]*rho0;
+
+      /* Squirmer section */
+      if (pc->s.type == COLLOID_TYPE_ACTIVE) {
+
+	/* We expect s.m to be a unit vector, but for floating
+	 * point purposes, we must make sure here. */
 
-	  lb_f(lb, i, ij, 0, &fdist);
-	  fdist += dm_a;
-	  lb_f_set(lb, i, ij, 0, fdist);
+	mod = modulus(rb)*modulus(pc->s.m);
+	rmod = 0.0;
+	if (mod != 0.0) rmod = 1.0/mod;
+	cost = rmod*dot_product(rb, pc->s.m);
+	if (cost*cost > 1.0) cost = 1.0;
+	assert(cost*cost <= 1.0);
+	sint = sqrt(1.0 - cost*cost);
 
-	  dm += dm_a;
+	cross_product(rb, pc->s.m, vector1);
+	cross_product(vector1, rb, tans);
 
-	  /* needed for mass conservation   */
-	  pc->sump += dm_a;
+	mod = modulus(tans);
+	rmod = 0.0;
+	if (mod != 0.0) rmod = 1.0/mod;
+	plegendre = -sint*(pc->s.b2*cost + pc->s.b1);
+
+	dm_a = 0.0;
+	for (ia = 0; ia < 3; ia++) {
+	  dm_a += -delta*plegendre*rmod*tans[ia]*cv[ij][ia];
 	}
-      }
-      else {
-	/* Virtual momentum transfer for solid->solid links,
-	 * but no contribution to drag maxtrix */
-
-	lb_f(lb, i, ij, 0, &fdist);
-	dm = fdist;
-	lb_f(lb, j, ji, 0, &fdist);
-	dm += fdist;
-	delta = 0.0;
-      }
 
-      for (ia = 0; ia < 3; ia++) {
-	c[ia] = 1.0*cv[ij][ia];
+	lb_f_link(lb, i, j, ij, 0, &fdist);
+	fdist += dm_a;
+	lb_f_link_set(lb, i, j, ij, 0, fdist);
+
+	dm += dm_a;
+
+	/* needed for mass conservation   */
+	pc->sump += dm_a;
       }
+    }
+    else {
+      /* Virtual momentum transfer for solid->solid links,
+       * but no contribution to drag maxtrix */
+
+      lb_f_link(lb, i, j, ij, 0, &fdist);
+      dm = fdist;
+      lb_f_link(lb, j, i, ji, 0, &fdist);
+      dm += fdist;
+      delta = 0.0;
+    }
+
+    for (ia = 0; ia < 3; ia++) {
+      c[ia] = 1.0*cv[ij][ia];
+    }
 
-      cross_product(p_link->rb, c, rbxc);
+    cross_product(rb, c, rbxc);
 
-      /* Now add contribution to the sums required for 
-       * self-consistent evaluation of new velocities. */
+    /* Now add contribution to the sums required for 
+     * self-consistent evaluation of new velocities. */
 
-      for (ia = 0; ia < 3; ia++) {
-	pc->f0[ia] += dm*c[ia];
-	pc->t0[ia] += dm*rbxc[ia];
-	/* Corrections when links are missing (close to contact) */
-	c[ia] -= pc->cbar[ia];
-	rbxc[ia] -= pc->rxcbar[ia];
-      }
+    for (ia = 0; ia < 3; ia++) {
+      pc->f0[ia] += dm*c[ia];
+      pc->t0[ia] += dm*rbxc[ia];
+      /* Corrections when links are missing (close to contact) */
+      c[ia] -= pc->cbar[ia];
+      rbxc[ia] -= pc->rxcbar[ia];
+    }
 
-      /* Drag matrix elements */
+    /* Drag matrix elements */
 
-      pc->zeta[ 0] += delta*c[X]*c[X];
-      pc->zeta[ 1] += delta*c[X]*c[Y];
-      pc->zeta[ 2] += delta*c[X]*c[Z];
-      pc->zeta[ 3] += delta*c[X]*rbxc[X];
-      pc->zeta[ 4] += delta*c[X]*rbxc[Y];
-      pc->zeta[ 5] += delta*c[X]*rbxc[Z];
+    pc->zeta[ 0] += delta*c[X]*c[X];
+    pc->zeta[ 1] += delta*c[X]*c[Y];
+    pc->zeta[ 2] += delta*c[X]*c[Z];
+    pc->zeta[ 3] += delta*c[X]*rbxc[X];
+    pc->zeta[ 4] += delta*c[X]*rbxc[Y];
+    pc->zeta[ 5] += delta*c[X]*rbxc[Z];
 
-      pc->zeta[ 6] += delta*c[Y]*c[Y];
-      pc->zeta[ 7] += delta*c[Y]*c[Z];
-      pc->zeta[ 8] += delta*c[Y]*rbxc[X];
-      pc->zeta[ 9] += delta*c[Y]*rbxc[Y];
-      pc->zeta[10] += delta*c[Y]*rbxc[Z];
+    pc->zeta[ 6] += delta*c[Y]*c[Y];
+    pc->zeta[ 7] += delta*c[Y]*c[Z];
+    pc->zeta[ 8] += delta*c[Y]*rbxc[X];
+    pc->zeta[ 9] += delta*c[Y]*rbxc[Y];
+    pc->zeta[10] += delta*c[Y]*rbxc[Z];
 
-      pc->zeta[11] += delta*c[Z]*c[Z];
-      pc->zeta[12] += delta*c[Z]*rbxc[X];
-      pc->zeta[13] += delta*c[Z]*rbxc[Y];
-      pc->zeta[14] += delta*c[Z]*rbxc[Z];
+    pc->zeta[11] += delta*c[Z]*c[Z];
+    pc->zeta[12] += delta*c[Z]*rbxc[X];
+    pc->zeta[13] += delta*c[Z]*rbxc[Y];
+    pc->zeta[14] += delta*c[Z]*rbxc[Z];
 
-      pc->zeta[15] += delta*rbxc[X]*rbxc[X];
-      pc->zeta[16] += delta*rbxc[X]*rbxc[Y];
-      pc->zeta[17] += delta*rbxc[X]*rbxc[Z];
+    pc->zeta[15] += delta*rbxc[X]*rbxc[X];
+    pc->zeta[16] += delta*rbxc[X]*rbxc[Y];
+    pc->zeta[17] += delta*rbxc[X]*rbxc[Z];
 
-      pc->zeta[18] += delta*rbxc[Y]*rbxc[Y];
-      pc->zeta[19] += delta*rbxc[Y]*rbxc[Z];
+    pc->zeta[18] += delta*rbxc[Y]*rbxc[Y];
+    pc->zeta[19] += delta*rbxc[Y]*rbxc[Z];
 
-      pc->zeta[20] += delta*rbxc[Z]*rbxc[Z];
+    pc->zeta[20] += delta*rbxc[Z]*rbxc[Z];
 
-    }
   }
 
   return 0;
@@ -558,24 +630,12 @@ static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
 static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
-  int i, j, ij, ji;
-  int ia;
-  int ndist;
-
-  double dm;
-  double vdotc;
-  double dms;
-  double df, dg;
-  double fdist;
-  double wxrb[3];
-
-  double dgtm1;
+  int i, j;
+  int nc, nall;
   double rho0;
 
   physics_t * phys = NULL;
-  colloid_t * pc = NULL;
-  colloid_link_t * p_link;
-
+  colloid_t ** handles = NULL;
 
   assert(bbl);
   assert(lb);
@@ -584,12 +644,34 @@ static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
   physics_ref(&phys);
   physics_rho0(phys, &rho0);
 
-  ndist=lb->ndist;
+  colloids_info_all_handles(cinfo, &nall, &handles);
+  assert(nall == bbl->ltable->ncolloid);
+  bbl_partial_reserve(bbl, nall);
 
-  /* Account the current phi deficit */
-  bbl->deltag = 0.0;
+  /* Each colloid writes only the distributions of its own links, and
+   * accumulates its contributions to the diagnostics separately.
+   * However, for a binary LB with the pull (fused or AA) layout, the
+   * order parameter at an outside site is read from locations which
+   * other links write, so the order of colloids is retained. */
+
+  if (lb->ndist > 1 && (lb->param->isfused || lb->param->isaa)) {
+    for (nc = 0; nc < nall; nc++) {
+      bbl_pass2_colloid(bbl, lb, handles[nc], nc, rho0,
+			bbl->partial + BBL_NPARTIAL*nc);
+    }
+  }
+  else {
+    tdp_host_omp(parallel for schedule(dynamic))
+    for (nc = 0; nc < nall; nc++) {
+      bbl_pass2_colloid(bbl, lb, handles[nc], nc, rho0,
+			bbl->partial + BBL_NPARTIAL*nc);
+    }
+  }
+
+  /* Sum the diagnostics in a fixed order */
 
-  /* Zero the surface stress */
+  bbl->deltag = 0.0;
+  bbl->nlink = 0;
 
   for (i = 0; i < 3; i++) {
     for (j = 0; j < 3; j++) {
@@ -597,123 +679,189 @@ static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
     }
   }
 
-  /* All colloids, including halo */
+  for (nc = 0; nc < nall; nc++) {
+    double * sum = bbl->partial + BBL_NPARTIAL*nc;
+    for (i = 0; i < 3; i++) {
+      for (j = 0; j < 3; j++) {
+	bbl->stress[i][j] += sum[3*i + j];
+      }
+    }
+    bbl->nlink += (int) sum[9];
+    bbl->deltag += handles[nc]->s.deltaphi;
+  }
 
-  colloids_info_all_head(cinfo, &pc);
+  return 0;
+}
 
-  for ( ; pc; pc = pc->nextall) {
+/*****************************************************************************
+ *
+ *  bbl_pass2_colloid
+ *
+ *  Bounce-back for the links of one colloid (entry nc in the link
+ *  table). The contributions to the surface stress sum[0..8] and the
+ *  number of fluid links sum[9] are returned.
+ *
+ *****************************************************************************/
 
-    /* Set correction for phi arising from previous step */
+static int bbl_pass2_colloid(bbl_t * bbl, lb_t * lb, colloid_t * pc, int nc,
+			     double rho0, double sum[BBL_NPARTIAL]) {
+  int i, j, ij, ji;
+  int ia;
+  int n;
 
-    dgtm1 = pc->s.deltaphi;
-    pc->s.deltaphi = 0.0;
+  double dm;
+  double vdotc;
+  double dms;
+  double df, dg;
+  double fdist;
+  double rb[3];
+  double wxrb[3];
+  double dgtm1;
 
-    /* Correction to the bounce-back for this particle if it is
-     * without full complement of links */
+  colloid_link_table_t * lt = bbl->ltable;
 
-    dms = 0.0;
+  assert(bbl);
+  assert(lb);
+  assert(pc);
 
-    for (ia = 0; ia < 3; ia++) {
-      dms += pc->s.v[ia]*pc->cbar[ia];
-      dms += pc->s.w[ia]*pc->rxcbar[ia];
-    }
+  for (n = 0; n < BBL_NPARTIAL; n++) {
+    sum[n] = 0.0;
+  }
 
-    dms = 2.0*rcs2*rho0*dms;
+  /* Set correction for phi arising from previous step */
 
-    /* Run through the links */
+  dgtm1 = pc->s.deltaphi;
+  pc->s.deltaphi = 0.0;
 
-    p_link = pc->lnk;
+  /* Correction to the bounce-back for this particle if it is
+   * without full complement of links */
 
-    for ( ; p_link; p_link = p_link->next) {
+  dms = 0.0;
 
-      i = p_link->i;       /* index site i (outside) */
-      j = p_link->j;       /* index site j (inside) */
-      ij = p_link->p;      /* link velocity index i->j */
-      ji = NVEL - ij;      /* link velocity index j->i */
+  for (ia = 0; ia < 3; ia++) {
+    dms += pc->s.v[ia]*pc->cbar[ia];
+    dms += pc->s.w[ia]*pc->rxcbar[ia];
+  }
 
-      if (p_link->status == LINK_FLUID) {
+  dms = 2.0*rcs2*rho0*dms;
 
-	lb_f(lb, i, ij, 0, &fdist);
-	dm =  2.0*fdist - wv[ij]*pc->deltam;
+  /* Run through the links */
 
-	/* Compute the self-consistent boundary velocity,
-	 * and add the correction term for changes in shape. */
+  for (n = lt->offset[nc]; n < lt->offset[nc + 1]; n++) {
 
-	cross_product(pc->s.w, p_link->rb, wxrb);
+    i = lt->i[n];        /* index site i (outside) */
+    j = lt->j[n];        /* index site j (inside) */
+    ij = lt->p[n];       /* link velocity index i->j */
+    ji = NVEL - ij;      /* link velocity index j->i */
 
-	vdotc = 0.0;
-	for (ia = 0; ia < 3; ia++) {
-	  vdotc += (pc->s.v[ia] + wxrb[ia])*cv[ij][ia];
-	}
-	vdotc = 2.0*rcs2*wv[ij]*vdotc;
-	df = rho0*vdotc + wv[ij]*pc->deltam;
+    rb[X] = lt->rb[X][n];
+    rb[Y] = lt->rb[Y][n];
+    rb[Z] = lt->rb[Z][n];
 
-	/* Contribution to mass conservation from squirmer */
+    if (lt->status[n] == LINK_FLUID) {
 
-	df += wv[ij]*pc->sump; 
+      sum[9] += 1.0;
+      lb_f_link(lb, i, j, ij, 0, &fdist);
+      dm =  2.0*fdist - wv[ij]*pc->deltam;
 
-	/* Correction owing to missing links "squeeze term" */
+      /* Compute the self-consistent boundary velocity,
+       * and add the correction term for changes in shape. */
 
-	df -= wv[ij]*dms;
+      cross_product(pc->s.w, rb, wxrb);
 
-	/* The outside site actually undergoes BBL. */
+      vdotc = 0.0;
+      for (ia = 0; ia < 3; ia++) {
+	vdotc += (pc->s.v[ia] + wxrb[ia])*cv[ij][ia];
+      }
+      vdotc = 2.0*rcs2*wv[ij]*vdotc;
+      df = rho0*vdotc + wv[ij]*pc->deltam;
 
-	lb_f(lb, i, ij, LB_RHO, &fdist);
-	fdist = fdist - df;
-	lb_f_set(lb, j, ji, LB_RHO, fdist);
+      /* Contribution to mass conservation from squirmer */
 
-	/* This is slightly clunky. If the order parameter is
-	 * via LB, bounce back with correction. */
+      df += wv[ij]*pc->sump; 
 
-	if (ndist > 1) {
-	  lb_0th_moment(lb, i, LB_PHI, &dg);
-	  dg *= vdotc;
-	  pc->s.deltaphi += dg;
-	  dg -= wv[ij]*dgtm1;
+      /* Correction owing to missing links "squeeze term" */
 
-	  lb_f(lb, i, ij, LB_PHI, &fdist);
-	  fdist = fdist - dg;
-	  lb_f_set(lb, j, ji, LB_PHI, fdist);
-	}
+      df -= wv[ij]*dms;
 
-	/* The stress is r_b f_b */
-	for (ia = 0; ia < 3; ia++) {
-	  bbl->stress[ia][X] += p_link->rb[X]*(dm - df)*cv[ij][ia];
-	  bbl->stress[ia][Y] += p_link->rb[Y]*(dm - df)*cv[ij][ia];
-	  bbl->stress[ia][Z] += p_link->rb[Z]*(dm - df)*cv[ij][ia];
-	}
-      }
-      else if (p_link->status == LINK_COLLOID) {
+      /* The outside site actually undergoes BBL. */
 
-	/* The stress should include the solid->solid term */
+      lb_f_link(lb, i, j, ij, LB_RHO, &fdist);
+      fdist = fdist - df;
+      lb_f_link_set(lb, j, i, ji, LB_RHO, fdist);
 
-	lb_f(lb, i, ij, 0, &fdist);
-	dm = fdist;
-	lb_f(lb, j, ji, 0, &fdist);
-	dm += fdist;
+      /* This is slightly clunky. If the order parameter is
+       * via LB, bounce back with correction. */
 
-	for (ia = 0; ia < 3; ia++) {
-	  bbl->stress[ia][X] += p_link->rb[X]*dm*cv[ij][ia];
-	  bbl->stress[ia][Y] += p_link->rb[Y]*dm*cv[ij][ia];
-	  bbl->stress[ia][Z] += p_link->rb[Z]*dm*cv[ij][ia];
-	}
+      if (lb->ndist > 1) {
+	lb_0th_moment(lb, i, LB_PHI, &dg);
+	dg *= vdotc;
+	pc->s.deltaphi += dg;
+	dg -= wv[ij]*dgtm1;
+
+	lb_f_link(lb, i, j, ij, LB_PHI, &fdist);
+	fdist = fdist - dg;
+	lb_f_link_set(lb, j, i, ji, LB_PHI, fdist);
+      }
+
+      /* The stress is r_b f_b */
+      for (ia = 0; ia < 3; ia++) {
+	sum[3*ia + X] += rb[X]*(dm - df)*cv[ij][ia];
+	sum[3*ia + Y] += rb[Y]*(dm - df)*cv[ij][ia];
+	sum[3*ia + Z] += rb[Z]*(dm - df)*cv[ij][ia];
       }
-      /* Next link */
     }
+    else if (lt->status[n] == LINK_COLLOID) {
 
-    /* Reset factors required for change of shape, etc */
+      /* The stress should include the solid->solid term */
 
-    pc->deltam = 0.0;
-    pc->sump = 0.0;
+      lb_f_link(lb, i, j, ij, 0, &fdist);
+      dm = fdist;
+      lb_f_link(lb, j, i, ji, 0, &fdist);
+      dm += fdist;
 
-    for (ia = 0; ia < 3; ia++) {
-      pc->f0[ia] = 0.0;
-      pc->t0[ia] = 0.0;
-      pc->fc0[ia] = 0.0;
-      pc->tc0[ia] = 0.0;
+      for (ia = 0; ia < 3; ia++) {
+	sum[3*ia + X] += rb[X]*dm*cv[ij][ia];
+	sum[3*ia + Y] += rb[Y]*dm*cv[ij][ia];
+	sum[3*ia + Z] += rb[Z]*dm*cv[ij][ia];
+      }
     }
+    /* Next link */
+  }
+
+  /* Reset factors required for change of shape, etc */
+
+  pc->deltam = 0.0;
+  pc->sump = 0.0;
 
-    bbl->deltag += pc->s.deltaphi;
+  for (ia = 0; ia < 3; ia++) {
+    pc->f0[ia] = 0.0;
+    pc->t0[ia] = 0.0;
+    pc->fc0[ia] = 0.0;
+    pc->tc0[ia] = 0.0;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bbl_partial_reserve
+ *
+ *  Work space for per-colloid diagnostics.
+ *
+ *****************************************************************************/
+
+static int bbl_partial_reserve(bbl_t * bbl, int ncolloid) {
+
+  assert(bbl);
+
+  if (ncolloid > bbl->npartial) {
+    free(bbl->partial);
+    bbl->npartial = 2*ncolloid;
+    bbl->partial = (double *) malloc(BBL_NPARTIAL*bbl->npartial*sizeof(double));
+    assert(bbl->partial);
+    if (bbl->partial == NULL) pe_fatal(bbl->pe, "malloc(bbl->partial) failed\n");
   }
 
   return 0;
@@ -733,6 +881,42 @@ static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
 int bbl_update_colloids(bbl_t * bbl, wall_t * wall, colloids_info_t * cinfo) {
 
+  int n, nall;
+  double rho0;
+  colloid_t ** handles = NULL;
+
+  assert(bbl);
+  assert(cinfo);
+
+  colloids_info_rho0(cinfo, &rho0);
+
+  /* All colloids, including halo. Each is independent. */
+
+  colloids_info_all_handles(cinfo, &nall, &handles);
+
+  tdp_host_omp(parallel for schedule(dynamic))
+  for (n = 0; n < nall; n++) {
+    bbl_update_colloid(bbl, wall, handles[n], rho0);
+  }
+
+  /* As the lubrication force is based on the updated velocity, but
+   * the old position, we can account for the total momentum here. */
+
+  bbl_wall_lubrication_account(bbl, wall, cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bbl_update_colloid
+ *
+ *  Solve the 6x6 problem for the new velocity of one colloid.
+ *
+ *****************************************************************************/
+
+static int bbl_update_colloid(bbl_t * bbl, wall_t * wall, colloid_t * pc,
+			      double rho0) {
   int ia;
   int ipivot[6];
   int iprow = 0;
@@ -741,195 +925,179 @@ int bbl_update_colloids(bbl_t * bbl, wall_t * wall, colloids_info_t * cinfo) {
   double mass;    /* Assumes (4/3) rho pi r^3 */
   double moment;  /* also assumes (2/5) mass r^2 for sphere */
   double tmp;
-  double rho0;
   double dwall[3];
   double xb[6];
   double a[6][6];
 
-  colloid_t * pc;
   PI_DOUBLE(pi);
 
   assert(bbl);
-  assert(cinfo);
-
-  colloids_info_rho0(cinfo, &rho0);
-
-  /* All colloids, including halo */
+  assert(pc);
+
+  /* Set up the matrix problem and solve it here. */
+
+  /* Mass and moment of inertia are those of a hard sphere
+   * with the input radius */
+
+  mass = (4.0/3.0)*pi*rho0*pow(pc->s.a0, 3);
+  moment = (2.0/5.0)*mass*pow(pc->s.a0, 2);
+
+  /* Wall lubrication correction */
+  wall_lubr_sphere(wall, pc->s.ah, pc->s.r, dwall);
+
+  /* Add inertial terms to diagonal elements */
+
+  a[0][0] = mass +   pc->zeta[0] - dwall[X];
+  a[0][1] =          pc->zeta[1];
+  a[0][2] =          pc->zeta[2];
+  a[0][3] =          pc->zeta[3];
+  a[0][4] =          pc->zeta[4];
+  a[0][5] =          pc->zeta[5];
+  a[1][1] = mass +   pc->zeta[6] - dwall[Y];
+  a[1][2] =          pc->zeta[7];
+  a[1][3] =          pc->zeta[8];
+  a[1][4] =          pc->zeta[9];
+  a[1][5] =          pc->zeta[10];
+  a[2][2] = mass +   pc->zeta[11] - dwall[Z];
+  a[2][3] =          pc->zeta[12];
+  a[2][4] =          pc->zeta[13];
+  a[2][5] =          pc->zeta[14];
+  a[3][3] = moment + pc->zeta[15];
+  a[3][4] =          pc->zeta[16];
+  a[3][5] =          pc->zeta[17];
+  a[4][4] = moment + pc->zeta[18];
+  a[4][5] =          pc->zeta[19];
+  a[5][5] = moment + pc->zeta[20];
+
+  /* Lower triangle */
+
+  a[1][0] = a[0][1];
+  a[2][0] = a[0][2];
+  a[2][1] = a[1][2];
+  a[3][0] = a[0][3];
+  a[3][1] = a[1][3];
+  a[3][2] = a[2][3];
+  a[4][0] = a[0][4];
+  a[4][1] = a[1][4];
+  a[4][2] = a[2][4];
+  a[4][3] = a[3][4];
+  a[5][0] = a[0][5];
+  a[5][1] = a[1][5];
+  a[5][2] = a[2][5];
+  a[5][3] = a[3][5];
+  a[5][4] = a[4][5];
+
+  /* Form the right-hand side */
 
-  colloids_info_all_head(cinfo, &pc);
-
-  for ( ; pc; pc = pc->nextall) {
+  for (ia = 0; ia < 3; ia++) {
+    xb[ia] = mass*pc->s.v[ia] + pc->f0[ia] + pc->force[ia];
+    xb[3+ia] = moment*pc->s.w[ia] + pc->t0[ia] + pc->torque[ia];
+  }
 
-    /* Set up the matrix problem and solve it here. */
+  /* Contribution to mass conservation from squirmer */
 
-    /* Mass and moment of inertia are those of a hard sphere
-     * with the input radius */
+  for (ia = 0; ia < 3; ia++) {
+    xb[ia] += pc->fc0[ia];
+    xb[3+ia] += pc->tc0[ia];
+  }
 
-    mass = (4.0/3.0)*pi*rho0*pow(pc->s.a0, 3);
-    moment = (2.0/5.0)*mass*pow(pc->s.a0, 2);
+  /* Begin the Gaussian elimination */
 
-    /* Wall lubrication correction */
-    wall_lubr_sphere(wall, pc->s.ah, pc->s.r, dwall);
+  for (k = 0; k < 6; k++) {
+    ipivot[k] = -1;
+  }
 
-    /* Add inertial terms to diagonal elements */
-
-    a[0][0] = mass +   pc->zeta[0] - dwall[X];
-    a[0][1] =          pc->zeta[1];
-    a[0][2] =          pc->zeta[2];
-    a[0][3] =          pc->zeta[3];
-    a[0][4] =          pc->zeta[4];
-    a[0][5] =          pc->zeta[5];
-    a[1][1] = mass +   pc->zeta[6] - dwall[Y];
-    a[1][2] =          pc->zeta[7];
-    a[1][3] =          pc->zeta[8];
-    a[1][4] =          pc->zeta[9];
-    a[1][5] =          pc->zeta[10];
-    a[2][2] = mass +   pc->zeta[11] - dwall[Z];
-    a[2][3] =          pc->zeta[12];
-    a[2][4] =          pc->zeta[13];
-    a[2][5] =          pc->zeta[14];
-    a[3][3] = moment + pc->zeta[15];
-    a[3][4] =          pc->zeta[16];
-    a[3][5] =          pc->zeta[17];
-    a[4][4] = moment + pc->zeta[18];
-    a[4][5] =          pc->zeta[19];
-    a[5][5] = moment + pc->zeta[20];
-
-    /* Lower triangle */
-
-    a[1][0] = a[0][1];
-    a[2][0] = a[0][2];
-    a[2][1] = a[1][2];
-    a[3][0] = a[0][3];
-    a[3][1] = a[1][3];
-    a[3][2] = a[2][3];
-    a[4][0] = a[0][4];
-    a[4][1] = a[1][4];
-    a[4][2] = a[2][4];
-    a[4][3] = a[3][4];
-    a[5][0] = a[0][5];
-    a[5][1] = a[1][5];
-    a[5][2] = a[2][5];
-    a[5][3] = a[3][5];
-    a[5][4] = a[4][5];
-
-    /* Form the right-hand side */
+  for (k = 0; k < 6; k++) {
 
-    for (ia = 0; ia < 3; ia++) {
-      xb[ia] = mass*pc->s.v[ia] + pc->f0[ia] + pc->force[ia];
-      xb[3+ia] = moment*pc->s.w[ia] + pc->t0[ia] + pc->torque[ia];
+    /* Find pivot row */
+    tmp = 0.0;
+    for (idash = 0; idash < 6; idash++) {
+      if (ipivot[idash] == -1) {
+	if (fabs(a[idash][k]) >= tmp) {
+	  tmp = fabs(a[idash][k]);
+	  iprow = idash;
+	}
+      }
     }
+    ipivot[k] = iprow;
 
-    /* Contribution to mass conservation from squirmer */
+    /* divide pivot row by the pivot element a[iprow][k] */
 
-    for (ia = 0; ia < 3; ia++) {
-      xb[ia] += pc->fc0[ia];
-      xb[3+ia] += pc->tc0[ia];
+    if (a[iprow][k] == 0.0) {
+      pe_fatal(bbl->pe, "Gaussian elimination failed in bbl_update\n");
     }
 
-    /* Begin the Gaussian elimination */
+    tmp = 1.0 / a[iprow][k];
 
-    for (k = 0; k < 6; k++) {
-      ipivot[k] = -1;
+    for (j = k; j < 6; j++) {
+      a[iprow][j] *= tmp;
     }
+    xb[iprow] *= tmp;
 
-    for (k = 0; k < 6; k++) {
-
-      /* Find pivot row */
-      tmp = 0.0;
-      for (idash = 0; idash < 6; idash++) {
-	if (ipivot[idash] == -1) {
-	  if (fabs(a[idash][k]) >= tmp) {
-	    tmp = fabs(a[idash][k]);
-	    iprow = idash;
-	  }
-	}
-      }
-      ipivot[k] = iprow;
-
-      /* divide pivot row by the pivot element a[iprow][k] */
+    /* Subtract the pivot row (scaled) from remaining rows */
 
-      if (a[iprow][k] == 0.0) {
-	pe_fatal(bbl->pe, "Gaussian elimination failed in bbl_update\n");
-      }
-
-      tmp = 1.0 / a[iprow][k];
-
-      for (j = k; j < 6; j++) {
-	a[iprow][j] *= tmp;
-      }
-      xb[iprow] *= tmp;
-
-      /* Subtract the pivot row (scaled) from remaining rows */
-
-      for (idash = 0; idash < 6; idash++) {
-	if (ipivot[idash] == -1) {
-	  tmp = a[idash][k];
-	  for (j = k; j < 6; j++) {
-	    a[idash][j] -= tmp*a[iprow][j];
-	  }
-	  xb[idash] -= tmp*xb[iprow];
+    for (idash = 0; idash < 6; idash++) {
+      if (ipivot[idash] == -1) {
+	tmp = a[idash][k];
+	for (j = k; j < 6; j++) {
+	  a[idash][j] -= tmp*a[iprow][j];
 	}
+	xb[idash] -= tmp*xb[iprow];
       }
     }
+  }
 
-    /* Now do the back substitution */
+  /* Now do the back substitution */
 
-    for (idash = 5; idash > -1; idash--) {
-      iprow = ipivot[idash];
-      tmp = xb[iprow];
-      for (k = idash+1; k < 6; k++) {
-	tmp -= a[iprow][k]*xb[ipivot[k]];
-      }
-      xb[iprow] = tmp;
+  for (idash = 5; idash > -1; idash--) {
+    iprow = ipivot[idash];
+    tmp = xb[iprow];
+    for (k = idash+1; k < 6; k++) {
+      tmp -= a[iprow][k]*xb[ipivot[k]];
     }
+    xb[iprow] = tmp;
+  }
 
-    /* Set the position update, but don't actually move
-     * the particles. This is deferred until the next
-     * call to coll_update() and associated cell list
-     * update.
-     * We use mean of old and new velocity. */
+  /* Set the position update, but don't actually move
+   * the particles. This is deferred until the next
+   * call to coll_update() and associated cell list
+   * update.
+   * We use mean of old and new velocity. */
 
-    for (ia = 0; ia < 3; ia++) {
-      if (pc->s.isfixedr == 0) pc->s.dr[ia] = 0.5*(pc->s.v[ia] + xb[ia]);
-      if (pc->s.isfixedv == 0) pc->s.v[ia] = xb[ia];
-      if (pc->s.isfixedw == 0) pc->s.w[ia] = xb[3+ia];
-    }
-
-    if (pc->s.isfixeds == 0) {
-      rotate_vector(pc->s.m, xb + 3);
-      rotate_vector(pc->s.s, xb + 3);
-    }
-
-    /* Record the actual hydrodynamic force on the particle */
-
-    pc->force[X] = pc->f0[X]
-      -(pc->zeta[0]*pc->s.v[X] +
-	pc->zeta[1]*pc->s.v[Y] +
-	pc->zeta[2]*pc->s.v[Z] +
-	pc->zeta[3]*pc->s.w[X] +
-	pc->zeta[4]*pc->s.w[Y] +
-	pc->zeta[5]*pc->s.w[Z]);
-    pc->force[Y] = pc->f0[Y]
-      -(pc->zeta[ 1]*pc->s.v[X] +
-	pc->zeta[ 6]*pc->s.v[Y] +
-	pc->zeta[ 7]*pc->s.v[Z] +
-	pc->zeta[ 8]*pc->s.w[X] +
-	pc->zeta[ 9]*pc->s.w[Y] +
-	pc->zeta[10]*pc->s.w[Z]);
-    pc->force[Z] = pc->f0[Z]
-      -(pc->zeta[ 2]*pc->s.v[X] +
-	pc->zeta[ 7]*pc->s.v[Y] +
-	pc->zeta[11]*pc->s.v[Z] +
-	pc->zeta[12]*pc->s.w[X] +
-	pc->zeta[13]*pc->s.w[Y] +
-	pc->zeta[14]*pc->s.w[Z]);
+  for (ia = 0; ia < 3; ia++) {
+    if (pc->s.isfixedr == 0) pc->s.dr[ia] = 0.5*(pc->s.v[ia] + xb[ia]);
+    if (pc->s.isfixedv == 0) pc->s.v[ia] = xb[ia];
+    if (pc->s.isfixedw == 0) pc->s.w[ia] = xb[3+ia];
   }
 
-  /* As the lubrication force is based on the updated velocity, but
-   * the old position, we can account for the total momentum here. */
+  if (pc->s.isfixeds == 0) {
+    rotate_vector(pc->s.m, xb + 3);
+    rotate_vector(pc->s.s, xb + 3);
+  }
 
-  bbl_wall_lubrication_account(bbl, wall, cinfo);
+  /* Record the actual hydrodynamic force on the particle */
+
+  pc->force[X] = pc->f0[X]
+    -(pc->zeta[0]*pc->s.v[X] +
+      pc->zeta[1]*pc->s.v[Y] +
+      pc->zeta[2]*pc->s.v[Z] +
+      pc->zeta[3]*pc->s.w[X] +
+      pc->zeta[4]*pc->s.w[Y] +
+      pc->zeta[5]*pc->s.w[Z]);
+  pc->force[Y] = pc->f0[Y]
+    -(pc->zeta[ 1]*pc->s.v[X] +
+      pc->zeta[ 6]*pc->s.v[Y] +
+      pc->zeta[ 7]*pc->s.v[Z] +
+      pc->zeta[ 8]*pc->s.w[X] +
+      pc->zeta[ 9]*pc->s.w[Y] +
+      pc->zeta[10]*pc->s.w[Z]);
+  pc->force[Z] = pc->f0[Z]
+    -(pc->zeta[ 2]*pc->s.v[X] +
+      pc->zeta[ 7]*pc->s.v[Y] +
+      pc->zeta[11]*pc->s.v[Z] +
+      pc->zeta[12]*pc->s.w[X] +
+      pc->zeta[13]*pc->s.w[Y] +
+      pc->zeta[14]*pc->s.w[Z]);
 
   return 0;
 }
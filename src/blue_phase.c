@@ -8,7 +8,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2011-2018 The University of Edinburgh
+ *  (c) 2011-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -1376,31 +1376,31 @@ __host__ int fe_lc_active_stress(fe_lc_t * fe) {
 
 /*****************************************************************************
  *
- *  fe_lc_mol_field_v
+ *  fe_lc_tensors_v
+ *
+ *  Expand the five independent components of Q_ab, d_c Q_ab and
+ *  del^2 Q_ab at sites index, ..., index + NSIMDVL - 1 into full
+ *  (symmetric, traceless) tensors.
  *
  *****************************************************************************/
 
-__host__ __device__
-void fe_lc_mol_field_v(fe_lc_t * fe, int index, double h[3][3][NSIMDVL]) {
-
+static __host__ __device__
+void fe_lc_tensors_v(fe_lc_t * fe, int index,
+		     double q[3][3][NSIMDVL],
+		     double dq[3][3][3][NSIMDVL],
+		     double dsq[3][3][NSIMDVL]) {
   int ia, iv;
 
-  double q[3][3][NSIMDVL];
-  double dq[3][3][3][NSIMDVL];
-  double dsq[3][3][NSIMDVL];
-
   double * __restrict__ data;
   double * __restrict__ grad;
   double * __restrict__ delsq;
 
   assert(fe);
- 
+
   data = fe->q->data;
   grad = fe->dq->grad;
   delsq = fe->dq->delsq;
 
-  /* Expand various tensors */
-
   for_simd_v(iv, NSIMDVL) q[X][X][iv] = data[addr_rank1(fe->q->nsites,NQAB,index+iv,XX)];
   for_simd_v(iv, NSIMDVL) q[X][Y][iv] = data[addr_rank1(fe->q->nsites,NQAB,index+iv,XY)];
   for_simd_v(iv, NSIMDVL) q[X][Z][iv] = data[addr_rank1(fe->q->nsites,NQAB,index+iv,XZ)];
@@ -1411,7 +1411,6 @@ void fe_lc_mol_field_v(fe_lc_t * fe, int index, double h[3][3][NSIMDVL]) {
   for_simd_v(iv, NSIMDVL) q[Z][Y][iv] = q[Y][Z][iv];
   for_simd_v(iv, NSIMDVL) q[Z][Z][iv] = 0.0 - q[X][X][iv] - q[Y][Y][iv];
 
-
   for (ia = 0; ia < NVECTOR; ia++) {
     for_simd_v(iv, NSIMDVL) dq[ia][X][X][iv] = grad[addr_rank2(fe->q->nsites,NQAB,NVECTOR,index+iv,XX,ia)];
     for_simd_v(iv, NSIMDVL) dq[ia][X][Y][iv] = grad[addr_rank2(fe->q->nsites,NQAB,NVECTOR,index+iv,XY,ia)];
@@ -1434,94 +1433,163 @@ void fe_lc_mol_field_v(fe_lc_t * fe, int index, double h[3][3][NSIMDVL]) {
   for_simd_v(iv, NSIMDVL) dsq[Z][Y][iv] = dsq[Y][Z][iv];
   for_simd_v(iv, NSIMDVL) dsq[Z][Z][iv] = 0.0 - dsq[X][X][iv] - dsq[Y][Y][iv];
 
+  return;
+}
 
-  fe_lc_compute_h_v(fe, q, dq, dsq, h);
+/*****************************************************************************
+ *
+ *  fe_lc_stress_active_v
+ *
+ *  Add the active stress, if present, to s.
+ *
+ *****************************************************************************/
+
+static __host__ __device__
+void fe_lc_stress_active_v(fe_lc_t * fe, int index,
+			   double q[3][3][NSIMDVL],
+			   double s[3][3][NSIMDVL]) {
+  int ia, ib, iv;
+  double dp[3][3];
+  double sa[3][3];
+  double q1[3][3];
+
+  assert(fe);
+
+  if (fe->param->is_active == 0) return;
+
+  for (iv = 0; iv < NSIMDVL; iv++) {
+    field_grad_vector_grad(fe->dp, index + iv, dp);
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	q1[ia][ib] = q[ia][ib][iv];
+      }
+    }
+    fe_lc_compute_stress_active(fe, q1, dp, sa);
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	s[ia][ib][iv] += sa[ia][ib];
+      }
+    }
+  }
 
   return;
 }
 
 /*****************************************************************************
  *
- *  fe_lc_stress_v
+ *  fe_lc_compute_anti_v
  *
- *  Vectorised version of fe_lc_stress
+ *  The antisymmetric combination a_ab = Q_ac H_cb - H_ac Q_cb for
+ *  symmetric Q and H. The diagonal is identically zero.
  *
  *****************************************************************************/
 
-__host__ __device__
-void fe_lc_stress_v(fe_lc_t * fe, int index, double s[3][3][NSIMDVL]) { 
+static __host__ __device__
+void fe_lc_compute_anti_v(double q[3][3][NSIMDVL],
+			  double h[3][3][NSIMDVL],
+			  double a[3][3][NSIMDVL]) {
+  int iv;
+
+  for_simd_v(iv, NSIMDVL) {
+
+    double qxx = q[X][X][iv], qxy = q[X][Y][iv], qxz = q[X][Z][iv];
+    double qyy = q[Y][Y][iv], qyz = q[Y][Z][iv], qzz = q[Z][Z][iv];
+    double hxx = h[X][X][iv], hxy = h[X][Y][iv], hxz = h[X][Z][iv];
+    double hyy = h[Y][Y][iv], hyz = h[Y][Z][iv], hzz = h[Z][Z][iv];
+
+    double axy = (qxx*hxy + qxy*hyy + qxz*hyz) - (hxx*qxy + hxy*qyy + hxz*qyz);
+    double axz = (qxx*hxz + qxy*hyz + qxz*hzz) - (hxx*qxz + hxy*qyz + hxz*qzz);
+    double ayz = (qxy*hxz + qyy*hyz + qyz*hzz) - (hxy*qxz + hyy*qyz + hyz*qzz);
+
+    a[X][X][iv] = 0.0;
+    a[X][Y][iv] = axy;
+    a[X][Z][iv] = axz;
+    a[Y][X][iv] = -axy;
+    a[Y][Y][iv] = 0.0;
+    a[Y][Z][iv] = ayz;
+    a[Z][X][iv] = -axz;
+    a[Z][Y][iv] = -ayz;
+    a[Z][Z][iv] = 0.0;
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  fe_lc_compute_curl_v
+ *
+ *  The combination g_ab = e_acd d_c Q_db + 2 q_0 Q_ab which appears
+ *  in the chiral gradient terms. Only the six non-zero entries of
+ *  the Levi-Civita tensor contribute, so each component is a single
+ *  difference of gradient components (with d_c Q_db = d_c Q_bd).
+ *
+ *****************************************************************************/
 
+static __host__ __device__
+void fe_lc_compute_curl_v(double q0, double q[3][3][NSIMDVL],
+			  double dq[3][3][3][NSIMDVL],
+			  double g[3][3][NSIMDVL]) {
   int iv;
-  int ia;
- 
+
+  for_simd_v(iv, NSIMDVL) {
+    g[X][X][iv] = dq[Y][X][Z][iv] - dq[Z][X][Y][iv] + 2.0*q0*q[X][X][iv];
+    g[X][Y][iv] = dq[Y][Y][Z][iv] - dq[Z][Y][Y][iv] + 2.0*q0*q[X][Y][iv];
+    g[X][Z][iv] = dq[Y][Z][Z][iv] - dq[Z][Y][Z][iv] + 2.0*q0*q[X][Z][iv];
+    g[Y][X][iv] = dq[Z][X][X][iv] - dq[X][X][Z][iv] + 2.0*q0*q[Y][X][iv];
+    g[Y][Y][iv] = dq[Z][X][Y][iv] - dq[X][Y][Z][iv] + 2.0*q0*q[Y][Y][iv];
+    g[Y][Z][iv] = dq[Z][X][Z][iv] - dq[X][Z][Z][iv] + 2.0*q0*q[Y][Z][iv];
+    g[Z][X][iv] = dq[X][X][Y][iv] - dq[Y][X][X][iv] + 2.0*q0*q[Z][X][iv];
+    g[Z][Y][iv] = dq[X][Y][Y][iv] - dq[Y][X][Y][iv] + 2.0*q0*q[Z][Y][iv];
+    g[Z][Z][iv] = dq[X][Y][Z][iv] - dq[Y][X][Z][iv] + 2.0*q0*q[Z][Z][iv];
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  fe_lc_mol_field_v
+ *
+ *****************************************************************************/
+
+__host__ __device__
+void fe_lc_mol_field_v(fe_lc_t * fe, int index, double h[3][3][NSIMDVL]) {
+
   double q[3][3][NSIMDVL];
-  double h[3][3][NSIMDVL];
   double dq[3][3][3][NSIMDVL];
   double dsq[3][3][NSIMDVL];
 
-  double * __restrict__ data;
-  double * __restrict__ grad;
-  double * __restrict__ delsq;
+  assert(fe);
 
-  data = fe->q->data;
-  grad = fe->dq->grad;
-  delsq = fe->dq->delsq;
+  fe_lc_tensors_v(fe, index, q, dq, dsq);
+  fe_lc_compute_h_v(fe, q, dq, dsq, h);
 
-  for_simd_v(iv, NSIMDVL) q[X][X][iv] = data[addr_rank1(fe->q->nsites,NQAB,index+iv,XX)];
-  for_simd_v(iv, NSIMDVL) q[X][Y][iv] = data[addr_rank1(fe->q->nsites,NQAB,index+iv,XY)];
-  for_simd_v(iv, NSIMDVL) q[X][Z][iv] = data[addr_rank1(fe->q->nsites,NQAB,index+iv,XZ)];
-  for_simd_v(iv, NSIMDVL) q[Y][X][iv] = q[X][Y][iv];
-  for_simd_v(iv, NSIMDVL) q[Y][Y][iv] = data[addr_rank1(fe->q->nsites,NQAB,index+iv,YY)];
-  for_simd_v(iv, NSIMDVL) q[Y][Z][iv] = data[addr_rank1(fe->q->nsites,NQAB,index+iv,YZ)];
-  for_simd_v(iv, NSIMDVL) q[Z][X][iv] = q[X][Z][iv];
-  for_simd_v(iv, NSIMDVL) q[Z][Y][iv] = q[Y][Z][iv];
-  for_simd_v(iv, NSIMDVL) q[Z][Z][iv] = 0.0 - q[X][X][iv] - q[Y][Y][iv];
+  return;
+}
 
-  for (ia = 0; ia < NVECTOR; ia++) {
-    for_simd_v(iv, NSIMDVL) dq[ia][X][X][iv] = grad[addr_rank2(fe->q->nsites,NQAB,3,index+iv,XX,ia)];
-    for_simd_v(iv, NSIMDVL) dq[ia][X][Y][iv] = grad[addr_rank2(fe->q->nsites,NQAB,3,index+iv,XY,ia)];
-    for_simd_v(iv, NSIMDVL) dq[ia][X][Z][iv] = grad[addr_rank2(fe->q->nsites,NQAB,3,index+iv,XZ,ia)];
-    for_simd_v(iv, NSIMDVL) dq[ia][Y][X][iv] = dq[ia][X][Y][iv];
-    for_simd_v(iv, NSIMDVL) dq[ia][Y][Y][iv] = grad[addr_rank2(fe->q->nsites,NQAB,3,index+iv,YY,ia)];
-    for_simd_v(iv, NSIMDVL) dq[ia][Y][Z][iv] = grad[addr_rank2(fe->q->nsites,NQAB,3,index+iv,YZ,ia)];
-    for_simd_v(iv, NSIMDVL) dq[ia][Z][X][iv] = dq[ia][X][Z][iv];
-    for_simd_v(iv, NSIMDVL) dq[ia][Z][Y][iv] = dq[ia][Y][Z][iv];
-    for_simd_v(iv, NSIMDVL) dq[ia][Z][Z][iv] = 0.0 - dq[ia][X][X][iv] - dq[ia][Y][Y][iv];
-  }
+/*****************************************************************************
+ *
+ *  fe_lc_stress_v
+ *
+ *  Vectorised version of fe_lc_stress
+ *
+ *****************************************************************************/
 
-  for_simd_v(iv, NSIMDVL) dsq[X][X][iv] = delsq[addr_rank1(fe->q->nsites,NQAB,index+iv,XX)];
-  for_simd_v(iv, NSIMDVL) dsq[X][Y][iv] = delsq[addr_rank1(fe->q->nsites,NQAB,index+iv,XY)];
-  for_simd_v(iv, NSIMDVL) dsq[X][Z][iv] = delsq[addr_rank1(fe->q->nsites,NQAB,index+iv,XZ)];
-  for_simd_v(iv, NSIMDVL) dsq[Y][X][iv] = dsq[X][Y][iv];
-  for_simd_v(iv, NSIMDVL) dsq[Y][Y][iv] = delsq[addr_rank1(fe->q->nsites,NQAB,index+iv,YY)];
-  for_simd_v(iv, NSIMDVL) dsq[Y][Z][iv] = delsq[addr_rank1(fe->q->nsites,NQAB,index+iv,YZ)];
-  for_simd_v(iv, NSIMDVL) dsq[Z][X][iv] = dsq[X][Z][iv];
-  for_simd_v(iv, NSIMDVL) dsq[Z][Y][iv] = dsq[Y][Z][iv];
-  for_simd_v(iv, NSIMDVL) dsq[Z][Z][iv] = 0.0 - dsq[X][X][iv] - dsq[Y][Y][iv];
+__host__ __device__
+void fe_lc_stress_v(fe_lc_t * fe, int index, double s[3][3][NSIMDVL]) {
+
+  double q[3][3][NSIMDVL];
+  double h[3][3][NSIMDVL];
+  double dq[3][3][3][NSIMDVL];
+  double dsq[3][3][NSIMDVL];
+
+  assert(fe);
 
+  fe_lc_tensors_v(fe, index, q, dq, dsq);
   fe_lc_compute_h_v(fe, q, dq, dsq, h);
   fe_lc_compute_stress_v(fe, q, dq, h, s);
-
-  if (fe->param->is_active) {
-    int ib;
-    double dp[3][3];
-    double sa[3][3];
-    double q1[3][3];
-    for (iv = 0; iv < NSIMDVL; iv++) {
-      field_grad_vector_grad(fe->dp, index + iv, dp);
-      for (ia = 0; ia < 3; ia++) {
-	for (ib = 0; ib < 3; ib++) {
-	  q1[ia][ib] = q[ia][ib][iv];
-	}
-      }
-      fe_lc_compute_stress_active(fe, q1, dp, sa);
-      for (ia = 0; ia < 3; ia++) {
-	for (ib = 0; ib < 3; ib++) {
-	  s[ia][ib][iv] += sa[ia][ib];
-	}
-      }
-    }
-  }
+  fe_lc_stress_active_v(fe, index, q, s);
 
   return;
 }
@@ -1530,22 +1598,34 @@ void fe_lc_stress_v(fe_lc_t * fe, int index, double s[3][3][NSIMDVL]) {
  *
  *  fe_lc_str_symm_v
  *
+ *  Vectorised version of fe_lc_str_symm().
+ *
  *****************************************************************************/
 
 __host__ __device__ void fe_lc_str_symm_v(fe_lc_t * fe, int index,
 			 		  double s[3][3][NSIMDVL]) {
 
   int ia, ib, iv;
-  double s1[3][3];
+  double q[3][3][NSIMDVL];
+  double h[3][3][NSIMDVL];
+  double a[3][3][NSIMDVL];
+  double dq[3][3][3][NSIMDVL];
+  double dsq[3][3][NSIMDVL];
 
   assert(fe);
 
-  for (iv = 0; iv < NSIMDVL; iv++) {
-    fe_lc_str_symm(fe, index + iv, s1);
-    for (ia = 0; ia < 3; ia++) {
-      for (ib = 0; ib < 3; ib++) {
-	s[ia][ib][iv] = s1[ia][ib];
-      }
+  fe_lc_tensors_v(fe, index, q, dq, dsq);
+  fe_lc_compute_h_v(fe, q, dq, dsq, h);
+  fe_lc_compute_stress_v(fe, q, dq, h, s);
+  fe_lc_stress_active_v(fe, index, q, s);
+
+  /* Antisymmetric part is subtracted (added, with the -ve sign) */
+
+  fe_lc_compute_anti_v(q, h, a);
+
+  for (ia = 0; ia < 3; ia++) {
+    for (ib = 0; ib < 3; ib++) {
+      for_simd_v(iv, NSIMDVL) s[ia][ib][iv] += a[ia][ib][iv];
     }
   }
 
@@ -1556,23 +1636,30 @@ __host__ __device__ void fe_lc_str_symm_v(fe_lc_t * fe, int index,
  *
  *  fe_lc_str_anti_v
  *
+ *  Vectorised version of fe_lc_str_anti().
+ *
  *****************************************************************************/
 
 __host__ __device__ void fe_lc_str_anti_v(fe_lc_t * fe, int index,
 			 		  double s[3][3][NSIMDVL]) {
-  assert(fe);
 
   int ia, ib, iv;
-  double s1[3][3];
+  double q[3][3][NSIMDVL];
+  double h[3][3][NSIMDVL];
+  double dq[3][3][3][NSIMDVL];
+  double dsq[3][3][NSIMDVL];
 
   assert(fe);
 
-  for (iv = 0; iv < NSIMDVL; iv++) {
-    fe_lc_str_anti(fe, index + iv, s1);
-    for (ia = 0; ia < 3; ia++) {
-      for (ib = 0; ib < 3; ib++) {
-	s[ia][ib][iv] = s1[ia][ib];
-      }
+  fe_lc_tensors_v(fe, index, q, dq, dsq);
+  fe_lc_compute_h_v(fe, q, dq, dsq, h);
+  fe_lc_compute_anti_v(q, h, s);
+
+  /* With minus sign */
+
+  for (ia = 0; ia < 3; ia++) {
+    for (ib = 0; ib < 3; ib++) {
+      for_simd_v(iv, NSIMDVL) s[ia][ib][iv] = -s[ia][ib][iv];
     }
   }
 
@@ -1583,28 +1670,26 @@ __host__ __device__ void fe_lc_str_anti_v(fe_lc_t * fe, int index,
  *
  *  fe_lc_compute_fed_v
  *
- *  Vectorised version of fe_lc_dompute_fed().
+ *  Vectorised version of fe_lc_compute_fed().
  *
- *  NO gamma = gamma(r) at the moment.
+ *  Only the six independent components of the symmetric Q_ab are
+ *  referenced. NO gamma = gamma(r) at the moment.
  *
  ****************************************************************************/
 
 __host__ __device__
 void fe_lc_compute_fed_v(fe_lc_t * fe,
-			 double q[3][3][NSIMDVL], 
+			 double q[3][3][NSIMDVL],
 			 double dq[3][3][3][NSIMDVL],
 			 double fed[NSIMDVL]) {
   int iv;
-  int ia, ib, ic;
 
+  double a0, gamma;
   double q0;
   double kappa0;
   double kappa1;
-
-  double sum[NSIMDVL];
-  double q2[NSIMDVL], q3[NSIMDVL];
-  double dq0[NSIMDVL], dq1[NSIMDVL];
-  double efield[NSIMDVL];
+  double exx, exy, exz, eyy, eyz, ezz;
+  double g[3][3][NSIMDVL];
   const double r3 = 1.0/3.0;
 
   assert(fe);
@@ -1612,153 +1697,83 @@ void fe_lc_compute_fed_v(fe_lc_t * fe,
   /* Redshifted values */
   q0 = fe->param->rredshift*fe->param->q0;
   kappa0 = fe->param->redshift*fe->param->redshift*fe->param->kappa0;
-  kappa1 = kappa0;
-
-  for_simd_v(iv, NSIMDVL) q2[iv] = 0.0;
-
-  /* Q_ab^2 */
-
-  for (ia = 0; ia < 3; ia++) {
-    for (ib = 0; ib < 3; ib++) {
-      for_simd_v(iv, NSIMDVL)  q2[iv] += q[ia][ib][iv]*q[ia][ib][iv];
-    }
-  }
-
-  /* Q_ab Q_bc Q_ca */
-
-  for_simd_v(iv, NSIMDVL) q3[iv] = 0.0;
-
-  for (ia = 0; ia < 3; ia++) {
-    for (ib = 0; ib < 3; ib++) {
-      for (ic = 0; ic < 3; ic++) {
-	/* We use here the fact that q[ic][ia] = q[ia][ic] */
-	for_simd_v(iv, NSIMDVL)  q3[iv] += q[ia][ib][iv]*q[ib][ic][iv]*q[ia][ic][iv];
-      }
-    }
-  }
-
-  /* (d_b Q_ab)^2 */
-
-  for_simd_v(iv, NSIMDVL)  dq0[iv] = 0.0;
-
-  for (ia = 0; ia < 3; ia++) {
-    for_simd_v(iv, NSIMDVL)  sum[iv] = 0.0;
-    for (ib = 0; ib < 3; ib++) {
-      for_simd_v(iv, NSIMDVL)  sum[iv] += dq[ib][ia][ib][iv];
-    }
-    for_simd_v(iv, NSIMDVL)  dq0[iv] += sum[iv]*sum[iv];
-  }
-
-  /* (e_acd d_c Q_db + 2q_0 Q_ab)^2 */
-  /* With symmetric Q_db write Q_bd */
-
-  for_simd_v(iv, NSIMDVL)  dq1[iv] = 0.0;
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[1][0][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[2][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[1][1][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[2][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[1][2][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[2][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[0][0][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[2][0][0][iv];
+  kappa1 = fe->param->redshift*fe->param->redshift*fe->param->kappa1;
 
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[0][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[2][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[0][2][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[2][2][0][iv];
+  a0 = fe->param->a0;
+  gamma = fe->param->gamma;
 
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[1][2][iv];
+  /* Electric field E_a E_b (epsilon_ includes the factor 1/12pi) */
 
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
+  exx = fe->param->e0coswt[X]*fe->param->e0coswt[X];
+  exy = fe->param->e0coswt[X]*fe->param->e0coswt[Y];
+  exz = fe->param->e0coswt[X]*fe->param->e0coswt[Z];
+  eyy = fe->param->e0coswt[Y]*fe->param->e0coswt[Y];
+  eyz = fe->param->e0coswt[Y]*fe->param->e0coswt[Z];
+  ezz = fe->param->e0coswt[Z]*fe->param->e0coswt[Z];
 
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[0][0][1][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[1][0][0][iv];
+  /* (e_acd d_c Q_db + 2q_0 Q_ab) */
 
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[2][0][iv];
+  fe_lc_compute_curl_v(q0, q, dq, g);
 
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
+  for_simd_v(iv, NSIMDVL) {
 
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[0][1][1][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[1][1][0][iv];
+    double qxx = q[X][X][iv], qxy = q[X][Y][iv], qxz = q[X][Z][iv];
+    double qyy = q[Y][Y][iv], qyz = q[Y][Z][iv], qzz = q[Z][Z][iv];
+    double q2, q3;
+    double dq0, dq1;
+    double divx, divy, divz;
+    double efield;
 
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[2][1][iv];
+    /* Q_ab^2 and Q_ab Q_bc Q_ca */
 
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
+    q2 = qxx*qxx + qyy*qyy + qzz*qzz + 2.0*(qxy*qxy + qxz*qxz + qyz*qyz);
 
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[0][2][1][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] -= dq[1][2][0][iv];
+    q3 = qxx*qxx*qxx + qyy*qyy*qyy + qzz*qzz*qzz
+      + 3.0*(qxy*qxy*(qxx + qyy) + qxz*qxz*(qxx + qzz) + qyz*qyz*(qyy + qzz))
+      + 6.0*qxy*qxz*qyz;
 
-  for_simd_v(iv, NSIMDVL) sum[iv] += 2.0*q0*q[2][2][iv];
+    /* (d_b Q_ab)^2 */
 
-  for_simd_v(iv, NSIMDVL) dq1[iv] += sum[iv]*sum[iv];
+    divx = dq[X][X][X][iv] + dq[Y][X][Y][iv] + dq[Z][X][Z][iv];
+    divy = dq[X][X][Y][iv] + dq[Y][Y][Y][iv] + dq[Z][Y][Z][iv];
+    divz = dq[X][X][Z][iv] + dq[Y][Y][Z][iv] + dq[Z][Z][Z][iv];
 
+    dq0 = divx*divx + divy*divy + divz*divz;
 
-  /* Electric field term (epsilon_ includes the factor 1/12pi) */
+    /* (e_acd d_c Q_db + 2q_0 Q_ab)^2 */
 
-  for_simd_v(iv, NSIMDVL)  efield[iv] = 0.0;
+    dq1 = g[X][X][iv]*g[X][X][iv] + g[X][Y][iv]*g[X][Y][iv]
+        + g[X][Z][iv]*g[X][Z][iv] + g[Y][X][iv]*g[Y][X][iv]
+        + g[Y][Y][iv]*g[Y][Y][iv] + g[Y][Z][iv]*g[Y][Z][iv]
+        + g[Z][X][iv]*g[Z][X][iv] + g[Z][Y][iv]*g[Z][Y][iv]
+        + g[Z][Z][iv]*g[Z][Z][iv];
 
-  for (ia = 0; ia < 3; ia++) {
-    for (ib = 0; ib < 3; ib++) {
-      for_simd_v(iv, NSIMDVL) {
-	efield[iv] += fe->param->e0coswt[ia]*q[ia][ib][iv]*fe->param->e0coswt[ib];
-      }
-    }
-  }
+    /* E_a Q_ab E_b */
 
+    efield = exx*qxx + eyy*qyy + ezz*qzz + 2.0*(exy*qxy + exz*qxz + eyz*qyz);
 
-  for_simd_v(iv, NSIMDVL) {
-    fed[iv] = 0.5*fe->param->a0*(1.0 - r3*fe->param->gamma)*q2[iv]
-      - r3*fe->param->a0*fe->param->gamma*q3[iv]
-      + 0.25*fe->param->a0*fe->param->gamma*q2[iv]*q2[iv]
-      + 0.5*kappa0*dq0[iv] + 0.5*kappa1*dq1[iv]
-      - fe->param->epsilon*efield[iv];
+    fed[iv] = 0.5*a0*(1.0 - r3*gamma)*q2
+      - r3*a0*gamma*q3
+      + 0.25*a0*gamma*q2*q2
+      + 0.5*kappa0*dq0 + 0.5*kappa1*dq1
+      - fe->param->epsilon*efield;
   }
 
   return;
 }
 
-
 /*****************************************************************************
  *
  *  fe_lc_compute_h_v
  *
  *  Vectorised version of the molecular field computation.
  *
+ *  As Q_ab is symmetric and traceless, only the upper triangle of
+ *  H_ab is computed; the lower triangle is a copy. The chiral term
+ *  is written out using the non-zero entries of the Levi-Civita
+ *  tensor only. The contraction e_abc d_b Q_ca, which appears in the
+ *  general expression, vanishes for symmetric Q and is omitted.
+ *
  *  Alan's note for GPU version.
  *
  *  To get temperary q[][][] etc arrays into registers really requires
@@ -1770,175 +1785,88 @@ void fe_lc_compute_fed_v(fe_lc_t * fe,
 
 __host__ __device__ __inline__
 void fe_lc_compute_h_v(fe_lc_t * fe,
-		       double q[3][3][NSIMDVL], 
+		       double q[3][3][NSIMDVL],
 		       double dq[3][3][3][NSIMDVL],
-		       double dsq[3][3][NSIMDVL], 
+		       double dsq[3][3][NSIMDVL],
 		       double h[3][3][NSIMDVL]) {
 
   int iv;
-  int ia, ib, ic;
   double q0;
-  double gamma;
+  double a0, gamma;
   double kappa0;
   double kappa1;
-
-  double q2[NSIMDVL];
-  double e2[NSIMDVL];
-  double edq[NSIMDVL];
-  double sum[NSIMDVL];
-
+  double c1, c2, c3, c4;
+  double e2;
+  double hexx, hexy, hexz, heyy, heyz, hezz;
   const double r3 = (1.0/3.0);
-  KRONECKER_DELTA_CHAR(d);
-  LEVI_CIVITA_CHAR(e);
+
+  assert(fe);
 
   /* Redshifted values */
   q0 = fe->param->rredshift*fe->param->q0;
   kappa0 = fe->param->redshift*fe->param->redshift*fe->param->kappa0;
-  kappa1 = kappa0;
+  kappa1 = fe->param->redshift*fe->param->redshift*fe->param->kappa1;
 
+  a0 = fe->param->a0;
   gamma = fe->param->gamma;
 
-  /* From the bulk terms in the free energy... */
+  c1 = -a0*(1.0 - r3*gamma);
+  c2 = a0*gamma;
+  c3 = 2.0*kappa1*q0;
+  c4 = 4.0*kappa1*q0*q0;
 
-  for_simd_v(iv, NSIMDVL) q2[iv] = 0.0;
+  /* Electric field term is independent of position */
 
-  for (ia = 0; ia < 3; ia++) {
-    for (ib = 0; ib < 3; ib++) {
-      for_simd_v(iv, NSIMDVL) q2[iv] += q[ia][ib][iv]*q[ia][ib][iv];
-    }
-  }
+  e2 = fe->param->e0coswt[X]*fe->param->e0coswt[X]
+     + fe->param->e0coswt[Y]*fe->param->e0coswt[Y]
+     + fe->param->e0coswt[Z]*fe->param->e0coswt[Z];
 
-  for (ia = 0; ia < 3; ia++) {
-    for (ib = 0; ib < 3; ib++) {
-      for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-      for (ic = 0; ic < 3; ic++) {
-	for_simd_v(iv, NSIMDVL) sum[iv] += q[ia][ic][iv]*q[ib][ic][iv];
-      }
-      for_simd_v(iv, NSIMDVL) h[ia][ib][iv] =
-	- fe->param->a0*(1.0 - r3*gamma)*q[ia][ib][iv]
-	+ fe->param->a0*gamma*(sum[iv] - r3*q2[iv]*d[ia][ib])
-	- fe->param->a0*gamma*q2[iv]*q[ia][ib][iv];
-    }
-  }
+  hexx = fe->param->epsilon*(fe->param->e0coswt[X]*fe->param->e0coswt[X] - r3*e2);
+  hexy = fe->param->epsilon*(fe->param->e0coswt[X]*fe->param->e0coswt[Y]);
+  hexz = fe->param->epsilon*(fe->param->e0coswt[X]*fe->param->e0coswt[Z]);
+  heyy = fe->param->epsilon*(fe->param->e0coswt[Y]*fe->param->e0coswt[Y] - r3*e2);
+  heyz = fe->param->epsilon*(fe->param->e0coswt[Y]*fe->param->e0coswt[Z]);
+  hezz = fe->param->epsilon*(fe->param->e0coswt[Z]*fe->param->e0coswt[Z] - r3*e2);
 
-  /* From the gradient terms ... */
-  /* First, the sum e_abc d_b Q_ca. With two permutations, we
-   * may rewrite this as e_bca d_b Q_ca */
+  for_simd_v(iv, NSIMDVL) {
 
-  for_simd_v(iv, NSIMDVL) edq[iv] = 0.0;
-
-  for (ib = 0; ib < 3; ib++) {
-    for (ic = 0; ic < 3; ic++) {
-      for (ia = 0; ia < 3; ia++) {
-	for_simd_v(iv, NSIMDVL) edq[iv] += e[ib][ic][ia]*dq[ib][ic][ia][iv];
-      }
-    }
-  }
-
-  /* Contraction d_c Q_db ... */
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[1][0][2][iv] + dq[1][0][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[2][0][1][iv] + -dq[2][0][1][iv];
-  for_simd_v(iv, NSIMDVL) {
-    h[0][0][iv] += kappa0*dsq[0][0][iv] - 2.0*kappa1*q0*sum[iv]
-      + 4.0*r3*kappa1*q0*edq[iv] - 4.0*kappa1*q0*q0*q[0][0][iv];
-  }
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[0][0][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[1][1][2][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[2][0][0][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[2][1][1][iv] ;
-  for_simd_v(iv, NSIMDVL) {
-    h[0][1][iv] += kappa0*dsq[0][1][iv] - 2.0*kappa1*q0*sum[iv]
-      - 4.0*kappa1*q0*q0*q[0][1][iv];
-  }
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[0][0][1][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[1][0][0][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[1][2][2][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[2][2][1][iv] ;
-  for_simd_v(iv, NSIMDVL) {
-    h[0][2][iv] += kappa0*dsq[0][2][iv] - 2.0*kappa1*q0*sum[iv]
-      - 4.0*kappa1*q0*q0*q[0][2][iv];
-    }
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[0][0][2][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[1][1][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[2][0][0][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[2][1][1][iv];
-  for_simd_v(iv, NSIMDVL) {
-    h[1][0][iv] += kappa0*dsq[1][0][iv] - 2.0*kappa1*q0*sum[iv]
-      - 4.0*kappa1*q0*q0*q[1][0][iv];
-  }
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[0][1][2][iv] + -dq[0][1][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[2][1][0][iv] + dq[2][1][0][iv];
-  for_simd_v(iv, NSIMDVL) {
-    h[1][1][iv] += kappa0*dsq[1][1][iv] - 2.0*kappa1*q0*sum[iv]
-      + 4.0*r3*kappa1*q0*edq[iv] - 4.0*kappa1*q0*q0*q[1][1][iv];
-  }
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[0][1][1][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[0][2][2][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[1][1][0][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[2][2][0][iv] ;
-  for_simd_v(iv, NSIMDVL) {
-    h[1][2][iv] += kappa0*dsq[1][2][iv] - 2.0*kappa1*q0*sum[iv]
-      - 4.0*kappa1*q0*q0*q[1][2][iv];
-  }
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[0][0][1][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[1][0][0][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[1][2][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[2][2][1][iv];
-  for_simd_v(iv, NSIMDVL) {
-    h[2][0][iv] += kappa0*dsq[2][0][iv] - 2.0*kappa1*q0*sum[iv]
-      - 4.0*kappa1*q0*q0*q[2][0][iv];
-  }
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[0][1][1][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[0][2][2][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[1][1][0][iv] ;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[2][2][0][iv];
-  for_simd_v(iv, NSIMDVL) {
-    h[2][1][iv] += kappa0*dsq[2][1][iv] - 2.0*kappa1*q0*sum[iv]
-      - 4.0*kappa1*q0*q0*q[2][1][iv];
-  }
-
-  for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
-  for_simd_v(iv, NSIMDVL) sum[iv] += dq[0][2][1][iv] + dq[0][2][1][iv];
-  for_simd_v(iv, NSIMDVL) sum[iv] += -dq[1][2][0][iv] + -dq[1][2][0][iv];
-  for_simd_v(iv, NSIMDVL) {
-    h[2][2][iv] += kappa0*dsq[2][2][iv] - 2.0*kappa1*q0*sum[iv]
-      + 4.0*r3*kappa1*q0*edq[iv] - 4.0*kappa1*q0*q0*q[2][2][iv];
-  }
-
-  /* Electric field term */
-
-  for_simd_v(iv, NSIMDVL) e2[iv] = 0.0;
-
-  for (ia = 0; ia < 3; ia++) {
-    for_simd_v(iv, NSIMDVL) {
-      e2[iv] += fe->param->e0coswt[ia]*fe->param->e0coswt[ia];
-    }
-  }
-
-  for (ia = 0; ia < 3; ia++) {
-    for (ib = 0; ib < 3; ib++) {
-      for_simd_v(iv, NSIMDVL) {
-	h[ia][ib][iv] +=  fe->param->epsilon*
-	  (fe->param->e0coswt[ia]*fe->param->e0coswt[ib] - r3*d[ia][ib]*e2[iv]);
-      }
-    }
-  }
+    double qxx = q[X][X][iv], qxy = q[X][Y][iv], qxz = q[X][Z][iv];
+    double qyy = q[Y][Y][iv], qyz = q[Y][Z][iv], qzz = q[Z][Z][iv];
+    double q2, cq;
+    double rxy, rxz, ryz;
+
+    /* From the bulk terms in the free energy... */
+
+    q2 = qxx*qxx + qyy*qyy + qzz*qzz + 2.0*(qxy*qxy + qxz*qxz + qyz*qyz);
+    cq = c1 - c2*q2 - c4;
+
+    /* From the gradient terms: e_acd d_c Q_db + e_bcd d_c Q_da
+     * (the diagonal is twice the single term) ... */
+
+    rxy = dq[Y][Y][Z][iv] - dq[Z][Y][Y][iv] + dq[Z][X][X][iv] - dq[X][X][Z][iv];
+    rxz = dq[Y][Z][Z][iv] - dq[Z][Y][Z][iv] + dq[X][X][Y][iv] - dq[Y][X][X][iv];
+    ryz = dq[Z][X][Z][iv] - dq[X][Z][Z][iv] + dq[X][Y][Y][iv] - dq[Y][X][Y][iv];
+
+    h[X][X][iv] = cq*qxx + c2*(qxx*qxx + qxy*qxy + qxz*qxz - r3*q2)
+      + kappa0*dsq[X][X][iv]
+      - 2.0*c3*(dq[Y][X][Z][iv] - dq[Z][X][Y][iv]) + hexx;
+    h[X][Y][iv] = cq*qxy + c2*(qxx*qxy + qxy*qyy + qxz*qyz)
+      + kappa0*dsq[X][Y][iv] - c3*rxy + hexy;
+    h[X][Z][iv] = cq*qxz + c2*(qxx*qxz + qxy*qyz + qxz*qzz)
+      + kappa0*dsq[X][Z][iv] - c3*rxz + hexz;
+    h[Y][Y][iv] = cq*qyy + c2*(qxy*qxy + qyy*qyy + qyz*qyz - r3*q2)
+      + kappa0*dsq[Y][Y][iv]
+      - 2.0*c3*(dq[Z][X][Y][iv] - dq[X][Y][Z][iv]) + heyy;
+    h[Y][Z][iv] = cq*qyz + c2*(qxy*qxz + qyy*qyz + qyz*qzz)
+      + kappa0*dsq[Y][Z][iv] - c3*ryz + heyz;
+    h[Z][Z][iv] = cq*qzz + c2*(qxz*qxz + qyz*qyz + qzz*qzz - r3*q2)
+      + kappa0*dsq[Z][Z][iv]
+      - 2.0*c3*(dq[X][Y][Z][iv] - dq[Y][X][Z][iv]) + hezz;
+
+    h[Y][X][iv] = h[X][Y][iv];
+    h[Z][X][iv] = h[X][Z][iv];
+    h[Z][Y][iv] = h[Y][Z][iv];
+  }
 
   return;
 }
@@ -1949,6 +1877,14 @@ void fe_lc_compute_h_v(fe_lc_t * fe,
  *
  *  Vectorised version of fe_lc_compute_stress()
  *
+ *  Q_ab and H_ab are assumed symmetric, so only their upper triangles
+ *  are referenced. The gradient terms in kappa1 are collected as
+ *
+ *    - kappa1 d_a Q_cd e_bce g_ed
+ *
+ *  with g_ab = e_acd d_c Q_db + 2 q_0 Q_ab (see fe_lc_compute_curl_v()),
+ *  so that only the non-zero entries of the Levi-Civita tensor appear.
+ *
  *****************************************************************************/
 
 __host__ __device__
@@ -1957,7 +1893,6 @@ void fe_lc_compute_stress_v(fe_lc_t * fe,
 			    double dq[3][3][3][NSIMDVL],
 			    double h[3][3][NSIMDVL],
 			    double s[3][3][NSIMDVL]) {
-  int ia, ib;
   int iv;
 
   double kappa0;
@@ -1965,12 +1900,13 @@ void fe_lc_compute_stress_v(fe_lc_t * fe,
   double q0;
   double xi;
 
-  double qh[NSIMDVL];
-  double p0[NSIMDVL];
-  double sthtmp[NSIMDVL];
+  double fed[NSIMDVL];
+  double g[3][3][NSIMDVL];
 
   const double r3 = (1.0/3.0);
 
+  assert(fe);
+
   /* Redshifted values */
 
   q0 = fe->param->q0*fe->param->rredshift;
@@ -1980,472 +1916,85 @@ void fe_lc_compute_stress_v(fe_lc_t * fe,
   xi = fe->param->xi;
 
   /* We have ignored the rho T term at the moment, assumed to be zero
-     (in particular, it has no divergence if rho = const). */
-
-  fe_lc_compute_fed_v(fe, q, dq, p0);
-
-  for_simd_v(iv, NSIMDVL) p0[iv] = 0.0 - p0[iv]; 
-
-  /* The contraction Q_ab H_ab */
-
-  for_simd_v(iv, NSIMDVL) qh[iv] = 0.0;
-
-  for (ia = 0; ia < 3; ia++) {
-    for (ib = 0; ib < 3; ib++) {
-      for_simd_v(iv, NSIMDVL) qh[iv] += q[ia][ib][iv]*h[ia][ib][iv];
-    }
-  }
-
-  /* The rest is automatically generated following
-   * fe_lc_compute_stress() */
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[0][0][iv]+ r3)*qh[iv] -p0[iv] ;
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][0][iv]*(q[0][0][iv] + r3)   -xi*(q[0][0][iv]    +r3)*h[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][1][iv]*(q[0][1][iv])   -xi*(q[0][1][iv]    )*h[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][2][iv]*(q[0][2][iv])   -xi*(q[0][2][iv]    )*h[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][0][iv]*dq[0][0][0][iv] - kappa1*dq[0][0][0][iv]*dq[0][0][0][iv]+ kappa1*dq[0][0][0][iv]*dq[0][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][0][iv]*dq[1][0][1][iv] - kappa1*dq[0][0][1][iv]*dq[0][0][1][iv]+ kappa1*dq[0][0][1][iv]*dq[0][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][0][iv]*dq[2][0][2][iv] - kappa1*dq[0][0][2][iv]*dq[0][0][2][iv]+ kappa1*dq[0][0][2][iv]*dq[0][0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][1][iv]*dq[0][1][0][iv] - kappa1*dq[0][1][0][iv]*dq[0][1][0][iv]+ kappa1*dq[0][1][0][iv]*dq[1][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][1][0][iv]*q[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][1][iv]*dq[1][1][1][iv] - kappa1*dq[0][1][1][iv]*dq[0][1][1][iv]+ kappa1*dq[0][1][1][iv]*dq[1][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][1][1][iv]*q[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][1][iv]*dq[2][1][2][iv] - kappa1*dq[0][1][2][iv]*dq[0][1][2][iv]+ kappa1*dq[0][1][2][iv]*dq[1][0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][1][2][iv]*q[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][2][iv]*dq[0][2][0][iv] - kappa1*dq[0][2][0][iv]*dq[0][2][0][iv]+ kappa1*dq[0][2][0][iv]*dq[2][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][2][0][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][2][iv]*dq[1][2][1][iv] - kappa1*dq[0][2][1][iv]*dq[0][2][1][iv]+ kappa1*dq[0][2][1][iv]*dq[2][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][2][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][0][2][iv]*dq[2][2][2][iv] - kappa1*dq[0][2][2][iv]*dq[0][2][2][iv]+ kappa1*dq[0][2][2][iv]*dq[2][0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][2][2][iv]*q[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][0][iv]*h[0][0][iv] - h[0][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][1][iv]*h[0][1][iv] - h[0][1][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][2][iv]*h[0][2][iv] - h[0][2][iv]*q[0][2][iv];
-
-
-  /* XX -ve sign */
-  for_simd_v(iv, NSIMDVL) s[X][X][iv] = -sthtmp[iv];
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[0][1][iv])*qh[iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][0][iv]*(q[1][0][iv])   -xi*(q[0][0][iv]    +r3)*h[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][1][iv]*(q[1][1][iv] + r3)   -xi*(q[0][1][iv]    )*h[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][2][iv]*(q[1][2][iv])   -xi*(q[0][2][iv]    )*h[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][0][iv]*dq[0][0][0][iv] - kappa1*dq[0][0][0][iv]*dq[1][0][0][iv]+ kappa1*dq[0][0][0][iv]*dq[0][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][0][0][iv]*q[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][0][iv]*dq[1][0][1][iv] - kappa1*dq[0][0][1][iv]*dq[1][0][1][iv]+ kappa1*dq[0][0][1][iv]*dq[0][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][0][1][iv]*q[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][0][iv]*dq[2][0][2][iv] - kappa1*dq[0][0][2][iv]*dq[1][0][2][iv]+ kappa1*dq[0][0][2][iv]*dq[0][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][0][2][iv]*q[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][1][iv]*dq[0][1][0][iv] - kappa1*dq[0][1][0][iv]*dq[1][1][0][iv]+ kappa1*dq[0][1][0][iv]*dq[1][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][1][iv]*dq[1][1][1][iv] - kappa1*dq[0][1][1][iv]*dq[1][1][1][iv]+ kappa1*dq[0][1][1][iv]*dq[1][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][1][iv]*dq[2][1][2][iv] - kappa1*dq[0][1][2][iv]*dq[1][1][2][iv]+ kappa1*dq[0][1][2][iv]*dq[1][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][2][iv]*dq[0][2][0][iv] - kappa1*dq[0][2][0][iv]*dq[1][2][0][iv]+ kappa1*dq[0][2][0][iv]*dq[2][1][0][iv];
-    
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][2][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][2][iv]*dq[1][2][1][iv] - kappa1*dq[0][2][1][iv]*dq[1][2][1][iv]+ kappa1*dq[0][2][1][iv]*dq[2][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][2][1][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][1][2][iv]*dq[2][2][2][iv] - kappa1*dq[0][2][2][iv]*dq[1][2][2][iv]+ kappa1*dq[0][2][2][iv]*dq[2][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][2][2][iv]*q[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][0][iv]*h[1][0][iv] - h[0][0][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][1][iv]*h[1][1][iv] - h[0][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][2][iv]*h[1][2][iv] - h[0][2][iv]*q[1][2][iv];
-
-
-  /* XY with minus sign */
-  for_simd_v(iv, NSIMDVL) s[X][Y][iv] = -sthtmp[iv];
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[0][2][iv])*qh[iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][0][iv]*(q[2][0][iv])   -xi*(q[0][0][iv]    +r3)*h[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][1][iv]*(q[2][1][iv])   -xi*(q[0][1][iv]    )*h[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[0][2][iv]*(q[2][2][iv] + r3)   -xi*(q[0][2][iv]    )*h[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][0][iv]*dq[0][0][0][iv] - kappa1*dq[0][0][0][iv]*dq[2][0][0][iv]+ kappa1*dq[0][0][0][iv]*dq[0][2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][0][0][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][0][iv]*dq[1][0][1][iv] - kappa1*dq[0][0][1][iv]*dq[2][0][1][iv]+ kappa1*dq[0][0][1][iv]*dq[0][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][0][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][0][iv]*dq[2][0][2][iv] - kappa1*dq[0][0][2][iv]*dq[2][0][2][iv]+ kappa1*dq[0][0][2][iv]*dq[0][2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[0][0][2][iv]*q[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][1][iv]*dq[0][1][0][iv] - kappa1*dq[0][1][0][iv]*dq[2][1][0][iv]+ kappa1*dq[0][1][0][iv]*dq[1][2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][1][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][1][iv]*dq[1][1][1][iv] - kappa1*dq[0][1][1][iv]*dq[2][1][1][iv]+ kappa1*dq[0][1][1][iv]*dq[1][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][1][1][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][1][iv]*dq[2][1][2][iv] - kappa1*dq[0][1][2][iv]*dq[2][1][2][iv]+ kappa1*dq[0][1][2][iv]*dq[1][2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[0][1][2][iv]*q[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][2][iv]*dq[0][2][0][iv] - kappa1*dq[0][2][0][iv]*dq[2][2][0][iv]+ kappa1*dq[0][2][0][iv]*dq[2][2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][2][iv]*dq[1][2][1][iv] - kappa1*dq[0][2][1][iv]*dq[2][2][1][iv]+ kappa1*dq[0][2][1][iv]*dq[2][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[0][2][2][iv]*dq[2][2][2][iv] - kappa1*dq[0][2][2][iv]*dq[2][2][2][iv]+ kappa1*dq[0][2][2][iv]*dq[2][2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][0][iv]*h[2][0][iv] - h[0][0][iv]*q[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][1][iv]*h[2][1][iv] - h[0][1][iv]*q[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[0][2][iv]*h[2][2][iv] - h[0][2][iv]*q[2][2][iv];
-
-
-  /* XZ with -ve sign*/
-  for_simd_v(iv, NSIMDVL) s[X][Z][iv] = -sthtmp[iv];
-
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[1][0][iv])*qh[iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][0][iv]*(q[0][0][iv] + r3)   -xi*(q[1][0][iv]    )*h[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][1][iv]*(q[0][1][iv])   -xi*(q[1][1][iv]    +r3)*h[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][2][iv]*(q[0][2][iv])   -xi*(q[1][2][iv]    )*h[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][0][iv]*dq[0][0][0][iv] - kappa1*dq[1][0][0][iv]*dq[0][0][0][iv]+ kappa1*dq[1][0][0][iv]*dq[0][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][0][iv]*dq[1][0][1][iv] - kappa1*dq[1][0][1][iv]*dq[0][0][1][iv]+ kappa1*dq[1][0][1][iv]*dq[0][0][1][iv];
+     (in particular, it has no divergence if rho = const). The isotropic
+     pressure is p0 = -fed. */
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][0][iv]*dq[2][0][2][iv] - kappa1*dq[1][0][2][iv]*dq[0][0][2][iv]+ kappa1*dq[1][0][2][iv]*dq[0][0][2][iv];
+  fe_lc_compute_fed_v(fe, q, dq, fed);
+  fe_lc_compute_curl_v(q0, q, dq, g);
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][1][iv]*dq[0][1][0][iv] - kappa1*dq[1][1][0][iv]*dq[0][1][0][iv]+ kappa1*dq[1][1][0][iv]*dq[1][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][1][0][iv]*q[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][1][iv]*dq[1][1][1][iv] - kappa1*dq[1][1][1][iv]*dq[0][1][1][iv]+ kappa1*dq[1][1][1][iv]*dq[1][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][1][1][iv]*q[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][1][iv]*dq[2][1][2][iv] - kappa1*dq[1][1][2][iv]*dq[0][1][2][iv]+ kappa1*dq[1][1][2][iv]*dq[1][0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][1][2][iv]*q[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][2][iv]*dq[0][2][0][iv] - kappa1*dq[1][2][0][iv]*dq[0][2][0][iv]+ kappa1*dq[1][2][0][iv]*dq[2][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][2][0][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][2][iv]*dq[1][2][1][iv] - kappa1*dq[1][2][1][iv]*dq[0][2][1][iv]+ kappa1*dq[1][2][1][iv]*dq[2][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][2][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][0][2][iv]*dq[2][2][2][iv] - kappa1*dq[1][2][2][iv]*dq[0][2][2][iv]+ kappa1*dq[1][2][2][iv]*dq[2][0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][2][2][iv]*q[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][0][iv]*h[0][0][iv] - h[1][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][1][iv]*h[0][1][iv] - h[1][1][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][2][iv]*h[0][2][iv] - h[1][2][iv]*q[0][2][iv];
-
-
-  /* YX -ve sign */
-  for_simd_v(iv, NSIMDVL) s[Y][X][iv] = -sthtmp[iv];
-
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[1][1][iv]+ r3)*qh[iv] -p0[iv] ;
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][0][iv]*(q[1][0][iv])   -xi*(q[1][0][iv]    )*h[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][1][iv]*(q[1][1][iv] + r3)   -xi*(q[1][1][iv]    +r3)*h[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][2][iv]*(q[1][2][iv])   -xi*(q[1][2][iv]    )*h[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][0][iv]*dq[0][0][0][iv] - kappa1*dq[1][0][0][iv]*dq[1][0][0][iv]+ kappa1*dq[1][0][0][iv]*dq[0][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][0][0][iv]*q[0][2][iv];
-  
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][0][iv]*dq[1][0][1][iv] - kappa1*dq[1][0][1][iv]*dq[1][0][1][iv]+ kappa1*dq[1][0][1][iv]*dq[0][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][0][1][iv]*q[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][0][iv]*dq[2][0][2][iv] - kappa1*dq[1][0][2][iv]*dq[1][0][2][iv]+ kappa1*dq[1][0][2][iv]*dq[0][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][0][2][iv]*q[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][1][iv]*dq[0][1][0][iv] - kappa1*dq[1][1][0][iv]*dq[1][1][0][iv]+ kappa1*dq[1][1][0][iv]*dq[1][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][1][iv]*dq[1][1][1][iv] - kappa1*dq[1][1][1][iv]*dq[1][1][1][iv]+ kappa1*dq[1][1][1][iv]*dq[1][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][1][iv]*dq[2][1][2][iv] - kappa1*dq[1][1][2][iv]*dq[1][1][2][iv]+ kappa1*dq[1][1][2][iv]*dq[1][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][2][iv]*dq[0][2][0][iv] - kappa1*dq[1][2][0][iv]*dq[1][2][0][iv]+ kappa1*dq[1][2][0][iv]*dq[2][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][2][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][2][iv]*dq[1][2][1][iv] - kappa1*dq[1][2][1][iv]*dq[1][2][1][iv]+ kappa1*dq[1][2][1][iv]*dq[2][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][2][1][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][1][2][iv]*dq[2][2][2][iv] - kappa1*dq[1][2][2][iv]*dq[1][2][2][iv]+ kappa1*dq[1][2][2][iv]*dq[2][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][2][2][iv]*q[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][0][iv]*h[1][0][iv] - h[1][0][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][1][iv]*h[1][1][iv] - h[1][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][2][iv]*h[1][2][iv] - h[1][2][iv]*q[1][2][iv];
-
-
-  /* YY -ve sign */
-  for_simd_v(iv, NSIMDVL) s[Y][Y][iv] = -sthtmp[iv];
-
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[1][2][iv])*qh[iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][0][iv]*(q[2][0][iv])   -xi*(q[1][0][iv]    )*h[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][1][iv]*(q[2][1][iv])   -xi*(q[1][1][iv]    +r3)*h[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[1][2][iv]*(q[2][2][iv] + r3)   -xi*(q[1][2][iv]    )*h[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][0][iv]*dq[0][0][0][iv] - kappa1*dq[1][0][0][iv]*dq[2][0][0][iv]+ kappa1*dq[1][0][0][iv]*dq[0][2][0][iv];
-  
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][0][0][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][0][iv]*dq[1][0][1][iv] - kappa1*dq[1][0][1][iv]*dq[2][0][1][iv]+ kappa1*dq[1][0][1][iv]*dq[0][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][0][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][0][iv]*dq[2][0][2][iv] - kappa1*dq[1][0][2][iv]*dq[2][0][2][iv]+ kappa1*dq[1][0][2][iv]*dq[0][2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[1][0][2][iv]*q[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][1][iv]*dq[0][1][0][iv] - kappa1*dq[1][1][0][iv]*dq[2][1][0][iv]+ kappa1*dq[1][1][0][iv]*dq[1][2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][1][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][1][iv]*dq[1][1][1][iv] - kappa1*dq[1][1][1][iv]*dq[2][1][1][iv]+ kappa1*dq[1][1][1][iv]*dq[1][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][1][1][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][1][iv]*dq[2][1][2][iv] - kappa1*dq[1][1][2][iv]*dq[2][1][2][iv]+ kappa1*dq[1][1][2][iv]*dq[1][2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[1][1][2][iv]*q[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][2][iv]*dq[0][2][0][iv] - kappa1*dq[1][2][0][iv]*dq[2][2][0][iv]+ kappa1*dq[1][2][0][iv]*dq[2][2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][2][iv]*dq[1][2][1][iv] - kappa1*dq[1][2][1][iv]*dq[2][2][1][iv]+ kappa1*dq[1][2][1][iv]*dq[2][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[1][2][2][iv]*dq[2][2][2][iv] - kappa1*dq[1][2][2][iv]*dq[2][2][2][iv]+ kappa1*dq[1][2][2][iv]*dq[2][2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][0][iv]*h[2][0][iv] - h[1][0][iv]*q[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][1][iv]*h[2][1][iv] - h[1][1][iv]*q[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[1][2][iv]*h[2][2][iv] - h[1][2][iv]*q[2][2][iv];
-
-
-  /* YZ -ve sign */
-  for_simd_v(iv, NSIMDVL) s[Y][Z][iv] = -sthtmp[iv];
-
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[2][0][iv])*qh[iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][0][iv]*(q[0][0][iv] + r3)   -xi*(q[2][0][iv]    )*h[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][1][iv]*(q[0][1][iv])   -xi*(q[2][1][iv]    )*h[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][2][iv]*(q[0][2][iv])   -xi*(q[2][2][iv]    +r3)*h[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][0][iv]*dq[0][0][0][iv] - kappa1*dq[2][0][0][iv]*dq[0][0][0][iv]+ kappa1*dq[2][0][0][iv]*dq[0][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][0][iv]*dq[1][0][1][iv] - kappa1*dq[2][0][1][iv]*dq[0][0][1][iv]+ kappa1*dq[2][0][1][iv]*dq[0][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][0][iv]*dq[2][0][2][iv] - kappa1*dq[2][0][2][iv]*dq[0][0][2][iv]+ kappa1*dq[2][0][2][iv]*dq[0][0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][1][iv]*dq[0][1][0][iv] - kappa1*dq[2][1][0][iv]*dq[0][1][0][iv]+ kappa1*dq[2][1][0][iv]*dq[1][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][1][0][iv]*q[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][1][iv]*dq[1][1][1][iv] - kappa1*dq[2][1][1][iv]*dq[0][1][1][iv]+ kappa1*dq[2][1][1][iv]*dq[1][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][1][1][iv]*q[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][1][iv]*dq[2][1][2][iv] - kappa1*dq[2][1][2][iv]*dq[0][1][2][iv]+ kappa1*dq[2][1][2][iv]*dq[1][0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][1][2][iv]*q[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][2][iv]*dq[0][2][0][iv] - kappa1*dq[2][2][0][iv]*dq[0][2][0][iv]+ kappa1*dq[2][2][0][iv]*dq[2][0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][2][0][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][2][iv]*dq[1][2][1][iv] - kappa1*dq[2][2][1][iv]*dq[0][2][1][iv]+ kappa1*dq[2][2][1][iv]*dq[2][0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][2][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][0][2][iv]*dq[2][2][2][iv] - kappa1*dq[2][2][2][iv]*dq[0][2][2][iv]+ kappa1*dq[2][2][2][iv]*dq[2][0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][2][2][iv]*q[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][0][iv]*h[0][0][iv] - h[2][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][1][iv]*h[0][1][iv] - h[2][1][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][2][iv]*h[0][2][iv] - h[2][2][iv]*q[0][2][iv];
-
-
-  /* ZX -ve sign */
-  for_simd_v(iv, NSIMDVL) s[Z][X][iv] = -sthtmp[iv];
-
-
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[2][1][iv])*qh[iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][0][iv]*(q[1][0][iv])   -xi*(q[2][0][iv]    )*h[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][1][iv]*(q[1][1][iv] + r3)   -xi*(q[2][1][iv]    )*h[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][2][iv]*(q[1][2][iv])   -xi*(q[2][2][iv]    +r3)*h[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][0][iv]*dq[0][0][0][iv] - kappa1*dq[2][0][0][iv]*dq[1][0][0][iv]+ kappa1*dq[2][0][0][iv]*dq[0][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][0][0][iv]*q[0][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][0][iv]*dq[1][0][1][iv] - kappa1*dq[2][0][1][iv]*dq[1][0][1][iv]+ kappa1*dq[2][0][1][iv]*dq[0][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][0][1][iv]*q[1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][0][iv]*dq[2][0][2][iv] - kappa1*dq[2][0][2][iv]*dq[1][0][2][iv]+ kappa1*dq[2][0][2][iv]*dq[0][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][0][2][iv]*q[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][1][iv]*dq[0][1][0][iv] - kappa1*dq[2][1][0][iv]*dq[1][1][0][iv]+ kappa1*dq[2][1][0][iv]*dq[1][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][1][iv]*dq[1][1][1][iv] - kappa1*dq[2][1][1][iv]*dq[1][1][1][iv]+ kappa1*dq[2][1][1][iv]*dq[1][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][1][iv]*dq[2][1][2][iv] - kappa1*dq[2][1][2][iv]*dq[1][1][2][iv]+ kappa1*dq[2][1][2][iv]*dq[1][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][2][iv]*dq[0][2][0][iv] - kappa1*dq[2][2][0][iv]*dq[1][2][0][iv]+ kappa1*dq[2][2][0][iv]*dq[2][1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][2][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][2][iv]*dq[1][2][1][iv] - kappa1*dq[2][2][1][iv]*dq[1][2][1][iv]+ kappa1*dq[2][2][1][iv]*dq[2][1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][2][1][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][1][2][iv]*dq[2][2][2][iv] - kappa1*dq[2][2][2][iv]*dq[1][2][2][iv]+ kappa1*dq[2][2][2][iv]*dq[2][1][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][2][2][iv]*q[2][0][iv];
-  
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][0][iv]*h[1][0][iv] - h[2][0][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][1][iv]*h[1][1][iv] - h[2][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][2][iv]*h[1][2][iv] - h[2][2][iv]*q[1][2][iv];
-
-
-  /* ZY -ve sign */
-  for_simd_v(iv, NSIMDVL) s[Z][Y][iv] = -sthtmp[iv];
-
-
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] = 2.0*xi*(q[2][2][iv]+ r3)*qh[iv] -p0[iv] ;
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][0][iv]*(q[2][0][iv])   -xi*(q[2][0][iv]    )*h[2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][1][iv]*(q[2][1][iv])   -xi*(q[2][1][iv]    )*h[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += -xi*h[2][2][iv]*(q[2][2][iv] + r3)   -xi*(q[2][2][iv]    +r3)*h[2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][0][iv]*dq[0][0][0][iv] - kappa1*dq[2][0][0][iv]*dq[2][0][0][iv]+ kappa1*dq[2][0][0][iv]*dq[0][2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][0][0][iv]*q[0][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][0][iv]*dq[1][0][1][iv] - kappa1*dq[2][0][1][iv]*dq[2][0][1][iv]+ kappa1*dq[2][0][1][iv]*dq[0][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][0][1][iv]*q[1][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][0][iv]*dq[2][0][2][iv] - kappa1*dq[2][0][2][iv]*dq[2][0][2][iv]+ kappa1*dq[2][0][2][iv]*dq[0][2][2][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] -= 2.0*kappa1*q0*dq[2][0][2][iv]*q[2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][1][iv]*dq[0][1][0][iv] - kappa1*dq[2][1][0][iv]*dq[2][1][0][iv]+ kappa1*dq[2][1][0][iv]*dq[1][2][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][1][0][iv]*q[0][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][1][iv]*dq[1][1][1][iv] - kappa1*dq[2][1][1][iv]*dq[2][1][1][iv]+ kappa1*dq[2][1][1][iv]*dq[1][2][1][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][1][1][iv]*q[1][0][iv];
-
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][1][iv]*dq[2][1][2][iv] - kappa1*dq[2][1][2][iv]*dq[2][1][2][iv]+ kappa1*dq[2][1][2][iv]*dq[1][2][2][iv];
+  for_simd_v(iv, NSIMDVL) {
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += 2.0*kappa1*q0*dq[2][1][2][iv]*q[2][0][iv];
+    int ia;
+    double qxx = q[X][X][iv], qxy = q[X][Y][iv], qxz = q[X][Z][iv];
+    double qyy = q[Y][Y][iv], qyz = q[Y][Z][iv], qzz = q[Z][Z][iv];
+    double hxx = h[X][X][iv], hxy = h[X][Y][iv], hxz = h[X][Z][iv];
+    double hyy = h[Y][Y][iv], hyz = h[Y][Z][iv], hzz = h[Z][Z][iv];
+    double divx, divy, divz;
+    double qh;
+    double qhxx, qhxy, qhxz, qhyx, qhyy, qhyz, qhzx, qhzy, qhzz;
+    double sg[3][3];
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][2][iv]*dq[0][2][0][iv] - kappa1*dq[2][2][0][iv]*dq[2][2][0][iv]+ kappa1*dq[2][2][0][iv]*dq[2][2][0][iv];
+    /* The contraction Q_ab H_ab, and (QH)_ab = Q_ac H_cb */
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][2][iv]*dq[1][2][1][iv] - kappa1*dq[2][2][1][iv]*dq[2][2][1][iv]+ kappa1*dq[2][2][1][iv]*dq[2][2][1][iv];
+    qh = qxx*hxx + qyy*hyy + qzz*hzz + 2.0*(qxy*hxy + qxz*hxz + qyz*hyz);
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += - kappa0*dq[2][2][2][iv]*dq[2][2][2][iv] - kappa1*dq[2][2][2][iv]*dq[2][2][2][iv]+ kappa1*dq[2][2][2][iv]*dq[2][2][2][iv];
+    qhxx = qxx*hxx + qxy*hxy + qxz*hxz;
+    qhxy = qxx*hxy + qxy*hyy + qxz*hyz;
+    qhxz = qxx*hxz + qxy*hyz + qxz*hzz;
+    qhyx = qxy*hxx + qyy*hxy + qyz*hxz;
+    qhyy = qxy*hxy + qyy*hyy + qyz*hyz;
+    qhyz = qxy*hxz + qyy*hyz + qyz*hzz;
+    qhzx = qxz*hxx + qyz*hxy + qzz*hxz;
+    qhzy = qxz*hxy + qyz*hyy + qzz*hyz;
+    qhzz = qxz*hxz + qyz*hyz + qzz*hzz;
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][0][iv]*h[2][0][iv] - h[2][0][iv]*q[2][0][iv];
+    /* d_c Q_ac */
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][1][iv]*h[2][1][iv] - h[2][1][iv]*q[2][1][iv];
+    divx = dq[X][X][X][iv] + dq[Y][X][Y][iv] + dq[Z][X][Z][iv];
+    divy = dq[X][X][Y][iv] + dq[Y][Y][Y][iv] + dq[Z][Y][Z][iv];
+    divz = dq[X][X][Z][iv] + dq[Y][Y][Z][iv] + dq[Z][Z][Z][iv];
 
-  for_simd_v(iv, NSIMDVL) sthtmp[iv] += q[2][2][iv]*h[2][2][iv] - h[2][2][iv]*q[2][2][iv];
+    /* Gradient terms -kappa0 d_a Q_bc d_d Q_cd - kappa1 d_a Q_cd e_bce g_ed
+     * one row a at a time */
 
+    for (ia = 0; ia < 3; ia++) {
+      double dxx = dq[ia][X][X][iv], dxy = dq[ia][X][Y][iv];
+      double dxz = dq[ia][X][Z][iv], dyy = dq[ia][Y][Y][iv];
+      double dyz = dq[ia][Y][Z][iv], dzz = dq[ia][Z][Z][iv];
+
+      sg[ia][X] = - kappa0*(dxx*divx + dxy*divy + dxz*divz)
+	- kappa1*((dxy*g[Z][X][iv] + dyy*g[Z][Y][iv] + dyz*g[Z][Z][iv])
+		- (dxz*g[Y][X][iv] + dyz*g[Y][Y][iv] + dzz*g[Y][Z][iv]));
+      sg[ia][Y] = - kappa0*(dxy*divx + dyy*divy + dyz*divz)
+	- kappa1*((dxz*g[X][X][iv] + dyz*g[X][Y][iv] + dzz*g[X][Z][iv])
+		- (dxx*g[Z][X][iv] + dxy*g[Z][Y][iv] + dxz*g[Z][Z][iv]));
+      sg[ia][Z] = - kappa0*(dxz*divx + dyz*divy + dzz*divz)
+	- kappa1*((dxx*g[Y][X][iv] + dxy*g[Y][Y][iv] + dxz*g[Y][Z][iv])
+		- (dxy*g[X][X][iv] + dyy*g[X][Y][iv] + dyz*g[X][Z][iv]));
+    }
 
-  /* ZZ -ve sign */
-  for_simd_v(iv, NSIMDVL) s[Z][Z][iv] = -sthtmp[iv];
+    /* Isotropic pressure, terms in xi, and the antisymmetric piece
+     * Q_ac H_cb - H_ac Q_cb, all with the overall minus sign. */
+
+    s[X][X][iv] = -(fed[iv] + 2.0*xi*(qxx + r3)*qh - 2.0*xi*qhxx
+		    - 2.0*r3*xi*hxx + sg[X][X]);
+    s[X][Y][iv] = -(2.0*xi*qxy*qh - xi*(qhxy + qhyx) - 2.0*r3*xi*hxy
+		    + sg[X][Y] + qhxy - qhyx);
+    s[X][Z][iv] = -(2.0*xi*qxz*qh - xi*(qhxz + qhzx) - 2.0*r3*xi*hxz
+		    + sg[X][Z] + qhxz - qhzx);
+    s[Y][X][iv] = -(2.0*xi*qxy*qh - xi*(qhyx + qhxy) - 2.0*r3*xi*hxy
+		    + sg[Y][X] + qhyx - qhxy);
+    s[Y][Y][iv] = -(fed[iv] + 2.0*xi*(qyy + r3)*qh - 2.0*xi*qhyy
+		    - 2.0*r3*xi*hyy + sg[Y][Y]);
+    s[Y][Z][iv] = -(2.0*xi*qyz*qh - xi*(qhyz + qhzy) - 2.0*r3*xi*hyz
+		    + sg[Y][Z] + qhyz - qhzy);
+    s[Z][X][iv] = -(2.0*xi*qxz*qh - xi*(qhzx + qhxz) - 2.0*r3*xi*hxz
+		    + sg[Z][X] + qhzx - qhxz);
+    s[Z][Y][iv] = -(2.0*xi*qyz*qh - xi*(qhzy + qhyz) - 2.0*r3*xi*hyz
+		    + sg[Z][Y] + qhzy - qhyz);
+    s[Z][Z][iv] = -(fed[iv] + 2.0*xi*(qzz + r3)*qh - 2.0*xi*qhzz
+		    - 2.0*r3*xi*hzz + sg[Z][Z]);
+  }
 
   return;
 }
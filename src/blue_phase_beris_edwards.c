@@ -31,7 +31,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2009-2018 The University of Edinburgh
+ *  (c) 2009-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -60,8 +60,8 @@
 #include "map_s.h"
 #include "timer.h"
 
-__host__ int beris_edw_update_driver(beris_edw_t * be, field_t * fq,
-				     field_grad_t * fq_grad,
+__host__ int beris_edw_update_driver(beris_edw_t * be, fe_t * fe,
+				     field_t * fq, field_grad_t * fq_grad,
 				     hydro_t * hydro,
 				     map_t * map, noise_t * noise); 
 __host__ int beris_edw_fix_swd(beris_edw_t * be, colloids_info_t * cinfo,
@@ -74,7 +74,7 @@ __host__ int beris_edw_h_driver(beris_edw_t * be, fe_t * fe);
 __global__
 void beris_edw_h_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be, fe_t * fe);
 __global__
-void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
+void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be, fe_t * fe,
 			field_t * fq, field_grad_t * fqgrad,
 			hydro_t * hydro, advflux_t * flux,
 			map_t * map, noise_t * noise);
@@ -89,7 +89,8 @@ struct beris_edw_s {
   lees_edw_t * le;                 /* Lees Edwards */
   advflux_t * flux;                /* Advective fluxes */
   int nall;                        /* Allocated sites */
-  double * h;                      /* Molecular Field */
+  int fused;                       /* Molecular field, flux bcs in update */
+  double * h;                      /* Molecular Field (if not fused) */
 
   beris_edw_t * target;            /* Target memory */
 };
@@ -128,8 +129,6 @@ __host__ int beris_edw_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
   assert(flx);
 
   lees_edw_nsites(le, &obj->nall);
-  obj->h = (double *) calloc(obj->nall*NQAB, sizeof(double));
-  assert(obj->h);
 
   obj->cs = cs;
   obj->le = le;
@@ -145,7 +144,6 @@ __host__ int beris_edw_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
     obj->target = obj;
   }
   else {
-    double * htmp = NULL;
     beris_edw_param_t * tmp;
     lees_edw_t * letarget = NULL;
 
@@ -163,11 +161,10 @@ __host__ int beris_edw_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
 
     tdpAssert(tdpMemcpy(&obj->target->nall, &obj->nall, sizeof(int),
 			tdpMemcpyHostToDevice));
-    tdpAssert(tdpMalloc((void **) &htmp, obj->nall*NQAB*sizeof(double)));
-    tdpAssert(tdpMemcpy(&obj->target->h, &htmp, sizeof(double *),
-			tdpMemcpyHostToDevice));
   }
 
+  beris_edw_fused_set(obj, 1);
+
   *pobj = obj;
 
   return 0;
@@ -188,16 +185,16 @@ __host__ int beris_edw_free(beris_edw_t * be) {
   tdpGetDeviceCount(&ndevice);
 
   if (ndevice > 0) {
-    double * htmp;
+    double * htmp = NULL;
 
     tdpAssert(tdpMemcpy(&htmp, &be->target->h, sizeof(double *),
 			tdpMemcpyDeviceToHost));
-    tdpAssert(tdpFree(htmp));
+    if (htmp) tdpAssert(tdpFree(htmp));
     tdpAssert(tdpFree(be->target));
   }
 
   advflux_free(be->flux);
-  free(be->h);
+  if (be->h) free(be->h);
   free(be->param);
   free(be);
 
@@ -243,6 +240,36 @@ __host__ int beris_edw_param_set(beris_edw_t * be, beris_edw_param_t vals) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  beris_edw_fused_set
+ *
+ *  If fused is set (the default), the molecular field is computed in
+ *  the update kernel, and no-normal-flux boundary conditions are
+ *  applied to the advective fluxes as they are read. Otherwise, the
+ *  molecular field is first stored for all sites, and the boundary
+ *  conditions applied in a separate pass (for reference).
+ *
+ *****************************************************************************/
+
+__host__ int beris_edw_fused_set(beris_edw_t * be, int fused) {
+
+  int ndevice;
+
+  assert(be);
+
+  be->fused = fused;
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    tdpAssert(tdpMemcpy(&be->target->fused, &be->fused, sizeof(int),
+			tdpMemcpyHostToDevice));
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  beris_edw_update
@@ -278,11 +305,11 @@ __host__ int beris_edw_update(beris_edw_t * be,
     beris_edw_fix_swd(be, cinfo, hydro, map);
     hydro_lees_edwards(hydro);
     advection_x(be->flux, hydro, fq);
-    advection_bcs_no_normal_flux(nf, be->flux, map);
+    if (be->fused == 0) advection_bcs_no_normal_flux(nf, be->flux, map);
   }
 
-  beris_edw_h_driver(be, fe);
-  beris_edw_update_driver(be, fq, fq_grad, hydro, map, noise);
+  if (be->fused == 0) beris_edw_h_driver(be, fe);
+  beris_edw_update_driver(be, fe, fq, fq_grad, hydro, map, noise);
 
   return 0;
 }
@@ -487,6 +514,7 @@ __host__ int beris_edw_update_host(beris_edw_t * be, fe_t * fe, field_t * fq,
  *****************************************************************************/
 
 __host__ int beris_edw_update_driver(beris_edw_t * be,
+				     fe_t * fe,
 				     field_t * fq,
 				     field_grad_t * fq_grad,
 				     hydro_t * hydro,
@@ -498,10 +526,12 @@ __host__ int beris_edw_update_driver(beris_edw_t * be,
   kernel_info_t limits;
   kernel_ctxt_t * ctxt = NULL;
 
+  fe_t * fe_target = NULL;
   hydro_t * hydrotarget = NULL;
   noise_t * noisetarget = NULL;
 
   assert(be);
+  assert(fe);
   assert(fq);
   assert(map);
 
@@ -515,6 +545,7 @@ __host__ int beris_edw_update_driver(beris_edw_t * be,
   kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
   beris_edw_param_commit(be);
+  fe->func->target(fe, &fe_target);
   if (hydro) hydrotarget = hydro->target;
 
   ison = 0;
@@ -524,7 +555,7 @@ __host__ int beris_edw_update_driver(beris_edw_t * be,
   TIMER_start(BP_BE_UPDATE_KERNEL);
 
   tdpLaunchKernel(beris_edw_kernel_v, nblk, ntpb, 0, 0,
-		  ctxt->target, be->target, fq->target, fq_grad->target,
+		  ctxt->target, be->target, fe_target, fq->target, fq_grad->target,
 		  hydrotarget, be->flux->target, map->target, noisetarget);
 
   tdpAssert(tdpPeekAtLastError());
@@ -544,12 +575,13 @@ __host__ int beris_edw_update_driver(beris_edw_t * be,
  *****************************************************************************/
 
 __global__
-void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
+void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be, fe_t * fe,
 			field_t * fq, field_grad_t * fqgrad,
 			hydro_t * hydro, advflux_t * flux,
 			map_t * map, noise_t * noise) {
 
   int kindex;
+  int xs, ys, zs;
   __shared__ int kiterations;
 
   const double dt = 1.0;
@@ -564,6 +596,7 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
   assert(map);
 
   kiterations = kernel_vector_iterations(ktx);
+  lees_edw_strides(be->le, &xs, &ys, &zs);
 
   for_simt_parallel(kindex, kiterations, NSIMDVL) {
 
@@ -585,6 +618,13 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
     double trace_qw[NSIMDVL];
     double chi[NQAB], chi_qab[3][3][NSIMDVL];
     double tr[NSIMDVL];
+    double h[NQAB][NSIMDVL];       /* Molecular field */
+    double maske[NSIMDVL];         /* No normal flux masks for fe, ... */
+    double maskw[NSIMDVL];
+    double masky[NSIMDVL];
+    double maskym[NSIMDVL];        /* ... fy at (jc - 1) */
+    double maskz[NSIMDVL];
+    double maskzm[NSIMDVL];        /* ... fz at (kc - 1) */
 
     index = kernel_baseindex(ktx, kindex);
     kernel_coords_v(ktx, kindex, ic, jc, kc);
@@ -757,6 +797,42 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       }
     }
 
+    /* Molecular field, and fluid status of neighbours (fused) */
+
+    if (be->fused) {
+      double h3[3][3][NSIMDVL];
+
+      fe->func->htensor_v(fe, index, h3);
+
+      for_simd_v(iv, NSIMDVL) h[XX][iv] = h3[X][X][iv];
+      for_simd_v(iv, NSIMDVL) h[XY][iv] = h3[X][Y][iv];
+      for_simd_v(iv, NSIMDVL) h[XZ][iv] = h3[X][Z][iv];
+      for_simd_v(iv, NSIMDVL) h[YY][iv] = h3[Y][Y][iv];
+      for_simd_v(iv, NSIMDVL) h[YZ][iv] = h3[Y][Z][iv];
+
+      for_simd_v(iv, NSIMDVL) {
+	maske[iv]  = (map->status[index + iv + xs] == MAP_FLUID);
+	maskw[iv]  = (map->status[index + iv - xs] == MAP_FLUID);
+	masky[iv]  = (map->status[index + iv + ys] == MAP_FLUID);
+	maskym[iv] = (map->status[index + iv - ys] == MAP_FLUID);
+	maskz[iv]  = (map->status[index + iv + zs] == MAP_FLUID);
+	maskzm[iv] = (map->status[index + iv - zs] == MAP_FLUID);
+      }
+    }
+    else {
+      for (id = 0; id < NQAB; id++) {
+	for_simd_v(iv, NSIMDVL) {
+	  h[id][iv] = be->h[addr_rank1(be->nall, NQAB, index+iv, id)];
+	}
+      }
+      for_simd_v(iv, NSIMDVL) maske[iv] = 1.0;
+      for_simd_v(iv, NSIMDVL) maskw[iv] = 1.0;
+      for_simd_v(iv, NSIMDVL) masky[iv] = 1.0;
+      for_simd_v(iv, NSIMDVL) maskym[iv] = 1.0;
+      for_simd_v(iv, NSIMDVL) maskz[iv] = 1.0;
+      for_simd_v(iv, NSIMDVL) maskzm[iv] = 1.0;
+    }
+
     /* Here's the full hydrodynamic update. */
     /* The divergence of advective fluxes involves (jc-1) and (kc-1)
      * which are masked out if not a valid kernel site */
@@ -773,13 +849,13 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[X][X][iv] += dt*
 	(s[X][X][iv]
 	 + chi_qab[X][X][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, XX)]
-	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
-	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
-	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
-	 + flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],XX)]
-	 - flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
-	 + flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],XX)]);
+	 + be->param->gamma*h[XX][iv]
+	 - maske[iv]*flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
+	 + maskw[iv]*flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
+	 - masky[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
+	 + maskym[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],XX)]
+	 - maskz[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
+	 + maskzm[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],XX)]);
       }
     }
 
@@ -788,13 +864,13 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[X][Y][iv] += dt*
 	(s[X][Y][iv]
 	 + chi_qab[X][Y][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, XY)]
-	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
-	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
-	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
-	 + flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],XY)]
-	 - flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
-	 + flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],XY)]);
+	 + be->param->gamma*h[XY][iv]
+	 - maske[iv]*flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
+	 + maskw[iv]*flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
+	 - masky[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
+	 + maskym[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],XY)]
+	 - maskz[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
+	 + maskzm[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],XY)]);
       }
     }
 	
@@ -803,13 +879,13 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[X][Z][iv] += dt*
 	(s[X][Z][iv]
 	 + chi_qab[X][Z][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, XZ)]
-	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
-	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
-	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
-	 + flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],XZ)]
-	 - flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
-	 + flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],XZ)]);
+	 + be->param->gamma*h[XZ][iv]
+	 - maske[iv]*flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
+	 + maskw[iv]*flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
+	 - masky[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
+	 + maskym[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],XZ)]
+	 - maskz[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
+	 + maskzm[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],XZ)]);
       }
     }
 	
@@ -818,13 +894,13 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[Y][Y][iv] += dt*
 	(s[Y][Y][iv]
 	 + chi_qab[Y][Y][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, YY)]
-	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
-	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
-	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
-	 + flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],YY)]
-	 - flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
-	 + flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],YY)]);
+	 + be->param->gamma*h[YY][iv]
+	 - maske[iv]*flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
+	 + maskw[iv]*flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
+	 - masky[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
+	 + maskym[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],YY)]
+	 - maskz[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
+	 + maskzm[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],YY)]);
       }
     }
 	
@@ -833,13 +909,13 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[Y][Z][iv] += dt*
 	(s[Y][Z][iv]
 	 + chi_qab[Y][Z][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, YZ)]
-	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
-	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
-	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
-	 + flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],YZ)]
-	 - flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
-	 + flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],YZ)]);
+	 + be->param->gamma*h[YZ][iv]
+	 - maske[iv]*flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
+	 + maskw[iv]*flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
+	 - masky[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
+	 + maskym[iv]*flux->fy[addr_rank1(flux->nsite,NQAB,indexj[iv],YZ)]
+	 - maskz[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
+	 + maskzm[iv]*flux->fz[addr_rank1(flux->nsite,NQAB,indexk[iv],YZ)]);
       }
     }
 
@@ -925,6 +1001,24 @@ __host__ int beris_edw_h_driver(beris_edw_t * be, fe_t * fe) {
   assert(be);
   assert(fe);
 
+  if (be->h == NULL) {
+    /* Storage for the molecular field at first use */
+    int ndevice;
+    double * htmp = NULL;
+
+    be->h = (double *) calloc(be->nall*NQAB, sizeof(double));
+    assert(be->h);
+    if (be->h == NULL) pe_fatal(be->flux->pe, "calloc(be->h) failed\n");
+
+    tdpGetDeviceCount(&ndevice);
+
+    if (ndevice > 0) {
+      tdpAssert(tdpMalloc((void **) &htmp, be->nall*NQAB*sizeof(double)));
+      tdpAssert(tdpMemcpy(&be->target->h, &htmp, sizeof(double *),
+			  tdpMemcpyHostToDevice));
+    }
+  }
+
   cs_nlocal(be->cs, nlocal);
 
   limits.imin = 1; limits.imax = nlocal[X];
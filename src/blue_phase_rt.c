@@ -9,7 +9,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2009-2018 The University of Edinburgh
+ *  (c) 2009-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -322,6 +322,13 @@ __host__ int blue_phase_init_rt(pe_t * pe, rt_t *rt,
     pe_info(pe, "Rotational diffusion const = %14.7e\n", gamma);
   }
 
+  /* Fused update is the default; the reference is for validation */
+
+  n = 1;
+  rt_int_parameter(rt, "lc_beris_edwards_fused", &n);
+  beris_edw_fused_set(be, n);
+  if (n == 0) pe_info(pe, "Reference (not fused) update selected\n");
+
   return 0;
 }
 
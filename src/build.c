@@ -30,6 +30,7 @@
 #include "util.h"
 #include "wall.h"
 #include "build.h"
+#include "colloids_s.h"
 #include "blue_phase.h"
 
 
@@ -51,6 +52,28 @@ static int build_reset_links(cs_t * cs, colloid_t * pc, map_t * map);
 static int build_reconstruct_links(cs_t * cs, colloids_info_t * cinfo,
 				   colloid_t * pc, map_t * map);
 static void build_link_mean(colloid_t * pc, int p, const double rb[3]);
+static int build_update_map_incremental(cs_t * cs, colloids_info_t * cinfo,
+					map_t * map);
+static int build_map_stamp_all(cs_t * cs, colloids_info_t * cinfo,
+			       map_t * map, int restamp);
+static int build_map_box(cs_t * cs, colloid_t * pc, double r0[3],
+			 int box[6]);
+static int build_map_stamp(cs_t * cs, colloids_info_t * cinfo, map_t * map,
+			   colloid_t * pc, int i, int record);
+static int build_map_footprint(cs_t * cs, colloid_t * pc);
+static int build_remove_replace_site(fe_t * fe, colloids_info_t * cinfo,
+				     lb_t * lb, field_t * phi, field_t * p,
+				     field_t * q, psi_t * psi, map_t * map,
+				     int index, int is_halo);
+static int build_remove_replace_sites(fe_t * fe, colloids_info_t * cinfo,
+				      lb_t * lb, field_t * phi, field_t * p,
+				      field_t * q, psi_t * psi, map_t * map,
+				      int nsite, const int * site);
+static int build_index_compare(const void * a, const void * b);
+static int build_link_table(colloids_info_t * cinfo);
+static int build_site_changed(colloids_info_t * cinfo, int index);
+static int build_random_unit_vector(colloids_info_t * info, colloid_t * pc,
+				    int index, double rhat[3]);
 static int build_colloid_wall_links(cs_t * cs, colloids_info_t * cinfo,
 				    colloid_t * pc,
 				    map_t * map);
@@ -66,49 +89,45 @@ int build_conservation_psi(colloids_info_t * cinfo, psi_t * psi);
  *  of all nodes in the presence on colloids. This must be complete
  *  before attempting to build the colloid links.
  *
+ *  If an incremental update has been requested, and the map is
+ *  consistent with the recorded footprints, only those particles
+ *  whose footprint may have changed are removed and replaced.
+ *
  ****************************************************************************/
 
 int build_update_map(cs_t * cs, colloids_info_t * cinfo, map_t * map) {
 
   int nlocal[3];
-  int noffset[3];
-  int ncell[3];
   int ic, jc, kc;
 
-  int i, j, k;
-  int i_min, i_max, j_min, j_max, k_min, k_max;
   int index;
   int nhalo;
   int status;
 
-  colloid_t * p_colloid = NULL;
-
-  double  r0[3];
-  double  rsite0[3];
-  double  rsep[3];
-
-  double   radius, rsq;
-  double   cosine, mod;
-
   /* To set the wetting data in the map, we assume C, H zero at moment */
   int ndata;
-  double wet[2];
+  double wet[2] = {0.0, 0.0};
 
   assert(cs);
   assert(cinfo);
   assert(map);
 
+  if (cinfo->map_incremental && cinfo->map_valid) {
+    return build_update_map_incremental(cs, cinfo, map);
+  }
+
   map_ndata(map, &ndata);
   assert(ndata <= 2);
 
   cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
   cs_nhalo(cs, &nhalo);
 
-  colloids_info_ncell(cinfo, ncell);
+  /* All sites are potentially changed */
+  cinfo->nmodified = -1;
 
   /* First, set any existing colloid sites to fluid */
 
+  tdp_host_omp(parallel for private(jc, kc, index, status))
   for (ic = 1 - nhalo; ic <= nlocal[X] + nhalo; ic++) {
     for (jc = 1 - nhalo; jc <= nlocal[Y] + nhalo; jc++) {
       for (kc = 1 - nhalo; kc <= nlocal[Z] + nhalo; kc++) {
@@ -119,8 +138,6 @@ int build_update_map(cs_t * cs, colloids_info_t * cinfo, map_t * map) {
 	if (status == MAP_COLLOID) {
 	  /* Set wetting properties to zero. */
 	  map_status_set(map, index, MAP_FLUID);
-	  wet[0] = 0.0;
-	  wet[1] = 0.0;
 	  map_data_set(map, index, wet);
 	}
 
@@ -130,96 +147,346 @@ int build_update_map(cs_t * cs, colloids_info_t * cinfo, map_t * map) {
 
   colloids_info_map_update(cinfo);
 
-  /* Loop through all cells (including the halo cells) */
+  /* All colloids (including halo) */
+
+  build_map_stamp_all(cs, cinfo, map, 0);
+
+  cinfo->map_valid = cinfo->map_incremental;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_update_map_incremental
+ *
+ *  The old map is first brought up-to-date with the current map
+ *  (only sites changed at the last update differ). Any particle which
+ *  has moved more than its margin since its footprint was recorded,
+ *  or is new, is then removed from the map and re-stamped.
+ *
+ *  Janus particles have wetting data which depend on orientation,
+ *  so are always re-stamped.
+ *
+ *  Distinct particles own distinct sites in the map, so removal
+ *  may be shared between threads.
+ *
+ *****************************************************************************/
+
+static int build_update_map_incremental(cs_t * cs, colloids_info_t * cinfo,
+					map_t * map) {
+  int noffset[3];
+  int n, nall, index;
+  int changed;
+  double dr[3];
+  double wet[2] = {0.0, 0.0};
+  colloid_t * pc = NULL;
+  colloid_t ** handles = NULL;
+
+  assert(cs);
+  assert(cinfo);
+  assert(map);
+  assert(cinfo->map_valid);
+
+  cs_nlocal_offset(cs, noffset);
+
+  if (cinfo->nmodified < 0) {
+    for (index = 0; index < cinfo->nsites; index++) {
+      cinfo->map_old[index] = cinfo->map_new[index];
+    }
+  }
+  else {
+    for (n = 0; n < cinfo->nmodified; n++) {
+      index = cinfo->modified[n];
+      cinfo->map_old[index] = cinfo->map_new[index];
+    }
+  }
+
+  cinfo->nmodified = 0;
+
+  /* Remove changed footprints */
+
+  colloids_info_all_handles(cinfo, &nall, &handles);
+
+  tdp_host_omp(parallel for private(pc, dr, changed, index) schedule(dynamic))
+  for (n = 0; n < nall; n++) {
+
+    pc = handles[n];
+    if (pc->fpset == 0) continue;
+
+    dr[X] = pc->s.r[X] - 1.0*noffset[X] - pc->fpr[X];
+    dr[Y] = pc->s.r[Y] - 1.0*noffset[Y] - pc->fpr[Y];
+    dr[Z] = pc->s.r[Z] - 1.0*noffset[Z] - pc->fpr[Z];
+
+    changed = (pc->s.type == COLLOID_TYPE_JANUS);
+    changed += (pc->s.a0 != pc->fpa0);
+    changed += (modulus(dr) >= pc->fpmargin);
+
+    if (changed == 0) continue;
+
+    {
+      int i, j, k;
+
+      for (i = pc->fpbox[0]; i <= pc->fpbox[1]; i++) {
+	for (j = pc->fpbox[2]; j <= pc->fpbox[3]; j++) {
+	  for (k = pc->fpbox[4]; k <= pc->fpbox[5]; k++) {
+	    index = cs_index(cs, i, j, k);
+	    if (cinfo->map_new[index] != pc) continue;
+	    colloids_info_map_set(cinfo, index, NULL);
+	    map_status_set(map, index, MAP_FLUID);
+	    map_data_set(map, index, wet);
+	    tdp_host_omp(critical (build_map_modified))
+	    colloids_info_map_modified(cinfo, index);
+	  }
+	}
+      }
+    }
+
+    pc->fpset = 0;
+  }
+
+  /* Stamp new and changed footprints */
+
+  build_map_stamp_all(cs, cinfo, map, 1);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_map_stamp_all
+ *
+ *  Stamp all colloids (or, if restamp is set, only those without a
+ *  current footprint) into the map.
+ *
+ *  Each thread takes whole planes of sites, and within a plane visits
+ *  the colloids in the serial (cell list) order. Each site therefore
+ *  sees the same sequence of writes as in serial, even where images
+ *  of the same particle overlap. The footprints are then recorded
+ *  per colloid.
+ *
+ *****************************************************************************/
+
+static int build_map_stamp_all(cs_t * cs, colloids_info_t * cinfo,
+			       map_t * map, int restamp) {
+  int nlocal[3];
+  int nhalo;
+  int ic, n, nall;
+  int record;
+  colloid_t * pc = NULL;
+  colloid_t ** handles = NULL;
+
+  assert(cs);
+  assert(cinfo);
+  assert(map);
+
+  cs_nlocal(cs, nlocal);
+  cs_nhalo(cs, &nhalo);
+  record = (cinfo->nmodified >= 0);
+
+  colloids_info_all_handles(cinfo, &nall, &handles);
+
+  tdp_host_omp(parallel for private(n, pc) schedule(dynamic))
+  for (ic = 1 - nhalo; ic <= nlocal[X] + nhalo; ic++) {
+    for (n = 0; n < nall; n++) {
+      pc = handles[n];
+      if (restamp && pc->fpset) continue;
+      build_map_stamp(cs, cinfo, map, pc, ic, record);
+    }
+  }
+
+  if (cinfo->map_incremental) {
+    tdp_host_omp(parallel for private(pc) schedule(dynamic))
+    for (n = 0; n < nall; n++) {
+      pc = handles[n];
+      if (restamp && pc->fpset) continue;
+      build_map_footprint(cs, pc);
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_map_box
+ *
+ *  The box of sites (in local coordinates, including halo) which
+ *  must be examined to find those inside the colloid. Sites outside
+ *  the box are at least a distance a0 + 1 from the centre.
+ *
+ *****************************************************************************/
+
+static int build_map_box(cs_t * cs, colloid_t * pc, double r0[3],
+			 int box[6]) {
+  int nlocal[3];
+  int noffset[3];
+  int nhalo;
+  double radius;
+
+  assert(cs);
+  assert(pc);
 
-  for (ic = 0; ic <= ncell[X] + 1; ic++) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+  cs_nhalo(cs, &nhalo);
 
-	/* Set the cell index */
+  radius = pc->s.a0;
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
+  /* Need to translate the colloid position to "local"
+   * coordinates, so that the correct range of lattice
+   * nodes is found */
 
-	/* For each colloid in this cell, check solid/fluid status */
+  r0[X] = pc->s.r[X] - 1.0*noffset[X];
+  r0[Y] = pc->s.r[Y] - 1.0*noffset[Y];
+  r0[Z] = pc->s.r[Z] - 1.0*noffset[Z];
 
-	while (p_colloid != NULL) {
+  /* Compute appropriate range of sites that require checks, i.e.,
+   * a cubic box around the centre of the colloid. However, this
+   * should not extend beyond the boundary of the current domain
+   * (but include halos). */
 
-	  /* Set actual position and radius */
+  box[0] = imax(1 - nhalo,         (int) floor(r0[X] - radius));
+  box[1] = imin(nlocal[X] + nhalo, (int) ceil (r0[X] + radius));
+  box[2] = imax(1 - nhalo,         (int) floor(r0[Y] - radius));
+  box[3] = imin(nlocal[Y] + nhalo, (int) ceil (r0[Y] + radius));
+  box[4] = imax(1 - nhalo,         (int) floor(r0[Z] - radius));
+  box[5] = imin(nlocal[Z] + nhalo, (int) ceil (r0[Z] + radius));
 
-	  radius = p_colloid->s.a0;
-	  rsq    = radius*radius;
+  return 0;
+}
 
-	  /* Need to translate the colloid position to "local"
-	   * coordinates, so that the correct range of lattice
-	   * nodes is found */
+/*****************************************************************************
+ *
+ *  build_map_stamp
+ *
+ *  Set the map for all sites in plane i inside colloid p_colloid.
+ *  If record is set, the sites are added to the modified list.
+ *
+ *****************************************************************************/
 
-	  r0[X] = p_colloid->s.r[X] - 1.0*noffset[X];
-	  r0[Y] = p_colloid->s.r[Y] - 1.0*noffset[Y];
-	  r0[Z] = p_colloid->s.r[Z] - 1.0*noffset[Z];
+static int build_map_stamp(cs_t * cs, colloids_info_t * cinfo, map_t * map,
+			   colloid_t * p_colloid, int i, int record) {
+  int j, k;
+  int box[6];
+  int index;
 
-	  /* Compute appropriate range of sites that require checks, i.e.,
-	   * a cubic box around the centre of the colloid. However, this
-	   * should not extend beyond the boundary of the current domain
-	   * (but include halos). */
+  double  r0[3];
+  double  rsite0[3];
+  double  rsep[3];
 
-	  i_min = imax(1 - nhalo,         (int) floor(r0[X] - radius));
-	  i_max = imin(nlocal[X] + nhalo, (int) ceil (r0[X] + radius));
-	  j_min = imax(1 - nhalo,         (int) floor(r0[Y] - radius));
-	  j_max = imin(nlocal[Y] + nhalo, (int) ceil (r0[Y] + radius));
-	  k_min = imax(1 - nhalo,         (int) floor(r0[Z] - radius));
-	  k_max = imin(nlocal[Z] + nhalo, (int) ceil (r0[Z] + radius));
+  double   rsq;
+  double   cosine, mod;
+  double wet[2];
 
-	  /* Check each site to see whether it is inside or not */
+  assert(cs);
+  assert(cinfo);
+  assert(map);
+  assert(p_colloid);
 
-	  for (i = i_min; i <= i_max; i++)
-	    for (j = j_min; j <= j_max; j++)
-	      for (k = k_min; k <= k_max; k++) {
+  build_map_box(cs, p_colloid, r0, box);
+  if (i < box[0] || i > box[1]) return 0;
 
-		/* rsite0 is the coordinate position of the site */
+  rsq = p_colloid->s.a0*p_colloid->s.a0;
 
-		rsite0[X] = 1.0*i;
-		rsite0[Y] = 1.0*j;
-		rsite0[Z] = 1.0*k;
-		cs_minimum_distance(cs, rsite0, r0, rsep);
+  /* Check each site to see whether it is inside or not */
 
-		/* Are we inside? */
+  for (j = box[2]; j <= box[3]; j++) {
+    for (k = box[4]; k <= box[5]; k++) {
 
-		if (dot_product(rsep, rsep) < rsq) {
+      /* rsite0 is the coordinate position of the site */
 
-		  /* Set index */
-		  index = cs_index(cs, i, j, k);
+      rsite0[X] = 1.0*i;
+      rsite0[Y] = 1.0*j;
+      rsite0[Z] = 1.0*k;
+      cs_minimum_distance(cs, rsite0, r0, rsep);
 
-		  colloids_info_map_set(cinfo, index, p_colloid);
-		  map_status_set(map, index, MAP_COLLOID);
+      /* Are we inside? */
 
-		  /* Janus particles have h = h_0 cos (theta)
-		   * with s[3] pointing to the 'north pole' */
+      if (dot_product(rsep, rsep) < rsq) {
 
-		  cosine = 1.0;
-		  if (p_colloid->s.type == COLLOID_TYPE_JANUS) {
-		    mod = modulus(rsep);
-		    if (mod > 0.0) {
-		      cosine = dot_product(p_colloid->s.s, rsep)/mod;
-		    }
-		  }
+	/* Set index */
+	index = cs_index(cs, i, j, k);
 
-		  wet[0] = p_colloid->s.c;
-		  wet[1] = cosine*p_colloid->s.h;
+	colloids_info_map_set(cinfo, index, p_colloid);
+	map_status_set(map, index, MAP_COLLOID);
+	if (record) {
+	  tdp_host_omp(critical (build_map_modified))
+	  colloids_info_map_modified(cinfo, index);
+	}
 
-		  map_data_set(map, index, wet);
-		}
-		/* Next site */
-	      }
+	/* Janus particles have h = h_0 cos (theta)
+	 * with s[3] pointing to the 'north pole' */
 
-	  /* Next colloid */
-	  p_colloid = p_colloid->next;
+	cosine = 1.0;
+	if (p_colloid->s.type == COLLOID_TYPE_JANUS) {
+	  mod = modulus(rsep);
+	  if (mod > 0.0) {
+	    cosine = dot_product(p_colloid->s.s, rsep)/mod;
+	  }
 	}
 
-	/* Next cell */
+	wet[0] = p_colloid->s.c;
+	wet[1] = cosine*p_colloid->s.h;
+
+	map_data_set(map, index, wet);
+      }
+      /* Next site */
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_map_footprint
+ *
+ *  Record the footprint for an incremental update, i.e., the box of
+ *  sites examined and the distance the particle may move before any
+ *  site changes from inside to outside or vice-versa.
+ *
+ *  Sites outside the box are at least a distance a0 + 1 from the
+ *  centre, so the margin is at most 1.
+ *
+ *****************************************************************************/
+
+static int build_map_footprint(cs_t * cs, colloid_t * p_colloid) {
+
+  int i, j, k;
+  int box[6];
+  double r0[3];
+  double rsite0[3];
+  double rsep[3];
+  double margin = 1.0;
+
+  assert(cs);
+  assert(p_colloid);
+
+  build_map_box(cs, p_colloid, r0, box);
+
+  for (i = box[0]; i <= box[1]; i++) {
+    for (j = box[2]; j <= box[3]; j++) {
+      for (k = box[4]; k <= box[5]; k++) {
+	rsite0[X] = 1.0*i;
+	rsite0[Y] = 1.0*j;
+	rsite0[Z] = 1.0*k;
+	cs_minimum_distance(cs, rsite0, r0, rsep);
+	margin = dmin(margin, fabs(modulus(rsep) - p_colloid->s.a0));
       }
     }
   }
 
+  p_colloid->fpset = 1;
+  for (i = 0; i < 6; i++) {
+    p_colloid->fpbox[i] = box[i];
+  }
+  p_colloid->fpr[X] = r0[X];
+  p_colloid->fpr[Y] = r0[Y];
+  p_colloid->fpr[Z] = r0[Z];
+  p_colloid->fpa0 = p_colloid->s.a0;
+  p_colloid->fpmargin = margin;
+
   return 0;
 }
 
@@ -235,52 +502,87 @@ int build_update_links(cs_t * cs, colloids_info_t * cinfo, wall_t * wall,
 		       map_t * map) {
 
   int ia;
-  int ic, jc, kc;
-  int ncell[3];
-  int nhalo;
-  colloid_t * pc;
+  int n, nall;
+  colloid_t * pc = NULL;
+  colloid_t ** handles = NULL;
 
   assert(cs);
   assert(cinfo);
   assert(map);
 
-  colloids_info_ncell(cinfo, ncell);
-  colloids_info_nhalo(cinfo, &nhalo);
+  /* Each colloid has its own links, so colloids may be shared
+   * between threads */
 
-  for (ic = 1 - nhalo; ic <= ncell[X] + nhalo; ic++) {
-    for (jc = 1 - nhalo; jc <= ncell[Y] + nhalo; jc++) {
-      for (kc = 1 - nhalo; kc <= ncell[Z] + nhalo; kc++) {
+  colloids_info_all_handles(cinfo, &nall, &handles);
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+  tdp_host_omp(parallel for private(ia, pc) schedule(dynamic))
+  for (n = 0; n < nall; n++) {
 
-	while (pc) {
+    pc = handles[n];
 
-	  pc->sumw   = 0.0;
-	  for (ia = 0; ia < 3; ia++) {
-	    pc->cbar[ia] = 0.0;
-	    pc->rxcbar[ia] = 0.0;
-	  }
+    pc->sumw   = 0.0;
+    for (ia = 0; ia < 3; ia++) {
+      pc->cbar[ia] = 0.0;
+      pc->rxcbar[ia] = 0.0;
+    }
 
-	  if (pc->s.rebuild) {
-	    /* The shape has changed, so need to reconstruct */
-	    build_reconstruct_links(cs, cinfo, pc, map);
-	    if (wall) build_colloid_wall_links(cs, cinfo, pc, map);
-	  }
-	  else {
-	    /* Shape unchanged, so just reset existing links */
-	    build_reset_links(cs, pc, map);
-	  }
+    if (pc->s.rebuild) {
+      /* The shape has changed, so need to reconstruct */
+      build_reconstruct_links(cs, cinfo, pc, map);
+      if (wall) build_colloid_wall_links(cs, cinfo, pc, map);
+    }
+    else {
+      /* Shape unchanged, so just reset existing links */
+      build_reset_links(cs, pc, map);
+    }
 
-	  build_count_faces_local(pc, &pc->s.sa, &pc->s.saf);
+    build_count_faces_local(pc, &pc->s.sa, &pc->s.saf);
 
-	  /* Next colloid */
+    pc->s.rebuild = 0;
+  }
 
-	  pc->s.rebuild = 0;
-	  pc = pc->next;
-	}
+  build_link_table(cinfo);
 
-	/* Next cell */
-      }
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_link_table
+ *
+ *  Copy the links of all colloids (including halo) in the order of
+ *  the 'all' list to the flat link table, which is then used by
+ *  the bounce-back until the links are next updated.
+ *
+ *  The end points of the links are the only sites at which the
+ *  bounce-back reads or writes the distributions.
+ *
+ *****************************************************************************/
+
+static int build_link_table(colloids_info_t * cinfo) {
+
+  int n;
+  int ifail = 0;
+  colloid_t * pc = NULL;
+  colloid_link_table_t * lt = NULL;
+
+  assert(cinfo);
+
+  lt = cinfo->ltable;
+  colloid_link_table_reset(lt);
+  colloids_info_all_head(cinfo, &pc);
+
+  for ( ; pc; pc = pc->nextall) {
+    ifail += colloid_link_table_add(lt, pc->lnk);
+  }
+
+  if (ifail) pe_fatal(cinfo->pe, "build_link_table() failed\n");
+
+  if (cinfo->lsites) {
+    site_sync_reset(cinfo->lsites);
+    for (n = 0; n < lt->nlink; n++) {
+      site_sync_add(cinfo->lsites, lt->i[n]);
+      site_sync_add(cinfo->lsites, lt->j[n]);
     }
   }
 
@@ -564,11 +866,12 @@ int build_remove_replace(fe_t * fe, colloids_info_t * cinfo, lb_t * lb,
 			 field_t * p, field_t * q, psi_t * psi, map_t * map) {
 
   int ic, jc, kc, index;
-  int is_halo;
   int nlocal[3];
   int nhalo;
-  colloid_t * pcold;
-  colloid_t * pcnew;
+  int n, nsite;
+  int nplane;
+  int * offset = NULL;
+  int * site = NULL;
 
   assert(lb);
   assert(cinfo);
@@ -576,49 +879,225 @@ int build_remove_replace(fe_t * fe, colloids_info_t * cinfo, lb_t * lb,
   cs_nlocal(lb->cs, nlocal);
   cs_nhalo(lb->cs, &nhalo);
 
+  if (cinfo->nmodified >= 0) {
+
+    /* Incremental: changed sites only, in the same (index) order
+     * as the full sweep below, and once each. */
+
+    qsort(cinfo->modified, cinfo->nmodified, sizeof(int),
+	  build_index_compare);
+
+    nsite = 0;
+    for (n = 0; n < cinfo->nmodified; n++) {
+      if (n > 0 && cinfo->modified[n] == cinfo->modified[n-1]) continue;
+      cinfo->modified[nsite++] = cinfo->modified[n];
+    }
+    cinfo->nmodified = nsite;
+
+    build_remove_replace_sites(fe, cinfo, lb, phi, p, q, psi, map,
+			       nsite, cinfo->modified);
+
+    return 0;
+  }
+
+  /* Full sweep. Finding the changed sites is shared between threads
+   * by plane; the changes are then made in index order, as in the
+   * incremental case. */
+
+  nplane = nlocal[X] + 2*nhalo;
+  offset = (int *) calloc(nplane + 1, sizeof(int));
+  assert(offset);
+  if (offset == NULL) pe_fatal(lb->pe, "calloc(offset) failed\n");
+
+  tdp_host_omp(parallel for private(jc, kc, index))
   for (ic = 1 - nhalo; ic <= nlocal[X] + nhalo; ic++) {
     for (jc = 1 - nhalo; jc <= nlocal[Y] + nhalo; jc++) {
       for (kc = 1 - nhalo; kc <= nlocal[Z] + nhalo; kc++) {
+	index = cs_index(lb->cs, ic, jc, kc);
+	if (build_site_changed(cinfo, index)) offset[ic + nhalo] += 1;
+      }
+    }
+  }
+
+  for (n = 0; n < nplane; n++) {
+    offset[n + 1] += offset[n];
+  }
 
+  site = (int *) malloc(imax(1, offset[nplane])*sizeof(int));
+  assert(site);
+  if (site == NULL) pe_fatal(lb->pe, "malloc(site) failed\n");
+
+  tdp_host_omp(parallel for private(jc, kc, index, nsite))
+  for (ic = 1 - nhalo; ic <= nlocal[X] + nhalo; ic++) {
+    nsite = offset[ic + nhalo - 1];
+    for (jc = 1 - nhalo; jc <= nlocal[Y] + nhalo; jc++) {
+      for (kc = 1 - nhalo; kc <= nlocal[Z] + nhalo; kc++) {
 	index = cs_index(lb->cs, ic, jc, kc);
+	if (build_site_changed(cinfo, index)) site[nsite++] = index;
+      }
+    }
+  }
 
-	colloids_info_map_old(cinfo, index, &pcold);
-	colloids_info_map(cinfo, index, &pcnew);
+  build_remove_replace_sites(fe, cinfo, lb, phi, p, q, psi, map,
+			     offset[nplane], site);
 
-	is_halo = (ic < 1 || jc < 1 || kc < 1 ||
-		   ic > nlocal[X] || jc > nlocal[Y] || kc > nlocal[Z]);
+  free(site);
+  free(offset);
 
-	if (pcold == NULL && pcnew != NULL) {
+  return 0;
+}
 
-	  pcnew->s.rebuild = 1;
+/*****************************************************************************
+ *
+ *  build_remove_replace_sites
+ *
+ *  Act on the changed sites site[nsite] in order.
+ *
+ *  The distributions and order parameters are resident on the target:
+ *  only the changed (non-halo) sites and their neighbours are read on
+ *  the host, and only the changed sites are recorded for return to
+ *  the target (lb_sync() etc.). All the changed sites, including
+ *  halo sites, are recorded in cinfo->changed for the map.
+ *
+ *****************************************************************************/
 
-	  if (!is_halo) {
-	    build_remove_fluid(lb, index, pcnew);
-	    if (phi) build_remove_order_parameter(lb, phi, index, pcnew);
-	    if (psi)  psi_colloid_remove_charge(psi, pcnew, index);
-	  }
-	}
+static int build_remove_replace_sites(fe_t * fe, colloids_info_t * cinfo,
+				      lb_t * lb, field_t * phi, field_t * p,
+				      field_t * q, psi_t * psi, map_t * map,
+				      int nsite, const int * site) {
+  int n, iv;
+  int is_halo;
+  int nlocal[3];
+  int coords[3];
 
-	if (pcold != NULL && pcnew == NULL) {
+  assert(cinfo);
+  assert(lb);
+  assert(site);
 
-	  pcold->s.rebuild = 1;
+  cs_nlocal(lb->cs, nlocal);
 
-	  if (!is_halo) {
-	    build_replace_fluid(lb, cinfo, index, pcold, map);
-	    if (phi) build_replace_order_parameter(fe, lb, cinfo, phi, index, pcold, map);
-	    if (p) build_replace_order_parameter(fe, lb, cinfo, p, index, pcold, map);
-	    if (q) build_replace_order_parameter(fe, lb, cinfo, q, index, pcold, map);
-	    if (psi) psi_colloid_replace_charge(psi, cinfo, pcold, index);
-	  }
-	}
+  site_sync_reset(cinfo->changed);
+  site_sync_reset(cinfo->fetch);
+
+  for (n = 0; n < nsite; n++) {
+    site_sync_add(cinfo->changed, site[n]);
+    cs_index_to_ijk(lb->cs, site[n], coords);
+    is_halo = (coords[X] < 1 || coords[Y] < 1 || coords[Z] < 1 ||
+	       coords[X] > nlocal[X] || coords[Y] > nlocal[Y] ||
+	       coords[Z] > nlocal[Z]);
+    if (is_halo) continue;
+    for (iv = 0; iv < NVEL; iv++) {
+      site_sync_add(cinfo->fetch, cs_index(lb->cs, coords[X] + cv[iv][X],
+					   coords[Y] + cv[iv][Y],
+					   coords[Z] + cv[iv][Z]));
+    }
+  }
 
-      }
+  lb_memcpy_sites(lb, cinfo->fetch, tdpMemcpyDeviceToHost);
+  if (phi) field_memcpy_sites(phi, cinfo->fetch, tdpMemcpyDeviceToHost);
+  if (p) field_memcpy_sites(p, cinfo->fetch, tdpMemcpyDeviceToHost);
+  if (q) field_memcpy_sites(q, cinfo->fetch, tdpMemcpyDeviceToHost);
+
+  for (n = 0; n < nsite; n++) {
+    cs_index_to_ijk(lb->cs, site[n], coords);
+    is_halo = (coords[X] < 1 || coords[Y] < 1 || coords[Z] < 1 ||
+	       coords[X] > nlocal[X] || coords[Y] > nlocal[Y] ||
+	       coords[Z] > nlocal[Z]);
+    build_remove_replace_site(fe, cinfo, lb, phi, p, q, psi, map, site[n],
+			      is_halo);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_site_changed
+ *
+ *  Return 1 if the site has changed from fluid to solid, or solid
+ *  to fluid, since the last map update.
+ *
+ *****************************************************************************/
+
+static int build_site_changed(colloids_info_t * cinfo, int index) {
+
+  colloid_t * pcold = NULL;
+  colloid_t * pcnew = NULL;
+
+  assert(cinfo);
+
+  colloids_info_map_old(cinfo, index, &pcold);
+  colloids_info_map(cinfo, index, &pcnew);
+
+  return ((pcold == NULL) != (pcnew == NULL));
+}
+
+/*****************************************************************************
+ *
+ *  build_remove_replace_site
+ *
+ *  Act on any change in the map at one site.
+ *
+ *****************************************************************************/
+
+static int build_remove_replace_site(fe_t * fe, colloids_info_t * cinfo,
+				     lb_t * lb, field_t * phi, field_t * p,
+				     field_t * q, psi_t * psi, map_t * map,
+				     int index, int is_halo) {
+  colloid_t * pcold;
+  colloid_t * pcnew;
+
+  colloids_info_map_old(cinfo, index, &pcold);
+  colloids_info_map(cinfo, index, &pcnew);
+
+  if (pcold == NULL && pcnew != NULL) {
+
+    pcnew->s.rebuild = 1;
+
+    if (!is_halo) {
+      build_remove_fluid(lb, index, pcnew);
+      if (phi) build_remove_order_parameter(lb, phi, index, pcnew);
+      if (psi)  psi_colloid_remove_charge(psi, pcnew, index);
+    }
+  }
+
+  if (pcold != NULL && pcnew == NULL) {
+
+    pcold->s.rebuild = 1;
+
+    if (!is_halo) {
+      build_replace_fluid(lb, cinfo, index, pcold, map);
+      if (phi) build_replace_order_parameter(fe, lb, cinfo, phi, index, pcold, map);
+      if (p) build_replace_order_parameter(fe, lb, cinfo, p, index, pcold, map);
+      if (q) build_replace_order_parameter(fe, lb, cinfo, q, index, pcold, map);
+      if (psi) psi_colloid_replace_charge(psi, cinfo, pcold, index);
+
+      lb_sync_site(lb, index);
+      if (phi) field_sync_site(phi, index);
+      if (p) field_sync_site(p, index);
+      if (q) field_sync_site(q, index);
     }
   }
 
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  build_index_compare
+ *
+ *  For qsort() of site indices.
+ *
+ *****************************************************************************/
+
+static int build_index_compare(const void * a, const void * b) {
+
+  int ia = *((const int *) a);
+  int ib = *((const int *) b);
+
+  return (ia > ib) - (ia < ib);
+}
+
 /*****************************************************************************
  *
  *  build_bbl_rebuild_flag
@@ -1135,6 +1614,58 @@ static int build_replace_order_parameter(fe_t * fe, lb_t * lb,
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  build_random_unit_vector
+ *
+ *  A random unit vector for colloid pc at lattice site index. The
+ *  value depends on the colloid, the global position of the site,
+ *  and the time step, so is the same on any process (including for
+ *  halo sites) and in any order of evaluation.
+ *
+ *****************************************************************************/
+
+static int build_random_unit_vector(colloids_info_t * info, colloid_t * pc,
+				    int index, double rhat[3]) {
+  int ia;
+  int step;
+  int coords[3], noffset[3], ntotal[3];
+  unsigned int isite;
+  double u[4];
+  double cost, sint;
+  physics_t * phys = NULL;
+  PI_DOUBLE(pi);
+
+  assert(info);
+  assert(pc);
+
+  physics_ref(&phys);
+  step = physics_control_timestep(phys);
+
+  cs_index_to_ijk(info->cs, index, coords);
+  cs_nlocal_offset(info->cs, noffset);
+  cs_ntotal(info->cs, ntotal);
+
+  for (ia = 0; ia < 3; ia++) {
+    coords[ia] = (noffset[ia] + coords[ia] - 1 + ntotal[ia]) % ntotal[ia];
+  }
+
+  isite = ((unsigned int) coords[X]*ntotal[Y] + coords[Y])*ntotal[Z]
+    + coords[Z];
+
+  colloids_info_rng_uniform(info, COLLOID_RNG_ANCHORING, pc->s.index,
+			    (int) isite, step, u);
+
+  cost = 1.0 - 2.0*u[0];
+  sint = sqrt(1.0 - cost*cost);
+
+  rhat[X] = sint*cos(2.0*pi*u[1]);
+  rhat[Y] = sint*sin(2.0*pi*u[1]);
+  rhat[Z] = cost;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  build_replace_q_local
@@ -1179,7 +1710,7 @@ int build_replace_q_local(fe_t * fe, colloids_info_t * info, colloid_t * pc,
 
   if (lc_param->anchoring_coll == LC_ANCHORING_PLANAR) {
 
-    util_random_unit_vector(&pc->s.rng, rhat);
+    build_random_unit_vector(info, pc, index, rhat);
 
     rhat_dot_rb = dot_product(rhat,rb); 
     rbp[0] = rhat[0] - rhat_dot_rb*rb[0];
@@ -1584,6 +2115,20 @@ int build_conservation_phi(colloids_info_t * cinfo, field_t * phi) {
   assert(cinfo);
   assert(phi);
 
+  /* Only the fluid link sites are required on the host */
+
+  site_sync_reset(cinfo->fetch);
+  colloids_info_all_head(cinfo, &colloid);
+
+  for (; colloid != NULL; colloid = colloid->nextall) {
+    if (colloid->s.deltaphi == 0.0) continue;
+    for (pl = colloid->lnk; pl != NULL; pl = pl->next) {
+      if (pl->status == LINK_FLUID) site_sync_add(cinfo->fetch, pl->i);
+    }
+  }
+
+  field_memcpy_sites(phi, cinfo->fetch, tdpMemcpyDeviceToHost);
+
   colloids_info_all_head(cinfo, &colloid);
 
   for (; colloid != NULL; colloid = colloid->nextall) {
@@ -1605,6 +2150,7 @@ int build_conservation_phi(colloids_info_t * cinfo, field_t * phi) {
 	/* Replace */
 	field_scalar(phi, pl->i, &value);
 	field_scalar_set(phi, pl->i, value + dphi);
+	field_sync_site(phi, pl->i);
       }
     }
 
@@ -36,24 +36,33 @@
 #include "free_energy.h"
 #include "control.h"
 #include "collision.h"
+#include "propagation.h"
 #include "field_s.h"
 #include "map_s.h"
 #include "kernel.h"
 #include "timer.h"
+#include "perf.h"
 
 #include "symmetric.h"
 
 __global__
 void lb_collision_mrt1(kernel_ctxt_t * ktx, lb_t * lb, hydro_t * hydro,
-		       map_t * map, noise_t * noise, fe_t * fe);
+		       map_t * map, noise_t * noise, fe_t * fe,
+		       int region, kernel_info_t inner);
 __global__
 void lb_collision_mrt2(kernel_ctxt_t * ktx, lb_t * lb, hydro_t * hydro,
 		       fe_symm_t * fe, noise_t * noise);
 
 int lb_collision_mrt(lb_t * lb, hydro_t * hydro, map_t * map,
 		     noise_t * noise, fe_t * fe);
+static __host__ int lb_collision_mrt_region(lb_t * lb, hydro_t * hydro,
+					    map_t * map, noise_t * noise,
+					    fe_t * fe,
+					    lb_collide_region_enum_t region);
 int lb_collision_binary(lb_t * lb, hydro_t * hydro, noise_t * noise,
 			fe_symm_t * fe);
+static __host__ int lb_collide_work(lb_t * lb,
+				    lb_collide_region_enum_t region);
 
 static __host__ __device__
 void lb_collision_fluctuations(lb_t * lb, noise_t * noise, int index,
@@ -63,7 +72,11 @@ static __host__ int lb_collision_parameters_commit(lb_t * lb);
 
 static __device__
 void lb_collision_mrt1_site(lb_t * lb, hydro_t * hydro, map_t * map,
-			    noise_t * noise, fe_t * fe, const int index0);
+			    noise_t * noise, fe_t * fe, const int index0,
+			    const int maskv[NSIMDVL]);
+static __device__
+void lb_collision_fchunk(lb_t * lb, const int index0, const int maskv[NSIMDVL],
+			 double * fchunk);
 static __device__
 void lb_collision_mrt2_site(lb_t * lb, hydro_t * hydro, fe_symm_t * fe,
 			    noise_t * noise, const int index0);
@@ -76,7 +89,7 @@ __device__ void d3q19_mode2f_phi(double jdotc[NSIMDVL],
 				 double sphi[3][3][NSIMDVL],
 				 double phi[NSIMDVL],
 				 double jphi[3][NSIMDVL],
-				 double * f, int baseIndex);
+				 lb_data_t * f, int baseIndex);
 
 /* Additional file scope collide time constants */
 
@@ -117,9 +130,96 @@ int lb_collide(lb_t * lb, hydro_t * hydro, map_t * map, noise_t * noise,
   lb_collision_noise_var_set(lb, noise);
   lb_collide_param_commit(lb);
 
+  perf_region_start("collision");
+
   if (ndist == 1) lb_collision_mrt(lb, hydro, map, noise, fe);
   if (ndist == 2) lb_collision_binary(lb, hydro, noise, (fe_symm_t *) fe);
 
+  lb_collide_work(lb, LB_COLLIDE_ALL);
+  perf_region_stop("collision");
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_collide_region
+ *
+ *  Collision for the boundary or the interior region of the local
+ *  domain only. The boundary region is the outermost layer of sites,
+ *  which is all that is required by the following halo swap, so the
+ *  halo swap may be started before the interior is computed:
+ *
+ *    lb_collide_region(..., LB_COLLIDE_BOUNDARY);
+ *    lb_halo_start(lb);
+ *    lb_collide_region(..., LB_COLLIDE_INTERIOR);
+ *    lb_halo_finish(lb);
+ *
+ *  Single distribution and standard (pull) propagation only; see
+ *  lb_collision_overlap().
+ *
+ *****************************************************************************/
+
+__host__ int lb_collide_region(lb_t * lb, hydro_t * hydro, map_t * map,
+			       noise_t * noise, fe_t * fe,
+			       lb_collide_region_enum_t region) {
+
+  if (hydro == NULL) return 0;
+
+  assert(lb);
+  assert(map);
+  assert(lb->ndist == 1);
+  assert(lb->param->isfused == 0);
+  assert(lb->param->isaa == 0);
+  assert(lb->nsparse == 0);
+
+  if (region == LB_COLLIDE_ALL) return lb_collide(lb, hydro, map, noise, fe);
+
+  lb_collision_relaxation_times_set(lb);
+  lb_collision_noise_var_set(lb, noise);
+  lb_collide_param_commit(lb);
+
+  perf_region_start("collision");
+  lb_collision_mrt_region(lb, hydro, map, noise, fe, region);
+  lb_collide_work(lb, region);
+  perf_region_stop("collision");
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_collide_work
+ *
+ *  Nominal work for the current perf region: each site reads and
+ *  writes all distributions, reads the force and writes the density
+ *  and velocity; the transformation to modes and back is counted as
+ *  4 NVEL^2 flops per distribution.
+ *
+ *****************************************************************************/
+
+static __host__ int lb_collide_work(lb_t * lb,
+				    lb_collide_region_enum_t region) {
+  int nlocal[3];
+  double nsites;
+  double ninner;
+  double nbytes;
+
+  assert(lb);
+
+  cs_nlocal(lb->cs, nlocal);
+
+  nsites = 1.0*nlocal[X]*nlocal[Y]*nlocal[Z];
+  ninner = 1.0*imax(nlocal[X] - 2, 0)*imax(nlocal[Y] - 2, 0)
+    *imax(nlocal[Z] - 2, 0);
+
+  if (lb->nsparse) nsites = 1.0*NSIMDVL*lb->nsparse;
+  if (region == LB_COLLIDE_BOUNDARY) nsites -= ninner;
+  if (region == LB_COLLIDE_INTERIOR) nsites = ninner;
+
+  nbytes = 2.0*lb->ndist*NVEL*sizeof(lb_data_t) + 7.0*sizeof(double);
+  perf_region_work(nsites, nsites*nbytes, 4.0*nsites*lb->ndist*NVEL*NVEL);
+
   return 0;
 }
 
@@ -133,10 +233,40 @@ int lb_collide(lb_t * lb, hydro_t * hydro, map_t * map, noise_t * noise,
 
 __host__ int lb_collision_mrt(lb_t * lb, hydro_t * hydro, map_t * map,
 			      noise_t * noise, fe_t * fe) {
+
+  assert(lb);
+
+  lb_collision_mrt_region(lb, hydro, map, noise, fe, LB_COLLIDE_ALL);
+
+  /* Fused propagation has written to fprime */
+  if (lb->param->isfused) lb_model_swapf(lb);
+
+  /* AA propagation has changed the storage layout */
+  if (lb->param->isaa) lb->param->parity = 1 - lb->param->parity;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_collision_mrt_region
+ *
+ *  Launch the single fluid collision kernel for the given region.
+ *  The boundary region is the outermost layer of local sites (those
+ *  required by the distribution halo swap), and the interior is the
+ *  remainder.
+ *
+ *****************************************************************************/
+
+static __host__ int lb_collision_mrt_region(lb_t * lb, hydro_t * hydro,
+					    map_t * map, noise_t * noise,
+					    fe_t * fe,
+					    lb_collide_region_enum_t region) {
   int nlocal[3];
   dim3 nblk, ntpb;
   fe_t * fetarget = NULL;
   kernel_info_t limits;
+  kernel_info_t inner;
   kernel_ctxt_t * ctxt = NULL;
 
   assert(lb);
@@ -150,9 +280,19 @@ __host__ int lb_collision_mrt(lb_t * lb, hydro_t * hydro, map_t * map,
   limits.jmin = 1; limits.jmax = nlocal[Y];
   limits.kmin = 1; limits.kmax = nlocal[Z];
 
+  /* Interior */
+  inner.imin = 2; inner.imax = nlocal[X] - 1;
+  inner.jmin = 2; inner.jmax = nlocal[Y] - 1;
+  inner.kmin = 2; inner.kmax = nlocal[Z] - 1;
+
+  if (region == LB_COLLIDE_INTERIOR) limits = inner;
+
   kernel_ctxt_create(lb->cs, NSIMDVL, limits, &ctxt);
   kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
+  /* Sparse sweep visits only the active site vectors */
+  if (lb->nsparse) kernel_launch_param(NSIMDVL*lb->nsparse, &nblk, &ntpb);
+
   lb_collision_parameters_commit(lb);
   if (fe) fe->func->target(fe, &fetarget);
 
@@ -160,7 +300,7 @@ __host__ int lb_collision_mrt(lb_t * lb, hydro_t * hydro, map_t * map,
 
   tdpLaunchKernel(lb_collision_mrt1, nblk, ntpb, 0, 0, ctxt->target,
 		  lb->target, hydro->target, map->target, noise->target,
-		  fetarget);
+		  fetarget, region, inner);
 
   tdpAssert(tdpPeekAtLastError());
   tdpAssert(tdpDeviceSynchronize());
@@ -177,22 +317,61 @@ __host__ int lb_collision_mrt(lb_t * lb, hydro_t * hydro, map_t * map,
  *  lb_collision_mrt1
  *
  *  Kernel driver for thread-decomposed collision routine; this generates
- *  a loop over all lattice sites.
+ *  a loop over all lattice sites, or over the active site vectors
+ *  only if a sparse list is present (see lb_sparse_set()).
+ *
+ *  For the boundary or interior region, sites outside the region are
+ *  masked out; the boundary excludes sites within "inner".
  *
  *****************************************************************************/
 
 __global__
 void lb_collision_mrt1(kernel_ctxt_t * ktx, lb_t * lb, hydro_t * hydro,
-		       map_t * map, noise_t * noise, fe_t * fe) {
-  int kindex;
+		       map_t * map, noise_t * noise, fe_t * fe,
+		       int region, kernel_info_t inner) {
+  int ks;
   int kiter;
 
   kiter = kernel_vector_iterations(ktx);
+  if (lb->nsparse) kiter = NSIMDVL*lb->nsparse;
 
-  for_simt_parallel(kindex, kiter, NSIMDVL) {
+  for_simt_parallel(ks, kiter, NSIMDVL) {
+    int iv;
     int index0;
+    int kindex;
+    int nmask = NSIMDVL;
+    int ic[NSIMDVL];
+    int jc[NSIMDVL];
+    int kc[NSIMDVL];
+    int maskv[NSIMDVL];
+
+    kindex = (lb->nsparse) ? lb->sparse[ks/NSIMDVL] : ks;
     index0 = kernel_baseindex(ktx, kindex);
-    lb_collision_mrt1_site(lb, hydro, map, noise, fe, index0);
+
+    if (_lbp.isfused || _lbp.isaa || region != LB_COLLIDE_ALL) {
+      kernel_coords_v(ktx, kindex, ic, jc, kc);
+      kernel_mask_v(ktx, ic, jc, kc, maskv);
+    }
+    else {
+      for_simd_v(iv, NSIMDVL) maskv[iv] = 1;
+    }
+
+    if (region == LB_COLLIDE_BOUNDARY) {
+      for_simd_v(iv, NSIMDVL) {
+	if (ic[iv] >= inner.imin && ic[iv] <= inner.imax &&
+	    jc[iv] >= inner.jmin && jc[iv] <= inner.jmax &&
+	    kc[iv] >= inner.kmin && kc[iv] <= inner.kmax) maskv[iv] = 0;
+      }
+    }
+
+    if (region != LB_COLLIDE_ALL) {
+      nmask = 0;
+      for_simd_v(iv, NSIMDVL) nmask += maskv[iv];
+    }
+
+    if (nmask > 0) {
+      lb_collision_mrt1_site(lb, hydro, map, noise, fe, index0, maskv);
+    }
   }
 
   return;
@@ -215,11 +394,26 @@ void lb_collision_mrt1(kernel_ctxt_t * ktx, lb_t * lb, hydro_t * hydro,
  *  body force present). The stress modes, and ghost modes, are
  *  relaxed toward their equilibrium values.
  *
+ *  If propagation is fused, the post-collision distributions are
+ *  pushed to the neighbouring site at displacement ndisp[p] in
+ *  fprime; sites outside the kernel domain (maskv = 0) are not
+ *  pushed. Non-fluid sites push their distributions unchanged.
+ *
+ *  AA-pattern propagation works in place in f, alternating two
+ *  kinds of step. From the natural layout (parity 0), the local
+ *  distributions are read and written back to the opposite
+ *  velocity slot at the same site. From the swapped layout
+ *  (parity 1), the distributions are read from the neighbours
+ *  and pushed to the neighbours, leaving the natural layout.
+ *  Each site reads and writes the same memory locations, so no
+ *  second buffer is required.
+ *
  *****************************************************************************/
 
 static __device__
 void lb_collision_mrt1_site(lb_t * lb, hydro_t * hydro, map_t * map,
-			    noise_t * noise, fe_t * fe, const int index0) {
+			    noise_t * noise, fe_t * fe, const int index0,
+			    const int maskv[NSIMDVL]) {
   
   int p, m;                               /* velocity index */
   int ia, ib;                             /* indices ("alphabeta") */
@@ -258,6 +452,17 @@ void lb_collision_mrt1_site(lb_t * lb, hydro_t * hydro, map_t * map,
     }
   }
 
+  /* In the pull scheme, masked sites are outside the current region */
+
+  if (_lbp.isfused == 0 && _lbp.isaa == 0) {
+    for_simd_v(iv, NSIMDVL) {
+      if (maskv[iv] == 0) {
+	includeSite[iv] = 0;
+	fullchunk = 0;
+      }
+    }
+  }
+
   for (ia = 0; ia < 3; ia++) {
     for_simd_v(iv, NSIMDVL) u[ia][iv] = 0.0;
   }
@@ -276,10 +481,7 @@ void lb_collision_mrt1_site(lb_t * lb, hydro_t * hydro, map_t * map,
 
   /* Load SIMD vectors for distribution and force */
 
-  for (p = 0; p < NVEL; p++) {
-    for_simd_v(iv, NSIMDVL) fchunk[p*NSIMDVL+iv] = 
-      lb->f[ LB_ADDR(_lbp.nsite, 1, NVEL, index0 + iv, LB_RHO, p) ];
-  }
+  lb_collision_fchunk(lb, index0, maskv, fchunk);
 
   for (ia = 0; ia < 3; ia++) {
     for_simd_v(iv, NSIMDVL) {
@@ -479,11 +681,55 @@ void lb_collision_mrt1_site(lb_t * lb, hydro_t * hydro, map_t * map,
 
   /* Write SIMD chunks back to main arrays. */
 
-  if (fullchunk) {
+  if (_lbp.isfused || _lbp.isaa) {
+    /* Restore pre-collision values at non-fluid sites */
+    if (fullchunk == 0) {
+      double f0[NVEL*NSIMDVL];
+      lb_collision_fchunk(lb, index0, maskv, f0);
+      for (p = 0; p < NVEL; p++) {
+	for_simd_v(iv, NSIMDVL) {
+	  if (includeSite[iv] == 0) fchunk[p*NSIMDVL+iv] = f0[p*NSIMDVL+iv];
+	}
+      }
+    }
+    if (_lbp.isfused || _lbp.parity) {
+      /* Propagate (push) */
+      lb_data_t * fp = (_lbp.isfused) ? lb->fprime : lb->f;
+      for (p = 0; p < NVEL; p++) {
+	for_simd_v(iv, NSIMDVL) {
+	  if (maskv[iv]) {
+	    fp[LB_ADDR(_lbp.nsite, 1, NVEL, index0 + iv + _lbp.ndisp[p],
+		       LB_RHO, p)] = fchunk[p*NSIMDVL+iv] - LB_FSHIFT(&_lbp, LB_RHO, p);
+	  }
+	}
+      }
+    }
+    else {
+      /* AA from natural layout: local swap to opposite velocity */
+      for (p = 0; p < NVEL; p++) {
+	for_simd_v(iv, NSIMDVL) {
+	  if (maskv[iv]) {
+	    lb->f[LB_ADDR(_lbp.nsite, 1, NVEL, index0 + iv, LB_RHO,
+			  (NVEL - p) % NVEL)]
+	      = fchunk[p*NSIMDVL+iv] - LB_FSHIFT(&_lbp, LB_RHO, p);
+	  }
+	}
+      }
+    }
+    for_simd_v(iv, NSIMDVL) {
+      if (includeSite[iv]) {
+	for (ia = 0; ia < 3; ia++) {
+	  hydro->u[addr_rank1(hydro->nsite, NHDIM, index0 + iv, ia)] = u[ia][iv];
+	}
+      }
+    }
+  }
+  else if (fullchunk) {
     /* distribution */
     for (p = 0; p < NVEL; p++) {
       for_simd_v(iv, NSIMDVL) { 
-	lb->f[LB_ADDR(_lbp.nsite, _lbp.ndist, NVEL, index0+iv, LB_RHO, p)] = fchunk[p*NSIMDVL+iv];
+	lb->f[LB_ADDR(_lbp.nsite, _lbp.ndist, NVEL, index0+iv, LB_RHO, p)]
+	  = fchunk[p*NSIMDVL+iv] - LB_FSHIFT(&_lbp, LB_RHO, p);
       }
     }
     /* velocity */
@@ -499,7 +745,7 @@ void lb_collision_mrt1_site(lb_t * lb, hydro_t * hydro, map_t * map,
 	/* distribution */
 	for (p = 0; p < NVEL; p++) {
 	  lb->f[LB_ADDR(_lbp.nsite, _lbp.ndist, NVEL, index0 + iv, LB_RHO, p)]
-	    = fchunk[p*NSIMDVL+iv]; 
+	    = fchunk[p*NSIMDVL+iv] - LB_FSHIFT(&_lbp, LB_RHO, p);
 	}
 	/* velocity */
 
@@ -513,6 +759,43 @@ void lb_collision_mrt1_site(lb_t * lb, hydro_t * hydro, map_t * map,
   return;
 }
 
+/*****************************************************************************
+ *
+ *  lb_collision_fchunk
+ *
+ *  Load the pre-collision distributions for NSIMDVL sites at index0.
+ *  In the AA swapped layout (parity 1), f_p(x) is read from the
+ *  opposite velocity slot at x - c_p; sites outside the kernel
+ *  domain (maskv = 0) are read locally, and are not used.
+ *
+ *****************************************************************************/
+
+static __device__
+void lb_collision_fchunk(lb_t * lb, const int index0, const int maskv[NSIMDVL],
+			 double * fchunk) {
+  int p, iv;
+
+  if (_lbp.isaa && _lbp.parity) {
+    for (p = 0; p < NVEL; p++) {
+      for_simd_v(iv, NSIMDVL) {
+	int index = index0 + iv - maskv[iv]*_lbp.ndisp[p];
+	fchunk[p*NSIMDVL+iv] =
+	  lb->f[LB_ADDR(_lbp.nsite, 1, NVEL, index, LB_RHO, (NVEL - p) % NVEL)]
+	  + LB_FSHIFT(&_lbp, LB_RHO, p);
+      }
+    }
+  }
+  else {
+    for (p = 0; p < NVEL; p++) {
+      for_simd_v(iv, NSIMDVL) fchunk[p*NSIMDVL+iv] = 
+	lb->f[ LB_ADDR(_lbp.nsite, 1, NVEL, index0 + iv, LB_RHO, p) ]
+	+ LB_FSHIFT(&_lbp, LB_RHO, p);
+    }
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  lb_collision_binary
@@ -684,7 +967,8 @@ __device__ void lb_collision_mrt2_site(lb_t * lb, hydro_t * hydro,
   for (p = 0; p < NVEL; p++) {
     for_simd_v(iv, NSIMDVL) {
       f[p*NSIMDVL+iv]
-	= lb->f[LB_ADDR(_lbp.nsite, _lbp.ndist, NVEL, index0 + iv, LB_RHO, p)];
+	= lb->f[LB_ADDR(_lbp.nsite, _lbp.ndist, NVEL, index0 + iv, LB_RHO, p)]
+	+ LB_FSHIFT(&_lbp, LB_RHO, p);
     }
   }
   d3q19_f2mode_chunk(mode, f);
@@ -697,7 +981,8 @@ __device__ void lb_collision_mrt2_site(lb_t * lb, hydro_t * hydro,
     for (p = 0; p < NVEL; p++) {
       for_simd_v(iv, NSIMDVL) {
 	mode[m*NSIMDVL+iv] += _lbp.ma[m][p]
-	  *lb->f[LB_ADDR(_lbp.nsite, _lbp.ndist, NVEL, index0 + iv, LB_RHO, p)];
+	  *(lb->f[LB_ADDR(_lbp.nsite, _lbp.ndist, NVEL, index0 + iv, LB_RHO, p)]
+	    + LB_FSHIFT(&_lbp, LB_RHO, p));
       }
     }
   }
@@ -851,7 +1136,7 @@ __device__ void lb_collision_mrt2_site(lb_t * lb, hydro_t * hydro,
   for (p = 0; p < NVEL; p++) {
     for_simd_v(iv, NSIMDVL) {
       lb->f[LB_ADDR(_lbp.nsite, _lbp.ndist, NVEL, index0 + iv, LB_RHO, p)] =
-	f[p*NSIMDVL+iv];
+	f[p*NSIMDVL+iv] - LB_FSHIFT(&_lbp, LB_RHO, p);
     }
   }
 #else    
@@ -861,7 +1146,8 @@ __device__ void lb_collision_mrt2_site(lb_t * lb, hydro_t * hydro,
       for_simd_v(iv, NSIMDVL) f[p*NSIMDVL+iv] += _lbp.mi[p][m]*mode[m*NSIMDVL+iv];
     }
     for_simd_v(iv, NSIMDVL) {
-      lb->f[LB_ADDR(_lbp.nsite, NDIST, NVEL, index0+iv, LB_RHO, p)] = f[p*NSIMDVL+iv];
+      lb->f[LB_ADDR(_lbp.nsite, NDIST, NVEL, index0+iv, LB_RHO, p)]
+	= f[p*NSIMDVL+iv] - LB_FSHIFT(&_lbp, LB_RHO, p);
     }
   }
 #endif
@@ -967,6 +1253,9 @@ __device__ void lb_collision_mrt2_site(lb_t * lb, hydro_t * hydro,
   noise_present(noise, NOISE_RHO, &status);
   if (status == 0) return 0;
 
+  /* The moments are computed on the host */
+  lb_memcpy(lb, tdpMemcpyDeviceToHost);
+
   physics_ref(&phys);
   physics_kt(phys, &kt);
 
@@ -1073,6 +1362,93 @@ __host__ int lb_collision_relaxation_set(lb_t * lb, lb_relaxation_enum_t nrelax)
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  lb_collision_fused_set
+ *
+ *  Switch for fused collision and propagation. If set, lb_collide()
+ *  performs a push propagation from each site, so that a separate
+ *  lb_propagation() stage is not required. Single distribution only.
+ *
+ *****************************************************************************/
+
+__host__ int lb_collision_fused_set(lb_t * lb, int isfused) {
+
+  assert(lb);
+  assert(lb->param);
+  assert(lb->ndist == 1 || isfused == 0);
+
+  lb->param->isfused = isfused;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_collision_fused
+ *
+ *****************************************************************************/
+
+__host__ int lb_collision_fused(lb_t * lb, int * isfused) {
+
+  assert(lb);
+  assert(lb->param);
+  assert(isfused);
+
+  *isfused = lb->param->isfused;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_collision_overlap_set
+ *
+ *  Switch to allow the collision to overlap the following halo swap
+ *  (see lb_collide_region()).
+ *
+ *****************************************************************************/
+
+__host__ int lb_collision_overlap_set(lb_t * lb, int isoverlap) {
+
+  assert(lb);
+  assert(lb->param);
+
+  lb->param->isoverlap = isoverlap;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_collision_overlap
+ *
+ *  Is the overlap both requested and available? It requires a single
+ *  distribution, the standard propagation, no sparse sweep, and at
+ *  least three sites in each direction locally.
+ *
+ *****************************************************************************/
+
+__host__ int lb_collision_overlap(lb_t * lb, int * isoverlap) {
+
+  int nlocal[3];
+
+  assert(lb);
+  assert(lb->param);
+  assert(isoverlap);
+
+  cs_nlocal(lb->cs, nlocal);
+
+  *isoverlap = lb->param->isoverlap;
+
+  if (lb->ndist != 1) *isoverlap = 0;
+  if (lb->param->isfused || lb->param->isaa) *isoverlap = 0;
+  if (lb->nsparse) *isoverlap = 0;
+  if (nlocal[X] < 3 || nlocal[Y] < 3 || nlocal[Z] < 3) *isoverlap = 0;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  lb_collision_relaxation_times_set
@@ -2295,7 +2671,7 @@ __device__ void d3q19_mode2f_phi(double jdotc[NSIMDVL],
 				 double sphi[3][3][NSIMDVL],
 				 double phi[NSIMDVL],
 				 double jphi[3][NSIMDVL],
-				 double * f, int baseIndex){
+				 lb_data_t * f, int baseIndex){
 
   int iv=0;
   const double rcs2 = 3.0;
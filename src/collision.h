@@ -23,8 +23,16 @@
 #include "model.h"
 #include "free_energy.h"
 
+typedef enum lb_collide_region_enum {LB_COLLIDE_ALL = 0,
+				     LB_COLLIDE_BOUNDARY,
+				     LB_COLLIDE_INTERIOR}
+  lb_collide_region_enum_t;
+
 __host__ int lb_collide(lb_t * lb, hydro_t * hydro, map_t * map,
 			noise_t * noise, fe_t * fe);
+__host__ int lb_collide_region(lb_t * lb, hydro_t * hydro, map_t * map,
+			       noise_t * noise, fe_t * fe,
+			       lb_collide_region_enum_t region);
 __host__ int lb_collision_stats_kt(lb_t * lb, noise_t * noise, map_t * map);
 __host__ int lb_collision_relaxation_set(lb_t * lb, lb_relaxation_enum_t nrelax);
 
@@ -32,5 +40,9 @@ __host__ int lb_collision_ghost_modes_on(lb_t * lb);
 __host__ int lb_collision_ghost_modes_off(lb_t * lb);
 __host__ int lb_collision_relaxation_times(lb_t * lb, double * tau);
 __host__ int lb_collision_relaxation_times_set(lb_t * lb);
+__host__ int lb_collision_fused_set(lb_t * lb, int isfused);
+__host__ int lb_collision_fused(lb_t * lb, int * isfused);
+__host__ int lb_collision_overlap_set(lb_t * lb, int isoverlap);
+__host__ int lb_collision_overlap(lb_t * lb, int * isoverlap);
 
 #endif
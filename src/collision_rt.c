@@ -39,6 +39,11 @@ int collision_run_time(pe_t * pe, rt_t * rt, lb_t * lb, noise_t * noise) {
   int p;
   int noise_on = 0;
   int nghost;
+  int nfused;
+  int noverlap;
+  int naa;
+  int ndist;
+  int ndevice;
   char relax[10];
   char tmp[BUFSIZ];
   double tau[NVEL];
@@ -85,6 +90,37 @@ int collision_run_time(pe_t * pe, rt_t * rt, lb_t * lb, noise_t * noise) {
     lb_collision_ghost_modes_off(lb);
   }
 
+  /* Fused collision and propagation (default off) */
+
+  p = rt_string_parameter(rt, "lb_fused_propagation", tmp, BUFSIZ);
+  nfused = 0;
+  if (p == 1 && strcmp(tmp, "on") == 0) {
+    lb_ndist(lb, &ndist);
+    tdpGetDeviceCount(&ndevice);
+    if (ndist != 1) {
+      pe_fatal(pe, "lb_fused_propagation requires a single distribution\n");
+    }
+    if (ndevice > 0) {
+      pe_fatal(pe, "lb_fused_propagation is not available for device\n");
+    }
+    lb_aa(lb, &naa);
+    if (naa) {
+      pe_fatal(pe, "lb_fused_propagation and lb_aa_propagation are "
+	       "mutually exclusive\n");
+    }
+    nfused = 1;
+    lb_collision_fused_set(lb, nfused);
+  }
+
+  /* Overlap of collision and distribution halo swap (default off).
+   * Only the x-direction messages are in flight during the interior
+   * collision; see halo_swap_start(). */
+
+  p = rt_string_parameter(rt, "lb_halo_overlap", tmp, BUFSIZ);
+  noverlap = 0;
+  if (p == 1 && strcmp(tmp, "on") == 0) noverlap = 1;
+  lb_collision_overlap_set(lb, noverlap);
+
   lb_collision_relaxation_times(lb, tau);
 
   pe_info(pe, "\n");
@@ -94,6 +130,12 @@ int collision_run_time(pe_t * pe, rt_t * rt, lb_t * lb, noise_t * noise) {
   pe_info(pe, "Hydrodynamic modes:       on\n");
   pe_info(pe, "Ghost modes:              %s\n", (nghost == 1) ? "on" : "off");
   pe_info(pe, "Isothermal fluctuations:  %s\n", (noise_on == 1) ? "on" : "off");
+  if (nfused) {
+    pe_info(pe, "Fused propagation:        on\n");
+  }
+  if (noverlap) {
+    pe_info(pe, "Halo overlap:             on (x-direction only)\n");
+  }
   pe_info(pe, "Shear relaxation time:   %12.5e\n", tau[LB_TAU_SHEAR]);
   pe_info(pe, "Bulk relaxation time:    %12.5e\n", tau[LB_TAU_BULK]);
   pe_info(pe, "Ghost relaxation time:   %12.5e\n", tau[NVEL-1]);
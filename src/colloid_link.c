@@ -4,22 +4,44 @@
  *
  *  Colloid boundary link structure.
  *
+ *  Links are taken from a pool which is extended a block at a time,
+ *  and links released are returned to the pool (not to the system)
+ *  for reuse when links are rebuilt. The pool blocks themselves are
+ *  released by colloid_link_pool_free() once no links are in use.
+ *
+ *  A flat link table is provided for consumers which want to stream
+ *  through all the links for a sequence of colloids.
+ *
  *  $Id: colloid_link.c,v 1.2 2010-10-15 12:40:02 kevin Exp $
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
- *  (c) 2010 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *****************************************************************************/
 
 #include <assert.h>
 #include <stdlib.h>
 
+#include "coords.h"
 #include "colloid_link.h"
 
-static int nlinks_ = 0;   /* Total currently allocated */
+#define COLLOID_LINK_NBLOCK 1024  /* Links per pool block */
+
+typedef struct colloid_link_block_s colloid_link_block_t;
+
+struct colloid_link_block_s {
+  colloid_link_t link[COLLOID_LINK_NBLOCK];
+  colloid_link_block_t * next;
+};
+
+static int nlinks_ = 0;                          /* Total currently in use */
+static colloid_link_t * free_ = NULL;            /* Pool free list */
+static colloid_link_block_t * blocks_ = NULL;    /* Pool blocks */
+
+static int colloid_link_table_grow(colloid_link_table_t * table, int nlink);
 
 /*****************************************************************************
  *
@@ -29,11 +51,41 @@ static int nlinks_ = 0;   /* Total currently allocated */
 
 colloid_link_t * colloid_link_allocate(void) {
 
-  colloid_link_t * p_link;
+  int n;
+  colloid_link_t * p_link = NULL;
+
+  /* The pool is shared between threads */
 
-  p_link = (colloid_link_t *) malloc(sizeof(colloid_link_t));
-  assert(p_link);
-  nlinks_++;
+  tdp_host_omp(critical (colloid_link_pool))
+  {
+    if (free_ == NULL) {
+
+      /* Extend the pool by one block */
+
+      colloid_link_block_t * block = NULL;
+
+      block = (colloid_link_block_t *) malloc(sizeof(colloid_link_block_t));
+      assert(block);
+
+      if (block) {
+	for (n = 0; n < COLLOID_LINK_NBLOCK - 1; n++) {
+	  block->link[n].next = block->link + n + 1;
+	}
+	block->link[COLLOID_LINK_NBLOCK - 1].next = NULL;
+
+	block->next = blocks_;
+	blocks_ = block;
+	free_ = block->link;
+      }
+    }
+
+    if (free_) {
+      p_link = free_;
+      free_ = p_link->next;
+      p_link->next = NULL;
+      nlinks_++;
+    }
+  }
 
   return p_link;
 }
@@ -43,18 +95,29 @@ colloid_link_t * colloid_link_allocate(void) {
  *  colloid_link_free_list
  *
  *  Should take the first link in the list as argument.
+ *  The whole list is returned to the pool.
  *
  *****************************************************************************/
 
 void colloid_link_free_list(colloid_link_t * p) {
 
-  colloid_link_t * tmp;
+  int n = 1;
+  colloid_link_t * tail;
 
-  while (p) {
-    tmp = p->next;
-    free(p);
-    p = tmp;
-    nlinks_--;
+  if (p == NULL) return;
+
+  tail = p;
+
+  while (tail->next) {
+    tail = tail->next;
+    n++;
+  }
+
+  tdp_host_omp(critical (colloid_link_pool))
+  {
+    nlinks_ -= n;
+    tail->next = free_;
+    free_ = p;
   }
 
   return;
@@ -93,3 +156,181 @@ int colloid_link_total(void) {
 
   return nlinks_;
 }
+
+/*****************************************************************************
+ *
+ *  colloid_link_pool_free
+ *
+ *  Release the pool blocks to the system. This is a no-op if any
+ *  links are still in use (e.g., by another colloids_info_t).
+ *
+ *****************************************************************************/
+
+int colloid_link_pool_free(void) {
+
+  colloid_link_block_t * block = NULL;
+
+  if (nlinks_ > 0) return 0;
+
+  while (blocks_) {
+    block = blocks_;
+    blocks_ = block->next;
+    free(block);
+  }
+
+  free_ = NULL;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_link_table_create
+ *
+ *****************************************************************************/
+
+int colloid_link_table_create(colloid_link_table_t ** ptable) {
+
+  colloid_link_table_t * table = NULL;
+
+  assert(ptable);
+
+  table = (colloid_link_table_t *) calloc(1, sizeof(colloid_link_table_t));
+  assert(table);
+  if (table == NULL) return -1;
+
+  table->ncalloc = 1;
+  table->offset = (int *) calloc(table->ncalloc + 1, sizeof(int));
+  assert(table->offset);
+  if (table->offset == NULL) return -1;
+
+  *ptable = table;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_link_table_free
+ *
+ *****************************************************************************/
+
+int colloid_link_table_free(colloid_link_table_t * table) {
+
+  assert(table);
+
+  free(table->rb[Z]);
+  free(table->rb[Y]);
+  free(table->rb[X]);
+  free(table->status);
+  free(table->p);
+  free(table->j);
+  free(table->i);
+  free(table->offset);
+  free(table);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_link_table_reset
+ *
+ *  Empty the table (the storage is retained).
+ *
+ *****************************************************************************/
+
+int colloid_link_table_reset(colloid_link_table_t * table) {
+
+  assert(table);
+
+  table->nlink = 0;
+  table->ncolloid = 0;
+  table->offset[0] = 0;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_link_table_add
+ *
+ *  Append the links of one colloid (the list may be empty) and
+ *  close its range.
+ *
+ *****************************************************************************/
+
+int colloid_link_table_add(colloid_link_table_t * table, colloid_link_t * p) {
+
+  int n;
+
+  assert(table);
+
+  if (table->ncolloid == table->ncalloc) {
+    int * tmp = NULL;
+    tmp = (int *) realloc(table->offset, (2*table->ncalloc + 1)*sizeof(int));
+    assert(tmp);
+    if (tmp == NULL) return -1;
+    table->offset = tmp;
+    table->ncalloc *= 2;
+  }
+
+  for (; p; p = p->next) {
+
+    n = table->nlink;
+    if (n == table->nalloc) {
+      if (colloid_link_table_grow(table, 2*table->nalloc + 64)) return -1;
+    }
+
+    table->i[n] = p->i;
+    table->j[n] = p->j;
+    table->p[n] = p->p;
+    table->status[n] = p->status;
+    table->rb[X][n] = p->rb[X];
+    table->rb[Y][n] = p->rb[Y];
+    table->rb[Z][n] = p->rb[Z];
+    table->nlink += 1;
+  }
+
+  table->ncolloid += 1;
+  table->offset[table->ncolloid] = table->nlink;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_link_table_grow
+ *
+ *  Existing contents are preserved.
+ *
+ *****************************************************************************/
+
+static int colloid_link_table_grow(colloid_link_table_t * table, int nlink) {
+
+  int ia;
+  int ifail = 0;
+  void * tmp = NULL;
+
+  assert(table);
+  assert(nlink > table->nalloc);
+
+  tmp = realloc(table->i, nlink*sizeof(int));
+  if (tmp) table->i = (int *) tmp; else ifail = -1;
+  tmp = realloc(table->j, nlink*sizeof(int));
+  if (tmp) table->j = (int *) tmp; else ifail = -1;
+  tmp = realloc(table->p, nlink*sizeof(int));
+  if (tmp) table->p = (int *) tmp; else ifail = -1;
+  tmp = realloc(table->status, nlink*sizeof(int));
+  if (tmp) table->status = (int *) tmp; else ifail = -1;
+
+  for (ia = 0; ia < 3; ia++) {
+    tmp = realloc(table->rb[ia], nlink*sizeof(double));
+    if (tmp) table->rb[ia] = (double *) tmp; else ifail = -1;
+  }
+
+  assert(ifail == 0);
+  if (ifail == 0) table->nalloc = nlink;
+
+  return ifail;
+}
@@ -9,7 +9,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -36,9 +36,34 @@ struct colloid_link_type {
 
 enum link_status {LINK_FLUID, LINK_COLLOID, LINK_BOUNDARY, LINK_UNUSED}; 
 
+/* Flat (structure of arrays) copy of the links for a sequence of
+ * colloids. The links for the nth colloid added are those with
+ * offset[n] <= index < offset[n+1]. */
+
+typedef struct colloid_link_table_s colloid_link_table_t;
+
+struct colloid_link_table_s {
+  int nalloc;             /* Capacity (links) */
+  int nlink;              /* Current number of links */
+  int ncalloc;            /* Capacity (colloids) */
+  int ncolloid;           /* Current number of colloids */
+  int * i;                /* Outside site index */
+  int * j;                /* Inside site index */
+  int * p;                /* Velocity index i -> j */
+  int * status;           /* Link status */
+  double * rb[3];         /* Boundary link vector components */
+  int * offset;           /* Per colloid offsets [ncolloid + 1] */
+};
+
 colloid_link_t * colloid_link_allocate(void);
 void             colloid_link_free_list(colloid_link_t * link);
 int              colloid_link_count(colloid_link_t * link);
 int              colloid_link_total(void);
+int              colloid_link_pool_free(void);
+
+int colloid_link_table_create(colloid_link_table_t ** ptable);
+int colloid_link_table_free(colloid_link_table_t * table);
+int colloid_link_table_reset(colloid_link_table_t * table);
+int colloid_link_table_add(colloid_link_table_t * table, colloid_link_t * lnk);
 
 #endif
@@ -4,11 +4,16 @@
  *
  *  Communication for sums over colloid links.
  *
+ *  The exchange is dimension by dimension, so that contributions
+ *  from edge and corner copies arrive via intermediate neighbours.
+ *  For each dimension, the list of colloids involved (the 'plan')
+ *  is retained, and only recomputed if the cell lists have changed.
+ *  Several sum types may be fused into one message.
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2018 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -20,6 +25,7 @@
 #include <string.h>
 
 #include "pe.h"
+#include "util.h"
 #include "coords_s.h"
 #include "colloids_s.h"
 #include "colloid_sums.h"
@@ -43,9 +49,9 @@
  *     for conserved quantities to be replaced after colloid
  *     movement.
  *
- *  For each message type, the index is passed as a double
- *  for simplicity. The following keep track of the different
- *  messages...
+ *  For each colloid, the index is passed as a double for simplicity,
+ *  followed by the quantities for each message type requested.
+ *  The following keep track of the different messages...
  *
  *****************************************************************************/
 
@@ -53,28 +59,45 @@ struct colloid_sum_s {
   pe_t * pe;                              /* Parallel environment */
   cs_t * cs;                              /* Coordinate-system */
   colloids_info_t * cinfo;                /* Temporary reference */
-  int mtype;                              /* Current message type */
+  int ntype;                              /* Number of message types */
+  int mtype[COLLOID_SUM_MAX];             /* Current message types */
   int mload;                              /* Load / unload flag */
   int msize;                              /* Current message size */
   int ncount[2];                          /* forward / backward */
+  int nbuf;                               /* Buffer capacity (doubles) */
   double * send;                          /* Send buffer */
   double * recv;                          /* Receive buffer */
+
+  int occupancy[3];                       /* cinfo occupancy at last plan */
+  int nplan[3][2];                        /* Plan counts (per dimension) */
+  int nalloc[3];                          /* Plan capacity */
+  colloid_t ** plan[3];                   /* Backward, then forward */
 };
 
-static int colloid_sums_count(colloid_sum_t * sum, const int dim);
+typedef int (* colloid_sum_loader_ft)(colloid_sum_t * sum, colloid_t * pc,
+				      double * buf);
+
+static int colloid_sums_dim(colloid_sum_t * sum, int dim);
+static int colloid_sums_plan(colloid_sum_t * sum, int dim);
+static int colloid_sums_plan_add(colloid_sum_t * sum, int dim, int n,
+				 int ic, int jc, int kc);
+static int colloid_sums_reserve(colloid_sum_t * sum, int nbuf);
 static int colloid_sums_irecv(colloid_sum_t * sum, int dim, MPI_Request rq[2]);
 static int colloid_sums_isend(colloid_sum_t * sum, int dim, MPI_Request rq[2]);
 static int colloid_sums_process(colloid_sum_t * sum, int dim);
+static int colloid_sums_message(colloid_sum_t * sum, colloid_t * pc,
+				double * buf);
 
-static int colloid_sums_m0(colloid_sum_t * sum, int, int, int, int);
-static int colloid_sums_m1(colloid_sum_t * sum, int, int, int, int);
-static int colloid_sums_m2(colloid_sum_t * sum, int, int, int, int);
-static int colloid_sums_m3(colloid_sum_t * sum, int, int, int, int);
-static int colloid_sums_m4(colloid_sum_t * sum, int, int, int, int);
+static int colloid_sums_m1(colloid_sum_t * sum, colloid_t * pc, double * buf);
+static int colloid_sums_m2(colloid_sum_t * sum, colloid_t * pc, double * buf);
+static int colloid_sums_m3(colloid_sum_t * sum, colloid_t * pc, double * buf);
+static int colloid_sums_m4(colloid_sum_t * sum, colloid_t * pc, double * buf);
 
-/* Message sizes (doubles) */
+/* Message sizes (doubles, including the index) and loaders */
 
 static const int msize_[COLLOID_SUM_MAX] = {10, 35, 7, 6};
+static const colloid_sum_loader_ft mloader_[COLLOID_SUM_MAX] = {
+  colloid_sums_m1, colloid_sums_m2, colloid_sums_m3, colloid_sums_m4};
 
 /* The following are used for internal communication */
 
@@ -101,6 +124,12 @@ int colloid_sums_create(colloids_info_t * cinfo, colloid_sum_t ** psum) {
   sum->pe = cinfo->pe;
   sum->cs = cinfo->cs;
   sum->cinfo = cinfo;
+
+  /* No plan yet */
+  sum->occupancy[X] = cinfo->occupancy - 1;
+  sum->occupancy[Y] = cinfo->occupancy - 1;
+  sum->occupancy[Z] = cinfo->occupancy - 1;
+
   *psum = sum;
 
   return 0;
@@ -116,6 +145,11 @@ void colloid_sums_free(colloid_sum_t * sum) {
 
   assert(sum);
 
+  free(sum->plan[Z]);
+  free(sum->plan[Y]);
+  free(sum->plan[X]);
+  free(sum->recv);
+  free(sum->send);
   free(sum);
 
   return;
@@ -133,25 +167,52 @@ void colloid_sums_free(colloid_sum_t * sum) {
 
 int colloid_sums_halo(colloids_info_t * cinfo, colloid_sum_enum_t mtype) {
 
+  assert(cinfo);
+
+  colloid_sums_halo_fused(cinfo, 1, &mtype);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_sums_halo_fused
+ *
+ *  Sums for ntype different message types in one exchange. The
+ *  types must be distinct (note ACTIVE and SUBGRID are the same),
+ *  and the quantities involved independent of one another.
+ *
+ *  The colloid_sum_t is retained by cinfo between calls.
+ *
+ *****************************************************************************/
+
+int colloid_sums_halo_fused(colloids_info_t * cinfo, int ntype,
+			    const colloid_sum_enum_t * mtype) {
+  int n, m;
   colloid_sum_t * sum = NULL;
 
   assert(cinfo);
+  assert(0 < ntype && ntype <= COLLOID_SUM_MAX);
+  assert(mtype);
 
-  sum = (colloid_sum_t * ) calloc(1, sizeof(colloid_sum_t));
-  assert(sum);
-  if (sum == NULL) pe_fatal(cinfo->pe, "calloc(colloid_sum_t) failed\n");
+  if (cinfo->sum == NULL) colloid_sums_create(cinfo, &cinfo->sum);
+  sum = cinfo->sum;
 
-  sum->pe = cinfo->pe;
-  sum->cs = cinfo->cs;
-  sum->cinfo = cinfo;
-  sum->mtype = mtype;
-  sum->msize = msize_[mtype];
+  sum->ntype = ntype;
+  sum->msize = 1;
 
-  colloid_sums_1d(sum, X, mtype);
-  colloid_sums_1d(sum, Y, mtype);
-  colloid_sums_1d(sum, Z, mtype);
+  for (n = 0; n < ntype; n++) {
+    assert(mtype[n] < COLLOID_SUM_MAX);
+    for (m = 0; m < n; m++) {
+      if (mtype[m] == mtype[n]) pe_fatal(sum->pe, "Repeated sum type\n");
+    }
+    sum->mtype[n] = mtype[n];
+    sum->msize += msize_[mtype[n]] - 1;
+  }
 
-  free(sum);
+  colloid_sums_dim(sum, X);
+  colloid_sums_dim(sum, Y);
+  colloid_sums_dim(sum, Z);
 
   return 0;
 }
@@ -164,31 +225,47 @@ int colloid_sums_halo(colloids_info_t * cinfo, colloid_sum_enum_t mtype) {
 
 int colloid_sums_1d(colloid_sum_t * sum, int dim, colloid_sum_enum_t mtype) {
 
-  int n;
- 
+  assert(sum);
+  assert(sum->cinfo);
+  assert(mtype < COLLOID_SUM_MAX);
+
+  sum->ntype = 1;
+  sum->mtype[0] = mtype;
+  sum->msize = msize_[mtype];
+
+  colloid_sums_dim(sum, dim);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_sums_dim
+ *
+ *  Exchange in one dimension for the current message types.
+ *
+ *****************************************************************************/
+
+static int colloid_sums_dim(colloid_sum_t * sum, int dim) {
+
   MPI_Request recv_req[2];
   MPI_Request send_req[2];
   MPI_Status  status[2];
 
   assert(sum);
   assert(sum->cinfo);
-  assert(mtype < COLLOID_SUM_MAX);
-
-  /* Count how many colloids are relevant */
 
-  sum->mtype = mtype;
-  sum->msize = msize_[mtype];
-  colloid_sums_count(sum, dim);
+  /* Relevant colloids */
 
-  /* Allocate send and receive buffer */
+  if (sum->occupancy[dim] != sum->cinfo->occupancy) {
+    colloid_sums_plan(sum, dim);
+  }
 
-  n = sum->ncount[BACKWARD] + sum->ncount[FORWARD];
+  sum->ncount[BACKWARD] = sum->nplan[dim][BACKWARD];
+  sum->ncount[FORWARD] = sum->nplan[dim][FORWARD];
 
-  sum->send = (double *) malloc(n*msize_[mtype]*sizeof(double));
-  sum->recv = (double *) malloc(n*msize_[mtype]*sizeof(double));
- 
-  if (sum->send == NULL) pe_fatal(sum->pe, "malloc(sum->send) failed\n");
-  if (sum->recv == NULL) pe_fatal(sum->pe, "malloc(sum->recv) failed\n");
+  colloid_sums_reserve(sum, sum->msize*(sum->ncount[BACKWARD]
+					+ sum->ncount[FORWARD]));
 
   /* Post receives */
 
@@ -205,79 +282,137 @@ int colloid_sums_1d(colloid_sum_t * sum, int dim, colloid_sum_enum_t mtype) {
   MPI_Waitall(2, recv_req, status);
   sum->mload = MESSAGE_UNLOAD;
   colloid_sums_process(sum, dim);
-  free(sum->recv);
 
   /* Finish */
 
   MPI_Waitall(2, send_req, status);
-  free(sum->send);
 
   return 0;
 }
 
 /*****************************************************************************
  *
- *  colloid_sums_count
+ *  colloid_sums_plan
  *
- *  Note that we need the full extent of the cell list is each
- *  direction perpendicular to the transfer.
+ *  Record the colloids involved in the exchange in direction dim:
+ *  those in the two layers of cells at the back, then those in the
+ *  two layers at the front. Note that we need the full extent of the
+ *  cell list is each direction perpendicular to the transfer.
+ *
+ *  There are no messages at non-periodic boundaries.
  *
  *****************************************************************************/
 
-static int colloid_sums_count(colloid_sum_t * sum, const int dim) {
+static int colloid_sums_plan(colloid_sum_t * sum, int dim) {
 
-  int ic, jc, kc;
-  int n0, n1;
+  int ic;
+  int d1, d2, p, q;
+  int cell[3];
+  int n;
   int ncell[3];
+  int nonback = 0;
+  int nonforw = 0;
 
-  sum->ncount[BACKWARD] = 0;
-  sum->ncount[FORWARD] = 0;
+  assert(sum);
 
   colloids_info_ncell(sum->cinfo, ncell);
 
-  if (dim == X) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
-	colloids_info_cell_count(sum->cinfo, 0, jc, kc, &n0);
-	colloids_info_cell_count(sum->cinfo, 1, jc, kc, &n1);
-	sum->ncount[BACKWARD] += (n0 + n1);
-	colloids_info_cell_count(sum->cinfo, ncell[X],     jc, kc, &n0);
-	colloids_info_cell_count(sum->cinfo, ncell[X] + 1, jc, kc, &n1);
-	sum->ncount[FORWARD] += (n0 + n1);
+  if (sum->cs->param->periodic[dim] == 0) {
+    nonback = (sum->cs->param->mpi_cartcoords[dim] == 0);
+    nonforw = (sum->cs->param->mpi_cartcoords[dim]
+	       == sum->cs->param->mpi_cartsz[dim] - 1);
+  }
+
+  /* Perpendicular directions in the order X, Y, Z */
+
+  d1 = (dim == X) ? Y : X;
+  d2 = (dim == Z) ? Y : Z;
+
+  n = 0;
+
+  for (p = 0; p <= ncell[d1] + 1 && nonback == 0; p++) {
+    for (q = 0; q <= ncell[d2] + 1; q++) {
+      cell[d1] = p;
+      cell[d2] = q;
+      for (ic = 0; ic <= 1; ic++) {
+	cell[dim] = ic;
+	n = colloid_sums_plan_add(sum, dim, n, cell[X], cell[Y], cell[Z]);
       }
     }
   }
 
-  if (dim == Y) {
-    for (ic = 0; ic <= ncell[X] + 1; ic++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
-	colloids_info_cell_count(sum->cinfo, ic, 0, kc, &n0);
-	colloids_info_cell_count(sum->cinfo, ic, 1, kc, &n1);
-	sum->ncount[BACKWARD] += (n0 + n1);
-	colloids_info_cell_count(sum->cinfo, ic, ncell[Y],     kc, &n0);
-	colloids_info_cell_count(sum->cinfo, ic, ncell[Y] + 1, kc, &n1);
-	sum->ncount[FORWARD] += (n0 + n1);
+  sum->nplan[dim][BACKWARD] = n;
+
+  for (p = 0; p <= ncell[d1] + 1 && nonforw == 0; p++) {
+    for (q = 0; q <= ncell[d2] + 1; q++) {
+      cell[d1] = p;
+      cell[d2] = q;
+      for (ic = 0; ic <= 1; ic++) {
+	cell[dim] = ncell[dim] + ic;
+	n = colloid_sums_plan_add(sum, dim, n, cell[X], cell[Y], cell[Z]);
       }
     }
   }
 
-  if (dim == Z) {
-    for (ic = 0; ic <= ncell[X] + 1; ic++) {
-      for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-	colloids_info_cell_count(sum->cinfo, ic, jc, 0, &n0);
-	colloids_info_cell_count(sum->cinfo, ic, jc, 1, &n1);
-	sum->ncount[BACKWARD] += (n0 + n1);
-	colloids_info_cell_count(sum->cinfo, ic, jc, ncell[Z],     &n0);
-	colloids_info_cell_count(sum->cinfo, ic, jc, ncell[Z] + 1, &n1);
-	sum->ncount[FORWARD] += (n0 + n1);
-      }
+  sum->nplan[dim][FORWARD] = n - sum->nplan[dim][BACKWARD];
+  sum->occupancy[dim] = sum->cinfo->occupancy;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_sums_plan_add
+ *
+ *  Append the colloids in cell (ic, jc, kc) to the plan at position
+ *  n; return the new length.
+ *
+ *****************************************************************************/
+
+static int colloid_sums_plan_add(colloid_sum_t * sum, int dim, int n,
+				 int ic, int jc, int kc) {
+  colloid_t * pc = NULL;
+
+  assert(sum);
+
+  colloids_info_cell_list_head(sum->cinfo, ic, jc, kc, &pc);
+
+  for (; pc; pc = pc->next) {
+    if (n == sum->nalloc[dim]) {
+      int nalloc = 2*sum->nalloc[dim] + 16;
+      colloid_t ** tmp = NULL;
+      tmp = (colloid_t **) realloc(sum->plan[dim], nalloc*sizeof(colloid_t *));
+      if (tmp == NULL) pe_fatal(sum->pe, "realloc(sum->plan) failed\n");
+      sum->plan[dim] = tmp;
+      sum->nalloc[dim] = nalloc;
     }
+    sum->plan[dim][n++] = pc;
   }
 
-  if (sum->cs->param->periodic[dim] == 0) {
-    if (sum->cs->param->mpi_cartcoords[dim] == 0) sum->ncount[CS_BACK] = 0;
-    if (sum->cs->param->mpi_cartcoords[dim]
-	== sum->cs->param->mpi_cartsz[dim] - 1) sum->ncount[CS_FORW] = 0;
+  return n;
+}
+
+/*****************************************************************************
+ *
+ *  colloid_sums_reserve
+ *
+ *  Ensure send and receive buffers hold at least nbuf doubles.
+ *
+ *****************************************************************************/
+
+static int colloid_sums_reserve(colloid_sum_t * sum, int nbuf) {
+
+  assert(sum);
+
+  if (nbuf > sum->nbuf || sum->send == NULL) {
+    nbuf = imax(1, nbuf);
+    free(sum->recv);
+    free(sum->send);
+    sum->send = (double *) malloc(nbuf*sizeof(double));
+    sum->recv = (double *) malloc(nbuf*sizeof(double));
+    if (sum->send == NULL) pe_fatal(sum->pe, "malloc(sum->send) failed\n");
+    if (sum->recv == NULL) pe_fatal(sum->pe, "malloc(sum->recv) failed\n");
+    sum->nbuf = nbuf;
   }
 
   return 0;
@@ -363,83 +498,26 @@ static int colloid_sums_isend(colloid_sum_t * sum, int dim,
 
 static int colloid_sums_process(colloid_sum_t * sum, int dim) {
 
+  int n, noff;
   int nb, nf;
-  int ic, jc, kc;
-  int ncell[3];
-
-  int (* mloader_forw)(colloid_sum_t *, int, int, int, int) = NULL;
-  int (* mloader_back)(colloid_sum_t *, int, int, int, int) = NULL;
-
-  colloids_info_ncell(sum->cinfo, ncell);
+  colloid_t ** plan = NULL;
 
-  if (sum->mtype == COLLOID_SUM_STRUCTURE) mloader_forw = colloid_sums_m1;
-  if (sum->mtype == COLLOID_SUM_DYNAMICS) mloader_forw = colloid_sums_m2;
-  if (sum->mtype == COLLOID_SUM_ACTIVE) mloader_forw = colloid_sums_m3;
-  if (sum->mtype == COLLOID_SUM_CONSERVATION) mloader_forw = colloid_sums_m4;
+  assert(sum);
 
-  assert(mloader_forw);
-  mloader_back = mloader_forw;
+  plan = sum->plan[dim];
+  nb = sum->ncount[BACKWARD];
+  nf = sum->ncount[FORWARD];
 
   if (sum->mload == MESSAGE_LOAD) {
-    nb = 0;
-    nf = sum->ncount[BACKWARD];
-  }
-  else {
-    nb = sum->ncount[FORWARD];
-    nf = 0;
-  }
-
-  /* Eliminate messages at non-perioidic boundaries via dummy loader m0.
-   * This is where loader_forw and loader_back can differ. */
-
-  if (sum->cs->param->periodic[dim] == 0) {
-    ic = sum->cs->param->mpi_cartcoords[dim];
-    if (ic == 0) mloader_back = colloid_sums_m0;
-    if (ic == sum->cs->param->mpi_cartsz[dim] - 1) {
-      mloader_forw = colloid_sums_m0;
-    }
-  }
-
-  if (dim == X) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
-	nb += mloader_back(sum, 0, jc, kc, nb);
-	nb += mloader_back(sum, 1, jc, kc, nb);
-	nf += mloader_forw(sum, ncell[X], jc, kc, nf);
-	nf += mloader_forw(sum, ncell[X] + 1, jc, kc, nf);
-      }
-    }
-  }
-
-  if (dim == Y) {
-    for (ic = 0; ic <= ncell[X] + 1; ic++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
-	nb += mloader_back(sum, ic, 0, kc, nb);
-	nb += mloader_back(sum, ic, 1, kc, nb);
-	nf += mloader_forw(sum, ic, ncell[Y], kc, nf); 
-	nf += mloader_forw(sum, ic, ncell[Y] + 1, kc, nf); 
-      }
+    for (n = 0; n < nb + nf; n++) {
+      colloid_sums_message(sum, plan[n], sum->send + sum->msize*n);
     }
   }
-
-  if (dim == Z) {
-    for (ic = 0; ic <= ncell[X] + 1; ic++) {
-      for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-	nb += mloader_back(sum, ic, jc, 0, nb);
-	nb += mloader_back(sum, ic, jc, 1, nb);
-	nf += mloader_forw(sum, ic, jc, ncell[Z], nf); 
-	nf += mloader_forw(sum, ic, jc, ncell[Z] + 1, nf); 
-      }
-    }
-  }
-
-  if (sum->mload == MESSAGE_LOAD) {
-    assert(nb == sum->ncount[BACKWARD]);
-    assert(nf == sum->ncount[BACKWARD] + sum->ncount[FORWARD]);
-  }
   else {
-    assert(nb == sum->ncount[FORWARD] + sum->ncount[BACKWARD]);
-    assert(nf == sum->ncount[FORWARD]);
+    for (n = 0; n < nb + nf; n++) {
+      noff = (n < nb) ? nf + n : n - nb;
+      colloid_sums_message(sum, plan[n], sum->recv + sum->msize*noff);
+    }
   }
 
   return 0;
@@ -447,16 +525,41 @@ static int colloid_sums_process(colloid_sum_t * sum, int dim) {
 
 /*****************************************************************************
  *
- *  colloid_sums_m0
+ *  colloid_sums_message
  *
- *  Null message for non-perioidic boundaries.
+ *  Load or unload the message for one colloid: the index, then
+ *  each message type in turn.
  *
  *****************************************************************************/
 
-static int colloid_sums_m0(colloid_sum_t * sum, int ic, int jc, int kc,
-			   int noff) {
+static int colloid_sums_message(colloid_sum_t * sum, colloid_t * pc,
+				double * buf) {
+  int n = 0;
+  int nt;
+  int index;
+
+  assert(sum);
+  assert(pc);
+  assert(buf);
 
-  return 0;
+  if (sum->mload == MESSAGE_LOAD) {
+    buf[n++] = 1.0*pc->s.index;
+  }
+  else {
+    /* unload and check incoming index (a fatal error) */
+    index = (int) buf[n++];
+    if (index != pc->s.index) {
+      pe_fatal(sum->pe, "Sum mismatch (%d)\n", index);
+    }
+  }
+
+  for (nt = 0; nt < sum->ntype; nt++) {
+    n += mloader_[sum->mtype[nt]](sum, pc, buf + n);
+  }
+
+  assert(n == sum->msize);
+
+  return n;
 }
 
 /*****************************************************************************
@@ -465,60 +568,37 @@ static int colloid_sums_m0(colloid_sum_t * sum, int ic, int jc, int kc,
  *
  *  'Structure' messages cbar, rxcbar etc
  *
- *  The supplied offset for the start of the message is number of
- *  particles, so must take account of the size of the message.
+ *  Returns the number of doubles loaded or unloaded.
  *
  *****************************************************************************/
 
-static int colloid_sums_m1(colloid_sum_t * sum, int ic, int jc, int kc,
-			   int noff) {
+static int colloid_sums_m1(colloid_sum_t * sum, colloid_t * pc, double * buf) {
 
-  int n, npart;
+  int n = 0;
   int ia;
-  int index;
-  colloid_t * pc;
-
-  n = sum->msize*noff;
-  npart = 0;
-  colloids_info_cell_list_head(sum->cinfo, ic, jc, kc, &pc);
 
-  while (pc) {
-
-    if (sum->mload == MESSAGE_LOAD) {
-      sum->send[n++] = 1.0*pc->s.index;
-      sum->send[n++] = pc->sumw;
-      for (ia = 0; ia < 3; ia++) {
-	sum->send[n++] = pc->cbar[ia];
-	sum->send[n++] = pc->rxcbar[ia];
-      }
-      sum->send[n++] = pc->deltam;
-      sum->send[n++] = pc->s.deltaphi;
-
-      assert(n == (noff + npart + 1)*sum->msize);
+  if (sum->mload == MESSAGE_LOAD) {
+    buf[n++] = pc->sumw;
+    for (ia = 0; ia < 3; ia++) {
+      buf[n++] = pc->cbar[ia];
+      buf[n++] = pc->rxcbar[ia];
     }
-    else {
-      /* unload and check incoming index (a fatal error) */
-      index = (int) sum->recv[n++];
-
-      if (index != pc->s.index) {
-	pe_fatal(sum->pe, "Sum mismatch m1 (%d)\n", index);
-      }
-
-      pc->sumw += sum->recv[n++];
-      for (ia = 0; ia < 3; ia++) {
-	pc->cbar[ia] += sum->recv[n++];
-	pc->rxcbar[ia] += sum->recv[n++];
-      }
-      pc->deltam += sum->recv[n++];
-      pc->s.deltaphi += sum->recv[n++];
-      assert(n == (noff + npart + 1)*sum->msize);
+    buf[n++] = pc->deltam;
+    buf[n++] = pc->s.deltaphi;
+  }
+  else {
+    pc->sumw += buf[n++];
+    for (ia = 0; ia < 3; ia++) {
+      pc->cbar[ia] += buf[n++];
+      pc->rxcbar[ia] += buf[n++];
     }
-
-    npart++;
-    pc = pc->next;
+    pc->deltam += buf[n++];
+    pc->s.deltaphi += buf[n++];
   }
 
-  return npart;
+  assert(n == msize_[COLLOID_SUM_STRUCTURE] - 1);
+
+  return n;
 }
 
 /*****************************************************************************
@@ -529,167 +609,102 @@ static int colloid_sums_m1(colloid_sum_t * sum, int ic, int jc, int kc,
  *
  *****************************************************************************/
 
-static int colloid_sums_m2(colloid_sum_t * sum, int ic, int jc, int kc,
-			   int noff) {
+static int colloid_sums_m2(colloid_sum_t * sum, colloid_t * pc, double * buf) {
 
-  int n, npart;
+  int n = 0;
   int ia;
-  int index;
-  colloid_t * pc = NULL;
-
-  n = sum->msize*noff;
-  npart = 0;
-  colloids_info_cell_list_head(sum->cinfo, ic, jc, kc, &pc);
-
-  while (pc) {
 
-    if (sum->mload == MESSAGE_LOAD) {
-      sum->send[n++] = 1.0*pc->s.index;
-      sum->send[n++] = pc->sump;
-      for (ia = 0; ia < 3; ia++) {
-	sum->send[n++] = pc->f0[ia];
-	sum->send[n++] = pc->t0[ia];
-	sum->send[n++] = pc->force[ia];
-	sum->send[n++] = pc->torque[ia];
-      }
-      for (ia = 0; ia < 21; ia++) {
-	sum->send[n++] = pc->zeta[ia];
-      }
-      assert(n == (noff + npart + 1)*sum->msize);
+  if (sum->mload == MESSAGE_LOAD) {
+    buf[n++] = pc->sump;
+    for (ia = 0; ia < 3; ia++) {
+      buf[n++] = pc->f0[ia];
+      buf[n++] = pc->t0[ia];
+      buf[n++] = pc->force[ia];
+      buf[n++] = pc->torque[ia];
     }
-    else {
-      /* unload and check incoming index (a fatal error) */
-      index = (int) sum->recv[n++];
-      if (index != pc->s.index) {
-	pe_fatal(sum->pe, "Sum mismatch m2 (%d)\n", index);
-      }
-
-      pc->sump += sum->recv[n++];
-      for (ia = 0; ia < 3; ia++) {
-	pc->f0[ia] += sum->recv[n++];
-	pc->t0[ia] += sum->recv[n++];
-	pc->force[ia] += sum->recv[n++];
-	pc->torque[ia] += sum->recv[n++];
-      }
-      for (ia = 0; ia < 21; ia++) {
-	pc->zeta[ia] += sum->recv[n++];
-      }
-      assert(n == (noff + npart + 1)*sum->msize);
+    for (ia = 0; ia < 21; ia++) {
+      buf[n++] = pc->zeta[ia];
+    }
+  }
+  else {
+    pc->sump += buf[n++];
+    for (ia = 0; ia < 3; ia++) {
+      pc->f0[ia] += buf[n++];
+      pc->t0[ia] += buf[n++];
+      pc->force[ia] += buf[n++];
+      pc->torque[ia] += buf[n++];
+    }
+    for (ia = 0; ia < 21; ia++) {
+      pc->zeta[ia] += buf[n++];
     }
-
-    npart++;
-    pc = pc->next;
   }
 
-  return npart;
+  assert(n == msize_[COLLOID_SUM_DYNAMICS] - 1);
+
+  return n;
 }
 
 /*****************************************************************************
  *
  *  colloid_sums_m3
  *
- *  See comments for m1 above.
+ *  Active squirmer (or subgrid) corrections fc0, tc0.
  *
  *****************************************************************************/
 
-static int colloid_sums_m3(colloid_sum_t * sum, int ic, int jc, int kc,
-			   int noff) {
+static int colloid_sums_m3(colloid_sum_t * sum, colloid_t * pc, double * buf) {
 
-  int n, npart;
+  int n = 0;
   int ia;
-  int index;
-  colloid_t * pc;
-
-  n = sum->msize*noff;
-  npart = 0;
-  colloids_info_cell_list_head(sum->cinfo, ic, jc, kc, &pc);
 
-  while (pc) {
-
-    if (sum->mload == MESSAGE_LOAD) {
-      sum->send[n++] = 1.0*pc->s.index;
-      for (ia = 0; ia < 3; ia++) {
-	sum->send[n++] = pc->fc0[ia];
-	sum->send[n++] = pc->tc0[ia];
-      }
-      assert(n == (noff + npart + 1)*sum->msize);
+  if (sum->mload == MESSAGE_LOAD) {
+    for (ia = 0; ia < 3; ia++) {
+      buf[n++] = pc->fc0[ia];
+      buf[n++] = pc->tc0[ia];
     }
-    else {
-      /* unload and check incoming index (a fatal error) */
-      index = (int) sum->recv[n++];
-      if (index != pc->s.index) {
-	pe_fatal(sum->pe, "Sum mismatch m2 (%d)\n", index);
-      }
-
-      for (ia = 0; ia < 3; ia++) {
-	pc->fc0[ia] += sum->recv[n++];
-	pc->tc0[ia] += sum->recv[n++];
-      }
-      assert(n == (noff + npart + 1)*sum->msize);
+  }
+  else {
+    for (ia = 0; ia < 3; ia++) {
+      pc->fc0[ia] += buf[n++];
+      pc->tc0[ia] += buf[n++];
     }
-
-    npart++;
-    pc = pc->next;
   }
 
-  return npart;
+  assert(n == msize_[COLLOID_SUM_ACTIVE] - 1);
+
+  return n;
 }
 
 /*****************************************************************************
  *
  *  colloid_sums_m4
  *
- *  See comments for m1 above.
- *
  *  This is for conserved order parameters and related information.
  *  Note there is a slight mix of state information and non-state
  *  information in this sum; should prbably all be 'non state'.
  *
  *****************************************************************************/
 
-static int colloid_sums_m4(colloid_sum_t * sum, int ic, int jc, int kc,
-			   int noff) {
-
-  int n, npart;
-  int index;
-  colloid_t * pc;
-
-  n = msize_[sum->mtype]*noff;
-  npart = 0;
-  colloids_info_cell_list_head(sum->cinfo, ic, jc, kc, &pc);
-
-  while (pc) {
-
-    if (sum->mload == MESSAGE_LOAD) {
-      sum->send[n++] = 1.0*pc->s.index;
-      sum->send[n++] = pc->s.deltaphi;
-      sum->send[n++] = pc->dq[0];
-      sum->send[n++] = pc->dq[1];
-      sum->send[n++] = pc->s.sa;
-      sum->send[n++] = pc->s.saf;
-
-      assert(n == (noff + npart + 1)*msize_[sum->mtype]);
-    }
-    else {
-
-      /* unload and check incoming index (a fatal error) */
-      index = (int) sum->recv[n++];
-      if (index != pc->s.index) {
-	pe_fatal(sum->pe, "Sum mismatch m4 (%d)\n", index);
-      }
-
-      pc->s.deltaphi += sum->recv[n++];
-      pc->dq[0]      += sum->recv[n++];
-      pc->dq[1]      += sum->recv[n++];
-      pc->s.sa       += sum->recv[n++];
-      pc->s.saf      += sum->recv[n++];
+static int colloid_sums_m4(colloid_sum_t * sum, colloid_t * pc, double * buf) {
 
-      assert(n == (noff + npart + 1)*msize_[sum->mtype]);
-    }
+  int n = 0;
 
-    npart++;
-    pc = pc->next;
+  if (sum->mload == MESSAGE_LOAD) {
+    buf[n++] = pc->s.deltaphi;
+    buf[n++] = pc->dq[0];
+    buf[n++] = pc->dq[1];
+    buf[n++] = pc->s.sa;
+    buf[n++] = pc->s.saf;
   }
+  else {
+    pc->s.deltaphi += buf[n++];
+    pc->dq[0]      += buf[n++];
+    pc->dq[1]      += buf[n++];
+    pc->s.sa       += buf[n++];
+    pc->s.saf      += buf[n++];
+  }
+
+  assert(n == msize_[COLLOID_SUM_CONSERVATION] - 1);
 
-  return npart;
+  return n;
 }
@@ -17,8 +17,6 @@
 
 #include "colloids.h"
 
-typedef struct colloid_sum_s colloid_sum_t;
-
 typedef enum colloid_sum_enum_type {
   COLLOID_SUM_STRUCTURE = 0,
   COLLOID_SUM_DYNAMICS = 1,
@@ -32,6 +30,8 @@ typedef enum colloid_sum_enum_type {
 int colloid_sums_create(colloids_info_t * cinfo, colloid_sum_t ** psum);
 void colloid_sums_free(colloid_sum_t * sum);
 int colloid_sums_halo(colloids_info_t * cinfo, colloid_sum_enum_t type);
+int colloid_sums_halo_fused(colloids_info_t * cinfo, int ntype,
+			    const colloid_sum_enum_t * type);
 int colloid_sums_1d(colloid_sum_t * sum, int dim, colloid_sum_enum_t type);
 
 #endif
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2018 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -25,6 +25,10 @@
 #include "util.h"
 #include "colloids.h"
 #include "colloids_s.h"
+#include "colloids_nlist.h"
+#include "colloids_soa.h"
+#include "colloid_sums.h"
+
 #define RHO_DEFAULT 1.0
 #define DRMAX_DEFAULT 0.8
 
@@ -32,6 +36,9 @@
 __host__ int colloid_create(colloids_info_t * cinfo, colloid_t ** pc);
 __host__ void colloid_free(colloids_info_t * cinfo, colloid_t * pc);
 
+static int colloids_info_cell_local(colloids_info_t * cinfo,
+				    int ic, int jc, int kc);
+
 /*****************************************************************************
  *
  *  colloids_info_create
@@ -73,11 +80,22 @@ __host__ int colloids_info_create(pe_t * pe, cs_t * cs, int ncell[3],
   assert(obj->clist);
   if (obj->clist == NULL) pe_fatal(pe, "calloc(nlist, colloid_t *) failed\n");
 
+  obj->cellflag = (int *) calloc(nlist, sizeof(int));
+  assert(obj->cellflag);
+  if (obj->cellflag == NULL) pe_fatal(pe, "calloc(nlist, int) failed\n");
+
   obj->rebuild_freq = 1;
+  obj->nmodified = -1;
   obj->ncells = nlist;
   obj->rho0 = RHO_DEFAULT;
   obj->drmax = DRMAX_DEFAULT;
 
+  colloids_soa_create(pe, &obj->soa);
+
+  if (colloid_link_table_create(&obj->ltable)) {
+    pe_fatal(pe, "colloid_link_table_create() failed\n");
+  }
+
   tdpGetDeviceCount(&ndevice);
 
   if (ndevice == 0) {
@@ -106,8 +124,20 @@ __host__ void colloids_info_free(colloids_info_t * info) {
   colloids_info_cell_list_clean(info);
 
   free(info->clist);
+  free(info->cellflag);
+  free(info->handles);
+  free(info->modified);
+  if (info->nlist) colloids_nlist_free(info->nlist);
+  colloids_soa_free(info->soa);
+  if (info->sum) colloid_sums_free(info->sum);
   if (info->map_old) free(info->map_old);
   if (info->map_new) free(info->map_new);
+  if (info->changed) site_sync_free(info->changed);
+  if (info->fetch) site_sync_free(info->fetch);
+  if (info->lsites) site_sync_free(info->lsites);
+  colloid_link_table_free(info->ltable);
+
+  colloid_link_pool_free();
 
   if (info->target != info) tdpAssert(tdpFree(info->target));
 
@@ -135,6 +165,7 @@ __host__ int colloids_info_recreate(int newcell[3], colloids_info_t ** pinfo) {
 
   oldinfo = *pinfo;
   colloids_info_create(oldinfo->pe, oldinfo->cs, newcell, &newinfo);
+  newinfo->rng_seed = oldinfo->rng_seed;
 
   colloids_info_list_local_build(*pinfo);
   colloids_info_local_head(*pinfo, &pc);
@@ -266,6 +297,10 @@ __host__ int colloids_info_map_init(colloids_info_t * info) {
     pe_fatal(info->pe, "calloc (map_new) failed");
   }
 
+  site_sync_create(info->pe, nsites, &info->changed);
+  site_sync_create(info->pe, nsites, &info->fetch);
+  site_sync_create(info->pe, nsites, &info->lsites);
+
   /* Allocate data space on target */
 
   tdpGetDeviceCount(&ndevice);
@@ -418,6 +453,68 @@ __host__ int colloids_info_map_set(colloids_info_t * cinfo, int index, colloid_t
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  colloids_info_map_incremental
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_map_incremental(colloids_info_t * cinfo,
+					   int * flag) {
+  assert(cinfo);
+  assert(flag);
+
+  *flag = cinfo->map_incremental;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_info_map_incremental_set
+ *
+ *  If set, the map is updated only for particles whose lattice
+ *  footprint has changed since the last update.
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_map_incremental_set(colloids_info_t * cinfo,
+					       int flag) {
+  assert(cinfo);
+
+  cinfo->map_incremental = flag;
+  cinfo->map_valid = 0;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_info_map_modified
+ *
+ *  Record site index as changed at the current map update.
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_map_modified(colloids_info_t * cinfo, int index) {
+
+  assert(cinfo);
+  assert(cinfo->nmodified >= 0);
+  assert(index >= 0 && index < cinfo->nsites);
+
+  if (cinfo->nmodified == cinfo->nmodified_max) {
+    int nmax = 2*cinfo->nmodified_max + 1024;
+    int * tmp = (int *) realloc(cinfo->modified, nmax*sizeof(int));
+    if (tmp == NULL) pe_fatal(cinfo->pe, "realloc(cinfo->modified) failed\n");
+    cinfo->modified = tmp;
+    cinfo->nmodified_max = nmax;
+  }
+
+  cinfo->modified[cinfo->nmodified++] = index;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  colloids_info_map_update
@@ -431,6 +528,7 @@ __host__ int colloids_info_map_update(colloids_info_t * cinfo) {
 
   assert(cinfo);
 
+  tdp_host_omp(parallel for)
   for (n = 0; n < cinfo->nsites; n++) {
     cinfo->map_old[n] = NULL;
   }
@@ -620,6 +718,8 @@ int colloids_info_insert_colloid(colloids_info_t * cinfo, colloid_t * coll) {
     p_previous->next = coll;
   }
 
+  cinfo->occupancy += 1;
+
   return 0;
 }
 
@@ -663,6 +763,10 @@ __host__ int colloids_info_cell_list_clean(colloids_info_t * cinfo) {
  *  last position update. Move as necessary, or remove if the
  *  particle has left the domain completely.
  *
+ *  Locating the new cell for every particle may be shared between
+ *  threads; the relinking is serial, and visits only those cells
+ *  flagged as having a particle to move (in the original order).
+ *
  *****************************************************************************/
 
 __host__ int colloids_info_update_cell_list(colloids_info_t * cinfo) {
@@ -671,6 +775,8 @@ __host__ int colloids_info_update_cell_list(colloids_info_t * cinfo) {
   int cell[3];
   int cl_old, cl_new;
   int destroy;
+  int nhalo;
+  int ncell[3];
 
   colloid_t * p_colloid;
   colloid_t * p_previous;
@@ -678,23 +784,48 @@ __host__ int colloids_info_update_cell_list(colloids_info_t * cinfo) {
 
   assert(cinfo);
 
-  for (ic = 1 - cinfo->nhalo; ic <= cinfo->ncell[X] + cinfo->nhalo; ic++) {
-    for (jc = 1 - cinfo->nhalo; jc <= cinfo->ncell[Y] + cinfo->nhalo; jc++) {
-      for (kc = 1 - cinfo->nhalo; kc <= cinfo->ncell[Z] + cinfo->nhalo; kc++) {
+  nhalo = cinfo->nhalo;
+  ncell[X] = cinfo->ncell[X];
+  ncell[Y] = cinfo->ncell[Y];
+  ncell[Z] = cinfo->ncell[Z];
+
+  tdp_host_omp(parallel for private(jc, kc, cl_old, cell, p_colloid) schedule(dynamic))
+  for (ic = 1 - nhalo; ic <= ncell[X] + nhalo; ic++) {
+    for (jc = 1 - nhalo; jc <= ncell[Y] + nhalo; jc++) {
+      for (kc = 1 - nhalo; kc <= ncell[Z] + nhalo; kc++) {
 
 	cl_old = colloids_info_cell_index(cinfo, ic, jc, kc);
+	cinfo->cellflag[cl_old] = 0;
+
+	for (p_colloid = cinfo->clist[cl_old]; p_colloid;
+	     p_colloid = p_colloid->next) {
+	  colloids_info_cell_coords(cinfo, p_colloid->s.r, cell);
+	  if (cell[X] != ic || cell[Y] != jc || cell[Z] != kc) {
+	    cinfo->cellflag[cl_old] = 1;
+	  }
+	}
+      }
+    }
+  }
+
+  for (ic = 1 - nhalo; ic <= ncell[X] + nhalo; ic++) {
+    for (jc = 1 - nhalo; jc <= ncell[Y] + nhalo; jc++) {
+      for (kc = 1 - nhalo; kc <= ncell[Z] + nhalo; kc++) {
+
+	cl_old = colloids_info_cell_index(cinfo, ic, jc, kc);
+	if (cinfo->cellflag[cl_old] == 0) continue;
 
 	p_colloid = cinfo->clist[cl_old];
 	p_previous = p_colloid;
 
 	while (p_colloid) {
 	  colloids_info_cell_coords(cinfo, p_colloid->s.r, cell);
-	  destroy = (cell[X] < 1 - cinfo->nhalo ||
-		     cell[Y] < 1 - cinfo->nhalo ||
-		     cell[Z] < 1 - cinfo->nhalo ||
-		     cell[X] > cinfo->ncell[X] + cinfo->nhalo ||
-		     cell[Y] > cinfo->ncell[Y] + cinfo->nhalo ||
-		     cell[Z] > cinfo->ncell[Z] + cinfo->nhalo);
+	  destroy = (cell[X] < 1 - nhalo ||
+		     cell[Y] < 1 - nhalo ||
+		     cell[Z] < 1 - nhalo ||
+		     cell[X] > ncell[X] + nhalo ||
+		     cell[Y] > ncell[Y] + nhalo ||
+		     cell[Z] > ncell[Z] + nhalo);
 
 	  if (destroy) {
 	    /* This particle should be unlinked and removed. */
@@ -740,6 +871,14 @@ __host__ int colloids_info_update_cell_list(colloids_info_t * cinfo) {
 
 	      colloids_info_insert_colloid(cinfo, p_colloid);
 
+	      /* Moving between local and halo cells is a change in the
+	       * local set (cf. neighbour list) */
+
+	      if (colloids_info_cell_local(cinfo, ic, jc, kc)
+		  != colloids_info_cell_local(cinfo, cell[X], cell[Y], cell[Z])) {
+		cinfo->generation += 1;
+	      }
+
 	      p_colloid = tmp;
 	    }
 	  }
@@ -755,6 +894,23 @@ __host__ int colloids_info_update_cell_list(colloids_info_t * cinfo) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  colloids_info_cell_local
+ *
+ *  Return 1 if cell (ic, jc, kc) is local (not halo), otherwise 0.
+ *
+ *****************************************************************************/
+
+static int colloids_info_cell_local(colloids_info_t * cinfo,
+				    int ic, int jc, int kc) {
+  assert(cinfo);
+
+  return (ic >= 1 && ic <= cinfo->ncell[X] &&
+	  jc >= 1 && jc <= cinfo->ncell[Y] &&
+	  kc >= 1 && kc <= cinfo->ncell[Z]);
+}
+
 /*****************************************************************************
  *
  *  colloids_info_add_local
@@ -854,6 +1010,7 @@ __host__ int colloid_create(colloids_info_t * cinfo, colloid_t ** pc) {
   obj->s = s;
 
   cinfo->nallocated += 1;
+  cinfo->generation += 1;
   *pc = obj;
 
   return 0;
@@ -870,10 +1027,27 @@ __host__ void colloid_free(colloids_info_t * cinfo, colloid_t * pc) {
   assert(cinfo);
   assert(pc);
 
+  /* If the map still refers to this colloid, an incremental update
+   * is not possible at the next rebuild. */
+
+  if (cinfo->map_valid && pc->fpset) {
+    int ic, jc, kc, index;
+    for (ic = pc->fpbox[0]; ic <= pc->fpbox[1]; ic++) {
+      for (jc = pc->fpbox[2]; jc <= pc->fpbox[3]; jc++) {
+	for (kc = pc->fpbox[4]; kc <= pc->fpbox[5]; kc++) {
+	  index = cs_index(cinfo->cs, ic, jc, kc);
+	  if (cinfo->map_new[index] == pc) cinfo->map_valid = 0;
+	}
+      }
+    }
+  }
+
   colloid_link_free_list(pc->lnk);
   tdpAssert(tdpFree(pc));
 
   cinfo->nallocated -= 1;
+  cinfo->generation += 1;
+  cinfo->occupancy += 1;
 
   return;
 }
@@ -1011,6 +1185,50 @@ __host__ int colloids_info_all_head(colloids_info_t * cinfo, colloid_t ** pc) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  colloids_info_all_handles
+ *
+ *  All colloids (including halo) as an array in cell list order,
+ *  i.e., the order of the 'all' list. This allows loops over
+ *  colloids to be shared between threads. The array is valid until
+ *  the cell lists next change.
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_all_handles(colloids_info_t * cinfo, int * nall,
+				       colloid_t *** handles) {
+  int ic, n;
+  colloid_t * pc = NULL;
+
+  assert(cinfo);
+  assert(nall);
+  assert(handles);
+
+  n = 0;
+  for (ic = 0; ic < cinfo->ncells; ic++) {
+    for (pc = cinfo->clist[ic]; pc; pc = pc->next) n += 1;
+  }
+
+  if (n > cinfo->nhandles) {
+    free(cinfo->handles);
+    cinfo->nhandles = 2*n;
+    cinfo->handles = (colloid_t **) malloc(cinfo->nhandles*sizeof(colloid_t *));
+    assert(cinfo->handles);
+    if (cinfo->handles == NULL) pe_fatal(cinfo->pe, "malloc(handles) failed\n");
+  }
+
+  n = 0;
+  for (ic = 0; ic < cinfo->ncells; ic++) {
+    for (pc = cinfo->clist[ic]; pc; pc = pc->next) cinfo->handles[n++] = pc;
+  }
+
+  *nall = n;
+  *handles = cinfo->handles;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  colloids_info_position_update
@@ -1073,6 +1291,64 @@ __host__ int colloids_info_position_update(colloids_info_t * cinfo) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  colloids_info_nlist
+ *
+ *  Neighbour list for pair interactions (NULL if none).
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_nlist(colloids_info_t * cinfo,
+				 colloids_nlist_t ** nlist) {
+  assert(cinfo);
+  assert(nlist);
+
+  *nlist = cinfo->nlist;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_info_nlist_set
+ *
+ *  The colloids_info_t takes ownership of the list.
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_nlist_set(colloids_info_t * cinfo,
+				     colloids_nlist_t * nlist) {
+  assert(cinfo);
+
+  if (cinfo->nlist && cinfo->nlist != nlist) {
+    colloids_nlist_free(cinfo->nlist);
+  }
+
+  cinfo->nlist = nlist;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_info_soa
+ *
+ *  Packed store for the pair interactions. The caller is responsible
+ *  for building it (see colloids_soa.h).
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_soa(colloids_info_t * cinfo, colloids_soa_t ** soa) {
+
+  assert(cinfo);
+  assert(soa);
+
+  *soa = cinfo->soa;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  colloids_info_update_lists
@@ -1539,3 +1815,94 @@ int colloids_info_rebuild_freq_set(colloids_info_t * cinfo, int nfreq) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  colloids_info_rng_seed
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_rng_seed(colloids_info_t * cinfo, int * seed) {
+
+  assert(cinfo);
+  assert(seed);
+
+  *seed = cinfo->rng_seed;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_info_rng_seed_set
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_rng_seed_set(colloids_info_t * cinfo, int seed) {
+
+  assert(cinfo);
+
+  cinfo->rng_seed = seed;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_info_rng_uniform
+ *
+ *  Four uniform deviates on (0,1) from the given stream. The counter
+ *  is (i1, i2, step): i1, i2 are global quantities, e.g., the colloid
+ *  index (or the ordered indices of a pair), and a component.
+ *  Identical arguments give identical results on any process or
+ *  thread.
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_rng_uniform(colloids_info_t * cinfo,
+				       colloid_rng_enum_t stream,
+				       int i1, int i2, int step, double u[4]) {
+  unsigned int ctr[4];
+  unsigned int key[2];
+
+  assert(cinfo);
+
+  ctr[0] = (unsigned int) i1;
+  ctr[1] = (unsigned int) i2;
+  ctr[2] = (unsigned int) step;
+  ctr[3] = 0;
+  key[0] = (unsigned int) cinfo->rng_seed;
+  key[1] = (unsigned int) stream;
+
+  util_philox_uniform(ctr, key, u);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_info_rng_gaussian
+ *
+ *  As colloids_info_rng_uniform(), but four Gaussian deviates.
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_rng_gaussian(colloids_info_t * cinfo,
+					colloid_rng_enum_t stream,
+					int i1, int i2, int step, double g[4]) {
+  unsigned int ctr[4];
+  unsigned int key[2];
+
+  assert(cinfo);
+
+  ctr[0] = (unsigned int) i1;
+  ctr[1] = (unsigned int) i2;
+  ctr[2] = (unsigned int) step;
+  ctr[3] = 0;
+  key[0] = (unsigned int) cinfo->rng_seed;
+  key[1] = (unsigned int) stream;
+
+  util_philox_gaussian(ctr, key, g);
+
+  return 0;
+}
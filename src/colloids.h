@@ -45,6 +45,16 @@ struct colloid {
   double sump;          /* flux through squirmer surface */ 
   double dq[2];         /* charge remove/replace mismatch for 2 charges */
 
+  /* Lattice footprint at last map update (incremental rebuild) */
+
+  int fpset;            /* Footprint below is current */
+  int fpbox[6];         /* Local lattice box (imin, imax, jmin, ...) */
+  double fpr[3];        /* Position (local coordinates) */
+  double fpa0;          /* Radius */
+  double fpmargin;      /* Movement allowed before footprint changes */
+
+  int isoa;             /* Slot in packed store at last build */
+
   /* Pointers */
 
   colloid_link_t * lnk; /* Pointer to the list of links defining surface */
@@ -59,6 +69,20 @@ struct colloid {
 };
 
 typedef struct colloids_info_s colloids_info_t;
+typedef struct colloids_nlist_s colloids_nlist_t;
+
+/* Independent streams of random numbers for colloid stochastic terms.
+ * Each draw is keyed on the seed and the stream, and counted by
+ * global quantities only (colloid indices, time step), so results do
+ * not depend on the order of evaluation or on the decomposition. */
+
+typedef enum colloid_rng_enum {
+  COLLOID_RNG_RANDOM = 0,     /* Reserved: colloid_t random[6] */
+  COLLOID_RNG_LUBRICATION,    /* Lubrication fluctuation-dissipation */
+  COLLOID_RNG_ANCHORING       /* Planar anchoring at replaced sites */
+} colloid_rng_enum_t;
+typedef struct colloids_soa_s colloids_soa_t;
+typedef struct colloid_sum_s colloid_sum_t;
 
 __host__ int colloids_info_create(pe_t * pe, cs_t * cs, int ncell[3],
 				  colloids_info_t ** pinfo);
@@ -82,6 +106,8 @@ __host__ int colloids_info_cell_index(colloids_info_t * cinfo, int ic, int jc, i
 __host__ int colloids_info_insert_colloid(colloids_info_t * cinfo, colloid_t * coll);
 __host__ int colloids_info_cell_list_clean(colloids_info_t * cinfo);
 __host__ int colloids_info_all_head(colloids_info_t * cinfo, colloid_t ** pc);
+__host__ int colloids_info_all_handles(colloids_info_t * cinfo, int * nall,
+				       colloid_t *** handles);
 __host__ int colloids_info_local_head(colloids_info_t * cinfo, colloid_t ** pc);
 __host__ int colloids_info_cell_list_head(colloids_info_t * info,
 				 int ic, int jc, int kc, colloid_t ** pc);
@@ -101,11 +127,28 @@ __host__ int colloids_info_map_update(colloids_info_t * cinfo);
 __host__ int colloids_info_position_update(colloids_info_t * cinfo);
 __host__ int colloids_info_map_set(colloids_info_t * cinfo, int index,
 			      colloid_t * pc);
+__host__ int colloids_info_map_incremental(colloids_info_t * cinfo, int * flag);
+__host__ int colloids_info_map_incremental_set(colloids_info_t * cinfo,
+					       int flag);
+__host__ int colloids_info_map_modified(colloids_info_t * cinfo, int index);
+__host__ int colloids_info_nlist(colloids_info_t * cinfo,
+				colloids_nlist_t ** nlist);
+__host__ int colloids_info_nlist_set(colloids_info_t * cinfo,
+				    colloids_nlist_t * nlist);
+__host__ int colloids_info_soa(colloids_info_t * cinfo, colloids_soa_t ** soa);
 __host__ int colloids_info_update_lists(colloids_info_t * cinfo);
 __host__ int colloids_info_list_all_build(colloids_info_t * cinfo);
 __host__ int colloids_info_list_local_build(colloids_info_t * cinfo);
 __host__ int colloids_info_climits(colloids_info_t * cinfo, int ia, int ic, int * lim);
 __host__ int colloids_info_a0max(colloids_info_t * cinfo, double * a0max);
+__host__ int colloids_info_rng_seed(colloids_info_t * cinfo, int * seed);
+__host__ int colloids_info_rng_seed_set(colloids_info_t * cinfo, int seed);
+__host__ int colloids_info_rng_uniform(colloids_info_t * cinfo,
+				       colloid_rng_enum_t stream,
+				       int i1, int i2, int step, double u[4]);
+__host__ int colloids_info_rng_gaussian(colloids_info_t * cinfo,
+					colloid_rng_enum_t stream,
+					int i1, int i2, int step, double g[4]);
 __host__ int colloids_info_ahmax(colloids_info_t * cinfo, double * ahmax);
 __host__ int colloids_info_count_local(colloids_info_t * cinfo, colloid_type_enum_t it,
 			      int * count);
@@ -9,7 +9,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2018 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
@@ -147,32 +147,31 @@ int colloids_halo_dim(colloid_halo_t * halo, int dim) {
   assert(halo);
   assert(halo->cinfo);
 
-  /* Work out how many are currently in the 'send' region, and
-   * communicate the information to work out recv count */
+  /* Work out how many are currently in the 'send' region; load the
+   * send buffer and send. */
 
   colloids_halo_send_count(halo, dim, NULL);
-  colloids_halo_number(halo, dim);
-
-  /* Allocate the send and recv buffer, and post recvs */
 
   n = halo->nsend[FORWARD] + halo->nsend[BACKWARD];
   halo->send = (colloid_state_t *) malloc(imax(1,n)*sizeof(colloid_state_t));
   assert(halo->send);
+  if (halo->send == NULL) pe_fatal(halo->pe, "halo malloc(send_) failed\n");
+
+  colloids_halo_load(halo, dim);
+  colloids_halo_isend(halo, dim, request_send);
+
+  /* The size of the incoming messages gives the recv count, so no
+   * separate exchange of counts is required. */
+
+  colloids_halo_number(halo, dim);
 
   n = halo->nrecv[FORWARD] + halo->nrecv[BACKWARD];
   halo->recv = (colloid_state_t *) malloc(imax(1,n)*sizeof(colloid_state_t));
   assert(halo->recv);
-
-  if (halo->send == NULL) pe_fatal(halo->pe, "halo malloc(send_) failed\n");
   if (halo->recv == NULL) pe_fatal(halo->pe, "halo malloc(recv_) failed\n");
 
   colloids_halo_irecv(halo, dim, request_recv);
 
-  /* Load the send buffer and send */
-
-  colloids_halo_load(halo, dim);
-  colloids_halo_isend(halo, dim, request_send);
-
   /* Wait for the receives, unload the recv buffer, and finish */
 
   MPI_Waitall(2, request_recv, status);
@@ -423,6 +422,8 @@ static int colloids_halo_unload(colloid_halo_t * halo, int nrecv) {
  *
  *  colloids_halo_irecv
  *
+ *  This 'progresses the message' in serial (for periodic boundaries).
+ *
  *****************************************************************************/
 
 static int colloids_halo_irecv(colloid_halo_t * halo, int dim,
@@ -438,7 +439,13 @@ static int colloids_halo_irecv(colloid_halo_t * halo, int dim,
   req[0] = MPI_REQUEST_NULL;
   req[1] = MPI_REQUEST_NULL;
 
-  if (halo->cs->param->mpi_cartsz[dim] > 1) {
+  if (halo->cs->param->mpi_cartsz[dim] == 1) {
+    if (halo->cs->param->periodic[dim]) {
+      n = halo->nsend[CS_FORW] + halo->nsend[CS_BACK];
+      memcpy(halo->recv, halo->send, n*sizeof(colloid_state_t));
+    }
+  }
+  else {
     comm  = halo->cs->commcart;
     pforw = halo->cs->mpi_cart_neighbours[CS_FORW][dim];
     pback = halo->cs->mpi_cart_neighbours[CS_BACK][dim];
@@ -458,7 +465,8 @@ static int colloids_halo_irecv(colloid_halo_t * halo, int dim,
  *
  *  colloids_halo_isend
  *
- *  This 'progresses the message' in serial (for periodic boundaries).
+ *  Messages are always sent (even if empty), as the receiving side
+ *  relies on them to determine the count.
  *
  *****************************************************************************/
 
@@ -472,17 +480,10 @@ static int colloids_halo_isend(colloid_halo_t * halo, int dim,
 
   assert(halo);
 
-  if (halo->cs->param->mpi_cartsz[dim] == 1) {
-
-    if (halo->cs->param->periodic[dim]) {
-      n = halo->nsend[CS_FORW] + halo->nsend[CS_BACK];
-      memcpy(halo->recv, halo->send, n*sizeof(colloid_state_t));
-    }
+  req[0] = MPI_REQUEST_NULL;
+  req[1] = MPI_REQUEST_NULL;
 
-    req[0] = MPI_REQUEST_NULL;
-    req[1] = MPI_REQUEST_NULL;
-  }
-  else {
+  if (halo->cs->param->mpi_cartsz[dim] > 1) {
 
     comm = halo->cs->commcart;
     pforw = halo->cs->mpi_cart_neighbours[CS_FORW][dim];
@@ -503,15 +504,18 @@ static int colloids_halo_isend(colloid_halo_t * halo, int dim,
  *
  *  colloids_halo_number
  *
+ *  In parallel, probe the incoming messages (already sent) for their
+ *  size.
+ *
  *****************************************************************************/
 
 static int colloids_halo_number(colloid_halo_t * halo, int dim) {
 
+  int nbytes;
   int pforw, pback;
 
   MPI_Comm    comm;
-  MPI_Request request[4];
-  MPI_Status  status[4];
+  MPI_Status  status;
 
   assert(halo);
 
@@ -525,16 +529,13 @@ static int colloids_halo_number(colloid_halo_t * halo, int dim) {
     pforw = halo->cs->mpi_cart_neighbours[CS_FORW][dim];
     pback = halo->cs->mpi_cart_neighbours[CS_BACK][dim];
 
-    MPI_Irecv(halo->nrecv + FORWARD, 1, MPI_INT, pforw, tagb_, comm,
-	      request);
-    MPI_Irecv(halo->nrecv + BACKWARD, 1, MPI_INT, pback, tagf_, comm,
-	      request + 1);
-    MPI_Issend(halo->nsend + FORWARD, 1, MPI_INT, pforw, tagf_, comm,
-	       request + 2);
-    MPI_Issend(halo->nsend + BACKWARD, 1, MPI_INT, pback, tagb_, comm,
-	       request + 3);
+    MPI_Probe(pforw, tagb_, comm, &status);
+    MPI_Get_count(&status, MPI_BYTE, &nbytes);
+    halo->nrecv[FORWARD] = nbytes/sizeof(colloid_state_t);
 
-    MPI_Waitall(4, request, status);
+    MPI_Probe(pback, tagf_, comm, &status);
+    MPI_Get_count(&status, MPI_BYTE, &nbytes);
+    halo->nrecv[BACKWARD] = nbytes/sizeof(colloid_state_t);
   }
 
   /* Non periodic boundaries receive no particles */
@@ -0,0 +1,355 @@
+/*****************************************************************************
+ *
+ *  colloids_nlist.c
+ *
+ *  Verlet neighbour list for colloid pair interactions.
+ *
+ *  Pairs found by the usual cell list search are retained if the
+ *  separation is within the interaction range plus a skin. The
+ *  list then remains valid until some colloid has moved more than
+ *  half the skin, or the set of local colloids has changed (colloids
+ *  created, destroyed, or moved between local and halo cells).
+ *
+ *  The cell width must be at least the interaction range plus the
+ *  skin (cf. interact_range_check()).
+ *
+ *  Pairs are recorded as slots in the packed store (colloids_soa.h),
+ *  which is rebuilt along with the list, and only gathered otherwise.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "util.h"
+#include "colloids_s.h"
+#include "colloids_nlist.h"
+#include "colloids_soa.h"
+
+static int colloids_nlist_add(colloids_nlist_t * nlist, int i1, int i2);
+static int colloids_nlist_drmax(colloids_nlist_t * nlist, colloids_soa_t * soa,
+				double * drmax);
+
+/*****************************************************************************
+ *
+ *  colloids_nlist_create
+ *
+ *  rc is the centre-centre range, and hc the surface-surface range,
+ *  of the interactions to be computed.
+ *
+ *****************************************************************************/
+
+int colloids_nlist_create(pe_t * pe, cs_t * cs, double rc, double hc,
+			  double skin, colloids_nlist_t ** pobj) {
+
+  colloids_nlist_t * obj = NULL;
+
+  assert(pe);
+  assert(cs);
+  assert(skin >= 0.0);
+  assert(pobj);
+
+  obj = (colloids_nlist_t *) calloc(1, sizeof(colloids_nlist_t));
+  assert(obj);
+  if (obj == NULL) pe_fatal(pe, "calloc(colloids_nlist_t) failed\n");
+
+  obj->pe = pe;
+  obj->cs = cs;
+  obj->rc = rc;
+  obj->hc = hc;
+  obj->skin = skin;
+
+  *pobj = obj;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_nlist_free
+ *
+ *****************************************************************************/
+
+int colloids_nlist_free(colloids_nlist_t * nlist) {
+
+  int ia;
+
+  assert(nlist);
+
+  for (ia = 0; ia < 3; ia++) {
+    free(nlist->fpair[ia]);
+    free(nlist->rlist[ia]);
+  }
+  free(nlist->vpair);
+  free(nlist->i2);
+  free(nlist->i1);
+  free(nlist);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_nlist_update
+ *
+ *  Rebuild the list if required. The decision is local: the halo
+ *  copies are included in the displacement check.
+ *
+ *  On return the packed store is current in either case.
+ *
+ *****************************************************************************/
+
+int colloids_nlist_update(colloids_nlist_t * nlist, colloids_info_t * cinfo) {
+
+  int rebuild;
+  double drmax = 0.0;
+  colloids_soa_t * soa = NULL;
+
+  assert(nlist);
+  assert(cinfo);
+
+  colloids_info_soa(cinfo, &soa);
+
+  rebuild = (nlist->nbuild == 0 || nlist->generation != cinfo->generation);
+  if (soa->nbuild != nlist->soabuild) rebuild = 1;
+
+  if (rebuild == 0) {
+    colloids_soa_gather(soa);
+    colloids_nlist_drmax(nlist, soa, &drmax);
+  }
+
+  if (2.0*drmax > nlist->skin) rebuild = 1;
+
+  if (rebuild) colloids_nlist_build(nlist, cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_nlist_build
+ *
+ *  The search visits pairs in the same order as the cell list loops
+ *  in the pair potentials, so the accumulation of forces is
+ *  unchanged. The packed store is rebuilt first.
+ *
+ *****************************************************************************/
+
+int colloids_nlist_build(colloids_nlist_t * nlist, colloids_info_t * cinfo) {
+
+  int ic1, jc1, kc1, ic2, jc2, kc2;
+  int di[2], dj[2], dk[2];
+  int ncell[3];
+  int c1, c2, i, j, n, ia;
+  double r1[3], r2[3], r12[3];
+  double r, rmax;
+  colloids_soa_t * soa = NULL;
+
+  assert(nlist);
+  assert(cinfo);
+
+  colloids_info_soa(cinfo, &soa);
+  colloids_soa_build(soa, cinfo);
+
+  nlist->npair = 0;
+  colloids_info_ncell(cinfo, ncell);
+
+  for (ic1 = 1; ic1 <= ncell[X]; ic1++) {
+    colloids_info_climits(cinfo, X, ic1, di);
+    for (jc1 = 1; jc1 <= ncell[Y]; jc1++) {
+      colloids_info_climits(cinfo, Y, jc1, dj);
+      for (kc1 = 1; kc1 <= ncell[Z]; kc1++) {
+        colloids_info_climits(cinfo, Z, kc1, dk);
+
+	c1 = colloids_info_cell_index(cinfo, ic1, jc1, kc1);
+	for (i = soa->cstart[c1]; i < soa->cstart[c1 + 1]; i++) {
+
+	  r1[X] = soa->r[X][i];
+	  r1[Y] = soa->r[Y][i];
+	  r1[Z] = soa->r[Z][i];
+
+          for (ic2 = di[0]; ic2 <= di[1]; ic2++) {
+            for (jc2 = dj[0]; jc2 <= dj[1]; jc2++) {
+              for (kc2 = dk[0]; kc2 <= dk[1]; kc2++) {
+
+		c2 = colloids_info_cell_index(cinfo, ic2, jc2, kc2);
+		for (j = soa->cstart[c2]; j < soa->cstart[c2 + 1]; j++) {
+
+		  if (soa->index[i] >= soa->index[j]) continue;
+
+		  r2[X] = soa->r[X][j];
+		  r2[Y] = soa->r[Y][j];
+		  r2[Z] = soa->r[Z][j];
+		  cs_minimum_distance(nlist->cs, r1, r2, r12);
+		  r = modulus(r12);
+		  rmax = dmax(nlist->rc, nlist->hc + soa->ah[i] + soa->ah[j]);
+
+		  if (r < rmax + nlist->skin) colloids_nlist_add(nlist, i, j);
+		}
+	      }
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  /* Reference positions for all colloids (including halo) */
+
+  if (soa->nall > nlist->nralloc) {
+    nlist->nralloc = 2*soa->nall + 64;
+    for (ia = 0; ia < 3; ia++) {
+      free(nlist->rlist[ia]);
+      nlist->rlist[ia] = (double *) malloc(nlist->nralloc*sizeof(double));
+      assert(nlist->rlist[ia]);
+      if (nlist->rlist[ia] == NULL) {
+	pe_fatal(nlist->pe, "malloc(nlist->rlist) failed\n");
+      }
+    }
+  }
+
+  for (n = 0; n < soa->nall; n++) {
+    nlist->rlist[X][n] = soa->r[X][n];
+    nlist->rlist[Y][n] = soa->r[Y][n];
+    nlist->rlist[Z][n] = soa->r[Z][n];
+  }
+
+  nlist->generation = cinfo->generation;
+  nlist->soabuild = soa->nbuild;
+  nlist->nbuild += 1;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_nlist_nbuild
+ *
+ *****************************************************************************/
+
+int colloids_nlist_nbuild(colloids_nlist_t * nlist, int * nbuild) {
+
+  assert(nlist);
+  assert(nbuild);
+
+  *nbuild = nlist->nbuild;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_nlist_pair_sum
+ *
+ *  Add the pair forces in the work space to the store (fpair[n] to
+ *  slot i2[n], and minus fpair[n] to slot i1[n]), and the potential
+ *  to vsum. This is in list order, so the result does not depend on
+ *  how the pairs were computed.
+ *
+ *****************************************************************************/
+
+int colloids_nlist_pair_sum(colloids_nlist_t * nlist, colloids_soa_t * soa,
+			    double * vsum) {
+  int n, ia;
+
+  assert(nlist);
+  assert(soa);
+  assert(vsum);
+  assert(soa->nbuild == nlist->soabuild);
+
+  for (n = 0; n < nlist->npair; n++) {
+    for (ia = 0; ia < 3; ia++) {
+      soa->force[ia][nlist->i1[n]] -= nlist->fpair[ia][n];
+      soa->force[ia][nlist->i2[n]] += nlist->fpair[ia][n];
+    }
+    *vsum += nlist->vpair[n];
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_nlist_add
+ *
+ *****************************************************************************/
+
+static int colloids_nlist_add(colloids_nlist_t * nlist, int i1, int i2) {
+
+  assert(nlist);
+
+  if (nlist->npair == nlist->nalloc) {
+    int ia;
+    int ifail = 0;
+    int nalloc = 2*nlist->nalloc + 64;
+    int * tmp1 = NULL;
+    int * tmp2 = NULL;
+
+    tmp1 = (int *) realloc(nlist->i1, nalloc*sizeof(int));
+    if (tmp1) nlist->i1 = tmp1;
+    tmp2 = (int *) realloc(nlist->i2, nalloc*sizeof(int));
+    if (tmp2) nlist->i2 = tmp2;
+    if (tmp1 == NULL || tmp2 == NULL) ifail = 1;
+
+    /* Work space contents are not retained */
+
+    for (ia = 0; ia < 3; ia++) {
+      free(nlist->fpair[ia]);
+      nlist->fpair[ia] = (double *) malloc(nalloc*sizeof(double));
+      if (nlist->fpair[ia] == NULL) ifail = 1;
+    }
+    free(nlist->vpair);
+    nlist->vpair = (double *) malloc(nalloc*sizeof(double));
+    if (nlist->vpair == NULL) ifail = 1;
+
+    if (ifail) pe_fatal(nlist->pe, "realloc(colloids_nlist_t) failed\n");
+    nlist->nalloc = nalloc;
+  }
+
+  nlist->i1[nlist->npair] = i1;
+  nlist->i2[nlist->npair] = i2;
+  nlist->npair += 1;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_nlist_drmax
+ *
+ *  Maximum displacement since the last build (including halo).
+ *  The store must have been gathered.
+ *
+ *****************************************************************************/
+
+static int colloids_nlist_drmax(colloids_nlist_t * nlist, colloids_soa_t * soa,
+				double * drmax) {
+  int n;
+  double dr[3];
+  double dr2, dr2max = 0.0;
+
+  assert(nlist);
+  assert(soa);
+  assert(drmax);
+
+  for (n = 0; n < soa->nall; n++) {
+    dr[X] = soa->r[X][n] - nlist->rlist[X][n];
+    dr[Y] = soa->r[Y][n] - nlist->rlist[Y][n];
+    dr[Z] = soa->r[Z][n] - nlist->rlist[Z][n];
+    dr2 = dr[X]*dr[X] + dr[Y]*dr[Y] + dr[Z]*dr[Z];
+    if (dr2 > dr2max) dr2max = dr2;
+  }
+
+  *drmax = sqrt(dr2max);
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+/*****************************************************************************
+ *
+ *  colloids_nlist.h
+ *
+ *  Verlet neighbour list for colloid pair interactions.
+ *
+ *  The implementation is exposed for the time being.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_COLLOIDS_NLIST_H
+#define LUDWIG_COLLOIDS_NLIST_H
+
+#include "pe.h"
+#include "coords.h"
+#include "colloids.h"
+
+/* Half list: each pair of slots (i1[n], i2[n]) in the packed store
+ * appears once, with i1 local and index[i1] < index[i2], in the order
+ * of the cell list search. The slots, and rlist, are valid until the
+ * next build.
+ *
+ * A pair potential may compute all pairs independently into the work
+ * space fpair and vpair (e.g., with threads), and then add them to the
+ * store in list order via colloids_nlist_pair_sum(). */
+
+struct colloids_nlist_s {
+  pe_t * pe;
+  cs_t * cs;
+  double rc;              /* Centre-centre cut off */
+  double hc;              /* Surface-surface cut off */
+  double skin;            /* Extra range retained in list */
+  int generation;         /* colloids_info_t generation at last build */
+  int nbuild;             /* Number of builds so far */
+  int soabuild;           /* Packed store build the slots refer to */
+  int nalloc;             /* Capacity (pairs) */
+  int npair;              /* Current number of pairs */
+  int * i1;               /* First member of pair */
+  int * i2;               /* Second member of pair */
+  int nralloc;            /* Capacity (reference positions) */
+  double * rlist[3];      /* Position of each slot at last build */
+  double * fpair[3];      /* Work space: force on i2 (pair n) */
+  double * vpair;         /* Work space: potential (pair n) */
+};
+
+int colloids_nlist_create(pe_t * pe, cs_t * cs, double rc, double hc,
+			  double skin, colloids_nlist_t ** pobj);
+int colloids_nlist_free(colloids_nlist_t * nlist);
+int colloids_nlist_build(colloids_nlist_t * nlist, colloids_info_t * cinfo);
+int colloids_nlist_update(colloids_nlist_t * nlist, colloids_info_t * cinfo);
+int colloids_nlist_nbuild(colloids_nlist_t * nlist, int * nbuild);
+int colloids_nlist_pair_sum(colloids_nlist_t * nlist, colloids_soa_t * soa,
+			    double * vsum);
+
+#endif
@@ -36,6 +36,7 @@
 #include "colloids_init.h"
 #include "colloid_io_rt.h"
 #include "colloids_rt.h"
+#include "ewald_pme.h"
 
 #include "bbl.h"
 #include "build.h"
@@ -141,6 +142,18 @@ int colloids_init_rt(pe_t * pe, rt_t * rt, cs_t * cs, colloids_info_t ** pinfo,
   bond_fene_init(pe, cs, rt, *interact);
   angle_cosine_init(pe, cs, rt, *interact);
 
+  /* Neighbour list (non-default only reported) */
+
+  {
+    double skin = 0.0;
+
+    if (rt_double_parameter(rt, "colloid_nlist_skin", &skin)) {
+      if (skin < 0.0) pe_fatal(pe, "colloid_nlist_skin must be >= 0\n");
+      interact_skin_set(*interact, skin);
+      pe_info(pe, "Neighbour list skin:          %14.7e\n", skin);
+    }
+  }
+
   colloids_rt_cell_list_checks(pe, cs, pinfo, *interact);
   colloids_init_halo_range_check(pe, cs, *pinfo);
   if (nc > 1) interact_range_check(*interact, *pinfo);
@@ -171,6 +184,24 @@ int colloids_init_rt(pe_t * pe, rt_t * rt, cs_t * cs, colloids_info_t ** pinfo,
       colloids_info_rebuild_freq_set(*pinfo, nfreq);
       pe_info(pe, "Colloid rebuild freq:         %d\n", nfreq);
     }
+
+    /* Map and links rebuilt only for particles which have moved */
+
+    if (rt_switch(rt, "colloid_rebuild_incremental")) {
+      colloids_info_map_incremental_set(*pinfo, 1);
+      pe_info(pe, "Colloid rebuild:              incremental\n");
+    }
+  }
+
+  /* Seed for colloid stochastic terms (non-default only reported) */
+
+  {
+    int seed = 0;
+
+    if (rt_int_parameter(rt, "colloid_random_seed", &seed)) {
+      colloids_info_rng_seed_set(*pinfo, seed);
+      pe_info(pe, "Colloid random seed:          %d\n", seed);
+    }
   }
 
   pe_info(pe, "\n");
@@ -551,6 +582,7 @@ int colloids_rt_cell_list_checks(pe_t * pe, cs_t * cs,
 
   double a0max, ahmax;  /* maximum radii */
   double rcmax, hcmax;  /* Interaction ranges */
+  double skin;          /* Neighbour list skin */
   double rmax;          /* Maximum interaction range */
   double wcell[3];      /* Final cell widths */
 
@@ -590,7 +622,8 @@ int colloids_rt_cell_list_checks(pe_t * pe, cs_t * cs,
     colloids_info_ahmax(*pinfo, &ahmax);
     interact_rcmax(interact, &rcmax);
     interact_hcmax(interact, &hcmax);
-    rmax = dmax(2.0*ahmax + hcmax, rcmax);
+    interact_skin(interact, &skin);
+    rmax = dmax(2.0*ahmax + hcmax, rcmax) + skin;
     rmax = dmax(rmax, 1.5); /* subgrid particles again */
     nbest[X] = (int) floor(1.0*nlocal[X] / rmax);
     nbest[Y] = (int) floor(1.0*nlocal[Y] / rmax);
@@ -630,8 +663,11 @@ int colloids_init_ewald_rt(pe_t * pe, rt_t * rt, cs_t * cs,
   int ncolloid;
   int iarg;
   int is_required = 0;
+  int order = EWALD_PME_ORDER_DEFAULT;
+  int mesh[3] = {0, 0, 0};
   double mu;               /* Dipole strength */
   double rc;               /* Real space cut off */
+  char method[BUFSIZ] = "direct";
 
   assert(cinfo);
 
@@ -649,6 +685,20 @@ int colloids_init_ewald_rt(pe_t * pe, rt_t * rt, cs_t * cs,
 
     ewald_create(pe, cs, mu, rc, cinfo, pewald);
     assert(*pewald);
+
+    /* Fourier space sum: "direct" (default) or "pme" */
+
+    rt_string_parameter(rt, "ewald_fourier_method", method, BUFSIZ);
+
+    if (strcmp(method, "pme") == 0) {
+      rt_int_parameter(rt, "ewald_pme_order", &order);
+      rt_int_parameter_vector(rt, "ewald_pme_mesh", mesh);
+      ewald_fourier_pme_set(*pewald, order, mesh);
+    }
+    else if (strcmp(method, "direct") != 0) {
+      pe_fatal(pe, "ewald_fourier_method not recognised: %s\n", method);
+    }
+
     ewald_info(*pewald); 
   }
 
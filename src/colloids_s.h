@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2018 The University of Edinburgh
+ *  (c) 2012-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -20,6 +20,7 @@
 #include "pe.h"
 #include "coords.h"
 #include "colloids.h"
+#include "site_sync.h"
 
 struct colloids_info_s {
 
@@ -32,6 +33,7 @@ struct colloids_info_s {
   int ncells;                 /* Total number of cells */
 
   int rebuild_freq;           /* Rebuild shape every so many steps */
+  int rng_seed;               /* Seed (key) for colloid random numbers */
 
   double rho0;                /* Mean density (usually matches fluid) */
   double drmax;               /* Maximum movement per time step */
@@ -39,7 +41,27 @@ struct colloids_info_s {
   colloid_t ** clist;         /* Cell list pointers */
   colloid_t ** map_old;       /* Map (previous time step) pointers */
   colloid_t ** map_new;       /* Map (current time step) pointers */
+
+  int map_incremental;        /* Rebuild map for moved particles only */
+  int map_valid;              /* Footprints consistent with map */
+  int nmodified;              /* Sites changed at last update (-1 all) */
+  int nmodified_max;          /* Capacity of modified */
+  int * modified;             /* Indices of sites changed */
+  site_sync_t * changed;      /* Sites changed at last rebuild (host/target) */
+  site_sync_t * fetch;        /* Sites read on host at last rebuild */
+  colloid_link_table_t * ltable; /* Flat copy of links at last rebuild */
+  site_sync_t * lsites;       /* Link end points at last rebuild */
+
+  int generation;             /* Changes if local/halo set changes */
+  int occupancy;              /* Changes if any cell list changes */
+  colloids_nlist_t * nlist;   /* Neighbour list (may be NULL) */
+  colloids_soa_t * soa;       /* Packed store for pair loops */
+  colloid_sum_t * sum;        /* Halo sum plan (may be NULL) */
+
   colloid_t * headall;        /* All colloid list (incl. halo) head */
+  colloid_t ** handles;       /* All colloids (incl. halo) as an array */
+  int nhandles;               /* Capacity of handles */
+  int * cellflag;             /* Work space [ncells] */
   colloid_t * headlocal;      /* Local list (excl. halo) head */
 
   pe_t * pe;                  /* Parallel environment */
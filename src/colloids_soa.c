@@ -0,0 +1,275 @@
+/*****************************************************************************
+ *
+ *  colloids_soa.c
+ *
+ *  Packed (structure-of-arrays) copy of the colloid quantities used
+ *  by the pair interactions.
+ *
+ *  The colloid_t remains the owner of the state: the store is built
+ *  from the cell list, refreshed by a gather before the pair loops,
+ *  and the accumulated force and torque scattered back afterwards.
+ *  The pair loops then see unit-stride arrays indexed by slot rather
+ *  than chasing pointers.
+ *
+ *  The build is a counting sort of all colloids (including halo) by
+ *  cell; within a cell the cell list order is retained, so a loop
+ *  over slots visits pairs in exactly the order of the cell list.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "colloids_s.h"
+#include "colloids_soa.h"
+
+static int colloids_soa_reserve(colloids_soa_t * soa, int nall);
+
+/*****************************************************************************
+ *
+ *  colloids_soa_create
+ *
+ *****************************************************************************/
+
+int colloids_soa_create(pe_t * pe, colloids_soa_t ** pobj) {
+
+  colloids_soa_t * obj = NULL;
+
+  assert(pe);
+  assert(pobj);
+
+  obj = (colloids_soa_t *) calloc(1, sizeof(colloids_soa_t));
+  assert(obj);
+  if (obj == NULL) pe_fatal(pe, "calloc(colloids_soa_t) failed\n");
+
+  obj->pe = pe;
+  obj->generation = -1;
+
+  *pobj = obj;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_soa_free
+ *
+ *****************************************************************************/
+
+int colloids_soa_free(colloids_soa_t * soa) {
+
+  int ia;
+
+  assert(soa);
+
+  for (ia = 0; ia < 3; ia++) {
+    free(soa->torque[ia]);
+    free(soa->force[ia]);
+    free(soa->v[ia]);
+    free(soa->r[ia]);
+  }
+  free(soa->ah);
+  free(soa->pc);
+  free(soa->index);
+  free(soa->cstart);
+  free(soa);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_soa_build
+ *
+ *  Sort by cell and gather. If the resulting order of colloids is
+ *  different, the previous slots are invalidated (nbuild changes).
+ *
+ *****************************************************************************/
+
+int colloids_soa_build(colloids_soa_t * soa, colloids_info_t * cinfo) {
+
+  int ic, n, nall;
+  int changed;
+  colloid_t * pc = NULL;
+
+  assert(soa);
+  assert(cinfo);
+
+  if (soa->ncells != cinfo->ncells) {
+    free(soa->cstart);
+    soa->cstart = (int *) calloc(cinfo->ncells + 1, sizeof(int));
+    assert(soa->cstart);
+    if (soa->cstart == NULL) pe_fatal(soa->pe, "calloc(soa->cstart) failed\n");
+    soa->ncells = cinfo->ncells;
+  }
+
+  /* Count, and offsets */
+
+  nall = 0;
+  for (ic = 0; ic < cinfo->ncells; ic++) {
+    soa->cstart[ic] = nall;
+    for (pc = cinfo->clist[ic]; pc; pc = pc->next) nall += 1;
+  }
+  soa->cstart[cinfo->ncells] = nall;
+
+  changed = (nall != soa->nall || nall > soa->nalloc || soa->nbuild == 0);
+  colloids_soa_reserve(soa, nall);
+
+  /* Handles */
+
+  for (ic = 0; ic < cinfo->ncells; ic++) {
+    n = soa->cstart[ic];
+    for (pc = cinfo->clist[ic]; pc; pc = pc->next) {
+      if (soa->pc[n] != pc) changed = 1;
+      pc->isoa = n;
+      soa->pc[n++] = pc;
+    }
+    assert(n == soa->cstart[ic + 1]);
+  }
+
+  soa->nall = nall;
+  soa->generation = cinfo->generation;
+  soa->nbuild += changed;
+
+  colloids_soa_gather(soa);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_soa_gather
+ *
+ *  Refresh all quantities from the handles. The slots must be
+ *  current (no colloid created or destroyed since the build).
+ *
+ *****************************************************************************/
+
+int colloids_soa_gather(colloids_soa_t * soa) {
+
+  int n, ia;
+  colloid_t * pc = NULL;
+
+  assert(soa);
+
+  for (n = 0; n < soa->nall; n++) {
+    pc = soa->pc[n];
+    assert(pc->isoa == n);
+    soa->index[n] = pc->s.index;
+    soa->ah[n] = pc->s.ah;
+    for (ia = 0; ia < 3; ia++) {
+      soa->r[ia][n] = pc->s.r[ia];
+      soa->v[ia][n] = pc->s.v[ia];
+      soa->force[ia][n] = pc->force[ia];
+      soa->torque[ia][n] = pc->torque[ia];
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_soa_scatter
+ *
+ *  Return the force and torque to the handles.
+ *
+ *****************************************************************************/
+
+int colloids_soa_scatter(colloids_soa_t * soa) {
+
+  int n, ia;
+  colloid_t * pc = NULL;
+
+  assert(soa);
+
+  for (n = 0; n < soa->nall; n++) {
+    pc = soa->pc[n];
+    for (ia = 0; ia < 3; ia++) {
+      pc->force[ia] = soa->force[ia][n];
+      pc->torque[ia] = soa->torque[ia][n];
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_soa_pair_add
+ *
+ *  Add pair force f to slot j, and -f to slot i.
+ *
+ *****************************************************************************/
+
+int colloids_soa_pair_add(colloids_soa_t * soa, int i, int j,
+			  const double f[3]) {
+  assert(soa);
+  assert(0 <= i && i < soa->nall);
+  assert(0 <= j && j < soa->nall);
+
+  soa->force[X][i] -= f[X];
+  soa->force[Y][i] -= f[Y];
+  soa->force[Z][i] -= f[Z];
+  soa->force[X][j] += f[X];
+  soa->force[Y][j] += f[Y];
+  soa->force[Z][j] += f[Z];
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_soa_reserve
+ *
+ *  Ensure capacity for at least nall colloids. Contents are not
+ *  preserved.
+ *
+ *****************************************************************************/
+
+static int colloids_soa_reserve(colloids_soa_t * soa, int nall) {
+
+  int ia;
+  int ifail = 0;
+  int nalloc;
+
+  assert(soa);
+
+  if (nall <= soa->nalloc) return 0;
+
+  nalloc = 2*nall + 64;
+
+  free(soa->index);
+  free(soa->pc);
+  free(soa->ah);
+  soa->index = (int *) malloc(nalloc*sizeof(int));
+  soa->pc = (colloid_t **) malloc(nalloc*sizeof(colloid_t *));
+  soa->ah = (double *) malloc(nalloc*sizeof(double));
+  if (soa->index == NULL || soa->pc == NULL || soa->ah == NULL) ifail = 1;
+
+  for (ia = 0; ia < 3; ia++) {
+    free(soa->r[ia]);
+    free(soa->v[ia]);
+    free(soa->force[ia]);
+    free(soa->torque[ia]);
+    soa->r[ia] = (double *) malloc(nalloc*sizeof(double));
+    soa->v[ia] = (double *) malloc(nalloc*sizeof(double));
+    soa->force[ia] = (double *) malloc(nalloc*sizeof(double));
+    soa->torque[ia] = (double *) malloc(nalloc*sizeof(double));
+    if (soa->r[ia] == NULL || soa->v[ia] == NULL) ifail = 1;
+    if (soa->force[ia] == NULL || soa->torque[ia] == NULL) ifail = 1;
+  }
+
+  if (ifail) pe_fatal(soa->pe, "malloc(colloids_soa_t) failed\n");
+  soa->nalloc = nalloc;
+
+  return 0;
+}
@@ -0,0 +1,57 @@
+/*****************************************************************************
+ *
+ *  colloids_soa.h
+ *
+ *  Packed (structure-of-arrays) copy of the colloid quantities used
+ *  by the pair interactions.
+ *
+ *  The implementation is exposed for the time being.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_COLLOIDS_SOA_H
+#define LUDWIG_COLLOIDS_SOA_H
+
+#include "pe.h"
+#include "colloids.h"
+
+/* Slots are ordered by cell (including halo cells), and within a
+ * cell in the order of the cell list. Cell c occupies the slots
+ * cstart[c] <= n < cstart[c+1]. Slots are stable until a build
+ * changes the order (nbuild is then incremented); pc[n] is the
+ * handle for slot n, and pc[n]->isoa == n. */
+
+struct colloids_soa_s {
+  pe_t * pe;
+  int generation;         /* colloids_info_t generation at last build */
+  int nbuild;             /* Number of builds which changed slots */
+  int ncells;             /* Number of cells */
+  int nalloc;             /* Capacity (colloids) */
+  int nall;               /* Current number of colloids (incl. halo) */
+  int * cstart;           /* Cell offsets [ncells + 1] */
+  int * index;            /* Colloid index s.index */
+  colloid_t ** pc;        /* Handles */
+  double * ah;            /* Hydrodynamic radius */
+  double * r[3];          /* Position */
+  double * v[3];          /* Velocity */
+  double * force[3];      /* Force */
+  double * torque[3];     /* Torque */
+};
+
+int colloids_soa_create(pe_t * pe, colloids_soa_t ** pobj);
+int colloids_soa_free(colloids_soa_t * soa);
+int colloids_soa_build(colloids_soa_t * soa, colloids_info_t * cinfo);
+int colloids_soa_gather(colloids_soa_t * soa);
+int colloids_soa_scatter(colloids_soa_t * soa);
+int colloids_soa_pair_add(colloids_soa_t * soa, int i, int j,
+			  const double f[3]);
+
+#endif
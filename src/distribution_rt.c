@@ -46,6 +46,8 @@ int lb_run_time(pe_t * pe, cs_t * cs, rt_t * rt, lb_t * lb) {
 
   int ndist;
   int nreduced;
+  int naa = 0;
+  int ndevice;
   int io_grid[3] = {1, 1, 1};
   char string[FILENAME_MAX] = "";
   char memory = ' ';
@@ -88,9 +90,31 @@ int lb_run_time(pe_t * pe, cs_t * cs, rt_t * rt, lb_t * lb) {
 
   pe_info(pe, "Model:            d%dq%d %c\n", NDIM, NVEL, memory);
   pe_info(pe, "SIMD vector len:  %d\n", NSIMDVL);
+  pe_info(pe, "Storage precision: %s\n",
+	  (sizeof(lb_data_t) == sizeof(float)) ? "float" : "double");
   pe_info(pe, "Number of sets:   %d\n", ndist);
   pe_info(pe, "Halo type:        %s\n", (nreduced == 1) ? "reduced" : "full");
 
+  /* AA-pattern in-place propagation (default off). Must be set
+   * before lb_init() as there is then no second buffer. */
+
+  rt_string_parameter(rt, "lb_aa_propagation", string, FILENAME_MAX);
+  if (strcmp(string, "on") == 0) {
+    tdpGetDeviceCount(&ndevice);
+    if (ndist != 1) {
+      pe_fatal(pe, "lb_aa_propagation requires a single distribution\n");
+    }
+    if (ndevice > 0) {
+      pe_fatal(pe, "lb_aa_propagation is not available for device\n");
+    }
+    if (nreduced) {
+      pe_fatal(pe, "lb_aa_propagation requires a full halo\n");
+    }
+    naa = 1;
+    lb_aa_set(lb, naa);
+    pe_info(pe, "Propagation:      AA pattern (in place)\n");
+  }
+
   if (strcmp("BINARY_SERIAL", string) == 0) {
     pe_info(pe, "Input format:     binary single serial file\n");
     io_info_set_processor_independent(io_info);
@@ -108,6 +132,14 @@ int lb_run_time(pe_t * pe, cs_t * cs, rt_t * rt, lb_t * lb) {
 
   pe_info(pe, "I/O grid:         %d %d %d\n", io_grid[X], io_grid[Y], io_grid[Z]);
 
+  /* Collective MPI-IO for binary (decomposition-independent) files */
+
+  if (rt_switch(rt, "distribution_io_mpiio")) {
+    io_info_mpiio_set(io_info, 1);
+    pe_info(pe, "I/O method:       MPI-IO (collective, single file)\n");
+  }
+  io_info_report_set(io_info, rt_switch(rt, "distribution_io_report"));
+
   lb_io_info_set(lb, io_info, form_in, form_out);
 
   /* Density io_info:
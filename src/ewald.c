@@ -7,10 +7,13 @@
  *
  *  See, for example, Allen and Tildesley, Computer Simulation of Liquids.
  *
+ *  The Fourier space part may optionally be computed via smooth
+ *  particle-mesh Ewald (see ewald_pme.c).
+ *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2007-2018 The University of Edinburgh.
+ *  (c) 2007-2019 The University of Edinburgh.
  *
  *  Contributing authors:
  *  Grace Kim
@@ -26,31 +29,33 @@
 #include "coords.h"
 #include "colloids.h"
 #include "ewald.h"
+#include "ewald_pme.h"
 #include "timer.h"
 #include "util.h"
 
-static int ewald_on_ = 0;
-static int nk_[3];
-static int nkmax_;
-static int nktot_;
-static double ewald_rc_ = 0.0;
-static double kappa_ = 0.0;
-static double kmax_;
-static double rpi_;
-static double mu_;
-
-static double ereal_ = 0.0;
-static double efourier_ = 0.0;
-
-static double * sinx_;   /* The term S(k) for each k */
-static double * cosx_;   /* The term C(k) for each k */
-static double * sinkr_;  /* Table for sin(kr) values */
-static double * coskr_;  /* Table for cos(kr) values */
-
 struct ewald_s {
   pe_t * pe;                 /* Parallel environment */
   cs_t * cs;                 /* Coordinate system */
   colloids_info_t * cinfo;   /* Retain a reference to colloids_info_t */
+
+  int nk[3];                 /* Largest wavevector index in each direction */
+  int nkmax;                 /* Size of sin(kr), cos(kr) tables */
+  int nktot;                 /* Total terms in Fourier space sum */
+  double rc;                 /* Real space cut off */
+  double kappa;              /* Ewald parameter */
+  double kmax;               /* Maximum square wavevector */
+  double rpi;                /* 1/sqrt(pi) */
+  double mu;                 /* Dipole strength */
+
+  double ereal;              /* Real space energy */
+  double efourier;           /* Fourier space energy */
+
+  double * sinx;             /* The term S(k) for each k */
+  double * cosx;             /* The term C(k) for each k */
+  double * sinkr;            /* Table for sin(kr) values */
+  double * coskr;            /* Table for cos(kr) values */
+
+  ewald_pme_t * pme;         /* Particle-mesh Fourier space sum (optional) */
 };
 
 static int ewald_sum_sin_cos_terms(ewald_t * ewald);
@@ -93,33 +98,32 @@ int ewald_create(pe_t * pe, cs_t * cs, double mu_input, double rc_input,
 
   /* Set constants */
 
-  rpi_      = 1.0/sqrt(pi);
-  mu_       = mu_input;
-  ewald_rc_ = rc_input;
-  ewald_on_ = 1;
-  kappa_    = 5.0/(2.0*ewald_rc_);
+  ewald->rpi   = 1.0/sqrt(pi);
+  ewald->mu    = mu_input;
+  ewald->rc    = rc_input;
+  ewald->kappa = 5.0/(2.0*ewald->rc);
 
-  nk = ceil(kappa_*kappa_*ewald_rc_*ltot[X]/pi);
+  nk = ceil(ewald->kappa*ewald->kappa*ewald->rc*ltot[X]/pi);
 
-  nk_[X] = nk;
-  nk_[Y] = nk;
-  nk_[Z] = nk;
-  kmax_ = pow(2.0*pi*nk/ltot[X], 2);
-  nkmax_ = nk + 1;
-  nktot_ = ewald_get_number_fourier_terms(ewald);
-  assert(nktot_ > 0);
+  ewald->nk[X] = nk;
+  ewald->nk[Y] = nk;
+  ewald->nk[Z] = nk;
+  ewald->kmax = pow(2.0*pi*nk/ltot[X], 2);
+  ewald->nkmax = nk + 1;
+  ewald->nktot = ewald_get_number_fourier_terms(ewald);
+  assert(ewald->nktot > 0);
 
-  sinx_ = (double *) malloc(nktot_*sizeof(double));
-  cosx_ = (double *) malloc(nktot_*sizeof(double));
+  ewald->sinx = (double *) malloc(ewald->nktot*sizeof(double));
+  ewald->cosx = (double *) malloc(ewald->nktot*sizeof(double));
 
-  if (sinx_ == NULL) pe_fatal(pe, "Ewald sum malloc(sinx_) failed\n");
-  if (cosx_ == NULL) pe_fatal(pe, "Ewald sum malloc(cosx_) failed\n");
+  if (ewald->sinx == NULL) pe_fatal(pe, "Ewald sum malloc(sinx) failed\n");
+  if (ewald->cosx == NULL) pe_fatal(pe, "Ewald sum malloc(cosx) failed\n");
 
-  sinkr_ = (double *) malloc(3*nkmax_*sizeof(double));
-  coskr_ = (double *) malloc(3*nkmax_*sizeof(double));
+  ewald->sinkr = (double *) malloc(3*ewald->nkmax*sizeof(double));
+  ewald->coskr = (double *) malloc(3*ewald->nkmax*sizeof(double));
 
-  if (sinkr_ == NULL) pe_fatal(pe, "Ewald sum malloc(sinx_) failed\n");
-  if (coskr_ == NULL) pe_fatal(pe, "Ewald sum malloc(cosx_) failed\n");
+  if (ewald->sinkr == NULL) pe_fatal(pe, "Ewald sum malloc(sinkr) failed\n");
+  if (ewald->coskr == NULL) pe_fatal(pe, "Ewald sum malloc(coskr) failed\n");
 
   *pewald = ewald;
 
@@ -135,6 +139,12 @@ int ewald_create(pe_t * pe, cs_t * cs, double mu_input, double rc_input,
 int ewald_free(ewald_t * ewald) {
 
   assert(ewald);
+
+  if (ewald->pme) ewald_pme_free(ewald->pme);
+  free(ewald->coskr);
+  free(ewald->sinkr);
+  free(ewald->cosx);
+  free(ewald->sinx);
   free(ewald);
 
   return 0;
@@ -150,23 +160,38 @@ int ewald_info(ewald_t * ewald) {
 
   int ncolloid;
   double eself;
+  pe_t * pe = NULL;
 
   assert(ewald);
 
+  pe = ewald->pe;
   colloids_info_ntotal(ewald->cinfo, &ncolloid);
   ewald_self_energy(ewald, &eself);
 
-  pe_info(ewald->pe, "\n");
-  pe_info(ewald->pe, "Ewald sum\n");
-  pe_info(ewald->pe, "---------\n");
-  pe_info(ewald->pe, "Number of particles:                      %d\n", ncolloid);
-  pe_info(ewald->pe, "Real space cut off:                      %14.7e\n", ewald_rc_);
-  pe_info(ewald->pe, "Dipole strength mu:                      %14.7e\n", mu_);
-  pe_info(ewald->pe, "Ewald parameter kappa:                   %14.7e\n", kappa_);
-  pe_info(ewald->pe, "Self energy (constant):                  %14.7e\n", eself);
-  pe_info(ewald->pe, "Maximum square wavevector:               %14.7e\n", kmax_);
-  pe_info(ewald->pe, "Max. term retained in Fourier space sum:  %d\n", nkmax_);
-  pe_info(ewald->pe, "Total terms kept in Fourier space sum:    %d\n\n", nktot_);
+  pe_info(pe, "\n");
+  pe_info(pe, "Ewald sum\n");
+  pe_info(pe, "---------\n");
+  pe_info(pe, "Number of particles:                      %d\n", ncolloid);
+  pe_info(pe, "Real space cut off:                      %14.7e\n", ewald->rc);
+  pe_info(pe, "Dipole strength mu:                      %14.7e\n", ewald->mu);
+  pe_info(pe, "Ewald parameter kappa:                   %14.7e\n", ewald->kappa);
+  pe_info(pe, "Self energy (constant):                  %14.7e\n", eself);
+  pe_info(pe, "Maximum square wavevector:               %14.7e\n", ewald->kmax);
+  pe_info(pe, "Max. term retained in Fourier space sum:  %d\n", ewald->nkmax);
+  pe_info(pe, "Total terms kept in Fourier space sum:    %d\n", ewald->nktot);
+
+  if (ewald->pme) {
+    int order;
+    int mesh[3];
+    ewald_pme_order(ewald->pme, &order);
+    ewald_pme_mesh(ewald->pme, mesh);
+    pe_info(pe, "Fourier space method:                     PME\n");
+    pe_info(pe, "PME B-spline order:                       %d\n", order);
+    pe_info(pe, "PME mesh:                                 %d %d %d\n",
+	    mesh[X], mesh[Y], mesh[Z]);
+  }
+
+  pe_info(pe, "\n");
 
   return 0;
 }
@@ -184,29 +209,47 @@ int ewald_kappa(ewald_t * ewald, double * kappa) {
   assert(ewald);
   assert(kappa);
 
-  *kappa = kappa_;
+  *kappa = ewald->kappa;
 
   return 0;
 }
 
 /*****************************************************************************
  *
- *  ewald_finish
+ *  ewald_fourier_pme_set
+ *
+ *  Use smooth particle-mesh Ewald for the Fourier space sum with
+ *  B-spline order "order" (the accuracy parameter). If mesh is NULL,
+ *  or any element is zero, the mesh defaults to the smallest power
+ *  of two exceeding 2nk + 1 in each direction. The wavevector
+ *  cut off is the same as that of the direct sum.
  *
  *****************************************************************************/
 
-void ewald_finish() {
+int ewald_fourier_pme_set(ewald_t * ewald, int order, const int mesh[3]) {
+
+  int ia;
+  int kmesh[3];
+
+  assert(ewald);
 
-  if (ewald_on_) {
-    free(sinx_);
-    free(cosx_);
-    free(sinkr_);
-    free(coskr_);
+  for (ia = 0; ia < 3; ia++) {
+    if (mesh == NULL || mesh[ia] == 0) {
+      kmesh[ia] = 1;
+      while (kmesh[ia] <= 2*ewald->nk[ia] + 1) kmesh[ia] *= 2;
+    }
+    else {
+      kmesh[ia] = mesh[ia];
+    }
   }
 
-  ewald_on_ = 0;
-  assert(0); /* TODO clear me up */
-  return;
+  if (ewald->pme) ewald_pme_free(ewald->pme);
+
+  ewald_pme_create(ewald->pe, ewald->cs, order, kmesh, &ewald->pme);
+  ewald_pme_influence_set(ewald->pme, ewald->mu, ewald->kappa, ewald->kmax,
+			  ewald->nk);
+
+  return 0;
 }
 
 /*****************************************************************************
@@ -225,7 +268,12 @@ int ewald_sum(ewald_t * ewald) {
 
   TIMER_start(TIMER_EWALD_TOTAL);
 
-  ewald_fourier_space_sum(ewald);
+  if (ewald->pme) {
+    ewald_fourier_space_sum_pme(ewald);
+  }
+  else {
+    ewald_fourier_space_sum(ewald);
+  }
   ewald_real_space_sum(ewald);
 
   TIMER_stop(TIMER_EWALD_TOTAL);
@@ -245,23 +293,26 @@ int ewald_real_space_energy(ewald_t * ewald, const double u1[3],
 			    const double u2[3], const double r12[3],
 			    double * ereal) {
   double r;
+  double mu, kappa;
 
   assert(ewald);
   assert(ereal);
 
   *ereal = 0.0;
+  mu = ewald->mu;
+  kappa = ewald->kappa;
 
   r = sqrt(r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z]);
 
-  if (r < ewald_rc_) {
+  if (r < ewald->rc) {
     double rr = 1.0/r;
     double b, b1, b2, c;
 
-    b1 = mu_*mu_*erfc(kappa_*r)*(rr*rr*rr);
-    b2 = mu_*mu_*(2.0*kappa_*rpi_)*exp(-kappa_*kappa_*r*r)*(rr*rr);
+    b1 = mu*mu*erfc(kappa*r)*(rr*rr*rr);
+    b2 = mu*mu*(2.0*kappa*ewald->rpi)*exp(-kappa*kappa*r*r)*(rr*rr);
 
     b = b1 + b2;
-    c = 3.0*b1*rr*rr + (2.0*kappa_*kappa_ + 3.0*rr*rr)*b2;
+    c = 3.0*b1*rr*rr + (2.0*kappa*kappa + 3.0*rr*rr)*b2;
 
     *ereal = dot_product(u1,u2)*b - dot_product(u1,r12)*dot_product(u2,r12)*c;
   }
@@ -285,6 +336,8 @@ int ewald_fourier_space_energy(ewald_t * ewald, double * ef) {
   double b0, b;
   double r4kappa_sq;
   double ltot[3];
+  double * sinx = NULL;
+  double * cosx = NULL;
   int kx, ky, kz, kn = 0;
   PI_DOUBLE(pi);
 
@@ -292,32 +345,34 @@ int ewald_fourier_space_energy(ewald_t * ewald, double * ef) {
 
   cs_ltot(ewald->cs, ltot);
   ewald_sum_sin_cos_terms(ewald);
+  sinx = ewald->sinx;
+  cosx = ewald->cosx;
 
   fkx = 2.0*pi/ltot[X];
   fky = 2.0*pi/ltot[Y];
   fkz = 2.0*pi/ltot[Z];
-  b0 = (4.0*pi/(ltot[X]*ltot[Y]*ltot[Z]))*mu_*mu_;
-  r4kappa_sq = 1.0/(4.0*kappa_*kappa_);
+  b0 = (4.0*pi/(ltot[X]*ltot[Y]*ltot[Z]))*ewald->mu*ewald->mu;
+  r4kappa_sq = 1.0/(4.0*ewald->kappa*ewald->kappa);
 
   /* Sum over k to get the energy. */
 
-  for (kz = 0; kz <= nk_[Z]; kz++) {
-    for (ky = -nk_[Y]; ky <= nk_[Y]; ky++) {
-      for (kx = -nk_[X]; kx <= nk_[X]; kx++) {
+  for (kz = 0; kz <= ewald->nk[Z]; kz++) {
+    for (ky = -ewald->nk[Y]; ky <= ewald->nk[Y]; ky++) {
+      for (kx = -ewald->nk[X]; kx <= ewald->nk[X]; kx++) {
 
         k[X] = fkx*kx;
         k[Y] = fky*ky;
         k[Z] = fkz*kz;
         ksq = k[X]*k[X] + k[Y]*k[Y] + k[Z]*k[Z];
 
-        if (ksq <= 0.0 || ksq > kmax_) continue;
+        if (ksq <= 0.0 || ksq > ewald->kmax) continue;
 
         b = b0*exp(-r4kappa_sq*ksq)/ksq;
 	if (kz == 0) {
-	  e += 0.5*b*(sinx_[kn]*sinx_[kn] + cosx_[kn]*cosx_[kn]);
+	  e += 0.5*b*(sinx[kn]*sinx[kn] + cosx[kn]*cosx[kn]);
 	}
 	else {
-	  e +=     b*(sinx_[kn]*sinx_[kn] + cosx_[kn]*cosx_[kn]);
+	  e +=     b*(sinx[kn]*sinx[kn] + cosx[kn]*cosx[kn]);
 	}
 	kn++;
       }
@@ -334,8 +389,8 @@ int ewald_fourier_space_energy(ewald_t * ewald, double * ef) {
  *  ewald_sum_sin_cos_terms
  *
  *  For each k, for the Fourier space sum, we need
- *      sinx_ = \sum_i u_i.k sin(k.r_i)    i.e., S(k)
- *      cosx_ = \sum_i u_i.k cos(k.r_i)    i.e., C(k)
+ *      ewald->sinx = \sum_i u_i.k sin(k.r_i)    i.e., S(k)
+ *      ewald->cosx = \sum_i u_i.k cos(k.r_i)    i.e., C(k)
  *
  *****************************************************************************/
 
@@ -364,9 +419,9 @@ static int ewald_sum_sin_cos_terms(ewald_t * ewald) {
 
   /* Comupte S(k) and C(k) from sum over particles */
 
-  for (kn = 0; kn < nktot_; kn++) {
-    sinx_[kn] = 0.0;
-    cosx_[kn] = 0.0;
+  for (kn = 0; kn < ewald->nktot; kn++) {
+    ewald->sinx[kn] = 0.0;
+    ewald->cosx[kn] = 0.0;
   }
 
   for (ic = 1; ic <= ncell[X]; ic++) {
@@ -383,9 +438,9 @@ static int ewald_sum_sin_cos_terms(ewald_t * ewald) {
 
 	  ewald_set_kr_table(ewald, p_colloid->s.r);
 
-	  for (kz = 0; kz <= nk_[Z]; kz++) {
-	    for (ky = -nk_[Y]; ky <= nk_[Y]; ky++) {
-	      for (kx = -nk_[X]; kx <= nk_[X]; kx++) {
+	  for (kz = 0; kz <= ewald->nk[Z]; kz++) {
+	    for (ky = -ewald->nk[Y]; ky <= ewald->nk[Y]; ky++) {
+	      for (kx = -ewald->nk[X]; kx <= ewald->nk[X]; kx++) {
 		double udotk, kdotr;
 		double skr[3], ckr[3];
 
@@ -394,14 +449,14 @@ static int ewald_sum_sin_cos_terms(ewald_t * ewald) {
 		k[Z] = fkz*kz;
 		ksq = k[X]*k[X] + k[Y]*k[Y] + k[Z]*k[Z];
 
-		if (ksq <= 0.0 || ksq > kmax_) continue;
+		if (ksq <= 0.0 || ksq > ewald->kmax) continue;
 
-		skr[X] = sinkr_[3*abs(kx) + X];
-		skr[Y] = sinkr_[3*abs(ky) + Y];
-		skr[Z] = sinkr_[3*kz      + Z];
-		ckr[X] = coskr_[3*abs(kx) + X];
-		ckr[Y] = coskr_[3*abs(ky) + Y];
-		ckr[Z] = coskr_[3*kz      + Z];
+		skr[X] = ewald->sinkr[3*abs(kx) + X];
+		skr[Y] = ewald->sinkr[3*abs(ky) + Y];
+		skr[Z] = ewald->sinkr[3*kz      + Z];
+		ckr[X] = ewald->coskr[3*abs(kx) + X];
+		ckr[Y] = ewald->coskr[3*abs(ky) + Y];
+		ckr[Z] = ewald->coskr[3*kz      + Z];
 
 		if (kx < 0) skr[X] = -skr[X];
 		if (ky < 0) skr[Y] = -skr[Y];
@@ -410,11 +465,11 @@ static int ewald_sum_sin_cos_terms(ewald_t * ewald) {
 
 		kdotr = skr[X]*ckr[Y]*ckr[Z] + ckr[X]*skr[Y]*ckr[Z]
 		  + ckr[X]*ckr[Y]*skr[Z] - skr[X]*skr[Y]*skr[Z];
-		sinx_[kn] += udotk*kdotr;
+		ewald->sinx[kn] += udotk*kdotr;
 
 		kdotr = ckr[X]*ckr[Y]*ckr[Z] - ckr[X]*skr[Y]*skr[Z]
 		  - skr[X]*ckr[Y]*skr[Z] - skr[X]*skr[Y]*ckr[Z];
-		cosx_[kn] += udotk*kdotr;
+		ewald->cosx[kn] += udotk*kdotr;
 
 		kn++;
 	      }
@@ -427,21 +482,21 @@ static int ewald_sum_sin_cos_terms(ewald_t * ewald) {
     }
   }
 
-  subsin = (double *) calloc(nktot_, sizeof(double));
-  subcos = (double *) calloc(nktot_, sizeof(double));
+  subsin = (double *) calloc(ewald->nktot, sizeof(double));
+  subcos = (double *) calloc(ewald->nktot, sizeof(double));
   assert(subsin);
   assert(subcos);
   if (subsin == NULL) pe_fatal(ewald->pe, "calloc(subsin) failed\n");
   if (subcos == NULL) pe_fatal(ewald->pe, "calloc(subcos) failed\n");
 
-  for (kn = 0; kn < nktot_; kn++) {
-    subsin[kn] = sinx_[kn];
-    subcos[kn] = cosx_[kn];
+  for (kn = 0; kn < ewald->nktot; kn++) {
+    subsin[kn] = ewald->sinx[kn];
+    subcos[kn] = ewald->cosx[kn];
   }
 
   cs_cart_comm(ewald->cs, &comm);
-  MPI_Allreduce(subsin, sinx_, nktot_, MPI_DOUBLE, MPI_SUM, comm);
-  MPI_Allreduce(subcos, cosx_, nktot_, MPI_DOUBLE, MPI_SUM, comm);
+  MPI_Allreduce(subsin, ewald->sinx, ewald->nktot, MPI_DOUBLE, MPI_SUM, comm);
+  MPI_Allreduce(subcos, ewald->cosx, ewald->nktot, MPI_DOUBLE, MPI_SUM, comm);
 
   free(subsin);
   free(subcos);
@@ -460,12 +515,14 @@ static int ewald_sum_sin_cos_terms(ewald_t * ewald) {
 int ewald_self_energy(ewald_t * ewald, double * eself) {
 
   int ntotal;
+  double kappa;
   PI_DOUBLE(pi);
 
   assert(ewald);
   colloids_info_ntotal(ewald->cinfo, &ntotal);
 
-  *eself = -2.0*mu_*mu_*(kappa_*kappa_*kappa_/(3.0*sqrt(pi)))*ntotal;
+  kappa = ewald->kappa;
+  *eself = -2.0*ewald->mu*ewald->mu*(kappa*kappa*kappa/(3.0*sqrt(pi)))*ntotal;
 
   return 0;
 }
@@ -482,8 +539,8 @@ int ewald_total_energy(ewald_t * ewald, double * ereal, double * efour,
 		       double * eself) {
 
   if (ewald) {
-    *ereal = ereal_;
-    *efour = efourier_;
+    *ereal = ewald->ereal;
+    *efour = ewald->efourier;
     ewald_self_energy(ewald, eself);
   }
   else {
@@ -513,13 +570,16 @@ int ewald_real_space_sum(ewald_t * ewald) {
   int ncell[3];
 
   double r12[3];
+  double mu, kappa;
 
   TIMER_start(TIMER_EWALD_REAL_SPACE);
 
   assert(ewald);
   colloids_info_ncell(ewald->cinfo, ncell);
 
-  ereal_ = 0.0;
+  mu = ewald->mu;
+  kappa = ewald->kappa;
+  ewald->ereal = 0.0;
 
   for (ic = 1; ic <= ncell[X]; ic++) {
     for (jc = 1; jc <= ncell[Y]; jc++) {
@@ -548,7 +608,7 @@ int ewald_real_space_sum(ewald_t * ewald) {
 		    cs_minimum_distance(ewald->cs, p_c2->s.r, p_c1->s.r, r12);
 		    r = sqrt(r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z]);
 
-		    if (r < ewald_rc_) {
+		    if (r < ewald->rc) {
 		      double rr = 1.0/r;
 		      double b, b1, b2, c, d;
 		      double udotu, u1dotr, u2dotr;
@@ -556,20 +616,20 @@ int ewald_real_space_sum(ewald_t * ewald) {
 		      int i;
 
 		      /* Energy */
-		      b1 = mu_*mu_*erfc(kappa_*r)*(rr*rr*rr);
-		      b2 = mu_*mu_*(2.0*kappa_*rpi_)
-			*exp(-kappa_*kappa_*r*r)*(rr*rr);
+		      b1 = mu*mu*erfc(kappa*r)*(rr*rr*rr);
+		      b2 = mu*mu*(2.0*kappa*ewald->rpi)
+			*exp(-kappa*kappa*r*r)*(rr*rr);
 
 		      b = b1 + b2;
-		      c = 3.0*b1*rr*rr + (2.0*kappa_*kappa_ + 3.0*rr*rr)*b2;
+		      c = 3.0*b1*rr*rr + (2.0*kappa*kappa + 3.0*rr*rr)*b2;
 		      d = 5.0*c/(r*r)
-			+ 4.0*kappa_*kappa_*kappa_*kappa_*b2;
+			+ 4.0*kappa*kappa*kappa*kappa*b2;
 
 		      udotu  = dot_product(p_c1->s.s, p_c2->s.s);
 		      u1dotr = dot_product(p_c1->s.s, r12);
 		      u2dotr = dot_product(p_c2->s.s, r12);
 
-		      ereal_ += udotu*b - u1dotr*u2dotr*c;
+		      ewald->ereal += udotu*b - u1dotr*u2dotr*c;
 
 		      /* Force */
 
@@ -659,8 +719,8 @@ int ewald_fourier_space_sum(ewald_t * ewald) {
   fkx = 2.0*pi/ltot[X];
   fky = 2.0*pi/ltot[Y];
   fkz = 2.0*pi/ltot[Z];
-  r4kappa_sq = 1.0/(4.0*kappa_*kappa_);
-  b0 = (4.0*pi/(ltot[X]*ltot[Y]*ltot[Z]))*mu_*mu_;
+  r4kappa_sq = 1.0/(4.0*ewald->kappa*ewald->kappa);
+  b0 = (4.0*pi/(ltot[X]*ltot[Y]*ltot[Z]))*ewald->mu*ewald->mu;
 
   colloids_info_ncell(ewald->cinfo, ncell);
 
@@ -686,12 +746,12 @@ int ewald_fourier_space_sum(ewald_t * ewald) {
 	    t[i] = 0.0;
 	  }
 
-	  efourier_ = 0.0; /* Count only once! */
+	  ewald->efourier = 0.0; /* Count only once! */
 
 	  kn = 0;
-	  for (kz = 0; kz <= nk_[Z]; kz++) {
-	    for (ky = -nk_[Y]; ky <= nk_[Y]; ky++) {
-	      for (kx = -nk_[X]; kx <= nk_[X]; kx++) {
+	  for (kz = 0; kz <= ewald->nk[Z]; kz++) {
+	    for (ky = -ewald->nk[Y]; ky <= ewald->nk[Y]; ky++) {
+	      for (kx = -ewald->nk[X]; kx <= ewald->nk[X]; kx++) {
 
 		double udotk, g[3];
 		double coskr, sinkr, ckr[3], skr[3];
@@ -701,20 +761,21 @@ int ewald_fourier_space_sum(ewald_t * ewald) {
 		k[Z] = fkz*kz;
 		ksq = k[X]*k[X] + k[Y]*k[Y] + k[Z]*k[Z];
 
-		if (ksq <= 0.0 || ksq > kmax_) continue;		
+		if (ksq <= 0.0 || ksq > ewald->kmax) continue;		
 		b = b0*exp(-r4kappa_sq*ksq)/ksq;
 
 		/* Energy */ 
 
 		if (kz > 0) b *= 2.0; 
-		efourier_ += 0.5*b*(sinx_[kn]*sinx_[kn] + cosx_[kn]*cosx_[kn]);
+		ewald->efourier += 0.5*b*(ewald->sinx[kn]*ewald->sinx[kn]
+					  + ewald->cosx[kn]*ewald->cosx[kn]);
 
-		skr[X] = sinkr_[3*abs(kx) + X];
-		skr[Y] = sinkr_[3*abs(ky) + Y];
-		skr[Z] = sinkr_[3*kz      + Z];
-		ckr[X] = coskr_[3*abs(kx) + X];
-		ckr[Y] = coskr_[3*abs(ky) + Y];
-		ckr[Z] = coskr_[3*kz      + Z];
+		skr[X] = ewald->sinkr[3*abs(kx) + X];
+		skr[Y] = ewald->sinkr[3*abs(ky) + Y];
+		skr[Z] = ewald->sinkr[3*kz      + Z];
+		ckr[X] = ewald->coskr[3*abs(kx) + X];
+		ckr[Y] = ewald->coskr[3*abs(ky) + Y];
+		ckr[Z] = ewald->coskr[3*kz      + Z];
 
 		if (kx < 0) skr[X] = -skr[X];
 		if (ky < 0) skr[Y] = -skr[Y];
@@ -730,8 +791,8 @@ int ewald_fourier_space_sum(ewald_t * ewald) {
 		udotk = dot_product(p_colloid->s.s, k);
 
 		for (i = 0; i < 3; i++) {
-		  f[i] += b*k[i]*udotk*(cosx_[kn]*sinkr - sinx_[kn]*coskr);
-		  g[i] =  b*k[i]*(cosx_[kn]*coskr + sinx_[kn]*sinkr);
+		  f[i] += b*k[i]*udotk*(ewald->cosx[kn]*sinkr - ewald->sinx[kn]*coskr);
+		  g[i] =  b*k[i]*(ewald->cosx[kn]*coskr + ewald->sinx[kn]*sinkr);
 		}
 
 		t[X] += -(p_colloid->s.s[Y]*g[Z] - p_colloid->s.s[Z]*g[Y]);
@@ -763,6 +824,28 @@ int ewald_fourier_space_sum(ewald_t * ewald) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  ewald_fourier_space_sum_pme
+ *
+ *  As ewald_fourier_space_sum(), but via particle-mesh Ewald.
+ *
+ *****************************************************************************/
+
+int ewald_fourier_space_sum_pme(ewald_t * ewald) {
+
+  assert(ewald);
+  assert(ewald->pme);
+
+  TIMER_start(TIMER_EWALD_FOURIER_SPACE);
+
+  ewald_pme_sum(ewald->pme, ewald->cinfo, &ewald->efourier);
+
+  TIMER_stop(TIMER_EWALD_FOURIER_SPACE);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  ewald_get_number_fourier_terms
@@ -789,16 +872,16 @@ static int ewald_get_number_fourier_terms(ewald_t * ewald) {
   fky = 2.0*pi/ltot[Y];
   fkz = 2.0*pi/ltot[Z];
 
-  for (kz = 0; kz <= nk_[Z]; kz++) {
-    for (ky = -nk_[Y]; ky <= nk_[Y]; ky++) {
-      for (kx = -nk_[X]; kx <= nk_[X]; kx++) {
+  for (kz = 0; kz <= ewald->nk[Z]; kz++) {
+    for (ky = -ewald->nk[Y]; ky <= ewald->nk[Y]; ky++) {
+      for (kx = -ewald->nk[X]; kx <= ewald->nk[X]; kx++) {
 
         k[0] = fkx*kx;
         k[1] = fky*ky;
         k[2] = fkz*kz;
         ksq = k[0]*k[0] + k[1]*k[1] + k[2]*k[2];
 
-        if (ksq <= 0.0 || ksq > kmax_) continue;
+        if (ksq <= 0.0 || ksq > ewald->kmax) continue;
 	kn++;
       }
     }
@@ -821,24 +904,28 @@ static int ewald_set_kr_table(ewald_t * ewald, double r[3]) {
   int i, k;
   double c2[3];
   double ltot[3];
+  double * sinkr = NULL;
+  double * coskr = NULL;
   PI_DOUBLE(pi);
 
   assert(ewald);
 
   cs_ltot(ewald->cs, ltot);
+  sinkr = ewald->sinkr;
+  coskr = ewald->coskr;
 
   for (i = 0; i < 3; i++) {
-    sinkr_[3*0 + i] = 0.0;
-    coskr_[3*0 + i] = 1.0;
-    sinkr_[3*1 + i] = sin(2.0*pi*r[i]/ltot[i]);
-    coskr_[3*1 + i] = cos(2.0*pi*r[i]/ltot[i]);
-    c2[i] = 2.0*coskr_[3*1 + i];
+    sinkr[3*0 + i] = 0.0;
+    coskr[3*0 + i] = 1.0;
+    sinkr[3*1 + i] = sin(2.0*pi*r[i]/ltot[i]);
+    coskr[3*1 + i] = cos(2.0*pi*r[i]/ltot[i]);
+    c2[i] = 2.0*coskr[3*1 + i];
   }
 
-  for (k = 2; k < nkmax_; k++) {
+  for (k = 2; k < ewald->nkmax; k++) {
     for (i = 0; i < 3; i++) {
-      sinkr_[3*k + i] = c2[i]*sinkr_[3*(k-1) + i] - sinkr_[3*(k-2) + i];
-      coskr_[3*k + i] = c2[i]*coskr_[3*(k-1) + i] - coskr_[3*(k-2) + i]; 
+      sinkr[3*k + i] = c2[i]*sinkr[3*(k-1) + i] - sinkr[3*(k-2) + i];
+      coskr[3*k + i] = c2[i]*coskr[3*(k-1) + i] - coskr[3*(k-2) + i];
     }
   }
 
@@ -0,0 +1,599 @@
+/*****************************************************************************
+ *
+ *  ewald_pme.c
+ *
+ *  Smooth particle-mesh Ewald (Essmann et al., J. Chem. Phys. 103,
+ *  8577 (1995)) for the Fourier space part of the Ewald sum for
+ *  point dipoles.
+ *
+ *  Each dipole s_i at scaled position u_i (u = K r / L in each
+ *  direction) is assigned to the mesh via cardinal B-splines M_p
+ *  of order p, the accuracy parameter:
+ *
+ *    Q(m) = sum_i sum_a s_ia (K_a/L_a) d/du_a [M_p M_p M_p](u_i - m)
+ *
+ *  The energy is then
+ *
+ *    E = (1/2) sum_k G(k) B(k) |Q^(k)|^2
+ *
+ *  where G(k) = (4 pi mu^2 / V) exp(-k^2/4kappa^2)/k^2 with the same
+ *  cut off as the direct sum, and B(k) is the B-spline Euler factor.
+ *  With phi the (unnormalised) inverse transform of G B Q^, the force
+ *  on a dipole is -sum_m phi(m) dQ(m)/dr_i and the torque is
+ *  -s_i x sum_m phi(m) dQ(m)/ds_i.
+ *
+ *  The mesh charge Q is assembled on each rank for the local colloids
+ *  and reduced onto the x slabs of the FFT; the potential phi is
+ *  gathered back in full for interpolation. The mesh is assumed to
+ *  be modest in size compared with the lattice.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "util.h"
+#include "fft.h"
+#include "ewald_pme.h"
+
+typedef struct ewald_pme_spline_s ewald_pme_spline_t;
+
+struct ewald_pme_spline_s {
+  int m[3][EWALD_PME_ORDER_MAX];     /* Mesh index for each weight */
+  double a[3][EWALD_PME_ORDER_MAX];  /* M_p */
+  double d[3][EWALD_PME_ORDER_MAX];  /* First derivative */
+  double d2[3][EWALD_PME_ORDER_MAX]; /* Second derivative */
+};
+
+struct ewald_pme_s {
+  pe_t * pe;              /* Parallel environment */
+  cs_t * cs;              /* Coordinate system */
+  fft_t * fft;            /* 3d FFT */
+  int order;              /* B-spline order p */
+  int mesh[3];            /* Mesh size K */
+  int nlocal;             /* Number of mesh points in local x slab */
+  int nylocal;            /* Number of y planes in local y slab */
+  int * count;            /* Size of x slab for each rank */
+  int * displ;            /* Offset of x slab for each rank */
+  double * q;             /* Full mesh Q, and then phi */
+  double * qslab;         /* Local x slab (real) */
+  double * xslab;         /* Local x slab (complex) */
+  double * yslab;         /* Local y slab (complex) */
+  double * theta;         /* G(k) B(k) on the local y slab */
+};
+
+static int ewald_pme_spline(ewald_pme_t * pme, const double r[3],
+			    ewald_pme_spline_t * sp);
+static int ewald_pme_weights(int p, double w, double * a, double * d,
+			     double * d2);
+static int ewald_pme_bsq(int p, int kmesh, int m, double * bsq);
+
+/*****************************************************************************
+ *
+ *  ewald_pme_create
+ *
+ *****************************************************************************/
+
+int ewald_pme_create(pe_t * pe, cs_t * cs, int order, const int mesh[3],
+		     ewald_pme_t ** pobj) {
+
+  int ia, r;
+  int nrank;
+  int x0, nx, y0, ny;
+  int nmesh;
+  ewald_pme_t * pme = NULL;
+  MPI_Comm comm;
+
+  assert(pe);
+  assert(cs);
+  assert(pobj);
+
+  if (order < 4 || order > EWALD_PME_ORDER_MAX) {
+    pe_fatal(pe, "PME B-spline order must be 4-%d\n", EWALD_PME_ORDER_MAX);
+  }
+
+  for (ia = 0; ia < 3; ia++) {
+    if (mesh[ia] < order) pe_fatal(pe, "PME mesh smaller than order\n");
+  }
+
+  pme = (ewald_pme_t *) calloc(1, sizeof(ewald_pme_t));
+  assert(pme);
+  if (pme == NULL) pe_fatal(pe, "calloc(ewald_pme_t) failed\n");
+
+  pme->pe = pe;
+  pme->cs = cs;
+  pme->order = order;
+  pme->mesh[X] = mesh[X];
+  pme->mesh[Y] = mesh[Y];
+  pme->mesh[Z] = mesh[Z];
+  nmesh = mesh[X]*mesh[Y]*mesh[Z];
+
+  cs_cart_comm(cs, &comm);
+  MPI_Comm_size(comm, &nrank);
+
+  fft_create(pe, comm, mesh, &pme->fft);
+  fft_xslab(pme->fft, &x0, &nx);
+  fft_yslab(pme->fft, &y0, &ny);
+
+  pme->nlocal = nx*mesh[Y]*mesh[Z];
+  pme->nylocal = ny;
+
+  pme->count = (int *) calloc(nrank, sizeof(int));
+  pme->displ = (int *) calloc(nrank, sizeof(int));
+  assert(pme->count);
+  assert(pme->displ);
+  if (pme->count == NULL) pe_fatal(pe, "calloc(pme->count) failed\n");
+  if (pme->displ == NULL) pe_fatal(pe, "calloc(pme->displ) failed\n");
+
+  MPI_Allgather(&pme->nlocal, 1, MPI_INT, pme->count, 1, MPI_INT, comm);
+  for (r = 1; r < nrank; r++) {
+    pme->displ[r] = pme->displ[r-1] + pme->count[r-1];
+  }
+
+  pme->q = (double *) calloc(nmesh, sizeof(double));
+  pme->qslab = (double *) calloc(imax(1, pme->nlocal), sizeof(double));
+  pme->xslab = (double *) calloc(imax(1, 2*pme->nlocal), sizeof(double));
+  pme->yslab = (double *) calloc(imax(1, 2*ny*mesh[X]*mesh[Z]),
+				 sizeof(double));
+  pme->theta = (double *) calloc(imax(1, ny*mesh[X]*mesh[Z]), sizeof(double));
+
+  if (pme->q == NULL) pe_fatal(pe, "calloc(pme->q) failed\n");
+  if (pme->qslab == NULL) pe_fatal(pe, "calloc(pme->qslab) failed\n");
+  if (pme->xslab == NULL) pe_fatal(pe, "calloc(pme->xslab) failed\n");
+  if (pme->yslab == NULL) pe_fatal(pe, "calloc(pme->yslab) failed\n");
+  if (pme->theta == NULL) pe_fatal(pe, "calloc(pme->theta) failed\n");
+
+  *pobj = pme;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ewald_pme_free
+ *
+ *****************************************************************************/
+
+int ewald_pme_free(ewald_pme_t * pme) {
+
+  assert(pme);
+
+  fft_free(pme->fft);
+  free(pme->theta);
+  free(pme->yslab);
+  free(pme->xslab);
+  free(pme->qslab);
+  free(pme->q);
+  free(pme->displ);
+  free(pme->count);
+  free(pme);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ewald_pme_order
+ *
+ *****************************************************************************/
+
+int ewald_pme_order(ewald_pme_t * pme, int * order) {
+
+  assert(pme);
+  assert(order);
+
+  *order = pme->order;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ewald_pme_mesh
+ *
+ *****************************************************************************/
+
+int ewald_pme_mesh(ewald_pme_t * pme, int mesh[3]) {
+
+  assert(pme);
+
+  mesh[X] = pme->mesh[X];
+  mesh[Y] = pme->mesh[Y];
+  mesh[Z] = pme->mesh[Z];
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ewald_pme_influence_set
+ *
+ *  Compute G(k) B(k) for the local y slab. The wavevectors retained
+ *  are exactly those of the direct sum, i.e., |n_a| <= nk[a] and
+ *  0 < k^2 <= kmax, so the mesh must have K_a > 2 nk[a].
+ *
+ *****************************************************************************/
+
+int ewald_pme_influence_set(ewald_pme_t * pme, double mu, double kappa,
+			    double kmax, const int nk[3]) {
+
+  int ia;
+  int ix, iy, iz, jy;
+  int n[3];
+  int y0, ny;
+  double ltot[3];
+  double k[3], ksq;
+  double b0, r4kappa_sq;
+  double * bsq[3] = {NULL, NULL, NULL};
+  PI_DOUBLE(pi);
+
+  assert(pme);
+  assert(kappa > 0.0);
+
+  cs_ltot(pme->cs, ltot);
+  fft_yslab(pme->fft, &y0, &ny);
+
+  for (ia = 0; ia < 3; ia++) {
+    if (pme->mesh[ia] <= 2*nk[ia]) {
+      pe_fatal(pme->pe, "PME mesh (%d) must exceed 2 x %d\n",
+	       pme->mesh[ia], nk[ia]);
+    }
+    bsq[ia] = (double *) calloc(pme->mesh[ia], sizeof(double));
+    assert(bsq[ia]);
+    if (bsq[ia] == NULL) pe_fatal(pme->pe, "calloc(bsq) failed\n");
+    for (ix = 0; ix < pme->mesh[ia]; ix++) {
+      ewald_pme_bsq(pme->order, pme->mesh[ia], ix, bsq[ia] + ix);
+    }
+  }
+
+  b0 = (4.0*pi/(ltot[X]*ltot[Y]*ltot[Z]))*mu*mu;
+  r4kappa_sq = 1.0/(4.0*kappa*kappa);
+
+  for (jy = 0; jy < ny; jy++) {
+    iy = y0 + jy;
+    n[Y] = (2*iy <= pme->mesh[Y]) ? iy : iy - pme->mesh[Y];
+    for (ix = 0; ix < pme->mesh[X]; ix++) {
+      n[X] = (2*ix <= pme->mesh[X]) ? ix : ix - pme->mesh[X];
+      for (iz = 0; iz < pme->mesh[Z]; iz++) {
+	n[Z] = (2*iz <= pme->mesh[Z]) ? iz : iz - pme->mesh[Z];
+
+	k[X] = 2.0*pi*n[X]/ltot[X];
+	k[Y] = 2.0*pi*n[Y]/ltot[Y];
+	k[Z] = 2.0*pi*n[Z]/ltot[Z];
+	ksq = k[X]*k[X] + k[Y]*k[Y] + k[Z]*k[Z];
+
+	pme->theta[(jy*pme->mesh[X] + ix)*pme->mesh[Z] + iz] = 0.0;
+
+	if (abs(n[X]) > nk[X] || abs(n[Y]) > nk[Y] || abs(n[Z]) > nk[Z]) {
+	  continue;
+	}
+	if (ksq <= 0.0 || ksq > kmax) continue;
+
+	pme->theta[(jy*pme->mesh[X] + ix)*pme->mesh[Z] + iz]
+	  = b0*exp(-r4kappa_sq*ksq)/ksq*bsq[X][ix]*bsq[Y][iy]*bsq[Z][iz];
+      }
+    }
+  }
+
+  free(bsq[Z]);
+  free(bsq[Y]);
+  free(bsq[X]);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ewald_pme_sum
+ *
+ *  Accumulate the Fourier space force and torque on the local
+ *  colloids; the (global) Fourier space energy is returned.
+ *
+ *****************************************************************************/
+
+int ewald_pme_sum(ewald_pme_t * pme, colloids_info_t * cinfo, double * ef) {
+
+  int ic, jc, kc;
+  int ix, iy, iz, ia, ib;
+  int n, nmesh;
+  int ncell[3];
+  int * kmesh = NULL;
+  double c[3];
+  double ltot[3];
+  double elocal, qre, qim, v, phi;
+  double ma[3], da[3], d2a[3][3];
+  double dr[3], ds[3];
+  colloid_t * pc = NULL;
+  ewald_pme_spline_t sp;
+  MPI_Comm comm;
+
+  assert(pme);
+  assert(cinfo);
+  assert(ef);
+
+  kmesh = pme->mesh;
+  nmesh = kmesh[X]*kmesh[Y]*kmesh[Z];
+
+  cs_ltot(pme->cs, ltot);
+  cs_cart_comm(pme->cs, &comm);
+  colloids_info_ncell(cinfo, ncell);
+
+  for (ia = 0; ia < 3; ia++) {
+    c[ia] = kmesh[ia]/ltot[ia];
+  }
+
+  /* Assign the local dipoles to the mesh */
+
+  for (n = 0; n < nmesh; n++) {
+    pme->q[n] = 0.0;
+  }
+
+  for (ic = 1; ic <= ncell[X]; ic++) {
+    for (jc = 1; jc <= ncell[Y]; jc++) {
+      for (kc = 1; kc <= ncell[Z]; kc++) {
+
+	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+
+	for (; pc; pc = pc->next) {
+
+	  ewald_pme_spline(pme, pc->s.r, &sp);
+
+	  for (ix = 0; ix < pme->order; ix++) {
+	    for (iy = 0; iy < pme->order; iy++) {
+	      for (iz = 0; iz < pme->order; iz++) {
+		v = c[X]*pc->s.s[X]*sp.d[X][ix]*sp.a[Y][iy]*sp.a[Z][iz]
+		  + c[Y]*pc->s.s[Y]*sp.a[X][ix]*sp.d[Y][iy]*sp.a[Z][iz]
+		  + c[Z]*pc->s.s[Z]*sp.a[X][ix]*sp.a[Y][iy]*sp.d[Z][iz];
+		n = (sp.m[X][ix]*kmesh[Y] + sp.m[Y][iy])*kmesh[Z] + sp.m[Z][iz];
+		pme->q[n] += v;
+	      }
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  MPI_Reduce_scatter(pme->q, pme->qslab, pme->count, MPI_DOUBLE, MPI_SUM,
+		     comm);
+
+  for (n = 0; n < pme->nlocal; n++) {
+    pme->xslab[2*n    ] = pme->qslab[n];
+    pme->xslab[2*n + 1] = 0.0;
+  }
+
+  fft_forward(pme->fft, pme->xslab, pme->yslab);
+
+  /* Energy, and convolution with the influence function */
+
+  elocal = 0.0;
+
+  for (n = 0; n < pme->nylocal*kmesh[X]*kmesh[Z]; n++) {
+    qre = pme->yslab[2*n    ];
+    qim = pme->yslab[2*n + 1];
+    elocal += 0.5*pme->theta[n]*(qre*qre + qim*qim);
+    pme->yslab[2*n    ] = pme->theta[n]*qre;
+    pme->yslab[2*n + 1] = pme->theta[n]*qim;
+  }
+
+  MPI_Allreduce(&elocal, ef, 1, MPI_DOUBLE, MPI_SUM, comm);
+
+  fft_backward(pme->fft, pme->yslab, pme->xslab);
+
+  for (n = 0; n < pme->nlocal; n++) {
+    pme->qslab[n] = pme->xslab[2*n];
+  }
+
+  MPI_Allgatherv(pme->qslab, pme->nlocal, MPI_DOUBLE, pme->q, pme->count,
+		 pme->displ, MPI_DOUBLE, comm);
+
+  /* Interpolate force and torque for the local dipoles */
+
+  for (ic = 1; ic <= ncell[X]; ic++) {
+    for (jc = 1; jc <= ncell[Y]; jc++) {
+      for (kc = 1; kc <= ncell[Z]; kc++) {
+
+	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+
+	for (; pc; pc = pc->next) {
+
+	  ewald_pme_spline(pme, pc->s.r, &sp);
+
+	  for (ia = 0; ia < 3; ia++) {
+	    dr[ia] = 0.0;
+	    ds[ia] = 0.0;
+	  }
+
+	  for (ix = 0; ix < pme->order; ix++) {
+	    for (iy = 0; iy < pme->order; iy++) {
+	      for (iz = 0; iz < pme->order; iz++) {
+
+		n = (sp.m[X][ix]*kmesh[Y] + sp.m[Y][iy])*kmesh[Z] + sp.m[Z][iz];
+		phi = pme->q[n];
+
+		ma[X] = sp.a[X][ix];
+		ma[Y] = sp.a[Y][iy];
+		ma[Z] = sp.a[Z][iz];
+		da[X] = sp.d[X][ix];
+		da[Y] = sp.d[Y][iy];
+		da[Z] = sp.d[Z][iz];
+
+		/* First and second derivatives of the product M M M */
+
+		d2a[X][X] = sp.d2[X][ix]*ma[Y]*ma[Z];
+		d2a[Y][Y] = ma[X]*sp.d2[Y][iy]*ma[Z];
+		d2a[Z][Z] = ma[X]*ma[Y]*sp.d2[Z][iz];
+		d2a[X][Y] = da[X]*da[Y]*ma[Z];
+		d2a[X][Z] = da[X]*ma[Y]*da[Z];
+		d2a[Y][Z] = ma[X]*da[Y]*da[Z];
+		d2a[Y][X] = d2a[X][Y];
+		d2a[Z][X] = d2a[X][Z];
+		d2a[Z][Y] = d2a[Y][Z];
+
+		ds[X] += phi*c[X]*da[X]*ma[Y]*ma[Z];
+		ds[Y] += phi*c[Y]*ma[X]*da[Y]*ma[Z];
+		ds[Z] += phi*c[Z]*ma[X]*ma[Y]*da[Z];
+
+		for (ia = 0; ia < 3; ia++) {
+		  v = 0.0;
+		  for (ib = 0; ib < 3; ib++) {
+		    v += pc->s.s[ib]*c[ib]*d2a[ib][ia];
+		  }
+		  dr[ia] += phi*c[ia]*v;
+		}
+	      }
+	    }
+	  }
+
+	  pc->force[X] -= dr[X];
+	  pc->force[Y] -= dr[Y];
+	  pc->force[Z] -= dr[Z];
+	  pc->torque[X] += -(pc->s.s[Y]*ds[Z] - pc->s.s[Z]*ds[Y]);
+	  pc->torque[Y] += -(pc->s.s[Z]*ds[X] - pc->s.s[X]*ds[Z]);
+	  pc->torque[Z] += -(pc->s.s[X]*ds[Y] - pc->s.s[Y]*ds[X]);
+	}
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ewald_pme_spline
+ *
+ *  B-spline weights and mesh indices for position r. The mesh
+ *  point m = floor(u) - j carries weight M_p(u - m).
+ *
+ *****************************************************************************/
+
+static int ewald_pme_spline(ewald_pme_t * pme, const double r[3],
+			    ewald_pme_spline_t * sp) {
+  int ia, j;
+  int iu;
+  double u;
+  double ltot[3];
+
+  assert(pme);
+  assert(sp);
+
+  cs_ltot(pme->cs, ltot);
+
+  for (ia = 0; ia < 3; ia++) {
+    u = fmod(pme->mesh[ia]*r[ia]/ltot[ia], (double) pme->mesh[ia]);
+    if (u < 0.0) u += pme->mesh[ia];
+    iu = (int) floor(u);
+    ewald_pme_weights(pme->order, u - iu, sp->a[ia], sp->d[ia], sp->d2[ia]);
+    for (j = 0; j < pme->order; j++) {
+      sp->m[ia][j] = (iu - j + pme->mesh[ia]) % pme->mesh[ia];
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ewald_pme_weights
+ *
+ *  For 0 <= w < 1, compute a[j] = M_p(w + j), j = 0, ..., p-1, with
+ *  first and second derivatives via the recurrence
+ *
+ *    M_n(x) = [x M_{n-1}(x) + (n - x) M_{n-1}(x - 1)] / (n - 1)
+ *    M_n'(x) = M_{n-1}(x) - M_{n-1}(x - 1).
+ *
+ *****************************************************************************/
+
+static int ewald_pme_weights(int p, double w, double * a, double * d,
+			     double * d2) {
+  int j, n;
+  double m1[EWALD_PME_ORDER_MAX + 1]; /* M_{p-1} with m1[0] = 0 padding */
+  double m2[EWALD_PME_ORDER_MAX + 2]; /* M_{p-2} with two zeros padding */
+
+  assert(p >= 4 && p <= EWALD_PME_ORDER_MAX);
+  assert(a);
+  assert(d);
+  assert(d2);
+
+  for (j = 0; j < p; j++) {
+    a[j] = 0.0;
+  }
+
+  a[0] = w;
+  a[1] = 1.0 - w;
+
+  for (n = 3; n <= p; n++) {
+
+    if (n == p - 1) {
+      for (j = 0; j < n - 1; j++) m2[j + 2] = a[j];
+    }
+    if (n == p) {
+      for (j = 0; j < n - 1; j++) m1[j + 1] = a[j];
+    }
+
+    for (j = n - 1; j >= 0; j--) {
+      a[j] = (w + j)*a[j] + (j > 0 ? (n - w - j)*a[j-1] : 0.0);
+      a[j] /= (n - 1);
+    }
+  }
+
+  m1[0] = 0.0;
+  m1[p] = 0.0;
+  m2[0] = 0.0;
+  m2[1] = 0.0;
+  m2[p] = 0.0;
+  m2[p + 1] = 0.0;
+
+  for (j = 0; j < p; j++) {
+    d[j] = m1[j + 1] - m1[j];
+    d2[j] = m2[j + 2] - 2.0*m2[j + 1] + m2[j];
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ewald_pme_bsq
+ *
+ *  |b(m)|^2 = 1 / |sum_{k=0}^{p-2} M_p(k+1) exp(2 pi i m k/K)|^2
+ *
+ *  The denominator can vanish for odd p at m = K/2, which is outside
+ *  the cut off in any case.
+ *
+ *****************************************************************************/
+
+static int ewald_pme_bsq(int p, int kmesh, int m, double * bsq) {
+
+  int k;
+  double a[EWALD_PME_ORDER_MAX];
+  double d[EWALD_PME_ORDER_MAX];
+  double d2[EWALD_PME_ORDER_MAX];
+  double sre = 0.0, sim = 0.0, ssq;
+  PI_DOUBLE(pi);
+
+  assert(bsq);
+
+  ewald_pme_weights(p, 0.0, a, d, d2);
+
+  for (k = 0; k <= p - 2; k++) {
+    sre += a[k + 1]*cos(2.0*pi*m*k/kmesh);
+    sim += a[k + 1]*sin(2.0*pi*m*k/kmesh);
+  }
+
+  ssq = sre*sre + sim*sim;
+  *bsq = (ssq > DBL_EPSILON) ? 1.0/ssq : 0.0;
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+/*****************************************************************************
+ *
+ *  ewald_pme.h
+ *
+ *  Smooth particle-mesh Ewald for the Fourier space part of the
+ *  dipolar Ewald sum.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_EWALD_PME_H
+#define LUDWIG_EWALD_PME_H
+
+#include "pe.h"
+#include "coords.h"
+#include "colloids.h"
+
+#define EWALD_PME_ORDER_DEFAULT 6
+#define EWALD_PME_ORDER_MAX     12
+
+typedef struct ewald_pme_s ewald_pme_t;
+
+int ewald_pme_create(pe_t * pe, cs_t * cs, int order, const int mesh[3],
+		     ewald_pme_t ** pobj);
+int ewald_pme_free(ewald_pme_t * pme);
+int ewald_pme_influence_set(ewald_pme_t * pme, double mu, double kappa,
+			    double kmax, const int nk[3]);
+int ewald_pme_sum(ewald_pme_t * pme, colloids_info_t * cinfo, double * ef);
+int ewald_pme_order(ewald_pme_t * pme, int * order);
+int ewald_pme_mesh(ewald_pme_t * pme, int mesh[3]);
+
+#endif
@@ -0,0 +1,567 @@
+/*****************************************************************************
+ *
+ *  fft.c
+ *
+ *  Simple built-in three-dimensional complex FFT.
+ *
+ *  Complex data are stored as interleaved (re, im) pairs of doubles.
+ *  One-dimensional transforms are radix-2 for lengths which are a
+ *  power of two, and a direct DFT otherwise (intended for small
+ *  lengths only).
+ *
+ *  The three-dimensional transform is slab-decomposed over all the
+ *  ranks of the communicator. The real space data are distributed
+ *  in slabs in x, i.e., [nx][ntotal[Y]][ntotal[Z]] locally, while
+ *  the transformed data are distributed in slabs in y, i.e., with
+ *  local layout [ny][ntotal[X]][ntotal[Z]]. One global transpose
+ *  is required in each direction.
+ *
+ *  The forward transform uses exp(-2 pi i k.x), and the backward
+ *  transform exp(+2 pi i k.x). Neither is normalised.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coords.h"
+#include "util.h"
+#include "fft.h"
+
+typedef struct fft_line_s fft_line_t;
+
+struct fft_line_s {
+  int n;                /* Length */
+  int pow2;             /* Length is a power of two */
+  double * w;           /* Twiddle factors cos, sin (2 pi k/n) */
+  double * tmp;         /* Workspace for direct transform */
+};
+
+struct fft_s {
+  pe_t * pe;            /* Parallel environment */
+  MPI_Comm comm;        /* Communicator */
+  int nrank;            /* Number of ranks in comm */
+  int rank;             /* Rank in comm */
+  int ntotal[3];        /* Global size */
+  int * x0;             /* Offset of x slab for each rank */
+  int * nx;             /* Size of x slab for each rank */
+  int * y0;             /* Offset of y slab for each rank */
+  int * ny;             /* Size of y slab for each rank */
+  int * xcount;         /* Transpose: doubles exchanged from x slab */
+  int * xdispl;         /* ... and displacement */
+  int * ycount;         /* Transpose: doubles exchanged from y slab */
+  int * ydispl;         /* ... and displacement */
+  double * line;        /* Workspace for strided transforms */
+  double * sbuf;        /* Transpose send buffer */
+  double * rbuf;        /* Transpose receive buffer */
+  fft_line_t * plan[3]; /* One-dimensional transforms */
+};
+
+static int fft_line_create(pe_t * pe, int n, fft_line_t ** pobj);
+static int fft_line_free(fft_line_t * plan);
+static int fft_line(fft_line_t * plan, int sign, double * data);
+static int fft_lines(fft_t * fft, int ia, int nlines, int sign,
+		     double * data);
+static int fft_transpose_xy(fft_t * fft, double * xdata, double * ydata);
+static int fft_transpose_yx(fft_t * fft, double * ydata, double * xdata);
+
+/*****************************************************************************
+ *
+ *  fft_create
+ *
+ *****************************************************************************/
+
+int fft_create(pe_t * pe, MPI_Comm comm, const int ntotal[3],
+	       fft_t ** pobj) {
+
+  int ia, r;
+  int nmax;
+  int nxlocal, nylocal;
+  fft_t * fft = NULL;
+
+  assert(pe);
+  assert(pobj);
+
+  fft = (fft_t *) calloc(1, sizeof(fft_t));
+  assert(fft);
+  if (fft == NULL) pe_fatal(pe, "calloc(fft_t) failed\n");
+
+  fft->pe = pe;
+  fft->comm = comm;
+  MPI_Comm_size(comm, &fft->nrank);
+  MPI_Comm_rank(comm, &fft->rank);
+
+  fft->x0 = (int *) calloc(fft->nrank, sizeof(int));
+  fft->nx = (int *) calloc(fft->nrank, sizeof(int));
+  fft->y0 = (int *) calloc(fft->nrank, sizeof(int));
+  fft->ny = (int *) calloc(fft->nrank, sizeof(int));
+  fft->xcount = (int *) calloc(fft->nrank, sizeof(int));
+  fft->xdispl = (int *) calloc(fft->nrank, sizeof(int));
+  fft->ycount = (int *) calloc(fft->nrank, sizeof(int));
+  fft->ydispl = (int *) calloc(fft->nrank, sizeof(int));
+  assert(fft->ydispl);
+  if (fft->ydispl == NULL) pe_fatal(pe, "calloc(fft_t->ydispl) failed\n");
+
+  nmax = 1;
+  for (ia = 0; ia < 3; ia++) {
+    if (ntotal[ia] < 1) pe_fatal(pe, "fft_create: bad size %d\n", ntotal[ia]);
+    fft->ntotal[ia] = ntotal[ia];
+    nmax = imax(nmax, ntotal[ia]);
+    fft_line_create(pe, ntotal[ia], fft->plan + ia);
+  }
+
+  /* Slabs: the first (n % nrank) ranks have one extra plane */
+
+  for (r = 0; r < fft->nrank; r++) {
+    fft->nx[r] = ntotal[X]/fft->nrank + (r < ntotal[X] % fft->nrank);
+    fft->ny[r] = ntotal[Y]/fft->nrank + (r < ntotal[Y] % fft->nrank);
+    if (r > 0) fft->x0[r] = fft->x0[r-1] + fft->nx[r-1];
+    if (r > 0) fft->y0[r] = fft->y0[r-1] + fft->ny[r-1];
+  }
+
+  nxlocal = fft->nx[fft->rank];
+  nylocal = fft->ny[fft->rank];
+
+  /* Transpose counts (in doubles): the block exchanged with rank r
+   * is [nxlocal][ny[r]][nz] from the x slab, and [nx[r]][nylocal][nz]
+   * from the y slab. */
+
+  for (r = 0; r < fft->nrank; r++) {
+    fft->xcount[r] = 2*nxlocal*fft->ny[r]*ntotal[Z];
+    fft->ycount[r] = 2*fft->nx[r]*nylocal*ntotal[Z];
+    if (r > 0) fft->xdispl[r] = fft->xdispl[r-1] + fft->xcount[r-1];
+    if (r > 0) fft->ydispl[r] = fft->ydispl[r-1] + fft->ycount[r-1];
+  }
+
+  fft->line = (double *) calloc(2*nmax, sizeof(double));
+  assert(fft->line);
+  if (fft->line == NULL) pe_fatal(pe, "calloc(fft_t->line) failed\n");
+
+  nmax = 2*imax(nxlocal*ntotal[Y], nylocal*ntotal[X])*ntotal[Z];
+  nmax = imax(nmax, 1);
+
+  fft->sbuf = (double *) calloc(nmax, sizeof(double));
+  fft->rbuf = (double *) calloc(nmax, sizeof(double));
+  assert(fft->sbuf);
+  assert(fft->rbuf);
+  if (fft->sbuf == NULL) pe_fatal(pe, "calloc(fft_t->sbuf) failed\n");
+  if (fft->rbuf == NULL) pe_fatal(pe, "calloc(fft_t->rbuf) failed\n");
+
+  *pobj = fft;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_free
+ *
+ *****************************************************************************/
+
+int fft_free(fft_t * fft) {
+
+  int ia;
+
+  assert(fft);
+
+  for (ia = 0; ia < 3; ia++) {
+    fft_line_free(fft->plan[ia]);
+  }
+
+  free(fft->rbuf);
+  free(fft->sbuf);
+  free(fft->line);
+  free(fft->ydispl);
+  free(fft->ycount);
+  free(fft->xdispl);
+  free(fft->xcount);
+  free(fft->ny);
+  free(fft->y0);
+  free(fft->nx);
+  free(fft->x0);
+  free(fft);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_xslab
+ *
+ *  Global offset and extent of the local real space slab.
+ *
+ *****************************************************************************/
+
+int fft_xslab(fft_t * fft, int * x0, int * nx) {
+
+  assert(fft);
+  assert(x0);
+  assert(nx);
+
+  *x0 = fft->x0[fft->rank];
+  *nx = fft->nx[fft->rank];
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_yslab
+ *
+ *  Global offset and extent of the local transformed slab.
+ *
+ *****************************************************************************/
+
+int fft_yslab(fft_t * fft, int * y0, int * ny) {
+
+  assert(fft);
+  assert(y0);
+  assert(ny);
+
+  *y0 = fft->y0[fft->rank];
+  *ny = fft->ny[fft->rank];
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_forward
+ *
+ *  The x slab data are overwritten; the result is the y slab.
+ *
+ *****************************************************************************/
+
+int fft_forward(fft_t * fft, double * xdata, double * ydata) {
+
+  int nxlocal, nylocal;
+
+  assert(fft);
+  assert(xdata);
+  assert(ydata);
+
+  nxlocal = fft->nx[fft->rank];
+  nylocal = fft->ny[fft->rank];
+
+  fft_lines(fft, Z, nxlocal*fft->ntotal[Y], -1, xdata);
+  fft_lines(fft, Y, nxlocal, -1, xdata);
+  fft_transpose_xy(fft, xdata, ydata);
+  fft_lines(fft, X, nylocal, -1, ydata);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_backward
+ *
+ *  The y slab data are overwritten; the result is the x slab.
+ *
+ *****************************************************************************/
+
+int fft_backward(fft_t * fft, double * ydata, double * xdata) {
+
+  int nxlocal, nylocal;
+
+  assert(fft);
+  assert(ydata);
+  assert(xdata);
+
+  nxlocal = fft->nx[fft->rank];
+  nylocal = fft->ny[fft->rank];
+
+  fft_lines(fft, X, nylocal, +1, ydata);
+  fft_transpose_yx(fft, ydata, xdata);
+  fft_lines(fft, Y, nxlocal, +1, xdata);
+  fft_lines(fft, Z, nxlocal*fft->ntotal[Y], +1, xdata);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_lines
+ *
+ *  Transform in direction ia for data with local layout [nlines][n][nz]
+ *  (ia = X or Y), or [nlines][nz] (ia = Z, contiguous).
+ *
+ *****************************************************************************/
+
+static int fft_lines(fft_t * fft, int ia, int nlines, int sign,
+		     double * data) {
+
+  int nz, n;
+  int il, j, k;
+  double * p = NULL;
+
+  assert(fft);
+  assert(data);
+
+  nz = fft->ntotal[Z];
+
+  if (ia == Z) {
+    for (il = 0; il < nlines; il++) {
+      fft_line(fft->plan[Z], sign, data + 2*il*nz);
+    }
+  }
+  else {
+    n = fft->ntotal[ia];
+    for (il = 0; il < nlines; il++) {
+      for (k = 0; k < nz; k++) {
+	p = data + 2*(il*n*nz + k);
+	for (j = 0; j < n; j++) {
+	  fft->line[2*j    ] = p[2*j*nz    ];
+	  fft->line[2*j + 1] = p[2*j*nz + 1];
+	}
+	fft_line(fft->plan[ia], sign, fft->line);
+	for (j = 0; j < n; j++) {
+	  p[2*j*nz    ] = fft->line[2*j    ];
+	  p[2*j*nz + 1] = fft->line[2*j + 1];
+	}
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_transpose_xy
+ *
+ *  [nxlocal][ntotal[Y]][nz] -> [nylocal][ntotal[X]][nz]
+ *
+ *****************************************************************************/
+
+static int fft_transpose_xy(fft_t * fft, double * xdata, double * ydata) {
+
+  int r, i, j;
+  int nz, nxlocal, nylocal;
+  double * p = NULL;
+
+  assert(fft);
+
+  nz = fft->ntotal[Z];
+  nxlocal = fft->nx[fft->rank];
+  nylocal = fft->ny[fft->rank];
+
+  /* Pack [nxlocal][ny[r]][nz] for each rank r */
+
+  p = fft->sbuf;
+  for (r = 0; r < fft->nrank; r++) {
+    for (i = 0; i < nxlocal; i++) {
+      for (j = fft->y0[r]; j < fft->y0[r] + fft->ny[r]; j++) {
+	memcpy(p, xdata + 2*(i*fft->ntotal[Y] + j)*nz, 2*nz*sizeof(double));
+	p += 2*nz;
+      }
+    }
+  }
+
+  MPI_Alltoallv(fft->sbuf, fft->xcount, fft->xdispl, MPI_DOUBLE,
+		fft->rbuf, fft->ycount, fft->ydispl, MPI_DOUBLE, fft->comm);
+
+  /* Unpack [nx[r]][nylocal][nz] from each rank r */
+
+  p = fft->rbuf;
+  for (r = 0; r < fft->nrank; r++) {
+    for (i = fft->x0[r]; i < fft->x0[r] + fft->nx[r]; i++) {
+      for (j = 0; j < nylocal; j++) {
+	memcpy(ydata + 2*(j*fft->ntotal[X] + i)*nz, p, 2*nz*sizeof(double));
+	p += 2*nz;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_transpose_yx
+ *
+ *  [nylocal][ntotal[X]][nz] -> [nxlocal][ntotal[Y]][nz]
+ *
+ *****************************************************************************/
+
+static int fft_transpose_yx(fft_t * fft, double * ydata, double * xdata) {
+
+  int r, i, j;
+  int nz, nxlocal, nylocal;
+  double * p = NULL;
+
+  assert(fft);
+
+  nz = fft->ntotal[Z];
+  nxlocal = fft->nx[fft->rank];
+  nylocal = fft->ny[fft->rank];
+
+  p = fft->sbuf;
+  for (r = 0; r < fft->nrank; r++) {
+    for (i = fft->x0[r]; i < fft->x0[r] + fft->nx[r]; i++) {
+      for (j = 0; j < nylocal; j++) {
+	memcpy(p, ydata + 2*(j*fft->ntotal[X] + i)*nz, 2*nz*sizeof(double));
+	p += 2*nz;
+      }
+    }
+  }
+
+  MPI_Alltoallv(fft->sbuf, fft->ycount, fft->ydispl, MPI_DOUBLE,
+		fft->rbuf, fft->xcount, fft->xdispl, MPI_DOUBLE, fft->comm);
+
+  p = fft->rbuf;
+  for (r = 0; r < fft->nrank; r++) {
+    for (i = 0; i < nxlocal; i++) {
+      for (j = fft->y0[r]; j < fft->y0[r] + fft->ny[r]; j++) {
+	memcpy(xdata + 2*(i*fft->ntotal[Y] + j)*nz, p, 2*nz*sizeof(double));
+	p += 2*nz;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_line_create
+ *
+ *****************************************************************************/
+
+static int fft_line_create(pe_t * pe, int n, fft_line_t ** pobj) {
+
+  int k;
+  fft_line_t * plan = NULL;
+  PI_DOUBLE(pi);
+
+  assert(pe);
+  assert(n > 0);
+  assert(pobj);
+
+  plan = (fft_line_t *) calloc(1, sizeof(fft_line_t));
+  assert(plan);
+  if (plan == NULL) pe_fatal(pe, "calloc(fft_line_t) failed\n");
+
+  plan->n = n;
+  plan->pow2 = ((n & (n - 1)) == 0);
+  plan->w = (double *) calloc(2*n, sizeof(double));
+  plan->tmp = (double *) calloc(2*n, sizeof(double));
+  assert(plan->w);
+  assert(plan->tmp);
+  if (plan->w == NULL) pe_fatal(pe, "calloc(fft_line_t->w) failed\n");
+  if (plan->tmp == NULL) pe_fatal(pe, "calloc(fft_line_t->tmp) failed\n");
+
+  for (k = 0; k < n; k++) {
+    plan->w[2*k    ] = cos(2.0*pi*k/n);
+    plan->w[2*k + 1] = sin(2.0*pi*k/n);
+  }
+
+  *pobj = plan;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_line_free
+ *
+ *****************************************************************************/
+
+static int fft_line_free(fft_line_t * plan) {
+
+  assert(plan);
+
+  free(plan->tmp);
+  free(plan->w);
+  free(plan);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fft_line
+ *
+ *  In-place transform of one contiguous line with exp(sign 2 pi i jk/n).
+ *
+ *****************************************************************************/
+
+static int fft_line(fft_line_t * plan, int sign, double * a) {
+
+  int n;
+  int i, j, k, m;
+  int len, half, step;
+  double wr, wi, ur, ui, vr, vi, tmp;
+
+  assert(plan);
+  assert(sign == -1 || sign == +1);
+  assert(a);
+
+  n = plan->n;
+
+  if (plan->pow2) {
+
+    /* Bit reversal permutation */
+
+    for (i = 1, j = 0; i < n; i++) {
+      m = n >> 1;
+      for (; j & m; m >>= 1) j ^= m;
+      j ^= m;
+      if (i < j) {
+	tmp = a[2*i]; a[2*i] = a[2*j]; a[2*j] = tmp;
+	tmp = a[2*i+1]; a[2*i+1] = a[2*j+1]; a[2*j+1] = tmp;
+      }
+    }
+
+    /* Butterflies */
+
+    for (len = 2; len <= n; len <<= 1) {
+      half = len/2;
+      step = n/len;
+      for (i = 0; i < n; i += len) {
+	for (k = 0; k < half; k++) {
+	  wr = plan->w[2*k*step];
+	  wi = sign*plan->w[2*k*step + 1];
+	  ur = a[2*(i + k)];
+	  ui = a[2*(i + k) + 1];
+	  vr = a[2*(i + k + half)]*wr - a[2*(i + k + half) + 1]*wi;
+	  vi = a[2*(i + k + half)]*wi + a[2*(i + k + half) + 1]*wr;
+	  a[2*(i + k)            ] = ur + vr;
+	  a[2*(i + k)         + 1] = ui + vi;
+	  a[2*(i + k + half)     ] = ur - vr;
+	  a[2*(i + k + half)  + 1] = ui - vi;
+	}
+      }
+    }
+  }
+  else {
+
+    /* Direct transform */
+
+    for (k = 0; k < n; k++) {
+      ur = 0.0;
+      ui = 0.0;
+      for (j = 0; j < n; j++) {
+	m = (j*k) % n;
+	wr = plan->w[2*m];
+	wi = sign*plan->w[2*m + 1];
+	ur += a[2*j]*wr - a[2*j + 1]*wi;
+	ui += a[2*j]*wi + a[2*j + 1]*wr;
+      }
+      plan->tmp[2*k    ] = ur;
+      plan->tmp[2*k + 1] = ui;
+    }
+    memcpy(a, plan->tmp, 2*n*sizeof(double));
+  }
+
+  return 0;
+}
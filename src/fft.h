@@ -0,0 +1,31 @@
+/*****************************************************************************
+ *
+ *  fft.h
+ *
+ *  Simple built-in three-dimensional complex FFT.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_FFT_H
+#define LUDWIG_FFT_H
+
+#include "pe.h"
+
+typedef struct fft_s fft_t;
+
+int fft_create(pe_t * pe, MPI_Comm comm, const int ntotal[3], fft_t ** pobj);
+int fft_free(fft_t * fft);
+int fft_xslab(fft_t * fft, int * x0, int * nx);
+int fft_yslab(fft_t * fft, int * y0, int * ny);
+int fft_forward(fft_t * fft, double * xdata, double * ydata);
+int fft_backward(fft_t * fft, double * ydata, double * xdata);
+
+#endif
@@ -38,6 +38,8 @@
 static int field_write(FILE * fp, int index, void * self);
 static int field_write_ascii(FILE * fp, int index, void * self);
 static int field_read(FILE * fp, int index, void * self);
+static int field_pack(void * self, char * buf);
+static int field_unpack(void * self, char * buf);
 static int field_read_ascii(FILE * fp, int index, void * self);
 
 static int field_leesedwards_parallel(field_t * obj);
@@ -112,6 +114,7 @@ __host__ int field_free(field_t * obj) {
     tdpFree(obj->target);
   }
 
+  if (obj->sync) site_sync_free(obj->sync);
   if (obj->data) free(obj->data);
   if (obj->name) free(obj->name);
   if (obj->halo) halo_swap_free(obj->halo);
@@ -193,6 +196,8 @@ __host__ int field_init(field_t * obj, int nhcomm, lees_edw_t * le) {
 
   halo_swap_handlers_set(obj->halo, halo_swap_pack_rank1, halo_swap_unpack_rank1);
 
+  site_sync_create(obj->pe, nsites, &obj->sync);
+
   return 0;
 }
 
@@ -237,6 +242,72 @@ __host__ int field_memcpy(field_t * obj, tdpMemcpyKind flag) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  field_memcpy_sites
+ *
+ *  As field_memcpy(), but for the sites in the list only.
+ *
+ *****************************************************************************/
+
+__host__ int field_memcpy_sites(field_t * obj, site_sync_t * sites,
+				tdpMemcpyKind flag) {
+  int ndevice;
+  double * tmp = obj->data;
+
+  assert(obj);
+  assert(sites);
+  assert(sites->nsites <= obj->nsites);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    tdpMemcpy(&tmp, &obj->target->data, sizeof(double *),
+	      tdpMemcpyDeviceToHost);
+  }
+
+  site_sync_memcpy(sites, obj->data, tmp, obj->nsites, obj->nf,
+		   sizeof(double), flag);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  field_sync_site
+ *
+ *  Record a change to the field at site index on the host.
+ *
+ *****************************************************************************/
+
+__host__ int field_sync_site(field_t * obj, int index) {
+
+  assert(obj);
+
+  site_sync_add(obj->sync, index);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  field_sync
+ *
+ *  Copy the field at the sites changed on the host since the last
+ *  call to the target.
+ *
+ *****************************************************************************/
+
+__host__ int field_sync(field_t * obj) {
+
+  assert(obj);
+
+  field_memcpy_sites(obj, obj->sync, tdpMemcpyHostToDevice);
+  site_sync_reset(obj->sync);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  field_nf
@@ -279,6 +350,7 @@ __host__ int field_init_io_info(field_t * obj, int grid[3], int form_in,
   io_info_write_set(obj->info, IO_FORMAT_ASCII, field_write_ascii);
   io_info_read_set(obj->info, IO_FORMAT_BINARY, field_read);
   io_info_read_set(obj->info, IO_FORMAT_ASCII, field_read_ascii);
+  io_info_pack_set(obj->info, field_pack, field_unpack);
 
   /* ASCII format size is 23 bytes per element plus a '\n' */
   io_info_set_bytesize(obj->info, IO_FORMAT_BINARY, obj->nf*sizeof(double));
@@ -913,6 +985,40 @@ static int field_write(FILE * fp, int index, void * self) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  field_pack
+ *
+ *  Bulk binary equivalent of field_write() for all local sites.
+ *
+ *****************************************************************************/
+
+static int field_pack(void * self, char * buf) {
+
+  field_t * obj = (field_t *) self;
+
+  assert(obj);
+
+  return io_pack_rank1(obj->cs, obj->nsites, obj->nf, sizeof(double),
+		       obj->data, obj->nf*sizeof(double), 0, buf);
+}
+
+/*****************************************************************************
+ *
+ *  field_unpack
+ *
+ *****************************************************************************/
+
+static int field_unpack(void * self, char * buf) {
+
+  field_t * obj = (field_t *) self;
+
+  assert(obj);
+
+  return io_unpack_rank1(obj->cs, obj->nsites, obj->nf, sizeof(double),
+			 obj->data, obj->nf*sizeof(double), 0, buf);
+}
+
 /*****************************************************************************
  *
  *  field_write_ascii
@@ -24,6 +24,7 @@
 #include "coords.h"
 #include "io_harness.h"
 #include "leesedwards.h"
+#include "site_sync.h"
 
 typedef struct field_s field_t;
 
@@ -34,6 +35,10 @@ __host__ int field_create(pe_t * pe, cs_t * cs, int nf, const char * name,
 __host__ int field_free(field_t * obj);
 
 __host__ int field_memcpy(field_t * obj, tdpMemcpyKind flag);
+__host__ int field_memcpy_sites(field_t * obj, site_sync_t * sites,
+				tdpMemcpyKind flag);
+__host__ int field_sync_site(field_t * obj, int index);
+__host__ int field_sync(field_t * obj);
 __host__ int field_init(field_t * obj, int nhcomm, lees_edw_t * le);
 __host__ int field_init_io_info(field_t * obj, int grid[3], int form_in,
 				int form_out);
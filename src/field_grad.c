@@ -23,6 +23,7 @@
 #include "leesedwards.h"
 #include "field_s.h"
 #include "field_grad_s.h"
+#include "perf.h"
 
 static int field_grad_init(field_grad_t * obj);
 
@@ -290,9 +291,15 @@ __host__ void field_grad_free(field_grad_t * obj) {
 
 int field_grad_compute(field_grad_t * obj) {
 
+  int npass = 1;
+  int nlocal[3];
+  double nsites;
+
   assert(obj);
   assert(obj->d2);
 
+  perf_region_start("gradient");
+
   field_leesedwards(obj->field);
 
   obj->d2(obj);
@@ -300,13 +307,24 @@ int field_grad_compute(field_grad_t * obj) {
   if (obj->level == 3) {
     assert(obj->dab);
     obj->dab(obj);
+    npass += 1;
   }
 
   if (obj->level >= 4) {
     assert(obj->d4);
     obj->d4(obj);
+    npass += 1;
   }
 
+  /* Nominal work: each pass reads the field and writes the gradient
+   * and Laplacian (a 7-point stencil, 13 flops per component). */
+
+  cs_nlocal(obj->field->cs, nlocal);
+  nsites = 1.0*nlocal[X]*nlocal[Y]*nlocal[Z];
+  perf_region_work(nsites, npass*nsites*obj->nf*(NVECTOR + 2)*sizeof(double),
+		   13.0*npass*nsites*obj->nf);
+  perf_region_stop("gradient");
+
   return 0;
 }
 
@@ -30,6 +30,7 @@ struct field_s {
   lees_edw_t * le;              /* Lees-Edwards */
   io_info_t * info;             /* I/O Handler */
   halo_swap_t * halo;           /* Halo swap driver object */
+  site_sync_t * sync;           /* Sites changed on host since field_sync() */
 
   field_t * target;             /* target structure */ 
 };
@@ -41,6 +41,8 @@ struct halo_swap_s {
   double * hzhi;
   f_pack_t data_pack;       /* Pack buffer kernel function */
   f_unpack_t data_unpack;   /* Unpack buffer kernel function */
+  MPI_Datatype mpidata;     /* Element type (MPI_DOUBLE or MPI_FLOAT) */
+  MPI_Request request[12];  /* X, Y, Z requests for split-phase swap */
   tdpStream_t stream[3];    /* Stream for each of X,Y,Z */
   halo_swap_t * target;     /* Device memory */
 };
@@ -55,7 +57,8 @@ struct halo_swap_param_s {
   int na;                   /* Extent (rank 1 fields) */
   int nb;                   /* Extent (rank2 fields) */
   int naddr;                /* Extenet (nsite for address calculation) */
-  int nfel;                 /* Field elements per site (double) */
+  int nfel;                 /* Field elements per site */
+  int nbyte;                /* Bytes per element (default double) */
   int nlocal[3];            /* local domain extent */
   int nall[3];              /* ... including 2*cs_nhalo */
   int hext[3][3];           /* halo extents ... see below */
@@ -69,6 +72,8 @@ __host__ int halo_swap_create(pe_t * pe, cs_t * cs, int nhcomm, int naddr,
 __host__ __device__ void halo_swap_coords(halo_swap_t * halo, int id, int index, int * ic, int * jc, int * kc);
 __host__ __device__ int halo_swap_index(halo_swap_t * halo, int ic, int jc, int kc);
 __host__ __device__ int halo_swap_bufindex(halo_swap_t * halo, int id, int ic, int jc, int kc);
+__host__ __device__ void halo_swap_elcpy(int nbyte, void * dst, int idst,
+					 const void * src, int isrc);
 
 /*****************************************************************************
  *
@@ -140,6 +145,8 @@ __host__ int halo_swap_create(pe_t * pe, cs_t * cs, int nhcomm, int naddr,
   halo->param->nhalo = nhalo;
   halo->param->nswap = nhcomm;
   halo->param->nfel = na*nb;
+  halo->param->nbyte = sizeof(double);
+  halo->mpidata = MPI_DOUBLE;
   halo->param->naddr = naddr;
   cs_nlocal(cs, halo->param->nlocal);
   cs_nall(cs, halo->param->nall);
@@ -364,6 +371,29 @@ __host__ int halo_swap_handlers_set(halo_swap_t * halo, f_pack_t pack,
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  halo_swap_mpi_datatype_set
+ *
+ *  The element type of the data is double by default; MPI_FLOAT is
+ *  also allowed. The buffers are sized for double, so are large
+ *  enough in either case.
+ *
+ *****************************************************************************/
+
+__host__ int halo_swap_mpi_datatype_set(halo_swap_t * halo,
+					MPI_Datatype mpidata) {
+
+  assert(halo);
+  assert(mpidata == MPI_DOUBLE || mpidata == MPI_FLOAT);
+
+  halo->mpidata = mpidata;
+  if (mpidata == MPI_DOUBLE) halo->param->nbyte = sizeof(double);
+  if (mpidata == MPI_FLOAT) halo->param->nbyte = sizeof(float);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  halo_swap_commit
@@ -698,27 +728,45 @@ __host__ int halo_swap_host_rank1(halo_swap_t * halo, void * mbuf,
  *
  *****************************************************************************/
 
-__host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
+__host__ int halo_swap_packed(halo_swap_t * halo, void * data) {
+
+  assert(halo);
+
+  halo_swap_start(halo, data);
+  halo_swap_finish(halo, data);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  halo_swap_start
+ *
+ *  First half of a split-phase halo_swap_packed(): post all the
+ *  receives, pack all the edges, and send the X edges. The caller
+ *  may then do work which does not touch the halo region or the
+ *  edges of "data" before calling halo_swap_finish().
+ *
+ *  The Y and Z edges depend on the X halo (for the corners), so
+ *  only the X messages are in flight between start and finish.
+ *
+ *****************************************************************************/
+
+__host__ int halo_swap_start(halo_swap_t * halo, void * data) {
 
   int ncount;
   int ndevice;
-  int ic, jc, kc;
-  int ih, jh, kh;
-  int ixlo, ixhi;
-  int iylo, iyhi;
-  int izlo, izhi;  
-  int m, mc, p;
-  int nd, nh;
+  int p;
   int hsz[3];
+  int nbyte;
   int mpicartsz[3];
   dim3 nblk, ntpb;
   double * tmp;
 
   MPI_Comm comm;
-  MPI_Request req_x[4];
-  MPI_Request req_y[4];
-  MPI_Request req_z[4];
-  MPI_Status  status[4];
+  MPI_Request * req_x = NULL;
+  MPI_Request * req_y = NULL;
+  MPI_Request * req_z = NULL;
 
   const int btagx = 639, btagy = 640, btagz = 641;
   const int ftagx = 642, ftagy = 643, ftagz = 644;
@@ -735,13 +783,15 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
   cs_cartsz(halo->cs, mpicartsz);
 
   /* hsz[] is just shorthand for local halo sizes */
-  /* An offset nd is required if nswap < nhalo */
 
+  nbyte = halo->param->nbyte;
   hsz[X] = halo->param->hsz[X];
   hsz[Y] = halo->param->hsz[Y];
   hsz[Z] = halo->param->hsz[Z];
-  nh = halo->param->nhalo;
-  nd = nh - halo->param->nswap;
+
+  req_x = halo->request;
+  req_y = halo->request + 4;
+  req_z = halo->request + 8;
 
   /* POST ALL RELEVANT Irecv() ahead of time */
 
@@ -753,25 +803,25 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
 
   if (mpicartsz[X] > 1) {
     ncount = halo->param->hsz[X]*halo->param->nfel;
-    MPI_Irecv(halo->hxlo, ncount, MPI_DOUBLE,
+    MPI_Irecv(halo->hxlo, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs,BACKWARD,X), ftagx, comm, req_x);
-    MPI_Irecv(halo->hxhi, ncount, MPI_DOUBLE,
+    MPI_Irecv(halo->hxhi, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs,FORWARD,X), btagx, comm, req_x + 1);
   }
 
   if (mpicartsz[Y] > 1) {
     ncount = halo->param->hsz[Y]*halo->param->nfel;
-    MPI_Irecv(halo->hylo, ncount, MPI_DOUBLE,
+    MPI_Irecv(halo->hylo, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs,BACKWARD,Y), ftagy, comm, req_y);
-    MPI_Irecv(halo->hyhi, ncount, MPI_DOUBLE,
+    MPI_Irecv(halo->hyhi, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs,FORWARD,Y), btagy, comm, req_y + 1);
   }
 
   if (mpicartsz[Z] > 1) {
     ncount = halo->param->hsz[Z]*halo->param->nfel;
-    MPI_Irecv(halo->hzlo, ncount, MPI_DOUBLE,
+    MPI_Irecv(halo->hzlo, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs,BACKWARD,Z), ftagz, comm, req_z);
-    MPI_Irecv(halo->hzhi, ncount, MPI_DOUBLE,
+    MPI_Irecv(halo->hzhi, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs,FORWARD,Z), btagz, comm, req_z + 1);
   }
 
@@ -785,11 +835,11 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
     ncount = hsz[X]*halo->param->nfel;
     tdpMemcpy(&tmp, &halo->target->fxlo, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(halo->fxlo, tmp, ncount*sizeof(double),
+    tdpMemcpyAsync(halo->fxlo, tmp, ncount*nbyte,
 		   tdpMemcpyDeviceToHost, halo->stream[X]);
     tdpMemcpy(&tmp, &halo->target->fxhi, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(halo->fxhi, tmp, ncount*sizeof(double),
+    tdpMemcpyAsync(halo->fxhi, tmp, ncount*nbyte,
 		   tdpMemcpyDeviceToHost, halo->stream[X]);
   }
 
@@ -803,11 +853,11 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
     ncount = hsz[Y]*halo->param->nfel;
     tdpMemcpy(&tmp, &halo->target->fylo, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(halo->fylo, tmp, ncount*sizeof(double),
+    tdpMemcpyAsync(halo->fylo, tmp, ncount*nbyte,
 		   tdpMemcpyDeviceToHost, halo->stream[Y]);
     tdpMemcpy(&tmp, &halo->target->fyhi, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(halo->fyhi, tmp, ncount*sizeof(double),
+    tdpMemcpyAsync(halo->fyhi, tmp, ncount*nbyte,
 		   tdpMemcpyDeviceToHost, halo->stream[Y]);
   }
 
@@ -821,53 +871,117 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
     ncount = hsz[Z]*halo->param->nfel;
     tdpMemcpy(&tmp, &halo->target->fzlo, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(halo->fzlo, tmp, ncount*sizeof(double),
+    tdpMemcpyAsync(halo->fzlo, tmp, ncount*nbyte,
 		   tdpMemcpyDeviceToHost, halo->stream[Z]);
     tdpMemcpy(&tmp, &halo->target->fzhi, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(halo->fzhi, tmp, ncount*sizeof(double),
+    tdpMemcpyAsync(halo->fzhi, tmp, ncount*nbyte,
 		   tdpMemcpyDeviceToHost, halo->stream[Z]);
   }
 
 
-  /* Wait for X; copy or MPI recvs; put X halos back on device, and unpack */
+  /* Wait for X edges from device, and send */
 
   tdpStreamSynchronize(halo->stream[X]);
+
+  if (mpicartsz[X] > 1) {
+    ncount = hsz[X]*halo->param->nfel;
+    MPI_Isend(halo->fxhi, ncount, halo->mpidata,
+	      cs_cart_neighb(halo->cs,FORWARD,X), ftagx, comm, req_x + 2);
+    MPI_Isend(halo->fxlo, ncount, halo->mpidata,
+	      cs_cart_neighb(halo->cs,BACKWARD,X), btagx, comm, req_x + 3);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  halo_swap_finish
+ *
+ *  Complete a halo swap begun with halo_swap_start(). The same
+ *  "data" must be supplied.
+ *
+ *****************************************************************************/
+
+__host__ int halo_swap_finish(halo_swap_t * halo, void * data) {
+
+  int ncount;
+  int ndevice;
+  int ic, jc, kc;
+  int ih, jh, kh;
+  int ixlo, ixhi;
+  int iylo, iyhi;
+  int izlo, izhi;  
+  int m, mc, p;
+  int nd, nh;
+  int hsz[3];
+  int nbyte;
+  int mpicartsz[3];
+  dim3 nblk, ntpb;
+  double * tmp;
+
+  MPI_Comm comm;
+  MPI_Request * req_x = NULL;
+  MPI_Request * req_y = NULL;
+  MPI_Request * req_z = NULL;
+  MPI_Status  status[4];
+
+  const int btagy = 640, btagz = 641;
+  const int ftagy = 643, ftagz = 644;
+
+  assert(halo);
+
+  tdpGetDeviceCount(&ndevice);
+
+  cs_cart_comm(halo->cs, &comm);
+  cs_cartsz(halo->cs, mpicartsz);
+
+  /* An offset nd is required if nswap < nhalo */
+
+  nbyte = halo->param->nbyte;
+  hsz[X] = halo->param->hsz[X];
+  hsz[Y] = halo->param->hsz[Y];
+  hsz[Z] = halo->param->hsz[Z];
+  nh = halo->param->nhalo;
+  nd = nh - halo->param->nswap;
+
+  req_x = halo->request;
+  req_y = halo->request + 4;
+  req_z = halo->request + 8;
+
+  /* Copy or MPI recvs for X; put X halos back on device, and unpack */
+
   ncount = hsz[X]*halo->param->nfel;
 
   if (mpicartsz[X] == 1) {
     /* note these copies do not alias for ndevice == 1 */
     /* fxhi -> hxlo */
-    memcpy(halo->hxlo, halo->fxhi, ncount*sizeof(double));
+    memcpy(halo->hxlo, halo->fxhi, ncount*nbyte);
     tdpMemcpy(&tmp, &halo->target->hxlo, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(tmp, halo->fxhi, ncount*sizeof(double),
+    tdpMemcpyAsync(tmp, halo->fxhi, ncount*nbyte,
 		    tdpMemcpyHostToDevice, halo->stream[X]);
     /* fxlo -> hxhi */
-    memcpy(halo->hxhi, halo->fxlo, ncount*sizeof(double));
+    memcpy(halo->hxhi, halo->fxlo, ncount*nbyte);
     tdpMemcpy(&tmp, &halo->target->hxhi, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(tmp, halo->fxlo, ncount*sizeof(double),
+    tdpMemcpyAsync(tmp, halo->fxlo, ncount*nbyte,
 		    tdpMemcpyHostToDevice, halo->stream[X]);
   }
   else {
-    MPI_Isend(halo->fxhi, ncount, MPI_DOUBLE,
-	      cs_cart_neighb(halo->cs,FORWARD,X), ftagx, comm, req_x + 2);
-    MPI_Isend(halo->fxlo, ncount, MPI_DOUBLE,
-	      cs_cart_neighb(halo->cs,BACKWARD,X), btagx, comm, req_x + 3);
-
     for (m = 0; m < 4; m++) {
       MPI_Waitany(4, req_x, &mc, status);
       if (mc == 0 && ndevice > 0) {
 	tdpMemcpy(&tmp, &halo->target->hxlo, sizeof(double *),
 		  tdpMemcpyDeviceToHost);
-	tdpMemcpyAsync(tmp, halo->hxlo, ncount*sizeof(double),
+	tdpMemcpyAsync(tmp, halo->hxlo, ncount*nbyte,
 		       tdpMemcpyHostToDevice, halo->stream[X]);
       }
       if (mc == 1 && ndevice > 0) {
 	tdpMemcpy(&tmp, &halo->target->hxhi, sizeof(double *),
 		  tdpMemcpyDeviceToHost);
-	tdpMemcpyAsync(tmp, halo->hxhi, ncount*sizeof(double),
+	tdpMemcpyAsync(tmp, halo->hxhi, ncount*nbyte,
 		       tdpMemcpyHostToDevice, halo->stream[X]);
       }
     }
@@ -897,10 +1011,14 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
         iyhi = halo_swap_bufindex(halo, X, ic,      jh + jc, kc);
 
         for (p = 0; p < halo->param->nfel; p++) {
-          halo->fylo[hsz[Y]*p + iylo] = halo->hxlo[hsz[X]*p + ixlo];
-          halo->fyhi[hsz[Y]*p + iylo] = halo->hxlo[hsz[X]*p + iyhi];
-          halo->fylo[hsz[Y]*p + ixhi] = halo->hxhi[hsz[X]*p + ixlo];
-          halo->fyhi[hsz[Y]*p + ixhi] = halo->hxhi[hsz[X]*p + iyhi];
+          halo_swap_elcpy(nbyte, halo->fylo, hsz[Y]*p + iylo,
+			  halo->hxlo, hsz[X]*p + ixlo);
+          halo_swap_elcpy(nbyte, halo->fyhi, hsz[Y]*p + iylo,
+			  halo->hxlo, hsz[X]*p + iyhi);
+          halo_swap_elcpy(nbyte, halo->fylo, hsz[Y]*p + ixhi,
+			  halo->hxhi, hsz[X]*p + ixlo);
+          halo_swap_elcpy(nbyte, halo->fyhi, hsz[Y]*p + ixhi,
+			  halo->hxhi, hsz[X]*p + iyhi);
         }
       }
     }
@@ -912,22 +1030,22 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
 
   if (mpicartsz[Y] == 1) {
     /* fyhi -> hylo */
-    memcpy(halo->hylo, halo->fyhi, ncount*sizeof(double));
+    memcpy(halo->hylo, halo->fyhi, ncount*nbyte);
     tdpMemcpy(&tmp, &halo->target->hylo, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(tmp, halo->fyhi, ncount*sizeof(double),
+    tdpMemcpyAsync(tmp, halo->fyhi, ncount*nbyte,
 		   tdpMemcpyHostToDevice, halo->stream[Y]);
     /* fylo -> hyhi */
-    memcpy(halo->hyhi, halo->fylo, ncount*sizeof(double));
+    memcpy(halo->hyhi, halo->fylo, ncount*nbyte);
     tdpMemcpy(&tmp, &halo->target->hyhi, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(tmp, halo->fylo,ncount*sizeof(double),
+    tdpMemcpyAsync(tmp, halo->fylo,ncount*nbyte,
 		   tdpMemcpyHostToDevice, halo->stream[Y]);
   }
   else {
-    MPI_Isend(halo->fyhi, ncount, MPI_DOUBLE,
+    MPI_Isend(halo->fyhi, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs, FORWARD,Y), ftagy, comm, req_y + 2);
-    MPI_Isend(halo->fylo, ncount, MPI_DOUBLE,
+    MPI_Isend(halo->fylo, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs, BACKWARD,Y), btagy, comm, req_y + 3);
 
     for (m = 0; m < 4; m++) {
@@ -935,13 +1053,13 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
       if (mc == 0 && ndevice > 0) {
 	tdpMemcpy(&tmp, &halo->target->hylo, sizeof(double *),
 		  tdpMemcpyDeviceToHost);
-	tdpMemcpyAsync(tmp, halo->hylo, ncount*sizeof(double),
+	tdpMemcpyAsync(tmp, halo->hylo, ncount*nbyte,
 		       tdpMemcpyHostToDevice, halo->stream[Y]);
       }
       if (mc == 1 && ndevice > 0) {
 	tdpMemcpy(&tmp, &halo->target->hyhi, sizeof(double *),
 		  tdpMemcpyDeviceToHost);
-	tdpMemcpyAsync(tmp, halo->hyhi, ncount*sizeof(double),
+	tdpMemcpyAsync(tmp, halo->hyhi, ncount*nbyte,
 			tdpMemcpyHostToDevice, halo->stream[Y]);
       }
     }
@@ -970,10 +1088,14 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
 	izhi = halo_swap_bufindex(halo, Z, ih + ic, jc,      kc);
 
         for (p = 0; p < halo->param->nfel; p++) {
-          halo->fzlo[hsz[Z]*p + izlo] = halo->hxlo[hsz[X]*p + ixlo];
-          halo->fzhi[hsz[Z]*p + izlo] = halo->hxlo[hsz[X]*p + ixhi];
-          halo->fzlo[hsz[Z]*p + izhi] = halo->hxhi[hsz[X]*p + ixlo];
-          halo->fzhi[hsz[Z]*p + izhi] = halo->hxhi[hsz[X]*p + ixhi];
+          halo_swap_elcpy(nbyte, halo->fzlo, hsz[Z]*p + izlo,
+			  halo->hxlo, hsz[X]*p + ixlo);
+          halo_swap_elcpy(nbyte, halo->fzhi, hsz[Z]*p + izlo,
+			  halo->hxlo, hsz[X]*p + ixhi);
+          halo_swap_elcpy(nbyte, halo->fzlo, hsz[Z]*p + izhi,
+			  halo->hxhi, hsz[X]*p + ixlo);
+          halo_swap_elcpy(nbyte, halo->fzhi, hsz[Z]*p + izhi,
+			  halo->hxhi, hsz[X]*p + ixhi);
         }
       }
     }
@@ -994,10 +1116,14 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
         izhi = halo_swap_bufindex(halo, Z, ic, jh + jc,      kc);
 
         for (p = 0; p < halo->param->nfel; p++) {
-          halo->fzlo[hsz[Z]*p + izlo] = halo->hylo[hsz[Y]*p + iylo];
-          halo->fzhi[hsz[Z]*p + izlo] = halo->hylo[hsz[Y]*p + iyhi];
-          halo->fzlo[hsz[Z]*p + izhi] = halo->hyhi[hsz[Y]*p + iylo];
-          halo->fzhi[hsz[Z]*p + izhi] = halo->hyhi[hsz[Y]*p + iyhi];
+          halo_swap_elcpy(nbyte, halo->fzlo, hsz[Z]*p + izlo,
+			  halo->hylo, hsz[Y]*p + iylo);
+          halo_swap_elcpy(nbyte, halo->fzhi, hsz[Z]*p + izlo,
+			  halo->hylo, hsz[Y]*p + iyhi);
+          halo_swap_elcpy(nbyte, halo->fzlo, hsz[Z]*p + izhi,
+			  halo->hyhi, hsz[Y]*p + iylo);
+          halo_swap_elcpy(nbyte, halo->fzhi, hsz[Z]*p + izhi,
+			  halo->hyhi, hsz[Y]*p + iyhi);
         }
       }
     }
@@ -1012,18 +1138,18 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
     /* fzhi -> hzlo */
     tdpMemcpy(&tmp, &halo->target->hzlo, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(tmp, halo->fzhi, ncount*sizeof(double),
+    tdpMemcpyAsync(tmp, halo->fzhi, ncount*nbyte,
 		   tdpMemcpyHostToDevice, halo->stream[Z]);
     /* fzlo -> hzhi */
     tdpMemcpy(&tmp, &halo->target->hzhi, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
-    tdpMemcpyAsync(tmp, halo->fzlo, ncount*sizeof(double),
+    tdpMemcpyAsync(tmp, halo->fzlo, ncount*nbyte,
 		   tdpMemcpyHostToDevice, halo->stream[Z]);
   }
   else {
-    MPI_Isend(halo->fzhi, ncount, MPI_DOUBLE,
+    MPI_Isend(halo->fzhi, ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs,FORWARD,Z), ftagz, comm, req_z + 2);
-    MPI_Isend(halo->fzlo,  ncount, MPI_DOUBLE,
+    MPI_Isend(halo->fzlo,  ncount, halo->mpidata,
 	      cs_cart_neighb(halo->cs,BACKWARD,Z), btagz, comm, req_z + 3);
 
     for (m = 0; m < 4; m++) {
@@ -1031,13 +1157,13 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
       if (mc == 0 && ndevice > 0) {
 	tdpMemcpy(&tmp, &halo->target->hzlo, sizeof(double *),
 		  tdpMemcpyDeviceToHost);
-	tdpMemcpyAsync(tmp, halo->hzlo, ncount*sizeof(double),
+	tdpMemcpyAsync(tmp, halo->hzlo, ncount*nbyte,
 		       tdpMemcpyHostToDevice, halo->stream[Z]);
       }
       if (mc == 1 && ndevice > 0) {
 	tdpMemcpy(&tmp, &halo->target->hzhi, sizeof(double *),
 		  tdpMemcpyDeviceToHost);
-	tdpMemcpyAsync(tmp, halo->hzhi, ncount*sizeof(double),
+	tdpMemcpyAsync(tmp, halo->hzhi, ncount*nbyte,
 		       tdpMemcpyHostToDevice, halo->stream[Z]);
       }
     }
@@ -1064,7 +1190,7 @@ __host__ int halo_swap_packed(halo_swap_t * halo, double * data) {
  *****************************************************************************/
 
 __global__
-void halo_swap_pack_rank1(halo_swap_t * halo, int id, double * data) {
+void halo_swap_pack_rank1(halo_swap_t * halo, int id, void * data) {
 
   int kindex;
 
@@ -1123,11 +1249,13 @@ void halo_swap_pack_rank1(halo_swap_t * halo, int id, double * data) {
       /* Low end, and high end */
 
       for (ia = 0; ia < hp->na; ia++) {
-	buflo[hsz*ia + kindex] = data[addr_rank1(hp->naddr, hp->na, indexl, ia)];
+	halo_swap_elcpy(hp->nbyte, buflo, hsz*ia + kindex,
+			data, addr_rank1(hp->naddr, hp->na, indexl, ia));
       }
 
       for (ia = 0; ia < hp->na; ia++) {
-	bufhi[hsz*ia + kindex] = data[addr_rank1(hp->naddr, hp->na, indexh, ia)];
+	halo_swap_elcpy(hp->nbyte, bufhi, hsz*ia + kindex,
+			data, addr_rank1(hp->naddr, hp->na, indexh, ia));
       }
     }
     else {
@@ -1136,8 +1264,8 @@ void halo_swap_pack_rank1(halo_swap_t * halo, int id, double * data) {
       nel = 0;
       for (ia = 0; ia < hp->na; ia++) {
 	for (ib = 0; ib < hp->nb; ib++) {
-	  buflo[hsz*nel + kindex] =
-	    data[addr_rank2(hp->naddr, hp->na, hp->nb, indexl, ia, ib)];
+	  halo_swap_elcpy(hp->nbyte, buflo, hsz*nel + kindex, data,
+			  addr_rank2(hp->naddr, hp->na, hp->nb, indexl, ia, ib));
 	  nel += 1;
 	}
       }
@@ -1145,8 +1273,8 @@ void halo_swap_pack_rank1(halo_swap_t * halo, int id, double * data) {
       nel = 0;
       for (ia = 0; ia < hp->na; ia++) {
 	for (ib = 0; ib < hp->nb; ib++) {
-	  bufhi[hsz*nel + kindex] =
-	    data[addr_rank2(hp->naddr, hp->na, hp->nb, indexh, ia, ib)];
+	  halo_swap_elcpy(hp->nbyte, bufhi, hsz*nel + kindex, data,
+			  addr_rank2(hp->naddr, hp->na, hp->nb, indexh, ia, ib));
 	  nel += 1;
 	}
       }
@@ -1166,7 +1294,7 @@ void halo_swap_pack_rank1(halo_swap_t * halo, int id, double * data) {
  *****************************************************************************/
 
 __global__
-void halo_swap_unpack_rank1(halo_swap_t * halo, int id, double * data) {
+void halo_swap_unpack_rank1(halo_swap_t * halo, int id, void * data) {
 
   int kindex;
 
@@ -1230,11 +1358,13 @@ void halo_swap_unpack_rank1(halo_swap_t * halo, int id, double * data) {
       /* Low end, then high end */
 
       for (ia = 0; ia < hp->na; ia++) {
-	data[addr_rank1(hp->naddr, hp->na, indexl, ia)] = buflo[hsz*ia + kindex];
+	halo_swap_elcpy(hp->nbyte, data, addr_rank1(hp->naddr, hp->na, indexl, ia),
+			buflo, hsz*ia + kindex);
       }
 
       for (ia = 0; ia < hp->na; ia++) {
-	data[addr_rank1(hp->naddr, hp->na, indexh, ia)] = bufhi[hsz*ia + kindex];
+	halo_swap_elcpy(hp->nbyte, data, addr_rank1(hp->naddr, hp->na, indexh, ia),
+			bufhi, hsz*ia + kindex);
       }
 
     }
@@ -1244,8 +1374,9 @@ void halo_swap_unpack_rank1(halo_swap_t * halo, int id, double * data) {
       nel = 0;
       for (ia = 0; ia < hp->na; ia++) {
 	for (ib = 0; ib < hp->nb; ib++) {
-	  data[addr_rank2(hp->naddr, hp->na, hp->nb, indexl, ia, ib)] =
-	    buflo[hsz*nel + kindex];
+	  halo_swap_elcpy(hp->nbyte, data,
+			  addr_rank2(hp->naddr, hp->na, hp->nb, indexl, ia, ib),
+			  buflo, hsz*nel + kindex);
 	  nel += 1;
 	}
       }
@@ -1253,8 +1384,9 @@ void halo_swap_unpack_rank1(halo_swap_t * halo, int id, double * data) {
       nel = 0;
       for (ia = 0; ia < hp->na; ia++) {
 	for (ib = 0; ib < hp->nb; ib++) {
-	  data[addr_rank2(hp->naddr, hp->na, hp->nb, indexh, ia, ib)] =
-	    bufhi[hsz*nel + kindex];
+	  halo_swap_elcpy(hp->nbyte, data,
+			  addr_rank2(hp->naddr, hp->na, hp->nb, indexh, ia, ib),
+			  bufhi, hsz*nel + kindex);
 	  nel += 1;
 	}
       }
@@ -1335,3 +1467,24 @@ int halo_swap_bufindex(halo_swap_t * halo, int id, int ic, int jc, int kc) {
 
   return (ic*xstr + jc*ystr + kc);
 }
+
+/*****************************************************************************
+ *
+ *  halo_swap_elcpy
+ *
+ *  Copy one element dst[idst] = src[isrc] of size nbyte.
+ *
+ *****************************************************************************/
+
+__host__ __device__ void halo_swap_elcpy(int nbyte, void * dst, int idst,
+					 const void * src, int isrc) {
+
+  if (nbyte == sizeof(float)) {
+    ((float *) dst)[idst] = ((const float *) src)[isrc];
+  }
+  else {
+    ((double *) dst)[idst] = ((const double *) src)[isrc];
+  }
+
+  return;
+}
@@ -28,6 +28,8 @@ static int hydro_lees_edwards_parallel(hydro_t * obj);
 static int hydro_u_write(FILE * fp, int index, void * self);
 static int hydro_u_write_ascii(FILE * fp, int index, void * self);
 static int hydro_u_read(FILE * fp, int index, void * self);
+static int hydro_u_pack(void * self, char * buf);
+static int hydro_u_unpack(void * self, char * buf);
 static int hydro_u_read_ascii(FILE * fp, int index, void * self);
 
 static __global__
@@ -273,6 +275,7 @@ __host__ int hydro_init_io_info(hydro_t * obj, int grid[3], int form_in,
   io_info_write_set(obj->info, IO_FORMAT_ASCII, hydro_u_write_ascii);
   io_info_read_set(obj->info, IO_FORMAT_BINARY, hydro_u_read);
   io_info_read_set(obj->info, IO_FORMAT_ASCII, hydro_u_read_ascii);
+  io_info_pack_set(obj->info, hydro_u_pack, hydro_u_unpack);
 
   /* ASCII output size (see write_ascii) is 69 bytes */
   io_info_set_bytesize(obj->info, IO_FORMAT_BINARY, NHDIM*sizeof(double));
@@ -755,6 +758,40 @@ static int hydro_u_write(FILE * fp, int index, void * arg) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  hydro_u_pack
+ *
+ *  Bulk binary equivalent of hydro_u_write() for all local sites.
+ *
+ *****************************************************************************/
+
+static int hydro_u_pack(void * self, char * buf) {
+
+  hydro_t * obj = (hydro_t *) self;
+
+  assert(obj);
+
+  return io_pack_rank1(obj->cs, obj->nsite, NHDIM, sizeof(double), obj->u,
+		       NHDIM*sizeof(double), 0, buf);
+}
+
+/*****************************************************************************
+ *
+ *  hydro_u_unpack
+ *
+ *****************************************************************************/
+
+static int hydro_u_unpack(void * self, char * buf) {
+
+  hydro_t * obj = (hydro_t *) self;
+
+  assert(obj);
+
+  return io_unpack_rank1(obj->cs, obj->nsite, NHDIM, sizeof(double), obj->u,
+			 NHDIM*sizeof(double), 0, buf);
+}
+
 /*****************************************************************************
  *
  *  hydro_u_write_ascii
@@ -35,6 +35,7 @@
 #include "control.h"
 #include "stats_colloid.h"
 #include "driven_colloid.h"
+#include "colloids_nlist.h"
 #include "interaction.h"
 
 struct interact_s {
@@ -49,6 +50,8 @@ struct interact_s {
   int    hcset[INTERACT_MAX];        /* Surface-surface interaction active */
   double hc[INTERACT_MAX];           /* Surface-surface cutoff range */
 
+  double skin;                       /* Neighbour list skin (0 for none) */
+
   void * abstr[INTERACT_MAX];        /* Abstract interaction types */
   compute_ft compute[INTERACT_MAX];  /* Corresponding compute functions */
   stat_ft stats[INTERACT_MAX];       /* Statisitics functions */
@@ -283,6 +286,19 @@ int interact_stats(interact_t * obj, colloids_info_t * cinfo) {
 	pe_info(obj->pe, "Pair potential energy is:    %14.7e\n", v);
       }
 
+      {
+	colloids_nlist_t * nlist = NULL;
+
+	colloids_info_nlist(cinfo, &nlist);
+
+	if (nlist) {
+	  int nbuildlocal, nbuild;
+	  colloids_nlist_nbuild(nlist, &nbuildlocal);
+	  MPI_Reduce(&nbuildlocal, &nbuild, 1, MPI_INT, MPI_MAX, 0, comm);
+	  pe_info(obj->pe, "Neighbour list builds:       %d\n", nbuild);
+	}
+      }
+
       intr = obj->abstr[INTERACT_BOND];
 
       if (intr) {
@@ -532,6 +548,8 @@ int interact_pairwise(interact_t * obj, colloids_info_t * cinfo) {
   assert(obj);
   assert(cinfo);
 
+  interact_nlist_update(obj, cinfo);
+
   intr = obj->abstr[INTERACT_LUBR];
   if (intr) obj->compute[INTERACT_LUBR](cinfo, intr);
 
@@ -541,6 +559,42 @@ int interact_pairwise(interact_t * obj, colloids_info_t * cinfo) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  interact_nlist_update
+ *
+ *  If a skin is set, the neighbour list for the pairwise interactions
+ *  is created (if necessary) and rebuilt (if necessary).
+ *
+ *****************************************************************************/
+
+int interact_nlist_update(interact_t * obj, colloids_info_t * cinfo) {
+
+  double rc, hc;
+  colloids_nlist_t * nlist = NULL;
+
+  assert(obj);
+  assert(cinfo);
+
+  if (obj->skin <= 0.0) return 0;
+  if (obj->abstr[INTERACT_LUBR] == NULL && obj->abstr[INTERACT_PAIR] == NULL) {
+    return 0;
+  }
+
+  colloids_info_nlist(cinfo, &nlist);
+
+  if (nlist == NULL) {
+    interact_rcmax(obj, &rc);
+    interact_hcmax(obj, &hc);
+    colloids_nlist_create(obj->pe, obj->cs, rc, hc, obj->skin, &nlist);
+    colloids_info_nlist_set(cinfo, nlist);
+  }
+
+  colloids_nlist_update(nlist, cinfo);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  interact_wall
@@ -724,6 +778,40 @@ int interact_hcmax(interact_t * obj, double * hcmax) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  interact_skin
+ *
+ *****************************************************************************/
+
+int interact_skin(interact_t * obj, double * skin) {
+
+  assert(obj);
+  assert(skin);
+
+  *skin = obj->skin;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  interact_skin_set
+ *
+ *  A skin > 0 requests a Verlet neighbour list for pair interactions.
+ *
+ *****************************************************************************/
+
+int interact_skin_set(interact_t * obj, double skin) {
+
+  assert(obj);
+  assert(skin >= 0.0);
+
+  obj->skin = skin;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  interact_range_check
@@ -734,6 +822,7 @@ int interact_hcmax(interact_t * obj, double * hcmax) {
  *  For surface-surface separation based potentials, the criterion has
  *  a contribution of the largest colloid diameter present. For centre-
  *  centre calculations (such as Yukawa), this is not required.
+ *  Any neighbour list skin is also included.
  *
  *****************************************************************************/
 
@@ -762,7 +851,7 @@ int interact_range_check(interact_t * obj, colloids_info_t * cinfo) {
   colloids_info_ahmax(cinfo, &ahmax);
   interact_rcmax(obj, &rc);
   interact_hcmax(obj, &hc);
-  rmax = dmax(2.0*ahmax + hc, rc);
+  rmax = dmax(2.0*ahmax + hc, rc) + obj->skin;
 
   /* Check against the cell list */
 
@@ -63,6 +63,9 @@ int interact_find_bonds(interact_t * obj, colloids_info_t * cinfo);
 int interact_stats(interact_t * obj, colloids_info_t * cinfo);
 int interact_hcmax(interact_t * obj, double * hcmax);
 int interact_rcmax(interact_t * obj, double * rcmax);
+int interact_skin(interact_t * obj, double * skin);
+int interact_skin_set(interact_t * obj, double skin);
+int interact_nlist_update(interact_t * obj, colloids_info_t * cinfo);
 
 int colloids_update_forces_zero(colloids_info_t * cinfo);
 int colloids_update_forces_external(colloids_info_t * cinfo, psi_t * psi);
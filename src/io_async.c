@@ -0,0 +1,441 @@
+/*****************************************************************************
+ *
+ *  io_async.c
+ *
+ *  Background (asynchronous) writer for lattice output.
+ *
+ *  A single writer thread drains a bounded queue of write requests.
+ *  Each request is a complete, contiguous buffer which is written to
+ *  a given offset in a given file; the buffer is owned (and released)
+ *  by the writer once queued. If the queue is full, the caller blocks
+ *  until a slot is available, so at most nqueue buffers are in flight.
+ *
+ *  Files are written with pwrite() and then truncated to the size of
+ *  the complete file (given with each request), so requests from
+ *  different ranks for the same file do not need to be ordered, and
+ *  no stale data remain from a previous, longer, file of the same
+ *  name. Only the main thread makes MPI calls.
+ *
+ *  Work which needs MPI (e.g., the gather of a group's data to its
+ *  root) may be deferred as a "stage": a callback which the main
+ *  thread polls at later io_async calls, and completes at a flush.
+ *  Stages complete in the order they were added, so writes to the
+ *  same file are still queued in order.
+ *
+ *  The writer times each write itself (the timers are not thread-safe,
+ *  so the time is accumulated here) and the total is merged into
+ *  TIMER_IO_ASYNC at the next flush. Time the main thread spends
+ *  waiting (a full queue, or a flush) is visible to the caller, e.g.,
+ *  as part of TIMER_IO.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "timer.h"
+#include "io_async.h"
+
+typedef struct io_async_job_s io_async_job_t;
+
+struct io_async_job_s {
+  char filename[FILENAME_MAX];
+  long int offset;               /* Offset in file (bytes) */
+  long int fsize;                /* Size of complete file (bytes) */
+  size_t nbytes;                 /* Size of buf (bytes) */
+  char * buf;                    /* Data (owned by the queue) */
+};
+
+typedef struct io_async_stage_s io_async_stage_t;
+
+struct io_async_stage_s {
+  io_async_stage_ft complete;    /* Completion callback */
+  void * ctx;                    /* Context for callback */
+  io_async_stage_t * next;
+};
+
+struct io_async_s {
+  pe_t * pe;
+  int nqueue;                    /* Maximum queue depth */
+  int nhead;                     /* Position of next job in queue */
+  int njob;                      /* Jobs queued (including one in progress) */
+  int ierr;                      /* First error (errno) from writer */
+  int shutdown;                  /* Writer to exit when queue empty */
+  int nwrite;                    /* Writes completed since last flush */
+  double tsum;                   /* Writer time since last flush (s) */
+  double tmin;                   /* Minimum time per write (s) */
+  double tmax;                   /* Maximum time per write (s) */
+  io_async_job_t * job;          /* Ring buffer of jobs [nqueue] */
+  io_async_stage_t * stage;      /* Deferred stages (main thread only) */
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t queued;         /* Job added (or shutdown) */
+  pthread_cond_t done;           /* Job completed */
+};
+
+static void * io_async_writer(void * arg);
+static int io_async_job_write(io_async_job_t * job);
+static int io_async_progress(io_async_t * obj, int wait);
+static double io_async_wtime(void);
+
+/*****************************************************************************
+ *
+ *  io_async_create
+ *
+ *****************************************************************************/
+
+__host__ int io_async_create(pe_t * pe, int nqueue, io_async_t ** pobj) {
+
+  io_async_t * obj = NULL;
+
+  assert(pe);
+  assert(pobj);
+
+  if (nqueue < 1) pe_fatal(pe, "io_async queue depth must be at least 1\n");
+
+  obj = (io_async_t *) calloc(1, sizeof(io_async_t));
+  assert(obj);
+  if (obj == NULL) pe_fatal(pe, "calloc(io_async_t) failed\n");
+
+  obj->job = (io_async_job_t *) calloc(nqueue, sizeof(io_async_job_t));
+  assert(obj->job);
+  if (obj->job == NULL) pe_fatal(pe, "calloc(io_async_job_t) failed\n");
+
+  obj->pe = pe;
+  obj->nqueue = nqueue;
+
+  pthread_mutex_init(&obj->lock, NULL);
+  pthread_cond_init(&obj->queued, NULL);
+  pthread_cond_init(&obj->done, NULL);
+
+  if (pthread_create(&obj->thread, NULL, io_async_writer, obj) != 0) {
+    pe_fatal(pe, "Failed to start io_async writer thread\n");
+  }
+
+  *pobj = obj;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_free
+ *
+ *  Any outstanding writes are completed first.
+ *
+ *****************************************************************************/
+
+__host__ int io_async_free(io_async_t * obj) {
+
+  assert(obj);
+
+  io_async_flush(obj);
+
+  pthread_mutex_lock(&obj->lock);
+  obj->shutdown = 1;
+  pthread_cond_signal(&obj->queued);
+  pthread_mutex_unlock(&obj->lock);
+
+  pthread_join(obj->thread, NULL);
+
+  pthread_cond_destroy(&obj->done);
+  pthread_cond_destroy(&obj->queued);
+  pthread_mutex_destroy(&obj->lock);
+
+  free(obj->job);
+  free(obj);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_nqueue
+ *
+ *****************************************************************************/
+
+__host__ int io_async_nqueue(io_async_t * obj, int * nqueue) {
+
+  assert(obj);
+  assert(nqueue);
+
+  *nqueue = obj->nqueue;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_write
+ *
+ *  Queue nbytes of buf for writing at offset in filename, which is
+ *  to be fsize bytes in total. The buffer must have been obtained
+ *  from malloc(); it is released by the writer and must not be
+ *  referenced by the caller after this call.
+ *
+ *  Blocks while the queue is full.
+ *
+ *****************************************************************************/
+
+__host__ int io_async_write(io_async_t * obj, const char * filename,
+			    long int offset, long int fsize,
+			    char * buf, size_t nbytes) {
+  int n;
+
+  assert(obj);
+  assert(filename);
+  assert(strlen(filename) < FILENAME_MAX);
+  assert(offset >= 0);
+  assert(offset + (long int) nbytes <= fsize);
+  assert(buf);
+
+  pthread_mutex_lock(&obj->lock);
+
+  while (obj->njob == obj->nqueue) {
+    pthread_cond_wait(&obj->done, &obj->lock);
+  }
+
+  n = (obj->nhead + obj->njob) % obj->nqueue;
+
+  strncpy(obj->job[n].filename, filename, FILENAME_MAX - 1);
+  obj->job[n].offset = offset;
+  obj->job[n].fsize = fsize;
+  obj->job[n].nbytes = nbytes;
+  obj->job[n].buf = buf;
+  obj->njob += 1;
+
+  pthread_cond_signal(&obj->queued);
+  pthread_mutex_unlock(&obj->lock);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_stage
+ *
+ *  Add a deferred stage. The callback is polled with wait = 0 (and
+ *  must then not block) until it reports done = 1; at a flush it is
+ *  called with wait = 1 and must complete. On completion the callback
+ *  is responsible for the context, and may call io_async_write().
+ *
+ *  Stages are polled, in order, here and at io_async_flush().
+ *
+ *****************************************************************************/
+
+__host__ int io_async_stage(io_async_t * obj, io_async_stage_ft complete,
+			    void * ctx) {
+
+  io_async_stage_t * stage = NULL;
+  io_async_stage_t ** last = NULL;
+
+  assert(obj);
+  assert(complete);
+
+  stage = (io_async_stage_t *) calloc(1, sizeof(io_async_stage_t));
+  assert(stage);
+  if (stage == NULL) pe_fatal(obj->pe, "calloc(io_async_stage_t) failed\n");
+
+  stage->complete = complete;
+  stage->ctx = ctx;
+
+  for (last = &obj->stage; *last; last = &(*last)->next);
+  *last = stage;
+
+  io_async_progress(obj, 0);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_flush
+ *
+ *  Complete all stages, and block until all queued writes have
+ *  completed. Any error in the writer is reported here. The writer
+ *  time since the last flush is added to TIMER_IO_ASYNC.
+ *
+ *****************************************************************************/
+
+__host__ int io_async_flush(io_async_t * obj) {
+
+  int ierr;
+  int nwrite;
+  double tsum, tmin, tmax;
+
+  assert(obj);
+
+  io_async_progress(obj, 1);
+
+  pthread_mutex_lock(&obj->lock);
+  while (obj->njob > 0) {
+    pthread_cond_wait(&obj->done, &obj->lock);
+  }
+  ierr = obj->ierr;
+  nwrite = obj->nwrite;
+  tsum = obj->tsum;
+  tmin = obj->tmin;
+  tmax = obj->tmax;
+  obj->nwrite = 0;
+  obj->tsum = 0.0;
+  pthread_mutex_unlock(&obj->lock);
+
+  if (nwrite > 0) TIMER_add(TIMER_IO_ASYNC, nwrite, tsum, tmin, tmax);
+
+  if (ierr) pe_fatal(obj->pe, "Asynchronous write failed: %s\n",
+		     strerror(ierr));
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_progress
+ *
+ *  Poll the stages in order, removing those which are complete. With
+ *  wait = 0, stop at the first which is not; otherwise, complete all.
+ *
+ *****************************************************************************/
+
+static int io_async_progress(io_async_t * obj, int wait) {
+
+  int done;
+  io_async_stage_t * stage = NULL;
+
+  assert(obj);
+
+  while (obj->stage) {
+    stage = obj->stage;
+    done = 0;
+    stage->complete(stage->ctx, wait, &done);
+    if (wait) assert(done);
+    if (done == 0) break;
+    obj->stage = stage->next;
+    free(stage);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_writer
+ *
+ *  Writer thread: take jobs from the head of the queue in order.
+ *
+ *****************************************************************************/
+
+static void * io_async_writer(void * arg) {
+
+  int ierr;
+  double t0, t1;
+  io_async_job_t job;
+  io_async_t * obj = (io_async_t *) arg;
+
+  assert(obj);
+
+  pthread_mutex_lock(&obj->lock);
+
+  while (1) {
+
+    while (obj->njob == 0 && obj->shutdown == 0) {
+      pthread_cond_wait(&obj->queued, &obj->lock);
+    }
+    if (obj->njob == 0) break;
+
+    /* The slot remains occupied until the write has completed. */
+
+    job = obj->job[obj->nhead];
+    pthread_mutex_unlock(&obj->lock);
+
+    t0 = io_async_wtime();
+    ierr = io_async_job_write(&job);
+    t1 = io_async_wtime();
+    free(job.buf);
+
+    pthread_mutex_lock(&obj->lock);
+    if (ierr && obj->ierr == 0) obj->ierr = ierr;
+    if (obj->nwrite == 0 || t1 - t0 < obj->tmin) obj->tmin = t1 - t0;
+    if (obj->nwrite == 0 || t1 - t0 > obj->tmax) obj->tmax = t1 - t0;
+    obj->tsum += (t1 - t0);
+    obj->nwrite += 1;
+    obj->nhead = (obj->nhead + 1) % obj->nqueue;
+    obj->njob -= 1;
+    pthread_cond_broadcast(&obj->done);
+  }
+
+  pthread_mutex_unlock(&obj->lock);
+
+  return NULL;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_job_write
+ *
+ *  Returns zero on success, or errno on failure.
+ *
+ *****************************************************************************/
+
+static int io_async_job_write(io_async_job_t * job) {
+
+  int fd;
+  int ierr = 0;
+  size_t nw = 0;
+  ssize_t n;
+
+  assert(job);
+
+  fd = open(job->filename, O_WRONLY | O_CREAT, 0644);
+  if (fd < 0) return errno;
+
+  while (nw < job->nbytes) {
+    n = pwrite(fd, job->buf + nw, job->nbytes - nw, job->offset + nw);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      ierr = errno;
+      break;
+    }
+    nw += n;
+  }
+
+  /* Every job for the file sets the same size, so order is immaterial */
+
+  if (ierr == 0 && ftruncate(fd, job->fsize) != 0) ierr = errno;
+
+  if (close(fd) != 0 && ierr == 0) ierr = errno;
+
+  return ierr;
+}
+
+/*****************************************************************************
+ *
+ *  io_async_wtime
+ *
+ *  Wall clock for the writer thread, which may not make MPI calls.
+ *
+ *****************************************************************************/
+
+static double io_async_wtime(void) {
+
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double) ts.tv_sec + 1.0e-09*ts.tv_nsec;
+}
@@ -0,0 +1,39 @@
+/*****************************************************************************
+ *
+ *  io_async.h
+ *
+ *  Background (asynchronous) writer for lattice output.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_IO_ASYNC_H
+#define LUDWIG_IO_ASYNC_H
+
+#include <stddef.h>
+
+#include "pe.h"
+
+typedef struct io_async_s io_async_t;
+
+/* Deferred stage callback: set *done = 1 when complete */
+typedef int (*io_async_stage_ft)(void * ctx, int wait, int * done);
+
+__host__ int io_async_create(pe_t * pe, int nqueue, io_async_t ** pobj);
+__host__ int io_async_free(io_async_t * obj);
+__host__ int io_async_write(io_async_t * obj, const char * filename,
+			    long int offset, long int fsize,
+			    char * buf, size_t nbytes);
+__host__ int io_async_stage(io_async_t * obj, io_async_stage_ft complete,
+			    void * ctx);
+__host__ int io_async_flush(io_async_t * obj);
+__host__ int io_async_nqueue(io_async_t * obj, int * nqueue);
+
+#endif
@@ -16,11 +16,13 @@
  *  lattice Cartesian communicator. Each IO communicator group so
  *  defined then deals with its own file.
  *
+ *  Decomposition-independent binary files may optionally be written
+ *  and read collectively using MPI-IO (see io_info_mpiio_set()).
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2007-2018 The University of Edinburgh
+ *  (c) 2007-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -28,12 +30,14 @@
  *****************************************************************************/
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "pe.h"
 #include "util.h"
+#include "memory.h"
 #include "coords_s.h"
 #include "leesedwards.h"
 #include "io_harness.h"
@@ -67,6 +71,10 @@ struct io_info_s {
   int processor_independent;
   int single_file_read;
   int report;                        /* Report time taken for output */
+  int mpiio;                         /* Use MPI-IO collective file access */
+  io_async_t * async;                /* Background writer (if present) */
+  io_pack_cb_ft pack;                /* Bulk binary pack (optional) */
+  io_pack_cb_ft unpack;              /* Bulk binary unpack (optional) */
   char metadata_stub[FILENAME_MAX];
   char name[FILENAME_MAX];
   io_rw_cb_ft write_data;
@@ -77,6 +85,24 @@ struct io_info_s {
   io_rw_cb_ft read_binary;
 };
 
+/* Deferred (non-blocking) gather for asynchronous output */
+
+typedef struct io_gather_s io_gather_t;
+
+struct io_gather_s {
+  io_info_t * obj;
+  int nreq;                          /* Number of MPI requests */
+  MPI_Request * req;                 /* Requests [nreq] */
+  char * buf;                        /* Sender: local buffer */
+  char * rbuf;                       /* Root: receive buffers [nreq] */
+  size_t rsz;                        /* Root: size of each receive buffer */
+  char * io_buf;                     /* Root: group buffer */
+  size_t iosz;                       /* Root: size of group buffer */
+  long int offset;                   /* Root: offset of group in file */
+  long int fsize;                    /* Root: size of complete file */
+  char filename[FILENAME_MAX];
+};
+
 static void io_set_group_filename(char *, const char *, io_info_t *);
 static long int io_file_offset(int, int, io_info_t *);
 static int io_decomposition_create(pe_t * pe, cs_t * cs, const int grid[3],
@@ -86,8 +112,20 @@ static int io_decomposition_free(io_decomposition_t *);
 
 int io_write_data_p(io_info_t * obj, const char * filename_stub, void * data);
 int io_write_data_s(io_info_t * obj, const char * filename_stub, void * data);
+int io_write_data_m(io_info_t * obj, const char * filename_stub, void * data);
+int io_read_data_m(io_info_t * obj, const char * filename_stub, void * data);
+static int io_mpiio_view(io_info_t * obj, MPI_File fh, MPI_Datatype * etype,
+			 MPI_Datatype * filetype);
 int io_unpack_local_buf(io_info_t * obj, int mpi_sender, const char * buf,
 			char * io_buf);
+static int io_local_buf_write(io_info_t * obj, void * data, char * buf);
+static int io_local_buf_read(io_info_t * obj, void * data, char * buf);
+static int io_rank1_strips(cs_t * cs, int nsites, int na, size_t sz,
+			   char * data, size_t recsz, size_t offset,
+			   char * buf, int pack);
+static int io_write_data_a(io_info_t * obj, const char * filename_stub,
+			   void * data);
+static int io_gather_complete(void * ctx, int wait, int * done);
 
 /*****************************************************************************
  *
@@ -240,6 +278,7 @@ static void io_set_group_filename(char * filename_io, const char * stub,
 static int io_decomposition_free(io_decomposition_t * p) {
 
   assert(p);
+  MPI_Comm_free(&p->xcomm);
   MPI_Comm_free(&p->comm);
   free(p);
  
@@ -497,6 +536,68 @@ int io_write_metadata_file(io_info_t * info, char * filename_stub) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  io_read_metadata_check
+ *
+ *  If a metadata file for this stub exists, the data description and
+ *  the data size per site it records must agree with the current
+ *  io_info. E.g., distributions stored in float cannot be read by a
+ *  double build, or vice versa.
+ *
+ *  Collective in the I/O group. Returns zero if no metadata file is
+ *  present, or the metadata agree; non-zero on a mismatch.
+ *
+ *****************************************************************************/
+
+int io_read_metadata_check(io_info_t * info, const char * filename_stub) {
+
+  int ifail = 0;
+  int bytesize = -1;
+  char filename[FILENAME_MAX];
+  char filename_io[2*FILENAME_MAX];
+  char line[2*FILENAME_MAX];
+  char name[FILENAME_MAX] = "";
+  FILE * fp_meta = NULL;
+
+  const char * key_name = "Data description:";
+  const char * key_size = "Data size per site (bytes):";
+
+  assert(info);
+  assert(filename_stub);
+
+  if (info->io_comm->rank == 0) {
+
+    io_set_group_filename(filename, filename_stub, info);
+    sprintf(filename_io, "%s.meta", filename);
+
+    fp_meta = fopen(filename_io, "r");
+
+    if (fp_meta) {
+      while (fgets(line, 2*FILENAME_MAX, fp_meta)) {
+	char * p = line;
+	line[strcspn(line, "\n")] = '\0';
+	if (strncmp(line, key_name, strlen(key_name)) == 0) {
+	  p += strlen(key_name);
+	  p += strspn(p, " ");
+	  strncpy(name, p, FILENAME_MAX - 1);
+	}
+	if (strncmp(line, key_size, strlen(key_size)) == 0) {
+	  bytesize = atoi(line + strlen(key_size));
+	}
+      }
+      fclose(fp_meta);
+
+      if (strcmp(name, info->name) != 0) ifail = 1;
+      if (bytesize != (int) info->bytesize) ifail = 1;
+    }
+  }
+
+  MPI_Bcast(&ifail, 1, MPI_INT, 0, info->io_comm->comm);
+
+  return ifail;
+}
+
 /*****************************************************************************
  *
  *  io_remove_metadata
@@ -698,6 +799,8 @@ int io_info_write_set(io_info_t * obj, int format, io_rw_cb_ft f) {
 
 int io_write_data(io_info_t * obj, const char * filename_stub, void * data) {
 
+  int ntotal[3];
+  size_t nbytes;
   double t0, t1;
 
   assert(obj);
@@ -707,11 +810,28 @@ int io_write_data(io_info_t * obj, const char * filename_stub, void * data) {
     /* Use the standard "parallel" method for the time being. */
     io_write_data_p(obj, filename_stub, data);
   }
+  else if (obj->mpiio) {
+    /* Collective write of the whole lattice to a single file */
+    t0 = MPI_Wtime();
+    io_write_data_m(obj, filename_stub, data);
+    t1 = MPI_Wtime();
+    if (obj->report) {
+      cs_ntotal(obj->cs, ntotal);
+      nbytes = obj->bytesize*ntotal[X]*ntotal[Y]*ntotal[Z];
+      pe_info(obj->pe, "Write %lu bytes in %f secs %f GB/s\n",
+	      nbytes, t1-t0, nbytes/(1.0e+09*(t1-t0)));
+    }
+  }
   else {
     /* This is serial output format if one I/O group */
     assert(obj->io_comm->ngroup[X] == 1);
     t0 = MPI_Wtime();
-    io_write_data_s(obj, filename_stub, data);
+    if (obj->async) {
+      io_write_data_a(obj, filename_stub, data);
+    }
+    else {
+      io_write_data_s(obj, filename_stub, data);
+    }
     t1 = MPI_Wtime();
     if (obj->report) {
       pe_info(obj->pe, "Write %lu bytes in %f secs %f GB/s\n",
@@ -739,6 +859,8 @@ int io_write_data_p(io_info_t * obj, const char * filename_stub, void * data) {
   int       token = 0;
   int       ic, jc, kc, index;
   int       nlocal[3];
+  size_t    localsz;
+  char *    buf = NULL;
   const int io_tag = 140;
 
   MPI_Status status;
@@ -769,11 +891,22 @@ int io_write_data_p(io_info_t * obj, const char * filename_stub, void * data) {
 
   if (fp_state == NULL) pe_fatal(obj->pe, "Failed to open %s\n", filename_io);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	index = cs_index(obj->cs, ic, jc, kc);
-	obj->write_data(fp_state, index, data);
+  if (obj->pack && obj->write_data == obj->write_binary) {
+    /* Bulk: one write for the whole local lattice */
+    localsz = (size_t) obj->bytesize*nlocal[X]*nlocal[Y]*nlocal[Z];
+    buf = (char *) malloc(localsz*sizeof(char));
+    if (buf == NULL) pe_fatal(obj->pe, "malloc(buf)\n");
+    obj->pack(data, buf);
+    fwrite(buf, sizeof(char), localsz, fp_state);
+    free(buf);
+  }
+  else {
+    for (ic = 1; ic <= nlocal[X]; ic++) {
+      for (jc = 1; jc <= nlocal[Y]; jc++) {
+	for (kc = 1; kc <= nlocal[Z]; kc++) {
+	  index = cs_index(obj->cs, ic, jc, kc);
+	  obj->write_data(fp_state, index, data);
+	}
       }
     }
   }
@@ -816,7 +949,6 @@ int io_write_data_p(io_info_t * obj, const char * filename_stub, void * data) {
 int io_write_data_s(io_info_t * obj, const char * filename_stub, void * data) {
 
   int nr;
-  int ic, jc, kc, index;
   int nlocal[3];
   int itemsz;                      /* Data size per site (bytes) */
   int iosz;                        /* Data size io_buf (bytes) */
@@ -827,7 +959,6 @@ int io_write_data_s(io_info_t * obj, const char * filename_stub, void * data) {
   char filename_io[FILENAME_MAX];
   long int offset;
   FILE * fp_state = NULL;
-  FILE * fp_buf;
 
   const int tag = 2017;
   MPI_Status status;
@@ -844,27 +975,13 @@ int io_write_data_s(io_info_t * obj, const char * filename_stub, void * data) {
 
   itemsz = obj->bytesize;
 
-  /* Local buffer to be assoicated with file handle for write... */
+  /* Write to the local buffer in local order */
 
   localsz = itemsz*nlocal[X]*nlocal[Y]*nlocal[Z];
   buf = (char *) malloc(localsz*sizeof(char));
-  fp_buf = fopen("/dev/null", "w"); /* TODO: de-hardwire this */
-  setvbuf(fp_buf, buf, _IOFBF, localsz);
+  if (buf == NULL) pe_fatal(obj->pe, "malloc(buf)\n");
 
-  if (buf == NULL || fp_buf == NULL) {
-    pe_fatal(obj->pe, "Buffer initialisation failed\n");
-  }
-
-  /* Write to the local buffer in local order */
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	index = cs_index(obj->cs, ic, jc, kc);
-	obj->write_data(fp_buf, index, data);
-      }
-    }
-  }
+  io_local_buf_write(obj, data, buf);
 
   /* Send local buffer to root. */
 
@@ -887,10 +1004,15 @@ int io_write_data_s(io_info_t * obj, const char * filename_stub, void * data) {
 
     io_unpack_local_buf(obj, 0, buf, io_buf);
 
-    for (nr = 0; nr < obj->io_comm->size - 1; nr++) {
-      MPI_Recv(rbuf, itemsz*obj->maxlocal, MPI_BYTE, MPI_ANY_SOURCE, tag,
+    /* Receive from each rank in turn: asynchronous output (see
+     * io_write_data_a()) uses the same tag, and other ranks may have
+     * sent for a later write, so MPI_ANY_SOURCE could match a later
+     * message. */
+
+    for (nr = 1; nr < obj->io_comm->size; nr++) {
+      MPI_Recv(rbuf, itemsz*obj->maxlocal, MPI_BYTE, nr, tag,
 	       obj->io_comm->comm, &status);
-      io_unpack_local_buf(obj, status.MPI_SOURCE, rbuf, io_buf);
+      io_unpack_local_buf(obj, nr, rbuf, io_buf);
     }
 
     free(rbuf);
@@ -925,12 +1047,160 @@ int io_write_data_s(io_info_t * obj, const char * filename_stub, void * data) {
     free(io_buf);
   }
 
-  fclose(fp_buf);
   free(buf);
 
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  io_write_data_a
+ *
+ *  Asynchronous version of io_write_data_s() with the same file
+ *  format. The local sites are packed to a staging buffer (the
+ *  snapshot), after which the caller may update the object. The
+ *  gather to the group root is non-blocking; it is completed as a
+ *  deferred stage of the background writer, after which the group
+ *  buffer is queued for writing. See io_async.c.
+ *
+ *****************************************************************************/
+
+static int io_write_data_a(io_info_t * obj, const char * filename_stub,
+			   void * data) {
+  int nr;
+  int nlocal[3];
+  int ntotal[3];
+  int cartsz[3];
+  size_t localsz;                  /* Data size local buffer (bytes) */
+  char * buf = NULL;
+  io_gather_t * gather = NULL;
+
+  const int tag = 2017;
+
+  assert(obj);
+  assert(data);
+  assert(obj->write_data);
+  assert(obj->async);
+
+  if (obj->metadata_written == 0) io_write_metadata(obj);
+
+  cs_nlocal(obj->cs, nlocal);
+  cs_ntotal(obj->cs, ntotal);
+  cs_cartsz(obj->cs, cartsz);
+
+  gather = (io_gather_t *) calloc(1, sizeof(io_gather_t));
+  assert(gather);
+  if (gather == NULL) pe_fatal(obj->pe, "calloc(io_gather_t) failed\n");
+
+  gather->obj = obj;
+  sprintf(gather->filename, "%s.%3.3d-%3.3d", filename_stub, 1, 1);
+
+  /* Snapshot of the local sites in local order */
+
+  localsz = (size_t) obj->bytesize*nlocal[X]*nlocal[Y]*nlocal[Z];
+  buf = (char *) malloc(localsz*sizeof(char));
+  if (buf == NULL) pe_fatal(obj->pe, "malloc(buf)\n");
+
+  io_local_buf_write(obj, data, buf);
+
+  if (obj->io_comm->rank > 0) {
+    gather->nreq = 1;
+    gather->req = (MPI_Request *) calloc(1, sizeof(MPI_Request));
+    if (gather->req == NULL) pe_fatal(obj->pe, "calloc(req) failed\n");
+    gather->buf = buf;
+    MPI_Isend(buf, (int) localsz, MPI_BYTE, 0, tag, obj->io_comm->comm,
+	      gather->req);
+  }
+  else {
+
+    gather->iosz = (size_t) obj->bytesize*obj->nsites;
+    gather->io_buf = (char *) malloc(gather->iosz*sizeof(char));
+    if (gather->io_buf == NULL) pe_fatal(obj->pe, "malloc(io_buf)\n");
+
+    io_unpack_local_buf(obj, 0, buf, gather->io_buf);
+    free(buf);
+
+    /* One receive buffer per sender, large enough for any rank */
+
+    gather->nreq = obj->io_comm->size - 1;
+    gather->rsz = (size_t) obj->bytesize
+      *((ntotal[X] + cartsz[X] - 1)/cartsz[X])
+      *((ntotal[Y] + cartsz[Y] - 1)/cartsz[Y])
+      *((ntotal[Z] + cartsz[Z] - 1)/cartsz[Z]);
+
+    if (gather->nreq > 0) {
+      gather->req = (MPI_Request *) calloc(gather->nreq, sizeof(MPI_Request));
+      gather->rbuf = (char *) malloc(gather->nreq*gather->rsz*sizeof(char));
+      if (gather->req == NULL) pe_fatal(obj->pe, "calloc(req) failed\n");
+      if (gather->rbuf == NULL) pe_fatal(obj->pe, "malloc(rbuf) failed\n");
+    }
+
+    for (nr = 1; nr < obj->io_comm->size; nr++) {
+      MPI_Irecv(gather->rbuf + (nr - 1)*gather->rsz, (int) gather->rsz,
+		MPI_BYTE, nr, tag, obj->io_comm->comm, gather->req + nr - 1);
+    }
+
+    /* Each group sets the size of the whole file, so no ordering
+     * between groups is required. */
+
+    gather->fsize = (long int) obj->bytesize*ntotal[X]*ntotal[Y]*ntotal[Z];
+    gather->offset = (long int) obj->bytesize*obj->io_comm->offset[X]
+      *obj->io_comm->nsite[Y]*obj->io_comm->nsite[Z];
+  }
+
+  io_async_stage(obj->async, io_gather_complete, gather);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_gather_complete
+ *
+ *  Deferred stage for io_write_data_a(). When the requests are complete,
+ *  the root assembles the group buffer and hands it to the writer,
+ *  which then owns it. The gather itself is released.
+ *
+ *****************************************************************************/
+
+static int io_gather_complete(void * ctx, int wait, int * done) {
+
+  int nr;
+  io_gather_t * gather = (io_gather_t *) ctx;
+
+  assert(gather);
+  assert(done);
+
+  *done = 1;
+
+  if (gather->nreq > 0) {
+    if (wait) {
+      MPI_Waitall(gather->nreq, gather->req, MPI_STATUSES_IGNORE);
+    }
+    else {
+      MPI_Testall(gather->nreq, gather->req, done, MPI_STATUSES_IGNORE);
+    }
+  }
+
+  if (*done == 0) return 0;
+
+  if (gather->io_buf) {
+    for (nr = 1; nr <= gather->nreq; nr++) {
+      io_unpack_local_buf(gather->obj, nr, gather->rbuf + (nr - 1)*gather->rsz,
+			  gather->io_buf);
+    }
+    io_async_write(gather->obj->async, gather->filename, gather->offset,
+		   gather->fsize, gather->io_buf, gather->iosz);
+  }
+
+  free(gather->rbuf);
+  free(gather->buf);
+  free(gather->req);
+  free(gather);
+
+  return 0;
+}
+
 /****************************************************************************
  *
  *  io_unpack_local_buf
@@ -999,6 +1269,294 @@ int io_unpack_local_buf(io_info_t * obj, int mpi_sender, const char * buf,
 }
 
 
+/*****************************************************************************
+ *
+ *  io_mpiio_view
+ *
+ *  Set the file view for collective MPI-IO. The file holds the whole
+ *  lattice in the same (decomposition-independent) order as
+ *  io_write_data_s(); each rank sees its own local subarray.
+ *
+ *  The caller must free the etype and filetype returned.
+ *
+ *****************************************************************************/
+
+static int io_mpiio_view(io_info_t * obj, MPI_File fh, MPI_Datatype * etype,
+			 MPI_Datatype * filetype) {
+  int ntotal[3];
+  int nlocal[3];
+  int noffset[3];
+
+  assert(obj);
+  assert(etype);
+  assert(filetype);
+
+  cs_ntotal(obj->cs, ntotal);
+  cs_nlocal(obj->cs, nlocal);
+  cs_nlocal_offset(obj->cs, noffset);
+
+  /* One element per lattice site */
+
+  MPI_Type_contiguous(obj->bytesize, MPI_BYTE, etype);
+  MPI_Type_commit(etype);
+
+  MPI_Type_create_subarray(3, ntotal, nlocal, noffset, MPI_ORDER_C, *etype,
+			   filetype);
+  MPI_Type_commit(filetype);
+
+  MPI_File_set_view(fh, 0, *etype, *filetype, "native", MPI_INFO_NULL);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_write_data_m
+ *
+ *  Write data to a single decomposition-independent file using
+ *  collective MPI-IO. Each rank packs its local sites to a contiguous
+ *  buffer, and the write is a single MPI_File_write_all() across the
+ *  Cartesian communicator. The count is in site records (the etype),
+ *  so it is limited to INT_MAX sites per rank rather than bytes.
+ *
+ *  The file layout is the same as io_write_data_s().
+ *
+ *****************************************************************************/
+
+int io_write_data_m(io_info_t * obj, const char * filename_stub, void * data) {
+
+  int nlocal[3];
+  int ifail;
+  size_t nsites;                   /* Local sites (file records) */
+  size_t localsz;                  /* Data size local buffer (bytes) */
+  char * buf = NULL;
+  char filename_io[FILENAME_MAX];
+
+  MPI_Comm comm;
+  MPI_File fh = MPI_FILE_NULL;
+  MPI_Datatype etype;
+  MPI_Datatype filetype;
+
+  assert(obj);
+  assert(filename_stub);
+  assert(data);
+  assert(obj->write_data);
+
+  if (obj->metadata_written == 0) io_write_metadata(obj);
+
+  cs_nlocal(obj->cs, nlocal);
+  cs_cart_comm(obj->cs, &comm);
+  sprintf(filename_io, "%s.%3.3d-%3.3d", filename_stub, 1, 1);
+
+  nsites = (size_t) nlocal[X]*nlocal[Y]*nlocal[Z];
+  localsz = nsites*obj->bytesize;
+
+  if (nsites > INT_MAX) {
+    pe_fatal(obj->pe, "Local sites %zu exceed MPI count for %s\n", nsites,
+	     filename_io);
+  }
+
+  buf = (char *) malloc(localsz*sizeof(char));
+  if (buf == NULL) pe_fatal(obj->pe, "malloc(buf)\n");
+
+  io_local_buf_write(obj, data, buf);
+
+  ifail = MPI_File_open(comm, filename_io, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+			MPI_INFO_NULL, &fh);
+  if (ifail != MPI_SUCCESS) {
+    pe_fatal(obj->pe, "Failed to open %s\n", filename_io);
+  }
+
+  /* MPI_MODE_CREATE does not truncate an existing file */
+
+  ifail = MPI_File_set_size(fh, 0);
+  if (ifail != MPI_SUCCESS) {
+    pe_fatal(obj->pe, "Failed to truncate %s\n", filename_io);
+  }
+
+  io_mpiio_view(obj, fh, &etype, &filetype);
+
+  ifail = MPI_File_write_all(fh, buf, (int) nsites, etype, MPI_STATUS_IGNORE);
+  if (ifail != MPI_SUCCESS) {
+    pe_fatal(obj->pe, "File error on writing %s\n", filename_io);
+  }
+
+  MPI_File_close(&fh);
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&etype);
+
+  free(buf);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_read_data_m
+ *
+ *  Collective MPI-IO read of a single decomposition-independent file
+ *  (as written by io_write_data_m() or io_write_data_s()). The local
+ *  buffer is then unpacked to the object.
+ *
+ *****************************************************************************/
+
+int io_read_data_m(io_info_t * obj, const char * filename_stub, void * data) {
+
+  int nlocal[3];
+  int ifail;
+  size_t nsites;                   /* Local sites (file records) */
+  size_t localsz;                  /* Data size local buffer (bytes) */
+  char * buf = NULL;
+  char filename_io[FILENAME_MAX];
+
+  MPI_Comm comm;
+  MPI_File fh = MPI_FILE_NULL;
+  MPI_Datatype etype;
+  MPI_Datatype filetype;
+
+  assert(obj);
+  assert(filename_stub);
+  assert(data);
+  assert(obj->read_data);
+
+  cs_nlocal(obj->cs, nlocal);
+  cs_cart_comm(obj->cs, &comm);
+  sprintf(filename_io, "%s.%3.3d-%3.3d", filename_stub, 1, 1);
+
+  nsites = (size_t) nlocal[X]*nlocal[Y]*nlocal[Z];
+  localsz = nsites*obj->bytesize;
+
+  if (nsites > INT_MAX) {
+    pe_fatal(obj->pe, "Local sites %zu exceed MPI count for %s\n", nsites,
+	     filename_io);
+  }
+
+  buf = (char *) malloc(localsz*sizeof(char));
+  if (buf == NULL) pe_fatal(obj->pe, "malloc(buf)\n");
+
+  ifail = MPI_File_open(comm, filename_io, MPI_MODE_RDONLY, MPI_INFO_NULL,
+			&fh);
+  if (ifail != MPI_SUCCESS) {
+    pe_fatal(obj->pe, "Failed to open %s\n", filename_io);
+  }
+
+  io_mpiio_view(obj, fh, &etype, &filetype);
+
+  ifail = MPI_File_read_all(fh, buf, (int) nsites, etype, MPI_STATUS_IGNORE);
+  if (ifail != MPI_SUCCESS) {
+    pe_fatal(obj->pe, "File error on reading %s\n", filename_io);
+  }
+
+  MPI_File_close(&fh);
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&etype);
+
+  io_local_buf_read(obj, data, buf);
+  free(buf);
+
+  return 0;
+}
+
+
+/*****************************************************************************
+ *
+ *  io_local_buf_write
+ *
+ *  Fill buf with all local sites in file order (x, y, z; z fastest).
+ *  If the object provides a bulk pack for binary output it is used;
+ *  otherwise, the per-site callback writes to a stream which is given
+ *  buf as its buffer.
+ *
+ *****************************************************************************/
+
+static int io_local_buf_write(io_info_t * obj, void * data, char * buf) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  size_t localsz;
+  FILE * fp_buf = NULL;
+
+  assert(obj);
+  assert(data);
+  assert(buf);
+
+  if (obj->pack && obj->write_data == obj->write_binary) {
+    obj->pack(data, buf);
+    return 0;
+  }
+
+  cs_nlocal(obj->cs, nlocal);
+  localsz = (size_t) obj->bytesize*nlocal[X]*nlocal[Y]*nlocal[Z];
+
+  fp_buf = fopen("/dev/null", "w"); /* TODO: de-hardwire this */
+  if (fp_buf == NULL) pe_fatal(obj->pe, "Buffer initialisation failed\n");
+  setvbuf(fp_buf, buf, _IOFBF, localsz);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(obj->cs, ic, jc, kc);
+	obj->write_data(fp_buf, index, data);
+      }
+    }
+  }
+
+  /* buf retains the data after the (notional) flush on close */
+  fclose(fp_buf);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_local_buf_read
+ *
+ *  Unpack buf (local sites in file order) to the object, either by
+ *  bulk unpack if available, or via the per-site callback reading
+ *  from a memory stream.
+ *
+ *****************************************************************************/
+
+static int io_local_buf_read(io_info_t * obj, void * data, char * buf) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  size_t localsz;
+  FILE * fp_buf = NULL;
+
+  assert(obj);
+  assert(data);
+  assert(buf);
+
+  if (obj->unpack && obj->read_data == obj->read_binary) {
+    obj->unpack(data, buf);
+    return 0;
+  }
+
+  cs_nlocal(obj->cs, nlocal);
+  localsz = (size_t) obj->bytesize*nlocal[X]*nlocal[Y]*nlocal[Z];
+
+  fp_buf = fmemopen(buf, localsz, "r");
+  if (fp_buf == NULL) pe_fatal(obj->pe, "Buffer initialisation failed\n");
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(obj->cs, ic, jc, kc);
+	obj->read_data(fp_buf, index, data);
+      }
+    }
+  }
+
+  if (ferror(fp_buf)) {
+    perror("perror: ");
+    pe_fatal(obj->pe, "Buffer error on read\n");
+  }
+  fclose(fp_buf);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  io_read_data
@@ -1015,6 +1573,12 @@ int io_read_data(io_info_t * obj, const char * filename_stub, void * data) {
   int       ic, jc, kc, index;
   int       nlocal[3];
   long int  offset;
+  int       ntotal[3];
+  size_t    nbytes;
+  size_t    localsz;
+  size_t    nread;
+  char *    buf = NULL;
+  double    t0, t1;
   const int io_tag = 141;
 
   MPI_Status status;
@@ -1024,6 +1588,27 @@ int io_read_data(io_info_t * obj, const char * filename_stub, void * data) {
   assert(filename_stub);
   assert(data);
 
+  if (obj->read_data == obj->read_binary && strlen(obj->metadata_stub) > 0) {
+    if (io_read_metadata_check(obj, obj->metadata_stub)) {
+      pe_fatal(obj->pe, "Metadata (%s) do not match %s (%d bytes per site)"
+	       " for %s\n", obj->metadata_stub, obj->name, (int) obj->bytesize,
+	       filename_stub);
+    }
+  }
+
+  if (obj->mpiio && obj->processor_independent) {
+    t0 = MPI_Wtime();
+    io_read_data_m(obj, filename_stub, data);
+    t1 = MPI_Wtime();
+    if (obj->report) {
+      cs_ntotal(obj->cs, ntotal);
+      nbytes = obj->bytesize*ntotal[X]*ntotal[Y]*ntotal[Z];
+      pe_info(obj->pe, "Read %lu bytes in %f secs %f GB/s\n",
+	      nbytes, t1-t0, nbytes/(1.0e+09*(t1-t0)));
+    }
+    return 0;
+  }
+
   cs_nlocal(obj->cs, nlocal);
 
   io_set_group_filename(filename_io, filename_stub, obj);
@@ -1045,16 +1630,42 @@ int io_read_data(io_info_t * obj, const char * filename_stub, void * data) {
   if (fp_state == NULL) pe_fatal(obj->pe, "Failed to open %s\n", filename_io);
   fseek(fp_state, token, SEEK_SET);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
+  if (obj->unpack && obj->read_data == obj->read_binary) {
 
-      /* Work out where the read comes from if required */
-      offset = io_file_offset(ic, jc, obj);
-      if (obj->processor_independent) fseek(fp_state, offset, SEEK_SET);
+    /* Bulk: read z-strips to a local buffer, and unpack once */
 
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	index = cs_index(obj->cs, ic, jc, kc);
-	obj->read_data(fp_state, index, data);
+    localsz = (size_t) obj->bytesize*nlocal[X]*nlocal[Y]*nlocal[Z];
+    buf = (char *) malloc(localsz*sizeof(char));
+    if (buf == NULL) pe_fatal(obj->pe, "malloc(buf)\n");
+
+    for (ic = 1; ic <= nlocal[X]; ic++) {
+      for (jc = 1; jc <= nlocal[Y]; jc++) {
+	offset = io_file_offset(ic, jc, obj);
+	if (obj->processor_independent) fseek(fp_state, offset, SEEK_SET);
+	index = nlocal[Z]*((ic - 1)*nlocal[Y] + (jc - 1));
+	nread = fread(buf + obj->bytesize*index, obj->bytesize, nlocal[Z],
+		      fp_state);
+	if (nread != (size_t) nlocal[Z]) {
+	  pe_fatal(obj->pe, "File error on reading %s\n", filename_io);
+	}
+      }
+    }
+
+    obj->unpack(data, buf);
+    free(buf);
+  }
+  else {
+    for (ic = 1; ic <= nlocal[X]; ic++) {
+      for (jc = 1; jc <= nlocal[Y]; jc++) {
+
+	/* Work out where the read comes from if required */
+	offset = io_file_offset(ic, jc, obj);
+	if (obj->processor_independent) fseek(fp_state, offset, SEEK_SET);
+
+	for (kc = 1; kc <= nlocal[Z]; kc++) {
+	  index = cs_index(obj->cs, ic, jc, kc);
+	  obj->read_data(fp_state, index, data);
+	}
       }
     }
   }
@@ -1112,3 +1723,172 @@ int io_info_metadata_filestub_set(io_info_t * info, const char * stub) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  io_info_mpiio_set
+ *
+ *  Use collective MPI-IO for decomposition-independent (binary) read
+ *  and write. A single file is used whatever the I/O grid.
+ *
+ *****************************************************************************/
+
+int io_info_mpiio_set(io_info_t * info, int mpiio) {
+
+  assert(info);
+
+  info->mpiio = mpiio;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_info_report_set
+ *
+ *  Report time taken and bandwidth for decomposition-independent I/O.
+ *
+ *****************************************************************************/
+
+int io_info_report_set(io_info_t * info, int report) {
+
+  assert(info);
+
+  info->report = report;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_info_async_set
+ *
+ *  Attach a background writer. Aggregated decomposition-independent
+ *  output is then staged and queued (io_write_data_a()) rather than
+ *  written directly; other output methods are unaffected. The caller is
+ *  responsible for io_async_flush() before the files are required.
+ *
+ *****************************************************************************/
+
+int io_info_async_set(io_info_t * info, io_async_t * async) {
+
+  assert(info);
+
+  info->async = async;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_info_pack_set
+ *
+ *  Optional bulk binary pack/unpack for the whole local lattice.
+ *  The buffer holds all local sites in file order (x, y, z with z
+ *  fastest) at obj->bytesize bytes per site, identical to the output
+ *  of the per-site binary callbacks. If present, these are used in
+ *  preference to the per-site callbacks for binary formats.
+ *
+ *****************************************************************************/
+
+int io_info_pack_set(io_info_t * info, io_pack_cb_ft pack,
+		     io_pack_cb_ft unpack) {
+  assert(info);
+
+  info->pack = pack;
+  info->unpack = unpack;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  io_pack_rank1
+ *
+ *  Helper for bulk pack callbacks. Copy a rank 1 field data[addr_rank1()]
+ *  of na elements of size sz per site to buf in file order, where each
+ *  site record is recsz bytes and the field starts at byte offset in
+ *  the record. For a record holding only the field, recsz = na*sz and
+ *  offset = 0.
+ *
+ *****************************************************************************/
+
+int io_pack_rank1(cs_t * cs, int nsites, int na, size_t sz, const void * data,
+		  size_t recsz, size_t offset, char * buf) {
+
+  return io_rank1_strips(cs, nsites, na, sz, (char *) data, recsz, offset,
+			 buf, 1);
+}
+
+/*****************************************************************************
+ *
+ *  io_unpack_rank1
+ *
+ *  The inverse of io_pack_rank1().
+ *
+ *****************************************************************************/
+
+int io_unpack_rank1(cs_t * cs, int nsites, int na, size_t sz, void * data,
+		    size_t recsz, size_t offset, const char * buf) {
+
+  return io_rank1_strips(cs, nsites, na, sz, (char *) data, recsz, offset,
+			 (char *) buf, 0);
+}
+
+/*****************************************************************************
+ *
+ *  io_rank1_strips
+ *
+ *  For each (x, y) the z-strip of each element is copied in turn.
+ *  The element copy has a fixed size for the common cases so that
+ *  the compiler may inline it.
+ *
+ *****************************************************************************/
+
+static int io_rank1_strips(cs_t * cs, int nsites, int na, size_t sz,
+			   char * data, size_t recsz, size_t offset,
+			   char * buf, int pack) {
+  int ic, jc, kc, ia;
+  int index0;
+  int nlocal[3];
+  int xs, ys, zs;
+  size_t ib = 0;
+
+  assert(cs);
+  assert(data);
+  assert(buf);
+  assert(recsz >= offset + na*sz);
+
+  cs_nlocal(cs, nlocal);
+  cs_strides(cs, &xs, &ys, &zs);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      index0 = cs_index(cs, ic, jc, 1);
+      for (ia = 0; ia < na; ia++) {
+	for (kc = 0; kc < nlocal[Z]; kc++) {
+	  char * pb = buf + ib + recsz*kc + offset + sz*ia;
+	  char * pd = data + sz*addr_rank1(nsites, na, index0 + zs*kc, ia);
+	  char * dst = (pack) ? pb : pd;
+	  char * src = (pack) ? pd : pb;
+	  switch (sz) {
+	  case 8:
+	    memcpy(dst, src, 8);
+	    break;
+	  case 4:
+	    memcpy(dst, src, 4);
+	    break;
+	  case 1:
+	    *dst = *src;
+	    break;
+	  default:
+	    memcpy(dst, src, sz);
+	  }
+	}
+      }
+      ib += recsz*nlocal[Z];
+    }
+  }
+
+  return 0;
+}
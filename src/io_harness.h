@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2007-2017 The University of Edinburgh
+ *  (c) 2007-2019 The University of Edinburgh
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
@@ -20,6 +20,7 @@
 
 #include "pe.h"
 #include "coords.h"
+#include "io_async.h"
 
 typedef enum io_format_enum {IO_FORMAT_NULL,
 			     IO_FORMAT_ASCII,
@@ -41,6 +42,9 @@ struct io_info_arg_s {
 /* Callback signature for lattice site I/O */
 typedef int (*io_rw_cb_ft)(FILE * fp, int index, void * self);
 
+/* Callback signature for bulk binary I/O of all local sites */
+typedef int (*io_pack_cb_ft)(void * self, char * buf);
+
 
 __host__ int io_info_create(pe_t * pe, cs_t * cs, io_info_arg_t * arg,
 			    io_info_t ** pinfo);
@@ -57,6 +61,18 @@ __host__ int io_info_set_bytesize(io_info_t * p, io_format_enum_t t, size_t);
 __host__ int io_write_metadata(io_info_t * info);
 __host__ int io_write_metadata_file(io_info_t * info, char * filestub);
 __host__ int io_info_metadata_filestub_set(io_info_t * info, const char * filestub);
+__host__ int io_read_metadata_check(io_info_t * info, const char * filestub);
+__host__ int io_info_mpiio_set(io_info_t * info, int mpiio);
+__host__ int io_info_report_set(io_info_t * info, int report);
+__host__ int io_info_async_set(io_info_t * info, io_async_t * async);
+__host__ int io_info_pack_set(io_info_t * info, io_pack_cb_ft pack,
+			      io_pack_cb_ft unpack);
+__host__ int io_pack_rank1(cs_t * cs, int nsites, int na, size_t sz,
+			   const void * data, size_t recsz, size_t offset,
+			   char * buf);
+__host__ int io_unpack_rank1(cs_t * cs, int nsites, int na, size_t sz,
+			     void * data, size_t recsz, size_t offset,
+			     const char * buf);
 
 __host__ int io_remove(const char * filename_stub, io_info_t * obj);
 __host__ int io_remove_metadata(io_info_t * obj, const char * file_stub);
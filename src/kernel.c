@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2016-2018 The University of Edinburgh
+ *  (c) 2016-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -22,6 +22,7 @@
 #include "pe.h"
 #include "coords_s.h"
 #include "kernel.h"
+#include "memory.h"
 
 /* Static kernel context information */
 
@@ -39,8 +40,16 @@ struct kernel_param_s {
   int kernel_vector_iterations;
   int nkv_local[3];
   kernel_info_t lim;
+  /* Tiled iteration (extents zero if not tiled) */
+  int ntile[3];
+  int ntilev[3];
 };
 
+/* Tile extents for subsequent contexts; zero is the full extent.
+ * All zero is the usual (untiled) iteration order. */
+
+static int tile_default[3] = {0, 0, 0};
+
 /* A static device context is provided to prevent repeated device
  * memory allocations/deallocations. */
 
@@ -50,6 +59,12 @@ static __constant__ kernel_param_t static_param;
 static __host__ int kernel_ctxt_commit(kernel_ctxt_t * ctxt, cs_t * cs,
 				       int nsimdvl,
 				       kernel_info_t lim);
+static __host__ int kernel_tile_extent(const int n[3], int ntile[3]);
+static __host__ __device__ void kernel_tile_coords(const int n[3],
+						   const int t[3],
+						   int kindex, int c[3]);
+static __global__ void kernel_tile_tune_kernel(kernel_ctxt_t * ktx, int nf,
+					       double * src, double * dst);
 
 /*****************************************************************************
  *
@@ -209,6 +224,24 @@ static __host__ int kernel_ctxt_commit(kernel_ctxt_t * obj, cs_t * cs,
   kiter = obj->param->nkv_local[X]*obj->param->nkv_local[Y]*obj->param->nkv_local[Z];
   obj->param->kernel_vector_iterations = kiter;
 
+  /* Tiles. In the vectorised case, a tile must be made up of whole
+   * SIMD blocks, so a partial extent in z must be a multiple of
+   * NSIMDVL (and so must the full extent, to keep alignment). */
+
+  kernel_tile_extent(obj->param->nklocal, obj->param->ntile);
+  kernel_tile_extent(obj->param->nkv_local, obj->param->ntilev);
+
+  if (obj->param->ntilev[X] > 0) {
+    if (obj->param->nkv_local[Z] % NSIMDVL) {
+      obj->param->ntilev[X] = 0;
+      obj->param->ntilev[Y] = 0;
+      obj->param->ntilev[Z] = 0;
+    }
+    else if (obj->param->ntilev[Z] % NSIMDVL) {
+      obj->param->ntilev[Z] = obj->param->nkv_local[Z];
+    }
+  }
+
   /* Copy the results to device memory */
 
   tdpGetDeviceCount(&ndevice);
@@ -231,9 +264,23 @@ static __host__ int kernel_ctxt_commit(kernel_ctxt_t * obj, cs_t * cs,
 
 __host__ __device__ int kernel_baseindex(kernel_ctxt_t * obj, int kindex) {
 
+  int c[3];
+  int nhalo;
+  int xs, ys;
+
   assert(obj);
 
-  return obj->param->kindex0 + kindex;
+  if (obj->param->ntilev[X] == 0) return obj->param->kindex0 + kindex;
+
+  /* Tiled: a SIMD block is contiguous in z within the tile */
+
+  kernel_tile_coords(obj->param->nkv_local, obj->param->ntilev, kindex, c);
+
+  nhalo = obj->param->nhalo;
+  ys = obj->param->nlocal[Z] + 2*nhalo;
+  xs = ys*(obj->param->nlocal[Y] + 2*nhalo);
+
+  return xs*(obj->param->lim.imin + nhalo - 1 + c[X]) + ys*c[Y] + c[Z];
 }
 
 /*****************************************************************************
@@ -248,6 +295,12 @@ __host__ __device__ int kernel_coords_ic(kernel_ctxt_t * obj, int kindex) {
 
   assert(obj);
 
+  if (obj->param->ntile[X] > 0) {
+    int c[3];
+    kernel_tile_coords(obj->param->nklocal, obj->param->ntile, kindex, c);
+    return obj->param->lim.imin + c[X];
+  }
+
   ic = obj->param->lim.imin
     + kindex/(obj->param->nklocal[Y]*obj->param->nklocal[Z]);
 
@@ -271,6 +324,12 @@ __host__ __device__ int kernel_coords_jc(kernel_ctxt_t * obj, int kindex) {
 
   assert(obj);
 
+  if (obj->param->ntile[X] > 0) {
+    int c[3];
+    kernel_tile_coords(obj->param->nklocal, obj->param->ntile, kindex, c);
+    return obj->param->lim.jmin + c[Y];
+  }
+
   xs = obj->param->nklocal[Y]*obj->param->nklocal[Z];
 
   ic = kindex/xs;
@@ -295,6 +354,14 @@ __host__ __device__ int kernel_coords_kc(kernel_ctxt_t * obj, int kindex) {
   int kc;
   int xs;
 
+  assert(obj);
+
+  if (obj->param->ntile[X] > 0) {
+    int c[3];
+    kernel_tile_coords(obj->param->nklocal, obj->param->ntile, kindex, c);
+    return obj->param->lim.kmin + c[Z];
+  }
+
   xs = obj->param->nklocal[Y]*obj->param->nklocal[Z];
 
   ic = kindex/xs;
@@ -325,6 +392,19 @@ __host__ __device__ int kernel_coords_v(kernel_ctxt_t * obj,
   int * __restrict__ kcv = kc;
 
   assert(obj);
+
+  if (obj->param->ntilev[X] > 0) {
+    /* Tiled: the block is contiguous in z */
+    int c[3];
+    kernel_tile_coords(obj->param->nkv_local, obj->param->ntilev, kindex0, c);
+    for_simd_v(iv, NSIMDVL) {
+      icv[iv] = obj->param->lim.imin + c[X];
+      jcv[iv] = 1 - obj->param->nhalo + c[Y];
+      kcv[iv] = 1 - obj->param->nhalo + c[Z] + iv;
+    }
+    return 0;
+  }
+
   xs = obj->param->nkv_local[Y]*obj->param->nkv_local[Z];
 
   for_simd_v(iv, NSIMDVL) {
@@ -497,3 +577,268 @@ __host__ int kernel_ctxt_info(kernel_ctxt_t * obj, kernel_info_t * lim) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  kernel_tile_set
+ *
+ *  Set the tile extents (x, y, z) for subsequently created contexts.
+ *  Tiles are visited x-tile slowest, and sites in each tile in the
+ *  usual order, so with static scheduling each thread works through
+ *  a contiguous run of tiles. A zero extent is the full extent of
+ *  the kernel in that direction; all zero is untiled.
+ *
+ *****************************************************************************/
+
+__host__ int kernel_tile_set(const int tile[3]) {
+
+  assert(tile);
+  assert(tile[X] >= 0 && tile[Y] >= 0 && tile[Z] >= 0);
+
+  tile_default[X] = tile[X];
+  tile_default[Y] = tile[Y];
+  tile_default[Z] = tile[Z];
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  kernel_tile
+ *
+ *****************************************************************************/
+
+__host__ int kernel_tile(int tile[3]) {
+
+  assert(tile);
+
+  tile[X] = tile_default[X];
+  tile[Y] = tile_default[Y];
+  tile[Z] = tile_default[Z];
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  kernel_tile_extent
+ *
+ *  Tile extents for a kernel of extent n[3] from the current setting.
+ *  The result is all zero if not tiled.
+ *
+ *****************************************************************************/
+
+static __host__ int kernel_tile_extent(const int n[3], int ntile[3]) {
+
+  int ia;
+
+  assert(n);
+  assert(ntile);
+
+  for (ia = 0; ia < 3; ia++) {
+    ntile[ia] = tile_default[ia];
+    if (ntile[ia] == 0 || ntile[ia] > n[ia]) ntile[ia] = n[ia];
+  }
+
+  if (tile_default[X] == 0 && tile_default[Y] == 0 && tile_default[Z] == 0) {
+    ntile[X] = 0;
+    ntile[Y] = 0;
+    ntile[Z] = 0;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  kernel_tile_coords
+ *
+ *  Offsets c[3] in a kernel of extent n[3], tiles of extent t[3],
+ *  of kernel index kindex. Tiles at the upper end in each direction
+ *  may be partial.
+ *
+ *****************************************************************************/
+
+static __host__ __device__ void kernel_tile_coords(const int n[3],
+						   const int t[3],
+						   int kindex, int c[3]) {
+  int ib, jb, kb;
+  int ex, ey, ez;
+  int r, ic, jc;
+
+  ib = kindex/(t[X]*n[Y]*n[Z]);
+  r  = kindex - ib*t[X]*n[Y]*n[Z];
+  ex = n[X] - ib*t[X];
+  if (ex > t[X]) ex = t[X];
+
+  jb = r/(ex*t[Y]*n[Z]);
+  r -= jb*ex*t[Y]*n[Z];
+  ey = n[Y] - jb*t[Y];
+  if (ey > t[Y]) ey = t[Y];
+
+  kb = r/(ex*ey*t[Z]);
+  r -= kb*ex*ey*t[Z];
+  ez = n[Z] - kb*t[Z];
+  if (ez > t[Z]) ez = t[Z];
+
+  ic = r/(ey*ez);
+  jc = (r - ic*ey*ez)/ez;
+
+  c[X] = ib*t[X] + ic;
+  c[Y] = jb*t[Y] + jc;
+  c[Z] = kb*t[Z] + r - ic*ey*ez - jc*ez;
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  kernel_tile_tune
+ *
+ *  Time a seven-point stencil on nf components for a number of
+ *  candidate tiles (full extent in x and z, and decreasing extent
+ *  in y), and return the fastest in tile[3]. The slowest rank
+ *  determines the time, so all ranks agree. The current setting
+ *  is not changed.
+ *
+ *****************************************************************************/
+
+__host__ int kernel_tile_tune(cs_t * cs, int nf, int tile[3]) {
+
+  const int nrep = 3;
+  const int ncandidate = 6;
+  const int candidate[6] = {0, 64, 32, 16, 8, 4};
+
+  int n, nrun;
+  int nsites;
+  int nlocal[3];
+  int tile0[3];
+  int ndevice;
+  double t0 = 0.0, t1, tbest;
+  double * src = NULL;
+  double * dst = NULL;
+  MPI_Comm comm;
+  kernel_info_t lim;
+  kernel_ctxt_t * ctxt = NULL;
+  dim3 nblk, ntpb;
+
+  assert(cs);
+  assert(nf > 0);
+  assert(tile);
+
+  cs_nsites(cs, &nsites);
+  cs_nlocal(cs, nlocal);
+  cs_cart_comm(cs, &comm);
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice == 0) {
+    src = (double *) calloc((size_t) nf*nsites, sizeof(double));
+    dst = (double *) calloc((size_t) nf*nsites, sizeof(double));
+    if (src == NULL) pe_fatal(cs->pe, "calloc(src) failed\n");
+    if (dst == NULL) pe_fatal(cs->pe, "calloc(dst) failed\n");
+  }
+  else {
+    tdpAssert(tdpMalloc((void **) &src, (size_t) nf*nsites*sizeof(double)));
+    tdpAssert(tdpMalloc((void **) &dst, (size_t) nf*nsites*sizeof(double)));
+    tdpAssert(tdpMemset(src, 0, (size_t) nf*nsites*sizeof(double)));
+  }
+
+  lim.imin = 1; lim.imax = nlocal[X];
+  lim.jmin = 1; lim.jmax = nlocal[Y];
+  lim.kmin = 1; lim.kmax = nlocal[Z];
+
+  kernel_tile(tile0);
+  tbest = -1.0;
+  tile[X] = 0; tile[Y] = 0; tile[Z] = 0;
+
+  for (n = 0; n < ncandidate; n++) {
+
+    int ttry[3] = {0, 0, 0};
+
+    if (candidate[n] >= nlocal[Y]) continue;
+    ttry[Y] = candidate[n];
+    kernel_tile_set(ttry);
+
+    kernel_ctxt_create(cs, 1, lim, &ctxt);
+    kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+    for (nrun = 0; nrun <= nrep; nrun++) {
+      /* First run is not timed */
+      if (nrun == 1) t0 = MPI_Wtime();
+      tdpLaunchKernel(kernel_tile_tune_kernel, nblk, ntpb, 0, 0,
+		      ctxt->target, nf, src, dst);
+      tdpAssert(tdpPeekAtLastError());
+      tdpAssert(tdpDeviceSynchronize());
+    }
+    t1 = MPI_Wtime() - t0;
+    kernel_ctxt_free(ctxt);
+
+    MPI_Allreduce(MPI_IN_PLACE, &t1, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+    if (tbest < 0.0 || t1 < tbest) {
+      tbest = t1;
+      tile[X] = ttry[X]; tile[Y] = ttry[Y]; tile[Z] = ttry[Z];
+    }
+  }
+
+  kernel_tile_set(tile0);
+
+  if (ndevice == 0) {
+    free(dst);
+    free(src);
+  }
+  else {
+    tdpAssert(tdpFree(dst));
+    tdpAssert(tdpFree(src));
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  kernel_tile_tune_kernel
+ *
+ *  Seven-point Laplacian of each of nf components of src.
+ *
+ *****************************************************************************/
+
+static __global__ void kernel_tile_tune_kernel(kernel_ctxt_t * ktx, int nf,
+					       double * src, double * dst) {
+  int kindex;
+  int kiter;
+
+  assert(ktx);
+  assert(src);
+  assert(dst);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic, jc, kc, n;
+    int index, nsites, xs, ys;
+
+    ic = kernel_coords_ic(ktx, kindex);
+    jc = kernel_coords_jc(ktx, kindex);
+    kc = kernel_coords_kc(ktx, kindex);
+    index = kernel_coords_index(ktx, ic, jc, kc);
+
+    nsites = ktx->param->nsites;
+    ys = ktx->param->nlocal[Z] + 2*ktx->param->nhalo;
+    xs = ys*(ktx->param->nlocal[Y] + 2*ktx->param->nhalo);
+
+    for (n = 0; n < nf; n++) {
+      dst[addr_rank1(nsites, nf, index, n)] =
+	src[addr_rank1(nsites, nf, index + xs, n)]
+	+ src[addr_rank1(nsites, nf, index - xs, n)]
+	+ src[addr_rank1(nsites, nf, index + ys, n)]
+	+ src[addr_rank1(nsites, nf, index - ys, n)]
+	+ src[addr_rank1(nsites, nf, index + 1, n)]
+	+ src[addr_rank1(nsites, nf, index - 1, n)]
+	- 6.0*src[addr_rank1(nsites, nf, index, n)];
+    }
+  }
+
+  return;
+}
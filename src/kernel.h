@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2016-2017 The University of Edinburgh
+ *  (c) 2016-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -78,5 +78,11 @@ __host__ __device__ int kernel_coords_index_v(kernel_ctxt_t * ctxt,
 
 __host__ int kernel_launch_param(int iterations, dim3 * nblk, dim3 * ntpb);
 
+/* Tiled (cache-blocked) iteration order for subsequent contexts */
+
+__host__ int kernel_tile_set(const int tile[3]);
+__host__ int kernel_tile(int tile[3]);
+__host__ int kernel_tile_tune(cs_t * cs, int nf, int tile[3]);
+
 #endif
 
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ *
+ *  kernel_rt.c
+ *
+ *  Run time options for kernel execution.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "kernel_rt.h"
+
+/*****************************************************************************
+ *
+ *  kernel_init_rt
+ *
+ *  The lattice kernels may be run in a tiled (cache-blocked) order:
+ *
+ *    kernel_tile_size  x_y_z   tile extents (0 for the full extent)
+ *    kernel_tile_size  auto    the fastest of a small number of
+ *                              candidates timed at start up
+ *
+ *  nf is the number of components of the largest field, which is
+ *  used to size the test at start up.
+ *
+ *****************************************************************************/
+
+__host__ int kernel_init_rt(pe_t * pe, rt_t * rt, cs_t * cs, int nf) {
+
+  int tile[3] = {0, 0, 0};
+  char value[BUFSIZ];
+
+  assert(pe);
+  assert(rt);
+  assert(cs);
+
+  if (rt_string_parameter(rt, "kernel_tile_size", value, BUFSIZ) == 0) {
+    return 0;
+  }
+
+  if (strcmp(value, "auto") == 0) {
+    if (nf < 1) nf = 1;
+    kernel_tile_tune(cs, nf, tile);
+  }
+  else {
+    rt_int_parameter_vector(rt, "kernel_tile_size", tile);
+    if (tile[X] < 0 || tile[Y] < 0 || tile[Z] < 0) {
+      pe_fatal(pe, "kernel_tile_size must not be negative\n");
+    }
+  }
+
+  kernel_tile_set(tile);
+
+  pe_info(pe, "\n");
+  pe_info(pe, "Kernel tiles (0 is full extent): %d %d %d %s\n",
+	  tile[X], tile[Y], tile[Z], (strcmp(value, "auto") == 0) ? "(auto)" : "");
+
+  return 0;
+}
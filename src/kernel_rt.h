@@ -0,0 +1,24 @@
+/*****************************************************************************
+ *
+ *  kernel_rt.h
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_KERNEL_RT_H
+#define LUDWIG_KERNEL_RT_H
+
+#include "pe.h"
+#include "runtime.h"
+#include "coords.h"
+
+__host__ int kernel_init_rt(pe_t * pe, rt_t * rt, cs_t * cs, int nf);
+
+#endif
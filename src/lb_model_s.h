@@ -17,17 +17,44 @@
 #ifndef LB_MODEL_S_H
 #define LB_MODEL_S_H
 
+#include <float.h>
+
 #include "model.h"
 #include "halo_swap.h"
 #include "io_harness.h"
 #include "stdint.h"
 
+/* Storage precision for the distributions. Arithmetic (collision,
+ * moments) is always in double. With -DLB_DATA_FLOAT, the stored
+ * value of the density distribution is shifted by the rest weight,
+ * i.e., f_p - w_p, to retain significant digits near rho = 1.
+ * The shift is itself rounded to float so that, e.g., zero is
+ * represented exactly. LB_DATA_EPSILON is the machine epsilon of
+ * the storage type, e.g., for tolerances in tests. */
+
+#ifdef LB_DATA_FLOAT
+typedef float lb_data_t;
+#define MPI_LB_DATA MPI_FLOAT
+#define LB_DATA_EPSILON FLT_EPSILON
+#define LB_FSHIFT(param, n, p) ((n) == LB_RHO ? (float) (param)->wv[p] : 0.0)
+#else
+typedef double lb_data_t;
+#define MPI_LB_DATA MPI_DOUBLE
+#define LB_DATA_EPSILON DBL_EPSILON
+#define LB_FSHIFT(param, n, p) 0.0
+#endif
+
 typedef struct lb_collide_param_s lb_collide_param_t;
 
 struct lb_collide_param_s {
   int8_t isghost;                      /* switch for ghost modes */
+  int8_t isfused;                      /* fused collision-propagation */
+  int8_t isaa;                         /* AA-pattern in-place propagation */
+  int8_t parity;                       /* AA: 0 natural, 1 swapped storage */
+  int8_t isoverlap;                    /* collision overlaps halo swap */
   int8_t cv[NVEL][3];
   int nsite;
+  int ndisp[NVEL];                     /* memory displacement of cv[p] */
   int ndist;
   double rho0;
   double var_shear;
@@ -53,10 +80,18 @@ struct lb_data_s {
   io_info_t * io_info;   /* Distributions */ 
   io_info_t * io_rho;    /* Fluid density (here; could be hydrodynamics...) */
 
-  double * f;            /* Distributions */
-  double * fprime;       /* used in propagation only */
+  lb_data_t * f;         /* Distributions */
+  lb_data_t * fprime;    /* used in propagation only (NULL for AA) */
+
+  int nreverse;          /* Size of each lb_halo_reverse() buffer */
+  lb_data_t * reverse;   /* lb_halo_reverse() buffers [4*nreverse] */
+  lb_data_t * natural;   /* lb_aa_natural() buffers [2*nsite] */
+
+  int nsparse;           /* Number of active site vectors (0 for dense) */
+  int * sparse;          /* Kernel vector indices of active site vectors */
 
   lb_collide_param_t * param;
+  site_sync_t * sync;    /* Sites changed on host since last lb_sync() */
 
   /* MPI data types for halo swaps; these are comupted at runtime
    * to conform to the model selected at compile time */
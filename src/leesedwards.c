@@ -170,6 +170,8 @@ __host__ int lees_edw_free(lees_edw_t * le) {
 
     if (le->target != le) tdpFree(le->target);
 
+    MPI_Comm_free(&le->le_plane_comm);
+    MPI_Comm_free(&le->le_comm);
     pe_free(le->pe);
     cs_free(le->cs);
     free(le->icbuff_to_real);
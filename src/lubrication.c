@@ -8,7 +8,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2014-2018 The University of Edinburgh
+ *  (c) 2014-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -24,6 +24,8 @@
 #include "coords.h"
 #include "physics.h"
 #include "colloids.h"
+#include "colloids_nlist.h"
+#include "colloids_soa.h"
 #include "lubrication.h"
 
 struct lubrication_s {
@@ -35,6 +37,14 @@ struct lubrication_s {
   double rchmax;
 };
 
+static int lubrication_pair(lubr_t * obj, colloids_info_t * cinfo,
+			    colloids_soa_t * soa, int i, int j, int step,
+			    double * hr, double f[3]);
+static int lubrication_force(lubr_t * lubr, double a1, double a2,
+			     const double u1[3], const double u2[3],
+			     const double r12[3], const double ran[2],
+			     double * phr, double f[3]);
+
 /*****************************************************************************
  *
  *  lubrication_create
@@ -80,6 +90,12 @@ int lubrication_free(lubr_t * obj) {
  *  lubrication_compute
  *
  *  Call back function for computing sphere-sphere corrections.
+ *  Pairs are taken from the neighbour list, if present, otherwise
+ *  from the cell list.
+ *
+ *  The random numbers for each pair depend only on the pair and the
+ *  time step, so pairs from the neighbour list may be computed
+ *  independently (and are added to the store in list order).
  *
  *****************************************************************************/
 
@@ -87,25 +103,59 @@ int lubrication_compute(colloids_info_t * cinfo, void * self) {
 
   lubr_t * obj = (lubr_t *) self;
 
+  int n, i, j;
+  int c1, c2;
   int ic1, jc1, kc1, ic2, jc2, kc2;
   int di[2], dj[2], dk[2];
   int ncell[3];
+  int step;
 
-  double ran[2];  /* Random numbers for fluctuation dissipation correction */
-  double r12[3];
-  double f[3];
   double ltot[3];
+  double hr, f[3];
 
-  colloid_t * pc1;
-  colloid_t * pc2;
+  colloids_nlist_t * nlist = NULL;
+  colloids_soa_t * soa = NULL;
+  physics_t * phys = NULL;
 
   assert(cinfo);
   assert(obj);
 
   cs_ltot(obj->cs, ltot);
+  physics_ref(&phys);
+  step = physics_control_timestep(phys);
 
   obj->hminlocal = ltot[X];
   colloids_info_ncell(cinfo, ncell);
+  colloids_info_nlist(cinfo, &nlist);
+  colloids_info_soa(cinfo, &soa);
+
+  if (nlist) {
+    double hmin = obj->hminlocal;
+    double vdummy = 0.0;
+
+    assert(soa->nbuild == nlist->soabuild);
+    colloids_soa_gather(soa);
+
+    /* Work space holds the force on i2, i.e., minus that on i1 */
+
+    tdp_host_omp(parallel for private(hr, f) reduction(min: hmin))
+    for (n = 0; n < nlist->npair; n++) {
+      lubrication_pair(obj, cinfo, soa, nlist->i1[n], nlist->i2[n], step,
+		       &hr, f);
+      nlist->fpair[X][n] = -f[X];
+      nlist->fpair[Y][n] = -f[Y];
+      nlist->fpair[Z][n] = -f[Z];
+      nlist->vpair[n] = 0.0;
+      hmin = dmin(hmin, hr);
+    }
+
+    obj->hminlocal = hmin;
+    colloids_nlist_pair_sum(nlist, soa, &vdummy);
+    colloids_soa_scatter(soa);
+    return 0;
+  }
+
+  colloids_soa_build(soa, cinfo);
 
   for (ic1 = 1; ic1 <= ncell[X]; ic1++) {
     colloids_info_climits(cinfo, X, ic1, di); 
@@ -114,32 +164,20 @@ int lubrication_compute(colloids_info_t * cinfo, void * self) {
       for (kc1 = 1; kc1 <= ncell[Z]; kc1++) {
         colloids_info_climits(cinfo, Z, kc1, dk);
 
-        colloids_info_cell_list_head(cinfo, ic1, jc1, kc1, &pc1);
-        for (; pc1; pc1 = pc1->next) {
+        c1 = colloids_info_cell_index(cinfo, ic1, jc1, kc1);
+        for (i = soa->cstart[c1]; i < soa->cstart[c1 + 1]; i++) {
 
           for (ic2 = di[0]; ic2 <= di[1]; ic2++) {
             for (jc2 = dj[0]; jc2 <= dj[1]; jc2++) {
               for (kc2 = dk[0]; kc2 <= dk[1]; kc2++) {
    
-                colloids_info_cell_list_head(cinfo, ic2, jc2, kc2, &pc2);
-                for (; pc2; pc2 = pc2->next) {
-
-                  if (pc1->s.index >= pc2->s.index) continue;
-
-                  cs_minimum_distance(obj->cs, pc1->s.r, pc2->s.r, r12);
-		  util_ranlcg_reap_gaussian(&pc1->s.rng, ran);
-
-		  lubrication_single(obj, pc1->s.ah, pc2->s.ah, pc1->s.v,
-				     pc2->s.v, r12, ran, f);
-
-		  pc1->force[X] += f[X];
-		  pc1->force[Y] += f[Y];
-		  pc1->force[Z] += f[Z];
-
-		  pc2->force[X] -= f[X];
-		  pc2->force[Y] -= f[Y];
-		  pc2->force[Z] -= f[Z];
+                c2 = colloids_info_cell_index(cinfo, ic2, jc2, kc2);
+                for (j = soa->cstart[c2]; j < soa->cstart[c2 + 1]; j++) {
 
+                  if (soa->index[i] >= soa->index[j]) continue;
+		  lubrication_pair(obj, cinfo, soa, i, j, step, &hr, f);
+		  obj->hminlocal = dmin(obj->hminlocal, hr);
+		  colloids_soa_pair_add(soa, j, i, f);
 		}
 	      }
 	    }
@@ -149,6 +187,57 @@ int lubrication_compute(colloids_info_t * cinfo, void * self) {
     }
   }
 
+  colloids_soa_scatter(soa);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lubrication_pair
+ *
+ *  Compute the correction f for slot i of the pair (i, j); that for
+ *  j is -f. The reduced separation is hr.
+ *
+ *  The random numbers for the fluctuation-dissipation part are keyed
+ *  on the ordered pair of colloid indices and the time step, so all
+ *  copies of the pair (on any process) see the same values.
+ *
+ *****************************************************************************/
+
+static int lubrication_pair(lubr_t * obj, colloids_info_t * cinfo,
+			    colloids_soa_t * soa, int i, int j, int step,
+			    double * hr, double f[3]) {
+
+  double ran[2] = {0.0, 0.0};
+  double r1[3] = {soa->r[X][i], soa->r[Y][i], soa->r[Z][i]};
+  double r2[3] = {soa->r[X][j], soa->r[Y][j], soa->r[Z][j]};
+  double v1[3] = {soa->v[X][i], soa->v[Y][i], soa->v[Z][i]};
+  double v2[3] = {soa->v[X][j], soa->v[Y][j], soa->v[Z][j]};
+  double r12[3];
+  double kt;
+  physics_t * phys = NULL;
+
+  assert(obj);
+  assert(soa);
+
+  physics_ref(&phys);
+  physics_kt(phys, &kt);
+
+  cs_minimum_distance(obj->cs, r1, r2, r12);
+
+  if (kt > 0.0) {
+    double g[4];
+    int i1 = imin(soa->index[i], soa->index[j]);
+    int i2 = imax(soa->index[i], soa->index[j]);
+    colloids_info_rng_gaussian(cinfo, COLLOID_RNG_LUBRICATION, i1, i2, step,
+			       g);
+    ran[0] = g[0];
+    ran[1] = g[1];
+  }
+
+  lubrication_force(obj, soa->ah[i], soa->ah[j], v1, v2, r12, ran, hr, f);
+
   return 0;
 }
 
@@ -241,6 +330,30 @@ int lubrication_rchmax(lubr_t * obj, double * rchmax) {
 int lubrication_single(lubr_t * lubr, double a1, double a2,
 		       const double u1[3], const double u2[3],
 		       const double r12[3], const double ran[2], double f[3]) {
+  double hr;
+
+  assert(lubr);
+
+  lubrication_force(lubr, a1, a2, u1, u2, r12, ran, &hr, f);
+  if (hr < lubr->hminlocal) lubr->hminlocal = hr;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lubrication_force
+ *
+ *  As lubrication_single(), but the reduced separation is returned
+ *  (phr) rather than recorded, so that pairs may be computed
+ *  independently.
+ *
+ *****************************************************************************/
+
+static int lubrication_force(lubr_t * lubr, double a1, double a2,
+			     const double u1[3], const double u2[3],
+			     const double r12[3], const double ran[2],
+			     double * phr, double f[3]) {
   int ia;
   double h;        /* Separation */
   double hr;       /* Reduced separation */
@@ -262,7 +375,7 @@ int lubrication_single(lubr_t * lubr, double a1, double a2,
 
   h = modulus(r12);
   hr = h - a1 - a2;
-  if (hr < lubr->hminlocal) lubr->hminlocal = hr;
+  *phr = hr;
 
   if (hr < lubr->rch[LUBRICATION_SS_FNORM]) {
 
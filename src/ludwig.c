@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2011-2018 The University of Edinburgh
+ *  (c) 2011-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -26,8 +26,10 @@
 #include "ran.h"
 #include "noise.h"
 #include "timer.h"
+#include "perf.h"
 #include "coords_rt.h"
 #include "coords.h"
+#include "kernel_rt.h"
 #include "leesedwards_rt.h"
 #include "control.h"
 #include "util.h"
@@ -87,6 +89,7 @@
 #include "psi.h"
 #include "psi_rt.h"
 #include "psi_sor.h"
+#include "psi_mg.h"
 #include "psi_stats.h"
 #include "psi_force.h"
 #include "psi_colloid.h"
@@ -149,6 +152,10 @@ struct ludwig_s {
   interact_t * interact;       /* Colloid-colloid interaction handler */
   bbl_t * bbl;                 /* Bounce-back on links boundary condition */
 
+  io_async_t * io_async;       /* Background writer for lattice output */
+  int perf_freq;                /* Performance region output frequency */
+  perf_format_enum_t perf_format;
+
   stats_sigma_t * stat_sigma;  /* Interfacial tension calibration */
   stats_ahydro_t * stat_ah;    /* Hydrodynamic radius calibration */
   stats_rheo_t * stat_rheo;    /* Rheology diagnostics */
@@ -192,6 +199,7 @@ static int ludwig_rt(ludwig_t * ludwig) {
   
   TIMER_init(ludwig->pe);
   TIMER_start(TIMER_TOTAL);
+  perf_init(ludwig->pe);
 
   /* Prefer maximum L1 cache available on device */
   tdpDeviceSetCacheConfig(tdpFuncCachePreferL1);
@@ -218,6 +226,15 @@ static int ludwig_rt(ludwig_t * ludwig) {
 
   lb_run_time(pe, cs, rt, ludwig->lb);
   collision_run_time(pe, rt, ludwig->lb, ludwig->noise_rho);
+
+  lb_collision_fused(ludwig->lb, &n);
+  if (n && ludwig->le && lees_edw_nplane_total(ludwig->le) > 0) {
+    pe_fatal(pe, "lb_fused_propagation is not available with Lees-Edwards\n");
+  }
+  lb_aa(ludwig->lb, &n);
+  if (n && ludwig->le && lees_edw_nplane_total(ludwig->le) > 0) {
+    pe_fatal(pe, "lb_aa_propagation is not available with Lees-Edwards\n");
+  }
   map_init_rt(pe, cs, rt, &ludwig->map);
 
   noise_init(ludwig->noise_rho, 0);
@@ -225,6 +242,12 @@ static int ludwig_rt(ludwig_t * ludwig) {
   ran_init_rt(pe, rt);
   hydro_rt(pe, rt, cs, ludwig->le, &ludwig->hydro);
 
+  /* Kernel iteration order (the largest field sizes any test) */
+
+  n = NHDIM;
+  if (ludwig->q) field_nf(ludwig->q, &n);
+  kernel_init_rt(pe, rt, cs, n);
+
   /* PHI I/O */
 
   rt_int_parameter_vector(rt, "default_io_grid", io_grid_default);
@@ -281,6 +304,23 @@ static int ludwig_rt(ludwig_t * ludwig) {
   bbl_create(pe, ludwig->cs, ludwig->lb, &ludwig->bbl);
   bbl_active_set(ludwig->bbl, ludwig->collinfo);
 
+  /* Sparse sweep (skip solid chunks) requires the map to be fixed for
+   * the whole run */
+
+  strcpy(value, "");
+  rt_string_parameter(rt, "lb_sparse_sweep", value, BUFSIZ);
+  if (strcmp(value, "on") == 0) {
+    lb_ndist(ludwig->lb, &n);
+    if (n != 1) pe_fatal(pe, "lb_sparse_sweep requires a single distribution\n");
+    colloids_info_ntotal(ludwig->collinfo, &n);
+    if (n > 0) pe_fatal(pe, "lb_sparse_sweep is not available with colloids\n");
+    lb_sparse_set(ludwig->lb, ludwig->map);
+    lb_sparse(ludwig->lb, &n);
+    pe_info(pe, "\n");
+    pe_info(pe, "Sparse LB sweep:  on (%d active site vectors on root)\n", n);
+    pe_info(pe, "Solid chunks are skipped; distribution storage is dense\n");
+  }
+
   /* NOW INITIAL CONDITIONS */
 
   pe_subdirectory(pe, subdirectory);
@@ -393,6 +433,59 @@ static int ludwig_rt(ludwig_t * ludwig) {
     psi_electroneutral(ludwig->psi, ludwig->map);
   }
 
+  /* Asynchronous lattice output: queue depth (default 0 is off) */
+
+  n = 0;
+  rt_int_parameter(rt, "io_async_queue_depth", &n);
+
+  if (n > 0) {
+    io_async_create(pe, n, &ludwig->io_async);
+
+    lb_io_info(ludwig->lb, &iohandler);
+    io_info_async_set(iohandler, ludwig->io_async);
+    lb_io_rho(ludwig->lb, &iohandler);
+    io_info_async_set(iohandler, ludwig->io_async);
+    if (ludwig->phi) {
+      field_io_info(ludwig->phi, &iohandler);
+      io_info_async_set(iohandler, ludwig->io_async);
+    }
+    if (ludwig->q) {
+      field_io_info(ludwig->q, &iohandler);
+      io_info_async_set(iohandler, ludwig->io_async);
+    }
+    if (ludwig->hydro) {
+      hydro_io_info(ludwig->hydro, &iohandler);
+      io_info_async_set(iohandler, ludwig->io_async);
+    }
+    if (ludwig->psi) {
+      psi_io_info(ludwig->psi, &iohandler);
+      io_info_async_set(iohandler, ludwig->io_async);
+    }
+    pe_info(pe, "\n");
+    pe_info(pe, "Asynchronous lattice output: on (queue depth %d)\n", n);
+  }
+
+  /* Performance region statistics: output frequency (default 0 is
+   * off) and format ("csv" or "json") */
+
+  ludwig->perf_freq = 0;
+  ludwig->perf_format = PERF_FORMAT_CSV;
+  rt_int_parameter(rt, "perf_dump_freq", &ludwig->perf_freq);
+
+  if (ludwig->perf_freq > 0) {
+    n = rt_string_parameter(rt, "perf_dump_format", value, BUFSIZ);
+    if (n == 1 && strcmp(value, "json") == 0) {
+      ludwig->perf_format = PERF_FORMAT_JSON;
+    }
+    else if (n == 1 && strcmp(value, "csv") != 0) {
+      pe_fatal(pe, "perf_dump_format must be csv or json\n");
+    }
+    pe_info(pe, "\n");
+    pe_info(pe, "Performance region output every %d steps (%s)\n",
+	    ludwig->perf_freq,
+	    (ludwig->perf_format == PERF_FORMAT_JSON) ? "json" : "csv");
+  }
+
   return 0;
 }
 
@@ -411,6 +504,11 @@ void ludwig_run(const char * inputfile) {
   int     step = 0;
   int     is_subgrid = 0;
   int     is_pm = 0;
+  int     is_fused = 0;
+  int     is_aa = 0;
+  int     is_push = 0;
+  int     is_overlap = 0;
+  int     aa_parity = 0;
   int     ncolloid = 0;
   double  fzero[3] = {0.0, 0.0, 0.0};
   double  uzero[3] = {0.0, 0.0, 0.0};
@@ -441,6 +539,10 @@ void ludwig_run(const char * inputfile) {
   pe_info(ludwig->pe, "Initial conditions.\n");
   wall_is_pm(ludwig->wall, &is_porous_media);
 
+  /* Distribution statistics are computed on the target */
+
+  map_memcpy(ludwig->map, tdpMemcpyHostToDevice);
+  lb_memcpy(ludwig->lb, tdpMemcpyHostToDevice);
   stats_distribution_print(ludwig->lb, ludwig->map);
 
   lb_ndist(ludwig->lb, &im);
@@ -461,7 +563,6 @@ void ludwig_run(const char * inputfile) {
 
   /* Move initilaised data to target for time stepping loop */
 
-  lb_memcpy(ludwig->lb, tdpMemcpyHostToDevice);
   if (ludwig->phi) field_memcpy(ludwig->phi, tdpMemcpyHostToDevice);
   if (ludwig->p)   field_memcpy(ludwig->p, tdpMemcpyHostToDevice);
   if (ludwig->q)   field_memcpy(ludwig->q, tdpMemcpyHostToDevice);
@@ -472,6 +573,10 @@ void ludwig_run(const char * inputfile) {
   pe_info(ludwig->pe, "\n");
   pe_info(ludwig->pe, "Starting time step loop.\n");
   subgrid_on(&is_subgrid);
+  lb_collision_fused(ludwig->lb, &is_fused);
+  lb_aa(ludwig->lb, &is_aa);
+  lb_collision_overlap(ludwig->lb, &is_overlap);
+  if (ludwig->le && lees_edw_nplane_total(ludwig->le) > 0) is_overlap = 0;
 
   /* sync tasks before main loop for timing purposes */
   MPI_Barrier(comm);
@@ -479,6 +584,7 @@ void ludwig_run(const char * inputfile) {
   while (physics_control_next_step(ludwig->phys)) {
 
     TIMER_start(TIMER_STEPS);
+    perf_region_start("step");
 
     step = physics_control_timestep(ludwig->phys);
 
@@ -545,7 +651,13 @@ void ludwig_run(const char * inputfile) {
 #ifdef PETSC
 	psi_petsc_solve(ludwig->psi, ludwig->fe, ludwig->epsilon);
 #else
-	psi_sor_solve(ludwig->psi, ludwig->fe, ludwig->epsilon);
+	psi_solver(ludwig->psi, &im);
+	if (im == PSI_POISSON_MULTIGRID) {
+	  psi_mg_solve(ludwig->psi, ludwig->fe, ludwig->epsilon);
+	}
+	else {
+	  psi_sor_solve(ludwig->psi, ludwig->fe, ludwig->epsilon);
+	}
 #endif
 	TIMER_stop(TIMER_ELECTRO_POISSON);
       }
@@ -699,25 +811,66 @@ void ludwig_run(const char * inputfile) {
 
       hydro_u_zero(ludwig->hydro, uzero);
 
+      /* With fused or AA propagation, internal colloid distributions
+       * are propagated unchanged from solid sites, so set them first. */
+
+      if ((is_fused || is_aa) && is_subgrid == 0) {
+	TIMER_start(TIMER_BBL);
+	bbl_pass0(ludwig->bbl, ludwig->lb, ludwig->collinfo);
+	TIMER_stop(TIMER_BBL);
+      }
+
+      /* An AA step from the swapped layout pushes, as if fused */
+
+      lb_aa_parity(ludwig->lb, &aa_parity);
+      is_push = is_fused || (is_aa && aa_parity);
+
       /* Collision stage */
 
-      TIMER_start(TIMER_COLLIDE);
+      if (is_overlap) {
 
-      lb_collide(ludwig->lb, ludwig->hydro, ludwig->map, ludwig->noise_rho,
-		 ludwig->fe);
+	/* Boundary sites first, then the interior while the halo
+	 * messages are in flight. */
 
-      TIMER_stop(TIMER_COLLIDE);
+	TIMER_start(TIMER_COLLIDE);
+	lb_collide_region(ludwig->lb, ludwig->hydro, ludwig->map,
+			  ludwig->noise_rho, ludwig->fe, LB_COLLIDE_BOUNDARY);
+	TIMER_stop(TIMER_COLLIDE);
 
-      
-      /* Boundary conditions */
+	TIMER_start(TIMER_HALO_LATTICE);
+	lb_halo_start(ludwig->lb);
+	TIMER_stop(TIMER_HALO_LATTICE);
 
-      lb_le_apply_boundary_conditions(ludwig->lb, ludwig->le);
+	TIMER_start(TIMER_COLLIDE);
+	lb_collide_region(ludwig->lb, ludwig->hydro, ludwig->map,
+			  ludwig->noise_rho, ludwig->fe, LB_COLLIDE_INTERIOR);
+	TIMER_stop(TIMER_COLLIDE);
 
-      TIMER_start(TIMER_HALO_LATTICE);
+	TIMER_start(TIMER_HALO_LATTICE);
+	lb_halo_finish(ludwig->lb);
+	TIMER_stop(TIMER_HALO_LATTICE);
+      }
+      else {
 
-      lb_halo(ludwig->lb);
+	TIMER_start(TIMER_COLLIDE);
 
-      TIMER_stop(TIMER_HALO_LATTICE);
+	lb_collide(ludwig->lb, ludwig->hydro, ludwig->map, ludwig->noise_rho,
+		   ludwig->fe);
+
+	TIMER_stop(TIMER_COLLIDE);
+
+	/* Boundary conditions */
+
+	lb_le_apply_boundary_conditions(ludwig->lb, ludwig->le);
+
+	TIMER_start(TIMER_HALO_LATTICE);
+
+	/* Fused: return distributions pushed into the halo first. */
+	if (is_push) lb_halo_reverse(ludwig->lb);
+	lb_halo(ludwig->lb);
+
+	TIMER_stop(TIMER_HALO_LATTICE);
+      }
 
       /* Colloid bounce-back applied between collision and
        * propagation steps. */
@@ -747,15 +900,27 @@ void ludwig_run(const char * inputfile) {
     /* There must be no halo updates between bounce back
      * and propagation, as the halo regions are active */
 
-    if (ludwig->hydro) {
+    if (ludwig->hydro && is_fused == 0 && is_aa == 0) {
       TIMER_start(TIMER_PROPAGATE);
       lb_propagation(ludwig->lb);
       TIMER_stop(TIMER_PROPAGATE);
     }
 
+    perf_region_stop("step");
     TIMER_stop(TIMER_STEPS);
 
+    if (ludwig->perf_freq > 0 && step % ludwig->perf_freq == 0) {
+      if (ludwig->perf_format == PERF_FORMAT_JSON) {
+	sprintf(filename, "%sperf.json", subdirectory);
+      }
+      else {
+	sprintf(filename, "%sperf.csv", subdirectory);
+      }
+      perf_dump(filename, step, ludwig->perf_format);
+    }
+
     TIMER_start(TIMER_FREE1); /* Time diagnostics */
+    TIMER_start(TIMER_IO);
 
     /* Configuration dump */
 
@@ -768,7 +933,7 @@ void ludwig_run(const char * inputfile) {
     }
 
     if (is_rho_output_step()) {
-      /* Potential device-host copy required */
+      lb_memcpy(ludwig->lb, tdpMemcpyDeviceToHost);
       pe_info(ludwig->pe, "Writing density output at step %d!\n", step);
       sprintf(filename, "%srho-%8.8d", subdirectory, step);
       io_write_data(ludwig->lb->io_rho, filename, ludwig->lb);
@@ -812,6 +977,8 @@ void ludwig_run(const char * inputfile) {
       }
     }
 
+    TIMER_stop(TIMER_IO);
+
     /* Measurements */
 
     if (is_measurement_step()) {
@@ -832,16 +999,17 @@ void ludwig_run(const char * inputfile) {
     }
 
     if (is_vel_output_step() || is_config_step()) {
+      TIMER_start(TIMER_IO);
       hydro_io_info(ludwig->hydro, &iohandler);
       pe_info(ludwig->pe, "Writing velocity output at step %d!\n", step);
       sprintf(filename, "%svel-%8.8d", subdirectory, step);
       io_write_data(iohandler, filename, ludwig->hydro);
+      TIMER_stop(TIMER_IO);
     }
 
     /* Print progress report */
 
     if (is_statistics_step()) {
-      lb_memcpy(ludwig->lb, tdpMemcpyDeviceToHost);
       stats_distribution_print(ludwig->lb, ludwig->map);
       lb_ndist(ludwig->lb, &im);
 
@@ -919,6 +1087,7 @@ void ludwig_run(const char * inputfile) {
   /* Dump the final configuration if required. */
 
   if (is_config_at_end()) {
+    TIMER_start(TIMER_IO);
     lb_memcpy(ludwig->lb, tdpMemcpyDeviceToHost);
     sprintf(filename, "%sdist-%8.8d", subdirectory, step);
     lb_io_info(ludwig->lb, &iohandler);
@@ -955,6 +1124,19 @@ void ludwig_run(const char * inputfile) {
       sprintf(filename,"%spsi-%8.8d", subdirectory, step);
       io_write_data(iohandler, filename, ludwig->psi);
     }
+    /* Final output must be complete before we finish */
+    if (ludwig->io_async) io_async_flush(ludwig->io_async);
+    TIMER_stop(TIMER_IO);
+  }
+
+  /* Any outstanding output is completed before shut down. Waiting
+   * for it is a visible stall, so is part of TIMER_IO; the time spent
+   * in the background writer itself is reported as TIMER_IO_ASYNC. */
+
+  if (ludwig->io_async) {
+    TIMER_start(TIMER_IO);
+    io_async_free(ludwig->io_async);
+    TIMER_stop(TIMER_IO);
   }
 
   /* Shut down cleanly. Give the timer statistics. Finalise PE. */
@@ -994,6 +1176,8 @@ void ludwig_run(const char * inputfile) {
 
   TIMER_stop(TIMER_TOTAL);
   TIMER_statistics();
+  perf_statistics();
+  perf_finalise();
 
   physics_free(ludwig->phys);
   lees_edw_free(ludwig->le);
@@ -1618,6 +1802,22 @@ int free_energy_init_rt(ludwig_t * ludwig) {
     }
   }
 
+  /* Divergence of the stress without storage of the stress */
+
+  if (ludwig->pth && rt_switch(rt, "fd_force_divergence_fused")) {
+    pth_fused_set(ludwig->pth, 1);
+    pe_info(pe, "Stress divergence:      fused (stress not stored)\n");
+  }
+
+  /* Cahn-Hilliard fluxes and update are fused by default */
+
+  if (ludwig->pch) {
+    int fused = 1;
+    rt_int_parameter(rt, "fd_phi_update_fused", &fused);
+    phi_ch_fused_set(ludwig->pch, fused);
+    if (fused == 0) pe_info(pe, "Cahn-Hilliard update:   reference (not fused)\n");
+  }
+
   ludwig->cs = cs;
   ludwig->le = le;
 
@@ -1753,6 +1953,7 @@ int ludwig_colloids_update(ludwig_t * ludwig) {
   int ndist;
   int ndevice;
   int ncolloid;
+  int nsparse;
   int iconserve;         /* switch for finite-difference conservation */
   int is_subgrid = 0;    /* subgrid particle switch */
 
@@ -1761,10 +1962,14 @@ int ludwig_colloids_update(ludwig_t * ludwig) {
   colloids_info_ntotal(ludwig->collinfo, &ncolloid);
   if (ncolloid == 0) return 0;
 
-  tdpGetDeviceCount(&ndevice);
+  /* The list of fluid chunks (lb_sparse_sweep) assumes a fixed map */
 
-  /* __NVCC__ TODO: remove */
-  lb_memcpy(ludwig->lb, tdpMemcpyDeviceToHost);
+  lb_sparse(ludwig->lb, &nsparse);
+  if (nsparse > 0) {
+    pe_fatal(ludwig->pe, "lb_sparse_sweep is not available with colloids\n");
+  }
+
+  tdpGetDeviceCount(&ndevice);
 
   subgrid_on(&is_subgrid);
 
@@ -1787,17 +1992,18 @@ int ludwig_colloids_update(ludwig_t * ludwig) {
   }
   else {
 
-    /* Removal or replacement of fluid requires a lattice halo update */
+    /* Removal or replacement of fluid requires a lattice halo update.
+     * The distributions remain resident on the target: the rebuild
+     * reads only the sites it requires, and returns the sites it
+     * changes via lb_sync() etc. below. */
 
     TIMER_start(TIMER_HALO_LATTICE);
 
-    /* __NVCC__ */
     if (ndevice == 0) {
-      lb_halo(ludwig->lb);
-    }
-    else {
-      lb_halo_swap(ludwig->lb, LB_HALO_HOST);
+      /* Raw halo swap and changes to fluid require natural AA layout */
+      lb_aa_natural(ludwig->lb);
     }
+    lb_halo(ludwig->lb);
 
     TIMER_stop(TIMER_HALO_LATTICE);
 
@@ -1831,11 +2037,18 @@ int ludwig_colloids_update(ludwig_t * ludwig) {
     TIMER_stop(TIMER_FORCES);
   }
 
-  /* __NVCC__ TODO: remove */
+  /* Changes made on the host */
 
   colloids_memcpy(ludwig->collinfo, tdpMemcpyHostToDevice);
-  map_memcpy(ludwig->map, tdpMemcpyHostToDevice);
-  lb_memcpy(ludwig->lb, tdpMemcpyHostToDevice);
+
+  if (is_subgrid == 0) {
+    map_memcpy_sites(ludwig->map, ludwig->collinfo->changed,
+		     tdpMemcpyHostToDevice);
+    lb_sync(ludwig->lb);
+    if (ludwig->phi) field_sync(ludwig->phi);
+    if (ludwig->p)   field_sync(ludwig->p);
+    if (ludwig->q)   field_sync(ludwig->q);
+  }
 
   return 0;
 }
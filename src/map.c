@@ -26,6 +26,8 @@
 
 static int map_read(FILE * fp, int index, void * self);
 static int map_write(FILE * fp, int index, void * self);
+static int map_pack(void * self, char * buf);
+static int map_unpack(void * self, char * buf);
 static int map_read_ascii(FILE * fp, int index, void * self);
 static int map_write_ascii(FILE * fp, int index, void * self);
 
@@ -187,6 +189,36 @@ __host__ int map_memcpy(map_t * map, tdpMemcpyKind flag) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  map_memcpy_sites
+ *
+ *  As map_memcpy(), but for the sites in the list only.
+ *
+ *****************************************************************************/
+
+__host__ int map_memcpy_sites(map_t * map, site_sync_t * sites,
+			      tdpMemcpyKind flag) {
+  int ndevice;
+  char * tmp = map->status;
+
+  assert(map);
+  assert(sites);
+  assert(sites->nsites <= map->nsite);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    tdpMemcpy(&tmp, &map->target->status, sizeof(char *),
+	      tdpMemcpyDeviceToHost);
+  }
+
+  site_sync_memcpy(sites, map->status, tmp, map->nsite, 1, sizeof(char),
+		   flag);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  map_init_io_info
@@ -214,6 +246,7 @@ int map_init_io_info(map_t * obj, int grid[3], int form_in, int form_out) {
   io_info_write_set(obj->info, IO_FORMAT_ASCII, map_write_ascii);
   io_info_read_set(obj->info, IO_FORMAT_BINARY, map_read);
   io_info_read_set(obj->info, IO_FORMAT_ASCII, map_read_ascii);
+  io_info_pack_set(obj->info, map_pack, map_unpack);
 
   sz = sizeof(char) + obj->ndata*sizeof(double);
   io_info_set_bytesize(obj->info, IO_FORMAT_BINARY, sz);
@@ -507,6 +540,59 @@ static int map_read(FILE * fp, int index, void * self) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  map_pack
+ *
+ *  Bulk binary equivalent of map_write() for all local sites. The
+ *  record is one char (status) followed by ndata doubles.
+ *
+ *****************************************************************************/
+
+static int map_pack(void * self, char * buf) {
+
+  map_t * obj = (map_t *) self;
+  size_t recsz;
+
+  assert(obj);
+
+  recsz = sizeof(char) + obj->ndata*sizeof(double);
+
+  io_pack_rank1(obj->cs, obj->nsite, 1, sizeof(char), obj->status, recsz,
+		0, buf);
+  if (obj->ndata > 0) {
+    io_pack_rank1(obj->cs, obj->nsite, obj->ndata, sizeof(double), obj->data,
+		  recsz, sizeof(char), buf);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  map_unpack
+ *
+ *****************************************************************************/
+
+static int map_unpack(void * self, char * buf) {
+
+  map_t * obj = (map_t *) self;
+  size_t recsz;
+
+  assert(obj);
+
+  recsz = sizeof(char) + obj->ndata*sizeof(double);
+
+  io_unpack_rank1(obj->cs, obj->nsite, 1, sizeof(char), obj->status, recsz,
+		  0, buf);
+  if (obj->ndata > 0) {
+    io_unpack_rank1(obj->cs, obj->nsite, obj->ndata, sizeof(double),
+		    obj->data, recsz, sizeof(char), buf);
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  map_write_ascii
@@ -20,6 +20,7 @@
 #include "pe.h"
 #include "coords.h"
 #include "io_harness.h"
+#include "site_sync.h"
 
 enum map_status {MAP_FLUID, MAP_BOUNDARY, MAP_COLLOID, MAP_STATUS_MAX};
 
@@ -28,6 +29,8 @@ typedef struct map_s map_t;
 __host__ int map_create(pe_t * pe, cs_t * cs, int ndata, map_t ** pobj);
 __host__ int map_free(map_t * obj);
 __host__ int map_memcpy(map_t * map, tdpMemcpyKind flag);
+__host__ int map_memcpy_sites(map_t * map, site_sync_t * sites,
+			      tdpMemcpyKind flag);
 
 __host__ int map_pm(map_t * map, int * porous_media_flag);
 __host__ int map_pm_set(map_t * map, int porous_media_flag);
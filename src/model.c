@@ -12,7 +12,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2018 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -31,6 +31,8 @@
 #include "model.h"
 #include "lb_model_s.h"
 #include "io_harness.h"
+#include "kernel.h"
+#include "perf.h"
 
 const double cs2  = (1.0/3.0);
 const double rcs2 = 3.0;
@@ -43,9 +45,19 @@ static int lb_f_read(FILE *, int index, void * self);
 static int lb_f_read_ascii(FILE *, int index, void * self);
 static int lb_f_write(FILE *, int index, void * self);
 static int lb_f_write_ascii(FILE *, int index, void * self);
+static int lb_f_pack(void * self, char * buf);
+static int lb_f_unpack(void * self, char * buf);
 static int lb_rho_write(FILE *, int index, void * self);
 static int lb_rho_write_ascii(FILE *, int index, void * self);
 static int lb_model_param_init(lb_t * lb);
+static int lb_halo_work(lb_t * lb);
+static int lb_halo_reverse_plane(lb_t * lb, int dim, int imin[3],
+				 int imax[3], int pvlo[NVEL], int pvhi[NVEL]);
+
+static __host__ __device__ int lb_f_addr(lb_t * lb, int index, int n, int p);
+#ifndef NDEBUG
+static __host__ __device__ int lb_f_addr_valid(lb_t * lb, int index, int p);
+#endif
 
 static __constant__ lb_collide_param_t static_param;
 
@@ -112,26 +124,35 @@ __host__ int lb_create(pe_t * pe, cs_t * cs, lb_t ** plb) {
 __host__ int lb_free(lb_t * lb) {
 
   int ndevice;
-  double * tmp;
+  int * sparse = NULL;
+  lb_data_t * tmp;
 
   assert(lb);
 
   tdpGetDeviceCount(&ndevice);
 
   if (ndevice > 0) {
-    tdpMemcpy(&tmp, &lb->target->f, sizeof(double *), tdpMemcpyDeviceToHost); 
+    tdpMemcpy(&tmp, &lb->target->f, sizeof(lb_data_t *), tdpMemcpyDeviceToHost); 
     tdpFree(tmp);
 
-    tdpMemcpy(&tmp, &lb->target->fprime, sizeof(double *),
+    tdpMemcpy(&tmp, &lb->target->fprime, sizeof(lb_data_t *),
 	      tdpMemcpyDeviceToHost); 
-    tdpFree(tmp);
+    if (tmp) tdpFree(tmp);
+
+    tdpMemcpy(&sparse, &lb->target->sparse, sizeof(int *),
+	      tdpMemcpyDeviceToHost);
+    if (sparse) tdpFree(sparse);
     tdpFree(lb->target);
   }
 
+  if (lb->sync) site_sync_free(lb->sync);
   if (lb->halo) halo_swap_free(lb->halo);
   if (lb->io_info) io_info_free(lb->io_info);
   if (lb->f) free(lb->f);
   if (lb->fprime) free(lb->fprime);
+  if (lb->sparse) free(lb->sparse);
+  if (lb->reverse) free(lb->reverse);
+  if (lb->natural) free(lb->natural);
 
   MPI_Type_free(&lb->plane_xy_full);
   MPI_Type_free(&lb->plane_xz_full);
@@ -166,7 +187,7 @@ __host__ int lb_free(lb_t * lb) {
 __host__ int lb_memcpy(lb_t * lb, tdpMemcpyKind flag) {
 
   int ndevice;
-  double * tmpf = NULL;
+  lb_data_t * tmpf = NULL;
 
   assert(lb);
 
@@ -180,17 +201,17 @@ __host__ int lb_memcpy(lb_t * lb, tdpMemcpyKind flag) {
 
     assert(lb->target);
 
-    tdpMemcpy(&tmpf, &lb->target->f, sizeof(double *), tdpMemcpyDeviceToHost);
+    tdpMemcpy(&tmpf, &lb->target->f, sizeof(lb_data_t *), tdpMemcpyDeviceToHost);
 
     switch (flag) {
     case tdpMemcpyHostToDevice:
       tdpMemcpy(&lb->target->ndist, &lb->ndist, sizeof(int), flag); 
       tdpMemcpy(&lb->target->nsite, &lb->nsite, sizeof(int), flag); 
       tdpMemcpy(&lb->target->model, &lb->model, sizeof(int), flag);
-      tdpMemcpy(tmpf, lb->f, NVEL*lb->nsite*lb->ndist*sizeof(double), flag);
+      tdpMemcpy(tmpf, lb->f, NVEL*lb->nsite*lb->ndist*sizeof(lb_data_t), flag);
       break;
     case tdpMemcpyDeviceToHost:
-      tdpMemcpy(lb->f, tmpf, NVEL*lb->nsite*lb->ndist*sizeof(double), flag);
+      tdpMemcpy(lb->f, tmpf, NVEL*lb->nsite*lb->ndist*sizeof(lb_data_t), flag);
       break;
     default:
       pe_fatal(lb->pe, "Bad flag in lb_memcpy\n");
@@ -200,6 +221,72 @@ __host__ int lb_memcpy(lb_t * lb, tdpMemcpyKind flag) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  lb_memcpy_sites
+ *
+ *  As lb_memcpy(), but for the sites in the list only.
+ *
+ *****************************************************************************/
+
+__host__ int lb_memcpy_sites(lb_t * lb, site_sync_t * sites,
+			     tdpMemcpyKind flag) {
+  int ndevice;
+  lb_data_t * tmpf = lb->f;
+
+  assert(lb);
+  assert(sites);
+  assert(sites->nsites <= lb->nsite);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    tdpMemcpy(&tmpf, &lb->target->f, sizeof(lb_data_t *),
+	      tdpMemcpyDeviceToHost);
+  }
+
+  site_sync_memcpy(sites, lb->f, tmpf, lb->nsite, lb->ndist*NVEL,
+		   sizeof(lb_data_t), flag);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_sync_site
+ *
+ *  Record a change to the distributions at site index on the host.
+ *
+ *****************************************************************************/
+
+__host__ int lb_sync_site(lb_t * lb, int index) {
+
+  assert(lb);
+
+  site_sync_add(lb->sync, index);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_sync
+ *
+ *  Copy the distributions at the sites changed on the host since
+ *  the last call to the target.
+ *
+ *****************************************************************************/
+
+__host__ int lb_sync(lb_t * lb) {
+
+  assert(lb);
+
+  lb_memcpy_sites(lb, lb->sync, tdpMemcpyHostToDevice);
+  site_sync_reset(lb->sync);
+
+  return 0;
+}
+
 /***************************************************************************
  *
  *  lb_init
@@ -218,7 +305,7 @@ __host__ int lb_init(lb_t * lb) {
   int ndata;
   int nhalo;
   int ndevice;
-  double * tmp;
+  lb_data_t * tmp;
 
   assert(lb);
 
@@ -234,19 +321,24 @@ __host__ int lb_init(lb_t * lb) {
 
   ndata = lb->nsite*lb->ndist*NVEL;
 #ifdef OLD_DATA
-  lb->f = (double  *) calloc(ndata, sizeof(double));
+  lb->f = (lb_data_t *) calloc(ndata, sizeof(lb_data_t));
   if (lb->f == NULL) pe_fatal(lb->pe, "malloc(distributions) failed\n");
 
-  lb->fprime = (double  *) calloc(ndata, sizeof(double));
+  lb->fprime = (lb_data_t *) calloc(ndata, sizeof(lb_data_t));
   if (lb->fprime == NULL) pe_fatal(lb->pe, "malloc(distributions) failed\n");
 #else
-  lb->f = (double  *) mem_aligned_malloc(MEM_PAGESIZE, ndata*sizeof(double));
+  lb->f = (lb_data_t *) mem_aligned_malloc(MEM_PAGESIZE,
+					       ndata*sizeof(lb_data_t));
   if (lb->f == NULL) pe_fatal(lb->pe, "malloc(distributions) failed\n");
-  memset(lb->f, 0, ndata*sizeof(double));
-
-  lb->fprime = (double *) mem_aligned_malloc(MEM_PAGESIZE, ndata*sizeof(double));
-  if (lb->fprime == NULL) pe_fatal(lb->pe, "malloc(distributions) failed\n");
-  memset(lb->fprime, 0, ndata*sizeof(double));
+  memset(lb->f, 0, ndata*sizeof(lb_data_t));
+
+  /* In-place (AA) propagation has no need of the second buffer */
+  if (lb->param->isaa == 0) {
+    lb->fprime = (lb_data_t *) mem_aligned_malloc(MEM_PAGESIZE,
+						  ndata*sizeof(lb_data_t));
+    if (lb->fprime == NULL) pe_fatal(lb->pe, "malloc(distributions) failed\n");
+    memset(lb->fprime, 0, ndata*sizeof(lb_data_t));
+  }
 #endif
 
   /* Allocate target copy of structure or alias */
@@ -262,14 +354,16 @@ __host__ int lb_init(lb_t * lb) {
     tdpMalloc((void **) &lb->target, sizeof(lb_t));
     tdpMemset(lb->target, 0, sizeof(lb_t));
 
-    tdpMalloc((void **) &tmp, ndata*sizeof(double));
-    tdpMemset(tmp, 0, ndata*sizeof(double));
-    tdpMemcpy(&lb->target->f, &tmp, sizeof(double *), tdpMemcpyHostToDevice);
+    tdpMalloc((void **) &tmp, ndata*sizeof(lb_data_t));
+    tdpMemset(tmp, 0, ndata*sizeof(lb_data_t));
+    tdpMemcpy(&lb->target->f, &tmp, sizeof(lb_data_t *), tdpMemcpyHostToDevice);
  
-    tdpMalloc((void **) &tmp, ndata*sizeof(double));
-    tdpMemset(tmp, 0, ndata*sizeof(double));
-    tdpMemcpy(&lb->target->fprime, &tmp, sizeof(double *),
-	      tdpMemcpyHostToDevice);
+    if (lb->param->isaa == 0) {
+      tdpMalloc((void **) &tmp, ndata*sizeof(lb_data_t));
+      tdpMemset(tmp, 0, ndata*sizeof(lb_data_t));
+      tdpMemcpy(&lb->target->fprime, &tmp, sizeof(lb_data_t *),
+		tdpMemcpyHostToDevice);
+    }
 
     tdpGetSymbolAddress((void **) &ptmp, tdpSymbol(static_param));
     tdpMemcpy(&lb->target->param, &ptmp, sizeof(lb_collide_param_t *),
@@ -283,14 +377,14 @@ __host__ int lb_init(lb_t * lb) {
    * in YZ plane one contiguous block of ny*nz sites. */
 
   MPI_Type_vector(nx*ny, lb->ndist*NVEL*nhalolocal, lb->ndist*NVEL*nz,
-		  MPI_DOUBLE, &lb->plane_xy_full);
+		  MPI_LB_DATA, &lb->plane_xy_full);
   MPI_Type_commit(&lb->plane_xy_full);
 
   MPI_Type_vector(nx, lb->ndist*NVEL*nz*nhalolocal, lb->ndist*NVEL*ny*nz,
-		  MPI_DOUBLE, &lb->plane_xz_full);
+		  MPI_LB_DATA, &lb->plane_xz_full);
   MPI_Type_commit(&lb->plane_xz_full);
 
-  MPI_Type_vector(1, lb->ndist*NVEL*ny*nz*nhalolocal, 1, MPI_DOUBLE,
+  MPI_Type_vector(1, lb->ndist*NVEL*ny*nz*nhalolocal, 1, MPI_LB_DATA,
 		  &lb->plane_yz_full);
   MPI_Type_commit(&lb->plane_yz_full);
 
@@ -299,6 +393,8 @@ __host__ int lb_init(lb_t * lb) {
   lb_halo_set(lb, LB_HALO_FULL);
   lb_memcpy(lb, tdpMemcpyHostToDevice);
 
+  site_sync_create(lb->pe, lb->nsite, &lb->sync);
+
   return 0;
 }
 
@@ -330,10 +426,13 @@ __host__ int lb_collide_param_commit(lb_t * lb) {
 static int lb_model_param_init(lb_t * lb) {
 
   int ia, ib, p;
+  int xs, ys, zs;
 
   assert(lb);
   assert(lb->param);
 
+  cs_strides(lb->cs, &xs, &ys, &zs);
+
   lb->param->nsite = lb->nsite;
   lb->param->ndist = lb->ndist;
 
@@ -341,7 +440,9 @@ static int lb_model_param_init(lb_t * lb) {
     lb->param->wv[p] = wv[p];
     for (ia = 0; ia < 3; ia++) {
       lb->param->cv[p][ia] = cv[p][ia];
+      assert(cv[(NVEL - p) % NVEL][ia] == -cv[p][ia]);
     }
+    lb->param->ndisp[p] = xs*cv[p][X] + ys*cv[p][Y] + zs*cv[p][Z];
     for (ia = 0; ia < 3; ia++) {
       for (ib = 0; ib < 3; ib++) {
 	lb->param->q[p][ia][ib] = q_[p][ia][ib];
@@ -474,7 +575,7 @@ static int lb_mpi_init(lb_t * lb) {
   nz = nlocal[Z] + 2*nhalo;
 
   /* extent of single site (AOS) */
-  extent = NVEL*lb->ndist*sizeof(double);
+  extent = NVEL*lb->ndist*sizeof(lb_data_t);
 
   /* X direction */
 
@@ -589,6 +690,7 @@ static int lb_mpi_init(lb_t * lb) {
 
   halo_swap_create_r2(lb->pe, lb->cs, 1, lb->nsite, lb->ndist, NVEL,&lb->halo);
   halo_swap_handlers_set(lb->halo, halo_swap_pack_rank1, halo_swap_unpack_rank1);
+  halo_swap_mpi_datatype_set(lb->halo, MPI_LB_DATA);
 
   return 0;
 }
@@ -608,7 +710,7 @@ static int lb_set_types(int ntype, MPI_Datatype * type) {
   assert(type);
 
   for (n = 0; n < ntype; n++) {
-    type[n] = MPI_DOUBLE;
+    type[n] = MPI_LB_DATA;
   }
 
   return 0;
@@ -683,12 +785,22 @@ __host__ int lb_io_info_set(lb_t * lb, io_info_t * io_info, int form_in, int for
 
   lb->io_info = io_info;
 
+  /* The storage type is part of the description, so a file of
+   * float distributions (stored shifted by w_p) is not read by a
+   * double build, or vice versa. Double is unmarked, as before. */
+
+#ifdef LB_DATA_FLOAT
+  sprintf(string, "%1d x Distribution: d%dq%d (float)", lb->ndist, NDIM, NVEL);
+#else
   sprintf(string, "%1d x Distribution: d%dq%d", lb->ndist, NDIM, NVEL);
+#endif
 
   io_info_set_name(lb->io_info, string);
   io_info_read_set(lb->io_info, IO_FORMAT_BINARY, lb_f_read);
   io_info_write_set(lb->io_info, IO_FORMAT_BINARY, lb_f_write);
-  io_info_set_bytesize(lb->io_info, IO_FORMAT_BINARY, lb->ndist*NVEL*sizeof(double));
+  io_info_pack_set(lb->io_info, lb_f_pack, lb_f_unpack);
+  io_info_set_bytesize(lb->io_info, IO_FORMAT_BINARY,
+		       lb->ndist*NVEL*sizeof(lb_data_t));
   io_info_read_set(lb->io_info, IO_FORMAT_ASCII, lb_f_read_ascii);
   io_info_write_set(lb->io_info, IO_FORMAT_ASCII, lb_f_write_ascii);
   io_info_format_set(lb->io_info, form_in, form_out);
@@ -741,6 +853,22 @@ __host__ int lb_io_info(lb_t * lb, io_info_t ** io_info) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  lb_io_rho
+ *
+ *****************************************************************************/
+
+__host__ int lb_io_rho(lb_t * lb, io_info_t ** io_rho) {
+
+  assert(lb);
+  assert(io_rho);
+
+  *io_rho = lb->io_rho;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  lb_halo
@@ -754,7 +882,81 @@ __host__ int lb_halo(lb_t * lb) {
 
   assert(lb);
 
+  perf_region_start("halo");
   lb_halo_swap(lb, LB_HALO_TARGET);
+  lb_halo_work(lb);
+  perf_region_stop("halo");
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_halo_work
+ *
+ *  Nominal work for the current perf region: all distributions at
+ *  each face site, sent and received, in each direction.
+ *
+ *****************************************************************************/
+
+static int lb_halo_work(lb_t * lb) {
+
+  int nlocal[3];
+  double nface;
+
+  assert(lb);
+
+  cs_nlocal(lb->cs, nlocal);
+
+  nface = 1.0*nlocal[Y]*nlocal[Z] + 1.0*(nlocal[X] + 2)*nlocal[Z]
+    + 1.0*(nlocal[X] + 2)*(nlocal[Y] + 2);
+
+  perf_region_work(0.0, 4.0*nface*lb->ndist*NVEL*sizeof(lb_data_t), 0.0);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_halo_start
+ *
+ *  Split-phase version of lb_halo(). Between start and finish, the
+ *  distributions at sites in the outermost local layer, and in the
+ *  halo, must not be touched.
+ *
+ *****************************************************************************/
+
+__host__ int lb_halo_start(lb_t * lb) {
+
+  lb_data_t * data;
+
+  assert(lb);
+
+  perf_region_start("halo");
+  tdpMemcpy(&data, &lb->target->f, sizeof(lb_data_t *), tdpMemcpyDeviceToHost);
+  halo_swap_start(lb->halo, data);
+  lb_halo_work(lb);
+  perf_region_stop("halo");
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_halo_finish
+ *
+ *****************************************************************************/
+
+__host__ int lb_halo_finish(lb_t * lb) {
+
+  lb_data_t * data;
+
+  assert(lb);
+
+  perf_region_start("halo");
+  tdpMemcpy(&data, &lb->target->f, sizeof(lb_data_t *), tdpMemcpyDeviceToHost);
+  halo_swap_finish(lb->halo, data);
+  perf_region_stop("halo");
 
   return 0;
 }
@@ -769,7 +971,7 @@ __host__ int lb_halo(lb_t * lb) {
 
 __host__ int lb_halo_swap(lb_t * lb, lb_halo_enum_t flag) {
 
-  double * data;
+  lb_data_t * data;
   const char * msg = "Attempting halo via struct with NSIMDVL > 1 or (AO)SOA";
 
   assert(lb);
@@ -779,7 +981,7 @@ __host__ int lb_halo_swap(lb_t * lb, lb_halo_enum_t flag) {
     lb_halo_via_copy(lb);
     break;
   case LB_HALO_TARGET:
-    tdpMemcpy(&data, &lb->target->f, sizeof(double *), tdpMemcpyDeviceToHost);
+    tdpMemcpy(&data, &lb->target->f, sizeof(lb_data_t *), tdpMemcpyDeviceToHost);
     halo_swap_packed(lb->halo, data);
     break;
   case LB_HALO_FULL:
@@ -850,11 +1052,11 @@ __host__ int lb_halo_via_struct(lb_t * lb) {
 
 	  ihalo = lb->ndist*NVEL*cs_index(lb->cs, 0, jc, kc);
 	  ireal = lb->ndist*NVEL*cs_index(lb->cs, nlocal[X], jc, kc);
-	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(double));
+	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(lb_data_t));
 
 	  ihalo = lb->ndist*NVEL*cs_index(lb->cs, nlocal[X]+1, jc, kc);
 	  ireal = lb->ndist*NVEL*cs_index(lb->cs, 1, jc, kc);
-	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(double));
+	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(lb_data_t));
 	}
       }
     }
@@ -886,11 +1088,11 @@ __host__ int lb_halo_via_struct(lb_t * lb) {
 
 	  ihalo = lb->ndist*NVEL*cs_index(lb->cs, ic, 0, kc);
 	  ireal = lb->ndist*NVEL*cs_index(lb->cs, ic, nlocal[Y], kc);
-	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(double));
+	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(lb_data_t));
 
 	  ihalo = lb->ndist*NVEL*cs_index(lb->cs, ic, nlocal[Y] + 1, kc);
 	  ireal = lb->ndist*NVEL*cs_index(lb->cs, ic, 1, kc);
-	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(double));
+	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(lb_data_t));
 	}
       }
     }
@@ -922,11 +1124,11 @@ __host__ int lb_halo_via_struct(lb_t * lb) {
 
 	  ihalo = lb->ndist*NVEL*cs_index(lb->cs, ic, jc, 0);
 	  ireal = lb->ndist*NVEL*cs_index(lb->cs, ic, jc, nlocal[Z]);
-	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(double));
+	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(lb_data_t));
 
 	  ihalo = lb->ndist*NVEL*cs_index(lb->cs, ic, jc, nlocal[Z] + 1);
 	  ireal = lb->ndist*NVEL*cs_index(lb->cs, ic, jc, 1);
-	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(double));
+	  memcpy(lb->f + ihalo, lb->f + ireal, lb->ndist*NVEL*sizeof(lb_data_t));
 	}
       }
     }
@@ -958,6 +1160,7 @@ __host__ int lb_halo_via_struct(lb_t * lb) {
  *
  *  Read one lattice site (index) worth of distributions.
  *  Note that read-write is always 'MODEL' order.
+ *  Binary data are in storage precision (lb_data_t) as held.
  *
  *****************************************************************************/
 
@@ -972,8 +1175,8 @@ static int lb_f_read(FILE * fp, int index, void * self) {
 
   for (n = 0; n < lb->ndist; n++) {
     for (p = 0; p < NVEL; p++) {
-      iread = LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p);
-      nr += fread(lb->f + iread, sizeof(double), 1, fp);
+      iread = lb_f_addr(lb, index, n, p);
+      nr += fread(lb->f + iread, sizeof(lb_data_t), 1, fp);
     }
   }
 
@@ -995,6 +1198,7 @@ static int lb_f_read_ascii(FILE * fp, int index, void * self) {
 
   int n, p;
   int nr;
+  double fvalue;
   pe_t * pe = NULL;
   lb_t * lb = (lb_t *) self;
 
@@ -1010,8 +1214,8 @@ static int lb_f_read_ascii(FILE * fp, int index, void * self) {
   nr = 0;
   for (n = 0; n < lb->ndist; n++) {
     for (p = 0; p < NVEL; p++) {
-      nr += fscanf(fp, "%le",
-		   &lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)]);
+      nr += fscanf(fp, "%le", &fvalue);
+      lb->f[lb_f_addr(lb, index, n, p)] = fvalue - LB_FSHIFT(lb->param, n, p);
     }
   }
 
@@ -1026,6 +1230,7 @@ static int lb_f_read_ascii(FILE * fp, int index, void * self) {
  *
  *  Write one lattice site (index) worth of distributions.
  *  Note that read/write is always 'MODEL' order.
+ *  Binary data are in storage precision (lb_data_t) as held.
  *
  *****************************************************************************/
 
@@ -1040,8 +1245,8 @@ static int lb_f_write(FILE * fp, int index, void * self) {
 
   for (n = 0; n < lb->ndist; n++) {
     for (p = 0; p < NVEL; p++) {
-      iwrite = LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p);
-      nw += fwrite(lb->f + iwrite, sizeof(double), 1, fp);
+      iwrite = lb_f_addr(lb, index, n, p);
+      nw += fwrite(lb->f + iwrite, sizeof(lb_data_t), 1, fp);
     }
   }
 
@@ -1050,6 +1255,105 @@ static int lb_f_write(FILE * fp, int index, void * self) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  lb_f_pack
+ *
+ *  Bulk binary equivalent of lb_f_write() for all local sites. In the
+ *  natural layout (parity 0) the distributions are a rank 1 object
+ *  of ndist*NVEL elements per site, so the common helper is used.
+ *  The swapped AA layout has its own strip loop via lb_f_addr().
+ *
+ *****************************************************************************/
+
+static int lb_f_pack(void * self, char * buf) {
+
+  int ic, jc, kc, n, p;
+  int index0;
+  int nlocal[3];
+  int xs, ys, zs;
+  size_t ib = 0;
+  lb_t * lb = (lb_t *) self;
+  lb_data_t * fbuf = (lb_data_t *) buf;
+  const int nrec = lb->ndist*NVEL;
+
+  assert(lb);
+  assert(buf);
+
+  if (lb->param->parity == 0) {
+    return io_pack_rank1(lb->cs, lb->nsite, nrec, sizeof(lb_data_t), lb->f,
+			 nrec*sizeof(lb_data_t), 0, buf);
+  }
+
+  cs_nlocal(lb->cs, nlocal);
+  cs_strides(lb->cs, &xs, &ys, &zs);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      index0 = cs_index(lb->cs, ic, jc, 1);
+      for (n = 0; n < lb->ndist; n++) {
+	for (p = 0; p < NVEL; p++) {
+	  for (kc = 0; kc < nlocal[Z]; kc++) {
+	    fbuf[ib + nrec*kc + NVEL*n + p]
+	      = lb->f[lb_f_addr(lb, index0 + zs*kc, n, p)];
+	  }
+	}
+      }
+      ib += nrec*nlocal[Z];
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_f_unpack
+ *
+ *  Bulk binary equivalent of lb_f_read(); cf. lb_f_pack().
+ *
+ *****************************************************************************/
+
+static int lb_f_unpack(void * self, char * buf) {
+
+  int ic, jc, kc, n, p;
+  int index0;
+  int nlocal[3];
+  int xs, ys, zs;
+  size_t ib = 0;
+  lb_t * lb = (lb_t *) self;
+  lb_data_t * fbuf = (lb_data_t *) buf;
+  const int nrec = lb->ndist*NVEL;
+
+  assert(lb);
+  assert(buf);
+
+  if (lb->param->parity == 0) {
+    return io_unpack_rank1(lb->cs, lb->nsite, nrec, sizeof(lb_data_t), lb->f,
+			   nrec*sizeof(lb_data_t), 0, buf);
+  }
+
+  cs_nlocal(lb->cs, nlocal);
+  cs_strides(lb->cs, &xs, &ys, &zs);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      index0 = cs_index(lb->cs, ic, jc, 1);
+      for (n = 0; n < lb->ndist; n++) {
+	for (p = 0; p < NVEL; p++) {
+	  for (kc = 0; kc < nlocal[Z]; kc++) {
+	    lb->f[lb_f_addr(lb, index0 + zs*kc, n, p)]
+	      = fbuf[ib + nrec*kc + NVEL*n + p];
+	  }
+	}
+      }
+      ib += nrec*nlocal[Z];
+    }
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  lb_f_write_ascii
@@ -1063,6 +1367,7 @@ static int lb_f_write_ascii(FILE * fp, int index, void * self) {
 
   int n, p;
   int nw = 0;
+  double fvalue;
   lb_t * lb = (lb_t*) self;
 
   pe_t * pe = NULL;
@@ -1083,7 +1388,8 @@ static int lb_f_write_ascii(FILE * fp, int index, void * self) {
 
   for (n = 0; n < lb->ndist; n++) {
     for (p = 0; p < NVEL; p++) {
-      fprintf(fp, "%le ", lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)]);
+      fvalue = lb->f[lb_f_addr(lb, index, n, p)] + LB_FSHIFT(lb->param, n, p);
+      fprintf(fp, "%le ", fvalue);
       nw++;
     }
   }
@@ -1228,7 +1534,7 @@ int lb_f(lb_t * lb, int index, int p, int n, double * f) {
   assert(p >= 0 && p < NVEL);
   assert(n >= 0 && n < lb->ndist);
 
-  *f = lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)];
+  *f = lb->f[lb_f_addr(lb, index, n, p)] + LB_FSHIFT(lb->param, n, p);
 
   return 0;
 }
@@ -1249,7 +1555,7 @@ int lb_f_set(lb_t * lb, int index, int p, int n, double fvalue) {
   assert(p >= 0 && p < NVEL);
   assert(n >= 0 && n < lb->ndist);
 
-  lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)] = fvalue;
+  lb->f[lb_f_addr(lb, index, n, p)] = fvalue - LB_FSHIFT(lb->param, n, p);
 
   return 0;
 }
@@ -1275,7 +1581,7 @@ int lb_0th_moment(lb_t * lb, int index, lb_dist_enum_t nd, double * rho) {
   *rho = 0.0;
 
   for (p = 0; p < NVEL; p++) {
-    *rho += lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, nd, p)];
+    *rho += lb->f[lb_f_addr(lb, index, nd, p)] + LB_FSHIFT(lb->param, nd, p);
   }
 
   return 0;
@@ -1306,7 +1612,8 @@ int lb_1st_moment(lb_t * lb, int index, lb_dist_enum_t nd, double g[3]) {
 
   for (p = 0; p < NVEL; p++) {
     for (n = 0; n < NDIM; n++) {
-      g[n] += cv[p][n]*lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, nd, p)];
+      g[n] += cv[p][n]*(lb->f[lb_f_addr(lb, index, nd, p)]
+			+ LB_FSHIFT(lb->param, nd, p));
     }
   }
 
@@ -1339,8 +1646,8 @@ int lb_2nd_moment(lb_t * lb, int index, lb_dist_enum_t nd, double s[3][3]) {
   for (p = 0; p < NVEL; p++) {
     for (ia = 0; ia < NDIM; ia++) {
       for (ib = 0; ib < NDIM; ib++) {
-	s[ia][ib] += lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, nd, p)]
-	  *q_[p][ia][ib];
+	s[ia][ib] += (lb->f[lb_f_addr(lb, index, nd, p)]
+		       + LB_FSHIFT(lb->param, nd, p))*q_[p][ia][ib];
       }
     }
   }
@@ -1368,7 +1675,7 @@ int lb_0th_moment_equilib_set(lb_t * lb, int index, int n, double rho) {
   assert(index >= 0 && index < lb->nsite);
 
   for (p = 0; p < NVEL; p++) {
-    lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)] = wv[p]*rho;
+    lb->f[lb_f_addr(lb, index, n, p)] = wv[p]*rho - LB_FSHIFT(lb->param, n, p);
   }
 
   return 0;
@@ -1402,8 +1709,9 @@ int lb_1st_moment_equilib_set(lb_t * lb, int index, double rho, double u[3]) {
       }
     }
 
-    lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, LB_RHO, p)]
-      = rho*wv[p]*(1.0 + rcs2*udotc + 0.5*rcs2*rcs2*sdotq);
+    lb->f[lb_f_addr(lb, index, LB_RHO, p)]
+      = rho*wv[p]*(1.0 + rcs2*udotc + 0.5*rcs2*rcs2*sdotq)
+      - LB_FSHIFT(lb->param, LB_RHO, p);
   }
 
   return 0;
@@ -1427,7 +1735,7 @@ int lb_f_index(lb_t * lb, int index, int n, double f[NVEL]) {
   assert(index >= 0 && index < lb->nsite);
 
   for (p = 0; p < NVEL; p++) {
-    f[p] = lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)];
+    f[p] = lb->f[lb_f_addr(lb, index, n, p)] + LB_FSHIFT(lb->param, n, p);
   }
 
   return 0;
@@ -1454,7 +1762,8 @@ int lb_f_multi_index(lb_t * lb, int index, int n, double fv[NVEL][NSIMDVL]) {
 
   for (p = 0; p < NVEL; p++) {
     for (iv = 0; iv < NSIMDVL; iv++) {
-      fv[p][iv] = lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index + iv, n, p)];
+      fv[p][iv] = lb->f[lb_f_addr(lb, index + iv, n, p)]
+	+ LB_FSHIFT(lb->param, n, p);
     }
   }
 
@@ -1483,7 +1792,8 @@ int lb_f_multi_index_part(lb_t * lb, int index, int n, double fv[NVEL][NSIMDVL],
 
   for (p = 0; p < NVEL; p++) {
     for (iv = 0; iv < nv; iv++) {
-      fv[p][iv] = lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index + iv, n, p)];
+      fv[p][iv] = lb->f[lb_f_addr(lb, index + iv, n, p)]
+	+ LB_FSHIFT(lb->param, n, p);
     }
   }
 
@@ -1509,7 +1819,7 @@ int lb_f_index_set(lb_t * lb, int index, int n, double f[NVEL]) {
   assert(index >= 0 && index < lb->nsite);
 
   for (p = 0; p < NVEL; p++) {
-    lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)] = f[p];
+    lb->f[lb_f_addr(lb, index, n, p)] = f[p] - LB_FSHIFT(lb->param, n, p);
   }
 
   return 0;
@@ -1536,7 +1846,8 @@ int lb_f_multi_index_set(lb_t * lb, int index, int n, double fv[NVEL][NSIMDVL]){
   assert(0);
   for (p = 0; p < NVEL; p++) {
     for (iv = 0; iv < NSIMDVL; iv++) {
-      lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index + iv, n, p)] = fv[p][iv];
+      lb->f[lb_f_addr(lb, index + iv, n, p)]
+	= fv[p][iv] - LB_FSHIFT(lb->param, n, p);
     }
   }
 
@@ -1563,7 +1874,8 @@ int lb_f_multi_index_set_part(lb_t * lb, int index, int n,
   assert(0);
   for (p = 0; p < NVEL; p++) {
     for (iv = 0; iv < nv; iv++) {
-      lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index + iv, n, p)] = fv[p][iv];
+      lb->f[lb_f_addr(lb, index + iv, n, p)]
+	= fv[p][iv] - LB_FSHIFT(lb->param, n, p);
     }
   }
 
@@ -1611,10 +1923,10 @@ __host__ int lb_halo_via_copy(lb_t * lb) {
   const int tagf = 900;
   const int tagb = 901;
 
-  double * sendforw;
-  double * sendback;
-  double * recvforw;
-  double * recvback;
+  lb_data_t * sendforw;
+  lb_data_t * sendback;
+  lb_data_t * recvforw;
+  lb_data_t * recvback;
 
   MPI_Request request[4];
   MPI_Status status[4];
@@ -1629,10 +1941,10 @@ __host__ int lb_halo_via_copy(lb_t * lb) {
   /* The x-direction (YZ plane) */
 
   nsend = NVEL*lb->ndist*nlocal[Y]*nlocal[Z];
-  sendforw = (double *) malloc(nsend*sizeof(double));
-  sendback = (double *) malloc(nsend*sizeof(double));
-  recvforw = (double *) malloc(nsend*sizeof(double));
-  recvback = (double *) malloc(nsend*sizeof(double));
+  sendforw = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  sendback = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  recvforw = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  recvback = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
   assert(sendback && sendforw);
   assert(recvforw && recvback);
   if (sendforw == NULL) pe_fatal(lb->pe, "malloc(sendforw) failed\n");
@@ -1661,19 +1973,19 @@ __host__ int lb_halo_via_copy(lb_t * lb) {
   assert(count == nsend);
 
   if (mpi_cartsz[X] == 1) {
-    memcpy(recvback, sendforw, nsend*sizeof(double));
-    memcpy(recvforw, sendback, nsend*sizeof(double));
+    memcpy(recvback, sendforw, nsend*sizeof(lb_data_t));
+    memcpy(recvforw, sendback, nsend*sizeof(lb_data_t));
   }
   else {
 
     pforw = cs_cart_neighb(lb->cs, CS_FORW, X);
     pback = cs_cart_neighb(lb->cs, CS_BACK, X);
 
-    MPI_Irecv(recvforw, nsend, MPI_DOUBLE, pforw, tagb, comm, request);
-    MPI_Irecv(recvback, nsend, MPI_DOUBLE, pback, tagf, comm, request + 1);
+    MPI_Irecv(recvforw, nsend, MPI_LB_DATA, pforw, tagb, comm, request);
+    MPI_Irecv(recvback, nsend, MPI_LB_DATA, pback, tagf, comm, request + 1);
 
-    MPI_Issend(sendback, nsend, MPI_DOUBLE, pback, tagb, comm, request + 2);
-    MPI_Issend(sendforw, nsend, MPI_DOUBLE, pforw, tagf, comm, request + 3);
+    MPI_Issend(sendback, nsend, MPI_LB_DATA, pback, tagb, comm, request + 2);
+    MPI_Issend(sendforw, nsend, MPI_LB_DATA, pforw, tagf, comm, request + 3);
 
     /* Wait for receives */
     MPI_Waitall(2, request, status);
@@ -1714,10 +2026,10 @@ __host__ int lb_halo_via_copy(lb_t * lb) {
   /* The y-direction (XZ plane) */
 
   nsend = NVEL*lb->ndist*(nlocal[X] + 2)*nlocal[Z];
-  sendforw = (double *) malloc(nsend*sizeof(double));
-  sendback = (double *) malloc(nsend*sizeof(double));
-  recvforw = (double *) malloc(nsend*sizeof(double));
-  recvback = (double *) malloc(nsend*sizeof(double));
+  sendforw = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  sendback = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  recvforw = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  recvback = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
   if (sendforw == NULL) pe_fatal(lb->pe, "malloc(sendforw) failed\n");
   if (sendback == NULL) pe_fatal(lb->pe, "malloc(sendback) failed\n");
   if (recvforw == NULL) pe_fatal(lb->pe, "malloc(recvforw) failed\n");
@@ -1745,19 +2057,19 @@ __host__ int lb_halo_via_copy(lb_t * lb) {
 
 
   if (mpi_cartsz[Y] == 1) {
-    memcpy(recvback, sendforw, nsend*sizeof(double));
-    memcpy(recvforw, sendback, nsend*sizeof(double));
+    memcpy(recvback, sendforw, nsend*sizeof(lb_data_t));
+    memcpy(recvforw, sendback, nsend*sizeof(lb_data_t));
   }
   else {
 
     pforw = cs_cart_neighb(lb->cs, CS_FORW, Y);
     pback = cs_cart_neighb(lb->cs, CS_BACK, Y);
 
-    MPI_Irecv(recvforw, nsend, MPI_DOUBLE, pforw, tagb, comm, request);
-    MPI_Irecv(recvback, nsend, MPI_DOUBLE, pback, tagf, comm, request + 1);
+    MPI_Irecv(recvforw, nsend, MPI_LB_DATA, pforw, tagb, comm, request);
+    MPI_Irecv(recvback, nsend, MPI_LB_DATA, pback, tagf, comm, request + 1);
 
-    MPI_Issend(sendback, nsend, MPI_DOUBLE, pback, tagb, comm, request + 2);
-    MPI_Issend(sendforw, nsend, MPI_DOUBLE, pforw, tagf, comm, request + 3);
+    MPI_Issend(sendback, nsend, MPI_LB_DATA, pback, tagb, comm, request + 2);
+    MPI_Issend(sendforw, nsend, MPI_LB_DATA, pforw, tagf, comm, request + 3);
 
     /* Wait of receives */
     MPI_Waitall(2, request, status);
@@ -1796,10 +2108,10 @@ __host__ int lb_halo_via_copy(lb_t * lb) {
   /* Finally, z-direction (XY plane) */
 
   nsend = NVEL*lb->ndist*(nlocal[X] + 2)*(nlocal[Y] + 2);
-  sendforw = (double *) malloc(nsend*sizeof(double));
-  sendback = (double *) malloc(nsend*sizeof(double));
-  recvforw = (double *) malloc(nsend*sizeof(double));
-  recvback = (double *) malloc(nsend*sizeof(double));
+  sendforw = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  sendback = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  recvforw = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
+  recvback = (lb_data_t *) malloc(nsend*sizeof(lb_data_t));
   if (sendforw == NULL) pe_fatal(lb->pe, "malloc(sendforw) failed\n");
   if (sendback == NULL) pe_fatal(lb->pe, "malloc(sendback) failed\n");
   if (recvforw == NULL) pe_fatal(lb->pe, "malloc(recvforw) failed\n");
@@ -1826,19 +2138,19 @@ __host__ int lb_halo_via_copy(lb_t * lb) {
   assert(count == nsend);
 
   if (mpi_cartsz[Z] == 1) {
-    memcpy(recvback, sendforw, nsend*sizeof(double));
-    memcpy(recvforw, sendback, nsend*sizeof(double));
+    memcpy(recvback, sendforw, nsend*sizeof(lb_data_t));
+    memcpy(recvforw, sendback, nsend*sizeof(lb_data_t));
   }
   else {
 
     pforw = cs_cart_neighb(lb->cs, CS_FORW, Z);
     pback = cs_cart_neighb(lb->cs, CS_BACK, Z);
 
-    MPI_Irecv(recvforw, nsend, MPI_DOUBLE, pforw, tagb, comm, request);
-    MPI_Irecv(recvback, nsend, MPI_DOUBLE, pback, tagf, comm, request + 1);
+    MPI_Irecv(recvforw, nsend, MPI_LB_DATA, pforw, tagb, comm, request);
+    MPI_Irecv(recvback, nsend, MPI_LB_DATA, pback, tagf, comm, request + 1);
 
-    MPI_Issend(sendback, nsend, MPI_DOUBLE, pback, tagb, comm, request + 2);
-    MPI_Issend(sendforw, nsend, MPI_DOUBLE, pforw, tagf, comm, request + 3);
+    MPI_Issend(sendback, nsend, MPI_LB_DATA, pback, tagb, comm, request + 2);
+    MPI_Issend(sendforw, nsend, MPI_LB_DATA, pforw, tagf, comm, request + 3);
 
     /* Wait for receives */
     MPI_Waitall(2, request, status);
@@ -1876,3 +2188,588 @@ __host__ int lb_halo_via_copy(lb_t * lb) {
  
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  lb_halo_reverse
+ *
+ *  For a push (fused collision-propagation) update, distributions
+ *  leaving the local domain are written to the first halo layer.
+ *  These must be returned to the appropriate (interior) site on
+ *  the neighbouring process, which is the reverse of a normal halo
+ *  swap: only those velocities pointing out of the domain are sent,
+ *  and the halo region is the source rather than the destination.
+ *
+ *  The order Z, Y, X (with the extent of the plane decreasing) means
+ *  that values pushed to edges and corners are forwarded correctly
+ *  to their final destination via more than one step.
+ *
+ *  Host only.
+ *
+ *****************************************************************************/
+
+__host__ int lb_halo_reverse(lb_t * lb) {
+
+  int ic, jc, kc;
+  int n, m;
+  int id, dim;
+  int pforw, pback;
+  int index;
+  int nsend, count;
+  int nv;
+  int pvlo[NVEL], pvhi[NVEL];
+  int nlocal[3];
+  int mpi_cartsz[3];
+  int imin[3], imax[3];
+
+  const int tagf = 902;
+  const int tagb = 903;
+  const int order[3] = {Z, Y, X};
+
+  lb_data_t * sendforw;
+  lb_data_t * sendback;
+  lb_data_t * recvforw;
+  lb_data_t * recvback;
+
+  MPI_Request request[4];
+  MPI_Status status[4];
+  MPI_Comm comm;
+
+  assert(lb);
+
+  cs_nlocal(lb->cs, nlocal);
+  cs_cart_comm(lb->cs, &comm);
+  cs_cartsz(lb->cs, mpi_cartsz);
+
+  /* Buffers are allocated once, on first use, for the largest plane */
+
+  if (lb->reverse == NULL) {
+    for (dim = 0; dim < 3; dim++) {
+      nv = lb_halo_reverse_plane(lb, dim, imin, imax, pvlo, pvhi);
+      nsend = nv*lb->ndist*(imax[X] - imin[X] + 1)*(imax[Y] - imin[Y] + 1)
+	*(imax[Z] - imin[Z] + 1);
+      if (nsend > lb->nreverse) lb->nreverse = nsend;
+    }
+    lb->reverse = (lb_data_t *) malloc(4*lb->nreverse*sizeof(lb_data_t));
+    if (lb->reverse == NULL) pe_fatal(lb->pe, "malloc(lb->reverse) failed\n");
+  }
+
+  sendforw = lb->reverse;
+  sendback = lb->reverse + lb->nreverse;
+  recvforw = lb->reverse + 2*lb->nreverse;
+  recvback = lb->reverse + 3*lb->nreverse;
+
+  for (id = 0; id < 3; id++) {
+
+    dim = order[id];
+
+    nv = lb_halo_reverse_plane(lb, dim, imin, imax, pvlo, pvhi);
+    if (nv == 0) continue;
+
+    nsend = nv*lb->ndist*(imax[X] - imin[X] + 1)*(imax[Y] - imin[Y] + 1)
+      *(imax[Z] - imin[Z] + 1);
+    assert(nsend <= lb->nreverse);
+
+    /* Pack from the halo planes 0 and nlocal + 1 */
+
+    count = 0;
+    for (m = 0; m < nv; m++) {
+      for (n = 0; n < lb->ndist; n++) {
+	for (ic = imin[X]; ic <= imax[X]; ic++) {
+	  for (jc = imin[Y]; jc <= imax[Y]; jc++) {
+	    for (kc = imin[Z]; kc <= imax[Z]; kc++) {
+
+	      index = cs_index(lb->cs, ic, jc, kc);
+	      sendback[count]
+		= lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, pvlo[m])];
+
+	      index = cs_index(lb->cs, ic + (dim == X)*(nlocal[X] + 1),
+			       jc + (dim == Y)*(nlocal[Y] + 1),
+			       kc + (dim == Z)*(nlocal[Z] + 1));
+	      sendforw[count]
+		= lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, pvhi[m])];
+	      ++count;
+	    }
+	  }
+	}
+      }
+    }
+    assert(count == nsend);
+
+    if (mpi_cartsz[dim] == 1) {
+      memcpy(recvback, sendforw, nsend*sizeof(lb_data_t));
+      memcpy(recvforw, sendback, nsend*sizeof(lb_data_t));
+    }
+    else {
+
+      pforw = cs_cart_neighb(lb->cs, CS_FORW, dim);
+      pback = cs_cart_neighb(lb->cs, CS_BACK, dim);
+
+      MPI_Irecv(recvforw, nsend, MPI_LB_DATA, pforw, tagb, comm, request);
+      MPI_Irecv(recvback, nsend, MPI_LB_DATA, pback, tagf, comm, request + 1);
+
+      MPI_Issend(sendback, nsend, MPI_LB_DATA, pback, tagb, comm, request + 2);
+      MPI_Issend(sendforw, nsend, MPI_LB_DATA, pforw, tagf, comm, request + 3);
+
+      /* Wait for receives */
+      MPI_Waitall(2, request, status);
+    }
+
+    /* Unpack to the interior planes nlocal and 1, respectively */
+
+    count = 0;
+    for (m = 0; m < nv; m++) {
+      for (n = 0; n < lb->ndist; n++) {
+	for (ic = imin[X]; ic <= imax[X]; ic++) {
+	  for (jc = imin[Y]; jc <= imax[Y]; jc++) {
+	    for (kc = imin[Z]; kc <= imax[Z]; kc++) {
+
+	      index = cs_index(lb->cs, ic + (dim == X)*nlocal[X],
+			       jc + (dim == Y)*nlocal[Y],
+			       kc + (dim == Z)*nlocal[Z]);
+	      lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, pvlo[m])]
+		= recvforw[count];
+
+	      index = cs_index(lb->cs, ic + (dim == X), jc + (dim == Y),
+			       kc + (dim == Z));
+	      lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, pvhi[m])]
+		= recvback[count];
+	      ++count;
+	    }
+	  }
+	}
+      }
+    }
+    assert(count == nsend);
+
+    if (mpi_cartsz[dim] > 1) {
+      /* Wait for sends */
+      MPI_Waitall(2, request + 2, status);
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_halo_reverse_plane
+ *
+ *  For lb_halo_reverse() in direction dim: the extent of the halo
+ *  plane (halo included in directions not yet treated), and the
+ *  velocities leaving via the low (pvlo) and high (pvhi) halo.
+ *  Returns the number of velocities in each direction.
+ *
+ *****************************************************************************/
+
+static int lb_halo_reverse_plane(lb_t * lb, int dim, int imin[3],
+				 int imax[3], int pvlo[NVEL], int pvhi[NVEL]) {
+  int m, p;
+  int nvlo = 0;
+  int nvhi = 0;
+  int nlocal[3];
+
+  assert(lb);
+
+  cs_nlocal(lb->cs, nlocal);
+
+  for (p = 0; p < NVEL; p++) {
+    if (lb->param->cv[p][dim] == -1) pvlo[nvlo++] = p;
+    if (lb->param->cv[p][dim] == +1) pvhi[nvhi++] = p;
+  }
+  assert(nvlo == nvhi);
+
+  for (m = 0; m < 3; m++) {
+    imin[m] = 1;
+    imax[m] = nlocal[m];
+  }
+  if (dim == Z) {
+    imin[X] = 0; imax[X] = nlocal[X] + 1;
+    imin[Y] = 0; imax[Y] = nlocal[Y] + 1;
+  }
+  if (dim == Y) {
+    imin[X] = 0; imax[X] = nlocal[X] + 1;
+  }
+  imin[dim] = 0;
+  imax[dim] = 0;
+
+  return nvlo;
+}
+
+/*****************************************************************************
+ *
+ *  lb_f_addr
+ *
+ *  Storage address of the 'natural' distribution f_p at site index.
+ *
+ *  With AA-pattern propagation, the storage alternates between the
+ *  natural layout (parity 0) and the swapped layout (parity 1) in
+ *  which f_p(x) is held at x - c_p in the slot for the opposite
+ *  velocity. The natural view is then not available at sites in the
+ *  outermost halo layer (x - c_p is off the lattice), and callers,
+ *  e.g., bounce-back and the colloid rebuild, must not ask for it.
+ *
+ *****************************************************************************/
+
+static __host__ __device__ int lb_f_addr(lb_t * lb, int index, int n, int p) {
+
+  int iaddr = index;
+  int paddr = p;
+
+  if (lb->param->parity) {
+    assert(lb_f_addr_valid(lb, index, p));
+    iaddr = index - lb->param->ndisp[p];
+    paddr = (NVEL - p) % NVEL;
+  }
+
+  return LB_ADDR(lb->nsite, lb->ndist, NVEL, iaddr, n, paddr);
+}
+
+#ifndef NDEBUG
+/*****************************************************************************
+ *
+ *  lb_f_addr_valid
+ *
+ *  Is x - c_p, for site x = index, on the local lattice (with halo)?
+ *
+ *****************************************************************************/
+
+static __host__ __device__ int lb_f_addr_valid(lb_t * lb, int index, int p) {
+
+  int ia;
+  int nhalo;
+  int nlocal[3];
+  int coords[3];
+  int valid = 1;
+
+  cs_nhalo(lb->cs, &nhalo);
+  cs_nlocal(lb->cs, nlocal);
+  cs_index_to_ijk(lb->cs, index, coords);
+
+  for (ia = 0; ia < 3; ia++) {
+    coords[ia] -= lb->param->cv[p][ia];
+    if (coords[ia] < 1 - nhalo || coords[ia] > nlocal[ia] + nhalo) valid = 0;
+  }
+
+  return valid;
+}
+#endif
+
+/*****************************************************************************
+ *
+ *  lb_aa_set
+ *
+ *  Select AA-pattern (in-place) propagation. This must occur
+ *  between create() and init(), as no fprime buffer is allocated.
+ *
+ *****************************************************************************/
+
+__host__ int lb_aa_set(lb_t * lb, int isaa) {
+
+  assert(lb);
+  assert(lb->f == NULL); /* don't change after initialisation */
+  assert(lb->ndist == 1 || isaa == 0);
+
+  lb->param->isaa = isaa;
+  lb->param->parity = 0;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_aa
+ *
+ *****************************************************************************/
+
+__host__ int lb_aa(lb_t * lb, int * isaa) {
+
+  assert(lb);
+  assert(isaa);
+
+  *isaa = lb->param->isaa;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_aa_parity
+ *
+ *  Current storage layout: 0 natural, 1 swapped.
+ *
+ *****************************************************************************/
+
+__host__ int lb_aa_parity(lb_t * lb, int * parity) {
+
+  assert(lb);
+  assert(parity);
+
+  *parity = lb->param->parity;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_f_link
+ *
+ *  Post-collision (pre-propagation) distribution leaving site i with
+ *  velocity p for neighbour j = i + c_p. This is intended for
+ *  bounce-back on links, which sits between collision and propagation
+ *  in the standard scheme. Where propagation has been fused with the
+ *  collision, the value has already been moved to site j.
+ *
+ *****************************************************************************/
+
+__host__ __device__
+int lb_f_link(lb_t * lb, int i, int j, int p, int n, double * f) {
+
+  int iaddr;
+
+  assert(lb);
+  assert(i >= 0 && i < lb->nsite);
+  assert(j >= 0 && j < lb->nsite);
+  assert(p >= 0 && p < NVEL);
+  assert(n >= 0 && n < lb->ndist);
+
+  if (lb->param->isfused || (lb->param->isaa && lb->param->parity == 0)) {
+    iaddr = LB_ADDR(lb->nsite, lb->ndist, NVEL, j, n, p);
+  }
+  else if (lb->param->isaa) {
+    iaddr = LB_ADDR(lb->nsite, lb->ndist, NVEL, i, n, (NVEL - p) % NVEL);
+  }
+  else {
+    iaddr = LB_ADDR(lb->nsite, lb->ndist, NVEL, i, n, p);
+  }
+
+  *f = lb->f[iaddr] + LB_FSHIFT(lb->param, n, p);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_f_link_set
+ *
+ *  See lb_f_link() above.
+ *
+ *****************************************************************************/
+
+__host__ __device__
+int lb_f_link_set(lb_t * lb, int i, int j, int p, int n, double f) {
+
+  int iaddr;
+
+  assert(lb);
+  assert(i >= 0 && i < lb->nsite);
+  assert(j >= 0 && j < lb->nsite);
+  assert(p >= 0 && p < NVEL);
+  assert(n >= 0 && n < lb->ndist);
+
+  if (lb->param->isfused || (lb->param->isaa && lb->param->parity == 0)) {
+    iaddr = LB_ADDR(lb->nsite, lb->ndist, NVEL, j, n, p);
+  }
+  else if (lb->param->isaa) {
+    iaddr = LB_ADDR(lb->nsite, lb->ndist, NVEL, i, n, (NVEL - p) % NVEL);
+  }
+  else {
+    iaddr = LB_ADDR(lb->nsite, lb->ndist, NVEL, i, n, p);
+  }
+
+  lb->f[iaddr] = f - LB_FSHIFT(lb->param, n, p);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_aa_natural
+ *
+ *  If the AA storage is currently in the swapped layout, return it
+ *  to the natural layout at all local sites. The halo is not valid
+ *  on return, so the caller is responsible for a halo swap.
+ *
+ *  For each pair p, pbar = NVEL - p, the natural values are
+ *
+ *    f_p(x) = F_pbar(x - c_p),  f_pbar(x) = F_p(x + c_p).
+ *
+ *****************************************************************************/
+
+__host__ int lb_aa_natural(lb_t * lb) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  int ndevice;
+  int n, p, pbar;
+  lb_data_t * fp = NULL;
+  lb_data_t * fpbar = NULL;
+
+  assert(lb);
+
+  if (lb->param->isaa == 0 || lb->param->parity == 0) return 0;
+
+  tdpGetDeviceCount(&ndevice);
+  if (ndevice > 0) pe_fatal(lb->pe, "lb_aa_natural() host only\n");
+
+  cs_nlocal(lb->cs, nlocal);
+
+  /* Buffers are allocated once, on first use */
+
+  if (lb->natural == NULL) {
+    lb->natural = (lb_data_t *) malloc(2*lb->nsite*sizeof(lb_data_t));
+    if (lb->natural == NULL) pe_fatal(lb->pe, "malloc(lb->natural) failed\n");
+  }
+
+  fp = lb->natural;
+  fpbar = lb->natural + lb->nsite;
+
+  for (n = 0; n < lb->ndist; n++) {
+    for (p = 1; p < NVEL; p++) {
+
+      pbar = NVEL - p;
+      if (pbar < p) continue;
+
+      for (index = 0; index < lb->nsite; index++) {
+	fp[index] = lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)];
+	fpbar[index] = lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, pbar)];
+      }
+
+      for (ic = 1; ic <= nlocal[X]; ic++) {
+	for (jc = 1; jc <= nlocal[Y]; jc++) {
+	  for (kc = 1; kc <= nlocal[Z]; kc++) {
+	    index = cs_index(lb->cs, ic, jc, kc);
+	    lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, p)]
+	      = fpbar[index - lb->param->ndisp[p]];
+	    lb->f[LB_ADDR(lb->nsite, lb->ndist, NVEL, index, n, pbar)]
+	      = fp[index + lb->param->ndisp[p]];
+	  }
+	}
+      }
+    }
+  }
+
+  lb->param->parity = 0;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_sparse_set
+ *
+ *  Skip solid chunks. Compute the list of kernel vector indices (in
+ *  the sense of kernel_ctxt_t over the local domain) which contain at
+ *  least one fluid site, or one site with a fluid neighbour. The
+ *  collision and propagation then visit only these chunks, so the
+ *  compute cost of a step scales with the fluid volume.
+ *
+ *  This is not a compact (fluid-only) store: the distributions, and
+ *  so the memory, remain dense and scale with the box volume. The
+ *  neighbours are still at fixed displacements ndisp[p], and the
+ *  halo swaps, bounce-back and I/O are unchanged. Sites not in the
+ *  list are left as they are; they are not seen by any fluid site.
+ *
+ *  The list is only valid while the map is unchanged, so colloids
+ *  are not allowed: it is an error if the map has colloid sites, or
+ *  if there are colloids at the time of the first colloid update
+ *  (see ludwig.c).
+ *
+ *****************************************************************************/
+
+__host__ int lb_sparse_set(lb_t * lb, map_t * map) {
+
+  int ndevice;
+  int nlocal[3];
+  int kindex, kiter;
+  int iv, p, status;
+  int ncolloid = 0;
+  int * tmp = NULL;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+
+  assert(lb);
+  assert(map);
+
+  cs_nlocal(lb->cs, nlocal);
+
+  map_volume_allreduce(map, MAP_COLLOID, &ncolloid);
+
+  if (ncolloid > 0) {
+    pe_fatal(lb->pe, "lb_sparse_set: map has colloid sites; the list of "
+	     "fluid chunks requires a fixed map (no colloids)\n");
+  }
+
+  limits.imin = 1; limits.imax = nlocal[X];
+  limits.jmin = 1; limits.jmax = nlocal[Y];
+  limits.kmin = 1; limits.kmax = nlocal[Z];
+
+  kernel_ctxt_create(lb->cs, NSIMDVL, limits, &ctxt);
+  kiter = kernel_vector_iterations(ctxt);
+
+  if (lb->sparse) free(lb->sparse);
+  lb->sparse = (int *) malloc((kiter/NSIMDVL + 1)*sizeof(int));
+  if (lb->sparse == NULL) pe_fatal(lb->pe, "malloc(lb->sparse) failed\n");
+  lb->nsparse = 0;
+
+  for (kindex = 0; kindex < kiter; kindex += NSIMDVL) {
+
+    int index0;
+    int isfluid = 0;
+    int ic[NSIMDVL];
+    int jc[NSIMDVL];
+    int kc[NSIMDVL];
+    int maskv[NSIMDVL];
+
+    kernel_coords_v(ctxt, kindex, ic, jc, kc);
+    kernel_mask_v(ctxt, ic, jc, kc, maskv);
+    index0 = kernel_baseindex(ctxt, kindex);
+
+    for (iv = 0; iv < NSIMDVL; iv++) {
+      if (maskv[iv] == 0) continue;
+      for (p = 0; p < NVEL; p++) {
+	map_status(map, index0 + iv + lb->param->ndisp[p], &status);
+	if (status == MAP_FLUID) isfluid = 1;
+      }
+    }
+
+    if (isfluid) lb->sparse[lb->nsparse++] = kindex;
+  }
+
+  kernel_ctxt_free(ctxt);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    tdpMemcpy(&tmp, &lb->target->sparse, sizeof(int *),
+	      tdpMemcpyDeviceToHost);
+    if (tmp) tdpFree(tmp);
+    tdpMalloc((void **) &tmp, (lb->nsparse + 1)*sizeof(int));
+    tdpMemcpy(tmp, lb->sparse, lb->nsparse*sizeof(int),
+	      tdpMemcpyHostToDevice);
+    tdpMemcpy(&lb->target->sparse, &tmp, sizeof(int *),
+	      tdpMemcpyHostToDevice);
+    tdpMemcpy(&lb->target->nsparse, &lb->nsparse, sizeof(int),
+	      tdpMemcpyHostToDevice);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  lb_sparse
+ *
+ *  Number of entries in the sparse list (zero if dense).
+ *
+ *****************************************************************************/
+
+__host__ int lb_sparse(lb_t * lb, int * nsparse) {
+
+  assert(lb);
+  assert(nsparse);
+
+  *nsparse = lb->nsparse;
+
+  return 0;
+}
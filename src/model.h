@@ -58,6 +58,8 @@ enum {NDIM     = NDIM19,
 #include "coords.h"
 #include "io_harness.h"
 #include "memory.h"
+#include "map.h"
+#include "site_sync.h"
 
 /* Number of hydrodynamic modes */
 enum {NHYDRO = 1 + NDIM + NDIM*(NDIM+1)/2};
@@ -88,13 +90,27 @@ __host__ int lb_create(pe_t * pe, cs_t * cs, lb_t ** lb);
 __host__ int lb_init(lb_t * lb);
 __host__ int lb_free(lb_t * lb);
 __host__ int lb_memcpy(lb_t * lb, tdpMemcpyKind flag);
+__host__ int lb_memcpy_sites(lb_t * lb, site_sync_t * sites,
+			     tdpMemcpyKind flag);
+__host__ int lb_sync_site(lb_t * lb, int index);
+__host__ int lb_sync(lb_t * lb);
 __host__ int lb_collide_param_commit(lb_t * lb);
 __host__ int lb_halo(lb_t * lb);
+__host__ int lb_halo_start(lb_t * lb);
+__host__ int lb_halo_finish(lb_t * lb);
 __host__ int lb_halo_swap(lb_t * lb, lb_halo_enum_t flag);
 __host__ int lb_halo_via_copy(lb_t * lb);
 __host__ int lb_halo_via_struct(lb_t * lb);
+__host__ int lb_halo_reverse(lb_t * lb);
+__host__ int lb_aa_set(lb_t * lb, int isaa);
+__host__ int lb_aa(lb_t * lb, int * isaa);
+__host__ int lb_aa_parity(lb_t * lb, int * parity);
+__host__ int lb_aa_natural(lb_t * lb);
+__host__ int lb_sparse_set(lb_t * lb, map_t * map);
+__host__ int lb_sparse(lb_t * lb, int * nsparse);
 __host__ int lb_halo_set(lb_t * lb, lb_halo_enum_t halo);
 __host__ int lb_io_info(lb_t * lb, io_info_t ** io_info);
+__host__ int lb_io_rho(lb_t * lb, io_info_t ** io_rho);
 __host__ int lb_io_info_set(lb_t * lb, io_info_t * io_info, int fin, int fout);
 __host__ int lb_io_rho_set(lb_t *lb, io_info_t * io_rho, int fin, int fout);
 
@@ -103,6 +119,10 @@ __host__ __device__ int lb_ndim(lb_t * lb, int * ndim);
 __host__ __device__ int lb_ndist(lb_t * lb, int * ndist);
 __host__ __device__ int lb_f(lb_t * lb, int index, int p, int n, double * f);
 __host__ __device__ int lb_f_set(lb_t * lb, int index, int p, int n, double f);
+__host__ __device__ int lb_f_link(lb_t * lb, int i, int j, int p, int n,
+				  double * f);
+__host__ __device__ int lb_f_link_set(lb_t * lb, int i, int j, int p, int n,
+				      double f);
 __host__ __device__ int lb_0th_moment(lb_t * lb, int index, lb_dist_enum_t nd,
 				      double * rho);
 __host__ __device__ int lb_f_index(lb_t * lb, int index, int n, double f[NVEL]);
@@ -277,7 +277,8 @@ static int le_reproject_all(lb_t * lb, lees_edw_t * le) {
 	  for (m = 0; m < NVEL; m++) {
 	    mode[m] = 0.0;
 	    for (p = 0; p < NVEL; p++) {
-	      mode[m] += lb->f[ndist*NVEL*index + 0 + p]*ma_[m][p];
+	      mode[m] += (lb->f[ndist*NVEL*index + 0 + p]
+			  + LB_FSHIFT(lb->param, LB_RHO, p))*ma_[m][p];
 	    }
 	  }
 
@@ -298,11 +299,12 @@ static int le_reproject_all(lb_t * lb, lees_edw_t * le) {
 	  /* Reproject */
 
 	  for (np = 0; np < xblocklen_cv[0]; np++) {
+	    double ftmp = 0.0;
 	    p = poffset + np;
-	    lb->f[ndist*NVEL*index + 0 + p] = 0.0;
 	    for (m = 0; m < NVEL; m++) {
-	      lb->f[ndist*NVEL*index + 0 + p] += mode[m]*mi_[p][m];
+	      ftmp += mode[m]*mi_[p][m];
 	    }
+	    lb->f[ndist*NVEL*index + 0 + p] = ftmp - LB_FSHIFT(lb->param, LB_RHO, p);
 	  }
 
 	  /* next site */
@@ -40,6 +40,8 @@
 
 static int noise_write(FILE * fp, int index, void * self);
 static int noise_read(FILE * fp, int index, void * self);
+static int noise_pack(void * self, char * buf);
+static int noise_unpack(void * self, char * buf);
 
 /*****************************************************************************
  *
@@ -312,6 +314,7 @@ __host__ int noise_init_io_info(noise_t * obj, int grid[3], int form_in,
   io_info_write_set(obj->info, IO_FORMAT_ASCII, noise_write);
   io_info_read_set(obj->info, IO_FORMAT_BINARY, noise_read);
   io_info_read_set(obj->info, IO_FORMAT_ASCII, noise_read);
+  io_info_pack_set(obj->info, noise_pack, noise_unpack);
   io_info_set_bytesize(obj->info, IO_FORMAT_BINARY,
 		       NNOISE_STATE*sizeof(unsigned int));
 
@@ -530,6 +533,42 @@ static int noise_read(FILE * fp, int index, void * self) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  noise_pack
+ *
+ *  Bulk binary equivalent of noise_write() for all local sites.
+ *
+ *****************************************************************************/
+
+static int noise_pack(void * self, char * buf) {
+
+  noise_t * obj = (noise_t *) self;
+
+  assert(obj);
+
+  return io_pack_rank1(obj->cs, obj->nsites, NNOISE_STATE,
+		       sizeof(unsigned int), obj->state,
+		       NNOISE_STATE*sizeof(unsigned int), 0, buf);
+}
+
+/*****************************************************************************
+ *
+ *  noise_unpack
+ *
+ *****************************************************************************/
+
+static int noise_unpack(void * self, char * buf) {
+
+  noise_t * obj = (noise_t *) self;
+
+  assert(obj);
+
+  return io_unpack_rank1(obj->cs, obj->nsites, NNOISE_STATE,
+			 sizeof(unsigned int), obj->state,
+			 NNOISE_STATE*sizeof(unsigned int), 0, buf);
+}
+
 /*****************************************************************************
  *
  *  noise_present
@@ -32,6 +32,8 @@
 #include "util.h"
 #include "coords.h"
 #include "colloids.h"
+#include "colloids_nlist.h"
+#include "colloids_soa.h"
 #include "pair_lj_cut.h"
 
 struct pair_lj_cut_s {
@@ -45,6 +47,10 @@ struct pair_lj_cut_s {
   double rminlocal;
 };
 
+static int pair_lj_cut_pair(pair_lj_cut_t * obj, colloids_soa_t * soa,
+			    int i, int j, double vcut, double dvcut,
+			    double rh[2], double * v, double f[3]);
+
 /*****************************************************************************
  *
  *  pair_lj_cut_create
@@ -143,34 +149,38 @@ int pair_lj_cut_register(pair_lj_cut_t * obj, interact_t * parent) {
  *
  *  pair_lj_cut_compute
  *
+ *  Pairs are taken from the neighbour list, if present, otherwise
+ *  from the cell list.
+ *
  *****************************************************************************/
 
 int pair_lj_cut_compute(colloids_info_t * cinfo, void * self) {
 
   pair_lj_cut_t * obj = (pair_lj_cut_t *) self;
 
+  int n, i, j;
+  int c1, c2;
   int ic1, jc1, kc1, ic2, jc2, kc2;
   int di[2], dj[2], dk[2];
   int ncell[3];
 
-  double r2;
-  double r;
   double rr;
   double rs;
   double vcut;
   double dvcut;
-  double r12[3];
-  double f, h;
   double ltot[3];
+  double rh[2], v, f[3];
 
-  colloid_t * pc1;
-  colloid_t * pc2;
+  colloids_nlist_t * nlist = NULL;
+  colloids_soa_t * soa = NULL;
 
   assert(cinfo);
   assert(self);
 
   cs_ltot(obj->cs, ltot);
   colloids_info_ncell(cinfo, ncell);
+  colloids_info_nlist(cinfo, &nlist);
+  colloids_info_soa(cinfo, &soa);
 
   obj->vlocal = 0.0;
   obj->rminlocal = dmax(ltot[X], dmax(ltot[Y], ltot[Z]));
@@ -182,6 +192,34 @@ int pair_lj_cut_compute(colloids_info_t * cinfo, void * self) {
   vcut = 4.0*obj->epsilon*(rs*rs - rs);
   dvcut = -24.0*rr*obj->epsilon*(2.0*rs*rs - rs);
 
+  if (nlist) {
+    /* Pairs are independent, and are added to the store in order */
+    double rmin = obj->rminlocal;
+    double hmin = obj->hminlocal;
+
+    assert(soa->nbuild == nlist->soabuild);
+    colloids_soa_gather(soa);
+
+    tdp_host_omp(parallel for private(rh, f) reduction(min: rmin, hmin))
+    for (n = 0; n < nlist->npair; n++) {
+      pair_lj_cut_pair(obj, soa, nlist->i1[n], nlist->i2[n], vcut, dvcut,
+		       rh, nlist->vpair + n, f);
+      nlist->fpair[X][n] = f[X];
+      nlist->fpair[Y][n] = f[Y];
+      nlist->fpair[Z][n] = f[Z];
+      rmin = dmin(rmin, rh[0]);
+      hmin = dmin(hmin, rh[1]);
+    }
+
+    obj->rminlocal = rmin;
+    obj->hminlocal = hmin;
+    colloids_nlist_pair_sum(nlist, soa, &obj->vlocal);
+    colloids_soa_scatter(soa);
+    return 0;
+  }
+
+  colloids_soa_build(soa, cinfo);
+
   for (ic1 = 1; ic1 <= ncell[X]; ic1++) {
     colloids_info_climits(cinfo, X, ic1, di); 
     for (jc1 = 1; jc1 <= ncell[Y]; jc1++) {
@@ -189,54 +227,89 @@ int pair_lj_cut_compute(colloids_info_t * cinfo, void * self) {
       for (kc1 = 1; kc1 <= ncell[Z]; kc1++) {
         colloids_info_climits(cinfo, Z, kc1, dk);
 
-        colloids_info_cell_list_head(cinfo, ic1, jc1, kc1, &pc1);
-        for (; pc1; pc1 = pc1->next) {
+        c1 = colloids_info_cell_index(cinfo, ic1, jc1, kc1);
+        for (i = soa->cstart[c1]; i < soa->cstart[c1 + 1]; i++) {
 
           for (ic2 = di[0]; ic2 <= di[1]; ic2++) {
             for (jc2 = dj[0]; jc2 <= dj[1]; jc2++) {
               for (kc2 = dk[0]; kc2 <= dk[1]; kc2++) {
    
-                colloids_info_cell_list_head(cinfo, ic2, jc2, kc2, &pc2);
-                for (; pc2; pc2 = pc2->next) {
+                c2 = colloids_info_cell_index(cinfo, ic2, jc2, kc2);
+                for (j = soa->cstart[c2]; j < soa->cstart[c2 + 1]; j++) {
+
+		  if (soa->index[i] >= soa->index[j]) continue;
+		  pair_lj_cut_pair(obj, soa, i, j, vcut, dvcut, rh, &v, f);
+		  obj->rminlocal = dmin(obj->rminlocal, rh[0]);
+		  obj->hminlocal = dmin(obj->hminlocal, rh[1]);
+		  obj->vlocal += v;
+		  colloids_soa_pair_add(soa, i, j, f);
+		}
+	      }
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  colloids_soa_scatter(soa);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  pair_lj_cut_pair
+ *
+ *  Potential and force for one pair; vcut and dvcut are the potential
+ *  and derivative at the cut off. The force f is that on j (minus f
+ *  on i); rh[0] and rh[1] are the centre-centre and surface-surface
+ *  separations. Nothing is accumulated here.
+ *
+ *****************************************************************************/
 
-		  if (pc1->s.index >= pc2->s.index) continue;
+static int pair_lj_cut_pair(pair_lj_cut_t * obj, colloids_soa_t * soa,
+			    int i, int j, double vcut, double dvcut,
+			    double rh[2], double * v, double f[3]) {
+  double r2;
+  double r;
+  double rr;
+  double rs;
+  double r1[3] = {soa->r[X][i], soa->r[Y][i], soa->r[Z][i]};
+  double rj[3] = {soa->r[X][j], soa->r[Y][j], soa->r[Z][j]};
+  double r12[3];
+  double fr;
 
-		  cs_minimum_distance(obj->cs, pc1->s.r, pc2->s.r, r12);
-		  r2 = r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z];
+  assert(obj);
+  assert(soa);
 
-		  r = sqrt(r2);
+  cs_minimum_distance(obj->cs, r1, rj, r12);
+  r2 = r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z];
 
-		  /* Record both rmin and hmin */
-		  if (r < obj->rminlocal) obj->rminlocal = r;
-		  h = r - pc1->s.ah -pc2->s.ah;
-		  if (h < obj->hminlocal) obj->hminlocal = h;
+  r = sqrt(r2);
 
-		  if (r > obj->rc) continue;
+  /* Record both r and h */
+  rh[0] = r;
+  rh[1] = r - soa->ah[i] -soa->ah[j];
 
-		  rr = 1.0/r;
-		  rs = pow(obj->sigma*rr, 6);
+  *v = 0.0;
+  f[X] = 0.0;
+  f[Y] = 0.0;
+  f[Z] = 0.0;
 
-		  /* Potential, force */
+  if (r > obj->rc) return 0;
 
-		  obj->vlocal += 4.0*obj->epsilon*(rs*rs - rs) - vcut
-		    - (r - obj->rc)*dvcut;
-		  f = -(-24.0*rr*obj->epsilon*(2.0*rs*rs - rs) - dvcut);
+  rr = 1.0/r;
+  rs = pow(obj->sigma*rr, 6);
 
-		  pc1->force[X] -= f*r12[X]*rr;
-		  pc1->force[Y] -= f*r12[Y]*rr;
-		  pc1->force[Z] -= f*r12[Z]*rr;
-		  pc2->force[X] += f*r12[X]*rr;
-		  pc2->force[Y] += f*r12[Y]*rr;
-		  pc2->force[Z] += f*r12[Z]*rr;
+  /* Potential, force */
 
-		}
-	      }
-	    }
-	  }
-	}
-      }
-    }
-  }
+  *v = 4.0*obj->epsilon*(rs*rs - rs) - vcut - (r - obj->rc)*dvcut;
+  fr = -(-24.0*rr*obj->epsilon*(2.0*rs*rs - rs) - dvcut);
+
+  f[X] = fr*r12[X]*rr;
+  f[Y] = fr*r12[Y]*rr;
+  f[Z] = fr*r12[Z]*rr;
 
   return 0;
 }
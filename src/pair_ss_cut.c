@@ -39,6 +39,8 @@
 #include "coords.h"
 #include "physics.h"
 #include "colloids.h"
+#include "colloids_nlist.h"
+#include "colloids_soa.h"
 #include "pair_ss_cut.h"
 
 struct pair_ss_cut_s {
@@ -53,6 +55,10 @@ struct pair_ss_cut_s {
   double rminlocal;      /* local min centre-centre separation */
 };
 
+static int pair_ss_cut_pair(pair_ss_cut_t * self, colloids_soa_t * soa,
+			    int i, int j, double vcut, double dvcut,
+			    double rh[2], double * v, double f[3]);
+
 /*****************************************************************************
  *
  *  pair_ss_cut_create
@@ -160,28 +166,29 @@ int pair_ss_cut_register(pair_ss_cut_t * obj, interact_t * parent) {
  *
  *  pair_ss_cut_compute
  *
+ *  Pairs are taken from the neighbour list, if present, otherwise
+ *  from the cell list.
+ *
  *****************************************************************************/
 
 int pair_ss_cut_compute(colloids_info_t * cinfo, void * obj) {
 
   pair_ss_cut_t * self = (pair_ss_cut_t *) obj;
 
+  int n, i, j;
+  int c1, c2;
   int ic1, jc1, kc1, ic2, jc2, kc2;
   int di[2], dj[2], dk[2];
   int ncell[3];
 
-  double r;                             /* centre-centre sepration */
-  double h;                             /* surface-surface separation */
-  double rh;                            /* reciprocal h */
   double rsigma;                        /* reciproal sigma */
   double vcut;                          /* potential at cut off */
   double dvcut;                         /* derivative at cut off */
-  double r12[3];                        /* centre-centre min distance 1->2 */
-  double f;
   double ltot[3];
+  double rh[2], v, f[3];
 
-  colloid_t * pc1;
-  colloid_t * pc2;
+  colloids_nlist_t * nlist = NULL;
+  colloids_soa_t * soa = NULL;
 
   assert(cinfo);
   assert(self);
@@ -197,6 +204,36 @@ int pair_ss_cut_compute(colloids_info_t * cinfo, void * obj) {
   dvcut = -self->epsilon*self->nu*rsigma*pow(self->sigma/self->hc, self->nu+1);
 
   colloids_info_ncell(cinfo, ncell);
+  colloids_info_nlist(cinfo, &nlist);
+  colloids_info_soa(cinfo, &soa);
+
+  if (nlist) {
+    /* Pairs are independent, and are added to the store in order */
+    double rmin = self->rminlocal;
+    double hmin = self->hminlocal;
+
+    assert(soa->nbuild == nlist->soabuild);
+    colloids_soa_gather(soa);
+
+    tdp_host_omp(parallel for private(rh, f) reduction(min: rmin, hmin))
+    for (n = 0; n < nlist->npair; n++) {
+      pair_ss_cut_pair(self, soa, nlist->i1[n], nlist->i2[n], vcut, dvcut,
+		       rh, nlist->vpair + n, f);
+      nlist->fpair[X][n] = f[X];
+      nlist->fpair[Y][n] = f[Y];
+      nlist->fpair[Z][n] = f[Z];
+      rmin = dmin(rmin, rh[0]);
+      hmin = dmin(hmin, rh[1]);
+    }
+
+    self->rminlocal = rmin;
+    self->hminlocal = hmin;
+    colloids_nlist_pair_sum(nlist, soa, &self->vlocal);
+    colloids_soa_scatter(soa);
+    return 0;
+  }
+
+  colloids_soa_build(soa, cinfo);
 
   for (ic1 = 1; ic1 <= ncell[X]; ic1++) {
     colloids_info_climits(cinfo, X, ic1, di); 
@@ -205,42 +242,22 @@ int pair_ss_cut_compute(colloids_info_t * cinfo, void * obj) {
       for (kc1 = 1; kc1 <= ncell[Z]; kc1++) {
         colloids_info_climits(cinfo, Z, kc1, dk);
 
-        colloids_info_cell_list_head(cinfo, ic1, jc1, kc1, &pc1);
-        for (; pc1; pc1 = pc1->next) {
+        c1 = colloids_info_cell_index(cinfo, ic1, jc1, kc1);
+        for (i = soa->cstart[c1]; i < soa->cstart[c1 + 1]; i++) {
 
           for (ic2 = di[0]; ic2 <= di[1]; ic2++) {
             for (jc2 = dj[0]; jc2 <= dj[1]; jc2++) {
               for (kc2 = dk[0]; kc2 <= dk[1]; kc2++) {
    
-		colloids_info_cell_list_head(cinfo, ic2, jc2, kc2, &pc2);
-                for (; pc2; pc2 = pc2->next) {
-
-                  if (pc1->s.index >= pc2->s.index) continue;
-
-		  cs_minimum_distance(self->cs, pc1->s.r, pc2->s.r, r12);
-		  r = sqrt(r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z]);
-		  if (r < self->rminlocal) self->rminlocal = r;
-
-		  h = r - pc1->s.ah - pc2->s.ah;
-		  if (h < self->hminlocal) self->hminlocal = h;
-
-		  if (h > self->hc) continue;
-		  assert(h > 0.0);
-
-		  rh = 1.0/h;
-
-		  self->vlocal += self->epsilon*pow(rh*self->sigma, self->nu)
-		    - vcut - (h - self->hc)*dvcut;
-		  f = -(-self->epsilon*self->nu*rsigma
-			*pow(rh*self->sigma, self->nu+1) - dvcut);
-
-		  rh = 1.0/r;
-		  pc1->force[X] -= f*r12[X]*rh;
-		  pc1->force[Y] -= f*r12[Y]*rh;
-		  pc1->force[Z] -= f*r12[Z]*rh;
-		  pc2->force[X] += f*r12[X]*rh;
-		  pc2->force[Y] += f*r12[Y]*rh;
-		  pc2->force[Z] += f*r12[Z]*rh;
+                c2 = colloids_info_cell_index(cinfo, ic2, jc2, kc2);
+                for (j = soa->cstart[c2]; j < soa->cstart[c2 + 1]; j++) {
+
+		  if (soa->index[i] >= soa->index[j]) continue;
+		  pair_ss_cut_pair(self, soa, i, j, vcut, dvcut, rh, &v, f);
+		  self->rminlocal = dmin(self->rminlocal, rh[0]);
+		  self->hminlocal = dmin(self->hminlocal, rh[1]);
+		  self->vlocal += v;
+		  colloids_soa_pair_add(soa, i, j, f);
 		}
 	      }
 	    }
@@ -250,6 +267,67 @@ int pair_ss_cut_compute(colloids_info_t * cinfo, void * obj) {
     }
   }
 
+  colloids_soa_scatter(soa);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  pair_ss_cut_pair
+ *
+ *  Potential and force for one pair; vcut and dvcut are the potential
+ *  and derivative at the cut off. The force f is that on j (minus f
+ *  on i); rh[0] and rh[1] are the centre-centre and surface-surface
+ *  separations. Nothing is accumulated here.
+ *
+ *****************************************************************************/
+
+static int pair_ss_cut_pair(pair_ss_cut_t * self, colloids_soa_t * soa,
+			    int i, int j, double vcut, double dvcut,
+			    double rh[2], double * v, double f[3]) {
+
+  double r;                             /* centre-centre sepration */
+  double h;                             /* surface-surface separation */
+  double rrh;                           /* reciprocal h */
+  double rsigma;                        /* reciproal sigma */
+  double r1[3] = {soa->r[X][i], soa->r[Y][i], soa->r[Z][i]};
+  double r2[3] = {soa->r[X][j], soa->r[Y][j], soa->r[Z][j]};
+  double r12[3];                        /* centre-centre min distance 1->2 */
+  double fh;
+
+  assert(self);
+  assert(soa);
+
+  rsigma = 1.0/self->sigma;
+
+  cs_minimum_distance(self->cs, r1, r2, r12);
+  r = sqrt(r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z]);
+  h = r - soa->ah[i] - soa->ah[j];
+
+  rh[0] = r;
+  rh[1] = h;
+
+  *v = 0.0;
+  f[X] = 0.0;
+  f[Y] = 0.0;
+  f[Z] = 0.0;
+
+  if (h > self->hc) return 0;
+  assert(h > 0.0);
+
+  rrh = 1.0/h;
+
+  *v = self->epsilon*pow(rrh*self->sigma, self->nu)
+    - vcut - (h - self->hc)*dvcut;
+  fh = -(-self->epsilon*self->nu*rsigma
+	 *pow(rrh*self->sigma, self->nu+1) - dvcut);
+
+  rrh = 1.0/r;
+  f[X] = fh*r12[X]*rrh;
+  f[Y] = fh*r12[Y]*rrh;
+  f[Z] = fh*r12[Z]*rrh;
+
   return 0;
 }
 
@@ -0,0 +1,582 @@
+/*****************************************************************************
+ *
+ *  perf.c
+ *
+ *  Named, nested performance regions.
+ *
+ *  Unlike the fixed timers of timer.c, regions are registered on
+ *  first use by name, and nest: a region started while another is
+ *  open is recorded as a child, with path "parent/child". E.g.,
+ *
+ *    perf_region_start("collision");
+ *    ... kernel ...
+ *    perf_region_work(nsites, nbytes, nflops);
+ *    perf_region_stop("collision");
+ *
+ *  The work declared (lattice sites updated, bytes moved, floating
+ *  point operations) is nominal, i.e., as counted by the kernel
+ *  driver, and is accumulated with the time. Derived rates (GB/s,
+ *  GFlop/s, MLUPS) are then available in the summary.
+ *
+ *  Statistics are reduced over ranks as the min/mean/max of the
+ *  total time in each region, with the load imbalance max/mean.
+ *  Regions need not be present on all ranks. perf_dump() may be
+ *  called periodically to append the cumulative statistics to a
+ *  CSV or JSON file (one line per dump for JSON).
+ *
+ *  Regions are not thread safe: use from the main thread only.
+ *  All functions are no-ops before perf_init().
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "perf.h"
+
+typedef struct perf_region_s perf_region_t;
+typedef struct perf_stat_s perf_stat_t;
+
+struct perf_region_s {
+  char name[PERF_NAME_MAX];
+  char path[PERF_PATH_MAX];      /* "parent/.../name" */
+  int parent;                    /* Index of parent (-1 at top level) */
+  int ncall;
+  double t_start;
+  double t_sum;
+  double nsites;                 /* Lattice site updates */
+  double nbytes;                 /* Bytes moved */
+  double nflops;                 /* Floating point operations */
+};
+
+/* Reduced statistics (significant at root only) */
+
+struct perf_stat_s {
+  char path[PERF_PATH_MAX];
+  int depth;
+  int ncall;                     /* Maximum over ranks */
+  double tmin;
+  double tmean;
+  double tmax;
+  double nsites;                 /* Sums over ranks */
+  double nbytes;
+  double nflops;
+};
+
+static pe_t * pe_perf = NULL;
+static int nregion = 0;
+static int nregion_alloc = 0;
+static perf_region_t * region = NULL;
+static int nstack = 0;
+static int stack[PERF_DEPTH_MAX];
+
+static int perf_region_find(const char * path);
+static int perf_reduce(int * nstat, perf_stat_t ** pstat);
+static double perf_rate(double work, double t);
+static double perf_imbalance(const perf_stat_t * stat);
+
+/*****************************************************************************
+ *
+ *  perf_init
+ *
+ *  Any existing regions are discarded.
+ *
+ *****************************************************************************/
+
+__host__ int perf_init(pe_t * pe) {
+
+  assert(pe);
+
+  perf_finalise();
+  pe_perf = pe;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_finalise
+ *
+ *****************************************************************************/
+
+__host__ int perf_finalise(void) {
+
+  free(region);
+
+  pe_perf = NULL;
+  region = NULL;
+  nregion = 0;
+  nregion_alloc = 0;
+  nstack = 0;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_region_start
+ *
+ *  Open region name as a child of the currently open region (if any),
+ *  registering it if this is the first call.
+ *
+ *****************************************************************************/
+
+__host__ int perf_region_start(const char * name) {
+
+  int n;
+  int parent;
+
+  assert(name);
+
+  if (pe_perf == NULL) return 0;
+
+  if (nstack == PERF_DEPTH_MAX) {
+    pe_fatal(pe_perf, "perf_region_start(%s): nesting exceeds %d\n",
+	     name, PERF_DEPTH_MAX);
+  }
+
+  parent = (nstack == 0) ? -1 : stack[nstack - 1];
+
+  for (n = 0; n < nregion; n++) {
+    if (region[n].parent == parent && strcmp(region[n].name, name) == 0) {
+      break;
+    }
+  }
+
+  if (n == nregion) {
+
+    /* New region */
+
+    if (strlen(name) >= PERF_NAME_MAX) {
+      pe_fatal(pe_perf, "perf region name too long: %s\n", name);
+    }
+    if (parent >= 0 && strlen(region[parent].path) + strlen(name) + 1
+	>= PERF_PATH_MAX) {
+      pe_fatal(pe_perf, "perf region path too long: %s/%s\n",
+	       region[parent].path, name);
+    }
+
+    if (nregion == nregion_alloc) {
+      nregion_alloc = 2*nregion_alloc + 8;
+      region = (perf_region_t *) realloc(region,
+					 nregion_alloc*sizeof(perf_region_t));
+      assert(region);
+      if (region == NULL) pe_fatal(pe_perf, "realloc(perf_region_t) failed\n");
+    }
+
+    memset(region + n, 0, sizeof(perf_region_t));
+    strcpy(region[n].name, name);
+    if (parent >= 0) {
+      strcpy(region[n].path, region[parent].path);
+      strcat(region[n].path, "/");
+    }
+    strcat(region[n].path, name);
+    region[n].parent = parent;
+    nregion += 1;
+  }
+
+  region[n].ncall += 1;
+  region[n].t_start = MPI_Wtime();
+  stack[nstack++] = n;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_region_stop
+ *
+ *  Close region name, which must be the innermost open region.
+ *
+ *****************************************************************************/
+
+__host__ int perf_region_stop(const char * name) {
+
+  int n;
+
+  assert(name);
+
+  if (pe_perf == NULL) return 0;
+
+  if (nstack == 0) {
+    pe_fatal(pe_perf, "perf_region_stop(%s): no open region\n", name);
+  }
+
+  n = stack[nstack - 1];
+
+  if (strcmp(region[n].name, name) != 0) {
+    pe_fatal(pe_perf, "perf_region_stop(%s): open region is %s\n",
+	     name, region[n].path);
+  }
+
+  region[n].t_sum += MPI_Wtime() - region[n].t_start;
+  nstack -= 1;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_region_work
+ *
+ *  Add work to the innermost open region.
+ *
+ *****************************************************************************/
+
+__host__ int perf_region_work(double nsites, double nbytes, double nflops) {
+
+  int n;
+
+  if (pe_perf == NULL) return 0;
+
+  if (nstack == 0) pe_fatal(pe_perf, "perf_region_work(): no open region\n");
+
+  n = stack[nstack - 1];
+  region[n].nsites += nsites;
+  region[n].nbytes += nbytes;
+  region[n].nflops += nflops;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_region_info
+ *
+ *  Local (this rank) values for the region with the given path.
+ *  work[] is {sites, bytes, flops}. Returns -1 if there is no
+ *  such region.
+ *
+ *****************************************************************************/
+
+__host__ int perf_region_info(const char * path, int * ncall, double * t,
+			      double work[3]) {
+  int n;
+
+  assert(path);
+  assert(ncall);
+  assert(t);
+  assert(work);
+
+  n = perf_region_find(path);
+  if (n < 0) return -1;
+
+  *ncall = region[n].ncall;
+  *t = region[n].t_sum;
+  work[0] = region[n].nsites;
+  work[1] = region[n].nbytes;
+  work[2] = region[n].nflops;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_statistics
+ *
+ *  Summary of all regions (collective).
+ *
+ *****************************************************************************/
+
+__host__ int perf_statistics(void) {
+
+  int n;
+  int nstat = 0;
+  const char * name = NULL;
+  perf_stat_t * stat = NULL;
+
+  if (pe_perf == NULL) return 0;
+
+  perf_reduce(&nstat, &stat);
+  if (nstat == 0) return 0;
+
+  pe_info(pe_perf, "\nRegion statistics\n");
+  pe_info(pe_perf, "%-28s %8s %10s %10s %10s %6s %8s %8s %8s\n",
+	  "Region", "calls", "tmin", "tmean", "tmax", "imbal",
+	  "GB/s", "GFlop/s", "MLUPS");
+
+  for (n = 0; n < nstat; n++) {
+
+    /* Last component of the path, indented by depth */
+
+    name = strrchr(stat[n].path, '/');
+    name = (name == NULL) ? stat[n].path : name + 1;
+    pe_info(pe_perf, "%*s%-*s %8d %10.3f %10.3f %10.3f %6.2f %8.2f %8.2f %8.2f\n",
+	    2*stat[n].depth, "", 28 - 2*stat[n].depth, name, stat[n].ncall,
+	    stat[n].tmin, stat[n].tmean, stat[n].tmax,
+	    perf_imbalance(stat + n),
+	    1.0e-09*perf_rate(stat[n].nbytes, stat[n].tmax),
+	    1.0e-09*perf_rate(stat[n].nflops, stat[n].tmax),
+	    1.0e-06*perf_rate(stat[n].nsites, stat[n].tmax));
+  }
+
+  free(stat);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_dump
+ *
+ *  Append the current (cumulative) statistics to filename, labelled
+ *  by step. Collective; the file is written by root only.
+ *
+ *  CSV has one line per region, with a header if the file is new;
+ *  JSON has a single object per line, so that the file may be read
+ *  one dump at a time.
+ *
+ *****************************************************************************/
+
+__host__ int perf_dump(const char * filename, int step,
+		       perf_format_enum_t format) {
+  int n;
+  int nstat = 0;
+  perf_stat_t * stat = NULL;
+  FILE * fp = NULL;
+
+  assert(filename);
+
+  if (pe_perf == NULL) return 0;
+
+  perf_reduce(&nstat, &stat);
+
+  if (pe_mpi_rank(pe_perf) == 0) {
+
+    fp = fopen(filename, "a");
+    if (fp == NULL) pe_fatal(pe_perf, "fopen(%s) failed\n", filename);
+
+    if (format == PERF_FORMAT_CSV) {
+      if (ftell(fp) == 0) {
+	fprintf(fp, "step,region,depth,calls,tmin,tmean,tmax,imbalance,"
+		"sites,bytes,flops,gbs,gflops,mlups\n");
+      }
+      for (n = 0; n < nstat; n++) {
+	fprintf(fp, "%d,%s,%d,%d,%e,%e,%e,%e,%e,%e,%e,%e,%e,%e\n", step,
+		stat[n].path, stat[n].depth, stat[n].ncall,
+		stat[n].tmin, stat[n].tmean, stat[n].tmax,
+		perf_imbalance(stat + n),
+		stat[n].nsites, stat[n].nbytes, stat[n].nflops,
+		1.0e-09*perf_rate(stat[n].nbytes, stat[n].tmax),
+		1.0e-09*perf_rate(stat[n].nflops, stat[n].tmax),
+		1.0e-06*perf_rate(stat[n].nsites, stat[n].tmax));
+      }
+    }
+    else {
+      fprintf(fp, "{\"step\": %d, \"nrank\": %d, \"regions\": [", step,
+	      pe_mpi_size(pe_perf));
+      for (n = 0; n < nstat; n++) {
+	fprintf(fp, "%s{\"region\": \"%s\", \"depth\": %d, \"calls\": %d, "
+		"\"tmin\": %e, \"tmean\": %e, \"tmax\": %e, "
+		"\"imbalance\": %e, \"sites\": %e, \"bytes\": %e, "
+		"\"flops\": %e, \"gbs\": %e, \"gflops\": %e, \"mlups\": %e}",
+		(n == 0) ? "" : ", ", stat[n].path, stat[n].depth,
+		stat[n].ncall, stat[n].tmin, stat[n].tmean, stat[n].tmax,
+		perf_imbalance(stat + n),
+		stat[n].nsites, stat[n].nbytes, stat[n].nflops,
+		1.0e-09*perf_rate(stat[n].nbytes, stat[n].tmax),
+		1.0e-09*perf_rate(stat[n].nflops, stat[n].tmax),
+		1.0e-06*perf_rate(stat[n].nsites, stat[n].tmax));
+      }
+      fprintf(fp, "]}\n");
+    }
+
+    if (ferror(fp)) pe_fatal(pe_perf, "Write to %s failed\n", filename);
+    fclose(fp);
+  }
+
+  free(stat);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_region_find
+ *
+ *  Local index of region with path, or -1 if not present.
+ *
+ *****************************************************************************/
+
+static int perf_region_find(const char * path) {
+
+  int n;
+
+  assert(path);
+
+  for (n = 0; n < nregion; n++) {
+    if (strcmp(region[n].path, path) == 0) return n;
+  }
+
+  return -1;
+}
+
+/*****************************************************************************
+ *
+ *  perf_reduce
+ *
+ *  The set of regions is the union over ranks (in order of rank,
+ *  then order of registration). The root gathers the paths and
+ *  broadcasts the union; values are then reduced with zero for a
+ *  region not present on a given rank.
+ *
+ *  On exit, *pstat[nstat] is significant at root only, and must be
+ *  released by the caller.
+ *
+ *****************************************************************************/
+
+static int perf_reduce(int * nstat, perf_stat_t ** pstat) {
+
+  int n, m, ir;
+  int nrank;
+  int nmax = 0;
+  int nunion = 0;
+  char * path = NULL;
+  char * paths = NULL;
+  double * tlocal = NULL;
+  double * tmp = NULL;
+  int * ilocal = NULL;
+  int * itmp = NULL;
+  perf_stat_t * stat = NULL;
+  MPI_Comm comm;
+
+  assert(pe_perf);
+  assert(nstat);
+  assert(pstat);
+
+  pe_mpi_comm(pe_perf, &comm);
+  nrank = pe_mpi_size(pe_perf);
+
+  MPI_Allreduce(&nregion, &nmax, 1, MPI_INT, MPI_MAX, comm);
+
+  if (nmax > 0) {
+
+    /* Gather the (padded) lists of paths at root and form the union */
+
+    path = (char *) calloc(nmax*PERF_PATH_MAX, sizeof(char));
+    paths = (char *) calloc((size_t) nrank*nmax*PERF_PATH_MAX, sizeof(char));
+    assert(path);
+    assert(paths);
+    if (path == NULL) pe_fatal(pe_perf, "calloc(path) failed\n");
+    if (paths == NULL) pe_fatal(pe_perf, "calloc(paths) failed\n");
+
+    for (n = 0; n < nregion; n++) {
+      strcpy(path + n*PERF_PATH_MAX, region[n].path);
+    }
+
+    MPI_Gather(path, nmax*PERF_PATH_MAX, MPI_CHAR, paths,
+	       nmax*PERF_PATH_MAX, MPI_CHAR, 0, comm);
+
+    if (pe_mpi_rank(pe_perf) == 0) {
+      for (ir = 0; ir < nrank*nmax; ir++) {
+	char * p = paths + ir*PERF_PATH_MAX;
+	if (p[0] == '\0') continue;
+	for (m = 0; m < nunion; m++) {
+	  if (strcmp(paths + m*PERF_PATH_MAX, p) == 0) break;
+	}
+	if (m == nunion) {
+	  memmove(paths + nunion*PERF_PATH_MAX, p, PERF_PATH_MAX);
+	  nunion += 1;
+	}
+      }
+    }
+
+    MPI_Bcast(&nunion, 1, MPI_INT, 0, comm);
+    MPI_Bcast(paths, nunion*PERF_PATH_MAX, MPI_CHAR, 0, comm);
+
+    /* Local contributions in union order */
+
+    tlocal = (double *) calloc(4*nunion, sizeof(double));
+    tmp = (double *) calloc(4*nunion, sizeof(double));
+    ilocal = (int *) calloc(nunion, sizeof(int));
+    itmp = (int *) calloc(nunion, sizeof(int));
+    stat = (perf_stat_t *) calloc(nunion, sizeof(perf_stat_t));
+    assert(tlocal && tmp && ilocal && itmp && stat);
+    if (stat == NULL) pe_fatal(pe_perf, "calloc(perf_stat_t) failed\n");
+
+    for (m = 0; m < nunion; m++) {
+      n = perf_region_find(paths + m*PERF_PATH_MAX);
+      if (n < 0) continue;
+      tlocal[4*m + 0] = region[n].t_sum;
+      tlocal[4*m + 1] = region[n].nsites;
+      tlocal[4*m + 2] = region[n].nbytes;
+      tlocal[4*m + 3] = region[n].nflops;
+      ilocal[m] = region[n].ncall;
+    }
+
+    MPI_Reduce(ilocal, itmp, nunion, MPI_INT, MPI_MAX, 0, comm);
+    for (m = 0; m < nunion; m++) stat[m].ncall = itmp[m];
+
+    MPI_Reduce(tlocal, tmp, 4*nunion, MPI_DOUBLE, MPI_SUM, 0, comm);
+    for (m = 0; m < nunion; m++) {
+      stat[m].tmean  = tmp[4*m + 0]/nrank;
+      stat[m].nsites = tmp[4*m + 1];
+      stat[m].nbytes = tmp[4*m + 2];
+      stat[m].nflops = tmp[4*m + 3];
+    }
+
+    /* Times only for min/max (stride 4) */
+
+    for (m = 0; m < nunion; m++) tlocal[m] = tlocal[4*m];
+
+    MPI_Reduce(tlocal, tmp, nunion, MPI_DOUBLE, MPI_MIN, 0, comm);
+    for (m = 0; m < nunion; m++) stat[m].tmin = tmp[m];
+    MPI_Reduce(tlocal, tmp, nunion, MPI_DOUBLE, MPI_MAX, 0, comm);
+    for (m = 0; m < nunion; m++) stat[m].tmax = tmp[m];
+
+    for (m = 0; m < nunion; m++) {
+      char * p = paths + m*PERF_PATH_MAX;
+      strcpy(stat[m].path, p);
+      stat[m].depth = 0;
+      for ( ; *p; p++) stat[m].depth += (*p == '/');
+    }
+
+    free(itmp);
+    free(ilocal);
+    free(tmp);
+    free(tlocal);
+    free(paths);
+    free(path);
+  }
+
+  *nstat = nunion;
+  *pstat = stat;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_rate
+ *
+ *****************************************************************************/
+
+static double perf_rate(double work, double t) {
+
+  return (t > 0.0) ? work/t : 0.0;
+}
+
+/*****************************************************************************
+ *
+ *  perf_imbalance
+ *
+ *  Load imbalance max/mean (1 if no time is recorded).
+ *
+ *****************************************************************************/
+
+static double perf_imbalance(const perf_stat_t * stat) {
+
+  assert(stat);
+
+  return (stat->tmean > 0.0) ? stat->tmax/stat->tmean : 1.0;
+}
@@ -0,0 +1,40 @@
+/*****************************************************************************
+ *
+ *  perf.h
+ *
+ *  Named, nested performance regions with work counts.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_PERF_H
+#define LUDWIG_PERF_H
+
+#include "pe.h"
+
+#define PERF_NAME_MAX  32
+#define PERF_PATH_MAX 128
+#define PERF_DEPTH_MAX 16
+
+typedef enum perf_format_enum {PERF_FORMAT_CSV, PERF_FORMAT_JSON}
+  perf_format_enum_t;
+
+__host__ int perf_init(pe_t * pe);
+__host__ int perf_finalise(void);
+__host__ int perf_region_start(const char * name);
+__host__ int perf_region_stop(const char * name);
+__host__ int perf_region_work(double nsites, double nbytes, double nflops);
+__host__ int perf_region_info(const char * path, int * ncall, double * t,
+			      double work[3]);
+__host__ int perf_statistics(void);
+__host__ int perf_dump(const char * filename, int step,
+		       perf_format_enum_t format);
+
+#endif
@@ -24,11 +24,15 @@
  *  This requires fixes at the plane boudaries to get consistent
  *  fluxes.
  *
+ *  If there are no Lees-Edwards planes and no noise, the fluxes and
+ *  the update are fused in a single sweep (phi_ch_fused_driver()),
+ *  which does not store the fluxes.
+ *
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2018 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributions:
  *  Thanks to Markus Gross, who helped to validate the noise implementation.
@@ -41,6 +45,8 @@
 #include <math.h>
 
 #include "field_s.h"
+#include "hydro_s.h"
+#include "map_s.h"
 #include "physics.h"
 #include "advection_s.h"
 #include "advection_bcs.h"
@@ -51,6 +57,9 @@ struct phi_ch_s {
   cs_t * cs;
   lees_edw_t * le;
   advflux_t * flux;
+  int fused;         /* Fused flux and update (if available) */
+  int nxs;           /* Sites in one plane of constant x */
+  double * pbuf;     /* Updated phi for four planes (target memory) */
 };
 
 struct phi_ch_info_s {
@@ -64,6 +73,8 @@ static int phi_ch_update_forward_step(phi_ch_t * pch, field_t * phif);
 static int phi_ch_le_fix_fluxes(phi_ch_t * pch, int nf);
 static int phi_ch_le_fix_fluxes_parallel(phi_ch_t * pch, int nf);
 static int phi_ch_random_flux(phi_ch_t * pch, noise_t * noise);
+static int phi_ch_fused_driver(phi_ch_t * pch, fe_t * fe, field_t * phi,
+			       hydro_t * hydro, map_t * map, int order);
 
 __global__ void phi_ch_flux_mu1_kernel(kernel_ctxt_t * ktx,
 				       lees_edw_t * le, fe_t * fe,
@@ -71,6 +82,11 @@ __global__ void phi_ch_flux_mu1_kernel(kernel_ctxt_t * ktx,
 __global__ void phi_ch_ufs_kernel(kernel_ctxt_t * ktx, lees_edw_t *le,
 				  field_t * field, advflux_t * flux,
 				  int ys, double wz);
+__global__ void phi_ch_fused_kernel(kernel_ctxt_t * ktx, fe_t * fe,
+				    field_t * field, hydro_t * hydro,
+				    map_t * map, double * pbuf, int nxs,
+				    int xs, int ys, int order, int icc, int icw,
+				    double mobility, double wz);
 
 /*****************************************************************************
  *
@@ -97,6 +113,7 @@ __host__ int phi_ch_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
   obj->cs = cs;
   obj->le = le;
   advflux_le_create(pe, cs, le, 1, &obj->flux);
+  phi_ch_fused_set(obj, 1);
 
   pe_retain(pe);
   lees_edw_retain(le);
@@ -114,8 +131,20 @@ __host__ int phi_ch_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
 
 __host__ int phi_ch_free(phi_ch_t * pch) {
 
+  int ndevice;
+
   assert(pch);
 
+  if (pch->pbuf) {
+    tdpGetDeviceCount(&ndevice);
+    if (ndevice == 0) {
+      free(pch->pbuf);
+    }
+    else {
+      tdpAssert(tdpFree(pch->pbuf));
+    }
+  }
+
   lees_edw_free(pch->le);
   pe_free(pch->pe);
 
@@ -125,6 +154,47 @@ __host__ int phi_ch_free(phi_ch_t * pch) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  phi_ch_fused_set
+ *
+ *  If fused is set (the default), the fused update is used where it
+ *  is available. The buffer for four planes is allocated here.
+ *
+ *****************************************************************************/
+
+__host__ int phi_ch_fused_set(phi_ch_t * pch, int fused) {
+
+  int ndevice;
+  int nhalo;
+  int nlocal[3];
+  size_t nbuf;
+
+  assert(pch);
+
+  pch->fused = fused;
+  if (fused == 0 || pch->pbuf) return 0;
+
+  cs_nhalo(pch->cs, &nhalo);
+  cs_nlocal(pch->cs, nlocal);
+
+  pch->nxs = (nlocal[Y] + 2*nhalo)*(nlocal[Z] + 2*nhalo);
+  nbuf = (size_t) 4*pch->nxs;
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice == 0) {
+    pch->pbuf = (double *) calloc(nbuf, sizeof(double));
+    if (pch->pbuf == NULL) pe_fatal(pch->pe, "calloc(pch->pbuf) failed\n");
+  }
+  else {
+    tdpAssert(tdpMalloc((void **) &pch->pbuf, nbuf*sizeof(double)));
+    tdpAssert(tdpMemset(pch->pbuf, 0, nbuf*sizeof(double)));
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  phi_cahn_hilliard
@@ -170,6 +240,19 @@ int phi_cahn_hilliard(phi_ch_t * pch, fe_t * fe, field_t * phi,
   field_nf(phi, &nf);
   assert(nf == 1);
 
+  /* Fused fluxes and update (advection schemes up to third order) */
+
+  if (pch->fused && hydro && noise_phi == 0 &&
+      lees_edw_nplane_total(pch->le) == 0) {
+    int order;
+    advection_order(&order);
+    if (order <= 3) {
+      hydro_u_halo(hydro);
+      phi_ch_fused_driver(pch, fe, phi, hydro, map, order);
+      return 0;
+    }
+  }
+
   /* Compute any advective fluxes first, then accumulate diffusive
    * and random fluxes. */
 
@@ -958,3 +1041,227 @@ __global__ void phi_ch_ufs_kernel(kernel_ctxt_t * ktx, lees_edw_t *le,
 
   return;
 }
+
+/*****************************************************************************
+ *
+ *  phi_ch_fused_driver
+ *
+ *  Advective and diffusive fluxes, no normal flux conditions, and
+ *  the update, in one sweep without storing the fluxes.
+ *
+ *  The lattice is swept in planes of constant x. The new phi for
+ *  plane ic is held in the buffer until plane ic + 3 is computed.
+ *  The stencil for plane ic + 3 reaches back only to ic + 1, so the
+ *  buffer for plane ic may then be copied back to the field. Face
+ *  fluxes are computed from both sides of the face, using exactly
+ *  the same operations as advection_x(), phi_ch_flux_mu1() and
+ *  advection_bcs_no_normal_flux(). So the result is the same as
+ *  that from the separate stages.
+ *
+ *****************************************************************************/
+
+static int phi_ch_fused_driver(phi_ch_t * pch, fe_t * fe, field_t * phi,
+			       hydro_t * hydro, map_t * map, int order) {
+  int ic;
+  int nlocal[3];
+  int xs, ys, zs;
+  double mobility;
+  double wz = 1.0;
+  dim3 nblk, ntpb;
+  fe_t * fetarget = NULL;
+  map_t * maptarget = NULL;
+  physics_t * phys = NULL;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+
+  assert(pch);
+  assert(pch->pbuf);
+  assert(fe);
+  assert(phi);
+  assert(hydro);
+  assert(order >= 1 && order <= 3);
+
+  lees_edw_nlocal(pch->le, nlocal);
+  lees_edw_strides(pch->le, &xs, &ys, &zs);
+  fe->func->target(fe, &fetarget);
+  if (map) maptarget = map->target;
+
+  physics_ref(&phys);
+  physics_mobility(phys, &mobility);
+
+  if (nlocal[Z] == 1) wz = 0.0;
+
+  /* The context describes one plane; the kernel is told which */
+
+  limits.imin = 1; limits.imax = 1;
+  limits.jmin = 1; limits.jmax = nlocal[Y];
+  limits.kmin = 1; limits.kmax = nlocal[Z];
+
+  kernel_ctxt_create(pch->cs, 1, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  for (ic = 1; ic <= nlocal[X] + 3; ic++) {
+
+    int icc = (ic <= nlocal[X]) ? ic : 0;  /* plane to compute */
+    int icw = (ic > 3) ? ic - 3 : 0;       /* plane to copy back */
+
+    tdpLaunchKernel(phi_ch_fused_kernel, nblk, ntpb, 0, 0,
+		    ctxt->target, fetarget, phi->target, hydro->target,
+		    maptarget, pch->pbuf, pch->nxs, xs, ys, order, icc, icw,
+		    mobility, wz);
+    tdpAssert(tdpPeekAtLastError());
+  }
+
+  tdpAssert(tdpDeviceSynchronize());
+
+  kernel_ctxt_free(ctxt);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_fused_face
+ *
+ *  Total flux at the face between lower site i0 and upper site
+ *  i0 + s (s is the stride in the relevant direction), given the
+ *  chemical potential mu0, mu1 on either side.
+ *
+ *  "west" selects the upwind test used in advection_x() for the
+ *  west face, which differs from that used for other faces only
+ *  when the velocity is exactly zero.
+ *
+ *****************************************************************************/
+
+static __host__ __device__ double phi_ch_fused_face(field_t * field,
+						    hydro_t * hydro,
+						    map_t * map, int order,
+						    int i0, int s, int ia,
+						    int west, double mu0,
+						    double mu1,
+						    double mobility) {
+  int i1 = i0 + s;
+  int lower;
+  double u, p0, p1;
+  double flux = 0.0;
+
+  const double a1 = -0.213933;
+  const double a2 =  0.927865;
+  const double a3 =  0.286067;
+
+  u = 0.5*(hydro->u[addr_rank1(hydro->nsite, NHDIM, i1, ia)]
+	   + hydro->u[addr_rank1(hydro->nsite, NHDIM, i0, ia)]);
+
+  /* Is the lower site upwind? */
+  lower = (west) ? (u > 0.0) : !(u < 0.0);
+
+  p0 = field->data[addr_rank0(field->nsites, i0)];
+  p1 = field->data[addr_rank0(field->nsites, i1)];
+
+  if (order == 1) {
+    flux = u*((lower) ? p0 : p1);
+  }
+  else if (order == 2) {
+    flux = u*0.5*(p0 + p1);
+  }
+  else {
+    if (lower) {
+      double pm = field->data[addr_rank0(field->nsites, i0 - s)];
+      flux = u*(a1*pm + a2*p0 + a3*p1);
+    }
+    else {
+      double pp = field->data[addr_rank0(field->nsites, i1 + s)];
+      flux = u*(a1*pp + a2*p1 + a3*p0);
+    }
+  }
+
+  flux -= mobility*(mu1 - mu0);
+
+  if (map) {
+    int m0 = (map->status[i0] == MAP_FLUID);
+    int m1 = (map->status[i1] == MAP_FLUID);
+    flux *= m0*m1;
+  }
+
+  return flux;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_fused_kernel
+ *
+ *  Unvectorised. If icc is non-zero, compute the new phi in plane icc
+ *  to the buffer; if icw is non-zero, copy the buffer for plane icw
+ *  back to the field.
+ *
+ *****************************************************************************/
+
+__global__ void phi_ch_fused_kernel(kernel_ctxt_t * ktx, fe_t * fe,
+				    field_t * field, hydro_t * hydro,
+				    map_t * map, double * pbuf, int nxs,
+				    int xs, int ys, int order, int icc, int icw,
+				    double mobility, double wz) {
+  int kindex;
+  int kiterations;
+
+  assert(ktx);
+  assert(fe);
+  assert(fe->func->mu);
+  assert(field);
+  assert(hydro);
+  assert(pbuf);
+
+  kiterations = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, 1) {
+
+    int jc, kc;
+    int index;
+
+    jc = kernel_coords_jc(ktx, kindex);
+    kc = kernel_coords_kc(ktx, kindex);
+
+    if (icc) {
+      double mu0, mum, mup;
+      double fluxw, fluxe, fluxy, fluxym, fluxz, fluxzm;
+      double phi;
+
+      index = kernel_coords_index(ktx, icc, jc, kc);
+      fe->func->mu(fe, index, &mu0);
+
+      fe->func->mu(fe, index - xs, &mum);
+      fe->func->mu(fe, index + xs, &mup);
+      fluxw = phi_ch_fused_face(field, hydro, map, order, index - xs, xs, X, 1,
+			     mum, mu0, mobility);
+      fluxe = phi_ch_fused_face(field, hydro, map, order, index, xs, X, 0,
+			     mu0, mup, mobility);
+
+      fe->func->mu(fe, index - ys, &mum);
+      fe->func->mu(fe, index + ys, &mup);
+      fluxym = phi_ch_fused_face(field, hydro, map, order, index - ys, ys, Y, 0,
+			      mum, mu0, mobility);
+      fluxy = phi_ch_fused_face(field, hydro, map, order, index, ys, Y, 0,
+			     mu0, mup, mobility);
+
+      fe->func->mu(fe, index - 1, &mum);
+      fe->func->mu(fe, index + 1, &mup);
+      fluxzm = phi_ch_fused_face(field, hydro, map, order, index - 1, 1, Z, 0,
+			      mum, mu0, mobility);
+      fluxz = phi_ch_fused_face(field, hydro, map, order, index, 1, Z, 0,
+			     mu0, mup, mobility);
+
+      phi = field->data[addr_rank0(field->nsites, index)];
+      phi -= (+ fluxe - fluxw + fluxy - fluxym + wz*fluxz - wz*fluxzm);
+
+      pbuf[(icc % 4)*nxs + index % nxs] = phi;
+    }
+
+    if (icw) {
+      index = kernel_coords_index(ktx, icw, jc, kc);
+      field->data[addr_rank0(field->nsites, index)]
+	= pbuf[(icw % 4)*nxs + index % nxs];
+    }
+  }
+
+  return;
+}
@@ -6,7 +6,7 @@
  *  Edinburgh Parallel Computing Centre
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *****************************************************************************/
 
@@ -29,6 +29,7 @@ __host__ int phi_ch_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
 			   phi_ch_info_t * info,
 			   phi_ch_t ** pch);
 __host__ int phi_ch_free(phi_ch_t * pch);
+__host__ int phi_ch_fused_set(phi_ch_t * pch, int fused);
 
 __host__ int phi_cahn_hilliard(phi_ch_t * pch, fe_t * fe, field_t * phi,
 			       hydro_t * hydro, map_t * map,
@@ -93,11 +93,15 @@ __host__ int phi_force_calculation(cs_t * cs, lees_edw_t * le, wall_t * wall,
   else {
     switch (pth->method) {
     case PTH_METHOD_DIVERGENCE:
-      pth_stress_compute(pth, fe);
       if (wall_present(wall) || is_pm) {
+	pth_stress_compute(pth, fe);
 	pth_force_fluid_wall_driver(pth, hydro, map, wall);
       }
+      else if (pth->fused) {
+	pth_force_fluid_fused_driver(pth, fe, hydro);
+      }
       else {
+	pth_stress_compute(pth, fe);
 	pth_force_fluid_driver(pth, hydro);
       }
       break;
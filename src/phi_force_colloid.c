@@ -75,6 +75,10 @@ __global__ void pth_force_wall_kernel(kernel_ctxt_t * ktx, pth_t * pth,
 				      double fw[3]);
 __global__ void pth_force_fluid_kernel_v(kernel_ctxt_t * ktx, pth_t * pth,
 					 hydro_t * hydro);
+__global__ void pth_fused_stress_kernel_v(kernel_ctxt_t * ktx, pth_t * pth,
+					  fe_t * fe, int anti);
+__global__ void pth_fused_force_kernel_v(kernel_ctxt_t * ktx, pth_t * pth,
+					 hydro_t * hydro);
 
 /*****************************************************************************
  *
@@ -478,6 +482,309 @@ __global__ void pth_force_fluid_kernel_v(kernel_ctxt_t * ktx, pth_t * pth,
   return;
 }
 
+/*****************************************************************************
+ *
+ *  pth_force_fluid_fused_driver
+ *
+ *  Kernel driver. Fluid only, with the stress computed on the fly.
+ *
+ *  The lattice is swept in planes of constant x. The stress for
+ *  plane ic is computed and held in pth->pbuf, which has room for
+ *  three planes; the divergence for plane ic - 1 can then be taken.
+ *  No lattice-sized stress array is required, and each stress is
+ *  computed once. The result is the same as that from
+ *  pth_stress_compute() followed by pth_force_fluid_driver().
+ *
+ *****************************************************************************/
+
+__host__ int pth_force_fluid_fused_driver(pth_t * pth, fe_t * fe,
+					  hydro_t * hydro) {
+  int ic;
+  int anti;
+  int nhalo;
+  int nlocal[3];
+  dim3 nblk, ntpb;
+  fe_t * fe_target = NULL;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+
+  assert(pth);
+  assert(pth->fused);
+  assert(fe);
+  assert(fe->func->target);
+  assert(hydro);
+
+  /* Antisymmetric part only, if relaxation; if none, no force. */
+
+  anti = fe->use_stress_relaxation;
+  if (anti && fe->func->str_anti_v == NULL) return 0;
+
+  cs_nhalo(pth->cs, &nhalo);
+  cs_nlocal(pth->cs, nlocal);
+  fe->func->target(fe, &fe_target);
+
+  TIMER_start(TIMER_PHI_FORCE_CALC);
+
+  for (ic = 0; ic <= nlocal[X] + 1; ic++) {
+
+    /* Stress in plane ic (all of y and z) */
+
+    limits.imin = ic;         limits.imax = ic;
+    limits.jmin = 1 - nhalo;  limits.jmax = nlocal[Y] + nhalo;
+    limits.kmin = 1 - nhalo;  limits.kmax = nlocal[Z] + nhalo;
+
+    kernel_ctxt_create(pth->cs, NSIMDVL, limits, &ctxt);
+    kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+    tdpLaunchKernel(pth_fused_stress_kernel_v, nblk, ntpb, 0, 0,
+		    ctxt->target, pth->target, fe_target, anti);
+    tdpAssert(tdpPeekAtLastError());
+
+    kernel_ctxt_free(ctxt);
+
+    if (ic < 2) continue;
+
+    /* Divergence in plane ic - 1 */
+
+    limits.imin = ic - 1; limits.imax = ic - 1;
+    limits.jmin = 1;      limits.jmax = nlocal[Y];
+    limits.kmin = 1;      limits.kmax = nlocal[Z];
+
+    kernel_ctxt_create(pth->cs, NSIMDVL, limits, &ctxt);
+    kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+    tdpLaunchKernel(pth_fused_force_kernel_v, nblk, ntpb, 0, 0,
+		    ctxt->target, pth->target, hydro->target);
+    tdpAssert(tdpPeekAtLastError());
+
+    kernel_ctxt_free(ctxt);
+  }
+
+  tdpAssert(tdpDeviceSynchronize());
+
+  TIMER_stop(TIMER_PHI_FORCE_CALC);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  pth_pbuf_v
+ *
+ *  Stress for a vector of sites from the plane buffer. Plane ic is
+ *  held in slot ic % 3 at the same offset as in the lattice.
+ *
+ *****************************************************************************/
+
+static __host__ __device__ void pth_pbuf_v(pth_t * pth, int ic[NSIMDVL],
+					   int index[NSIMDVL],
+					   double p[3][3][NSIMDVL]) {
+  int ia, ib, iv;
+  int n3 = 3*pth->nxs;
+  int ip[NSIMDVL];
+
+  for_simd_v(iv, NSIMDVL) {
+    ip[iv] = (ic[iv] % 3)*pth->nxs + index[iv] % pth->nxs;
+  }
+
+  for (ia = 0; ia < 3; ia++) {
+    for (ib = 0; ib < 3; ib++) {
+      for_simd_v(iv, NSIMDVL) {
+	p[ia][ib][iv] = pth->pbuf[addr_rank2(n3, 3, 3, ip[iv], ia, ib)];
+      }
+    }
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  pth_fused_stress_kernel_v
+ *
+ *  Stress (or its antisymmetric part) for one plane into the buffer.
+ *
+ *****************************************************************************/
+
+__global__ void pth_fused_stress_kernel_v(kernel_ctxt_t * ktx, pth_t * pth,
+					  fe_t * fe, int anti) {
+  int kindex;
+  int kiterations;
+
+  assert(ktx);
+  assert(pth);
+  assert(fe);
+
+  kiterations = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, NSIMDVL) {
+
+    int iv;
+    int ia, ib;
+    int index;
+    int ic[NSIMDVL];
+    int jc[NSIMDVL];
+    int kc[NSIMDVL];
+    int maskv[NSIMDVL];
+    int ip[NSIMDVL];
+    double s[3][3][NSIMDVL];
+
+    index = kernel_baseindex(ktx, kindex);
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
+
+    if (anti) {
+      fe->func->str_anti_v(fe, index, s);
+    }
+    else {
+      fe->func->stress_v(fe, index, s);
+    }
+
+    /* A vector block may straddle two planes: store this plane only */
+
+    for_simd_v(iv, NSIMDVL) {
+      ip[iv] = (ic[iv] % 3)*pth->nxs + (index + iv) % pth->nxs;
+    }
+
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	for_simd_v(iv, NSIMDVL) {
+	  if (maskv[iv]) {
+	    pth->pbuf[addr_rank2(3*pth->nxs, 3, 3, ip[iv], ia, ib)]
+	      = s[ia][ib][iv];
+	  }
+	}
+      }
+    }
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  pth_fused_force_kernel_v
+ *
+ *  As pth_force_fluid_kernel_v(), but the stress comes from the plane
+ *  buffer. Masked sites refer to themselves, and so always lie in
+ *  one of the three planes held.
+ *
+ *****************************************************************************/
+
+__global__ void pth_fused_force_kernel_v(kernel_ctxt_t * ktx, pth_t * pth,
+					 hydro_t * hydro) {
+  int kindex;
+  int kiterations;
+
+  assert(ktx);
+  assert(pth);
+  assert(hydro);
+
+  kiterations = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, NSIMDVL) {
+
+    int iv;
+    int ia;
+    int index;                   /* first index in vector block */
+    int ic[NSIMDVL];
+    int jc[NSIMDVL];
+    int kc[NSIMDVL];
+    int pm[NSIMDVL];             /* ordinate +/- 1 */
+    int maskv[NSIMDVL];          /* = 0 if not kernel site, 1 otherwise */
+    int index0[NSIMDVL];
+    int index1[NSIMDVL];
+    double pth0[3][3][NSIMDVL];
+    double pth1[3][3][NSIMDVL];
+    double force[3][NSIMDVL];
+
+    index = kernel_baseindex(ktx, kindex);
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
+
+    for_simd_v(iv, NSIMDVL) index0[iv] = index + iv;
+    pth_pbuf_v(pth, ic, index0, pth0);
+
+    /* x-direction */
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = ic[iv] + maskv[iv];
+    kernel_coords_index_v(ktx, pm, jc, kc, index1);
+    pth_pbuf_v(pth, pm, index1, pth1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	force[ia][iv] = -0.5*(pth1[ia][X][iv] + pth0[ia][X][iv]);
+      }
+    }
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = ic[iv] - maskv[iv];
+    kernel_coords_index_v(ktx, pm, jc, kc, index1);
+    pth_pbuf_v(pth, pm, index1, pth1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	force[ia][iv] += 0.5*(pth1[ia][X][iv] + pth0[ia][X][iv]);
+      }
+    }
+
+    /* y-direction */
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = jc[iv] + maskv[iv];
+    kernel_coords_index_v(ktx, ic, pm, kc, index1);
+    pth_pbuf_v(pth, ic, index1, pth1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	force[ia][iv] -= 0.5*(pth1[ia][Y][iv] + pth0[ia][Y][iv]);
+      }
+    }
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = jc[iv] - maskv[iv];
+    kernel_coords_index_v(ktx, ic, pm, kc, index1);
+    pth_pbuf_v(pth, ic, index1, pth1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	force[ia][iv] += 0.5*(pth1[ia][Y][iv] + pth0[ia][Y][iv]);
+      }
+    }
+
+    /* z-direction */
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = kc[iv] + maskv[iv];
+    kernel_coords_index_v(ktx, ic, jc, pm, index1);
+    pth_pbuf_v(pth, ic, index1, pth1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	force[ia][iv] -= 0.5*(pth1[ia][Z][iv] + pth0[ia][Z][iv]);
+      }
+    }
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = kc[iv] - maskv[iv];
+    kernel_coords_index_v(ktx, ic, jc, pm, index1);
+    pth_pbuf_v(pth, ic, index1, pth1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	force[ia][iv] += 0.5*(pth1[ia][Z][iv] + pth0[ia][Z][iv]);
+      }
+    }
+
+    /* Store the force on lattice */
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	hydro->f[addr_rank1(hydro->nsite,NHDIM,index+iv,ia)]
+	  += force[ia][iv]*maskv[iv];
+      }
+    }
+    /* Next site */
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  pth_force_map_kernel
@@ -9,7 +9,7 @@
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
- *  (c) 2009-2016 The University of Edinburgh
+ *  (c) 2009-2019 The University of Edinburgh
  *
  *****************************************************************************/
 
@@ -24,6 +24,8 @@
 #include "wall.h"
 
 __host__ int pth_force_fluid_driver(pth_t * pth, hydro_t * hydro);
+__host__ int pth_force_fluid_fused_driver(pth_t * pth, fe_t * fe,
+					  hydro_t * hydro);
 __host__ int pth_force_fluid_wall_driver(pth_t * pth, hydro_t * hydro,
 					 map_t * map, wall_t * wall);
 __host__ int pth_force_colloid(pth_t * pth, fe_t * fe, colloids_info_t * cinfo,
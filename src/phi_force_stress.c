@@ -9,7 +9,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2018 The University of Edinburgh
+ *  (c) 2012-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -42,7 +42,6 @@ __global__ void pth_kernel_a_v(kernel_ctxt_t * ktx, pth_t * pth, fe_t * fe);
 __host__ int pth_create(pe_t * pe, cs_t * cs, int method, pth_t ** pobj) {
 
   int ndevice;
-  double * tmp;
   pth_t * obj = NULL;
 
   assert(pobj);
@@ -56,12 +55,8 @@ __host__ int pth_create(pe_t * pe, cs_t * cs, int method, pth_t ** pobj) {
   obj->method = method;
   cs_nsites(cs, &obj->nsites);
 
-  /* If memory required */
-
-  if (method == PTH_METHOD_DIVERGENCE) {
-    obj->str = (double *) calloc(3*3*obj->nsites, sizeof(double));
-    if (obj->str == NULL) pe_fatal(pe, "calloc(pth->str) failed\n");
-  }
+  /* Stress memory, if required, is allocated at the first call to
+   * pth_stress_compute() */
 
   /* Allocate target memory, or alias */
 
@@ -76,12 +71,6 @@ __host__ int pth_create(pe_t * pe, cs_t * cs, int method, pth_t ** pobj) {
     tdpMemset(obj->target, 0, sizeof(pth_t));
     tdpMemcpy(&obj->target->nsites, &obj->nsites, sizeof(int),
 	      tdpMemcpyHostToDevice);
-
-    if (method == PTH_METHOD_DIVERGENCE) {
-      tdpMalloc((void **) &tmp, 3*3*obj->nsites*sizeof(double));
-      tdpMemcpy(&obj->target->str, &tmp, sizeof(double *),
-		tdpMemcpyHostToDevice);
-    }
   }
 
   *pobj = obj;
@@ -89,6 +78,87 @@ __host__ int pth_create(pe_t * pe, cs_t * cs, int method, pth_t ** pobj) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  pth_str_alloc
+ *
+ *  The full stress (3x3 per site) on host and target.
+ *
+ *****************************************************************************/
+
+static __host__ int pth_str_alloc(pth_t * pth) {
+
+  int ndevice;
+  double * tmp = NULL;
+
+  assert(pth);
+  assert(pth->str == NULL);
+
+  pth->str = (double *) calloc(3*3*pth->nsites, sizeof(double));
+  if (pth->str == NULL) pe_fatal(pth->pe, "calloc(pth->str) failed\n");
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    tdpMalloc((void **) &tmp, 3*3*pth->nsites*sizeof(double));
+    tdpMemset(tmp, 0, 3*3*pth->nsites*sizeof(double));
+    tdpMemcpy(&pth->target->str, &tmp, sizeof(double *),
+	      tdpMemcpyHostToDevice);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  pth_fused_set
+ *
+ *  If fused is set, the divergence of the stress on the fluid is
+ *  computed without storing the stress for the whole lattice. Only
+ *  three consecutive planes of constant x are held (pth->pbuf).
+ *
+ *  The full stress is still allocated if it turns out to be required
+ *  (walls, porous media, colloids).
+ *
+ *****************************************************************************/
+
+__host__ int pth_fused_set(pth_t * pth, int fused) {
+
+  int ndevice;
+  int nhalo;
+  int nlocal[3];
+  double * tmp = NULL;
+
+  assert(pth);
+
+  if (pth->method != PTH_METHOD_DIVERGENCE) return 0;
+  if (fused == 0 || pth->fused) return 0;
+
+  cs_nhalo(pth->cs, &nhalo);
+  cs_nlocal(pth->cs, nlocal);
+
+  pth->fused = 1;
+  pth->nxs = (nlocal[Y] + 2*nhalo)*(nlocal[Z] + 2*nhalo);
+
+  pth->pbuf = (double *) calloc(3*3*3*pth->nxs, sizeof(double));
+  if (pth->pbuf == NULL) pe_fatal(pth->pe, "calloc(pth->pbuf) failed\n");
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    tdpMalloc((void **) &tmp, 3*3*3*pth->nxs*sizeof(double));
+    tdpMemset(tmp, 0, 3*3*3*pth->nxs*sizeof(double));
+    tdpMemcpy(&pth->target->pbuf, &tmp, sizeof(double *),
+	      tdpMemcpyHostToDevice);
+    tdpMemcpy(&pth->target->fused, &pth->fused, sizeof(int),
+	      tdpMemcpyHostToDevice);
+    tdpMemcpy(&pth->target->nxs, &pth->nxs, sizeof(int),
+	      tdpMemcpyHostToDevice);
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  pth_free
@@ -108,9 +178,14 @@ __host__ int pth_free(pth_t * pth) {
     tdpMemcpy(&tmp, &pth->target->str, sizeof(double *),
 	      tdpMemcpyDeviceToHost);
     if (tmp) tdpFree(tmp);
+    tmp = NULL;
+    tdpMemcpy(&tmp, &pth->target->pbuf, sizeof(double *),
+	      tdpMemcpyDeviceToHost);
+    if (tmp) tdpFree(tmp);
     tdpFree(pth->target);
   }
 
+  if (pth->pbuf) free(pth->pbuf);
   if (pth->str) free(pth->str);
   free(pth);
 
@@ -180,6 +255,8 @@ __host__ int pth_stress_compute(pth_t * pth, fe_t * fe) {
   assert(fe);
   assert(fe->func->target);
 
+  if (pth->str == NULL) pth_str_alloc(pth);
+
   cs_nlocal(pth->cs, nlocal);
   nextra = 1; /* Limits extend one point into the halo */
 
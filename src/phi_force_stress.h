@@ -9,7 +9,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2017 The University of Edinburgh
+ *  (c) 2012-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -31,6 +31,7 @@ __host__ int pth_create(pe_t * pe, cs_t * cs, int method, pth_t ** pth);
 __host__ int pth_free(pth_t * pth);
 __host__ int pth_memcpy(pth_t * pth, tdpMemcpyKind flag);
 __host__ int pth_stress_compute(pth_t * pth, fe_t * fe);
+__host__ int pth_fused_set(pth_t * pth, int fused);
 
 __host__ __device__ void pth_stress(pth_t * pth,  int index, double p[3][3]);
 __host__ __device__ void pth_stress_set(pth_t * pth, int index, double p[3][3]);
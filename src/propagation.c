@@ -24,9 +24,9 @@
 #include "propagation.h"
 #include "lb_model_s.h"
 #include "timer.h"
+#include "perf.h"
 
 __host__ int lb_propagation_driver(lb_t * lb);
-__host__ int lb_model_swapf(lb_t * lb);
 
 __global__ void lb_propagation_kernel(kernel_ctxt_t * ktx, lb_t * lb);
 __global__ void lb_propagation_kernel_novector(kernel_ctxt_t * ktx, lb_t * lb);
@@ -60,6 +60,7 @@ __host__ int lb_propagation(lb_t * lb) {
 __host__ int lb_propagation_driver(lb_t * lb) {
 
   int nlocal[3];
+  double nsites;
   dim3 nblk, ntpb;
   kernel_info_t limits;
   kernel_ctxt_t * ctxt = NULL;
@@ -83,6 +84,10 @@ __host__ int lb_propagation_driver(lb_t * lb) {
   kernel_ctxt_create(lb->cs, NSIMDVL, limits, &ctxt);
   kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
+  /* Sparse sweep visits only the active site vectors */
+  if (lb->nsparse) kernel_launch_param(NSIMDVL*lb->nsparse, &nblk, &ntpb);
+
+  perf_region_start("propagation");
   TIMER_start(TIMER_PROP_KERNEL);
 
   tdpLaunchKernel(lb_propagation_kernel, nblk, ntpb, 0, 0,
@@ -92,6 +97,13 @@ __host__ int lb_propagation_driver(lb_t * lb) {
 
   TIMER_stop(TIMER_PROP_KERNEL);
 
+  /* Each distribution is read once and written once */
+
+  nsites = 1.0*nlocal[X]*nlocal[Y]*nlocal[Z];
+  if (lb->nsparse) nsites = 1.0*NSIMDVL*lb->nsparse;
+  perf_region_work(nsites, 2.0*nsites*lb->ndist*NVEL*sizeof(lb_data_t), 0.0);
+  perf_region_stop("propagation");
+
   kernel_ctxt_free(ctxt);
 
   lb_model_swapf(lb);
@@ -153,7 +165,8 @@ __global__ void lb_propagation_kernel_novector(kernel_ctxt_t * ktx, lb_t * lb) {
  *
  *  lb_propagation_kernel
  *
- *  A vectorised version.
+ *  A vectorised version. If a sparse list is present, only the
+ *  active site vectors are visited (see lb_sparse_set()).
  *
  *  Notes.
  *  GPU: Constants must come from static __constant__ memory
@@ -163,28 +176,31 @@ __global__ void lb_propagation_kernel_novector(kernel_ctxt_t * ktx, lb_t * lb) {
 
 __global__ void lb_propagation_kernel(kernel_ctxt_t * ktx, lb_t * lb) {
 
-  int kindex;
+  int ks;
   int kiter;
-  double * __restrict__ f;
-  double * __restrict__ fprime;
+  lb_data_t * __restrict__ f;
+  lb_data_t * __restrict__ fprime;
 
   assert(lb);
 
   kiter = kernel_vector_iterations(ktx);
+  if (lb->nsparse) kiter = NSIMDVL*lb->nsparse;
   f = lb->f;
   fprime = lb->fprime;
 
-  for_simt_parallel(kindex, kiter, NSIMDVL) {
+  for_simt_parallel(ks, kiter, NSIMDVL) {
 
     int iv;
     int n, p;
     int index0;
+    int kindex;
     int ic[NSIMDVL];
     int jc[NSIMDVL];
     int kc[NSIMDVL];
     int maskv[NSIMDVL];
     int indexp[NSIMDVL];
 
+    kindex = (lb->nsparse) ? lb->sparse[ks/NSIMDVL] : ks;
     kernel_coords_v(ktx, kindex, ic, jc, kc);
     kernel_mask_v(ktx, ic, jc, kc, maskv);
 
@@ -225,8 +241,8 @@ __global__ void lb_propagation_kernel(kernel_ctxt_t * ktx, lb_t * lb) {
 __host__ int lb_model_swapf(lb_t * lb) {
 
   int ndevice;
-  double * tmp1;
-  double * tmp2;
+  lb_data_t * tmp1;
+  lb_data_t * tmp2;
 
   assert(lb);
   assert(lb->target);
@@ -239,14 +255,14 @@ __host__ int lb_model_swapf(lb_t * lb) {
     lb->fprime = tmp1;
   }
   else {
-    tdpAssert(tdpMemcpy(&tmp1, &lb->target->f, sizeof(double *),
+    tdpAssert(tdpMemcpy(&tmp1, &lb->target->f, sizeof(lb_data_t *),
 			tdpMemcpyDeviceToHost));
-    tdpAssert(tdpMemcpy(&tmp2, &lb->target->fprime, sizeof(double *),
+    tdpAssert(tdpMemcpy(&tmp2, &lb->target->fprime, sizeof(lb_data_t *),
 			tdpMemcpyDeviceToHost)); 
 
-    tdpAssert(tdpMemcpy(&lb->target->f, &tmp2, sizeof(double *),
+    tdpAssert(tdpMemcpy(&lb->target->f, &tmp2, sizeof(lb_data_t *),
 			tdpMemcpyHostToDevice));
-    tdpAssert(tdpMemcpy(&lb->target->fprime, &tmp1, sizeof(double *),
+    tdpAssert(tdpMemcpy(&lb->target->fprime, &tmp1, sizeof(lb_data_t *),
 			tdpMemcpyHostToDevice));
   }
 
@@ -19,5 +19,6 @@
 #include "model.h"
 
 __host__ int lb_propagation(lb_t * lb);
+__host__ int lb_model_swapf(lb_t * lb);
 
 #endif
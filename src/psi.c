@@ -33,6 +33,7 @@
 #include "map.h"
 #include "psi_s.h"
 #include "psi_gradients.h"
+#include "psi_mg.h"
 #include "physics.h"
 
 static const double  e_unit_default = 1.0;              /* Default unit charge */
@@ -302,6 +303,7 @@ void psi_free(psi_t * obj) {
   }
 
   if (obj->info) io_info_free(obj->info);
+  if (obj->mg) psi_mg_free(obj->mg);
 
   free(obj->valency);
   free(obj->diffusivity);
@@ -1302,6 +1304,38 @@ int psi_force_method_set(psi_t * psi, int flag) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  psi_solver
+ *
+ *****************************************************************************/
+
+int psi_solver(psi_t * psi, int * solver) {
+
+  assert(psi);
+  assert(solver);
+
+  *solver = psi->solver;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_solver_set
+ *
+ *****************************************************************************/
+
+int psi_solver_set(psi_t * psi, int solver) {
+
+  assert(psi);
+  assert(solver >= 0 && solver < PSI_POISSON_NTYPES);
+
+  psi->solver = solver;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  psi_nfreq_set
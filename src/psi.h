@@ -34,6 +34,13 @@ enum psi_force_method {PSI_FORCE_NONE = 0,
 		       PSI_FORCE_NTYPES
 };
 
+/* Poisson solver (in the absence of PETSc) */
+
+enum psi_poisson_solver {PSI_POISSON_SOR = 0,
+			 PSI_POISSON_MULTIGRID,
+			 PSI_POISSON_NTYPES
+};
+
 typedef struct psi_s psi_t;
 
 /* f_vare_t describes the signature of the function expected
@@ -93,6 +100,8 @@ int psi_skipsteps_set(psi_t * obj, double skipsteps);
 int psi_zero_mean(psi_t * obj);
 int psi_force_method(psi_t * obj, int * flag);
 int psi_force_method_set(psi_t * obj, int flag);
+int psi_solver(psi_t * obj, int * solver);
+int psi_solver_set(psi_t * obj, int solver);
 
 int psi_electroneutral(psi_t * obj, map_t * map);
 #endif
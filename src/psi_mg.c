@@ -0,0 +1,1051 @@
+/*****************************************************************************
+ *
+ *  psi_mg.c
+ *
+ *  Geometric multigrid solution of the Poisson equation
+ *
+ *    div [epsilon(r) grad psi(r)] = -rho_elec(r)
+ *
+ *  for the potential stored in the psi_t object. The fine grid
+ *  operator is exactly that of psi_sor.c (uniform or variable
+ *  permittivity), so the same tolerances apply and the two solvers
+ *  agree to within the tolerance.
+ *
+ *  The solution is by V-cycles with red/black Gauss-Seidel smoothing.
+ *  Coarse grids are cell-centred: a coarse cell is the union of two
+ *  fine cells in each coarsened direction. The residual is restricted
+ *  by averaging; the correction is prolongated by (tri)linear
+ *  interpolation. Coarse grid operators are rediscretised with the
+ *  restricted (averaged) permittivity.
+ *
+ *  A direction is coarsened while the number of points is even (and
+ *  greater than 2), and, while distributed, even on every rank. When
+ *  the local grid becomes small, or cannot be coarsened further, the
+ *  coarse grid is agglomerated: every rank gathers the whole grid and
+ *  the remaining levels are computed redundantly without further
+ *  communication. The coarsest grid is relaxed to a fixed reduction
+ *  in the residual.
+ *
+ *  The number of V-cycles required is then independent of system
+ *  size, provided the number of points in each direction is of the
+ *  form 2^n m with m small.
+ *
+ *  Boundary conditions for the correction are periodic, or zero
+ *  normal gradient in non-periodic directions, as for the potential
+ *  (see psi_halo_psijump()).
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "physics.h"
+#include "control.h"
+#include "util.h"
+#include "psi_s.h"
+#include "psi_mg.h"
+
+#define PSI_MG_NLEVEL_MAX     32     /* Maximum number of levels */
+#define PSI_MG_NLOCAL_MIN     64     /* Agglomerate below this many sites */
+#define PSI_MG_NPRE            2     /* Pre-smoothing sweeps */
+#define PSI_MG_NPOST           2     /* Post-smoothing sweeps */
+#define PSI_MG_COARSE_RTOL 1.0e-03   /* Residual reduction on coarsest grid */
+#define PSI_MG_COARSE_MAX   1000     /* Maximum sweeps on coarsest grid */
+
+typedef struct psi_mg_level_s psi_mg_level_t;
+
+struct psi_mg_level_s {
+  int gather;               /* Agglomerated copy of level above */
+  int replicated;           /* Whole grid held by every rank */
+  int nhalo;                /* Halo width */
+  int nlocal[3];            /* Local extent */
+  int noffset[3];           /* Global offset of local extent */
+  int ntotal[3];            /* Global extent */
+  int nfac[3];              /* Coarsening factor (1 or 2) from level above */
+  int str[3];               /* Memory strides */
+  int nsites;               /* Sites including halo */
+  double rh2[3];            /* 1/h^2 in each direction */
+  double * u;               /* Solution (level 0) or correction */
+  double * f;               /* Right-hand side */
+  double * r;               /* Residual */
+  double * eps;             /* Permittivity */
+};
+
+struct psi_mg_s {
+  pe_t * pe;
+  cs_t * cs;
+  psi_t * psi;              /* Current problem */
+  int nlevel;
+  int ncycle;               /* V-cycles at last solve */
+  int nrank;
+  int nmax;                 /* Largest local grid at agglomeration */
+  int * glocal;             /* nlocal[3], noffset[3] per rank [6*nrank] */
+  double * gsend;           /* Agglomeration buffers */
+  double * grecv;
+  double * hbuf;            /* Halo buffers [4*nplane] */
+  int nplane;
+  psi_mg_level_t level[PSI_MG_NLEVEL_MAX];
+};
+
+static int psi_mg_level_init(psi_mg_t * mg, int l);
+static int psi_mg_vcycle(psi_mg_t * mg, int l);
+static int psi_mg_coarse(psi_mg_t * mg, int l);
+static int psi_mg_smooth(psi_mg_t * mg, int l, int nsweep);
+static int psi_mg_residual(psi_mg_t * mg, int l, double * rnorm);
+static int psi_mg_restrict(psi_mg_t * mg, int l, const double * src,
+			   double * dst);
+static int psi_mg_prolong(psi_mg_t * mg, int l);
+static int psi_mg_gather(psi_mg_t * mg, int l, const double * src,
+			 double * dst);
+static int psi_mg_scatter(psi_mg_t * mg, int l);
+static int psi_mg_halo(psi_mg_t * mg, int l, double * a);
+static int psi_mg_mean_zero(psi_mg_t * mg, int l, double * a);
+
+/*****************************************************************************
+ *
+ *  psi_mg_index
+ *
+ *****************************************************************************/
+
+static inline int psi_mg_index(const psi_mg_level_t * lvl, int ic, int jc,
+			       int kc) {
+
+  return lvl->str[X]*(ic + lvl->nhalo - 1) + lvl->str[Y]*(jc + lvl->nhalo - 1)
+    + lvl->str[Z]*(kc + lvl->nhalo - 1);
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_apply
+ *
+ *  The operator at site index: as psi_sor_vare_poisson(), with
+ *  spacing h in each direction.
+ *
+ *****************************************************************************/
+
+static inline double psi_mg_apply(const psi_mg_level_t * lvl,
+				  const double * u, int index) {
+  int ia, s;
+  double au = 0.0;
+  const double * eps = lvl->eps;
+
+  for (ia = 0; ia < 3; ia++) {
+    s = lvl->str[ia];
+    au += lvl->rh2[ia]*(eps[index]*(u[index+s] + u[index-s] - 2.0*u[index])
+			+ 0.25*(eps[index+s] - eps[index-s])
+			*(u[index+s] - u[index-s]));
+  }
+
+  return au;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_create
+ *
+ *  Set up the hierarchy of grids appropriate for cs.
+ *
+ *****************************************************************************/
+
+int psi_mg_create(pe_t * pe, cs_t * cs, psi_mg_t ** pobj) {
+
+  int ia, l, n;
+  int nhalo;
+  int ncoarsen;
+  int cartsz[3];
+  int iseven[3];
+  int nsites;
+  int nplane;
+  int glocal[6];
+  psi_mg_t * mg = NULL;
+  psi_mg_level_t * lvl = NULL;
+  psi_mg_level_t * next = NULL;
+  MPI_Comm comm;
+
+  assert(pe);
+  assert(cs);
+  assert(pobj);
+
+  mg = (psi_mg_t *) calloc(1, sizeof(psi_mg_t));
+  assert(mg);
+  if (mg == NULL) pe_fatal(pe, "calloc(psi_mg_t) failed\n");
+
+  mg->pe = pe;
+  mg->cs = cs;
+  mg->nrank = pe_mpi_size(pe);
+
+  cs_cart_comm(cs, &comm);
+  cs_cartsz(cs, cartsz);
+  cs_nhalo(cs, &nhalo);
+
+  /* Level 0 shares the layout of the potential */
+
+  lvl = mg->level;
+  lvl->nhalo = nhalo;
+  cs_nlocal(cs, lvl->nlocal);
+  cs_nlocal_offset(cs, lvl->noffset);
+  cs_ntotal(cs, lvl->ntotal);
+  cs_strides(cs, lvl->str + X, lvl->str + Y, lvl->str + Z);
+  cs_nsites(cs, &lvl->nsites);
+  for (ia = 0; ia < 3; ia++) {
+    lvl->nfac[ia] = 1;
+    lvl->rh2[ia] = 1.0;
+  }
+  mg->nlevel = 1;
+
+  /* Coarser levels */
+
+  for (l = 0; l < PSI_MG_NLEVEL_MAX - 1; l++) {
+
+    lvl = mg->level + l;
+    next = mg->level + l + 1;
+    *next = *lvl;
+    next->gather = 0;
+    next->nhalo = 1;
+
+    for (ia = 0; ia < 3; ia++) {
+      n = lvl->replicated ? lvl->ntotal[ia] : lvl->nlocal[ia];
+      iseven[ia] = (n % 2 == 0);
+    }
+    if (lvl->replicated == 0) {
+      MPI_Allreduce(MPI_IN_PLACE, iseven, 3, MPI_INT, MPI_LAND, comm);
+    }
+
+    ncoarsen = 0;
+    for (ia = 0; ia < 3; ia++) {
+      next->nfac[ia] = 1;
+      if (iseven[ia] && lvl->ntotal[ia] > 2) next->nfac[ia] = 2;
+      ncoarsen += (next->nfac[ia] == 2);
+    }
+
+    nsites = lvl->nlocal[X]*lvl->nlocal[Y]*lvl->nlocal[Z];
+    MPI_Allreduce(MPI_IN_PLACE, &nsites, 1, MPI_INT, MPI_MIN, comm);
+
+    if (lvl->replicated == 0 && mg->nrank > 1 && l > 0 &&
+	(ncoarsen == 0 || nsites < PSI_MG_NLOCAL_MIN)) {
+
+      /* Agglomerate: same grid, held in full by all ranks */
+
+      next->gather = 1;
+      next->replicated = 1;
+      for (ia = 0; ia < 3; ia++) {
+	next->nfac[ia] = 1;
+	next->nlocal[ia] = lvl->ntotal[ia];
+	next->noffset[ia] = 0;
+      }
+
+      for (ia = 0; ia < 3; ia++) {
+	glocal[ia] = lvl->nlocal[ia];
+	glocal[3 + ia] = lvl->noffset[ia];
+      }
+      mg->glocal = (int *) calloc(6*mg->nrank, sizeof(int));
+      assert(mg->glocal);
+      if (mg->glocal == NULL) pe_fatal(pe, "calloc(glocal) failed\n");
+
+      MPI_Allgather(glocal, 6, MPI_INT, mg->glocal, 6, MPI_INT, comm);
+
+      mg->nmax = 0;
+      for (n = 0; n < mg->nrank; n++) {
+	nsites = mg->glocal[6*n + X]*mg->glocal[6*n + Y]*mg->glocal[6*n + Z];
+	mg->nmax = imax(mg->nmax, nsites);
+      }
+      mg->gsend = (double *) calloc(mg->nmax, sizeof(double));
+      mg->grecv = (double *) calloc((size_t) mg->nrank*mg->nmax,
+				    sizeof(double));
+      assert(mg->gsend);
+      assert(mg->grecv);
+      if (mg->grecv == NULL) pe_fatal(pe, "calloc(grecv) failed\n");
+    }
+    else {
+
+      if (ncoarsen == 0) break;
+
+      for (ia = 0; ia < 3; ia++) {
+	next->nlocal[ia]  = lvl->nlocal[ia]/next->nfac[ia];
+	next->noffset[ia] = lvl->noffset[ia]/next->nfac[ia];
+	next->ntotal[ia]  = lvl->ntotal[ia]/next->nfac[ia];
+	next->rh2[ia] = lvl->rh2[ia]/(next->nfac[ia]*next->nfac[ia]);
+      }
+    }
+
+    next->str[Z] = 1;
+    next->str[Y] = next->str[Z]*(next->nlocal[Z] + 2);
+    next->str[X] = next->str[Y]*(next->nlocal[Y] + 2);
+    next->nsites = next->str[X]*(next->nlocal[X] + 2);
+
+    mg->nlevel += 1;
+  }
+
+  /* Storage (level 0 u is the potential itself) and halo buffers */
+
+  nplane = 0;
+  for (l = 0; l < mg->nlevel; l++) {
+    psi_mg_level_init(mg, l);
+    lvl = mg->level + l;
+    n = 2*lvl->nhalo;
+    nplane = imax(nplane, (lvl->nlocal[X] + n)*(lvl->nlocal[Y] + n));
+    nplane = imax(nplane, (lvl->nlocal[X] + n)*(lvl->nlocal[Z] + n));
+    nplane = imax(nplane, (lvl->nlocal[Y] + n)*(lvl->nlocal[Z] + n));
+  }
+
+  mg->nplane = nplane;
+  mg->hbuf = (double *) calloc(4*nplane, sizeof(double));
+  assert(mg->hbuf);
+  if (mg->hbuf == NULL) pe_fatal(pe, "calloc(hbuf) failed\n");
+
+  *pobj = mg;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_level_init
+ *
+ *****************************************************************************/
+
+static int psi_mg_level_init(psi_mg_t * mg, int l) {
+
+  psi_mg_level_t * lvl = NULL;
+
+  assert(mg);
+  assert(0 <= l && l < mg->nlevel);
+
+  lvl = mg->level + l;
+
+  if (l > 0) {
+    lvl->u = (double *) calloc(lvl->nsites, sizeof(double));
+    assert(lvl->u);
+    if (lvl->u == NULL) pe_fatal(mg->pe, "calloc(mg->u) failed\n");
+  }
+
+  lvl->f = (double *) calloc(lvl->nsites, sizeof(double));
+  lvl->r = (double *) calloc(lvl->nsites, sizeof(double));
+  lvl->eps = (double *) calloc(lvl->nsites, sizeof(double));
+  assert(lvl->f);
+  assert(lvl->r);
+  assert(lvl->eps);
+
+  if (lvl->f == NULL) pe_fatal(mg->pe, "calloc(mg->f) failed\n");
+  if (lvl->r == NULL) pe_fatal(mg->pe, "calloc(mg->r) failed\n");
+  if (lvl->eps == NULL) pe_fatal(mg->pe, "calloc(mg->eps) failed\n");
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_free
+ *
+ *****************************************************************************/
+
+int psi_mg_free(psi_mg_t * mg) {
+
+  int l;
+
+  assert(mg);
+
+  for (l = 0; l < mg->nlevel; l++) {
+    if (l > 0) free(mg->level[l].u);
+    free(mg->level[l].f);
+    free(mg->level[l].r);
+    free(mg->level[l].eps);
+  }
+
+  free(mg->hbuf);
+  free(mg->grecv);
+  free(mg->gsend);
+  free(mg->glocal);
+  free(mg);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_nlevel
+ *
+ *****************************************************************************/
+
+int psi_mg_nlevel(psi_mg_t * mg, int * nlevel) {
+
+  assert(mg);
+  assert(nlevel);
+
+  *nlevel = mg->nlevel;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_ncycle
+ *
+ *  Number of V-cycles taken at the last solve.
+ *
+ *****************************************************************************/
+
+int psi_mg_ncycle(psi_mg_t * mg, int * ncycle) {
+
+  assert(mg);
+  assert(ncycle);
+
+  *ncycle = mg->ncycle;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_solve
+ *
+ *  As psi_sor_solve(): if fepsilon is NULL, the permittivity is
+ *  uniform. The grid hierarchy is retained by the psi_t object.
+ *
+ *****************************************************************************/
+
+int psi_mg_solve(psi_t * obj, fe_t * fe, f_vare_t fepsilon) {
+
+  assert(obj);
+
+  if (obj->mg == NULL) psi_mg_create(obj->pe, obj->cs, &obj->mg);
+
+  psi_mg_poisson(obj->mg, obj, fe, fepsilon);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_poisson
+ *
+ *  Iterate V-cycles until the norm of the residual (as for SOR, the
+ *  sum of the absolute values over sites) meets either the absolute
+ *  or relative tolerance, or the maximum number of iterations (here
+ *  V-cycles) is reached.
+ *
+ *****************************************************************************/
+
+int psi_mg_poisson(psi_mg_t * mg, psi_t * obj, fe_t * fe, f_vare_t fepsilon) {
+
+  int ic, jc, kc, index;
+  int l, n;
+  int niteration;
+  double rho_elec;
+  double epsilon;
+  double eunit, beta;
+  double tol_rel, tol_abs;
+  double rnorm[2];             /* Initial and current norm of residual */
+  double rnorm_local;
+  double ltot[3];
+  psi_mg_level_t * lvl = mg->level;
+  physics_t * phys = NULL;
+  MPI_Comm comm;
+
+  assert(mg);
+  assert(obj);
+  assert(obj->cs == mg->cs);
+
+  physics_ref(&phys);
+  cs_ltot(obj->cs, ltot);
+  cs_cart_comm(obj->cs, &comm);
+
+  psi_epsilon(obj, &epsilon);
+  psi_reltol(obj, &tol_rel);
+  psi_abstol(obj, &tol_abs);
+  psi_maxits(obj, &niteration);
+  psi_beta(obj, &beta);
+  psi_unit_charge(obj, &eunit);
+
+  mg->psi = obj;
+  lvl->u = obj->psi;
+
+  /* Fine grid right-hand side, and permittivity including one
+   * point of halo */
+
+  for (ic = 0; ic <= lvl->nlocal[X] + 1; ic++) {
+    for (jc = 0; jc <= lvl->nlocal[Y] + 1; jc++) {
+      for (kc = 0; kc <= lvl->nlocal[Z] + 1; kc++) {
+
+	index = cs_index(obj->cs, ic, jc, kc);
+
+	/* Non-dimensional potential in Poisson eqn requires e/kT */
+	psi_rho_elec(obj, index, &rho_elec);
+	lvl->f[index] = -eunit*beta*rho_elec;
+
+	lvl->eps[index] = epsilon;
+	if (fepsilon) fepsilon(fe, index, lvl->eps + index);
+      }
+    }
+  }
+
+  /* Coarse grid permittivity */
+
+  for (l = 1; l < mg->nlevel; l++) {
+    if (mg->level[l].gather) {
+      psi_mg_gather(mg, l - 1, mg->level[l-1].eps, mg->level[l].eps);
+    }
+    else {
+      psi_mg_restrict(mg, l - 1, mg->level[l-1].eps, mg->level[l].eps);
+    }
+    psi_mg_halo(mg, l, mg->level[l].eps);
+  }
+
+  psi_halo_psi(obj);
+  psi_halo_psijump(obj);
+
+  psi_mg_residual(mg, 0, &rnorm_local);
+  MPI_Allreduce(&rnorm_local, rnorm, 1, MPI_DOUBLE, MPI_SUM, comm);
+  rnorm[1] = rnorm[0];
+
+  for (n = 0; n < niteration; n++) {
+
+    if (rnorm[1] < tol_abs) {
+      if (physics_control_timestep(phys) % obj->nfreq == 0) {
+	pe_info(obj->pe, "\n");
+	pe_info(obj->pe, "Multigrid solver converged to absolute tolerance\n");
+	pe_info(obj->pe, "Multigrid residual per site %14.7e at %d V-cycles\n",
+		rnorm[1]/(ltot[X]*ltot[Y]*ltot[Z]), n);
+      }
+      break;
+    }
+
+    if (rnorm[1] < tol_rel*rnorm[0]) {
+      if (physics_control_timestep(phys) % obj->nfreq == 0) {
+	pe_info(obj->pe, "\n");
+	pe_info(obj->pe, "Multigrid solver converged to relative tolerance\n");
+	pe_info(obj->pe, "Multigrid residual per site %14.7e at %d V-cycles\n",
+		rnorm[1]/(ltot[X]*ltot[Y]*ltot[Z]), n);
+      }
+      break;
+    }
+
+    psi_mg_vcycle(mg, 0);
+
+    psi_mg_residual(mg, 0, &rnorm_local);
+    MPI_Allreduce(&rnorm_local, rnorm + 1, 1, MPI_DOUBLE, MPI_SUM, comm);
+  }
+
+  if (n == niteration) {
+    pe_info(obj->pe, "\n");
+    pe_info(obj->pe, "Multigrid solver exceeded %d V-cycles\n", n);
+    pe_info(obj->pe, "Multigrid residual %le (initial) %le (final)\n\n",
+	    rnorm[0], rnorm[1]);
+  }
+
+  mg->ncycle = n;
+  mg->psi = NULL;
+  lvl->u = NULL;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_vcycle
+ *
+ *  On entry, the halo of u at level l must be up-to-date; f is the
+ *  right-hand side.
+ *
+ *****************************************************************************/
+
+static int psi_mg_vcycle(psi_mg_t * mg, int l) {
+
+  psi_mg_level_t * lvl = NULL;
+  psi_mg_level_t * next = NULL;
+
+  assert(mg);
+
+  if (l == mg->nlevel - 1) return psi_mg_coarse(mg, l);
+
+  lvl = mg->level + l;
+  next = mg->level + l + 1;
+
+  memset(next->u, 0, next->nsites*sizeof(double));
+
+  if (next->gather) {
+    /* No work at this level: hand over to the agglomerated grid */
+    psi_mg_gather(mg, l, lvl->f, next->f);
+    psi_mg_vcycle(mg, l + 1);
+    psi_mg_scatter(mg, l);
+    return 0;
+  }
+
+  psi_mg_smooth(mg, l, PSI_MG_NPRE);
+  psi_mg_residual(mg, l, NULL);
+  psi_mg_restrict(mg, l, lvl->r, next->f);
+
+  psi_mg_vcycle(mg, l + 1);
+
+  psi_mg_halo(mg, l + 1, next->u);
+  psi_mg_prolong(mg, l);
+  psi_mg_halo(mg, l, lvl->u);
+  psi_mg_smooth(mg, l, PSI_MG_NPOST);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_coarse
+ *
+ *  Relax on the coarsest grid until the residual is reduced by a
+ *  fixed factor. This grid is not distributed, so there is no
+ *  communication. In the fully periodic case, the problem is
+ *  singular, and the mean is removed from both f and u.
+ *
+ *****************************************************************************/
+
+static int psi_mg_coarse(psi_mg_t * mg, int l) {
+
+  int n;
+  int periodic[3];
+  double rnorm0, rnorm;
+  psi_mg_level_t * lvl = mg->level + l;
+
+  assert(mg);
+  assert(l > 0);
+  assert(lvl->replicated || mg->nrank == 1);
+
+  cs_periodic(mg->cs, periodic);
+
+  if (periodic[X] && periodic[Y] && periodic[Z]) psi_mg_mean_zero(mg, l, lvl->f);
+
+  psi_mg_residual(mg, l, &rnorm0);
+
+  for (n = 0; n < PSI_MG_COARSE_MAX; n += 4) {
+    psi_mg_smooth(mg, l, 4);
+    psi_mg_residual(mg, l, &rnorm);
+    if (rnorm <= PSI_MG_COARSE_RTOL*rnorm0) break;
+  }
+
+  if (periodic[X] && periodic[Y] && periodic[Z]) {
+    psi_mg_mean_zero(mg, l, lvl->u);
+    psi_mg_halo(mg, l, lvl->u);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_smooth
+ *
+ *  Red/black Gauss-Seidel with colour by global position; halo swap
+ *  after each colour.
+ *
+ *****************************************************************************/
+
+static int psi_mg_smooth(psi_mg_t * mg, int l, int nsweep) {
+
+  int ic, jc, kc, index;
+  int kst;
+  int n, pass;
+  double diag;
+  psi_mg_level_t * lvl = mg->level + l;
+  double * u = lvl->u;
+
+  assert(mg);
+
+  for (n = 0; n < nsweep; n++) {
+    for (pass = 0; pass < 2; pass++) {
+
+      for (ic = 1; ic <= lvl->nlocal[X]; ic++) {
+	for (jc = 1; jc <= lvl->nlocal[Y]; jc++) {
+	  kst = 1 + (lvl->noffset[X] + ic + lvl->noffset[Y] + jc
+		     + lvl->noffset[Z] + 1 + pass) % 2;
+	  for (kc = kst; kc <= lvl->nlocal[Z]; kc += 2) {
+
+	    index = psi_mg_index(lvl, ic, jc, kc);
+
+	    diag = -2.0*lvl->eps[index]*(lvl->rh2[X] + lvl->rh2[Y]
+					 + lvl->rh2[Z]);
+	    u[index] += (lvl->f[index] - psi_mg_apply(lvl, u, index))/diag;
+	  }
+	}
+      }
+
+      psi_mg_halo(mg, l, u);
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_residual
+ *
+ *  r = f - Au at level l. If rnorm is not NULL, the local sum of
+ *  the absolute value of the residual is returned.
+ *
+ *****************************************************************************/
+
+static int psi_mg_residual(psi_mg_t * mg, int l, double * rnorm) {
+
+  int ic, jc, kc, index;
+  double rsum = 0.0;
+  psi_mg_level_t * lvl = mg->level + l;
+
+  assert(mg);
+
+  for (ic = 1; ic <= lvl->nlocal[X]; ic++) {
+    for (jc = 1; jc <= lvl->nlocal[Y]; jc++) {
+      for (kc = 1; kc <= lvl->nlocal[Z]; kc++) {
+	index = psi_mg_index(lvl, ic, jc, kc);
+	lvl->r[index] = lvl->f[index] - psi_mg_apply(lvl, lvl->u, index);
+	rsum += fabs(lvl->r[index]);
+      }
+    }
+  }
+
+  if (rnorm) *rnorm = rsum;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_restrict
+ *
+ *  Average of src over the fine cells at level l making up each
+ *  coarse cell of dst at level l + 1 (interior only).
+ *
+ *****************************************************************************/
+
+static int psi_mg_restrict(psi_mg_t * mg, int l, const double * src,
+			   double * dst) {
+  int ic, jc, kc;
+  int ia, ja, ka;
+  double sum, rnorm;
+  psi_mg_level_t * lvl = mg->level + l;
+  psi_mg_level_t * next = mg->level + l + 1;
+
+  assert(mg);
+  assert(l + 1 < mg->nlevel);
+  assert(next->gather == 0);
+
+  rnorm = 1.0/(next->nfac[X]*next->nfac[Y]*next->nfac[Z]);
+
+  for (ic = 1; ic <= next->nlocal[X]; ic++) {
+    for (jc = 1; jc <= next->nlocal[Y]; jc++) {
+      for (kc = 1; kc <= next->nlocal[Z]; kc++) {
+
+	sum = 0.0;
+	for (ia = 0; ia < next->nfac[X]; ia++) {
+	  for (ja = 0; ja < next->nfac[Y]; ja++) {
+	    for (ka = 0; ka < next->nfac[Z]; ka++) {
+	      sum += src[psi_mg_index(lvl, next->nfac[X]*(ic - 1) + 1 + ia,
+				      next->nfac[Y]*(jc - 1) + 1 + ja,
+				      next->nfac[Z]*(kc - 1) + 1 + ka)];
+	    }
+	  }
+	}
+	dst[psi_mg_index(next, ic, jc, kc)] = rnorm*sum;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_prolong
+ *
+ *  Add the correction from level l + 1 to u at level l by linear
+ *  interpolation in each coarsened direction: a fine cell takes
+ *  3/4 of its parent and 1/4 of the nearest neighbour of the parent.
+ *  The halo of the coarse correction must be up-to-date.
+ *
+ *****************************************************************************/
+
+static int psi_mg_prolong(psi_mg_t * mg, int l) {
+
+  int ia, n;
+  int ic, jc, kc;
+  int ip[3], in[3];            /* Parent and neighbour coarse positions */
+  double wp[3], wn[3];         /* Weights */
+  double du;
+  psi_mg_level_t * lvl = mg->level + l;
+  psi_mg_level_t * next = mg->level + l + 1;
+  const double * uc = next->u;
+
+  assert(mg);
+  assert(l + 1 < mg->nlevel);
+
+  for (ic = 1; ic <= lvl->nlocal[X]; ic++) {
+    for (jc = 1; jc <= lvl->nlocal[Y]; jc++) {
+      for (kc = 1; kc <= lvl->nlocal[Z]; kc++) {
+
+	int c[3] = {ic, jc, kc};
+
+	for (ia = 0; ia < 3; ia++) {
+	  if (next->nfac[ia] == 2) {
+	    ip[ia] = (c[ia] + 1)/2;
+	    in[ia] = ip[ia] + ((c[ia] % 2) ? -1 : +1);
+	    wp[ia] = 0.75;
+	    wn[ia] = 0.25;
+	  }
+	  else {
+	    ip[ia] = c[ia];
+	    in[ia] = c[ia];
+	    wp[ia] = 1.0;
+	    wn[ia] = 0.0;
+	  }
+	}
+
+	du = 0.0;
+	for (n = 0; n < 8; n++) {
+	  int ix = (n & 4) ? in[X] : ip[X];
+	  int iy = (n & 2) ? in[Y] : ip[Y];
+	  int iz = (n & 1) ? in[Z] : ip[Z];
+	  double w = ((n & 4) ? wn[X] : wp[X])*((n & 2) ? wn[Y] : wp[Y])
+	    *((n & 1) ? wn[Z] : wp[Z]);
+	  if (w > 0.0) du += w*uc[psi_mg_index(next, ix, iy, iz)];
+	}
+
+	lvl->u[psi_mg_index(lvl, ic, jc, kc)] += du;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_gather
+ *
+ *  Assemble the whole of src (distributed at level l) in dst
+ *  (replicated at level l + 1) on every rank. Interior only.
+ *
+ *****************************************************************************/
+
+static int psi_mg_gather(psi_mg_t * mg, int l, const double * src,
+			 double * dst) {
+  int ic, jc, kc, n, nr;
+  int * gl = NULL;
+  psi_mg_level_t * lvl = mg->level + l;
+  psi_mg_level_t * next = mg->level + l + 1;
+  MPI_Comm comm;
+
+  assert(mg);
+  assert(next->gather);
+
+  cs_cart_comm(mg->cs, &comm);
+
+  n = 0;
+  for (ic = 1; ic <= lvl->nlocal[X]; ic++) {
+    for (jc = 1; jc <= lvl->nlocal[Y]; jc++) {
+      for (kc = 1; kc <= lvl->nlocal[Z]; kc++) {
+	mg->gsend[n++] = src[psi_mg_index(lvl, ic, jc, kc)];
+      }
+    }
+  }
+
+  MPI_Allgather(mg->gsend, mg->nmax, MPI_DOUBLE, mg->grecv, mg->nmax,
+		MPI_DOUBLE, comm);
+
+  for (nr = 0; nr < mg->nrank; nr++) {
+    gl = mg->glocal + 6*nr;
+    n = nr*mg->nmax;
+    for (ic = 1; ic <= gl[X]; ic++) {
+      for (jc = 1; jc <= gl[Y]; jc++) {
+	for (kc = 1; kc <= gl[Z]; kc++) {
+	  dst[psi_mg_index(next, gl[3+X] + ic, gl[3+Y] + jc, gl[3+Z] + kc)]
+	    = mg->grecv[n++];
+	}
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_scatter
+ *
+ *  The local part of the replicated solution at level l + 1 becomes
+ *  u at level l (interior only).
+ *
+ *****************************************************************************/
+
+static int psi_mg_scatter(psi_mg_t * mg, int l) {
+
+  int ic, jc, kc;
+  psi_mg_level_t * lvl = mg->level + l;
+  psi_mg_level_t * next = mg->level + l + 1;
+
+  assert(mg);
+  assert(next->gather);
+
+  for (ic = 1; ic <= lvl->nlocal[X]; ic++) {
+    for (jc = 1; jc <= lvl->nlocal[Y]; jc++) {
+      for (kc = 1; kc <= lvl->nlocal[Z]; kc++) {
+	lvl->u[psi_mg_index(lvl, ic, jc, kc)] =
+	  next->u[psi_mg_index(next, lvl->noffset[X] + ic,
+			       lvl->noffset[Y] + jc, lvl->noffset[Z] + kc)];
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_halo
+ *
+ *  Halo of width one for a at level l. Level 0 is the potential, for
+ *  which the psi_t halo (including any jump) is used.
+ *
+ *  Otherwise, each direction in turn (so that edges and corners are
+ *  correct): periodic or zero gradient for a local or replicated
+ *  direction, or exchange with neighbouring ranks.
+ *
+ *****************************************************************************/
+
+static int psi_mg_halo(psi_mg_t * mg, int l, double * a) {
+
+  int ia, ib, ic, n, nb, nc;
+  int c[3];
+  int lo, hi, one, nth;
+  int periodic[3];
+  int cartsz[3];
+  int coords[3];
+  int back, forw;
+  const int tag = 1011;
+  double * sendlo = mg->hbuf;
+  double * sendhi = mg->hbuf + mg->nplane;
+  double * recvlo = mg->hbuf + 2*mg->nplane;
+  double * recvhi = mg->hbuf + 3*mg->nplane;
+  psi_mg_level_t * lvl = mg->level + l;
+  MPI_Comm comm;
+
+  assert(mg);
+
+  if (l == 0 && a == lvl->u) {
+    psi_halo_psi(mg->psi);
+    psi_halo_psijump(mg->psi);
+    return 0;
+  }
+
+  assert(lvl->nhalo == 1);
+
+  cs_periodic(mg->cs, periodic);
+  cs_cartsz(mg->cs, cartsz);
+  cs_cart_coords(mg->cs, coords);
+  cs_cart_comm(mg->cs, &comm);
+
+  for (ia = 0; ia < 3; ia++) {
+
+    ib = (ia + 1) % 3;
+    ic = (ia + 2) % 3;
+
+    if (lvl->replicated || cartsz[ia] == 1) {
+
+      for (nb = 0; nb <= lvl->nlocal[ib] + 1; nb++) {
+	for (nc = 0; nc <= lvl->nlocal[ic] + 1; nc++) {
+	  c[ib] = nb; c[ic] = nc;
+	  c[ia] = 0;                   lo  = psi_mg_index(lvl, c[X], c[Y], c[Z]);
+	  c[ia] = 1;                   one = psi_mg_index(lvl, c[X], c[Y], c[Z]);
+	  c[ia] = lvl->nlocal[ia];     nth = psi_mg_index(lvl, c[X], c[Y], c[Z]);
+	  c[ia] = lvl->nlocal[ia] + 1; hi  = psi_mg_index(lvl, c[X], c[Y], c[Z]);
+	  a[lo] = periodic[ia] ? a[nth] : a[one];
+	  a[hi] = periodic[ia] ? a[one] : a[nth];
+	}
+      }
+    }
+    else {
+
+      back = cs_cart_neighb(mg->cs, CS_BACK, ia);
+      forw = cs_cart_neighb(mg->cs, CS_FORW, ia);
+
+      n = 0;
+      for (nb = 0; nb <= lvl->nlocal[ib] + 1; nb++) {
+	for (nc = 0; nc <= lvl->nlocal[ic] + 1; nc++) {
+	  c[ib] = nb; c[ic] = nc;
+	  c[ia] = 1;               sendlo[n] = a[psi_mg_index(lvl, c[X], c[Y], c[Z])];
+	  c[ia] = lvl->nlocal[ia]; sendhi[n] = a[psi_mg_index(lvl, c[X], c[Y], c[Z])];
+	  n += 1;
+	}
+      }
+
+      MPI_Sendrecv(sendlo, n, MPI_DOUBLE, back, tag, recvhi, n, MPI_DOUBLE,
+		   forw, tag, comm, MPI_STATUS_IGNORE);
+      MPI_Sendrecv(sendhi, n, MPI_DOUBLE, forw, tag, recvlo, n, MPI_DOUBLE,
+		   back, tag, comm, MPI_STATUS_IGNORE);
+
+      n = 0;
+      for (nb = 0; nb <= lvl->nlocal[ib] + 1; nb++) {
+	for (nc = 0; nc <= lvl->nlocal[ic] + 1; nc++) {
+	  c[ib] = nb; c[ic] = nc;
+	  c[ia] = 0;                   lo  = psi_mg_index(lvl, c[X], c[Y], c[Z]);
+	  c[ia] = 1;                   one = psi_mg_index(lvl, c[X], c[Y], c[Z]);
+	  c[ia] = lvl->nlocal[ia];     nth = psi_mg_index(lvl, c[X], c[Y], c[Z]);
+	  c[ia] = lvl->nlocal[ia] + 1; hi  = psi_mg_index(lvl, c[X], c[Y], c[Z]);
+	  a[lo] = recvlo[n];
+	  a[hi] = recvhi[n];
+	  /* Zero gradient at a non-periodic boundary */
+	  if (periodic[ia] == 0 && coords[ia] == 0) a[lo] = a[one];
+	  if (periodic[ia] == 0 && coords[ia] == cartsz[ia] - 1) a[hi] = a[nth];
+	  n += 1;
+	}
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_mg_mean_zero
+ *
+ *  Remove the mean of a at level l, which must not be distributed.
+ *
+ *****************************************************************************/
+
+static int psi_mg_mean_zero(psi_mg_t * mg, int l, double * a) {
+
+  int ic, jc, kc;
+  double sum = 0.0;
+  double rn;
+  psi_mg_level_t * lvl = mg->level + l;
+
+  assert(mg);
+
+  rn = 1.0/(lvl->nlocal[X]*lvl->nlocal[Y]*lvl->nlocal[Z]);
+
+  for (ic = 1; ic <= lvl->nlocal[X]; ic++) {
+    for (jc = 1; jc <= lvl->nlocal[Y]; jc++) {
+      for (kc = 1; kc <= lvl->nlocal[Z]; kc++) {
+	sum += a[psi_mg_index(lvl, ic, jc, kc)];
+      }
+    }
+  }
+
+  for (ic = 1; ic <= lvl->nlocal[X]; ic++) {
+    for (jc = 1; jc <= lvl->nlocal[Y]; jc++) {
+      for (kc = 1; kc <= lvl->nlocal[Z]; kc++) {
+	a[psi_mg_index(lvl, ic, jc, kc)] -= rn*sum;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,32 @@
+/*****************************************************************************
+ *
+ *  psi_mg.h
+ *
+ *  Geometric multigrid solver for the Poisson equation.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef PSI_MG_H
+#define PSI_MG_H
+
+#include "psi.h"
+#include "fe_electro_symmetric.h"
+
+typedef struct psi_mg_s psi_mg_t;
+
+int psi_mg_create(pe_t * pe, cs_t * cs, psi_mg_t ** pobj);
+int psi_mg_free(psi_mg_t * mg);
+int psi_mg_solve(psi_t * obj, fe_t * fe, f_vare_t fepsilon);
+int psi_mg_poisson(psi_mg_t * mg, psi_t * obj, fe_t * fe, f_vare_t fepsilon);
+int psi_mg_nlevel(psi_mg_t * mg, int * nlevel);
+int psi_mg_ncycle(psi_mg_t * mg, int * ncycle);
+
+#endif
@@ -54,6 +54,7 @@ int psi_rt_init_param(pe_t * pe, rt_t * rt, psi_t * obj) {
   int io_format_in = IO_FORMAT_DEFAULT;
   int io_format_out = IO_FORMAT_DEFAULT;
   char value[BUFSIZ] = "BINARY";
+  char solver[BUFSIZ] = "sor";
 
   int multisteps;             /* Number of substeps in NPE */
   int skipsteps;              /* Poisson equation solved every skipstep timesteps */ 
@@ -135,6 +136,21 @@ int psi_rt_init_param(pe_t * pe, rt_t * rt, psi_t * obj) {
   psi_maxits(obj, &niteration);
   pe_info(pe, "Max. no. of iterations:  %16d\n", niteration);
 
+  /* Poisson solver: "sor" (default) or "multigrid" */
+
+  rt_string_parameter(rt, "electrokinetics_solver", solver, BUFSIZ);
+
+  if (strcmp(solver, "sor") == 0) {
+    psi_solver_set(obj, PSI_POISSON_SOR);
+  }
+  else if (strcmp(solver, "multigrid") == 0) {
+    psi_solver_set(obj, PSI_POISSON_MULTIGRID);
+    pe_info(pe, "Poisson solver:             multigrid\n");
+  }
+  else {
+    pe_fatal(pe, "electrokinetics_solver not recognised: %s\n", solver);
+  }
+
   /* Output */
 
   n = 0;
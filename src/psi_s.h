@@ -53,6 +53,7 @@ struct psi_s {
   double reltol;            /* Relative tolerance for Poisson solver */
   double abstol;            /* Absolute tolerance for Poisson solver */
   int method;               /* Force computation method */
+  int solver;               /* Poisson solver (SOR or multigrid) */
   int maxits;               /* Maximum number of iterations */
   int multisteps;           /* Number of substeps in charge dynamics */
   int skipsteps;            /* Poisson equation solved every skipsteps timesteps */
@@ -62,6 +63,7 @@ struct psi_s {
   MPI_Datatype psihalo[3];  /* psi field halo */
   MPI_Datatype rhohalo[3];  /* charge densities halo */
   io_info_t * info;         /* I/O informtation */
+  struct psi_mg_s * mg;     /* Multigrid hierarchy (if required) */
 };
 
 int psi_halo(int nf, double * f, MPI_Datatype halo[3]);
@@ -13,6 +13,9 @@ struct pth_s {
   int method;           /* Method for force computation */
   int nsites;           /* Number of sites allocated */
   double * str;         /* Stress may be antisymmetric */
+  int fused;            /* Divergence computed on the fly (no str) */
+  int nxs;              /* Sites per x-plane (fused) */
+  double * pbuf;        /* Stress in three consecutive x-planes (fused) */
   pth_t * target;       /* Target memory */
 };
 
@@ -0,0 +1,319 @@
+/*****************************************************************************
+ *
+ *  site_sync.c
+ *
+ *  A list of lattice sites whose data are to be copied between host
+ *  and target.
+ *
+ *  Lattice data are usually copied in their entirety, but where only
+ *  a small number of sites is touched on the host (e.g., colloid
+ *  links, or sites which change status when a colloid moves) it is
+ *  better to pack just those sites into a contiguous buffer, copy the
+ *  buffer, and unpack. The data are any rank one object addressed as
+ *  addr_rank1(nsites, na, index, ia) with elements of sz bytes (a
+ *  rank two object na*nb is the same as rank one with na*nb).
+ *
+ *  If there is no device, host and target data alias, and there is
+ *  nothing to copy.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernel.h"
+#include "memory.h"
+#include "site_sync.h"
+
+static int site_sync_reserve(site_sync_t * sync, size_t nbuf);
+
+__global__ void site_sync_pack_kernel(int nlist, const int * list,
+				      int nsites, int na, int sz,
+				      const char * data, char * buf);
+__global__ void site_sync_unpack_kernel(int nlist, const int * list,
+					int nsites, int na, int sz,
+					const char * buf, char * data);
+
+/*****************************************************************************
+ *
+ *  site_sync_create
+ *
+ *****************************************************************************/
+
+__host__ int site_sync_create(pe_t * pe, int nsites, site_sync_t ** pobj) {
+
+  site_sync_t * obj = NULL;
+
+  assert(pe);
+  assert(nsites > 0);
+  assert(pobj);
+
+  obj = (site_sync_t *) calloc(1, sizeof(site_sync_t));
+  assert(obj);
+  if (obj == NULL) pe_fatal(pe, "calloc(site_sync_t) failed\n");
+
+  obj->inlist = (char *) calloc(nsites, sizeof(char));
+  assert(obj->inlist);
+  if (obj->inlist == NULL) pe_fatal(pe, "calloc(sync->inlist) failed\n");
+
+  obj->pe = pe;
+  obj->nsites = nsites;
+
+  *pobj = obj;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  site_sync_free
+ *
+ *****************************************************************************/
+
+__host__ int site_sync_free(site_sync_t * sync) {
+
+  assert(sync);
+
+  if (sync->tlist) tdpFree(sync->tlist);
+  if (sync->tbuf) tdpFree(sync->tbuf);
+  free(sync->hbuf);
+  free(sync->inlist);
+  free(sync->list);
+  free(sync);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  site_sync_add
+ *
+ *  Add site index to the list (if not already present).
+ *
+ *****************************************************************************/
+
+__host__ int site_sync_add(site_sync_t * sync, int index) {
+
+  assert(sync);
+  assert(0 <= index && index < sync->nsites);
+
+  if (sync->inlist[index]) return 0;
+
+  if (sync->nlist == sync->nalloc) {
+    int nalloc = 2*sync->nalloc + 64;
+    int * tmp = (int *) realloc(sync->list, nalloc*sizeof(int));
+    if (tmp == NULL) pe_fatal(sync->pe, "realloc(sync->list) failed\n");
+    sync->list = tmp;
+    sync->nalloc = nalloc;
+  }
+
+  sync->inlist[index] = 1;
+  sync->list[sync->nlist++] = index;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  site_sync_reset
+ *
+ *  Empty the list.
+ *
+ *****************************************************************************/
+
+__host__ int site_sync_reset(site_sync_t * sync) {
+
+  int n;
+
+  assert(sync);
+
+  for (n = 0; n < sync->nlist; n++) {
+    sync->inlist[sync->list[n]] = 0;
+  }
+  sync->nlist = 0;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  site_sync_memcpy
+ *
+ *  Copy na elements of sz bytes at each site in the list from host
+ *  data hdata to target data tdata (tdpMemcpyHostToDevice), or the
+ *  reverse (tdpMemcpyDeviceToHost). tdata is the target address of
+ *  the data proper (not the target copy of the host structure), and
+ *  nsites is the number of sites allocated for the data (which may
+ *  exceed the extent of the list, e.g., with Lees-Edwards planes).
+ *
+ *****************************************************************************/
+
+__host__ int site_sync_memcpy(site_sync_t * sync, void * hdata, void * tdata,
+			      int nsites, int na, size_t sz,
+			      tdpMemcpyKind flag) {
+  int n, ia;
+  int ndevice;
+  size_t nbuf;
+  dim3 nblk, ntpb;
+  char * data = (char *) hdata;
+
+  assert(sync);
+  assert(hdata);
+  assert(nsites >= sync->nsites);
+  assert(na > 0);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice == 0) {
+    /* Host and target alias */
+    assert(hdata == tdata);
+    return 0;
+  }
+
+  if (sync->nlist == 0) return 0;
+
+  nbuf = sync->nlist*na*sz;
+  site_sync_reserve(sync, nbuf);
+
+  tdpMemcpy(sync->tlist, sync->list, sync->nlist*sizeof(int),
+	    tdpMemcpyHostToDevice);
+  kernel_launch_param(sync->nlist, &nblk, &ntpb);
+
+  switch (flag) {
+  case tdpMemcpyHostToDevice:
+    for (n = 0; n < sync->nlist; n++) {
+      for (ia = 0; ia < na; ia++) {
+	memcpy(sync->hbuf + sz*(n*na + ia),
+	       data + sz*addr_rank1(nsites, na, sync->list[n], ia), sz);
+      }
+    }
+    tdpMemcpy(sync->tbuf, sync->hbuf, nbuf, flag);
+    tdpLaunchKernel(site_sync_unpack_kernel, nblk, ntpb, 0, 0,
+		    sync->nlist, sync->tlist, nsites, na, (int) sz,
+		    sync->tbuf, (char *) tdata);
+    tdpAssert(tdpPeekAtLastError());
+    tdpAssert(tdpDeviceSynchronize());
+    break;
+  case tdpMemcpyDeviceToHost:
+    tdpLaunchKernel(site_sync_pack_kernel, nblk, ntpb, 0, 0,
+		    sync->nlist, sync->tlist, nsites, na, (int) sz,
+		    (const char *) tdata, sync->tbuf);
+    tdpAssert(tdpPeekAtLastError());
+    tdpAssert(tdpDeviceSynchronize());
+    tdpMemcpy(sync->hbuf, sync->tbuf, nbuf, flag);
+    for (n = 0; n < sync->nlist; n++) {
+      for (ia = 0; ia < na; ia++) {
+	memcpy(data + sz*addr_rank1(nsites, na, sync->list[n], ia),
+	       sync->hbuf + sz*(n*na + ia), sz);
+      }
+    }
+    break;
+  default:
+    pe_fatal(sync->pe, "Bad flag in site_sync_memcpy()\n");
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  site_sync_reserve
+ *
+ *  Target list for the current list and buffers of at least nbuf
+ *  bytes. Contents are not retained.
+ *
+ *****************************************************************************/
+
+static int site_sync_reserve(site_sync_t * sync, size_t nbuf) {
+
+  assert(sync);
+
+  if (sync->nlist > sync->ntarget) {
+    if (sync->tlist) tdpFree(sync->tlist);
+    tdpAssert(tdpMalloc((void **) &sync->tlist, sync->nalloc*sizeof(int)));
+    sync->ntarget = sync->nalloc;
+  }
+
+  if (nbuf > sync->nbuf) {
+    nbuf = 2*nbuf;
+    free(sync->hbuf);
+    if (sync->tbuf) tdpFree(sync->tbuf);
+    sync->hbuf = (char *) malloc(nbuf);
+    if (sync->hbuf == NULL) pe_fatal(sync->pe, "malloc(sync->hbuf) failed\n");
+    tdpAssert(tdpMalloc((void **) &sync->tbuf, nbuf));
+    sync->nbuf = nbuf;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  site_sync_pack_kernel
+ *
+ *  Gather the listed sites from data to buf.
+ *
+ *****************************************************************************/
+
+__global__ void site_sync_pack_kernel(int nlist, const int * list,
+				      int nsites, int na, int sz,
+				      const char * data, char * buf) {
+  int n;
+
+  assert(list);
+  assert(data);
+  assert(buf);
+
+  for_simt_parallel(n, nlist, 1) {
+    int ia, ib;
+    for (ia = 0; ia < na; ia++) {
+      size_t ibuf = (size_t) sz*(n*na + ia);
+      size_t idata = (size_t) sz*addr_rank1(nsites, na, list[n], ia);
+      for (ib = 0; ib < sz; ib++) {
+	buf[ibuf + ib] = data[idata + ib];
+      }
+    }
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  site_sync_unpack_kernel
+ *
+ *  Scatter buf to the listed sites in data.
+ *
+ *****************************************************************************/
+
+__global__ void site_sync_unpack_kernel(int nlist, const int * list,
+					int nsites, int na, int sz,
+					const char * buf, char * data) {
+  int n;
+
+  assert(list);
+  assert(buf);
+  assert(data);
+
+  for_simt_parallel(n, nlist, 1) {
+    int ia, ib;
+    for (ia = 0; ia < na; ia++) {
+      size_t ibuf = (size_t) sz*(n*na + ia);
+      size_t idata = (size_t) sz*addr_rank1(nsites, na, list[n], ia);
+      for (ib = 0; ib < sz; ib++) {
+	data[idata + ib] = buf[ibuf + ib];
+      }
+    }
+  }
+
+  return;
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ *
+ *  site_sync.h
+ *
+ *  A list of lattice sites whose data are to be copied between host
+ *  and target (e.g., sites changed on the host).
+ *
+ *  The implementation is exposed for the time being.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_SITE_SYNC_H
+#define LUDWIG_SITE_SYNC_H
+
+#include "pe.h"
+
+typedef struct site_sync_s site_sync_t;
+
+/* Each site appears in the list at most once, in the order of the
+ * first addition. The target list and the buffers are only allocated
+ * if there is a device. */
+
+struct site_sync_s {
+  pe_t * pe;              /* Parallel environment */
+  int nsites;             /* Number of lattice sites (allocated) */
+  int nlist;              /* Current number of sites in the list */
+  int nalloc;             /* Capacity of list */
+  int * list;             /* Site indices */
+  char * inlist;          /* inlist[index] is 1 if index is in list */
+  int ntarget;            /* Capacity of target list */
+  int * tlist;            /* Target copy of list */
+  size_t nbuf;            /* Size of buffers (bytes) */
+  char * hbuf;            /* Host buffer */
+  char * tbuf;            /* Target buffer */
+};
+
+__host__ int site_sync_create(pe_t * pe, int nsites, site_sync_t ** pobj);
+__host__ int site_sync_free(site_sync_t * sync);
+__host__ int site_sync_add(site_sync_t * sync, int index);
+__host__ int site_sync_reset(site_sync_t * sync);
+__host__ int site_sync_memcpy(site_sync_t * sync, void * hdata, void * tdata,
+			      int nsites, int na, size_t sz,
+			      tdpMemcpyKind flag);
+
+#endif
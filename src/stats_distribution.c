@@ -8,10 +8,17 @@
  *  If there is more than one distribution, it is assumed the relevant
  *  statistics are produced in the order parameter sector.
  *
+ *  With a device, the reductions are performed on the target, so that
+ *  only the results (and not the distributions) need to be copied back.
+ *  Each block produces a partial result, and the partial results are
+ *  summed in block order on the host. Without a device, the sums are
+ *  made in lattice order on the host, so the results do not depend on
+ *  the number of threads.
+ *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
@@ -20,13 +27,28 @@
 #include <assert.h>
 #include <float.h>
 #include <math.h>
+#include <stdlib.h>
 
 #include "pe.h"
 #include "coords.h"
+#include "kernel.h"
 #include "lb_model_s.h"
+#include "map_s.h"
 #include "util.h"
 #include "stats_distribution.h"
 
+static int stats_distribution_print_target(lb_t * lb, map_t * map,
+					   double stat[5]);
+static int stats_distribution_momentum_target(lb_t * lb, map_t * map,
+					      double g[3]);
+
+__global__ void stats_distribution_print_kernel(kernel_ctxt_t * ktx,
+						lb_t * lb, map_t * map,
+						double * stat);
+__global__ void stats_distribution_momentum_kernel(kernel_ctxt_t * ktx,
+						   lb_t * lb, map_t * map,
+						   double * gm);
+
 /*****************************************************************************
  *
  *  stats_distribution_print
@@ -41,6 +63,7 @@ int stats_distribution_print(lb_t * lb, map_t * map) {
   int ic, jc, kc, index;
   int nlocal[3];
   int status;
+  int ndevice;
 
   double stat_local[5];
   double stat_total[5];
@@ -62,20 +85,27 @@ int stats_distribution_print(lb_t * lb, map_t * map) {
   stat_local[3] = +DBL_MAX;  /* min local density */
   stat_local[4] = -DBL_MAX;  /* max local density */
 
-  for (ic = 1;  ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    stats_distribution_print_target(lb, map, stat_local);
+  }
+  else {
+    for (ic = 1;  ic <= nlocal[X]; ic++) {
+      for (jc = 1; jc <= nlocal[Y]; jc++) {
+	for (kc = 1; kc <= nlocal[Z]; kc++) {
 
-        index = cs_index(lb->cs, ic, jc, kc);
-	map_status(map, index, &status);
-	if (status != MAP_FLUID) continue;
+	  index = cs_index(lb->cs, ic, jc, kc);
+	  map_status(map, index, &status);
+	  if (status != MAP_FLUID) continue;
 
-	lb_0th_moment(lb, index, LB_RHO, &rho);
-	stat_local[0] += 1.0;
-	stat_local[1] += rho;
-	stat_local[2] += rho*rho;
-	stat_local[3] = dmin(rho, stat_local[3]);
-	stat_local[4] = dmax(rho, stat_local[4]);
+	  lb_0th_moment(lb, index, LB_RHO, &rho);
+	  stat_local[0] += 1.0;
+	  stat_local[1] += rho;
+	  stat_local[2] += rho*rho;
+	  stat_local[3] = dmin(rho, stat_local[3]);
+	  stat_local[4] = dmax(rho, stat_local[4]);
+	}
       }
     }
   }
@@ -100,6 +130,158 @@ int stats_distribution_print(lb_t * lb, map_t * map) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  stats_distribution_print_target
+ *
+ *  Accumulate the local statistics stat[5] (which must be initialised)
+ *  on the target. The partial result from each block is returned to
+ *  the host and added in block order, so the result is reproducible.
+ *
+ *****************************************************************************/
+
+static int stats_distribution_print_target(lb_t * lb, map_t * map,
+					   double stat[5]) {
+  int ib, nb;
+  int nlocal[3];
+  dim3 nblk, ntpb;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+
+  double * partial = NULL;
+  double * partial_d = NULL;
+
+  assert(lb);
+  assert(map);
+  assert(stat);
+
+  cs_nlocal(lb->cs, nlocal);
+
+  limits.imin = 1; limits.imax = nlocal[X];
+  limits.jmin = 1; limits.jmax = nlocal[Y];
+  limits.kmin = 1; limits.kmax = nlocal[Z];
+
+  kernel_ctxt_create(lb->cs, 1, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  nb = nblk.x;
+  partial = (double *) malloc(5*nb*sizeof(double));
+  assert(partial);
+  if (partial == NULL) pe_fatal(lb->pe, "malloc(partial) failed\n");
+
+  for (ib = 0; ib < nb; ib++) {
+    partial[5*ib + 0] = 0.0;
+    partial[5*ib + 1] = 0.0;
+    partial[5*ib + 2] = 0.0;
+    partial[5*ib + 3] = +DBL_MAX;
+    partial[5*ib + 4] = -DBL_MAX;
+  }
+
+  tdpMalloc((void **) &partial_d, 5*nb*sizeof(double));
+  tdpMemcpy(partial_d, partial, 5*nb*sizeof(double), tdpMemcpyHostToDevice);
+
+  tdpLaunchKernel(stats_distribution_print_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, lb->target, map->target, partial_d);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  tdpMemcpy(partial, partial_d, 5*nb*sizeof(double), tdpMemcpyDeviceToHost);
+
+  for (ib = 0; ib < nb; ib++) {
+    stat[0] += partial[5*ib + 0];
+    stat[1] += partial[5*ib + 1];
+    stat[2] += partial[5*ib + 2];
+    stat[3] = dmin(partial[5*ib + 3], stat[3]);
+    stat[4] = dmax(partial[5*ib + 4], stat[4]);
+  }
+
+  tdpFree(partial_d);
+  free(partial);
+  kernel_ctxt_free(ctxt);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  stats_distribution_print_kernel
+ *
+ *  Fluid volume, total density, sum of squares, and min and max of
+ *  the density for each block, in stat[5*blockIdx.x + 0..4] (which
+ *  must be initialised).
+ *
+ *****************************************************************************/
+
+__global__ void stats_distribution_print_kernel(kernel_ctxt_t * ktx,
+						lb_t * lb, map_t * map,
+						double * stat) {
+  int kindex;
+  int kiterations;
+  int tid;
+
+  double vol, rho, rho2;
+  double rhomin = +DBL_MAX;
+  double rhomax = -DBL_MAX;
+  double * sblk = NULL;
+
+  __shared__ double svol[TARGET_MAX_THREADS_PER_BLOCK];
+  __shared__ double srho[TARGET_MAX_THREADS_PER_BLOCK];
+  __shared__ double srho2[TARGET_MAX_THREADS_PER_BLOCK];
+
+  assert(ktx);
+  assert(lb);
+  assert(map);
+  assert(stat);
+
+  kiterations = kernel_iterations(ktx);
+
+  tid = threadIdx.x;
+  sblk = stat + 5*blockIdx.x;
+
+  svol[tid] = 0.0;
+  srho[tid] = 0.0;
+  srho2[tid] = 0.0;
+
+  for_simt_parallel(kindex, kiterations, 1) {
+
+    int ic, jc, kc, index;
+    int status;
+
+    ic = kernel_coords_ic(ktx, kindex);
+    jc = kernel_coords_jc(ktx, kindex);
+    kc = kernel_coords_kc(ktx, kindex);
+    index = kernel_coords_index(ktx, ic, jc, kc);
+
+    map_status(map, index, &status);
+
+    if (status == MAP_FLUID) {
+      lb_0th_moment(lb, index, LB_RHO, &rho);
+      svol[tid] += 1.0;
+      srho[tid] += rho;
+      srho2[tid] += rho*rho;
+      rhomin = dmin(rho, rhomin);
+      rhomax = dmax(rho, rhomax);
+    }
+  }
+
+  vol = tdpAtomicBlockAddDouble(svol);
+  rho = tdpAtomicBlockAddDouble(srho);
+  rho2 = tdpAtomicBlockAddDouble(srho2);
+
+  if (tid == 0) {
+    sblk[0] = vol;
+    sblk[1] = rho;
+    sblk[2] = rho2;
+  }
+
+  /* Minimum and maximum do not depend on the order */
+
+  tdpAtomicMinDouble(sblk + 3, rhomin);
+  tdpAtomicMaxDouble(sblk + 4, rhomax);
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  stats_distribution_momentum
@@ -113,6 +295,7 @@ int stats_distribution_momentum(lb_t * lb, map_t * map, double g[3]) {
   int ic, jc, kc, index;
   int nlocal[3];
   int status;
+  int ndevice;
 
   double g_local[3];
   double g_site[3];
@@ -129,18 +312,25 @@ int stats_distribution_momentum(lb_t * lb, map_t * map, double g[3]) {
   g_local[Y] = 0.0;
   g_local[Z] = 0.0;
 
-  for (ic = 1;  ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    stats_distribution_momentum_target(lb, map, g_local);
+  }
+  else {
+    for (ic = 1;  ic <= nlocal[X]; ic++) {
+      for (jc = 1; jc <= nlocal[Y]; jc++) {
+	for (kc = 1; kc <= nlocal[Z]; kc++) {
 
-        index = cs_index(lb->cs, ic, jc, kc);
-	map_status(map, index, &status);
-	if (status != MAP_FLUID) continue;
+	  index = cs_index(lb->cs, ic, jc, kc);
+	  map_status(map, index, &status);
+	  if (status != MAP_FLUID) continue;
 
-	lb_1st_moment(lb, index, LB_RHO, g_site);
-	g_local[X] += g_site[X];
-	g_local[Y] += g_site[Y];
-	g_local[Z] += g_site[Z];
+	  lb_1st_moment(lb, index, LB_RHO, g_site);
+	  g_local[X] += g_site[X];
+	  g_local[Y] += g_site[Y];
+	  g_local[Z] += g_site[Z];
+	}
       }
     }
   }
@@ -149,3 +339,140 @@ int stats_distribution_momentum(lb_t * lb, map_t * map, double g[3]) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  stats_distribution_momentum_target
+ *
+ *  Local fluid momentum g[3] (which must be initialised) from the
+ *  target; the partial result from each block is added in block order.
+ *
+ *****************************************************************************/
+
+static int stats_distribution_momentum_target(lb_t * lb, map_t * map,
+					      double g[3]) {
+  int ib, nb;
+  int nlocal[3];
+  dim3 nblk, ntpb;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+
+  double * partial = NULL;
+  double * partial_d = NULL;
+
+  assert(lb);
+  assert(map);
+  assert(g);
+
+  cs_nlocal(lb->cs, nlocal);
+
+  limits.imin = 1; limits.imax = nlocal[X];
+  limits.jmin = 1; limits.jmax = nlocal[Y];
+  limits.kmin = 1; limits.kmax = nlocal[Z];
+
+  kernel_ctxt_create(lb->cs, 1, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  nb = nblk.x;
+  partial = (double *) calloc(3*nb, sizeof(double));
+  assert(partial);
+  if (partial == NULL) pe_fatal(lb->pe, "calloc(partial) failed\n");
+
+  tdpMalloc((void **) &partial_d, 3*nb*sizeof(double));
+  tdpMemcpy(partial_d, partial, 3*nb*sizeof(double), tdpMemcpyHostToDevice);
+
+  tdpLaunchKernel(stats_distribution_momentum_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, lb->target, map->target, partial_d);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  tdpMemcpy(partial, partial_d, 3*nb*sizeof(double), tdpMemcpyDeviceToHost);
+
+  for (ib = 0; ib < nb; ib++) {
+    g[X] += partial[3*ib + X];
+    g[Y] += partial[3*ib + Y];
+    g[Z] += partial[3*ib + Z];
+  }
+
+  tdpFree(partial_d);
+  free(partial);
+  kernel_ctxt_free(ctxt);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  stats_distribution_momentum_kernel
+ *
+ *  Fluid momentum for each block in gm[3*blockIdx.x + X..Z].
+ *
+ *****************************************************************************/
+
+__global__ void stats_distribution_momentum_kernel(kernel_ctxt_t * ktx,
+						   lb_t * lb, map_t * map,
+						   double * gm) {
+  int kindex;
+  int kiterations;
+  int tid;
+
+  double gx, gy, gz;
+
+  __shared__ double sgx[TARGET_MAX_THREADS_PER_BLOCK];
+  __shared__ double sgy[TARGET_MAX_THREADS_PER_BLOCK];
+  __shared__ double sgz[TARGET_MAX_THREADS_PER_BLOCK];
+
+  assert(ktx);
+  assert(lb);
+  assert(map);
+  assert(gm);
+
+  kiterations = kernel_iterations(ktx);
+
+  tid = threadIdx.x;
+
+  sgx[tid] = 0.0;
+  sgy[tid] = 0.0;
+  sgz[tid] = 0.0;
+
+  for_simt_parallel(kindex, kiterations, 1) {
+
+    int ic, jc, kc, index;
+    int p, status;
+    double f;
+
+    ic = kernel_coords_ic(ktx, kindex);
+    jc = kernel_coords_jc(ktx, kindex);
+    kc = kernel_coords_kc(ktx, kindex);
+    index = kernel_coords_index(ktx, ic, jc, kc);
+
+    map_status(map, index, &status);
+
+    if (status == MAP_FLUID) {
+      /* As lb_1st_moment(), but the velocities must be from the
+       * (target) parameters. */
+      gx = 0.0; gy = 0.0; gz = 0.0;
+      for (p = 0; p < NVEL; p++) {
+	lb_f(lb, index, p, LB_RHO, &f);
+	gx += lb->param->cv[p][X]*f;
+	gy += lb->param->cv[p][Y]*f;
+	gz += lb->param->cv[p][Z]*f;
+      }
+      sgx[tid] += gx;
+      sgy[tid] += gy;
+      sgz[tid] += gz;
+    }
+  }
+
+  gx = tdpAtomicBlockAddDouble(sgx);
+  gy = tdpAtomicBlockAddDouble(sgy);
+  gz = tdpAtomicBlockAddDouble(sgz);
+
+  if (tid == 0) {
+    gm[3*blockIdx.x + X] = gx;
+    gm[3*blockIdx.x + Y] = gy;
+    gm[3*blockIdx.x + Z] = gz;
+  }
+
+  return;
+}
@@ -11,7 +11,7 @@
  *  Edinburgh Soft Matter and Statistical Phyiscs Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -27,11 +27,33 @@
 #include "physics.h"
 #include "colloids_s.h"
 #include "colloid_sums.h"
+#include "hydro_s.h"
 #include "util.h"
+#include "perf.h"
 #include "subgrid.h"
 
+/* Number of lattice sites in each direction within range of a
+ * particle: floor(r - drange_) ... ceil(r + drange_). */
+
+#define SUBGRID_NW 4
+
+/* Separable weights for one particle: the (clipped) range of local
+ * lattice sites in each direction and the 1d Peskin weight for each
+ * site in that range. The weight at site (i,j,k) is the product
+ * w[X][i - imin[X]]*w[Y][j - imin[Y]]*w[Z][k - imin[Z]]. */
+
+typedef struct subgrid_weight_s subgrid_weight_t;
+
+struct subgrid_weight_s {
+  int imin[3];
+  int imax[3];
+  double w[3][SUBGRID_NW];
+};
+
 static double d_peskin(double);
 static int subgrid_interpolation(colloids_info_t * cinfo, hydro_t * hydro);
+static int subgrid_weights(cs_t * cs, const double r[3], subgrid_weight_t * w);
+static int subgrid_cell_stride(colloids_info_t * cinfo, int stride[3]);
 static double drange_ = 1.0; /* Max. range of interpolation - 1 */
 static int subgrid_on_ = 0;  /* Subgrid particle flag */
 
@@ -42,92 +64,103 @@ static int subgrid_on_ = 0;  /* Subgrid particle flag */
  *  For each particle, accumulate the force on the relevant surrounding
  *  lattice nodes. Only nodes in the local domain are involved.
  *
+ *  Particles in different cells may share lattice nodes, so the cells
+ *  are coloured: cells of the same colour are far enough apart that
+ *  their particles have no nodes in common, and may be shared between
+ *  threads. Each node receives contributions in the same order
+ *  whatever the number of threads.
+ *
  *****************************************************************************/
 
 int subgrid_force_from_particles(colloids_info_t * cinfo, hydro_t * hydro) {
 
   int ic, jc, kc;
-  int i, j, k, i_min, i_max, j_min, j_max, k_min, k_max;
-  int index;
-  int nlocal[3], offset[3];
+  int i, j, k;
+  int ia, n;
+  int xs, ys, zs;
   int ncell[3];
+  int stride[3];
+  int ncolour[3];
+  int icolour, jcolour, kcolour;
+  int nparticle = 0;
 
-  double r[3], r0[3], force[3], g[3];
-  double dr;
+  double g[3];
+  double wxy, dr;
   colloid_t * p_colloid;
+  subgrid_weight_t w;
 
   physics_t * phys = NULL;
 
   assert(cinfo);
   assert(hydro);
 
-  cs_nlocal(cinfo->cs, nlocal);
-  cs_nlocal_offset(cinfo->cs, offset);
+  perf_region_start("subgrid_force");
+
+  cs_strides(cinfo->cs, &xs, &ys, &zs);
   colloids_info_ncell(cinfo, ncell);
+  subgrid_cell_stride(cinfo, stride);
 
   physics_ref(&phys);
   physics_fgrav(phys, g);
 
-  /* Loop through all cells (including the halo cells) */
-
-  for (ic = 0; ic <= ncell[X] + 1; ic++) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+  /* Loop through all cells (including the halo cells) one colour
+   * at a time; the cells of one colour are (ic, jc, kc) =
+   * (icolour, jcolour, kcolour) + multiples of stride. The implicit
+   * barrier at the end of each work-shared loop separates the
+   * colours. */
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
+  tdp_host_omp(parallel private(icolour, jcolour, kcolour, ncolour, n, ic, jc, kc, i, j, k, ia, wxy, dr, p_colloid, w) reduction(+: nparticle))
+  for (icolour = 0; icolour < stride[X]; icolour++) {
+    for (jcolour = 0; jcolour < stride[Y]; jcolour++) {
+      for (kcolour = 0; kcolour < stride[Z]; kcolour++) {
 
-	while (p_colloid != NULL) {
+	ncolour[X] = 1 + (ncell[X] + 1 - icolour)/stride[X];
+	ncolour[Y] = 1 + (ncell[Y] + 1 - jcolour)/stride[Y];
+	ncolour[Z] = 1 + (ncell[Z] + 1 - kcolour)/stride[Z];
 
-          /* Need to translate the colloid position to "local"
-           * coordinates, so that the correct range of lattice
-           * nodes is found */
+	tdp_host_omp(for schedule(dynamic))
+	for (n = 0; n < ncolour[X]*ncolour[Y]*ncolour[Z]; n++) {
 
-          r0[X] = p_colloid->s.r[X] - 1.0*offset[X];
-          r0[Y] = p_colloid->s.r[Y] - 1.0*offset[Y];
-          r0[Z] = p_colloid->s.r[Z] - 1.0*offset[Z];
+	  ic = icolour + stride[X]*(n/(ncolour[Y]*ncolour[Z]));
+	  jc = jcolour + stride[Y]*((n/ncolour[Z]) % ncolour[Y]);
+	  kc = kcolour + stride[Z]*(n % ncolour[Z]);
 
-	  /* Work out which local lattice sites are involved
-	   * and loop around */
+	  colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
 
-          i_min = imax(1,         (int) floor(r0[X] - drange_));
-          i_max = imin(nlocal[X], (int) ceil (r0[X] + drange_));
-          j_min = imax(1,         (int) floor(r0[Y] - drange_));
-          j_max = imin(nlocal[Y], (int) ceil (r0[Y] + drange_));
-          k_min = imax(1,         (int) floor(r0[Z] - drange_));
-          k_max = imin(nlocal[Z], (int) ceil (r0[Z] + drange_));
+	  for (; p_colloid; p_colloid = p_colloid->next) {
 
-          for (i = i_min; i <= i_max; i++) {
-            for (j = j_min; j <= j_max; j++) {
-	      for (k = k_min; k <= k_max; k++) {
+	    subgrid_weights(cinfo->cs, p_colloid->s.r, &w);
+	    if (w.imax[Z] < w.imin[Z]) continue;
+	    nparticle += 1;
 
-		index = cs_index(cinfo->cs, i, j, k);
+	    for (i = w.imin[X]; i <= w.imax[X]; i++) {
+	      for (j = w.imin[Y]; j <= w.imax[Y]; j++) {
 
-                /* Separation between r0 and the coordinate position of
-		 * this site */
+		int index0 = cs_index(cinfo->cs, i, j, w.imin[Z]);
 
-		r[X] = r0[X] - 1.0*i;
-		r[Y] = r0[Y] - 1.0*j;
-		r[Z] = r0[Z] - 1.0*k;
+		wxy = w.w[X][i - w.imin[X]]*w.w[Y][j - w.imin[Y]];
 
-		dr = d_peskin(r[X])*d_peskin(r[Y])*d_peskin(r[Z]);
-
-		force[X] = g[X]*dr;
-		force[Y] = g[Y]*dr;
-		force[Z] = g[Z]*dr;
-		hydro_f_local_add(hydro, index, force);
+		for (ia = 0; ia < 3; ia++) {
+		  for (k = 0; k <= w.imax[Z] - w.imin[Z]; k++) {
+		    int index = index0 + k*zs;
+		    dr = wxy*w.w[Z][k];
+		    hydro->f[addr_rank1(hydro->nsite, NHDIM, index, ia)]
+		      += g[ia]*dr;
+		  }
+		}
 	      }
 	    }
 	  }
-
-	  /* Next colloid */
-	  p_colloid = p_colloid->next;
+	  /* Next cell */
 	}
-
-	/* Next cell */
       }
     }
   }
 
+  perf_region_work(0.0, 64.0*nparticle*NHDIM*2.0*sizeof(double),
+		   64.0*nparticle*(2.0 + 2.0*NHDIM));
+  perf_region_stop("subgrid_force");
+
   return 0;
 }
 
@@ -144,49 +177,39 @@ int subgrid_force_from_particles(colloids_info_t * cinfo, hydro_t * hydro) {
 int subgrid_update(colloids_info_t * cinfo, hydro_t * hydro) {
 
   int ia;
-  int ic, jc, kc;
-  int ncell[3];
+  int n, nall;
   double drag, reta;
   double g[3];
   double eta;
   PI_DOUBLE(pi);
   colloid_t * p_colloid;
+  colloid_t ** handles = NULL;
   physics_t * phys = NULL;
 
   assert(cinfo);
   assert(hydro);
 
-  colloids_info_ncell(cinfo, ncell);
-
   subgrid_interpolation(cinfo, hydro);
   colloid_sums_halo(cinfo, COLLOID_SUM_SUBGRID);
 
-  /* Loop through all cells (including the halo cells) */
+  /* Loop through all colloids (including the halo cells) */
 
   physics_ref(&phys);
   physics_eta_shear(phys, &eta);
   physics_fgrav(phys, g);
   reta = 1.0/(6.0*pi*eta);
 
-  for (ic = 0; ic <= ncell[X] + 1; ic++) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
-
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
-
-	while (p_colloid != NULL) {
+  colloids_info_all_handles(cinfo, &nall, &handles);
 
-	  drag = reta*(1.0/p_colloid->s.a0 - 1.0/p_colloid->s.ah);
+  tdp_host_omp(parallel for private(ia, drag, p_colloid))
+  for (n = 0; n < nall; n++) {
 
-	  for (ia = 0; ia < 3; ia++) {
-	    p_colloid->s.v[ia] = p_colloid->fc0[ia] + drag*g[ia];
-	    p_colloid->s.dr[ia] = p_colloid->s.v[ia];
-	  }
-
-	  p_colloid = p_colloid->next;
-	}
+    p_colloid = handles[n];
+    drag = reta*(1.0/p_colloid->s.a0 - 1.0/p_colloid->s.ah);
 
-      }
+    for (ia = 0; ia < 3; ia++) {
+      p_colloid->s.v[ia] = p_colloid->fc0[ia] + drag*g[ia];
+      p_colloid->s.dr[ia] = p_colloid->s.v[ia];
     }
   }
 
@@ -200,104 +223,145 @@ int subgrid_update(colloids_info_t * cinfo, hydro_t * hydro) {
  *  Interpolate (delta function method) the lattice velocity field
  *  to the position of the particles.
  *
+ *  Each particle accumulates only its own velocity, so the particles
+ *  (in cell list order) may be shared between threads.
+ *
  *****************************************************************************/
 
 static int subgrid_interpolation(colloids_info_t * cinfo, hydro_t * hydro) {
 
-  int ic, jc, kc;
-  int i, j, k, i_min, i_max, j_min, j_max, k_min, k_max;
-  int index;
-  int nlocal[3], offset[3];
-  int ncell[3];
+  int i, j, k;
+  int n, nall;
+  int xs, ys, zs;
 
-  double r0[3], r[3], u[3];
-  double dr;
+  double u[3];
+  double wxy, dr;
   colloid_t * p_colloid;
+  colloid_t ** handles = NULL;
+  subgrid_weight_t w;
 
   assert(cinfo);
   assert(hydro);
 
-  cs_nlocal(cinfo->cs, nlocal);
-  cs_nlocal_offset(cinfo->cs, offset);
-  colloids_info_ncell(cinfo, ncell);
+  perf_region_start("subgrid_interpolation");
+
+  cs_strides(cinfo->cs, &xs, &ys, &zs);
+  colloids_info_all_handles(cinfo, &nall, &handles);
+
+  /* For each particle, set the velocity to zero for this step and
+   * add up the contributions from the lattice. */
+
+  tdp_host_omp(parallel for private(i, j, k, u, wxy, dr, p_colloid, w) schedule(dynamic, 64))
+  for (n = 0; n < nall; n++) {
 
-  /* Loop through all cells (including the halo cells) and set
-   * the velocity at each particle to zero for this step. */
+    p_colloid = handles[n];
+    subgrid_weights(cinfo->cs, p_colloid->s.r, &w);
 
-  for (ic = 0; ic <= ncell[X] + 1; ic++) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+    u[X] = 0.0;
+    u[Y] = 0.0;
+    u[Z] = 0.0;
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
+    for (i = w.imin[X]; i <= w.imax[X]; i++) {
+      for (j = w.imin[Y]; j <= w.imax[Y]; j++) {
 
-	while (p_colloid != NULL) {
-	  p_colloid->fc0[X] = 0.0;
-	  p_colloid->fc0[Y] = 0.0;
-	  p_colloid->fc0[Z] = 0.0;
-	  p_colloid = p_colloid->next;
+	int index0;
+
+	if (w.imax[Z] < w.imin[Z]) continue;
+
+	index0 = cs_index(cinfo->cs, i, j, w.imin[Z]);
+	wxy = w.w[X][i - w.imin[X]]*w.w[Y][j - w.imin[Y]];
+
+	for (k = 0; k <= w.imax[Z] - w.imin[Z]; k++) {
+	  int index = index0 + k*zs;
+	  dr = wxy*w.w[Z][k];
+	  u[X] += hydro->u[addr_rank1(hydro->nsite, NHDIM, index, X)]*dr;
+	  u[Y] += hydro->u[addr_rank1(hydro->nsite, NHDIM, index, Y)]*dr;
+	  u[Z] += hydro->u[addr_rank1(hydro->nsite, NHDIM, index, Z)]*dr;
 	}
       }
     }
+
+    p_colloid->fc0[X] = u[X];
+    p_colloid->fc0[Y] = u[Y];
+    p_colloid->fc0[Z] = u[Z];
   }
 
-  /* And add up the contributions to the velocity from the lattice. */
+  perf_region_work(0.0, 64.0*nall*NHDIM*sizeof(double), 64.0*nall*8.0);
+  perf_region_stop("subgrid_interpolation");
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  subgrid_weights
+ *
+ *  For a particle at global position r, compute the range of local
+ *  lattice sites involved, and the 1d Peskin weights in each
+ *  direction for those sites. The range is empty (imax < imin) if
+ *  the particle is out of reach of the local domain. This replaces three d_peskin()
+ *  evaluations at every site by SUBGRID_NW per direction.
+ *
+ *****************************************************************************/
+
+static int subgrid_weights(cs_t * cs, const double r[3], subgrid_weight_t * w) {
 
-  for (ic = 0; ic <= ncell[X] + 1; ic++) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+  int ia, n;
+  int nlocal[3], offset[3];
+  double r0;
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
+  assert(cs);
+  assert(w);
 
-	while (p_colloid != NULL) {
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, offset);
 
-          /* Need to translate the colloid position to "local"
-           * coordinates, so that the correct range of lattice
-           * nodes is found */
+  for (ia = 0; ia < 3; ia++) {
 
-          r0[X] = p_colloid->s.r[X] - 1.0*offset[X];
-          r0[Y] = p_colloid->s.r[Y] - 1.0*offset[Y];
-          r0[Z] = p_colloid->s.r[Z] - 1.0*offset[Z];
+    /* Need to translate the colloid position to "local"
+     * coordinates, so that the correct range of lattice
+     * nodes is found */
 
-	  /* Work out which local lattice sites are involved
-	   * and loop around */
+    r0 = r[ia] - 1.0*offset[ia];
 
-          i_min = imax(1,         (int) floor(r0[X] - drange_));
-          i_max = imin(nlocal[X], (int) ceil (r0[X] + drange_));
-          j_min = imax(1,         (int) floor(r0[Y] - drange_));
-          j_max = imin(nlocal[Y], (int) ceil (r0[Y] + drange_));
-          k_min = imax(1,         (int) floor(r0[Z] - drange_));
-          k_max = imin(nlocal[Z], (int) ceil (r0[Z] + drange_));
+    w->imin[ia] = imax(1,          (int) floor(r0 - drange_));
+    w->imax[ia] = imin(nlocal[ia], (int) ceil (r0 + drange_));
+    assert(w->imax[ia] - w->imin[ia] < SUBGRID_NW);
 
-          for (i = i_min; i <= i_max; i++) {
-            for (j = j_min; j <= j_max; j++) {
-	      for (k = k_min; k <= k_max; k++) {
+    for (n = 0; n <= w->imax[ia] - w->imin[ia]; n++) {
+      /* Separation between r0 and the coordinate position of
+       * this site */
+      w->w[ia][n] = d_peskin(r0 - 1.0*(w->imin[ia] + n));
+    }
+  }
 
-		index = cs_index(cinfo->cs, i, j, k);
+  return 0;
+}
 
-                /* Separation between r0 and the coordinate position of
-		 * this site */
+/*****************************************************************************
+ *
+ *  subgrid_cell_stride
+ *
+ *  The stride between cells of the same colour in each direction.
+ *  A particle reaches lattice sites less than (drange_ + 1) away, so
+ *  cells separated by at least 2(drange_ + 1) lattice units share
+ *  no sites. With the usual cells (width >= 4) this is 2, i.e., 8
+ *  colours.
+ *
+ *****************************************************************************/
 
-		r[X] = r0[X] - 1.0*i;
-		r[Y] = r0[Y] - 1.0*j;
-		r[Z] = r0[Z] - 1.0*k;
+static int subgrid_cell_stride(colloids_info_t * cinfo, int stride[3]) {
 
-		dr = d_peskin(r[X])*d_peskin(r[Y])*d_peskin(r[Z]);
-		hydro_u(hydro, index, u);
+  int ia;
+  double lcell[3];
 
-		p_colloid->fc0[X] += u[X]*dr;
-		p_colloid->fc0[Y] += u[Y]*dr;
-		p_colloid->fc0[Z] += u[Z]*dr;
-	      }
-	    }
-	  }
+  assert(cinfo);
 
-	  /* Next colloid */
-	  p_colloid = p_colloid->next;
-	}
+  colloids_info_lcell(cinfo, lcell);
 
-	/* Next cell */
-      }
-    }
+  for (ia = 0; ia < 3; ia++) {
+    stride[ia] = 2;
+    while ((stride[ia] - 1)*lcell[ia] < 2.0*(drange_ + 1.0)) stride[ia] += 1;
   }
 
   return 0;
@@ -12,7 +12,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -51,6 +51,7 @@ static const char * timer_name[] = {"Total",
 				    "phi halos",
 				    "Lees Edwards BC",
 				    "I/O",
+				    "I/O (background)",
 				    "Forces",
 				    "Rebuild",
 				    "BBL",
@@ -148,6 +149,28 @@ void TIMER_stop(const int t_id) {
   return;
 }
 
+/*****************************************************************************
+ *
+ *  TIMER_add
+ *
+ *  Add ncall intervals measured elsewhere (e.g., by another thread,
+ *  which must not use the timers directly) to the specified timer.
+ *
+ *****************************************************************************/
+
+void TIMER_add(const int t_id, int ncall, double t_sum, double t_min,
+	       double t_max) {
+
+  assert(ncall > 0);
+
+  timer[t_id].t_sum  += t_sum;
+  timer[t_id].t_max   = dmax(timer[t_id].t_max, t_max);
+  timer[t_id].t_min   = dmin(timer[t_id].t_min, t_min);
+  timer[t_id].nsteps += ncall;
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  TIMER_statistics
@@ -159,6 +182,8 @@ void TIMER_stop(const int t_id) {
 void TIMER_statistics() {
 
   int    n;
+  unsigned int nlocal[TIMER_NTIMERS];
+  unsigned int nsteps[TIMER_NTIMERS];
   double t_min, t_max, t_sum;
   double r;
 
@@ -172,11 +197,20 @@ void TIMER_statistics() {
   pe_info(pe_stat, "\nTimer statistics\n");
   pe_info(pe_stat, "%20s: %10s %10s %10s\n", "Section", "  tmin", "  tmax", " total");
 
+  /* Report the stats for active timers. Some timers are used on
+   * only some ranks (e.g., the background writer is only used at
+   * the I/O group root), so the decision must be global if the
+   * reductions below are to match. One reduction covers all timers. */
+
   for (n = 0; n < TIMER_NTIMERS; n++) {
+    nlocal[n] = timer[n].nsteps;
+  }
 
-    /* Report the stats for active timers */
+  MPI_Allreduce(nlocal, nsteps, TIMER_NTIMERS, MPI_UNSIGNED, MPI_MAX, comm);
+
+  for (n = 0; n < TIMER_NTIMERS; n++) {
 
-    if (timer[n].nsteps != 0) {
+    if (nsteps[n] != 0) {
 
       t_min = timer[n].t_min;
       t_max = timer[n].t_max;
@@ -189,8 +223,8 @@ void TIMER_statistics() {
       t_sum /= pe_mpi_size(pe_stat);
 
       pe_info(pe_stat, "%20s: %10.3f %10.3f %10.3f %10.6f", timer_name[n],
-	   t_min, t_max, t_sum, t_sum/(double) timer[n].nsteps);
-      pe_info(pe_stat, " (%d call%s)\n", timer[n].nsteps, timer[n].nsteps > 1 ? "s" : ""); 
+	   t_min, t_max, t_sum, t_sum/(double) nsteps[n]);
+      pe_info(pe_stat, " (%d call%s)\n", nsteps[n], nsteps[n] > 1 ? "s" : ""); 
     }
   }
 
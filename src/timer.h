@@ -25,6 +25,8 @@
 __host__ int TIMER_init(pe_t * pe);
 __host__ void TIMER_start(const int);
 __host__ void TIMER_stop(const int);
+__host__ void TIMER_add(const int, int ncall, double t_sum, double t_min,
+			double t_max);
 __host__ void TIMER_statistics(void);
 
 enum timer_id {TIMER_TOTAL = 0,
@@ -39,6 +41,7 @@ enum timer_id {TIMER_TOTAL = 0,
 	       TIMER_PHI_HALO,
 	       TIMER_LE,
 	       TIMER_IO,
+	       TIMER_IO_ASYNC,
 	       TIMER_FORCES,
 	       TIMER_REBUILD,
 	       TIMER_BBL,
@@ -28,6 +28,9 @@
 #include "util.h"
 
 static void util_swap(int ia, int ib, double a[3], double b[3][3]);
+static __host__ __device__ void util_mulhilo32(unsigned int a, unsigned int b,
+					       unsigned int * hi,
+					       unsigned int * lo);
 
 /***************************************************************************
  *
@@ -1328,3 +1331,130 @@ static long int util_ranlcg_multiply(long a, long s, long c, long m) {
 
   return p;
 }
+
+/*****************************************************************************
+ *
+ *  util_philox4x32
+ *
+ *  Counter-based random number generator Philox-4x32 with 10 rounds
+ *  (Salmon et al., SC11 "Parallel random numbers: as easy as 1, 2, 3").
+ *
+ *  Four 32-bit random integers r are a (bijective) function of the
+ *  128-bit counter ctr for a given 64-bit key. Streams which must
+ *  not depend on the order of evaluation, or on the decomposition,
+ *  should use counters made from global quantities (e.g., particle
+ *  index and time step).
+ *
+ *****************************************************************************/
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+__host__ __device__ int util_philox4x32(const unsigned int ctr[4],
+					const unsigned int key[2],
+					unsigned int r[4]) {
+  int n;
+  unsigned int k0, k1;
+  unsigned int hi0, lo0, hi1, lo1;
+  unsigned int x[4];
+
+  assert(ctr);
+  assert(key);
+  assert(r);
+
+  x[0] = ctr[0]; x[1] = ctr[1]; x[2] = ctr[2]; x[3] = ctr[3];
+  k0 = key[0];
+  k1 = key[1];
+
+  for (n = 0; n < 10; n++) {
+    util_mulhilo32(PHILOX_M0, x[0], &hi0, &lo0);
+    util_mulhilo32(PHILOX_M1, x[2], &hi1, &lo1);
+    x[0] = hi1 ^ x[1] ^ k0;
+    x[1] = lo1;
+    x[2] = hi0 ^ x[3] ^ k1;
+    x[3] = lo0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+
+  r[0] = x[0]; r[1] = x[1]; r[2] = x[2]; r[3] = x[3];
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  util_philox_uniform
+ *
+ *  Four uniform deviates on the open interval (0,1).
+ *
+ *****************************************************************************/
+
+__host__ __device__ int util_philox_uniform(const unsigned int ctr[4],
+					    const unsigned int key[2],
+					    double u[4]) {
+  int n;
+  unsigned int r[4];
+
+  assert(u);
+
+  util_philox4x32(ctr, key, r);
+
+  for (n = 0; n < 4; n++) {
+    u[n] = (r[n] + 0.5)*(1.0/4294967296.0);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  util_philox_gaussian
+ *
+ *  Four Gaussian deviates (zero mean, unit variance) via Box-Muller
+ *  from two pairs of uniforms. As there is no rejection, the cost is
+ *  the same for every counter.
+ *
+ *****************************************************************************/
+
+__host__ __device__ int util_philox_gaussian(const unsigned int ctr[4],
+					     const unsigned int key[2],
+					     double g[4]) {
+  double u[4];
+  double f;
+  PI_DOUBLE(pi);
+
+  assert(g);
+
+  util_philox_uniform(ctr, key, u);
+
+  f = sqrt(-2.0*log(u[0]));
+  g[0] = f*cos(2.0*pi*u[1]);
+  g[1] = f*sin(2.0*pi*u[1]);
+  f = sqrt(-2.0*log(u[2]));
+  g[2] = f*cos(2.0*pi*u[3]);
+  g[3] = f*sin(2.0*pi*u[3]);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  util_mulhilo32
+ *
+ *  High and low 32 bits of the 64-bit product a*b.
+ *
+ *****************************************************************************/
+
+static __host__ __device__ void util_mulhilo32(unsigned int a, unsigned int b,
+					       unsigned int * hi,
+					       unsigned int * lo) {
+  unsigned long long p = (unsigned long long) a*b;
+
+  *hi = (unsigned int) (p >> 32);
+  *lo = (unsigned int) p;
+
+  return;
+}
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk) 
@@ -64,4 +64,17 @@ __host__ int util_random_unit_vector(int * state, double rhat[3]);
 __host__ int util_ranlcg_reap_uniform(int * state, double * r);
 __host__ int util_ranlcg_reap_gaussian(int * state, double r[2]);
 
+/* Counter-based (Philox-4x32-10) random numbers. There is no state:
+ * the result is a function of the counter and the key only. */
+
+__host__ __device__ int util_philox4x32(const unsigned int ctr[4],
+					const unsigned int key[2],
+					unsigned int r[4]);
+__host__ __device__ int util_philox_uniform(const unsigned int ctr[4],
+					    const unsigned int key[2],
+					    double u[4]);
+__host__ __device__ int util_philox_gaussian(const unsigned int ctr[4],
+					     const unsigned int key[2],
+					     double g[4]);
+
 #endif
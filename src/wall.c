@@ -520,9 +520,13 @@ __global__ void wall_setu_kernel(wall_t * wall, lb_t * lb) {
 
   for_simt_parallel(n, wall->nlink, 1) {
 
+    int i, j;
+
+    i = wall->linki[n];
+    j = wall->linkj[n];
     p = NVEL - wall->linkp[n];
     fp = lb->param->wv[p]*(lb->param->rho0 + rcs2*ux*lb->param->cv[p][X]);
-    lb_f_set(lb, wall->linkj[n], p, LB_RHO, fp);
+    lb_f_link_set(lb, j, i, p, LB_RHO, fp);
 
   }
 
@@ -627,8 +631,8 @@ __global__ void wall_bbl_kernel(wall_t * wall, lb_t * lb, map_t * map) {
       /* This matches the momentum exchange in colloid BBL. */
       /* This only affects the accounting (via anomaly, as below) */
 
-      lb_f(lb, i, ij, LB_RHO, &fp0);
-      lb_f(lb, j, ji, LB_RHO, &fp1);
+      lb_f_link(lb, i, j, ij, LB_RHO, &fp0);
+      lb_f_link(lb, j, i, ji, LB_RHO, &fp1);
       fp = fp0 + fp1;
 
       fx[tid] += (fp - 2.0*lb->param->wv[ij])*lb->param->cv[ij][X];
@@ -642,7 +646,7 @@ __global__ void wall_bbl_kernel(wall_t * wall, lb_t * lb, map_t * map) {
        * wv[ij]. This is ok for walls where there are exactly
        * equal and opposite links at each side of the system. */
 
-      lb_f(lb, i, ij, LB_RHO, &fp);
+      lb_f_link(lb, i, j, ij, LB_RHO, &fp);
       lb_0th_moment(lb, i, LB_RHO, &rho);
 
       force = 2.0*fp - 2.0*rcs2*lb->param->wv[ij]*lb->param->rho0*cdotu;
@@ -652,15 +656,15 @@ __global__ void wall_bbl_kernel(wall_t * wall, lb_t * lb, map_t * map) {
       fz[tid] += (force - 2.0*lb->param->wv[ij])*lb->param->cv[ij][Z];
 
       fp = fp - 2.0*rcs2*lb->param->wv[ij]*lb->param->rho0*cdotu;
-      lb_f_set(lb, j, ji, LB_RHO, fp);
+      lb_f_link_set(lb, j, i, ji, LB_RHO, fp);
 
       if (lb->param->ndist > 1) {
 	/* Order parameter */
-	lb_f(lb, i, ij, LB_PHI, &fp);
+	lb_f_link(lb, i, j, ij, LB_PHI, &fp);
 	lb_0th_moment(lb, i, LB_PHI, &rho);
 
 	fp = fp - 2.0*rcs2*lb->param->wv[ij]*lb->param->rho0*cdotu;
-	lb_f_set(lb, j, ji, LB_PHI, fp);
+	lb_f_link_set(lb, j, i, ji, LB_PHI, fp);
       }
     }
     /* Next link */
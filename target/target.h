@@ -109,6 +109,18 @@ __device__ double tdpAtomicMinDouble(double * minval, double val);
 __device__ int tdpAtomicBlockAddInt(int * partsum);
 __device__ double tdpAtomicBlockAddDouble(double * partsum);
 
+/* Host-side work sharing. Loops over host data structures (e.g.,
+ * colloids) may be shared between OpenMP threads outside any kernel
+ * launch, e.g., tdp_host_omp(parallel for schedule(dynamic)).
+ * The directive is dropped if there is no OpenMP. */
+
+#ifdef _OPENMP
+#define tdp_host_str(...) #__VA_ARGS__
+#define tdp_host_omp(...) _Pragma(tdp_host_str(omp __VA_ARGS__))
+#else
+#define tdp_host_omp(...)
+#endif
+
 /* Help for error checking */
 
 __host__ __device__ void tdpErrorHandler(tdpError_t ifail, const char * file,
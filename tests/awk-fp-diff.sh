@@ -29,12 +29,12 @@ BEGIN {
 
   # There a a number of global objects in use, including:
   #
-  # TOLERANCE  the floating point tolerance
+  # TOLERANCE  the floating point tolerance (may be set via -v)
   # files1[]   lines of file 1 (1..nlines1 with file1[0] the filename)
   # files2[]   lines of file 2 (1..nlines2 with file2[0] the filename)
   # lcslen[,]  lowest common subsequence array for diff algorithm 
 
-  TOLERANCE = 1.0e-12
+  if (TOLERANCE == "") TOLERANCE = 1.0e-12
   nlines1 = 0
   nlines2 = 0
   file1[0] = ARGV[1]
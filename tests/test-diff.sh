@@ -19,6 +19,7 @@
 #
 #  Options:
 #    -v causes the actual results of the diff to be sent to stdout
+#    -t tol sets the floating point tolerance (default 1.0e-12)
 #
 #  Edinburgh Soft Matter and Statistical Physics Group and
 #  Edinburgh Parallel Computing Centre
@@ -44,17 +45,17 @@ then
 fi
 
 is_verbose=0
+tolerance=""
 
-while getopts v opt
+while getopts vt: opt
 do
 case "$opt" in
     v) is_verbose=1;;
+    t) tolerance="-v TOLERANCE=$OPTARG";;
 esac
 done
 
-if [ $is_verbose -eq 1 ]; then
-    shift
-fi
+shift $((OPTIND - 1))
 
 if [ ! -e $1 ]; then
     if [ $is_verbose -eq 1 ]; then
@@ -77,6 +78,7 @@ fi
 #   - blank lines
 #   - "Timer resolution"
 #   - exact location of the input file via "user parameters"  
+#   - performance region statistics (to the end of the run)
 
 sed '/call)/d' $1 > test-diff-tmp.ref
 sed -i~ '/calls)/d' test-diff-tmp.ref
@@ -90,6 +92,8 @@ sed -i~ 's/d3q15\ R/d3q15/' test-diff-tmp.ref
 sed -i~ 's/d3q19\ R/d3q19/' test-diff-tmp.ref
 sed -i~ '/GPU\ INFO/d' test-diff-tmp.ref
 sed -i~ '/SIMD\ vector/d' test-diff-tmp.ref
+sed -i~ '/Storage\ precision/d' test-diff-tmp.ref
+sed -i~ '/Region.statistics/,/finished.normally/{/finished.normally/!d}' test-diff-tmp.ref
 
 sed '/call)/d' $2 > test-diff-tmp.log
 sed -i~ '/calls)/d' test-diff-tmp.log
@@ -103,15 +107,17 @@ sed -i~ 's/d3q15\ R/d3q15/' test-diff-tmp.log
 sed -i~ 's/d3q19\ R/d3q19/' test-diff-tmp.log
 sed -i~ '/GPU\ INFO/d' test-diff-tmp.log
 sed -i~ '/SIMD\ vector/d' test-diff-tmp.log
+sed -i~ '/Storage\ precision/d' test-diff-tmp.log
+sed -i~ '/Region.statistics/,/finished.normally/{/finished.normally/!d}' test-diff-tmp.log
 
 # Here we use the floating point diff to measure "success"
 
-var=`$FPDIFF test-diff-tmp.ref test-diff-tmp.log | wc -l`
+var=`$FPDIFF $tolerance test-diff-tmp.ref test-diff-tmp.log | wc -l`
 
 
 if [ $is_verbose -eq 1 -a $var -gt 0 ]
     then
-    c=`$FPDIFF test-diff-tmp.ref test-diff-tmp.log`
+    c=`$FPDIFF $tolerance test-diff-tmp.ref test-diff-tmp.log`
     echo "$c"
 fi
 
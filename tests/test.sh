@@ -6,7 +6,7 @@
 #
 #  Run a regression test.
 #
-#  ./test.sh input.inp "serial launch command" "parallel launch command"
+#  ./test.sh input.inp "serial launch command" "parallel launch command" [tol]
 #
 #  The executable may be launched in parallel, but the test-diff
 #  script must be run in serial. Hence the requirement for both
@@ -14,6 +14,8 @@
 #
 #  The launch method may be an empty string in serial.
 #
+#  The optional tolerance is passed to the test-diff script (-t).
+#
 #
 #  Edinburgh Soft Matter and Statisical Physics Group and
 #  Edinburgh Parallel Computing Centre
@@ -41,6 +43,8 @@ function main() {
   input="$1"
   launch_serial="$2"
   launch_mpi="$3"
+  tolerance=""
+  if [ -n "$4" ]; then tolerance="-t $4"; fi
 
   # The naming convention for the files is "serial-xxxx-xxx.inp"
   # for the input and with extension ".log" for the reference
@@ -51,12 +55,12 @@ function main() {
   ${launch_mpi} ${executable} $input > $stub.new
 
   # Get difference via the difference script
-  ${launch_serial} ${test_diff} $stub.new $stub.log
+  ${launch_serial} ${test_diff} ${tolerance} $stub.new $stub.log
 
   if [ $? -ne 0 ]
   then
       echo "    FAIL ./$input"
-      ${launch_serial} ${test_diff} -v $stub.log $stub.new
+      ${launch_serial} ${test_diff} -v ${tolerance} $stub.log $stub.new
       # ok, exit with zero
      exit 0
   else
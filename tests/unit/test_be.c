@@ -10,7 +10,7 @@
  *  Contributing authors:
  *    Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
- *  (c) 2013-2017 The University of Edinburgh
+ *  (c) 2013-2019 The University of Edinburgh
  *
  *****************************************************************************/
 
@@ -18,16 +18,23 @@
 #include <float.h>
 #include <math.h>
 
+#include <stdlib.h>
+
 #include "pe.h"
 #include "coords.h"
 #include "leesedwards.h"
-#include "field.h"
+#include "physics.h"
+#include "field_s.h"
 #include "field_grad.h"
+#include "gradient_3d_7pt_fluid.h"
+#include "blue_phase.h"
 #include "blue_phase_beris_edwards.h"
 #include "tests.h"
 
 static int do_test_be_tmatrix(void);
 static int do_test_be1(void);
+static int do_test_be_fused(void);
+static int do_test_be_q_set(cs_t * cs, field_t * fq, field_grad_t * fqgrad);
 
 /*****************************************************************************
  *
@@ -41,6 +48,7 @@ int test_be_suite(void) {
 
   do_test_be1();
   do_test_be_tmatrix();
+  do_test_be_fused();
 
   return 0;
 }
@@ -66,6 +74,10 @@ static int do_test_be1(void) {
   beris_edw_create(pe, cs, le, &be);
   assert(be);
 
+  /* The reference (not fused) update allocates h only on demand */
+  beris_edw_fused_set(be, 0);
+  beris_edw_fused_set(be, 1);
+
   beris_edw_free(be);
 
   lees_edw_free(le);
@@ -108,3 +120,223 @@ static int do_test_be_tmatrix(void) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  do_test_be_fused
+ *
+ *  The fused update (molecular field and no normal flux boundary
+ *  conditions computed in the update kernel) must agree exactly with
+ *  the reference update, here with solid sites and a non-zero
+ *  velocity field.
+ *
+ *****************************************************************************/
+
+static int do_test_be_fused(void) {
+
+  int nhalo = 2;
+  int ic, jc, kc, index, n;
+  int nlocal[3];
+  int noffset[3];
+  int ncell[3] = {2, 2, 2};
+  int nsolid = 0;
+  double u[3];
+  double qmax = 0.0;
+  double * qref = NULL;
+
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  physics_t * phys = NULL;
+  field_t * fq = NULL;
+  field_grad_t * fqgrad = NULL;
+  fe_lc_t * fe = NULL;
+  fe_lc_param_t param = {0};
+  beris_edw_t * be = NULL;
+  beris_edw_param_t bep = {0};
+  hydro_t * hydro = NULL;
+  map_t * map = NULL;
+  colloids_info_t * cinfo = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+  lees_edw_create(pe, cs, NULL, &le);
+  physics_create(pe, &phys);
+
+  field_create(pe, cs, NQAB, "q", &fq);
+  field_init(fq, nhalo, le);
+  field_grad_create(pe, fq, 2, &fqgrad);
+  field_grad_set(fqgrad, grad_3d_7pt_fluid_d2, NULL);
+
+  param.a0 = 0.01;
+  param.gamma = 3.0;
+  param.kappa0 = 0.01;
+  param.kappa1 = 0.01;
+  param.q0 = 0.1;
+  param.xi = 0.7;
+  param.redshift = 1.0;
+  param.rredshift = 1.0;
+
+  fe_lc_create(pe, cs, le, fq, fqgrad, &fe);
+  fe_lc_param_set(fe, param);
+  fe_lc_param_commit(fe);
+
+  bep.xi = param.xi;
+  bep.gamma = 0.5;
+  beris_edw_create(pe, cs, le, &be);
+  beris_edw_param_set(be, bep);
+  beris_edw_param_commit(be);
+
+  /* Solid sites: a scattering of isolated sites and one solid plane */
+
+  map_create(pe, cs, 0, &map);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	n = 3*(noffset[X] + ic) + 5*(noffset[Y] + jc) + 7*(noffset[Z] + kc);
+	if (n % 11 == 0 || noffset[X] + ic == 1) {
+	  map_status_set(map, index, MAP_BOUNDARY);
+	  nsolid += 1;
+	}
+      }
+    }
+  }
+
+  map_memcpy(map, tdpMemcpyHostToDevice);
+  map_halo(map);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_map_init(cinfo);
+
+  hydro_create(pe, cs, le, 1, &hydro);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	u[X] = 0.01*sin(0.1*(noffset[Y] + jc));
+	u[Y] = 0.01*cos(0.2*(noffset[Z] + kc));
+	u[Z] = 0.01*sin(0.3*(noffset[X] + ic));
+	hydro_u_set(hydro, index, u);
+      }
+    }
+  }
+
+  hydro_memcpy(hydro, tdpMemcpyHostToDevice);
+  hydro_u_halo(hydro);
+
+  /* Reference */
+
+  qref = (double *) malloc(NQAB*fq->nsites*sizeof(double));
+  assert(qref);
+
+  do_test_be_q_set(cs, fq, fqgrad);
+  beris_edw_fused_set(be, 0);
+  beris_edw_update(be, (fe_t *) fe, fq, fqgrad, hydro, cinfo, map, NULL);
+  field_memcpy(fq, tdpMemcpyDeviceToHost);
+
+  for (n = 0; n < NQAB*fq->nsites; n++) {
+    qref[n] = fq->data[n];
+  }
+
+  /* Fused */
+
+  do_test_be_q_set(cs, fq, fqgrad);
+  beris_edw_fused_set(be, 1);
+  beris_edw_update(be, (fe_t *) fe, fq, fqgrad, hydro, cinfo, map, NULL);
+  field_memcpy(fq, tdpMemcpyDeviceToHost);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	for (n = 0; n < NQAB; n++) {
+	  double q  = fq->data[addr_rank1(fq->nsites, NQAB, index, n)];
+	  double qr = qref[addr_rank1(fq->nsites, NQAB, index, n)];
+	  test_assert(q == qr);
+	  qmax = fmax(qmax, fabs(q));
+	}
+      }
+    }
+  }
+
+  /* Make sure there was something to compare */
+  test_assert(nsolid > 0);
+  test_assert(qmax > 0.0);
+
+  free(qref);
+  hydro_free(hydro);
+  colloids_info_free(cinfo);
+  map_free(map);
+  beris_edw_free(be);
+  fe_lc_free(fe);
+  field_grad_free(fqgrad);
+  field_free(fq);
+  physics_free(phys);
+  lees_edw_free(le);
+  cs_free(cs);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_be_q_set
+ *
+ *  A smooth, periodic, traceless, symmetric q with gradients.
+ *
+ *****************************************************************************/
+
+static int do_test_be_q_set(cs_t * cs, field_t * fq, field_grad_t * fqgrad) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  int noffset[3];
+  double ltot[3];
+  double x, y, z;
+  double q[3][3];
+  double pi;
+
+  assert(cs);
+  assert(fq);
+  assert(fqgrad);
+
+  pi = 4.0*atan(1.0);
+  cs_ltot(cs, ltot);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	x = 2.0*pi*(noffset[X] + ic)/ltot[X];
+	y = 2.0*pi*(noffset[Y] + jc)/ltot[Y];
+	z = 2.0*pi*(noffset[Z] + kc)/ltot[Z];
+	q[X][X] = 0.2*sin(x + y);
+	q[X][Y] = 0.1*cos(2.0*z);
+	q[X][Z] = 0.1*sin(y - z);
+	q[Y][X] = q[X][Y];
+	q[Y][Y] = 0.1*cos(x + 3.0*z);
+	q[Y][Z] = 0.05*sin(2.0*x);
+	q[Z][X] = q[X][Z];
+	q[Z][Y] = q[Y][Z];
+	q[Z][Z] = 0.0 - q[X][X] - q[Y][Y];
+	field_tensor_set(fq, index, q);
+      }
+    }
+  }
+
+  field_memcpy(fq, tdpMemcpyHostToDevice);
+  field_halo(fq);
+  field_grad_compute(fqgrad);
+
+  return 0;
+}
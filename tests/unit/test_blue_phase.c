@@ -8,7 +8,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -40,6 +40,9 @@ static int test_o8m_struct(pe_t * pe, cs_t * cs, lees_edw_t * le, fe_lc_t * fe,
 			   field_t * fq,
 			   field_grad_t * fqgrad);
 static int test_bp_nonfield(void);
+static int test_bp_vector(cs_t * cs, fe_lc_t * fe, field_t * fq,
+			  field_grad_t * fqgrad);
+static int test_bp_vector_sites(cs_t * cs, fe_lc_t * fe, int hcheck);
 
 
 __host__ int do_test_fe_lc_device1(pe_t * pe, cs_t * cs, fe_lc_t * fe);
@@ -78,6 +81,7 @@ int test_bp_suite(void) {
   fe_lc_create(pe, cs, le, fq, fqgrad, &fe);
 
   test_o8m_struct(pe, cs, le, fe, fq, fqgrad);
+  test_bp_vector(cs, fe, fq, fqgrad);
   do_test_fe_lc_device1(pe, cs, fe);
 
   fe_lc_free(fe);
@@ -844,6 +848,142 @@ int test_o8m_struct(pe_t * pe, cs_t * cs, lees_edw_t * le, fe_lc_t * fe,
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  test_bp_vector
+ *
+ *  The vectorised molecular field and stress must agree with the
+ *  scalar versions. Uses the O8M structure with the electric field
+ *  switched on; the stress is also checked for kappa0 != kappa1.
+ *
+ *****************************************************************************/
+
+static int test_bp_vector(cs_t * cs, fe_lc_t * fe, field_t * fq,
+			  field_grad_t * fqgrad) {
+
+  double ltot[3];
+  double e0[3] = {0.01, 0.02, -0.03};
+  fe_lc_param_t param = {0};
+
+  assert(cs);
+  assert(fe);
+  assert(fq);
+  assert(fqgrad);
+
+  cs_ltot(cs, ltot);
+
+  param.a0 = 0.014384711;
+  param.gamma = 3.1764706;
+  param.kappa0 = 0.01;
+  param.kappa1 = 0.01;
+  param.q0 = sqrt(2.0)*4.0*atan(1.0)*16.0/ltot[Y];
+  param.xi = 0.7;
+  param.redshift = 0.83;
+  param.epsilon = 41.4;
+  fe_lc_param_set(fe, param);
+
+  fe->param->e0coswt[X] = e0[X];
+  fe->param->e0coswt[Y] = e0[Y];
+  fe->param->e0coswt[Z] = e0[Z];
+
+  field_halo(fq);
+  field_grad_compute(fqgrad);
+
+  test_bp_vector_sites(cs, fe, 1);
+
+  /* Stress only (the scalar molecular field requires kappa0 = kappa1) */
+
+  fe->param->kappa1 = 2.0*fe->param->kappa0;
+  test_bp_vector_sites(cs, fe, 0);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_bp_vector_sites
+ *
+ *  Compare vector and scalar results at all complete vector blocks
+ *  along z.
+ *
+ *****************************************************************************/
+
+static int test_bp_vector_sites(cs_t * cs, fe_lc_t * fe, int hcheck) {
+
+  int ic, jc, kc, index;
+  int ia, ib, iv;
+  int nlocal[3];
+  double smax = 0.0;
+  double s1[3][3];
+  double s[3][3][NSIMDVL];
+
+  assert(cs);
+  assert(fe);
+
+  cs_nlocal(cs, nlocal);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc + NSIMDVL - 1 <= nlocal[Z]; kc += NSIMDVL) {
+
+	index = cs_index(cs, ic, jc, kc);
+
+	if (hcheck) {
+	  fe_lc_mol_field_v(fe, index, s);
+	  for (iv = 0; iv < NSIMDVL; iv++) {
+	    fe_lc_mol_field(fe, index + iv, s1);
+	    for (ia = 0; ia < 3; ia++) {
+	      for (ib = 0; ib < 3; ib++) {
+		test_assert(fabs(s[ia][ib][iv] - s1[ia][ib])
+			    < TEST_DOUBLE_TOLERANCE);
+	      }
+	    }
+	  }
+	}
+
+	fe_lc_stress_v(fe, index, s);
+	for (iv = 0; iv < NSIMDVL; iv++) {
+	  fe_lc_stress(fe, index + iv, s1);
+	  for (ia = 0; ia < 3; ia++) {
+	    for (ib = 0; ib < 3; ib++) {
+	      test_assert(fabs(s[ia][ib][iv] - s1[ia][ib])
+			  < TEST_DOUBLE_TOLERANCE);
+	      smax = fmax(smax, fabs(s1[ia][ib]));
+	    }
+	  }
+	}
+
+	fe_lc_str_symm_v(fe, index, s);
+	for (iv = 0; iv < NSIMDVL; iv++) {
+	  fe_lc_str_symm(fe, index + iv, s1);
+	  for (ia = 0; ia < 3; ia++) {
+	    for (ib = 0; ib < 3; ib++) {
+	      test_assert(fabs(s[ia][ib][iv] - s1[ia][ib])
+			  < TEST_DOUBLE_TOLERANCE);
+	    }
+	  }
+	}
+
+	fe_lc_str_anti_v(fe, index, s);
+	for (iv = 0; iv < NSIMDVL; iv++) {
+	  fe_lc_str_anti(fe, index + iv, s1);
+	  for (ia = 0; ia < 3; ia++) {
+	    for (ib = 0; ib < 3; ib++) {
+	      test_assert(fabs(s[ia][ib][iv] - s1[ia][ib])
+			  < TEST_DOUBLE_TOLERANCE);
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  /* Make sure there was something to compare */
+  test_assert(smax > 0.0);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  multiply_gradient
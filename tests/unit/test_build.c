@@ -18,17 +18,23 @@
 #include <float.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "pe.h"
 #include "coords.h"
 #include "colloids_halo.h"
 #include "colloid_sums.h"
 #include "build.h"
+#include "colloids_s.h"
 #include "tests.h"
 
 static int test_build_links_model_c1(pe_t * pe, cs_t * cs, double a0, double r0[3]);
 static int test_build_links_model_c2(pe_t * pe, cs_t * cs, double a0, double r0[3]);
 static int test_build_rebuild_c1(pe_t * pe, cs_t * cs, double a0, double r0[3]);
+static int test_build_incremental_c1(pe_t * pe, cs_t * cs, double a0,
+				     double r0[3]);
+static int test_build_incremental_move(cs_t * cs, colloids_info_t * cinfo,
+				       map_t * map, double dr);
 
 /*****************************************************************************
  *
@@ -59,18 +65,21 @@ int test_build_suite(void) {
   test_build_links_model_c1(pe, cs, a0, r0);
   test_build_links_model_c2(pe, cs, a0, r0);
   test_build_rebuild_c1(pe, cs, a0, r0);
+  test_build_incremental_c1(pe, cs, a0, r0);
 
   a0 = 4.77;
   r0[X] = lmin[X] + delta; r0[Y] = 0.5*ltot[Y]; r0[Z] = 0.5*ltot[Z];
   test_build_links_model_c1(pe, cs, a0, r0);
   test_build_links_model_c2(pe, cs, a0, r0);
   test_build_rebuild_c1(pe, cs, a0, r0);
+  test_build_incremental_c1(pe, cs, a0, r0);
 
   a0 = 3.84;
   r0[X] = ltot[X]; r0[Y] = ltot[Y]; r0[Z] = ltot[Z];
   test_build_links_model_c1(pe, cs, a0, r0);
   test_build_links_model_c2(pe, cs, a0, r0);
   test_build_rebuild_c1(pe, cs, a0, r0);
+  test_build_incremental_c1(pe, cs, a0, r0);
 
   /* Some known cases: place the colloid in the centre and test only
    * in serial, as there is no quick way to compute in parallel. */
@@ -302,3 +311,105 @@ static int test_build_rebuild_c1(pe_t * pe, cs_t * cs, double a0, double r0[3])
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_build_incremental_c1
+ *
+ *  The map after an incremental update must be the same as that
+ *  from a full update.
+ *
+ *****************************************************************************/
+
+static int test_build_incremental_c1(pe_t * pe, cs_t * cs, double a0,
+				     double r0[3]) {
+  int ncell[3] = {2, 2, 2};
+
+  map_t * map = NULL;
+  colloid_t * pc = NULL;
+  colloids_info_t * cinfo = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_map_init(cinfo);
+  colloids_info_map_incremental_set(cinfo, 1);
+  map_create(pe, cs, 0, &map);
+
+  colloids_info_add_local(cinfo, 1, r0, &pc);
+  if (pc) pc->s.a0 = a0;
+  colloids_info_ntotal_set(cinfo);
+  colloids_halo_state(cinfo);
+
+  /* First update is always full; then small and large moves */
+
+  build_update_map(cs, cinfo, map);
+  test_assert(cinfo->map_valid == 1);
+  test_assert(cinfo->nmodified == -1);
+
+  test_build_incremental_move(cs, cinfo, map, 0.01);
+  test_build_incremental_move(cs, cinfo, map, 0.3);
+  test_build_incremental_move(cs, cinfo, map, 0.7);
+
+  map_free(map);
+  colloids_info_free(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_build_incremental_move
+ *
+ *  Move all copies of the colloid by dr in each direction, update
+ *  incrementally, and compare with a full update.
+ *
+ *****************************************************************************/
+
+static int test_build_incremental_move(cs_t * cs, colloids_info_t * cinfo,
+				       map_t * map, double dr) {
+  int n;
+  int status0, status1;
+  colloid_t * pc = NULL;
+  colloid_t ** map0 = NULL;
+  int * s0 = NULL;
+
+  colloids_info_list_all_build(cinfo);
+  colloids_info_all_head(cinfo, &pc);
+  for ( ; pc; pc = pc->nextall) {
+    pc->s.r[X] += dr;
+    pc->s.r[Y] += dr;
+    pc->s.r[Z] -= dr;
+  }
+
+  build_update_map(cs, cinfo, map);
+  test_assert(cinfo->nmodified >= 0);
+
+  map0 = (colloid_t **) calloc(cinfo->nsites, sizeof(colloid_t *));
+  s0 = (int *) calloc(cinfo->nsites, sizeof(int));
+  assert(map0);
+  assert(s0);
+
+  for (n = 0; n < cinfo->nsites; n++) {
+    map0[n] = cinfo->map_new[n];
+    map_status(map, n, s0 + n);
+  }
+
+  /* Full update for comparison */
+
+  colloids_info_map_incremental_set(cinfo, 1);
+  build_update_map(cs, cinfo, map);
+
+  for (n = 0; n < cinfo->nsites; n++) {
+    map_status(map, n, &status1);
+    status0 = s0[n];
+    test_assert(cinfo->map_new[n] == map0[n]);
+    test_assert(status0 == status1);
+  }
+
+  free(s0);
+  free(map0);
+
+  return 0;
+}
@@ -0,0 +1,174 @@
+/*****************************************************************************
+ *
+ *  test_colloid_link.c
+ *
+ *  Pooled link allocation and the flat link table.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "colloid_link.h"
+#include "tests.h"
+
+static int test_colloid_link_pool(void);
+static int test_colloid_link_table(void);
+static colloid_link_t * test_colloid_link_list(int nlink, int i0);
+
+/*****************************************************************************
+ *
+ *  test_colloid_link_suite
+ *
+ *****************************************************************************/
+
+int test_colloid_link_suite(void) {
+
+  pe_t * pe = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+
+  test_colloid_link_pool();
+  test_colloid_link_table();
+
+  pe_info(pe, "PASS     ./unit/test_colloid_link\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloid_link_pool
+ *
+ *  Links returned to the pool are reused.
+ *
+ *****************************************************************************/
+
+static int test_colloid_link_pool(void) {
+
+  int ntotal;
+  colloid_link_t * p1 = NULL;
+  colloid_link_t * p2 = NULL;
+
+  ntotal = colloid_link_total();
+
+  p1 = test_colloid_link_list(3, 0);
+  test_assert(colloid_link_count(p1) == 3);
+  test_assert(colloid_link_total() == ntotal + 3);
+
+  colloid_link_free_list(p1);
+  test_assert(colloid_link_total() == ntotal);
+
+  /* The last link freed is the head of the list, which is first
+   * to be reused. */
+
+  p2 = colloid_link_allocate();
+  test_assert(p2 == p1);
+  test_assert(p2->next == NULL);
+  test_assert(colloid_link_total() == ntotal + 1);
+
+  colloid_link_free_list(p2);
+  colloid_link_free_list(NULL);
+  test_assert(colloid_link_total() == ntotal);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloid_link_table
+ *
+ *****************************************************************************/
+
+static int test_colloid_link_table(void) {
+
+  int n;
+  int nlink[3] = {5, 0, 100};
+  colloid_link_t * lnk[3];
+  colloid_link_table_t * table = NULL;
+
+  colloid_link_table_create(&table);
+  test_assert(table != NULL);
+
+  for (n = 0; n < 3; n++) {
+    lnk[n] = test_colloid_link_list(nlink[n], 1000*n);
+  }
+
+  /* Twice, to check the storage is reused */
+
+  colloid_link_table_reset(table);
+  colloid_link_table_add(table, lnk[0]);
+  colloid_link_table_reset(table);
+
+  for (n = 0; n < 3; n++) {
+    colloid_link_table_add(table, lnk[n]);
+  }
+
+  test_assert(table->ncolloid == 3);
+  test_assert(table->nlink == 105);
+  test_assert(table->offset[0] == 0);
+  test_assert(table->offset[1] == 5);
+  test_assert(table->offset[2] == 5);
+  test_assert(table->offset[3] == 105);
+
+  for (n = table->offset[2]; n < table->offset[3]; n++) {
+    test_assert(table->i[n] == 2000 + n - 5);
+    test_assert(table->j[n] == 2000 + n - 5 + 1);
+    test_assert(table->p[n] == 1);
+    test_assert(table->status[n] == LINK_FLUID);
+    test_assert(table->rb[X][n] == 1.0*(n - 5));
+    test_assert(table->rb[Y][n] == 2.0);
+    test_assert(table->rb[Z][n] == 3.0);
+  }
+
+  for (n = 0; n < 3; n++) {
+    colloid_link_free_list(lnk[n]);
+  }
+  colloid_link_table_free(table);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloid_link_list
+ *
+ *  A list of nlink (possibly zero) links with i = i0, i0 + 1, ...
+ *
+ *****************************************************************************/
+
+static colloid_link_t * test_colloid_link_list(int nlink, int i0) {
+
+  int n;
+  colloid_link_t * head = NULL;
+  colloid_link_t * last = NULL;
+  colloid_link_t * p = NULL;
+
+  for (n = 0; n < nlink; n++) {
+    p = colloid_link_allocate();
+    assert(p);
+    p->i = i0 + n;
+    p->j = i0 + n + 1;
+    p->p = 1;
+    p->status = LINK_FLUID;
+    p->rb[X] = 1.0*n;
+    p->rb[Y] = 2.0;
+    p->rb[Z] = 3.0;
+    if (head == NULL) head = p;
+    if (last) last->next = p;
+    last = p;
+  }
+
+  return head;
+}
@@ -25,7 +25,8 @@
 #include "colloid_sums.h"
 #include "tests.h"
 
-static int dim_; /* Current direction */
+static int dim_;   /* Current direction */
+static int fused_; /* Use fused sum over all directions */
 
 static int test_colloid_sums_1d(pe_t * pe);
 static int test_colloid_sums_reference_set(colloid_t * cref, int seed);
@@ -49,6 +50,11 @@ int test_colloid_sums_suite(void) {
   pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
 
   test_colloid_sums_1d(pe);
+
+  fused_ = 1;
+  test_colloid_sums_1d(pe);
+  fused_ = 0;
+
   test_colloid_sums_move(pe);
   test_colloid_sums_conservation(pe);
 
@@ -169,20 +175,30 @@ static int test_colloid_sums_edge(pe_t * pe, cs_t * cs, int ncell[3],
 
   MPI_Barrier(MPI_COMM_WORLD);
   colloids_halo_state(cinfo);
-  colloid_sums_1d(halosum, X, COLLOID_SUM_STRUCTURE);
-  colloid_sums_1d(halosum, X, COLLOID_SUM_DYNAMICS);
-  colloid_sums_1d(halosum, X, COLLOID_SUM_ACTIVE);
-
-  if (dim_ == Y || dim_ == Z) {
-    colloid_sums_1d(halosum, Y, COLLOID_SUM_STRUCTURE);
-    colloid_sums_1d(halosum, Y, COLLOID_SUM_DYNAMICS);
-    colloid_sums_1d(halosum, Y, COLLOID_SUM_ACTIVE);
+
+  if (fused_) {
+    /* All three types at once; other directions have no copies */
+    colloid_sum_enum_t mtype[3] = {COLLOID_SUM_STRUCTURE,
+				   COLLOID_SUM_DYNAMICS,
+				   COLLOID_SUM_ACTIVE};
+    colloid_sums_halo_fused(cinfo, 3, mtype);
   }
+  else {
+    colloid_sums_1d(halosum, X, COLLOID_SUM_STRUCTURE);
+    colloid_sums_1d(halosum, X, COLLOID_SUM_DYNAMICS);
+    colloid_sums_1d(halosum, X, COLLOID_SUM_ACTIVE);
+
+    if (dim_ == Y || dim_ == Z) {
+      colloid_sums_1d(halosum, Y, COLLOID_SUM_STRUCTURE);
+      colloid_sums_1d(halosum, Y, COLLOID_SUM_DYNAMICS);
+      colloid_sums_1d(halosum, Y, COLLOID_SUM_ACTIVE);
+    }
 
-  if (dim_ == Z) {
-    colloid_sums_1d(halosum, Z, COLLOID_SUM_STRUCTURE);
-    colloid_sums_1d(halosum, Z, COLLOID_SUM_DYNAMICS);
-    colloid_sums_1d(halosum, Z, COLLOID_SUM_ACTIVE);
+    if (dim_ == Z) {
+      colloid_sums_1d(halosum, Z, COLLOID_SUM_STRUCTURE);
+      colloid_sums_1d(halosum, Z, COLLOID_SUM_DYNAMICS);
+      colloid_sums_1d(halosum, Z, COLLOID_SUM_ACTIVE);
+    }
   }
 
   /* Everywhere check colloid index = 1 has the correct sum */
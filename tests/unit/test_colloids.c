@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2016 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -23,9 +23,12 @@
 #include "colloids_s.h"
 #include "tests.h"
 
+#define TEST_NRANDOM 8
+
 int test_colloids_info_with_ncell(pe_t * pe, cs_t * cs, int ncellref[3]);
 int test_colloids_info_add_local(colloids_info_t * cinfo);
 int test_colloids_info_cell_coords(colloids_info_t * cinfo);
+int test_colloids_info_random(pe_t * pe, cs_t * cs);
 
 /*****************************************************************************
  *
@@ -64,6 +67,8 @@ int test_colloids_info_suite(void) {
   ncell[Z] = 8;
   test_colloids_info_with_ncell(pe, cs, ncell);
 
+  test_colloids_info_random(pe, cs);
+
   pe_info(pe, "PASS     ./unit/test_colloids\n");
 
   cs_free(cs);
@@ -274,3 +279,63 @@ int test_colloids_info_cell_coords(colloids_info_t * cinfo) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_colloids_info_random
+ *
+ *  The random numbers depend only on the seed, the stream, the
+ *  colloid index(es) and the step: not on the cell list or the
+ *  order of evaluation.
+ *
+ *****************************************************************************/
+
+int test_colloids_info_random(pe_t * pe, cs_t * cs) {
+
+  int n, ia;
+  int ncell1[3] = {2, 2, 2};
+  int ncell2[3] = {4, 4, 4};
+  double ref[TEST_NRANDOM + 1][4];
+  double g1[4];
+  colloids_info_t * cinfo1 = NULL;
+  colloids_info_t * cinfo2 = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  colloids_info_create(pe, cs, ncell1, &cinfo1);
+  colloids_info_create(pe, cs, ncell2, &cinfo2);
+
+  for (n = 1; n <= TEST_NRANDOM; n++) {
+    colloids_info_rng_gaussian(cinfo1, COLLOID_RNG_RANDOM, n, 0, 10, ref[n]);
+  }
+
+  /* Same values from a different cell list, in reverse order */
+
+  for (n = TEST_NRANDOM; n >= 1; n--) {
+    colloids_info_rng_gaussian(cinfo2, COLLOID_RNG_RANDOM, n, 0, 10, g1);
+    for (ia = 0; ia < 4; ia++) {
+      test_assert(g1[ia] == ref[n][ia]);
+    }
+  }
+
+  /* A different index, step, stream, or seed gives different values */
+
+  colloids_info_rng_gaussian(cinfo1, COLLOID_RNG_RANDOM, 1, 1, 10, g1);
+  test_assert(g1[0] != ref[1][0]);
+  colloids_info_rng_gaussian(cinfo1, COLLOID_RNG_RANDOM, 1, 0, 11, g1);
+  test_assert(g1[0] != ref[1][0]);
+  colloids_info_rng_gaussian(cinfo1, COLLOID_RNG_LUBRICATION, 1, 0, 10, g1);
+  test_assert(g1[0] != ref[1][0]);
+
+  colloids_info_rng_seed_set(cinfo1, 1);
+  colloids_info_rng_seed(cinfo1, &n);
+  test_assert(n == 1);
+  colloids_info_rng_gaussian(cinfo1, COLLOID_RNG_RANDOM, 1, 0, 10, g1);
+  test_assert(g1[0] != ref[1][0]);
+
+  colloids_info_free(cinfo2);
+  colloids_info_free(cinfo1);
+
+  return 0;
+}
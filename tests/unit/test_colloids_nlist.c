@@ -0,0 +1,279 @@
+/*****************************************************************************
+ *
+ *  test_colloids_nlist.c
+ *
+ *  Verlet neighbour list for pair interactions.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "colloids_s.h"
+#include "colloids_halo.h"
+#include "colloids_nlist.h"
+#include "pair_lj_cut.h"
+#include "tests.h"
+
+#define NLIST_NX     3
+#define NLIST_NC     (NLIST_NX*NLIST_NX*NLIST_NX)
+#define NLIST_AH     1.25
+#define NLIST_RC     3.0
+#define NLIST_SKIN   0.5
+
+static int test_colloids_nlist_forces(pe_t * pe, cs_t * cs);
+static int test_nlist_config(colloids_info_t * cinfo);
+static int test_nlist_move(colloids_info_t * cinfo, double dr);
+static int test_nlist_compare(colloids_info_t * cinfo, pair_lj_cut_t * lj);
+
+/*****************************************************************************
+ *
+ *  test_colloids_nlist_suite
+ *
+ *****************************************************************************/
+
+int test_colloids_nlist_suite(void) {
+
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_init(cs);
+
+  test_colloids_nlist_forces(pe, cs);
+
+  cs_free(cs);
+  pe_info(pe, "PASS     ./unit/test_colloids_nlist\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloids_nlist_forces
+ *
+ *  Forces computed via the list must agree exactly with those from
+ *  the cell list; the list should be rebuilt only when required.
+ *
+ *****************************************************************************/
+
+static int test_colloids_nlist_forces(pe_t * pe, cs_t * cs) {
+
+  int nbuild;
+  int ncell[3] = {4, 4, 4};
+  int serial;
+  double r[3];
+
+  colloid_t * pc = NULL;
+  colloids_info_t * cinfo = NULL;
+  colloids_nlist_t * nlist = NULL;
+  pair_lj_cut_t * lj = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  serial = (pe_mpi_size(pe) == 1);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  pair_lj_cut_create(pe, cs, &lj);
+  pair_lj_cut_param_set(lj, 1.0, 1.0, NLIST_RC);
+
+  test_nlist_config(cinfo);
+
+  colloids_nlist_create(pe, cs, NLIST_RC, 0.0, NLIST_SKIN, &nlist);
+  colloids_info_nlist_set(cinfo, nlist);
+
+  colloids_nlist_update(nlist, cinfo);
+  colloids_nlist_nbuild(nlist, &nbuild);
+  test_assert(nbuild == 1);
+  test_nlist_compare(cinfo, lj);
+
+  /* A move of less than half the skin does not require a rebuild */
+
+  test_nlist_move(cinfo, 0.1);
+  colloids_nlist_update(nlist, cinfo);
+  colloids_nlist_nbuild(nlist, &nbuild);
+  if (serial) test_assert(nbuild == 1);
+  test_nlist_compare(cinfo, lj);
+
+  /* A further move takes us past half the skin */
+
+  test_nlist_move(cinfo, 0.2);
+  colloids_nlist_update(nlist, cinfo);
+  colloids_nlist_nbuild(nlist, &nbuild);
+  if (serial) test_assert(nbuild == 2);
+  test_nlist_compare(cinfo, lj);
+
+  /* A new colloid always requires a rebuild */
+
+  r[X] = 24.0; r[Y] = 24.0; r[Z] = 28.0;
+  colloids_info_add_local(cinfo, NLIST_NC + 1, r, &pc);
+  if (pc) pc->s.ah = NLIST_AH;
+  colloids_info_ntotal_set(cinfo);
+  colloids_halo_state(cinfo);
+
+  colloids_nlist_update(nlist, cinfo);
+  colloids_nlist_nbuild(nlist, &nbuild);
+  if (serial) test_assert(nbuild == 3);
+  test_nlist_compare(cinfo, lj);
+
+  pair_lj_cut_free(lj);
+  colloids_info_free(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_nlist_config
+ *
+ *  A small cluster of colloids, some within the cut off, some within
+ *  the skin, and some beyond both. The cluster sits away from the
+ *  cell boundaries.
+ *
+ *****************************************************************************/
+
+static int test_nlist_config(colloids_info_t * cinfo) {
+
+  int i, j, k, n;
+  double r[3];
+  colloid_t * pc = NULL;
+
+  assert(cinfo);
+
+  for (i = 0; i < NLIST_NX; i++) {
+    for (j = 0; j < NLIST_NX; j++) {
+      for (k = 0; k < NLIST_NX; k++) {
+	n = 1 + k + NLIST_NX*(j + NLIST_NX*i);
+	r[X] = 20.0 + 2.7*i + 0.05*j;
+	r[Y] = 20.0 + 2.9*j + 0.07*k;
+	r[Z] = 20.0 + 3.3*k + 0.03*i;
+	colloids_info_add_local(cinfo, n, r, &pc);
+	if (pc) pc->s.ah = NLIST_AH;
+      }
+    }
+  }
+
+  colloids_info_ntotal_set(cinfo);
+  colloids_halo_state(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_nlist_move
+ *
+ *  Displace each colloid (including any halo copies) by a distance
+ *  dr in a direction which depends on the index.
+ *
+ *****************************************************************************/
+
+static int test_nlist_move(colloids_info_t * cinfo, double dr) {
+
+  int ic, jc, kc;
+  int ia;
+  colloid_t * pc = NULL;
+
+  assert(cinfo);
+
+  for (ic = 1 - cinfo->nhalo; ic <= cinfo->ncell[X] + cinfo->nhalo; ic++) {
+    for (jc = 1 - cinfo->nhalo; jc <= cinfo->ncell[Y] + cinfo->nhalo; jc++) {
+      for (kc = 1 - cinfo->nhalo; kc <= cinfo->ncell[Z] + cinfo->nhalo; kc++) {
+	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+	for (; pc; pc = pc->next) {
+	  ia = pc->s.index % 3;
+	  pc->s.r[ia] += ((pc->s.index % 2) ? dr : -dr);
+	}
+      }
+    }
+  }
+
+  colloids_info_update_cell_list(cinfo);
+  colloids_halo_state(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_nlist_compare
+ *
+ *  Compare forces and potential energy with and without the list.
+ *
+ *****************************************************************************/
+
+static int test_nlist_compare(colloids_info_t * cinfo, pair_lj_cut_t * lj) {
+
+  int n;
+  double fsum = 0.0;
+  double * fref = NULL;
+  double stats0[INTERACT_STAT_MAX];
+  double stats1[INTERACT_STAT_MAX];
+  colloid_t * pc = NULL;
+  colloids_nlist_t * nlist = NULL;
+
+  assert(cinfo);
+  assert(lj);
+
+  colloids_info_list_all_build(cinfo);
+
+  fref = (double *) calloc(3*(NLIST_NC + 2), sizeof(double));
+  assert(fref);
+
+  /* Reference from the cell list */
+
+  nlist = cinfo->nlist;
+  cinfo->nlist = NULL;
+
+  colloids_update_forces_zero(cinfo);
+  pair_lj_cut_compute(cinfo, lj);
+  pair_lj_cut_stats(lj, stats0);
+
+  colloids_info_all_head(cinfo, &pc);
+  for (; pc; pc = pc->nextall) {
+    n = pc->s.index;
+    assert(n <= NLIST_NC + 1);
+    fref[3*n + X] = pc->force[X];
+    fref[3*n + Y] = pc->force[Y];
+    fref[3*n + Z] = pc->force[Z];
+    fsum += fabs(pc->force[X]) + fabs(pc->force[Y]) + fabs(pc->force[Z]);
+  }
+
+  if (pe_mpi_size(cinfo->pe) == 1) test_assert(fsum > 0.0);
+
+  /* Neighbour list */
+
+  cinfo->nlist = nlist;
+
+  colloids_update_forces_zero(cinfo);
+  pair_lj_cut_compute(cinfo, lj);
+  pair_lj_cut_stats(lj, stats1);
+
+  colloids_info_all_head(cinfo, &pc);
+  for (; pc; pc = pc->nextall) {
+    n = pc->s.index;
+    test_assert(pc->force[X] == fref[3*n + X]);
+    test_assert(pc->force[Y] == fref[3*n + Y]);
+    test_assert(pc->force[Z] == fref[3*n + Z]);
+  }
+
+  test_assert(stats1[INTERACT_STAT_VLOCAL] == stats0[INTERACT_STAT_VLOCAL]);
+
+  free(fref);
+
+  return 0;
+}
@@ -0,0 +1,186 @@
+/*****************************************************************************
+ *
+ *  test_colloids_soa.c
+ *
+ *  Packed store for colloid pair interactions.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "colloids_s.h"
+#include "colloids_halo.h"
+#include "colloids_soa.h"
+#include "tests.h"
+
+#define SOA_NC 8
+
+static int test_colloids_soa_build(pe_t * pe, cs_t * cs);
+static int test_colloids_soa_order(colloids_info_t * cinfo,
+				   colloids_soa_t * soa);
+
+/*****************************************************************************
+ *
+ *  test_colloids_soa_suite
+ *
+ *****************************************************************************/
+
+int test_colloids_soa_suite(void) {
+
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_init(cs);
+
+  test_colloids_soa_build(pe, cs);
+
+  cs_free(cs);
+  pe_info(pe, "PASS     ./unit/test_colloids_soa\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloids_soa_build
+ *
+ *  Slots follow the cell list, gather and scatter agree with the
+ *  handles, and the slots change only if the order changes.
+ *
+ *****************************************************************************/
+
+static int test_colloids_soa_build(pe_t * pe, cs_t * cs) {
+
+  int n, nbuild;
+  int ncell[3] = {4, 4, 4};
+  double r[3];
+
+  colloid_t * pc = NULL;
+  colloids_info_t * cinfo = NULL;
+  colloids_soa_t * soa = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_soa(cinfo, &soa);
+  test_assert(soa != NULL);
+
+  for (n = 1; n <= SOA_NC; n++) {
+    r[X] = 20.0 + 3.0*n;
+    r[Y] = 44.0 - 2.5*n;
+    r[Z] = 20.0 + 1.5*n*(n % 3);
+    colloids_info_add_local(cinfo, n, r, &pc);
+    if (pc) {
+      pc->s.ah = 1.0 + 0.1*n;
+      pc->s.v[X] = 0.01*n;
+      pc->force[Y] = -1.0*n;
+    }
+  }
+
+  colloids_info_ntotal_set(cinfo);
+  colloids_halo_state(cinfo);
+
+  colloids_soa_build(soa, cinfo);
+  test_colloids_soa_order(cinfo, soa);
+  nbuild = soa->nbuild;
+
+  for (n = 0; n < soa->nall; n++) {
+    pc = soa->pc[n];
+    test_assert(soa->index[n] == pc->s.index);
+    test_assert(soa->ah[n] == pc->s.ah);
+    test_assert(soa->r[X][n] == pc->s.r[X]);
+    test_assert(soa->r[Y][n] == pc->s.r[Y]);
+    test_assert(soa->r[Z][n] == pc->s.r[Z]);
+    test_assert(soa->v[X][n] == pc->s.v[X]);
+    test_assert(soa->force[Y][n] == pc->force[Y]);
+  }
+
+  /* Scatter returns force and torque */
+
+  for (n = 0; n < soa->nall; n++) {
+    soa->force[Z][n] = 2.0*n;
+    soa->torque[X][n] = 3.0*n;
+  }
+
+  colloids_soa_scatter(soa);
+
+  for (n = 0; n < soa->nall; n++) {
+    test_assert(soa->pc[n]->force[Z] == 2.0*n);
+    test_assert(soa->pc[n]->torque[X] == 3.0*n);
+  }
+
+  /* No change in order: slots are retained */
+
+  colloids_soa_build(soa, cinfo);
+  test_assert(soa->nbuild == nbuild);
+
+  /* Move the first colloid to the last occupied cell: new slots */
+
+  if (soa->nall > 1) {
+    pc = soa->pc[0];
+    pc->s.r[X] = soa->r[X][soa->nall - 1];
+    pc->s.r[Y] = soa->r[Y][soa->nall - 1];
+    pc->s.r[Z] = soa->r[Z][soa->nall - 1];
+    colloids_info_update_cell_list(cinfo);
+
+    colloids_soa_build(soa, cinfo);
+    test_colloids_soa_order(cinfo, soa);
+    test_assert(soa->nbuild == nbuild + 1);
+    test_assert(soa->pc[pc->isoa] == pc);
+    test_assert(pc->isoa > 0);
+  }
+
+  colloids_info_free(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloids_soa_order
+ *
+ *  Each cell's slots are its cell list in order.
+ *
+ *****************************************************************************/
+
+static int test_colloids_soa_order(colloids_info_t * cinfo,
+				   colloids_soa_t * soa) {
+  int ic, n;
+  int nall = 0;
+  colloid_t * pc = NULL;
+
+  assert(cinfo);
+  assert(soa);
+
+  test_assert(soa->cstart[0] == 0);
+
+  for (ic = 0; ic < cinfo->ncells; ic++) {
+    n = soa->cstart[ic];
+    for (pc = cinfo->clist[ic]; pc; pc = pc->next) {
+      test_assert(soa->pc[n] == pc);
+      test_assert(pc->isoa == n);
+      n += 1;
+      nall += 1;
+    }
+    test_assert(n == soa->cstart[ic + 1]);
+  }
+
+  test_assert(nall == soa->nall);
+
+  return 0;
+}
@@ -10,7 +10,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -24,10 +24,15 @@
 #include "pe.h"
 #include "coords.h"
 #include "colloids.h"
+#include "util.h"
 #include "ewald.h"
 #include "tests.h"
 
 #define TOLERANCE 1.0e-07
+#define EWALD_PME_NTEST     6
+#define EWALD_PME_TOLERANCE 1.0e-04
+
+static int test_ewald_pme(pe_t * pe, cs_t * cs);
 
 /*****************************************************************************
  *
@@ -451,12 +456,121 @@ int test_ewald_suite(void) {
   /* test_assert(fabs(e - -0.00186468) < TOLERANCE);*/
 
   ewald_free(ewald);
+  colloids_info_free(cinfo);
+
+  test_ewald_pme(pe, cs);
 
   pe_info(pe, "PASS     ./unit/test_ewald\n");
 
-  colloids_info_free(cinfo);
   cs_free(cs);
   pe_free(pe);
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_ewald_pme
+ *
+ *  The particle-mesh Fourier space sum should agree with the direct
+ *  sum for energy, force and torque, for a small set of dipoles.
+ *
+ *****************************************************************************/
+
+static int test_ewald_pme(pe_t * pe, cs_t * cs) {
+
+  int n, ia;
+  int ncell[3] = {2, 2, 2};
+  double mu = 0.285;
+  double rc = 16.0;
+  double r[3], smod;
+  double ereal, eself;
+  double edirect, epme;
+  double fmax = 0.0, tmax = 0.0;
+  double fdirect[EWALD_PME_NTEST][3];
+  double tdirect[EWALD_PME_NTEST][3];
+
+  colloid_t * pc[EWALD_PME_NTEST];
+  colloids_info_t * cinfo = NULL;
+  ewald_t * ewald = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+
+  for (n = 0; n < EWALD_PME_NTEST; n++) {
+    r[X] = 1.0 + 13.7*n + 2.3*(n % 2);
+    r[Y] = 5.0 + 9.1*n*n - 3.0*n;
+    r[Z] = 60.0 - 11.3*n;
+    for (ia = 0; ia < 3; ia++) {
+      r[ia] = fmod(r[ia], 64.0) + 0.5;
+    }
+    colloids_info_add_local(cinfo, n + 1, r, pc + n);
+    test_assert(pc[n] != NULL);
+    pc[n]->s.a0 = 2.3;
+    pc[n]->s.ah = 2.3;
+    pc[n]->s.s[X] = cos(1.3*n);
+    pc[n]->s.s[Y] = sin(1.3*n)*cos(0.7*n + 0.2);
+    pc[n]->s.s[Z] = sin(1.3*n)*sin(0.7*n + 0.2);
+    smod = modulus(pc[n]->s.s);
+    for (ia = 0; ia < 3; ia++) {
+      pc[n]->s.s[ia] /= smod;
+    }
+  }
+  colloids_info_ntotal_set(cinfo);
+
+  ewald_create(pe, cs, mu, rc, cinfo, &ewald);
+
+  /* Direct sum */
+
+  for (n = 0; n < EWALD_PME_NTEST; n++) {
+    for (ia = 0; ia < 3; ia++) {
+      pc[n]->force[ia] = 0.0;
+      pc[n]->torque[ia] = 0.0;
+    }
+  }
+  ewald_fourier_space_sum(ewald);
+  ewald_total_energy(ewald, &ereal, &edirect, &eself);
+
+  for (n = 0; n < EWALD_PME_NTEST; n++) {
+    for (ia = 0; ia < 3; ia++) {
+      fdirect[n][ia] = pc[n]->force[ia];
+      tdirect[n][ia] = pc[n]->torque[ia];
+      fmax = dmax(fmax, fabs(fdirect[n][ia]));
+      tmax = dmax(tmax, fabs(tdirect[n][ia]));
+    }
+  }
+
+  test_assert(fmax > 0.0);
+  test_assert(tmax > 0.0);
+
+  /* PME with default mesh; the error falls with increasing order */
+
+  ewald_fourier_pme_set(ewald, 10, NULL);
+
+  for (n = 0; n < EWALD_PME_NTEST; n++) {
+    for (ia = 0; ia < 3; ia++) {
+      pc[n]->force[ia] = 0.0;
+      pc[n]->torque[ia] = 0.0;
+    }
+  }
+  ewald_fourier_space_sum_pme(ewald);
+  ewald_total_energy(ewald, &ereal, &epme, &eself);
+
+  test_assert(fabs(epme - edirect) < EWALD_PME_TOLERANCE*fabs(edirect));
+
+  for (n = 0; n < EWALD_PME_NTEST; n++) {
+    for (ia = 0; ia < 3; ia++) {
+      test_assert(fabs(pc[n]->force[ia] - fdirect[n][ia])
+		  < EWALD_PME_TOLERANCE*fmax);
+      test_assert(fabs(pc[n]->torque[ia] - tdirect[n][ia])
+		  < EWALD_PME_TOLERANCE*tmax);
+    }
+  }
+
+  ewald_free(ewald);
+  colloids_info_free(cinfo);
+
+  return 0;
+}
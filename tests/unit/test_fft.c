@@ -0,0 +1,167 @@
+/*****************************************************************************
+ *
+ *  test_fft.c
+ *
+ *  Built-in three-dimensional FFT.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "util.h"
+#include "fft.h"
+#include "tests.h"
+
+static int do_test_fft(pe_t * pe, const int ntotal[3]);
+static int test_fft_data(const int ntotal[3], int ix, int iy, int iz,
+			 double * re, double * im);
+
+/*****************************************************************************
+ *
+ *  test_fft_suite
+ *
+ *****************************************************************************/
+
+int test_fft_suite(void) {
+
+  int ntotal1[3] = {8, 4, 16};   /* Radix 2 */
+  int ntotal2[3] = {6, 5, 8};    /* Some direct transforms */
+  pe_t * pe = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+
+  do_test_fft(pe, ntotal1);
+  do_test_fft(pe, ntotal2);
+
+  pe_info(pe, "PASS     ./unit/test_fft\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_fft
+ *
+ *  Compare the forward transform with a direct sum, and check the
+ *  backward transform recovers the original data (times N).
+ *
+ *****************************************************************************/
+
+static int do_test_fft(pe_t * pe, const int ntotal[3]) {
+
+  int ix, iy, iz, jx, jy, jz;
+  int x0, nx, y0, ny;
+  int n, ntot;
+  double re, im, sre, sim, arg;
+  double * xdata = NULL;
+  double * ydata = NULL;
+  fft_t * fft = NULL;
+  PI_DOUBLE(pi);
+
+  assert(pe);
+
+  ntot = ntotal[X]*ntotal[Y]*ntotal[Z];
+
+  fft_create(pe, MPI_COMM_WORLD, ntotal, &fft);
+  fft_xslab(fft, &x0, &nx);
+  fft_yslab(fft, &y0, &ny);
+
+  xdata = (double *) calloc(imax(1, 2*nx*ntotal[Y]*ntotal[Z]), sizeof(double));
+  ydata = (double *) calloc(imax(1, 2*ny*ntotal[X]*ntotal[Z]), sizeof(double));
+  assert(xdata);
+  assert(ydata);
+
+  for (ix = 0; ix < nx; ix++) {
+    for (iy = 0; iy < ntotal[Y]; iy++) {
+      for (iz = 0; iz < ntotal[Z]; iz++) {
+	n = (ix*ntotal[Y] + iy)*ntotal[Z] + iz;
+	test_fft_data(ntotal, x0 + ix, iy, iz, xdata + 2*n, xdata + 2*n + 1);
+      }
+    }
+  }
+
+  fft_forward(fft, xdata, ydata);
+
+  for (jy = 0; jy < ny; jy++) {
+    for (jx = 0; jx < ntotal[X]; jx++) {
+      for (jz = 0; jz < ntotal[Z]; jz++) {
+
+	sre = 0.0;
+	sim = 0.0;
+	for (ix = 0; ix < ntotal[X]; ix++) {
+	  for (iy = 0; iy < ntotal[Y]; iy++) {
+	    for (iz = 0; iz < ntotal[Z]; iz++) {
+	      test_fft_data(ntotal, ix, iy, iz, &re, &im);
+	      arg = -2.0*pi*((double) jx*ix/ntotal[X]
+			     + (double) (y0 + jy)*iy/ntotal[Y]
+			     + (double) jz*iz/ntotal[Z]);
+	      sre += re*cos(arg) - im*sin(arg);
+	      sim += re*sin(arg) + im*cos(arg);
+	    }
+	  }
+	}
+
+	n = (jy*ntotal[X] + jx)*ntotal[Z] + jz;
+	test_assert(fabs(ydata[2*n    ] - sre) < FLT_EPSILON);
+	test_assert(fabs(ydata[2*n + 1] - sim) < FLT_EPSILON);
+      }
+    }
+  }
+
+  fft_backward(fft, ydata, xdata);
+
+  for (ix = 0; ix < nx; ix++) {
+    for (iy = 0; iy < ntotal[Y]; iy++) {
+      for (iz = 0; iz < ntotal[Z]; iz++) {
+	n = (ix*ntotal[Y] + iy)*ntotal[Z] + iz;
+	test_fft_data(ntotal, x0 + ix, iy, iz, &re, &im);
+	test_assert(fabs(xdata[2*n    ] - ntot*re) < FLT_EPSILON);
+	test_assert(fabs(xdata[2*n + 1] - ntot*im) < FLT_EPSILON);
+      }
+    }
+  }
+
+  free(ydata);
+  free(xdata);
+  fft_free(fft);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_fft_data
+ *
+ *  A deterministic function of global position.
+ *
+ *****************************************************************************/
+
+static int test_fft_data(const int ntotal[3], int ix, int iy, int iz,
+			 double * re, double * im) {
+
+  int n;
+
+  assert(re);
+  assert(im);
+
+  n = (ix*ntotal[Y] + iy)*ntotal[Z] + iz;
+
+  *re = sin(0.37*n + 0.1*ix);
+  *im = cos(0.23*n - 0.3*iz);
+
+  return 0;
+}
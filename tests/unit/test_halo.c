@@ -8,7 +8,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -23,13 +23,14 @@
 
 #include "pe.h"
 #include "coords.h"
-#include "model.h"
+#include "lb_model_s.h"
 #include "control.h"
 #include "tests.h"
 
 int do_test_const_blocks(void);
 int do_test_halo_null(pe_t * pe, cs_t * cs, lb_halo_enum_t halo);
 int do_test_halo(pe_t * pe, cs_t * cs, int dim, const lb_halo_enum_t halo);
+int do_test_halo_split(pe_t * pe, cs_t * cs);
 
 /*****************************************************************************
  *
@@ -61,6 +62,7 @@ int test_halo_suite(void) {
     do_test_halo(pe, cs, Z, LB_HALO_REDUCED);
   }
 
+  do_test_halo_split(pe, cs);
 
   pe_info(pe, "PASS     ./unit/test_halo\n");
   cs_free(cs);
@@ -316,7 +318,8 @@ int do_test_halo(pe_t * pe, cs_t * cs, int dim, lb_halo_enum_t halo) {
 
 	      for (p = 0; p < NVEL; p++) {
 		lb_f(lb, index, p, nd, &f_actual);
-		test_assert(fabs(f_actual-f_expect) < DBL_EPSILON);
+		test_assert(fabs(f_actual - f_expect)
+			    < LB_DATA_EPSILON*(1.0 + f_expect));
 	      }
 	    }
 
@@ -328,7 +331,8 @@ int do_test_halo(pe_t * pe, cs_t * cs, int dim, lb_halo_enum_t halo) {
 
 	      for (p = 0; p < NVEL; p++) {
 		lb_f(lb, index, p, nd, &f_actual);
-		test_assert(fabs(f_actual-f_expect) < DBL_EPSILON);
+		test_assert(fabs(f_actual - f_expect)
+			    < LB_DATA_EPSILON*(1.0 + f_expect));
 	      }
 	    }
 	  }
@@ -342,3 +346,116 @@ int do_test_halo(pe_t * pe, cs_t * cs, int dim, lb_halo_enum_t halo) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  do_test_halo_split
+ *
+ *  The split-phase lb_halo_start() / lb_halo_finish() must give the
+ *  same halo as lb_halo(), while the interior may be updated between
+ *  the two.
+ *
+ *****************************************************************************/
+
+int do_test_halo_split(pe_t * pe, cs_t * cs) {
+
+  int nlocal[3];
+  int ic, jc, kc, index, p;
+  int ndata;
+  int isinterior;
+  double f, f_expect;
+  double * fref = NULL;
+  lb_t * lb = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  lb_create(pe, cs, &lb);
+  lb_init(lb);
+
+  cs_nlocal(cs, nlocal);
+  cs_nsites(cs, &ndata);
+
+  fref = (double *) calloc(NVEL*ndata, sizeof(double));
+  assert(fref);
+
+  /* Reference: distinct value at each local site, then lb_halo() */
+
+  for (ic = 0; ic <= nlocal[X] + 1; ic++) {
+    for (jc = 0; jc <= nlocal[Y] + 1; jc++) {
+      for (kc = 0; kc <= nlocal[Z] + 1; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	for (p = 0; p < NVEL; p++) {
+	  lb_f_set(lb, index, p, 0, -1.0);
+	  if (ic < 1 || ic > nlocal[X]) continue;
+	  if (jc < 1 || jc > nlocal[Y]) continue;
+	  if (kc < 1 || kc > nlocal[Z]) continue;
+	  lb_f_set(lb, index, p, 0, 1.0*(NVEL*index + p));
+	}
+      }
+    }
+  }
+
+  lb_memcpy(lb, tdpMemcpyHostToDevice);
+  lb_halo(lb);
+  lb_memcpy(lb, tdpMemcpyDeviceToHost);
+
+  for (ic = 0; ic <= nlocal[X] + 1; ic++) {
+    for (jc = 0; jc <= nlocal[Y] + 1; jc++) {
+      for (kc = 0; kc <= nlocal[Z] + 1; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	for (p = 0; p < NVEL; p++) {
+	  lb_f(lb, index, p, 0, &f);
+	  fref[NVEL*index + p] = f;
+	  isinterior = (ic > 1 && ic < nlocal[X] && jc > 1 && jc < nlocal[Y]
+			&& kc > 1 && kc < nlocal[Z]);
+	  if (ic < 1 || ic > nlocal[X] || jc < 1 || jc > nlocal[Y] ||
+	      kc < 1 || kc > nlocal[Z]) {
+	    lb_f_set(lb, index, p, 0, -1.0);
+	  }
+	  else if (isinterior) {
+	    /* Interior will be updated between start and finish */
+	    fref[NVEL*index + p] = -2.0;
+	  }
+	}
+      }
+    }
+  }
+
+  lb_memcpy(lb, tdpMemcpyHostToDevice);
+  lb_halo_start(lb);
+
+  for (ic = 2; ic < nlocal[X]; ic++) {
+    for (jc = 2; jc < nlocal[Y]; jc++) {
+      for (kc = 2; kc < nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	for (p = 0; p < NVEL; p++) {
+	  lb_f_set(lb, index, p, 0, -2.0);
+	}
+      }
+    }
+  }
+  lb_memcpy(lb, tdpMemcpyHostToDevice);
+
+  lb_halo_finish(lb);
+  lb_memcpy(lb, tdpMemcpyDeviceToHost);
+
+  for (ic = 0; ic <= nlocal[X] + 1; ic++) {
+    for (jc = 0; jc <= nlocal[Y] + 1; jc++) {
+      for (kc = 0; kc <= nlocal[Z] + 1; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	for (p = 0; p < NVEL; p++) {
+	  f_expect = fref[NVEL*index + p];
+	  lb_f(lb, index, p, 0, &f);
+	  test_assert(fabs(f - f_expect)
+		      < LB_DATA_EPSILON*(1.0 + fabs(f_expect)));
+	}
+      }
+    }
+  }
+
+  free(fref);
+  lb_free(lb);
+
+  return 0;
+}
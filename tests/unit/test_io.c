@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2019 The University of Edinburgh
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
@@ -16,11 +16,13 @@
 #include <assert.h>
 #include <float.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 #include "pe.h"
 #include "coords.h"
+#include "memory.h"
 #include "io_harness.h"
 #include "tests.h"
 
@@ -31,6 +33,10 @@ struct test_io_s {
 };
 
 int do_test_io_info_struct(pe_t * pe, cs_t * cs);
+int do_test_io_mpiio(pe_t * pe, cs_t * cs);
+int do_test_io_async(pe_t * pe, cs_t * cs);
+int do_test_io_metadata_check(pe_t * pe, cs_t * cs);
+int do_test_io_pack_rank1(pe_t * pe, cs_t * cs);
 static int  test_io_read1(FILE *, int index, void * self);
 static int  test_io_write1(FILE *, int index, void * self);
 static int  test_io_read3(FILE *, int index, void * self);
@@ -52,6 +58,10 @@ int test_io_suite(void) {
   cs_init(cs);
 
   do_test_io_info_struct(pe, cs);
+  do_test_io_mpiio(pe, cs);
+  do_test_io_async(pe, cs);
+  do_test_io_metadata_check(pe, cs);
+  do_test_io_pack_rank1(pe, cs);
   /* if (pe_size() == cart_size(X)) test_processor_independent();
      test_ascii();*/
 
@@ -140,6 +150,309 @@ int do_test_io_info_struct(pe_t * pe, cs_t * cs) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  do_test_io_mpiio
+ *
+ *  Binary round trip via collective MPI-IO. An existing, longer, file
+ *  of the same name must be truncated.
+ *
+ *****************************************************************************/
+
+int do_test_io_mpiio(pe_t * pe, cs_t * cs) {
+
+  char stubp[FILENAME_MAX];
+  char filename[2*FILENAME_MAX];
+  test_io_t data = {2, 1.0};
+  io_info_arg_t args;
+  io_info_t * io_info = NULL;
+  FILE * fp = NULL;
+  int ntotal[3];
+  long int nbytes = 0;
+
+  assert(pe);
+  assert(cs);
+
+  sprintf(stubp, "/tmp/temp-test-io-mpiio");
+  sprintf(filename, "%s.%3.3d-%3.3d", stubp, 1, 1);
+
+  args.grid[X] = 1;
+  args.grid[Y] = 1;
+  args.grid[Z] = 1;
+
+  io_info_create(pe, cs, &args, &io_info);
+  assert(io_info);
+
+  io_info_set_name(io_info, "Test MPI-IO data");
+  io_info_set_bytesize(io_info, IO_FORMAT_BINARY, sizeof(double));
+  io_info_write_set(io_info, IO_FORMAT_BINARY, test_io_write1);
+  io_info_read_set(io_info, IO_FORMAT_BINARY, test_io_read1);
+  io_info_format_set(io_info, IO_FORMAT_BINARY, IO_FORMAT_BINARY);
+  io_info_metadata_filestub_set(io_info, stubp);
+  io_info_mpiio_set(io_info, 1);
+
+  cs_ntotal(cs, ntotal);
+
+  if (pe_mpi_rank(pe) == 0) {
+    fp = fopen(filename, "w");
+    test_assert(fp != NULL);
+    fseek(fp, 2*sizeof(double)*ntotal[X]*ntotal[Y]*ntotal[Z] - 1, SEEK_SET);
+    fputc(0, fp);
+    fclose(fp);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  io_write_data(io_info, stubp, &data);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  /* One file for the whole lattice */
+
+  if (pe_mpi_rank(pe) == 0) {
+    fp = fopen(filename, "r");
+    test_assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    nbytes = ftell(fp);
+    fclose(fp);
+    test_assert(nbytes == sizeof(double)*ntotal[X]*ntotal[Y]*ntotal[Z]);
+  }
+
+  io_read_data(io_info, stubp, &data);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (pe_mpi_rank(pe) == 0) remove(filename);
+  io_remove_metadata(io_info, stubp);
+  io_info_free(io_info);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_io_async
+ *
+ *  Binary round trip via the background writer. Two writes to the
+ *  same file are queued with a queue depth of one. An existing, longer,
+ *  file of the same name must be truncated.
+ *
+ *****************************************************************************/
+
+int do_test_io_async(pe_t * pe, cs_t * cs) {
+
+  char stubp[FILENAME_MAX];
+  char filename[2*FILENAME_MAX];
+  test_io_t data = {2, 1.0};
+  io_info_arg_t args;
+  io_info_t * io_info = NULL;
+  io_async_t * async = NULL;
+  int nqueue = 0;
+  int ntotal[3];
+  long int fsize;
+  FILE * fp = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  sprintf(stubp, "/tmp/temp-test-io-async");
+  sprintf(filename, "%s.%3.3d-%3.3d", stubp, 1, 1);
+
+  io_async_create(pe, 1, &async);
+  io_async_nqueue(async, &nqueue);
+  test_assert(nqueue == 1);
+
+  args.grid[X] = 1;
+  args.grid[Y] = 1;
+  args.grid[Z] = 1;
+
+  io_info_create(pe, cs, &args, &io_info);
+  assert(io_info);
+
+  io_info_set_name(io_info, "Test async data");
+  io_info_set_bytesize(io_info, IO_FORMAT_BINARY, sizeof(double));
+  io_info_write_set(io_info, IO_FORMAT_BINARY, test_io_write1);
+  io_info_read_set(io_info, IO_FORMAT_BINARY, test_io_read1);
+  io_info_format_set(io_info, IO_FORMAT_BINARY, IO_FORMAT_BINARY);
+  io_info_metadata_filestub_set(io_info, stubp);
+  io_info_async_set(io_info, async);
+
+  cs_ntotal(cs, ntotal);
+  fsize = sizeof(double)*ntotal[X]*ntotal[Y]*ntotal[Z];
+
+  if (pe_mpi_rank(pe) == 0) {
+    fp = fopen(filename, "w");
+    test_assert(fp != NULL);
+    fseek(fp, 2*fsize - 1, SEEK_SET);
+    fputc(0, fp);
+    fclose(fp);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  io_write_data(io_info, stubp, &data);
+  io_write_data(io_info, stubp, &data);
+  io_async_flush(async);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (pe_mpi_rank(pe) == 0) {
+    fp = fopen(filename, "r");
+    test_assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    test_assert(ftell(fp) == fsize);
+    fclose(fp);
+  }
+
+  io_read_data(io_info, stubp, &data);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (pe_mpi_rank(pe) == 0) remove(filename);
+  io_remove_metadata(io_info, stubp);
+  io_info_free(io_info);
+  io_async_free(async);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_io_metadata_check
+ *
+ *  A read must be refused if the data description or the size per
+ *  site differ from those recorded in the metadata, e.g., float
+ *  rather than double data.
+ *
+ *****************************************************************************/
+
+int do_test_io_metadata_check(pe_t * pe, cs_t * cs) {
+
+  char stubp[FILENAME_MAX];
+  io_info_arg_t args;
+  io_info_t * io_info = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  sprintf(stubp, "/tmp/temp-test-io-meta");
+
+  args.grid[X] = 1;
+  args.grid[Y] = 1;
+  args.grid[Z] = 1;
+
+  io_info_create(pe, cs, &args, &io_info);
+  assert(io_info);
+
+  io_info_set_name(io_info, "Test double data");
+  io_info_set_bytesize(io_info, IO_FORMAT_BINARY, sizeof(double));
+  io_info_format_set(io_info, IO_FORMAT_BINARY, IO_FORMAT_BINARY);
+
+  /* No metadata file is not an error */
+
+  io_remove_metadata(io_info, stubp);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  test_assert(io_read_metadata_check(io_info, stubp) == 0);
+
+  io_write_metadata_file(io_info, stubp);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  test_assert(io_read_metadata_check(io_info, stubp) == 0);
+
+  io_info_set_bytesize(io_info, IO_FORMAT_BINARY, sizeof(float));
+  io_info_format_set(io_info, IO_FORMAT_BINARY, IO_FORMAT_BINARY);
+  test_assert(io_read_metadata_check(io_info, stubp) != 0);
+
+  io_info_set_bytesize(io_info, IO_FORMAT_BINARY, sizeof(double));
+  io_info_format_set(io_info, IO_FORMAT_BINARY, IO_FORMAT_BINARY);
+  io_info_set_name(io_info, "Test double data (float)");
+  test_assert(io_read_metadata_check(io_info, stubp) != 0);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  io_remove_metadata(io_info, stubp);
+  io_info_free(io_info);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_io_pack_rank1
+ *
+ *  Pack a rank 1 field into a record of one char plus the field
+ *  (so the field is at offset 1), check the file order, and unpack.
+ *
+ *****************************************************************************/
+
+int do_test_io_pack_rank1(pe_t * pe, cs_t * cs) {
+
+  int ic, jc, kc, ia;
+  int index;
+  int nsites;
+  int nlocal[3];
+  const int na = 3;
+  size_t ib = 0;
+  size_t recsz = sizeof(char) + na*sizeof(double);
+  double * data = NULL;
+  double * copy = NULL;
+  char * buf = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  cs_nsites(cs, &nsites);
+  cs_nlocal(cs, nlocal);
+
+  data = (double *) calloc(na*nsites, sizeof(double));
+  copy = (double *) calloc(na*nsites, sizeof(double));
+  buf = (char *) calloc(recsz*nlocal[X]*nlocal[Y]*nlocal[Z], sizeof(char));
+  assert(data);
+  assert(copy);
+  assert(buf);
+
+  for (index = 0; index < nsites; index++) {
+    for (ia = 0; ia < na; ia++) {
+      data[addr_rank1(nsites, na, index, ia)] = 1.0*na*index + ia;
+    }
+  }
+
+  io_pack_rank1(cs, nsites, na, sizeof(double), data, recsz, sizeof(char),
+		buf);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	double dval;
+	index = cs_index(cs, ic, jc, kc);
+	test_assert(buf[ib] == 0);
+	for (ia = 0; ia < na; ia++) {
+	  memcpy(&dval, buf + ib + sizeof(char) + ia*sizeof(double),
+		 sizeof(double));
+	  test_assert(fabs(dval - (1.0*na*index + ia)) < DBL_EPSILON);
+	}
+	ib += recsz;
+      }
+    }
+  }
+
+  io_unpack_rank1(cs, nsites, na, sizeof(double), copy, recsz, sizeof(char),
+		  buf);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	for (ia = 0; ia < na; ia++) {
+	  test_assert(fabs(copy[addr_rank1(nsites, na, index, ia)]
+			   - data[addr_rank1(nsites, na, index, ia)])
+		      < DBL_EPSILON);
+	}
+      }
+    }
+  }
+
+  free(buf);
+  free(copy);
+  free(data);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  test_write_1
@@ -88,6 +88,27 @@ __host__ int test_kernel_suite(void) {
 
   do_test_kernel(cs, lim, data);
 
+  /* Tiled iteration, including partial tiles */
+
+  {
+    int tile1[3] = {2, 3, 0};
+    int tile2[3] = {3, 5, 7};
+    int tile0[3] = {0, 0, 0};
+
+    kernel_tile_set(tile1);
+    do_test_kernel(cs, lim, data);
+    kernel_tile_set(tile2);
+    do_test_kernel(cs, lim, data);
+
+    lim.imin = 1; lim.imax = nlocal[X];
+    lim.jmin = 1; lim.jmax = nlocal[Y];
+    lim.kmin = 1; lim.kmax = nlocal[Z];
+    data_zero(data);
+    do_test_kernel(cs, lim, data);
+
+    kernel_tile_set(tile0);
+  }
+
   data_free(data);
 
   cs_free(cs);
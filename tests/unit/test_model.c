@@ -29,6 +29,7 @@ static void test_model_constants(void);
 static void test_model_velocity_set(void);
 
 int do_test_model_distributions(pe_t * pe, cs_t * cs);
+int do_test_model_storage(pe_t * pe, cs_t * cs);
 int do_test_model_halo_swap(pe_t * pe, cs_t * cs);
 int do_test_model_reduced_halo_swap(pe_t * pe, cs_t * cs);
 int do_test_lb_model_io(pe_t * pe, cs_t * cs);
@@ -58,6 +59,7 @@ int test_model_suite(void) {
   /* Now test actual distributions */
 
   do_test_model_distributions(pe, cs);
+  do_test_model_storage(pe, cs);
   do_test_model_halo_swap(pe, cs);
   if (DATA_MODEL == DATA_MODEL_AOS && NSIMDVL == 1) {
     do_test_model_reduced_halo_swap(pe, cs);
@@ -359,21 +361,21 @@ int do_test_model_distributions(pe_t * pe, cs_t * cs) {
       fvalue_expected = 0.01*n + wv[p];
       lb_f_set(lb, index, p, n, fvalue_expected);
       lb_f(lb, index, p, n, &fvalue);
-      assert(fabs(fvalue - fvalue_expected) < DBL_EPSILON);
+      assert(fabs(fvalue - fvalue_expected) < LB_DATA_EPSILON);
     }
 
     /* info("Check zeroth moment... ");*/
 
     fvalue_expected = 0.01*n*NVEL + 1.0;
     lb_0th_moment(lb, index, (lb_dist_enum_t) n, &fvalue);
-    assert(fabs(fvalue - fvalue_expected) <= DBL_EPSILON);
+    assert(fabs(fvalue - fvalue_expected) <= NVEL*LB_DATA_EPSILON);
 
     /* info("Check first moment... ");*/
 
     lb_1st_moment(lb, index, (n == 0) ? LB_RHO : LB_PHI, u);
 
     for (i = 0; i < NDIM; i++) {
-      assert(fabs(u[i] - 0.0) < DBL_EPSILON);
+      assert(fabs(u[i] - 0.0) < NVEL*LB_DATA_EPSILON);
     }
   }
 
@@ -382,6 +384,62 @@ int do_test_model_distributions(pe_t * pe, cs_t * cs) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  do_test_model_storage
+ *
+ *  Distributions are stored as lb_data_t (float with -DLB_DATA_FLOAT),
+ *  shifted by the rest weights; the rest state should be exact.
+ *
+ *****************************************************************************/
+
+int do_test_model_storage(pe_t * pe, cs_t * cs) {
+
+  int p;
+  int index = 1;
+  double eps;
+  double rho;
+  double fvalue, fvalue_expected;
+
+  lb_t * lb = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  lb_create(pe, cs, &lb);
+  lb_init(lb);
+
+  assert(sizeof(lb->f[0]) == sizeof(lb_data_t));
+  eps = LB_DATA_EPSILON;
+
+  /* Rest state */
+
+  lb_0th_moment_equilib_set(lb, index, LB_RHO, 1.0);
+  lb_0th_moment(lb, index, LB_RHO, &rho);
+  assert(fabs(rho - 1.0) <= NVEL*DBL_EPSILON);
+
+  for (p = 0; p < NVEL; p++) {
+    lb_f(lb, index, p, LB_RHO, &fvalue);
+    assert(fabs(fvalue - wv[p])
+	   <= eps*fabs(wv[p] - LB_FSHIFT(lb->param, LB_RHO, p)) + DBL_EPSILON);
+  }
+
+  /* Small departure from rest is retained to storage precision */
+
+  for (p = 0; p < NVEL; p++) {
+    fvalue_expected = wv[p]*(1.0 + 0.01*cv[p][X]);
+    lb_f_set(lb, index, p, LB_RHO, fvalue_expected);
+    lb_f(lb, index, p, LB_RHO, &fvalue);
+    assert(fabs(fvalue - fvalue_expected)
+	   <= eps*fabs(fvalue_expected - LB_FSHIFT(lb->param, LB_RHO, p))
+	   + DBL_EPSILON);
+  }
+
+  lb_free(lb);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  do_test_model_halo_swap
@@ -456,20 +514,24 @@ int do_test_model_halo_swap(pe_t * pe, cs_t * cs) {
 
 	  f_expect = 1.0*abs(i - nlocal[X]);
 	  lb_f(lb, index, X, n, &f_actual);
-	  test_assert(fabs(f_actual - f_expect) < DBL_EPSILON);
+	  test_assert(fabs(f_actual - f_expect)
+		      < LB_DATA_EPSILON*(1.0 + f_expect));
 
 	  f_expect = 1.0*abs(j - nlocal[Y]);
 	  lb_f(lb, index, Y, n, &f_actual);
-	  test_assert(fabs(f_actual - f_expect) < DBL_EPSILON);
+	  test_assert(fabs(f_actual - f_expect)
+		      < LB_DATA_EPSILON*(1.0 + f_expect));
 
 	  f_expect = 1.0*abs(k - nlocal[Z]);
 	  lb_f(lb, index, Z, n, &f_actual);
-	  test_assert(fabs(f_actual - f_expect) < DBL_EPSILON);
+	  test_assert(fabs(f_actual - f_expect)
+		      < LB_DATA_EPSILON*(1.0 + f_expect));
 
 	  for (p = 3; p < NVEL; p++) {
 	    lb_f(lb, index, p, n, &f_actual);
 	    f_expect = (double) p;
-	    test_assert(fabs(f_actual - f_expect) < DBL_EPSILON);
+	    test_assert(fabs(f_actual - f_expect)
+			< LB_DATA_EPSILON*(1.0 + f_expect));
 	  }
 	}
       }
@@ -539,7 +601,8 @@ int do_test_model_reduced_halo_swap(pe_t * pe, cs_t * cs) {
 	  for (p = 0; p < NVEL; p++) {
 	    lb_f(lb, index, p, n, &f_actual);
 	    f_expect = 1.0*(n*NVEL +  p);
-	    test_assert(fabs(f_expect - f_actual) < DBL_EPSILON);
+	    test_assert(fabs(f_expect - f_actual)
+			< LB_DATA_EPSILON*(1.0 + f_expect));
 	  }
 	}
       }
@@ -570,7 +633,8 @@ int do_test_model_reduced_halo_swap(pe_t * pe, cs_t * cs) {
 	    kcdt = k + cv[p][Z];
 
 	    if (test_model_is_domain(cs, icdt, jcdt, kcdt)) {
-	      test_assert(fabs(f_actual - f_expect) < DBL_EPSILON);
+	      test_assert(fabs(f_actual - f_expect)
+			  < LB_DATA_EPSILON*(1.0 + f_expect));
 	    }
 	  }
 	}
@@ -0,0 +1,169 @@
+/*****************************************************************************
+ *
+ *  test_perf.c
+ *
+ *  Performance regions.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pe.h"
+#include "perf.h"
+#include "tests.h"
+
+static int do_test_perf_nest(pe_t * pe);
+static int do_test_perf_dump(pe_t * pe, perf_format_enum_t format);
+
+/*****************************************************************************
+ *
+ *  test_perf_suite
+ *
+ *****************************************************************************/
+
+int test_perf_suite(void) {
+
+  pe_t * pe = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+
+  do_test_perf_nest(pe);
+  do_test_perf_dump(pe, PERF_FORMAT_CSV);
+  do_test_perf_dump(pe, PERF_FORMAT_JSON);
+
+  pe_info(pe, "PASS     ./unit/test_perf\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_perf_nest
+ *
+ *****************************************************************************/
+
+static int do_test_perf_nest(pe_t * pe) {
+
+  int n;
+  int ncall;
+  double t;
+  double work[3];
+
+  assert(pe);
+
+  /* Before initialisation, regions are ignored */
+
+  perf_region_start("ignored");
+  perf_region_stop("ignored");
+  assert(perf_region_info("ignored", &ncall, &t, work) == -1);
+
+  perf_init(pe);
+
+  for (n = 0; n < 2; n++) {
+    perf_region_start("step");
+    perf_region_start("collision");
+    perf_region_work(10.0, 100.0, 1000.0);
+    perf_region_stop("collision");
+    perf_region_start("halo");
+    perf_region_stop("halo");
+    perf_region_stop("step");
+  }
+
+  /* Same name at a different level is a different region */
+
+  perf_region_start("collision");
+  perf_region_stop("collision");
+
+  assert(perf_region_info("step", &ncall, &t, work) == 0);
+  assert(ncall == 2);
+  assert(t >= 0.0);
+  assert(work[0] == 0.0);
+
+  assert(perf_region_info("step/collision", &ncall, &t, work) == 0);
+  assert(ncall == 2);
+  assert(work[0] == 20.0);
+  assert(work[1] == 200.0);
+  assert(work[2] == 2000.0);
+
+  assert(perf_region_info("step/halo", &ncall, &t, work) == 0);
+  assert(ncall == 2);
+
+  assert(perf_region_info("collision", &ncall, &t, work) == 0);
+  assert(ncall == 1);
+  assert(work[1] == 0.0);
+
+  assert(perf_region_info("halo", &ncall, &t, work) == -1);
+
+  perf_finalise();
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_perf_dump
+ *
+ *  Two dumps should give a header and two lines per region (csv),
+ *  or two lines (json).
+ *
+ *****************************************************************************/
+
+static int do_test_perf_dump(pe_t * pe, perf_format_enum_t format) {
+
+  int nline = 0;
+  char line[BUFSIZ];
+  const char * filename = "test-perf-dump.out";
+  FILE * fp = NULL;
+
+  assert(pe);
+
+  perf_init(pe);
+
+  perf_region_start("step");
+  perf_region_start("gradient");
+  perf_region_work(1.0, 8.0, 13.0);
+  perf_region_stop("gradient");
+  perf_region_stop("step");
+
+  if (pe_mpi_rank(pe) == 0) remove(filename);
+  perf_dump(filename, 1, format);
+  perf_dump(filename, 2, format);
+
+  if (pe_mpi_rank(pe) == 0) {
+    fp = fopen(filename, "r");
+    assert(fp);
+    while (fgets(line, BUFSIZ, fp)) {
+      if (format == PERF_FORMAT_CSV && nline == 0) {
+	assert(strncmp(line, "step,region", 11) == 0);
+      }
+      if (format == PERF_FORMAT_CSV && nline == 2) {
+	assert(strncmp(line, "1,step/gradient,1,1,", 20) == 0);
+      }
+      if (format == PERF_FORMAT_JSON) {
+	assert(strncmp(line, "{\"step\": ", 9) == 0);
+	assert(strstr(line, "\"region\": \"step/gradient\""));
+      }
+      nline += 1;
+    }
+    fclose(fp);
+    remove(filename);
+
+    if (format == PERF_FORMAT_CSV)  assert(nline == 5);
+    if (format == PERF_FORMAT_JSON) assert(nline == 2);
+  }
+
+  perf_finalise();
+
+  return 0;
+}
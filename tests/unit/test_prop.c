@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 Ths University of Edinburgh
+ *  (c) 2010-2019 Ths University of Edinburgh
  *
  *  Contributing authors: 
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -23,11 +23,21 @@
 #include "kernel.h"
 #include "memory.h"
 #include "lb_model_s.h"
+#include "map.h"
+#include "noise.h"
+#include "physics.h"
+#include "leesedwards.h"
+#include "hydro.h"
+#include "collision.h"
 #include "propagation.h"
 #include "tests.h"
 
 __host__ int do_test_velocity(pe_t * pe, cs_t * cs, lb_halo_enum_t halo);
 __host__ int do_test_source_destination(pe_t * pe, cs_t * cs, lb_halo_enum_t halo);
+__host__ int do_test_halo_reverse(pe_t * pe, cs_t * cs);
+__host__ int do_test_aa_natural(pe_t * pe, cs_t * cs);
+__host__ int do_test_aa_pull(pe_t * pe, cs_t * cs);
+__host__ int do_test_sparse(pe_t * pe, cs_t * cs);
 
 /*****************************************************************************
  *
@@ -58,6 +68,11 @@ int test_lb_prop_suite(void) {
   do_test_velocity(pe, cs, LB_HALO_TARGET);
   do_test_source_destination(pe, cs, LB_HALO_TARGET);
 
+  do_test_halo_reverse(pe, cs);
+  do_test_aa_natural(pe, cs);
+  do_test_aa_pull(pe, cs);
+  do_test_sparse(pe, cs);
+
   pe_info(pe, "PASS     ./unit/test_prop\n");
   cs_free(cs);
   pe_free(pe);
@@ -82,7 +97,7 @@ int do_test_velocity(pe_t * pe, cs_t * cs, lb_halo_enum_t halo) {
   int nd;
   int nvel;
   int ndist = 2;
-  double f_actual;
+  double f_actual, f_expect;
 
   lb_t * lb = NULL;
 
@@ -139,8 +154,9 @@ int do_test_velocity(pe_t * pe, cs_t * cs, lb_halo_enum_t halo) {
 
 	for (nd = 0; nd < ndist; nd++) {
 	  for (p = 0; p < nvel; p++) {
+	    f_expect = 1.0*(p + nd*NVEL);
 	    lb_f(lb, index, p, nd, &f_actual);
-	    assert(fabs(f_actual - 1.0*(p + nd*NVEL)) < DBL_EPSILON);
+	    assert(fabs(f_actual - f_expect) < LB_DATA_EPSILON*(1.0 + f_expect));
 	  }
 	}
       }
@@ -251,7 +267,7 @@ int do_test_source_destination(pe_t * pe, cs_t * cs, lb_halo_enum_t halo) {
 	    /* In case of d2q9, propagation is only for kc = 1 */
 	    if (NDIM == 2 && kc > 1) f_actual = f_expect;
 
-	    assert(fabs(f_actual - f_expect) < DBL_EPSILON);
+	    assert(fabs(f_actual - f_expect) < LB_DATA_EPSILON*(1.0 + f_expect));
 	  }
 	}
 
@@ -264,3 +280,385 @@ int do_test_source_destination(pe_t * pe, cs_t * cs, lb_halo_enum_t halo) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  do_test_halo_reverse
+ *
+ *  Push each distribution one lattice spacing from its source (as
+ *  for fused collision-propagation), including into the halo region,
+ *  and check the reverse halo swap delivers everything to the correct
+ *  destination. Host only.
+ *
+ *****************************************************************************/
+
+int do_test_halo_reverse(pe_t * pe, cs_t * cs) {
+
+  int ndevice;
+  int nlocal[3], offset[3];
+  int ntotal[3];
+  int ic, jc, kc, index, p;
+  int nvel;
+  int isource, jsource, ksource;
+  double f_actual, f_expect;
+  double ltot[3];
+
+  lb_t * lb = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  tdpGetDeviceCount(&ndevice);
+  if (ndevice > 0) return 0;
+
+  lb_create(pe, cs, &lb);
+  assert(lb);
+  lb_init(lb);
+  lb_nvel(lb, &nvel);
+
+  cs_ltot(cs, ltot);
+  cs_ntotal(cs, ntotal);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, offset);
+
+  /* Push test values from each local site */
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+
+	f_actual = ltot[Y]*ltot[Z]*(offset[X] + ic) +
+	  ltot[Z]*(offset[Y] + jc) + (offset[Z] + kc);
+
+	for (p = 0; p < nvel; p++) {
+	  index = cs_index(cs, ic + cv[p][X], jc + cv[p][Y], kc + cv[p][Z]);
+	  lb_f_set(lb, index, p, LB_RHO, f_actual);
+	}
+      }
+    }
+  }
+
+  lb_halo_reverse(lb);
+
+  /* Test */
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+
+	index = cs_index(cs, ic, jc, kc);
+
+	for (p = 0; p < nvel; p++) {
+	  isource = offset[X] + ic - cv[p][X];
+	  if (isource == 0) isource += ntotal[X];
+	  if (isource == ntotal[X] + 1) isource = 1;
+	  jsource = offset[Y] + jc - cv[p][Y];
+	  if (jsource == 0) jsource += ntotal[Y];
+	  if (jsource == ntotal[Y] + 1) jsource = 1;
+	  ksource = offset[Z] + kc - cv[p][Z];
+	  if (ksource == 0) ksource += ntotal[Z];
+	  if (ksource == ntotal[Z] + 1) ksource = 1;
+
+	  f_expect = ltot[Y]*ltot[Z]*isource + ltot[Z]*jsource + ksource;
+	  lb_f(lb, index, p, LB_RHO, &f_actual);
+
+	  assert(fabs(f_actual - f_expect) < LB_DATA_EPSILON*(1.0 + f_expect));
+	}
+      }
+    }
+  }
+
+  lb_free(lb);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_aa_natural
+ *
+ *  Set distinct values via the natural view in the AA swapped layout,
+ *  check where they are stored, and check they survive the return
+ *  to the natural layout. Host only.
+ *
+ *****************************************************************************/
+
+int do_test_aa_natural(pe_t * pe, cs_t * cs) {
+
+  int ndevice;
+  int nlocal[3];
+  int ic, jc, kc, index, p;
+  int nvel;
+  int parity;
+  double f_actual, f_expect;
+
+  lb_t * lb = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  tdpGetDeviceCount(&ndevice);
+  if (ndevice > 0) return 0;
+
+  lb_create(pe, cs, &lb);
+  assert(lb);
+  lb_aa_set(lb, 1);
+  lb_init(lb);
+  lb_nvel(lb, &nvel);
+
+  assert(lb->fprime == NULL);
+
+  cs_nlocal(cs, nlocal);
+
+  lb->param->parity = 1;
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+
+	index = cs_index(cs, ic, jc, kc);
+
+	for (p = 0; p < nvel; p++) {
+	  f_expect = 1.0*(nvel*index + p);
+	  lb_f_set(lb, index, p, LB_RHO, f_expect);
+
+	  /* Stored at x - c_p in the opposite slot */
+	  f_actual = lb->f[LB_ADDR(lb->nsite, 1, NVEL,
+				   index - lb->param->ndisp[p], LB_RHO,
+				   (NVEL - p) % NVEL)]
+	    + LB_FSHIFT(lb->param, LB_RHO, p);
+	  assert(fabs(f_actual - f_expect) < LB_DATA_EPSILON*(1.0 + f_expect));
+	}
+      }
+    }
+  }
+
+  lb_aa_natural(lb);
+  lb_aa_parity(lb, &parity);
+  assert(parity == 0);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+
+	index = cs_index(cs, ic, jc, kc);
+
+	for (p = 0; p < nvel; p++) {
+	  f_expect = 1.0*(nvel*index + p);
+	  lb_f(lb, index, p, LB_RHO, &f_actual);
+	  assert(fabs(f_actual - f_expect) < LB_DATA_EPSILON*(1.0 + f_expect));
+	  f_actual = lb->f[LB_ADDR(lb->nsite, 1, NVEL, index, LB_RHO, p)]
+	    + LB_FSHIFT(lb->param, LB_RHO, p);
+	  assert(fabs(f_actual - f_expect) < LB_DATA_EPSILON*(1.0 + f_expect));
+	}
+      }
+    }
+  }
+
+  lb_free(lb);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_aa_pull
+ *
+ *  Several time steps of collision and AA propagation must agree with
+ *  collision and standard (pull) propagation from the same initial
+ *  state. The AA run is returned to the natural layout after the first
+ *  and third steps, as at a colloid update. Host only.
+ *
+ *****************************************************************************/
+
+int do_test_aa_pull(pe_t * pe, cs_t * cs) {
+
+  int ndevice;
+  int nlocal[3];
+  int noffset[3];
+  int ic, jc, kc, index, p;
+  int nvel;
+  int step;
+  int parity;
+  double f0, f_actual, f_expect;
+
+  const int nstep = 4;
+
+  lb_t * lb = NULL;
+  lb_t * lbaa = NULL;
+  map_t * map = NULL;
+  hydro_t * hydro = NULL;
+  noise_t * noise = NULL;
+  physics_t * phys = NULL;
+  lees_edw_t * le = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  tdpGetDeviceCount(&ndevice);
+  if (ndevice > 0) return 0;
+
+  physics_create(pe, &phys);
+  lees_edw_create(pe, cs, NULL, &le);
+  hydro_create(pe, cs, le, 1, &hydro);
+  map_create(pe, cs, 0, &map);
+  noise_create(pe, cs, &noise);
+
+  lb_create(pe, cs, &lb);
+  lb_init(lb);
+  lb_create(pe, cs, &lbaa);
+  lb_aa_set(lbaa, 1);
+  lb_init(lbaa);
+  lb_nvel(lb, &nvel);
+
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  /* Initial state: a perturbation of the rest distribution which
+   * varies with position and direction, so there is flow. */
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	for (p = 0; p < nvel; p++) {
+	  f0 = lb->param->wv[p]*(1.0 + 0.01*sin(0.1*(noffset[X] + ic)*(p + 1))
+				 + 0.01*cos(0.2*(noffset[Y] + jc))
+				 + 0.01*sin(0.3*(noffset[Z] + kc)));
+	  lb_f_set(lb, index, p, LB_RHO, f0);
+	  lb_f_set(lbaa, index, p, LB_RHO, f0);
+	}
+      }
+    }
+  }
+
+  for (step = 1; step <= nstep; step++) {
+
+    lb_collide(lb, hydro, map, noise, NULL);
+    lb_halo(lb);
+    lb_propagation(lb);
+
+    lb_aa_parity(lbaa, &parity);
+    lb_collide(lbaa, hydro, map, noise, NULL);
+    if (parity) lb_halo_reverse(lbaa);
+    lb_halo(lbaa);
+
+    if (step == 1 || step == 3) {
+      lb_aa_natural(lbaa);
+      lb_aa_parity(lbaa, &parity);
+      assert(parity == 0);
+      lb_halo(lbaa);
+    }
+
+    for (ic = 1; ic <= nlocal[X]; ic++) {
+      for (jc = 1; jc <= nlocal[Y]; jc++) {
+	for (kc = 1; kc <= nlocal[Z]; kc++) {
+	  index = cs_index(cs, ic, jc, kc);
+	  for (p = 0; p < nvel; p++) {
+	    lb_f(lb, index, p, LB_RHO, &f_expect);
+	    lb_f(lbaa, index, p, LB_RHO, &f_actual);
+	    assert(fabs(f_actual - f_expect) < LB_DATA_EPSILON*(1.0 + f_expect));
+	  }
+	}
+      }
+    }
+  }
+
+  lb_free(lbaa);
+  lb_free(lb);
+  noise_free(noise);
+  map_free(map);
+  hydro_free(hydro);
+  lees_edw_free(le);
+  physics_free(phys);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_sparse
+ *
+ *  A slab of solid in the local domain. The sparse propagation must
+ *  agree with the dense propagation at all sites which are fluid or
+ *  have a fluid neighbour. Host only.
+ *
+ *****************************************************************************/
+
+int do_test_sparse(pe_t * pe, cs_t * cs) {
+
+  int ndevice;
+  int nlocal[3];
+  int ic, jc, kc, index, p;
+  int nvel;
+  int nsparse;
+  double f_actual, f_expect;
+
+  lb_t * lb = NULL;
+  map_t * map = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  tdpGetDeviceCount(&ndevice);
+  if (ndevice > 0) return 0;
+
+  cs_nlocal(cs, nlocal);
+  if (nlocal[X] < 8) return 0;
+
+  lb_create(pe, cs, &lb);
+  assert(lb);
+  lb_init(lb);
+  lb_nvel(lb, &nvel);
+
+  map_create(pe, cs, 0, &map);
+  assert(map);
+
+  /* Solid for 2 <= ic <= nlocal[X]/2 */
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	if (ic >= 2 && ic <= nlocal[X]/2) map_status_set(map, index, MAP_BOUNDARY);
+	for (p = 0; p < nvel; p++) {
+	  lb_f_set(lb, index, p, LB_RHO, 1.0*(nvel*index + p));
+	}
+      }
+    }
+  }
+
+  lb_sparse(lb, &nsparse);
+  assert(nsparse == 0);
+
+  lb_sparse_set(lb, map);
+  lb_sparse(lb, &nsparse);
+  assert(nsparse > 0);
+  assert(nsparse < nlocal[X]*nlocal[Y]*nlocal[Z]/NSIMDVL);
+
+  lb_halo_swap(lb, LB_HALO_HOST);
+  lb_propagation(lb);
+
+  /* Sources in the halo hold periodic images, so interior only */
+
+  for (ic = 2; ic < nlocal[X]; ic++) {
+    if (ic > 2 && ic < nlocal[X]/2) continue;
+    for (jc = 2; jc < nlocal[Y]; jc++) {
+      for (kc = 2; kc < nlocal[Z]; kc++) {
+
+	index = cs_index(cs, ic, jc, kc);
+
+	for (p = 0; p < nvel; p++) {
+	  f_expect = 1.0*(nvel*(index - lb->param->ndisp[p]) + p);
+	  lb_f(lb, index, p, LB_RHO, &f_actual);
+	  assert(fabs(f_actual - f_expect) < LB_DATA_EPSILON*(1.0 + f_expect));
+	}
+      }
+    }
+  }
+
+  map_free(map);
+  lb_free(lb);
+
+  return 0;
+}
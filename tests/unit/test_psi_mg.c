@@ -0,0 +1,378 @@
+/*****************************************************************************
+ *
+ *  test_psi_mg.c
+ *
+ *  Multigrid Poisson solver.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "physics.h"
+#include "util.h"
+#include "psi_s.h"
+#include "psi_sor.h"
+#include "psi_mg.h"
+#include "tests.h"
+
+static int do_test_mg_uniform(pe_t * pe);
+static int do_test_mg_vare(pe_t * pe);
+static int do_test_mg_ncycle(pe_t * pe);
+static int test_psi_create(pe_t * pe, int n, cs_t ** cs, psi_t ** psi);
+static int test_charge_set(psi_t * psi);
+static int test_vare_residual(psi_t * psi, double * rnorm);
+static int fepsilon_sinz(void * fe, int index, double * epsilon);
+
+/*****************************************************************************
+ *
+ *  test_psi_mg_suite
+ *
+ *****************************************************************************/
+
+int test_psi_mg_suite(void) {
+
+  pe_t * pe = NULL;
+  physics_t * phys = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  physics_create(pe, &phys);
+  physics_control_next_step(phys); /* Avoid solver messages at t = 0 */
+
+  do_test_mg_uniform(pe);
+  do_test_mg_vare(pe);
+  do_test_mg_ncycle(pe);
+
+  pe_info(pe, "PASS     ./unit/test_psi_mg\n");
+  physics_free(phys);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_mg_uniform
+ *
+ *  Uniform permittivity: the multigrid solution should agree with
+ *  SOR to within a constant.
+ *
+ *****************************************************************************/
+
+static int do_test_mg_uniform(pe_t * pe) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  int nlevel, ncycle;
+  double psi0, psi1;
+  double shift, diff;
+  double * psor = NULL;
+  cs_t * cs = NULL;
+  psi_t * psi = NULL;
+  psi_mg_t * mg = NULL;
+  MPI_Comm comm;
+
+  assert(pe);
+
+  test_psi_create(pe, 16, &cs, &psi);
+  cs_nlocal(cs, nlocal);
+  cs_cart_comm(cs, &comm);
+
+  psor = (double *) calloc(psi->nsites, sizeof(double));
+  assert(psor);
+
+  test_charge_set(psi);
+  psi_sor_poisson(psi);
+  for (index = 0; index < psi->nsites; index++) psor[index] = psi->psi[index];
+
+  test_charge_set(psi);
+  psi_mg_create(pe, cs, &mg);
+  psi_mg_nlevel(mg, &nlevel);
+  test_assert(nlevel > 1);
+
+  psi_mg_poisson(mg, psi, NULL, NULL);
+  psi_mg_ncycle(mg, &ncycle);
+  test_assert(ncycle > 0);
+  test_assert(ncycle < 30);
+
+  /* Shift of first site in the global system */
+
+  index = cs_index(cs, 1, 1, 1);
+  shift = psi->psi[index] - psor[index];
+  MPI_Bcast(&shift, 1, MPI_DOUBLE, 0, comm);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	psi0 = psor[index];
+	psi1 = psi->psi[index];
+	diff = fabs(psi1 - psi0 - shift);
+	test_assert(diff < FLT_EPSILON*fmax(1.0, fabs(psi0)));
+      }
+    }
+  }
+
+  psi_mg_free(mg);
+  free(psor);
+  psi_free(psi);
+  cs_free(cs);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_mg_vare
+ *
+ *  Variable permittivity: check the residual of the discrete system
+ *  (computed independently) meets the tolerance.
+ *
+ *****************************************************************************/
+
+static int do_test_mg_vare(pe_t * pe) {
+
+  int ncycle;
+  double rnorm, rnorm0;
+  cs_t * cs = NULL;
+  psi_t * psi = NULL;
+  MPI_Comm comm;
+
+  assert(pe);
+
+  test_psi_create(pe, 16, &cs, &psi);
+  cs_cart_comm(cs, &comm);
+
+  psi_solver_set(psi, PSI_POISSON_MULTIGRID);
+  psi->epsilon = 1.0;
+
+  test_charge_set(psi);
+  test_vare_residual(psi, &rnorm0);
+
+  /* The fe argument carries the coordinate system */
+
+  psi_mg_solve(psi, (fe_t *) cs, fepsilon_sinz);
+  test_assert(psi->mg != NULL);
+
+  psi_mg_ncycle(psi->mg, &ncycle);
+  test_assert(ncycle > 0);
+  test_assert(ncycle < 30);
+
+  psi_halo_psi(psi);
+  psi_halo_psijump(psi);
+  test_vare_residual(psi, &rnorm);
+  test_assert(rnorm < psi->reltol*rnorm0 || rnorm < psi->abstol);
+
+  psi_free(psi);
+  cs_free(cs);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_mg_ncycle
+ *
+ *  The number of V-cycles should not depend (much) on system size.
+ *
+ *****************************************************************************/
+
+static int do_test_mg_ncycle(pe_t * pe) {
+
+  int ncycle16, ncycle32;
+  cs_t * cs = NULL;
+  psi_t * psi = NULL;
+
+  assert(pe);
+
+  test_psi_create(pe, 16, &cs, &psi);
+  test_charge_set(psi);
+  psi_mg_solve(psi, NULL, NULL);
+  psi_mg_ncycle(psi->mg, &ncycle16);
+  psi_free(psi);
+  cs_free(cs);
+
+  test_psi_create(pe, 32, &cs, &psi);
+  test_charge_set(psi);
+  psi_mg_solve(psi, NULL, NULL);
+  psi_mg_ncycle(psi->mg, &ncycle32);
+  psi_free(psi);
+  cs_free(cs);
+
+  test_assert(ncycle32 <= ncycle16 + 2);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_psi_create
+ *
+ *  Periodic system n^3 with two species.
+ *
+ *****************************************************************************/
+
+static int test_psi_create(pe_t * pe, int n, cs_t ** cs, psi_t ** psi) {
+
+  int ntotal[3] = {n, n, n};
+
+  assert(pe);
+  assert(cs);
+  assert(psi);
+
+  cs_create(pe, cs);
+  cs_nhalo_set(*cs, 1);
+  cs_ntotal_set(*cs, ntotal);
+  cs_init(*cs);
+
+  psi_create(pe, *cs, 2, psi);
+  psi_valency_set(*psi, 0, +1);
+  psi_valency_set(*psi, 1, -1);
+  psi_epsilon_set(*psi, 1.0);
+  psi_beta_set(*psi, 1.0);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_charge_set
+ *
+ *  A smooth, three-dimensional, charge-neutral distribution:
+ *  rho_0 = rho_b [1 + 0.5 sin(2pi x/L) sin(2pi y/L) cos(2pi z/L)]
+ *  with rho_1 = rho_b uniform. The potential is set to zero.
+ *
+ *****************************************************************************/
+
+static int test_charge_set(psi_t * psi) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  int noffset[3];
+  double ltot[3];
+  double x, y, z;
+  double rho_b = 0.01;
+  PI_DOUBLE(pi);
+
+  assert(psi);
+
+  cs_ltot(psi->cs, ltot);
+  cs_nlocal(psi->cs, nlocal);
+  cs_nlocal_offset(psi->cs, noffset);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    x = 2.0*pi*(noffset[X] + ic - 0.5)/ltot[X];
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      y = 2.0*pi*(noffset[Y] + jc - 0.5)/ltot[Y];
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	z = 2.0*pi*(noffset[Z] + kc - 0.5)/ltot[Z];
+
+	index = cs_index(psi->cs, ic, jc, kc);
+	psi_psi_set(psi, index, 0.0);
+	psi_rho_set(psi, index, 0, rho_b*(1.0 + 0.5*sin(x)*sin(y)*cos(z)));
+	psi_rho_set(psi, index, 1, rho_b);
+      }
+    }
+  }
+
+  psi_halo_psi(psi);
+  psi_halo_rho(psi);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_vare_residual
+ *
+ *  Global sum of |div [epsilon grad psi] + e beta rho_elec| using the
+ *  stencil of psi_sor_vare_poisson(). The halo of psi must be current.
+ *
+ *****************************************************************************/
+
+static int test_vare_residual(psi_t * psi, double * rnorm) {
+
+  int ic, jc, kc, index, ia;
+  int nlocal[3];
+  int str[3];
+  double eps0, epsp, epsm;
+  double rho_elec;
+  double lap, rsum = 0.0;
+  MPI_Comm comm;
+
+  assert(psi);
+  assert(rnorm);
+
+  cs_nlocal(psi->cs, nlocal);
+  cs_strides(psi->cs, str + X, str + Y, str + Z);
+  cs_cart_comm(psi->cs, &comm);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+
+	index = cs_index(psi->cs, ic, jc, kc);
+	fepsilon_sinz(psi->cs, index, &eps0);
+
+	lap = 0.0;
+	for (ia = 0; ia < 3; ia++) {
+	  fepsilon_sinz(psi->cs, index + str[ia], &epsp);
+	  fepsilon_sinz(psi->cs, index - str[ia], &epsm);
+	  lap += eps0*(psi->psi[index + str[ia]] + psi->psi[index - str[ia]]
+		       - 2.0*psi->psi[index])
+	    + 0.25*(epsp - epsm)*(psi->psi[index + str[ia]]
+				  - psi->psi[index - str[ia]]);
+	}
+
+	psi_rho_elec(psi, index, &rho_elec);
+	rsum += fabs(lap + psi->e*psi->beta*rho_elec);
+      }
+    }
+  }
+
+  MPI_Allreduce(&rsum, rnorm, 1, MPI_DOUBLE, MPI_SUM, comm);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  fepsilon_sinz
+ *
+ *  Permittivity e = 1 + 0.5 sin(2pi z/L_z) as a function of global
+ *  position. The first argument is the coordinate system.
+ *
+ *****************************************************************************/
+
+static int fepsilon_sinz(void * fe, int index, double * epsilon) {
+
+  int coords[3];
+  int noffset[3];
+  double ltot[3];
+  cs_t * cs = (cs_t *) fe;
+  PI_DOUBLE(pi);
+
+  assert(cs);
+  assert(epsilon);
+
+  cs_index_to_ijk(cs, index, coords);
+  cs_nlocal_offset(cs, noffset);
+  cs_ltot(cs, ltot);
+
+  *epsilon = 1.0 + 0.5*sin(2.0*pi*(noffset[Z] + coords[Z] - 0.5)/ltot[Z]);
+
+  return 0;
+}
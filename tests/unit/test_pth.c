@@ -0,0 +1,198 @@
+/*****************************************************************************
+ *
+ *  test_pth.c
+ *
+ *  Force on the fluid from the divergence of the chemical stress.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "field.h"
+#include "field_grad.h"
+#include "gradient_3d_7pt_fluid.h"
+#include "leesedwards.h"
+#include "symmetric.h"
+#include "hydro_s.h"
+#include "pth_s.h"
+#include "phi_force_colloid.h"
+#include "tests.h"
+
+static int test_pth_fused(pe_t * pe, cs_t * cs, fe_t * fe);
+static int test_pth_phi_set(cs_t * cs, field_t * phi);
+
+/*****************************************************************************
+ *
+ *  test_pth_suite
+ *
+ *****************************************************************************/
+
+int test_pth_suite(void) {
+
+  int nhalo = 2;
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  field_t * phi = NULL;
+  field_grad_t * dphi = NULL;
+  fe_symm_t * fe = NULL;
+  fe_symm_param_t param = {-0.0625, +0.0625, 0.04};
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_init(cs);
+  lees_edw_create(pe, cs, NULL, &le);
+
+  field_create(pe, cs, 1, "phi", &phi);
+  field_init(phi, nhalo, le);
+  field_grad_create(pe, phi, 2, &dphi);
+  field_grad_set(dphi, grad_3d_7pt_fluid_d2, NULL);
+
+  fe_symm_create(pe, cs, phi, dphi, &fe);
+  fe_symm_param_set(fe, param);
+
+  test_pth_phi_set(cs, phi);
+  field_grad_compute(dphi);
+
+  test_pth_fused(pe, cs, (fe_t *) fe);
+
+  fe_symm_free(fe);
+  field_grad_free(dphi);
+  field_free(phi);
+  lees_edw_free(le);
+  cs_free(cs);
+
+  pe_info(pe, "PASS     ./unit/test_pth\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_pth_fused
+ *
+ *  The fused computation must agree exactly with the divergence
+ *  of the stored stress.
+ *
+ *****************************************************************************/
+
+static int test_pth_fused(pe_t * pe, cs_t * cs, fe_t * fe) {
+
+  int ic, jc, kc, index, ia;
+  int nlocal[3];
+  double fzero[3] = {0.0, 0.0, 0.0};
+  double fabsmax = 0.0;
+
+  pth_t * pth = NULL;
+  pth_t * pthf = NULL;
+  hydro_t * hydro = NULL;
+  hydro_t * hydrof = NULL;
+
+  assert(pe);
+  assert(cs);
+  assert(fe);
+
+  cs_nlocal(cs, nlocal);
+
+  pth_create(pe, cs, PTH_METHOD_DIVERGENCE, &pth);
+  pth_create(pe, cs, PTH_METHOD_DIVERGENCE, &pthf);
+  pth_fused_set(pthf, 1);
+
+  test_assert(pth->str == NULL);
+  test_assert(pthf->fused == 1);
+
+  hydro_create(pe, cs, NULL, 1, &hydro);
+  hydro_create(pe, cs, NULL, 1, &hydrof);
+  hydro_f_zero(hydro, fzero);
+  hydro_f_zero(hydrof, fzero);
+
+  pth_stress_compute(pth, fe);
+  pth_force_fluid_driver(pth, hydro);
+  pth_force_fluid_fused_driver(pthf, fe, hydrof);
+
+  test_assert(pth->str != NULL);
+  test_assert(pthf->str == NULL);
+
+  hydro_memcpy(hydro, tdpMemcpyDeviceToHost);
+  hydro_memcpy(hydrof, tdpMemcpyDeviceToHost);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	for (ia = 0; ia < 3; ia++) {
+	  double f  = hydro->f[addr_rank1(hydro->nsite, NHDIM, index, ia)];
+	  double ff = hydrof->f[addr_rank1(hydrof->nsite, NHDIM, index, ia)];
+	  test_assert(f == ff);
+	  fabsmax = fmax(fabsmax, fabs(f));
+	}
+      }
+    }
+  }
+
+  /* Make sure there was something to compare */
+  test_assert(fabsmax > 0.0);
+
+  hydro_free(hydrof);
+  hydro_free(hydro);
+  pth_free(pthf);
+  pth_free(pth);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_pth_phi_set
+ *
+ *  A smooth, periodic, but not trivially symmetric, composition.
+ *
+ *****************************************************************************/
+
+static int test_pth_phi_set(cs_t * cs, field_t * phi) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  int noffset[3];
+  double ltot[3];
+  double x, y, z;
+  double pi;
+
+  assert(cs);
+  assert(phi);
+
+  pi = 4.0*atan(1.0);
+  cs_ltot(cs, ltot);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	x = 2.0*pi*(noffset[X] + ic)/ltot[X];
+	y = 2.0*pi*(noffset[Y] + jc)/ltot[Y];
+	z = 2.0*pi*(noffset[Z] + kc)/ltot[Z];
+	field_scalar_set(phi, index, sin(x)*cos(2.0*y) + 0.5*sin(x + 3.0*z));
+      }
+    }
+  }
+
+  field_memcpy(phi, tdpMemcpyHostToDevice);
+  field_halo(phi);
+
+  return 0;
+}
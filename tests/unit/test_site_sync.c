@@ -0,0 +1,169 @@
+/*****************************************************************************
+ *
+ *  test_site_sync.c
+ *
+ *  Lists of sites for host/target copies.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "memory.h"
+#include "site_sync.h"
+#include "tests.h"
+
+static int test_site_sync_list(pe_t * pe, int nsites);
+static int test_site_sync_memcpy(pe_t * pe, int nsites);
+
+/*****************************************************************************
+ *
+ *  test_site_sync_suite
+ *
+ *****************************************************************************/
+
+int test_site_sync_suite(void) {
+
+  int nsites;
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_init(cs);
+  cs_nsites(cs, &nsites);
+
+  test_site_sync_list(pe, nsites);
+  test_site_sync_memcpy(pe, nsites);
+
+  cs_free(cs);
+  pe_info(pe, "PASS     ./unit/test_site_sync\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_site_sync_list
+ *
+ *  Sites appear once, in order of first addition, until reset.
+ *
+ *****************************************************************************/
+
+static int test_site_sync_list(pe_t * pe, int nsites) {
+
+  int n;
+  site_sync_t * sync = NULL;
+
+  assert(pe);
+
+  site_sync_create(pe, nsites, &sync);
+  test_assert(sync->nlist == 0);
+
+  site_sync_add(sync, nsites - 1);
+  site_sync_add(sync, 0);
+  site_sync_add(sync, nsites - 1);
+  test_assert(sync->nlist == 2);
+  test_assert(sync->list[0] == nsites - 1);
+  test_assert(sync->list[1] == 0);
+
+  site_sync_reset(sync);
+  test_assert(sync->nlist == 0);
+  test_assert(sync->inlist[0] == 0);
+  test_assert(sync->inlist[nsites - 1] == 0);
+
+  /* Beyond the initial capacity */
+
+  for (n = 0; n < nsites; n += 2) {
+    site_sync_add(sync, n);
+    site_sync_add(sync, n);
+  }
+  test_assert(sync->nlist == (nsites + 1)/2);
+  test_assert(sync->list[sync->nlist - 1] == 2*(sync->nlist - 1));
+
+  site_sync_free(sync);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_site_sync_memcpy
+ *
+ *  Round trip of the listed sites for a rank one object. In the
+ *  absence of a device, the host data are not changed.
+ *
+ *****************************************************************************/
+
+static int test_site_sync_memcpy(pe_t * pe, int nsites) {
+
+  int n, ia;
+  int ndevice;
+  const int na = 3;
+  double * hdata = NULL;
+  double * tdata = NULL;
+  site_sync_t * sync = NULL;
+
+  assert(pe);
+
+  tdpGetDeviceCount(&ndevice);
+
+  hdata = (double *) malloc(nsites*na*sizeof(double));
+  assert(hdata);
+
+  for (n = 0; n < nsites; n++) {
+    for (ia = 0; ia < na; ia++) {
+      hdata[addr_rank1(nsites, na, n, ia)] = 1.0*(n*na + ia);
+    }
+  }
+
+  tdata = hdata;
+  if (ndevice > 0) {
+    tdpAssert(tdpMalloc((void **) &tdata, nsites*na*sizeof(double)));
+  }
+
+  site_sync_create(pe, nsites, &sync);
+  site_sync_add(sync, 1);
+  site_sync_add(sync, nsites/2);
+
+  site_sync_memcpy(sync, hdata, tdata, nsites, na, sizeof(double),
+		   tdpMemcpyHostToDevice);
+
+  for (ia = 0; ia < na; ia++) {
+    hdata[addr_rank1(nsites, na, 1, ia)] = -1.0;
+    hdata[addr_rank1(nsites, na, nsites/2, ia)] = -1.0;
+  }
+
+  if (ndevice > 0) {
+    /* The target values are restored */
+    site_sync_memcpy(sync, hdata, tdata, nsites, na, sizeof(double),
+		     tdpMemcpyDeviceToHost);
+    for (ia = 0; ia < na; ia++) {
+      test_assert(hdata[addr_rank1(nsites, na, 1, ia)] == 1.0*(na + ia));
+    }
+    tdpFree(tdata);
+  }
+  else {
+    site_sync_memcpy(sync, hdata, tdata, nsites, na, sizeof(double),
+		     tdpMemcpyDeviceToHost);
+    for (ia = 0; ia < na; ia++) {
+      test_assert(hdata[addr_rank1(nsites, na, 1, ia)] == -1.0);
+    }
+  }
+
+  site_sync_free(sync);
+  free(hdata);
+
+  return 0;
+}
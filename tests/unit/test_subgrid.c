@@ -0,0 +1,262 @@
+/*****************************************************************************
+ *
+ *  test_subgrid.c
+ *
+ *  Subgrid (point-like) particles: force spreading and velocity
+ *  interpolation.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2019 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "physics.h"
+#include "colloids_s.h"
+#include "colloids_halo.h"
+#include "hydro_s.h"
+#include "subgrid.h"
+#include "tests.h"
+
+#define SUBGRID_NP 40
+#define SUBGRID_A0 1.25
+
+static int test_subgrid_force(pe_t * pe, cs_t * cs, int ncell[3]);
+static int test_subgrid_update(pe_t * pe, cs_t * cs);
+static int test_subgrid_config(colloids_info_t * cinfo);
+
+/*****************************************************************************
+ *
+ *  test_subgrid_suite
+ *
+ *****************************************************************************/
+
+int test_subgrid_suite(void) {
+
+  int nlocal[3];
+  int ncell[3];
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  physics_t * phys = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  physics_create(pe, &phys);
+
+  /* Usual cells (two colours per direction) and narrow cells
+   * (more than two colours). The narrow cells are two lattice
+   * units wide: the halo cells must still hold every particle
+   * which reaches a local site, i.e., within two lattice units. */
+
+  ncell[X] = 2; ncell[Y] = 2; ncell[Z] = 2;
+  test_subgrid_force(pe, cs, ncell);
+
+  ncell[X] = nlocal[X]/2; ncell[Y] = nlocal[Y]/2; ncell[Z] = nlocal[Z]/2;
+  test_subgrid_force(pe, cs, ncell);
+  test_subgrid_update(pe, cs);
+
+  physics_free(phys);
+  cs_free(cs);
+  pe_info(pe, "PASS     ./unit/test_subgrid\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_subgrid_force
+ *
+ *  The Peskin weights sum to unity, so the total force spread to the
+ *  lattice must be the number of particles times the external force,
+ *  for any cells (per direction, per process) at least two lattice
+ *  units wide.
+ *
+ *****************************************************************************/
+
+static int test_subgrid_force(pe_t * pe, cs_t * cs, int ncell[3]) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  double g[3] = {0.001, -0.002, 0.0005};
+  double fzero[3] = {0.0, 0.0, 0.0};
+  double flocal[3] = {0.0, 0.0, 0.0};
+  double fsum[3];
+  MPI_Comm comm;
+
+  colloids_info_t * cinfo = NULL;
+  hydro_t * hydro = NULL;
+  physics_t * phys = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  cs_nlocal(cs, nlocal);
+  cs_cart_comm(cs, &comm);
+
+  physics_ref(&phys);
+  physics_fgrav_set(phys, g);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  hydro_create(pe, cs, NULL, 1, &hydro);
+  hydro_f_zero(hydro, fzero);
+
+  test_subgrid_config(cinfo);
+  subgrid_force_from_particles(cinfo, hydro);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	flocal[X] += hydro->f[addr_rank1(hydro->nsite, NHDIM, index, X)];
+	flocal[Y] += hydro->f[addr_rank1(hydro->nsite, NHDIM, index, Y)];
+	flocal[Z] += hydro->f[addr_rank1(hydro->nsite, NHDIM, index, Z)];
+      }
+    }
+  }
+
+  MPI_Allreduce(flocal, fsum, 3, MPI_DOUBLE, MPI_SUM, comm);
+
+  test_assert(fabs(fsum[X] - SUBGRID_NP*g[X]) < DBL_EPSILON*SUBGRID_NP);
+  test_assert(fabs(fsum[Y] - SUBGRID_NP*g[Y]) < DBL_EPSILON*SUBGRID_NP);
+  test_assert(fabs(fsum[Z] - SUBGRID_NP*g[Z]) < DBL_EPSILON*SUBGRID_NP);
+
+  g[X] = 0.0; g[Y] = 0.0; g[Z] = 0.0;
+  physics_fgrav_set(phys, g);
+
+  hydro_free(hydro);
+  colloids_info_free(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_subgrid_update
+ *
+ *  The Peskin kernel has zero first moment, so a velocity field
+ *  linear in position is interpolated exactly. With no external
+ *  force, the particle velocity is the interpolated fluid velocity.
+ *
+ *****************************************************************************/
+
+static int test_subgrid_update(pe_t * pe, cs_t * cs) {
+
+  int ic, jc, kc, index;
+  int nlocal[3];
+  int noffset[3];
+  int ncell[3] = {2, 2, 2};
+  double u[3];
+  double du = 0.001;
+  colloid_t * pc = NULL;
+
+  colloids_info_t * cinfo = NULL;
+  hydro_t * hydro = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  hydro_create(pe, cs, NULL, 1, &hydro);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	u[X] = 0.01 + du*(noffset[X] + ic);
+	u[Y] = 0.02 - du*(noffset[Y] + jc);
+	u[Z] = 0.03 + du*(noffset[X] + ic + noffset[Z] + kc);
+	hydro_u_set(hydro, index, u);
+      }
+    }
+  }
+
+  test_subgrid_config(cinfo);
+  subgrid_update(cinfo, hydro);
+
+  /* Particles away from the domain boundaries (the halo of u is
+   * not set) */
+
+  colloids_info_local_head(cinfo, &pc);
+
+  for (; pc; pc = pc->nextlocal) {
+    double r[3];
+    r[X] = pc->s.r[X] - noffset[X];
+    r[Y] = pc->s.r[Y] - noffset[Y];
+    r[Z] = pc->s.r[Z] - noffset[Z];
+    if (r[X] < 3.0 || r[X] > nlocal[X] - 2.0) continue;
+    if (r[Y] < 3.0 || r[Y] > nlocal[Y] - 2.0) continue;
+    if (r[Z] < 3.0 || r[Z] > nlocal[Z] - 2.0) continue;
+    test_assert(fabs(pc->s.v[X] - (0.01 + du*pc->s.r[X])) < FLT_EPSILON);
+    test_assert(fabs(pc->s.v[Y] - (0.02 - du*pc->s.r[Y])) < FLT_EPSILON);
+    test_assert(fabs(pc->s.v[Z] - (0.03 + du*(pc->s.r[X] + pc->s.r[Z])))
+		< FLT_EPSILON);
+    test_assert(fabs(pc->s.dr[X] - pc->s.v[X]) < DBL_EPSILON);
+  }
+
+  hydro_free(hydro);
+  colloids_info_free(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_subgrid_config
+ *
+ *  SUBGRID_NP particles at pseudo-random positions throughout the
+ *  system, including pairs close enough to share lattice sites.
+ *
+ *****************************************************************************/
+
+static int test_subgrid_config(colloids_info_t * cinfo) {
+
+  int n, ia;
+  double ltot[3];
+  double lmin[3];
+  double r[3];
+  colloid_t * pc = NULL;
+
+  assert(cinfo);
+
+  cs_ltot(cinfo->cs, ltot);
+  cs_lmin(cinfo->cs, lmin);
+
+  /* Particle 2m is displaced from particle 2m - 1 by 1.3 in x */
+
+  for (n = 1; n <= SUBGRID_NP; n++) {
+    int m = (n + 1)/2;
+    for (ia = 0; ia < 3; ia++) {
+      double x = fmod(0.618034*m*(ia + 1) + 0.1*ia, 1.0);
+      r[ia] = lmin[ia] + x*ltot[ia];
+    }
+    if (n % 2 == 0) r[X] = lmin[X] + fmod(r[X] - lmin[X] + 1.3, ltot[X]);
+    colloids_info_add_local(cinfo, n, r, &pc);
+    if (pc) {
+      pc->s.type = COLLOID_TYPE_SUBGRID;
+      pc->s.a0 = SUBGRID_A0;
+      pc->s.ah = SUBGRID_A0;
+    }
+  }
+
+  colloids_info_ntotal_set(cinfo);
+  colloids_halo_state(cinfo);
+
+  return 0;
+}
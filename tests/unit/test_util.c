@@ -29,6 +29,7 @@
 
 int util_svd_check(int m, int n, double ** a);
 int util_random_unit_vector_check(void);
+int util_philox_check(void);
 
 /*****************************************************************************
  *
@@ -67,6 +68,7 @@ int test_util_suite(void) {
 
   util_matrix_free(m, &a);
   util_random_unit_vector_check();
+  util_philox_check();
 
   pe_info(pe, "PASS     ./unit/test_util\n");
   pe_free(pe);
@@ -216,5 +218,80 @@ int util_random_unit_vector_check(void) {
   /*info("Component <Z> is %g (ok)\n", rmean[2]);*/
 
 
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  util_philox_check
+ *
+ *  Known answers for Philox-4x32-10 (from the Random123 distribution),
+ *  and the moments of the uniform and Gaussian deviates.
+ *
+ *****************************************************************************/
+
+int util_philox_check(void) {
+
+  int n;
+  unsigned int ctr[4];
+  unsigned int key[2];
+  unsigned int r[4];
+  double u[4], g[4];
+  double umean = 0.0;
+  double gmean = 0.0, gvar = 0.0;
+  double umin = 1.0, umax = 0.0;
+
+  ctr[0] = 0; ctr[1] = 0; ctr[2] = 0; ctr[3] = 0;
+  key[0] = 0; key[1] = 0;
+  util_philox4x32(ctr, key, r);
+  test_assert(r[0] == 0x6627e8d5U);
+  test_assert(r[1] == 0xe169c58dU);
+  test_assert(r[2] == 0xbc57ac4cU);
+  test_assert(r[3] == 0x9b00dbd8U);
+
+  ctr[0] = 0xffffffffU; ctr[1] = 0xffffffffU;
+  ctr[2] = 0xffffffffU; ctr[3] = 0xffffffffU;
+  key[0] = 0xffffffffU; key[1] = 0xffffffffU;
+  util_philox4x32(ctr, key, r);
+  test_assert(r[0] == 0x408f276dU);
+  test_assert(r[1] == 0x41c83b0eU);
+  test_assert(r[2] == 0xa20bc7c6U);
+  test_assert(r[3] == 0x6d5451fdU);
+
+  ctr[0] = 0x243f6a88U; ctr[1] = 0x85a308d3U;
+  ctr[2] = 0x13198a2eU; ctr[3] = 0x03707344U;
+  key[0] = 0xa4093822U; key[1] = 0x299f31d0U;
+  util_philox4x32(ctr, key, r);
+  test_assert(r[0] == 0xd16cfe09U);
+  test_assert(r[1] == 0x94fdccebU);
+  test_assert(r[2] == 0x5001e420U);
+  test_assert(r[3] == 0x24126ea1U);
+
+  /* Moments: four values per counter */
+
+  key[0] = 17; key[1] = 1;
+  ctr[1] = 0; ctr[2] = 0; ctr[3] = 0;
+
+  for (n = 0; n < NLARGE/4; n++) {
+    ctr[0] = n;
+    util_philox_uniform(ctr, key, u);
+    util_philox_gaussian(ctr, key, g);
+    umean += u[0] + u[1] + u[2] + u[3];
+    umin = dmin(umin, dmin(dmin(u[0], u[1]), dmin(u[2], u[3])));
+    umax = dmax(umax, dmax(dmax(u[0], u[1]), dmax(u[2], u[3])));
+    gmean += g[0] + g[1] + g[2] + g[3];
+    gvar += g[0]*g[0] + g[1]*g[1] + g[2]*g[2] + g[3]*g[3];
+  }
+
+  umean /= NLARGE;
+  gmean /= NLARGE;
+  gvar /= NLARGE;
+
+  test_assert(umin > 0.0);
+  test_assert(umax < 1.0);
+  test_assert(fabs(umean - 0.5) < STAT_TOLERANCE);
+  test_assert(fabs(gmean) < STAT_TOLERANCE);
+  test_assert(fabs(gvar - 1.0) < STAT_TOLERANCE);
+
   return 0;
 }
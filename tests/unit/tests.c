@@ -57,12 +57,16 @@ int tests_create() {
   test_bp_suite();
   test_build_suite();
   test_colloid_suite();
+  test_colloid_link_suite();
   test_colloid_sums_suite();
   test_colloids_info_suite();
   test_colloids_halo_suite();
+  test_colloids_nlist_suite();
+  test_colloids_soa_suite();
   test_ewald_suite();
   test_fe_electro_suite();
   test_fe_electro_symm_suite();
+  test_fft_suite();
   test_field_suite();
   test_field_grad_suite();
   test_halo_suite();
@@ -76,11 +80,16 @@ int tests_create() {
   test_pair_lj_cut_suite();
   test_pair_ss_cut_suite();
   test_pair_yukawa_suite();
+  test_perf_suite();
   test_polar_active_suite();
   test_psi_suite();
+  test_psi_mg_suite();
+  test_pth_suite();
   test_lb_prop_suite();
   test_random_suite();
   test_rt_suite();
+  test_site_sync_suite();
+  test_subgrid_suite();
   test_timer_suite();
   test_util_suite();
 
@@ -31,12 +31,16 @@ int test_bonds_suite(void);
 int test_build_suite(void);
 int test_colloid_sums_suite(void);
 int test_colloid_suite(void);
+int test_colloid_link_suite(void);
 int test_colloids_info_suite(void);
 int test_colloids_halo_suite(void);
+int test_colloids_nlist_suite(void);
+int test_colloids_soa_suite(void);
 int test_coords_suite(void);
 int test_ewald_suite(void);
 int test_fe_electro_suite(void);
 int test_fe_electro_symm_suite(void);
+int test_fft_suite(void);
 int test_field_suite(void);
 int test_field_grad_suite(void);
 int test_halo_suite(void);
@@ -53,13 +57,18 @@ int test_pair_lj_cut_suite(void);
 int test_pair_ss_cut_suite(void);
 int test_pair_yukawa_suite(void);
 int test_pe_suite(void);
+int test_perf_suite(void);
 int test_phi_ch_suite(void);
 int test_polar_active_suite(void);
 int test_lb_prop_suite(void);
 int test_psi_suite(void);
+int test_psi_mg_suite(void);
 int test_psi_sor_suite(void);
+int test_pth_suite(void);
 int test_random_suite(void);
 int test_rt_suite(void);
+int test_site_sync_suite(void);
+int test_subgrid_suite(void);
 int test_timer_suite(void);
 int test_util_suite(void);
 